@@ -5,6 +5,8 @@ void run_memory_benchmark();
 void run_prompt_benchmark();
 void run_config_benchmark();
 void run_performance_benchmarks();
+void run_local_model_benchmark();
+void run_gateway_http_benchmark();
 
 int main() {
   std::cout << "GhostClaw Benchmarks\n";
@@ -13,5 +15,7 @@ int main() {
   run_prompt_benchmark();
   run_config_benchmark();
   run_performance_benchmarks();
+  run_local_model_benchmark();
+  run_gateway_http_benchmark();
   return 0;
 }
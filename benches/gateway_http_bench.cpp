@@ -0,0 +1,89 @@
+#include "bench_common.hpp"
+
+#include "ghostclaw/gateway/http_parser.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+// The request as a client sends it, delivered in reads of this size.
+constexpr std::size_t kReadSize = 512;
+
+std::string make_request() {
+  std::string body(4096, 'x');
+  std::string raw = "POST /webhook?session=abc HTTP/1.1\r\n"
+                    "Host: 127.0.0.1:8080\r\n"
+                    "User-Agent: bench\r\n"
+                    "Accept: */*\r\n"
+                    "Authorization: Bearer 0123456789abcdef\r\n"
+                    "Content-Type: application/json\r\n";
+  raw += "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+  return raw;
+}
+
+// The gateway's previous path: grow a string, rescan it for the end of the headers after
+// every read, then copy everything through an istringstream.
+std::size_t legacy_parse(const std::string &wire) {
+  std::string raw;
+  std::size_t header_end = std::string::npos;
+  std::size_t content_length = 0;
+  for (std::size_t offset = 0; offset < wire.size(); offset += kReadSize) {
+    raw.append(wire, offset, kReadSize);
+    if (header_end == std::string::npos) {
+      header_end = raw.find("\r\n\r\n");
+      if (header_end != std::string::npos) {
+        const auto cl = raw.find("Content-Length:");
+        content_length = std::stoul(raw.substr(cl + 15));
+      }
+    }
+    if (header_end != std::string::npos && raw.size() >= header_end + 4 + content_length) {
+      break;
+    }
+  }
+  std::istringstream stream(raw.substr(0, header_end));
+  std::string method;
+  std::string path;
+  std::string version;
+  stream >> method >> path >> version;
+  std::string line;
+  std::getline(stream, line);
+  std::unordered_map<std::string, std::string> headers;
+  while (std::getline(stream, line)) {
+    const auto colon = line.find(':');
+    if (colon == std::string::npos) {
+      continue;
+    }
+    std::string key = line.substr(0, colon);
+    std::transform(key.begin(), key.end(), key.begin(),
+                   [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+    headers[key] = line.substr(colon + 1);
+  }
+  const std::string body = raw.substr(header_end + 4, content_length);
+  return headers.size() + body.size();
+}
+
+std::size_t incremental_parse(ghostclaw::gateway::HttpRequestParser &parser,
+                              const std::string &wire) {
+  for (std::size_t offset = 0; offset < wire.size(); offset += kReadSize) {
+    (void)parser.feed(std::string_view(wire).substr(offset, kReadSize));
+  }
+  const std::size_t size = parser.request().headers.size() + parser.request().body.size();
+  (void)parser.consume();
+  return size;
+}
+
+} // namespace
+
+void run_gateway_http_benchmark() {
+  const std::string wire = make_request();
+  volatile std::size_t sink = 0;
+  ghostclaw::bench::run_bench("gateway_http_parse_legacy", 20000,
+                              [&] { sink = sink + legacy_parse(wire); });
+  ghostclaw::gateway::HttpRequestParser parser;
+  ghostclaw::bench::run_bench("gateway_http_parse_incremental", 20000,
+                              [&] { sink = sink + incremental_parse(parser, wire); });
+}
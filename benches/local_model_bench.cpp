@@ -0,0 +1,120 @@
+#include "bench_common.hpp"
+
+#include "ghostclaw/providers/gguf.hpp"
+#include "ghostclaw/providers/local_model.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace {
+
+namespace p = ghostclaw::providers;
+
+// Random Q8_0 weights shaped like a small chat model (about 60M parameters), so the
+// kernels can be timed without downloading one. GHOSTCLAW_BENCH_GGUF points at a real
+// model instead.
+std::filesystem::path write_bench_model(const std::filesystem::path &path) {
+  constexpr std::uint64_t embd = 512;
+  constexpr std::uint64_t ff = 1536;
+  constexpr std::uint64_t kv = 128;
+  constexpr std::uint64_t layers = 8;
+  std::vector<std::string> pieces = {"<unk>", "<s>", "</s>"};
+  std::vector<std::int32_t> types = {2, 3, 3};
+  for (int b = 0; b < 256; ++b) {
+    static constexpr char kHex[] = "0123456789ABCDEF";
+    pieces.push_back(std::string("<0x") + kHex[b >> 4] + kHex[b & 15] + ">");
+    types.push_back(6);
+  }
+  for (char c = 'a'; c <= 'z'; ++c) {
+    pieces.emplace_back(1, c);
+    pieces.push_back("\xE2\x96\x81" + std::string(1, c));
+    types.insert(types.end(), {1, 1});
+  }
+  while (pieces.size() < 8000) {
+    pieces.push_back("tok" + std::to_string(pieces.size()));
+    types.push_back(1);
+  }
+  const std::uint64_t vocab = pieces.size();
+
+  std::mt19937_64 rng(1);
+  std::uniform_real_distribution<float> dist(-0.05F, 0.05F);
+  const auto quantized = [&](const std::uint64_t count) {
+    std::vector<float> values(count);
+    for (auto &value : values) value = dist(rng);
+    return p::quantize_q8_0(values);
+  };
+
+  p::GgufWriter writer;
+  writer.set_string("general.architecture", "llama");
+  writer.set_uint("llama.context_length", 2048);
+  writer.set_uint("llama.embedding_length", embd);
+  writer.set_uint("llama.block_count", layers);
+  writer.set_uint("llama.feed_forward_length", ff);
+  writer.set_uint("llama.attention.head_count", 8);
+  writer.set_uint("llama.attention.head_count_kv", 2);
+  writer.set_string("tokenizer.ggml.model", "llama");
+  writer.set_strings("tokenizer.ggml.tokens", pieces);
+  writer.set_floats("tokenizer.ggml.scores", std::vector<float>(vocab, 0.0F));
+  writer.set_ints("tokenizer.ggml.token_type", types);
+  writer.add_tensor("token_embd.weight", {embd, vocab}, p::GgmlType::Q8_0, quantized(embd * vocab));
+  writer.add_f32("output_norm.weight", {embd}, std::vector<float>(embd, 1.0F));
+  for (std::uint64_t l = 0; l < layers; ++l) {
+    const std::string prefix = "blk." + std::to_string(l) + ".";
+    writer.add_f32(prefix + "attn_norm.weight", {embd}, std::vector<float>(embd, 1.0F));
+    writer.add_f32(prefix + "ffn_norm.weight", {embd}, std::vector<float>(embd, 1.0F));
+    writer.add_tensor(prefix + "attn_q.weight", {embd, embd}, p::GgmlType::Q8_0, quantized(embd * embd));
+    writer.add_tensor(prefix + "attn_k.weight", {embd, kv}, p::GgmlType::Q8_0, quantized(embd * kv));
+    writer.add_tensor(prefix + "attn_v.weight", {embd, kv}, p::GgmlType::Q8_0, quantized(embd * kv));
+    writer.add_tensor(prefix + "attn_output.weight", {embd, embd}, p::GgmlType::Q8_0,
+                      quantized(embd * embd));
+    writer.add_tensor(prefix + "ffn_gate.weight", {embd, ff}, p::GgmlType::Q8_0, quantized(embd * ff));
+    writer.add_tensor(prefix + "ffn_up.weight", {embd, ff}, p::GgmlType::Q8_0, quantized(embd * ff));
+    writer.add_tensor(prefix + "ffn_down.weight", {ff, embd}, p::GgmlType::Q8_0, quantized(ff * embd));
+  }
+  (void)writer.write(path);
+  return path;
+}
+
+} // namespace
+
+void run_local_model_benchmark() {
+  std::filesystem::path path;
+  bool synthetic = false;
+  if (const char *env = std::getenv("GHOSTCLAW_BENCH_GGUF"); env != nullptr && *env != '\0') {
+    path = env;
+  } else {
+    path = write_bench_model(std::filesystem::temp_directory_path() /
+                             "ghostclaw-local-model-bench.gguf");
+    synthetic = true;
+  }
+  auto loaded = p::LocalModel::load(path, {.context_length = 1024, .cache_slots = 1});
+  if (!loaded.ok()) {
+    std::cout << "local_model: skipped (" << loaded.error() << ")\n";
+    return;
+  }
+  auto &model = loaded.value();
+  std::cout << "local_model: arch=" << model->architecture() << " threads=" << model->threads()
+            << "\n";
+
+  std::string prompt;
+  for (int i = 0; i < 10; ++i) {
+    prompt += "the quick brown fox jumps over the lazy dog ";
+  }
+  const p::LocalGenerateOptions prefill_only{.max_tokens = 1, .temperature = 0.0F};
+  int round = 0;
+  // A distinct first word defeats the prefix cache so every iteration prefills in full.
+  ghostclaw::bench::run_bench("local_model_prefill", 3, [&] {
+    (void)model->generate(std::to_string(round++) + " " + prompt, prefill_only);
+  });
+  const p::LocalGenerateOptions decode{.max_tokens = 32, .temperature = 0.0F};
+  ghostclaw::bench::run_bench("local_model_decode_32", 3,
+                              [&] { (void)model->generate(prompt, decode); });
+  model.reset();
+  if (synthetic) {
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+  }
+}
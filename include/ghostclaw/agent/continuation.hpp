@@ -0,0 +1,89 @@
+#pragma once
+
+#include "ghostclaw/agent/tool_executor.hpp"
+#include "ghostclaw/common/result.hpp"
+#include "ghostclaw/security/approval.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace ghostclaw::agent {
+
+// A turn suspended on tool calls that need a human decision. It carries everything the
+// tool loop needs to go on, so whichever worker receives the decision can resume it.
+struct ParkedTurn {
+  std::string id;
+  std::string session_id;
+  std::string agent_id;
+  std::string channel_id;
+  std::string group_id;
+  std::string tool_profile;
+  std::string model;
+  double temperature = 0.7;
+  // The user message the turn started with.
+  std::string message;
+  std::string system_prompt;
+  std::string memory_context;
+  // Prompt of the provider call whose tool calls are waiting.
+  std::string current_prompt;
+  std::size_t iteration = 0;
+  std::size_t max_tool_iterations = 10;
+  // What the approver is asked about, one line per pending call.
+  std::string command;
+  std::string created_at;
+  // Results of earlier iterations, then those of the waiting batch that already ran.
+  std::vector<ToolCallResult> completed;
+  std::size_t batch_start = 0;
+  std::vector<ToolCallRequest> pending;
+};
+
+[[nodiscard]] std::string parked_turn_to_json(const ParkedTurn &turn);
+[[nodiscard]] common::Result<ParkedTurn> parked_turn_from_json(const std::string &json);
+
+struct ApprovalReply {
+  std::string id;
+  security::ApprovalDecision decision = security::ApprovalDecision::Deny;
+};
+
+// "/approve <id>", "/approve-always <id>" or "/deny <id>" as sent from a chat channel.
+// Telegram's "/approve@bot" form is accepted too.
+[[nodiscard]] std::optional<ApprovalReply> parse_approval_reply(const std::string &text);
+
+// Parked turns as one JSON file each, so they survive restarts and any process sharing
+// the workspace can resume them. Turns nobody answers within `ttl` are swept.
+class ContinuationStore {
+public:
+  static constexpr std::chrono::seconds kDefaultTtl{24 * 60 * 60};
+
+  explicit ContinuationStore(std::filesystem::path root, std::chrono::seconds ttl = kDefaultTtl);
+
+  // <workspace>/.ghostclaw/parked-turns
+  [[nodiscard]] static std::filesystem::path default_root(const std::filesystem::path &workspace);
+
+  // Assigns turn.id when empty. Sweeps expired turns first.
+  [[nodiscard]] common::Result<std::string> park(ParkedTurn turn);
+  // Claims and returns the turn. Claiming is atomic: of several callers resuming the
+  // same id, exactly one gets it. The claimed file stays on disk until finish() or
+  // release(), so a resume that dies midway is not lost before the sweep reaps it.
+  [[nodiscard]] common::Result<ParkedTurn> take(const std::string &id);
+  // Drops a claimed turn once its resumed run is over.
+  void finish(const std::string &id);
+  // Puts a claimed turn back, e.g. when the caller turned out not to own it.
+  void release(const std::string &id);
+  // Removes parked and claimed turns older than the TTL; returns how many went.
+  std::size_t sweep();
+  [[nodiscard]] std::vector<ParkedTurn> list(const std::optional<std::string> &session_id = {}) const;
+
+private:
+  [[nodiscard]] std::filesystem::path path_for(const std::string &id) const;
+  [[nodiscard]] std::filesystem::path claimed_path_for(const std::string &id) const;
+  [[nodiscard]] bool expired(const std::filesystem::path &path) const;
+
+  std::filesystem::path root_;
+  std::chrono::seconds ttl_;
+};
+
+} // namespace ghostclaw::agent
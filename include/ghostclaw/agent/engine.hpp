@@ -1,17 +1,29 @@
 #pragma once
 
 #include "ghostclaw/agent/context.hpp"
+#include "ghostclaw/agent/continuation.hpp"
 #include "ghostclaw/agent/tool_executor.hpp"
+#include "ghostclaw/common/cancel.hpp"
 #include "ghostclaw/config/schema.hpp"
 #include "ghostclaw/memory/memory.hpp"
+#include "ghostclaw/memory/write_behind.hpp"
+#include "ghostclaw/providers/admission.hpp"
+#include "ghostclaw/providers/router.hpp"
 #include "ghostclaw/providers/traits.hpp"
+#include "ghostclaw/security/approval.hpp"
+#include "ghostclaw/tools/output_store.hpp"
+#include "ghostclaw/tools/tool_catalog.hpp"
 #include "ghostclaw/tools/tool_registry.hpp"
 
+#include <atomic>
 #include <chrono>
 #include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace ghostclaw::agent {
@@ -25,13 +37,31 @@ struct AgentOptions {
   std::optional<std::string> channel_id;
   std::optional<std::string> group_id;
   std::optional<std::string> tool_profile;
+  // Prior conversation for this session, e.g. from sessions::SessionHistory; added to
+  // the turn context after memory and skills.
+  std::string history_context;
   std::size_t max_tool_iterations = 10;
+  // Cancelling aborts the in-flight provider request and any running tool calls; the
+  // run then fails with kTurnCancelled.
+  std::shared_ptr<common::CancelToken> cancel_token;
+  // Background turns (heartbeat, cron, agent-to-agent) yield provider capacity to
+  // interactive ones. Sessions (or agents, without one) share it fairly.
+  providers::RequestPriority priority = providers::RequestPriority::Interactive;
+  // Receives tool output while tools are still running (see tools::ToolContext::on_output).
+  std::function<void(const tools::ToolOutputChunk &)> on_tool_output;
+  // When a tool call needs a human decision, park the turn and return at once (see
+  // AgentEngine::resume) instead of holding this thread until the approval socket answers.
+  bool park_on_approval = false;
 };
 
+inline constexpr std::string_view kTurnCancelled = "turn cancelled";
+
 struct Usage {
   std::size_t prompt_tokens = 0;
   std::size_t completion_tokens = 0;
   std::size_t total_tokens = 0;
+  // Part of prompt_tokens served from the provider's prompt cache.
+  std::size_t cached_prompt_tokens = 0;
 };
 
 struct AgentResponse {
@@ -39,6 +69,9 @@ struct AgentResponse {
   std::vector<ToolCallResult> tool_results;
   Usage usage;
   std::chrono::milliseconds duration{0};
+  // Set when the turn is parked until someone approves pending_approval_command.
+  std::optional<std::string> pending_approval_id;
+  std::string pending_approval_command;
 };
 
 struct StreamCallbacks {
@@ -60,14 +93,69 @@ public:
                                           const StreamCallbacks &callbacks,
                                           const AgentOptions &options = {});
   [[nodiscard]] common::Status run_interactive(const AgentOptions &options = {});
+  // Continues a turn parked on approval: the waiting calls run (or are refused) on this
+  // thread, then the tool loop picks up where it stopped. Any engine sharing the workspace
+  // can resume a turn. Fails for unknown ids and when options.session_id is set to another
+  // session than the turn's.
+  [[nodiscard]] common::Result<AgentResponse> resume(const std::string &approval_id,
+                                                     security::ApprovalDecision decision,
+                                                     const AgentOptions &options = {});
+  [[nodiscard]] std::vector<ParkedTurn>
+  parked_turns(const std::optional<std::string> &session_id = {}) const;
 
   [[nodiscard]] std::string build_system_prompt();
   [[nodiscard]] std::string build_memory_context(const std::string &message);
+  // Folds new conversation lines into a running summary with one provider call.
+  // Matches sessions::HistorySummarizer.
+  [[nodiscard]] common::Result<std::string> summarize_history(const std::string &previous_summary,
+                                                              const std::string &new_messages,
+                                                              std::size_t token_budget);
+  [[nodiscard]] memory::IMemory *memory() const { return memory_.get(); }
+
+  // Routes simple run() turns to the router's fast model. Set before the first turn.
+  void set_model_router(std::shared_ptr<providers::ModelRouter> router);
+  // Empty when no router is set.
+  [[nodiscard]] std::optional<providers::RouterStats> router_stats() const;
 
 private:
+  struct TurnPreparation {
+    std::string system_prompt;
+    std::string context;
+    bool skills_matched = false;
+  };
+
+  // Builds the system prompt, memory context and skill context for a turn. The three
+  // stages are independent, so they run concurrently.
+  [[nodiscard]] TurnPreparation prepare_turn(const std::string &message,
+                                             const AgentOptions &options);
+  void start_provider_warmup();
+
+  // Tool specs offered to the provider this turn; see ToolCatalog::select.
+  [[nodiscard]] std::vector<tools::ToolSpec> select_tools(const std::string &message,
+                                                          const std::string &context,
+                                                          const tools::ToolContext &ctx) const;
+  void remember_tools(const std::string &session_id, const std::vector<ToolCallResult> &results);
+  // Text for the next prompt: the output itself, or a preview and handle once it is
+  // over tools.spill_threshold_bytes and the turn may call tool_output. AgentResponse
+  // keeps the full output either way.
+  [[nodiscard]] std::string prompt_tool_output(const ToolCallResult &result,
+                                               const tools::ToolContext &ctx);
+
+  [[nodiscard]] tools::ToolContext tool_context(const AgentOptions &options) const;
   [[nodiscard]] common::Result<AgentResponse>
   process_with_tools(const std::string &message, const std::string &system_prompt,
-                     const std::string &memory_context, const AgentOptions &options);
+                     const std::string &memory_context, const AgentOptions &options,
+                     providers::RouteTier &tier);
+  // Provider and tool rounds from turn.iteration on. A batch with calls awaiting approval
+  // parks the turn.
+  [[nodiscard]] common::Result<AgentResponse>
+  tool_loop(ParkedTurn &turn, const tools::ToolContext &ctx,
+            const std::vector<tools::ToolSpec> &tool_specs, const AgentOptions &options);
+  [[nodiscard]] common::Result<AgentResponse> park_turn(ParkedTurn turn, std::size_t batch_start,
+                                                        std::vector<ToolCallRequest> pending);
+  // The turn's message followed by the results of turn.completed[from..].
+  [[nodiscard]] std::string tool_results_prompt(const ParkedTurn &turn, std::size_t from,
+                                                const tools::ToolContext &ctx);
 
   [[nodiscard]] bool detect_prompt_injection(const std::string &input) const;
   [[nodiscard]] bool detect_prompt_leak(const std::string &output) const;
@@ -75,14 +163,25 @@ private:
 
   const config::Config &config_;
   std::shared_ptr<providers::Provider> provider_;
+  std::shared_ptr<providers::ModelRouter> router_;
   std::unique_ptr<memory::IMemory> memory_;
+  memory::WriteBehindMemory *auto_save_ = nullptr;
   tools::ToolRegistry tools_;
+  tools::ToolCatalog tool_catalog_;
   ToolExecutor tool_executor_;
+  std::shared_ptr<security::ToolPolicyPipeline> tool_policy_;
+  std::shared_ptr<security::ApprovalManager> approval_;
+  ContinuationStore continuations_;
+  mutable std::mutex recent_tools_mutex_;
+  std::unordered_map<std::string, std::vector<std::string>> recent_tools_;
   ContextBuilder context_builder_;
   std::filesystem::path workspace_;
+  tools::ToolOutputStore output_store_;
   std::vector<std::string> skill_instructions_;
   std::vector<std::string> skill_prompts_;
   std::vector<std::string> skill_index_entries_;
+  std::atomic<bool> warmup_started_{false};
+  std::future<void> warmup_future_;
 };
 
 } // namespace ghostclaw::agent
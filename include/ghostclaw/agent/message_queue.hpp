@@ -1,17 +1,24 @@
 #pragma once
 
+#include "ghostclaw/common/cancel.hpp"
+
 #include <chrono>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <queue>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 namespace ghostclaw::agent {
 
 enum class QueueMode { Steer, Followup, Collect };
 
+[[nodiscard]] std::optional<QueueMode> queue_mode_from_string(std::string_view value);
+
 struct QueuedMessage {
   std::string content;
   std::string sender;
@@ -35,4 +42,39 @@ private:
   std::queue<QueuedMessage> queue_;
 };
 
+// Cancel tokens for the turns running or waiting on each session. A turn that starts in
+// Steer mode supersedes every turn already registered for its session.
+class ActiveTurns {
+public:
+  [[nodiscard]] std::shared_ptr<common::CancelToken> begin(const std::string &session_id,
+                                                           QueueMode mode);
+  void end(const std::string &session_id, const std::shared_ptr<common::CancelToken> &token);
+  // Returns how many turns were cancelled.
+  std::size_t cancel(const std::string &session_id);
+  // Cancels every registered turn, e.g. on shutdown.
+  std::size_t cancel_all();
+
+private:
+  std::mutex mutex_;
+  std::unordered_map<std::string, std::vector<std::shared_ptr<common::CancelToken>>> turns_;
+};
+
+// Keeps a turn registered with ActiveTurns for the lifetime of the scope.
+class ActiveTurn {
+public:
+  ActiveTurn(ActiveTurns &turns, std::string session_id, QueueMode mode);
+  ~ActiveTurn();
+
+  ActiveTurn(const ActiveTurn &) = delete;
+  ActiveTurn &operator=(const ActiveTurn &) = delete;
+
+  [[nodiscard]] const std::shared_ptr<common::CancelToken> &token() const { return token_; }
+  [[nodiscard]] bool cancelled() const { return token_->is_cancelled(); }
+
+private:
+  ActiveTurns &turns_;
+  std::string session_id_;
+  std::shared_ptr<common::CancelToken> token_;
+};
+
 } // namespace ghostclaw::agent
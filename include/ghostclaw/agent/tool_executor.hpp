@@ -18,6 +18,14 @@ namespace ghostclaw::sandbox {
 class SandboxManager;
 } // namespace sandbox
 
+namespace ghostclaw::nodes {
+class NodeScheduler;
+} // namespace nodes
+
+namespace ghostclaw::tools {
+class ToolResultCache;
+} // namespace tools
+
 namespace ghostclaw::agent {
 
 struct ToolCallRequest {
@@ -30,6 +38,11 @@ struct ToolCallResult {
   std::string id;
   std::string name;
   tools::ToolResult result;
+  // Wall time from dispatch to result, including policy, approval and offload.
+  std::chrono::milliseconds duration{0};
+  // Not run: the call waits for a human decision (tools::ToolContext::park_approvals). The
+  // command put to the approver is in result.metadata["approval_command"].
+  bool awaiting_approval = false;
 };
 
 class ToolExecutor {
@@ -38,6 +51,9 @@ public:
     std::shared_ptr<security::ToolPolicyPipeline> tool_policy;
     std::shared_ptr<sandbox::SandboxManager> sandbox;
     std::shared_ptr<security::ApprovalManager> approval;
+    std::shared_ptr<nodes::NodeScheduler> node_scheduler;
+    // Reused results of tools that declare a cache policy; null disables reuse.
+    std::shared_ptr<tools::ToolResultCache> result_cache;
   };
 
   explicit ToolExecutor(tools::ToolRegistry &registry, Dependencies dependencies = {});
@@ -45,11 +61,24 @@ public:
   void set_tool_policy_pipeline(std::shared_ptr<security::ToolPolicyPipeline> tool_policy);
   void set_sandbox_manager(std::shared_ptr<sandbox::SandboxManager> sandbox);
   void set_approval_manager(std::shared_ptr<security::ApprovalManager> approval);
+  void set_node_scheduler(std::shared_ptr<nodes::NodeScheduler> node_scheduler);
+  void set_result_cache(std::shared_ptr<tools::ToolResultCache> result_cache);
 
   [[nodiscard]] std::vector<ToolCallResult> execute(const std::vector<ToolCallRequest> &calls,
                                                     const tools::ToolContext &ctx);
+  // Runs calls a human has already approved: every check but the approval one applies.
+  [[nodiscard]] std::vector<ToolCallResult>
+  execute_approved(const std::vector<ToolCallRequest> &calls, const tools::ToolContext &ctx);
 
 private:
+  [[nodiscard]] std::vector<ToolCallResult> execute_batch(const std::vector<ToolCallRequest> &calls,
+                                                          const tools::ToolContext &ctx,
+                                                          bool approved);
+  [[nodiscard]] ToolCallResult execute_one(const ToolCallRequest &call,
+                                           const tools::ToolContext &ctx,
+                                           std::chrono::steady_clock::time_point now,
+                                           bool approved);
+
   tools::ToolRegistry &registry_;
   std::mutex state_mutex_;
   std::unordered_map<std::string, std::size_t> failure_counts_;
@@ -31,6 +31,11 @@ public:
   receive_text(std::chrono::milliseconds timeout) = 0;
 };
 
+// Plain ws:// client transport; returns nullptr on platforms without socket support.
+// A non-empty bearer_token is sent as the handshake Authorization header.
+[[nodiscard]] std::unique_ptr<ICDPTransport>
+make_websocket_transport(std::string bearer_token = "");
+
 class CDPClient {
 public:
   CDPClient();
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace ghostclaw::common {
+
+// Cooperative cancellation for one unit of work. The owner calls cancel(); workers
+// either poll is_cancelled() or subscribe a callback that interrupts a blocking call.
+// Callbacks run on the cancelling thread with the token locked, so they must be short
+// and must not call back into the token. Once unsubscribe() returns, its callback is
+// guaranteed not to be running.
+class CancelToken {
+public:
+  using Callback = std::function<void()>;
+
+  void cancel();
+  [[nodiscard]] bool is_cancelled() const { return cancelled_.load(); }
+
+  // Returns 0 and runs the callback immediately when already cancelled.
+  [[nodiscard]] std::uint64_t subscribe(Callback callback);
+  void unsubscribe(std::uint64_t id);
+
+  // Sleeps up to `timeout`; returns true as soon as the token is cancelled.
+  bool wait_for(std::chrono::milliseconds timeout);
+
+private:
+  std::atomic<bool> cancelled_{false};
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::uint64_t next_id_ = 1;
+  std::unordered_map<std::uint64_t, Callback> callbacks_;
+};
+
+[[nodiscard]] inline bool is_cancelled(const std::shared_ptr<CancelToken> &token) {
+  return token != nullptr && token->is_cancelled();
+}
+
+// Subscription that is dropped on scope exit. A null token makes it a no-op.
+class CancelSubscription {
+public:
+  CancelSubscription(std::shared_ptr<CancelToken> token, CancelToken::Callback callback);
+  ~CancelSubscription();
+
+  CancelSubscription(const CancelSubscription &) = delete;
+  CancelSubscription &operator=(const CancelSubscription &) = delete;
+
+  void reset();
+
+private:
+  std::shared_ptr<CancelToken> token_;
+  std::uint64_t id_ = 0;
+};
+
+// Provider interfaces do not take a token, so the agent installs the turn's token for
+// the calling thread and the HTTP client picks it up from there.
+[[nodiscard]] std::shared_ptr<CancelToken> current_cancel_token();
+
+class ScopedCancelToken {
+public:
+  explicit ScopedCancelToken(std::shared_ptr<CancelToken> token);
+  ~ScopedCancelToken();
+
+  ScopedCancelToken(const ScopedCancelToken &) = delete;
+  ScopedCancelToken &operator=(const ScopedCancelToken &) = delete;
+
+private:
+  std::shared_ptr<CancelToken> previous_;
+};
+
+} // namespace ghostclaw::common
@@ -31,9 +31,23 @@ struct GatewayConfig {
   bool websocket_tls_enabled = false;
   std::string websocket_tls_cert_file;
   std::string websocket_tls_key_file;
+  // Recent events kept per session so a reconnecting client can resubscribe with `since`.
+  std::size_t websocket_replay_events = 512;
   bool session_send_policy_enabled = true;
   std::uint32_t session_send_policy_max_per_window = 60;
   std::uint32_t session_send_policy_window_seconds = 60;
+  // Gateway turns see a rolling summary plus the last few messages of their session.
+  bool session_history_enabled = true;
+  std::size_t session_history_recent_messages = 8;
+  std::size_t session_history_summary_tokens = 400;
+  // Sessions idle this long move to compressed archive segments; 0 (the default) keeps
+  // them all hot.
+  std::uint32_t session_archive_idle_hours = 0;
+  bool cluster_enabled = false;
+  std::string cluster_dir;
+  std::string cluster_worker_id;
+  std::string cluster_advertise_url;
+  std::uint32_t cluster_lease_seconds = 10;
 };
 
 struct AutonomyConfig {
@@ -46,6 +60,13 @@ struct AutonomyConfig {
                                               "~/.ssh", "~/.gnupg", "~/.aws"};
   std::uint32_t max_actions_per_hour = 100;
   std::uint32_t max_cost_per_day_cents = 1000;
+  // Approval of runtime tool calls (shell and friends); see security::ApprovalPolicy.
+  // With approval_ask other than "off", channel and gateway turns park until someone
+  // answers /approve or /deny; unanswered turns are dropped after approval_ttl_secs.
+  std::string approval_security = "full";
+  std::string approval_ask = "off";
+  std::vector<std::string> approval_allowlist;
+  std::uint64_t approval_ttl_secs = 86400;
 };
 
 struct TelegramConfig {
@@ -94,6 +115,9 @@ struct ChannelsConfig {
   std::optional<IMessageConfig> imessage;
   std::optional<WhatsAppConfig> whatsapp;
   std::optional<WebhookConfig> webhook;
+  // "steer" cancels a session's in-flight turn when a new message arrives for it;
+  // "followup" queues the new message behind it.
+  std::string queue_mode = "followup";
 };
 
 struct CloudflareConfig {
@@ -139,6 +163,59 @@ struct ReliabilityConfig {
   std::uint32_t scheduler_retries = 2;
 };
 
+struct RouterConfig {
+  // Sends simple turns to a fast, usually local, model; everything else keeps
+  // default_provider/default_model.
+  bool enabled = false;
+  std::string fast_provider = "ollama";
+  std::string fast_model = "llama3.2:3b";
+  // Longer messages always take the default model.
+  std::size_t max_fast_chars = 280;
+  // Turns scored below this go to the default model.
+  double min_confidence = 0.6;
+  // Ask the fast model to classify turns the heuristics are unsure about.
+  bool classifier = false;
+};
+
+struct AdmissionConfig {
+  // Process-wide scheduling of upstream provider requests, budgeted per provider and key.
+  bool enabled = true;
+  // Rolling one-minute budgets; 0 leaves one unlimited.
+  std::uint32_t requests_per_minute = 0;
+  std::uint64_t tokens_per_minute = 0;
+  // In-flight requests per provider and key; 0 is unlimited.
+  std::uint32_t max_concurrent = 0;
+  // Share of each budget that background work (heartbeat, cron, agent-to-agent messages)
+  // may use, keeping headroom for interactive turns.
+  double background_share = 0.5;
+  // Requests queued longer than this fail instead of waiting on.
+  std::uint64_t max_wait_secs = 120;
+};
+
+struct BatchConfig {
+  // Sends deferred background requests (heartbeat tasks, cron jobs) through provider batch
+  // APIs, trading hours of worst-case latency for a lower price per token.
+  bool enabled = false;
+  // A batch goes out once it holds max_batch_size requests or its oldest request has
+  // waited max_delay_secs.
+  std::uint32_t max_batch_size = 100;
+  std::uint64_t max_delay_secs = 30;
+  std::uint64_t poll_interval_secs = 30;
+  // Requests still without a result after this fail; their batch is cancelled upstream.
+  std::uint64_t max_wait_secs = 86400;
+};
+
+struct LocalModelConfig {
+  // In-process inference for "gguf:<path>" providers.
+  // Kernel threads per loaded model; 0 uses every hardware thread.
+  std::uint32_t threads = 0;
+  // Tokens of context per KV cache; capped at the model's trained length.
+  std::uint32_t context_length = 2048;
+  std::uint32_t max_tokens = 512;
+  // Recent prompts whose KV cache is kept so follow-up turns skip the shared prefix.
+  std::uint32_t cache_slots = 4;
+};
+
 struct HeartbeatConfig {
   bool enabled = false;
   std::uint64_t interval_minutes = 60;
@@ -162,6 +239,16 @@ struct ToolAllowConfig {
 struct ToolsConfig {
   std::string profile = "full";
   ToolAllowConfig allow;
+  // Tool schemas sent per provider call; 0 sends every tool.
+  std::size_t max_per_turn = 12;
+  // Always offered when registered, whatever the message is about.
+  std::vector<std::string> core = {"shell", "file_read", "file_edit", "memory_recall",
+                                    "tool_output"};
+  // Larger tool outputs are stored on disk and the prompt gets a preview plus a
+  // tool_output handle; 0 keeps every output inline.
+  std::size_t spill_threshold_bytes = 4096;
+  // Reuse results of idempotent tools (file_read, web_search, ...) while still valid.
+  bool result_cache = true;
 };
 
 struct CalendarConfig {
@@ -241,6 +328,8 @@ struct ScheduleEntry {
 struct DaemonConfig {
   bool auto_start_schedules = true;
   std::vector<ScheduleEntry> schedules;
+  bool control_socket_enabled = true;
+  std::string control_socket;
 };
 
 struct McpServerConfig {
@@ -255,6 +344,23 @@ struct McpConfig {
   std::vector<McpServerConfig> servers;
 };
 
+struct RemoteNodeConfig {
+  std::string id;
+  std::string endpoint;
+  std::vector<std::string> capabilities = {"system"};
+  std::string token;
+  bool enabled = true;
+};
+
+struct NodesConfig {
+  bool serve = false;
+  std::string serve_token;
+  std::vector<std::string> offload_tools;
+  std::size_t max_in_flight_per_node = 4;
+  bool local_fallback = true;
+  std::vector<RemoteNodeConfig> remotes;
+};
+
 struct GoogleConfig {
   std::string client_id;
   std::string client_secret;
@@ -278,6 +384,10 @@ struct Config {
   ObservabilityConfig observability;
   RuntimeConfig runtime;
   ReliabilityConfig reliability;
+  RouterConfig router;
+  AdmissionConfig admission;
+  BatchConfig batch;
+  LocalModelConfig local_model;
   HeartbeatConfig heartbeat;
   BrowserConfig browser;
   ToolsConfig tools;
@@ -291,6 +401,7 @@ struct Config {
   MultiConfig multi;
   DaemonConfig daemon;
   McpConfig mcp;
+  NodesConfig nodes;
   GoogleConfig google;
 };
 
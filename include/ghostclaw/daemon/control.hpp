@@ -0,0 +1,116 @@
+#pragma once
+
+#include "ghostclaw/agent/engine.hpp"
+#include "ghostclaw/common/result.hpp"
+#include "ghostclaw/config/schema.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace ghostclaw::daemon {
+
+using ControlMap = std::unordered_map<std::string, std::string>;
+using ControlEmit = std::function<void(const ControlMap &)>;
+using ControlHandler = std::function<common::Result<ControlMap>(
+    const std::string &method, const ControlMap &params, const ControlEmit &emit)>;
+
+// daemon.control_socket, or <config dir>/daemon.sock.
+[[nodiscard]] std::filesystem::path control_socket_path(const config::Config &config);
+
+// Providers an agent.run may name: the default, the reliability fallbacks and, when the
+// router is on, its fast provider. Each one costs a resident engine, so the set is closed.
+[[nodiscard]] std::vector<std::string> configured_providers(const config::Config &config);
+
+// Line-delimited JSON RPC on a Unix domain socket. A request is one flat object with a
+// "method" key; the server answers with zero or more {"type":"event",...} frames and a
+// final {"type":"result",...} or {"type":"error","error":...} frame.
+class ControlServer {
+public:
+  ControlServer(std::filesystem::path socket_path, ControlHandler handler);
+  ~ControlServer();
+
+  [[nodiscard]] common::Status start();
+  void stop();
+  [[nodiscard]] bool is_running() const { return running_; }
+
+private:
+  void accept_loop();
+  void serve_client(int client_fd);
+
+  std::filesystem::path socket_path_;
+  ControlHandler handler_;
+
+  std::atomic<bool> running_{false};
+  int listen_fd_ = -1;
+  std::thread accept_thread_;
+  std::mutex clients_mutex_;
+  std::condition_variable clients_cv_;
+  std::vector<int> client_fds_;
+};
+
+class ControlClient {
+public:
+  explicit ControlClient(std::filesystem::path socket_path);
+
+  // True when a daemon is listening on the socket.
+  [[nodiscard]] bool available() const;
+
+  [[nodiscard]] common::Result<ControlMap>
+  call(const std::string &method, const ControlMap &params, const ControlEmit &on_event = {},
+       std::chrono::milliseconds timeout = std::chrono::minutes(10)) const;
+
+private:
+  std::filesystem::path socket_path_;
+};
+
+// Serves agent, memory, session and cron requests against one long-lived engine.
+// The daemon exposes it over ControlServer; the CLI calls it directly when no daemon
+// is running. The engine is built on first use; an agent.run naming another configured
+// provider gets its own engine, also kept for reuse. Failed builds are not cached.
+class ControlService {
+public:
+  // `provider` is empty for the configured default.
+  using EngineFactory =
+      std::function<common::Result<std::shared_ptr<agent::AgentEngine>>(const std::string &provider)>;
+
+  ControlService(std::filesystem::path workspace, EngineFactory engine_factory,
+                 std::vector<std::string> providers = {});
+
+  [[nodiscard]] common::Result<ControlMap> handle(const std::string &method,
+                                                  const ControlMap &params,
+                                                  const ControlEmit &emit = {});
+  [[nodiscard]] common::Status warm();
+
+private:
+  [[nodiscard]] common::Result<std::shared_ptr<agent::AgentEngine>>
+  engine(const std::string &provider = "");
+  [[nodiscard]] common::Result<ControlMap> agent_run(const ControlMap &params,
+                                                     const ControlEmit &emit);
+  [[nodiscard]] common::Result<ControlMap> memory_recall(const ControlMap &params);
+  [[nodiscard]] common::Result<ControlMap> memory_store(const ControlMap &params);
+  [[nodiscard]] common::Result<ControlMap> sessions_list(const ControlMap &params);
+  [[nodiscard]] common::Result<ControlMap> sessions_history(const ControlMap &params);
+  [[nodiscard]] common::Result<ControlMap> cron_request(const std::string &method,
+                                                        const ControlMap &params);
+
+  std::filesystem::path workspace_;
+  EngineFactory engine_factory_;
+  // Overrides accepted by agent.run; anything else is refused before an engine is built.
+  std::vector<std::string> providers_;
+  std::mutex engine_mutex_;
+  // Serialises agent turns only; memory calls rely on the backend's own locking.
+  std::mutex run_mutex_;
+  // Keyed by provider override; "" is the default engine.
+  std::unordered_map<std::string, std::shared_ptr<agent::AgentEngine>> engines_;
+};
+
+} // namespace ghostclaw::daemon
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "ghostclaw/common/result.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace ghostclaw::gateway {
+
+struct ClusterWorker {
+  std::string worker_id;
+  std::string endpoint;
+  std::int64_t pid = 0;
+  std::int64_t heartbeat_ms = 0;
+};
+
+// Exclusive flock(2) on a file shared by workers. The kernel drops it when the holder
+// exits, so a crashed worker never leaves it stuck. Not supported on Windows, where
+// every lock reports held.
+class ClusterLock {
+public:
+  ClusterLock() = default;
+  ~ClusterLock();
+  ClusterLock(ClusterLock &&other) noexcept;
+  ClusterLock &operator=(ClusterLock &&other) noexcept;
+  ClusterLock(const ClusterLock &) = delete;
+  ClusterLock &operator=(const ClusterLock &) = delete;
+
+  // Blocks until the lock is held.
+  [[nodiscard]] static ClusterLock acquire(const std::filesystem::path &path);
+  // Returns an unheld lock when another process has it.
+  [[nodiscard]] static ClusterLock try_acquire(const std::filesystem::path &path);
+  [[nodiscard]] bool held() const { return held_; }
+
+private:
+  ClusterLock(const std::filesystem::path &path, bool wait);
+  void release();
+
+  int fd_ = -1;
+  bool held_ = false;
+};
+
+// Worker membership shared through lease files in a common directory. Each worker
+// rewrites its own lease on heartbeat; stale leases are ignored and pruned.
+class WorkerRegistry {
+public:
+  WorkerRegistry(std::filesystem::path dir, std::chrono::milliseconds lease_ttl);
+
+  [[nodiscard]] common::Status heartbeat(const ClusterWorker &worker) const;
+  [[nodiscard]] common::Status remove(std::string_view worker_id) const;
+  [[nodiscard]] std::vector<ClusterWorker> live_workers() const;
+
+private:
+  [[nodiscard]] std::filesystem::path lease_path(std::string_view worker_id) const;
+
+  std::filesystem::path dir_;
+  std::chrono::milliseconds lease_ttl_;
+};
+
+// Rendezvous (highest random weight) hashing: a worker joining or leaving only
+// moves the sessions it gains or loses, every other session keeps its owner.
+[[nodiscard]] std::optional<ClusterWorker>
+route_session(std::string_view session_id, const std::vector<ClusterWorker> &workers);
+
+class ClusterCoordinator {
+public:
+  ClusterCoordinator(std::filesystem::path dir, ClusterWorker self,
+                     std::chrono::milliseconds lease_ttl);
+  ~ClusterCoordinator();
+
+  [[nodiscard]] common::Status start();
+  void stop();
+
+  [[nodiscard]] const ClusterWorker &self() const { return self_; }
+  // Secret shared through <dir>/cluster.key, created by the first worker to start.
+  // Forwarded requests carry it so the owner can trust them without a client bearer.
+  [[nodiscard]] const std::string &key() const { return key_; }
+  // Owner of the session, or nullopt when this worker owns it.
+  [[nodiscard]] std::optional<ClusterWorker> remote_owner(std::string_view session_id) const;
+  [[nodiscard]] std::vector<ClusterWorker> members() const;
+  void refresh();
+  // Held while a turn for the session runs, by the owner and by any worker serving the
+  // session because the owner was unreachable, so no two workers run it at once.
+  // Sessions hash onto a fixed set of lock files; two sharing one just queue.
+  [[nodiscard]] ClusterLock lock_session(std::string_view session_id) const;
+
+private:
+  void heartbeat_loop();
+
+  WorkerRegistry registry_;
+  std::filesystem::path dir_;
+  ClusterWorker self_;
+  std::string key_;
+  std::chrono::milliseconds lease_ttl_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<ClusterWorker> members_;
+  std::atomic<bool> running_{false};
+  std::thread heartbeat_thread_;
+};
+
+} // namespace ghostclaw::gateway
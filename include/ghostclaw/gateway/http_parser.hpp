@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace ghostclaw::gateway {
+
+struct HttpParserLimits {
+  // Request line plus headers, and separately any chunked trailers.
+  std::size_t max_head_bytes = 16 * 1024;
+  std::size_t max_headers = 64;
+  std::size_t max_body_bytes = 64 * 1024;
+};
+
+struct HttpHeaderView {
+  std::string_view name;
+  std::string_view value;
+};
+
+// Points into the parser's buffer: valid until the next consume().
+struct HttpRequestView {
+  std::string_view method;
+  std::string_view target;
+  // 0 for HTTP/1.0, 1 for HTTP/1.1.
+  int version_minor = 1;
+  std::vector<HttpHeaderView> headers;
+  // Chunked bodies are decoded in place, so this is always the plain body.
+  std::string_view body;
+  bool keep_alive = true;
+
+  // Case-insensitive; the first header of that name.
+  [[nodiscard]] std::optional<std::string_view> header(std::string_view name) const;
+};
+
+enum class HttpParseStatus { NeedMore, Complete, Error };
+
+// Resumable HTTP/1.1 request parser over one fixed buffer, sized from the limits when the
+// parser is built. The socket reads straight into buffer(); commit() parses only the new
+// bytes, so a request that arrives in many small reads is never rescanned. Supports
+// Content-Length and chunked bodies, and pipelined requests: consume() drops the finished
+// request and starts on whatever followed it.
+class HttpRequestParser {
+public:
+  explicit HttpRequestParser(HttpParserLimits limits = {});
+
+  // Free space for the next read.
+  [[nodiscard]] std::span<char> buffer();
+  // Parses `bytes` just written to the front of buffer().
+  HttpParseStatus commit(std::size_t bytes);
+  // Copies as much of `bytes` as fits into buffer() and commits it. Returns how many
+  // bytes were taken; the rest must be fed again after consume().
+  std::size_t feed(std::string_view bytes);
+  // Drops the completed request and parses any pipelined bytes after it.
+  HttpParseStatus consume();
+
+  [[nodiscard]] HttpParseStatus status() const;
+  [[nodiscard]] const HttpRequestView &request() const { return request_; }
+  // Bytes received past the end of the completed request.
+  [[nodiscard]] bool has_pipelined() const;
+  // The HTTP status to answer a rejected request with: 400, 413, 431, 501 or 505.
+  [[nodiscard]] int error_status() const { return error_status_; }
+  [[nodiscard]] std::string_view error() const { return error_; }
+
+private:
+  enum class State { RequestLine, Headers, Body, ChunkSize, ChunkData, ChunkEnd, Trailers, Done, Failed };
+
+  HttpParseStatus parse();
+  HttpParseStatus fail(int status, std::string_view message);
+  // The next complete line from pos_, without its line ending.
+  [[nodiscard]] std::optional<std::string_view> next_line();
+  [[nodiscard]] bool parse_request_line(std::string_view line);
+  [[nodiscard]] bool parse_header(std::string_view line);
+  [[nodiscard]] HttpParseStatus start_body();
+  void finish();
+  void compact_chunked();
+
+  HttpParserLimits limits_;
+  std::unique_ptr<char[]> data_;
+  std::size_t capacity_ = 0;
+  std::size_t size_ = 0;
+  // Start of the next unparsed byte, and where the search for its line end resumes.
+  std::size_t pos_ = 0;
+  std::size_t scan_ = 0;
+  std::size_t section_start_ = 0;
+  std::size_t body_start_ = 0;
+  // Decoded chunked bytes end here; raw chunk framing after it is reclaimed.
+  std::size_t body_end_ = 0;
+  std::size_t remaining_ = 0;
+  std::optional<std::size_t> content_length_;
+  bool chunked_ = false;
+  State state_ = State::RequestLine;
+  HttpRequestView request_;
+  int error_status_ = 0;
+  std::string_view error_;
+};
+
+} // namespace ghostclaw::gateway
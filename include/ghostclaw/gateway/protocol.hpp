@@ -4,8 +4,10 @@
 #include "ghostclaw/common/result.hpp"
 #include "ghostclaw/config/schema.hpp"
 #include "ghostclaw/memory/memory.hpp"
+#include "ghostclaw/sessions/history.hpp"
 #include "ghostclaw/sessions/store.hpp"
 
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
@@ -43,16 +45,25 @@ struct WsServerMessage {
   std::string session;
   RpcMap payload;
   std::optional<std::string> error;
+  // Position in the session's event stream; 0 for messages that are not session events.
+  std::uint64_t seq = 0;
 
   [[nodiscard]] std::string to_json() const;
 };
 
 [[nodiscard]] common::Result<WsClientMessage> parse_ws_client_message(const std::string &json);
 
+// Adds a finished turn's tokens, tool time and latency to the session's usage totals.
+void record_turn_usage(sessions::SessionStore *store, const std::string &session_id,
+                       const agent::AgentResponse &response);
+// Writes the per-turn usage fields into an agent.run result.
+void add_turn_usage_fields(RpcMap &map, const agent::AgentResponse &response);
+
 class RpcHandler {
 public:
   RpcHandler(std::shared_ptr<agent::AgentEngine> agent, memory::IMemory *memory,
-             sessions::SessionStore *session_store, const config::Config &config);
+             sessions::SessionStore *session_store, const config::Config &config,
+             sessions::SessionHistory *history = nullptr);
 
   [[nodiscard]] RpcResponse handle(const RpcRequest &request);
 
@@ -64,12 +75,19 @@ private:
   [[nodiscard]] RpcResponse handle_session_override_set(const RpcRequest &request);
   [[nodiscard]] RpcResponse handle_session_override_get(const RpcRequest &request) const;
   [[nodiscard]] RpcResponse handle_session_group_list(const RpcRequest &request) const;
+  [[nodiscard]] RpcResponse handle_session_usage(const RpcRequest &request) const;
+  [[nodiscard]] RpcResponse handle_router_stats(const RpcRequest &request) const;
+  [[nodiscard]] RpcResponse handle_admission_stats(const RpcRequest &request) const;
+  [[nodiscard]] RpcResponse handle_batch_stats(const RpcRequest &request) const;
   [[nodiscard]] RpcResponse handle_health(const RpcRequest &request) const;
+  [[nodiscard]] RpcResponse handle_approval_list(const RpcRequest &request) const;
+  [[nodiscard]] RpcResponse handle_approval_resolve(const RpcRequest &request);
 
   std::shared_ptr<agent::AgentEngine> agent_;
   memory::IMemory *memory_;
   sessions::SessionStore *session_store_;
   const config::Config &config_;
+  sessions::SessionHistory *history_;
 };
 
 } // namespace ghostclaw::gateway
@@ -1,17 +1,23 @@
 #pragma once
 
 #include "ghostclaw/agent/engine.hpp"
+#include "ghostclaw/agent/message_queue.hpp"
 #include "ghostclaw/common/result.hpp"
 #include "ghostclaw/config/schema.hpp"
+#include "ghostclaw/gateway/cluster.hpp"
 #include "ghostclaw/gateway/protocol.hpp"
 #include "ghostclaw/gateway/websocket.hpp"
 #include "ghostclaw/memory/memory.hpp"
+#include "ghostclaw/nodes/node.hpp"
+#include "ghostclaw/sessions/archiver.hpp"
+#include "ghostclaw/sessions/history.hpp"
 #include "ghostclaw/sessions/send_policy.hpp"
 #include "ghostclaw/sessions/store.hpp"
 #include "ghostclaw/security/pairing.hpp"
 #include "ghostclaw/tunnel/tunnel.hpp"
 
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
 #include <memory>
 #include <mutex>
@@ -19,6 +25,7 @@
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace ghostclaw::gateway {
@@ -59,6 +66,7 @@ public:
   [[nodiscard]] bool is_running() const;
   [[nodiscard]] std::optional<std::string> public_url() const;
   [[nodiscard]] std::uint16_t websocket_port() const;
+  [[nodiscard]] const ClusterCoordinator *cluster() const { return cluster_.get(); }
 
   [[nodiscard]] HttpResponse dispatch_for_test(const HttpRequest &request);
 
@@ -67,6 +75,17 @@ private:
   [[nodiscard]] HttpResponse handle_health(const HttpRequest &request) const;
   [[nodiscard]] HttpResponse handle_pair(const HttpRequest &request);
   [[nodiscard]] HttpResponse handle_webhook(const HttpRequest &request);
+  [[nodiscard]] std::optional<HttpResponse> forward_to_owner(const HttpRequest &request,
+                                                             const std::string &session_id);
+  // Runs a websocket agent.run on the session's owner through its /webhook; nullopt when
+  // this worker owns the session or the owner is unreachable.
+  [[nodiscard]] std::optional<common::Result<RpcMap>>
+  forward_run_to_owner(const std::string &session_id, const RpcMap &payload);
+  [[nodiscard]] std::optional<HttpResponse> post_to_owner(const std::string &session_id,
+                                                          const std::string &body,
+                                                          const std::string &authorization);
+  // A request another worker forwarded, vouched for by the shared cluster key.
+  [[nodiscard]] bool is_cluster_request(const HttpRequest &request) const;
   [[nodiscard]] HttpResponse handle_whatsapp_verify(const HttpRequest &request) const;
   [[nodiscard]] HttpResponse handle_whatsapp_message(const HttpRequest &request);
 
@@ -86,15 +105,25 @@ private:
   std::unique_ptr<WebSocketServer> websocket_server_;
   std::uint16_t websocket_port_ = 0;
   std::unique_ptr<sessions::SessionStore> session_store_;
+  std::unique_ptr<sessions::SessionHistory> session_history_;
+  std::unique_ptr<sessions::SessionArchiver> session_archiver_;
   std::unique_ptr<sessions::SessionSendPolicy> send_policy_;
+  std::shared_ptr<nodes::NodeActionExecutor> node_executor_;
+  std::string node_workspace_;
+  std::unique_ptr<ClusterCoordinator> cluster_;
 
   std::atomic<bool> running_{false};
   int listen_fd_ = -1;
   std::thread accept_thread_;
+  // Connections being served, each on its own thread; stop() waits for them.
+  std::mutex clients_mutex_;
+  std::condition_variable clients_cv_;
+  std::unordered_set<int> client_fds_;
   std::uint16_t bound_port_ = 0;
 
   std::mutex session_lanes_mutex_;
   std::unordered_map<std::string, std::weak_ptr<std::mutex>> session_lanes_;
+  agent::ActiveTurns active_turns_;
 };
 
 } // namespace ghostclaw::gateway
@@ -7,6 +7,7 @@
 
 #include <atomic>
 #include <cstdint>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -15,6 +16,7 @@
 #include <thread>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 namespace ghostclaw::gateway {
@@ -27,6 +29,10 @@ struct WebSocketOptions {
   std::string tls_cert_file;
   std::string tls_key_file;
   bool require_authorization = false;
+  // Each session's recent events are kept so a client that reconnects can resubscribe
+  // with `since` and receive what it missed; 0 disables replay.
+  std::size_t replay_events_per_session = 512;
+  std::size_t replay_max_sessions = 1024;
   std::function<bool(const std::string &)> authorize;
   std::function<common::Result<RpcMap>(const WsClientMessage &,
                                        const std::function<void(const RpcMap &)> &)> rpc_handler;
@@ -35,6 +41,8 @@ struct WebSocketOptions {
 struct WebSocketStats {
   std::size_t connected_clients = 0;
   std::size_t total_subscriptions = 0;
+  std::size_t replay_sessions = 0;
+  std::size_t replay_events = 0;
 };
 
 class WebSocketServer {
@@ -49,8 +57,12 @@ public:
   [[nodiscard]] std::uint16_t port() const;
   [[nodiscard]] WebSocketStats stats() const;
 
+  // Stamps the event with the session's next sequence number, keeps it for replay, and
+  // sends it to current subscribers. Returns how many received it.
   [[nodiscard]] std::size_t publish_session_event(const std::string &session,
                                                   const RpcMap &payload);
+  // Sequence number of the session's latest event; 0 before its first.
+  [[nodiscard]] std::uint64_t last_session_seq(const std::string &session) const;
 
 private:
   struct ClientState {
@@ -58,6 +70,19 @@ private:
     SSL *ssl = nullptr;
     std::unordered_set<std::string> sessions;
     std::mutex write_mutex;
+    // permessage-deflate, negotiated without context takeover in either direction.
+    bool deflate = false;
+    int deflate_window_bits = 15;
+  };
+
+  // One session's event stream. `mutex` is held from stamping an event until it has been
+  // sent, and while a resubscribing client is replayed, so each subscriber sees the
+  // session's events once and in order.
+  struct SessionStream {
+    std::mutex mutex;
+    std::uint64_t last_seq = 0;
+    std::deque<std::pair<std::uint64_t, std::string>> events;
+    std::uint64_t last_used = 0;
   };
 
   [[nodiscard]] common::Status validate_bind_address(const std::string &host) const;
@@ -66,12 +91,18 @@ private:
   [[nodiscard]] bool perform_handshake(const std::shared_ptr<ClientState> &client) const;
   void remove_client(int fd);
 
+  // `deflated` lets one publish compress its payload once for every recipient that uses
+  // the default window.
   [[nodiscard]] bool send_text_frame(const std::shared_ptr<ClientState> &client,
-                                     const std::string &payload) const;
+                                     const std::string &payload,
+                                     std::optional<std::string> *deflated = nullptr) const;
   [[nodiscard]] bool send_server_message(const std::shared_ptr<ClientState> &client,
                                          const WsServerMessage &message) const;
   void handle_client_message(const std::shared_ptr<ClientState> &client,
                              const WsClientMessage &message);
+  void subscribe_client(const std::shared_ptr<ClientState> &client,
+                        const WsClientMessage &message);
+  [[nodiscard]] std::shared_ptr<SessionStream> stream_for(const std::string &session);
 
   WebSocketOptions options_;
   std::atomic<bool> running_{false};
@@ -82,6 +113,10 @@ private:
 
   mutable std::mutex clients_mutex_;
   std::unordered_map<int, std::shared_ptr<ClientState>> clients_;
+
+  mutable std::mutex streams_mutex_;
+  std::unordered_map<std::string, std::shared_ptr<SessionStream>> streams_;
+  std::uint64_t stream_clock_ = 0;
 };
 
 } // namespace ghostclaw::gateway
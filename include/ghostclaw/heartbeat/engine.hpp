@@ -1,11 +1,14 @@
 #pragma once
 
 #include "ghostclaw/agent/engine.hpp"
+#include "ghostclaw/common/cancel.hpp"
 #include "ghostclaw/common/result.hpp"
+#include "ghostclaw/heartbeat/job_pool.hpp"
 
 #include <atomic>
 #include <chrono>
 #include <filesystem>
+#include <memory>
 #include <thread>
 #include <vector>
 
@@ -40,7 +43,11 @@ private:
   agent::AgentEngine &agent_;
   HeartbeatConfig config_;
   std::thread thread_;
+  // Runs tasks off the tick thread; see JobPool.
+  std::unique_ptr<JobPool> tasks_;
   std::atomic<bool> running_{false};
+  // Fired by stop() so tasks blocked on a provider (or a batch) return promptly.
+  std::shared_ptr<common::CancelToken> cancel_;
 };
 
 } // namespace ghostclaw::heartbeat
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace ghostclaw::heartbeat {
+
+// Threads for background work when batching is on: enough jobs run side by side for
+// their provider calls to share a batch, without a thread per job.
+inline constexpr std::size_t kBatchedJobThreads = 8;
+
+// Fixed set of threads for cron jobs and heartbeat tasks, so the poll loop hands work
+// off and keeps polling instead of waiting for it. A key already queued or running is
+// not queued again: a job that outlasts the poll interval is not started twice.
+class JobPool {
+public:
+  explicit JobPool(std::size_t threads);
+  ~JobPool();
+
+  JobPool(const JobPool &) = delete;
+  JobPool &operator=(const JobPool &) = delete;
+
+  // False when `key` is still queued or running, or the pool has stopped.
+  bool post(const std::string &key, std::function<void()> job);
+  // Drops queued jobs and waits only for the ones already running.
+  void stop();
+  // Queued plus running jobs.
+  [[nodiscard]] std::size_t busy() const;
+
+private:
+  void worker_loop();
+
+  std::vector<std::thread> workers_;
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::pair<std::string, std::function<void()>>> queue_;
+  std::unordered_set<std::string> busy_keys_;
+  bool stopping_ = false;
+};
+
+} // namespace ghostclaw::heartbeat
@@ -1,11 +1,14 @@
 #pragma once
 
 #include "ghostclaw/agent/engine.hpp"
+#include "ghostclaw/common/cancel.hpp"
 #include "ghostclaw/config/schema.hpp"
 #include "ghostclaw/heartbeat/cron_store.hpp"
+#include "ghostclaw/heartbeat/job_pool.hpp"
 
 #include <atomic>
 #include <chrono>
+#include <memory>
 #include <optional>
 #include <thread>
 
@@ -45,7 +48,11 @@ private:
   SchedulerConfig config_;
   const config::Config *runtime_config_ = nullptr;
   std::thread thread_;
+  // Runs due jobs off the poll thread; see JobPool.
+  std::unique_ptr<JobPool> jobs_;
   std::atomic<bool> running_{false};
+  // Fired by stop() so jobs blocked on a provider (or a batch) return promptly.
+  std::shared_ptr<common::CancelToken> cancel_;
 };
 
 } // namespace ghostclaw::heartbeat
@@ -1,9 +1,11 @@
 #pragma once
 
+#include "ghostclaw/common/cancel.hpp"
 #include "ghostclaw/common/result.hpp"
 #include "ghostclaw/config/schema.hpp"
 
 #include <atomic>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <vector>
@@ -30,24 +32,48 @@ public:
   void stop();
   [[nodiscard]] bool is_running() const;
 
+  // Requests start the server on first use and restart it when the process has died
+  // since the last request. health_check() does the same for a server that was started
+  // before, without sending anything; a never-started server is left alone.
+  [[nodiscard]] bool health_check();
+  [[nodiscard]] std::size_t restart_count() const { return restarts_.load(); }
+
   [[nodiscard]] common::Result<std::vector<McpToolInfo>> list_tools();
-  [[nodiscard]] common::Result<std::string> call_tool(const std::string &tool_name,
-                                                       const std::string &arguments_json);
+  // A cancelled call sends notifications/cancelled for the request and returns at once;
+  // a late reply from the server is skipped by the next read.
+  [[nodiscard]] common::Result<std::string>
+  call_tool(const std::string &tool_name, const std::string &arguments_json,
+            const std::shared_ptr<common::CancelToken> &cancel_token = nullptr);
 
   [[nodiscard]] const std::string &server_id() const { return config_.id; }
 
 private:
-  [[nodiscard]] common::Result<std::string> send_request(const std::string &method,
-                                                          const std::string &params_json);
-  [[nodiscard]] common::Result<std::string> read_response(int expected_id);
+  [[nodiscard]] common::Status start_locked();
+  void stop_locked();
+  [[nodiscard]] common::Status ensure_running_locked();
+  [[nodiscard]] bool exited_locked();
+
+  [[nodiscard]] common::Result<std::string>
+  send_request(const std::string &method, const std::string &params_json,
+               const std::shared_ptr<common::CancelToken> &cancel_token = nullptr);
+  [[nodiscard]] common::Result<std::string>
+  read_response(int expected_id,
+                const std::shared_ptr<common::CancelToken> &cancel_token = nullptr);
 
   config::McpServerConfig config_;
   pid_t pid_ = -1;
   int stdin_fd_ = -1;
   int stdout_fd_ = -1;
   std::atomic<int> next_id_{1};
-  std::mutex io_mutex_;
+  // Serialises requests and process start/stop.
+  mutable std::mutex io_mutex_;
   std::string read_buffer_;
+  bool started_once_ = false;
+  // Set when a pipe write or read fails; the next request restarts the server.
+  bool broken_ = false;
+  // Whether the last request was fully written before it failed.
+  bool written_ = false;
+  std::atomic<std::size_t> restarts_{0};
 };
 
 } // namespace ghostclaw::mcp
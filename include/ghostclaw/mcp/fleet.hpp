@@ -0,0 +1,60 @@
+#pragma once
+
+#include "ghostclaw/config/schema.hpp"
+#include "ghostclaw/mcp/client.hpp"
+#include "ghostclaw/tools/tool.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ghostclaw::mcp {
+
+// One client per distinct server configuration, shared by every tool registry in the
+// process. The fleet only holds weak references: a server process lives as long as some
+// McpTool uses it. Tool lists are cached in memory and, when a cache directory is given,
+// on disk, so a cached server is not started until one of its tools is called.
+class McpFleet {
+public:
+  McpFleet() = default;
+
+  McpFleet(const McpFleet &) = delete;
+  McpFleet &operator=(const McpFleet &) = delete;
+
+  [[nodiscard]] static McpFleet &shared();
+
+  [[nodiscard]] std::shared_ptr<McpClient> acquire(const config::McpServerConfig &server);
+
+  // Servers without a cached tool list are started and listed concurrently.
+  [[nodiscard]] std::vector<std::unique_ptr<tools::ITool>>
+  collect_tools(const std::vector<config::McpServerConfig> &servers,
+                const std::filesystem::path &cache_dir = {});
+
+  // Restarts servers that were started and have since exited. Returns how many
+  // started servers are running afterwards.
+  std::size_t check_health();
+  [[nodiscard]] std::size_t running_count() const;
+
+  void set_cache_ttl(std::chrono::seconds ttl) { cache_ttl_ = ttl; }
+
+private:
+  struct Slot {
+    std::weak_ptr<McpClient> client;
+    std::optional<std::vector<McpToolInfo>> tools;
+  };
+
+  [[nodiscard]] std::vector<std::shared_ptr<McpClient>> live_clients() const;
+  [[nodiscard]] std::optional<std::vector<McpToolInfo>>
+  load_cached_tools(const std::filesystem::path &path) const;
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, Slot> servers_;
+  std::chrono::seconds cache_ttl_ = std::chrono::hours(24);
+};
+
+} // namespace ghostclaw::mcp
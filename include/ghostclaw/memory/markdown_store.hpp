@@ -2,6 +2,8 @@
 
 #include "ghostclaw/memory/memory.hpp"
 
+#include <mutex>
+
 namespace ghostclaw::memory {
 
 class MarkdownMemory final : public IMemory {
@@ -29,6 +31,8 @@ private:
   [[nodiscard]] common::Result<std::vector<MemoryEntry>> load_all() const;
 
   std::filesystem::path workspace_;
+  // Serializes file access; the auto-save writer stores from a background thread.
+  std::mutex mutex_;
 };
 
 } // namespace ghostclaw::memory
@@ -3,6 +3,7 @@
 #include "ghostclaw/common/result.hpp"
 #include "ghostclaw/config/schema.hpp"
 
+#include <cstdint>
 #include <filesystem>
 #include <memory>
 #include <optional>
@@ -48,6 +49,17 @@ public:
   [[nodiscard]] virtual std::string_view name() const = 0;
   [[nodiscard]] virtual common::Status store(const std::string &key, const std::string &content,
                                              MemoryCategory category) = 0;
+  // Stores key, content and category of each entry. Backends that can embed or commit
+  // several entries at once override this.
+  [[nodiscard]] virtual common::Status store_batch(const std::vector<MemoryEntry> &entries) {
+    for (const auto &entry : entries) {
+      auto status = store(entry.key, entry.content, entry.category);
+      if (!status.ok()) {
+        return status;
+      }
+    }
+    return common::Status::success();
+  }
   [[nodiscard]] virtual common::Result<std::vector<MemoryEntry>>
   recall(const std::string &query, std::size_t limit) = 0;
   [[nodiscard]] virtual common::Result<std::optional<MemoryEntry>> get(const std::string &key) = 0;
@@ -58,12 +70,24 @@ public:
   [[nodiscard]] virtual common::Status reindex() = 0;
   [[nodiscard]] virtual bool health_check() = 0;
   [[nodiscard]] virtual MemoryStats stats() = 0;
+  // Blocks until writes accepted earlier are durable.
+  [[nodiscard]] virtual common::Status flush() { return common::Status::success(); }
+  // Changes whenever a write may have changed what recall/get/list return, so callers can
+  // reuse earlier results while it stays the same. nullopt when the backend cannot tell
+  // (e.g. its files are edited outside the process).
+  [[nodiscard]] virtual std::optional<std::uint64_t> write_epoch() const { return std::nullopt; }
 };
 
 [[nodiscard]] std::unique_ptr<IMemory> create_memory(const config::Config &config,
                                                      const std::filesystem::path &workspace);
 
 [[nodiscard]] std::string now_rfc3339();
+// "<prefix>_<unix seconds>_<suffix>", where the suffix keeps keys minted in the same
+// second (by this process or another) from overwriting each other.
+[[nodiscard]] std::string unique_memory_key(std::string_view prefix);
+// Process-wide increasing counter for write_epoch(), so epochs of different backends
+// never coincide.
+[[nodiscard]] std::uint64_t next_write_epoch();
 [[nodiscard]] double recency_score(const std::string &updated_at, double half_life_days);
 
 } // namespace ghostclaw::memory
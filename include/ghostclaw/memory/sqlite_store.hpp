@@ -6,6 +6,7 @@
 #include "ghostclaw/memory/memory.hpp"
 #include "ghostclaw/memory/vector_index.hpp"
 
+#include <atomic>
 #include <mutex>
 #include <sqlite3.h>
 
@@ -20,6 +21,8 @@ public:
   [[nodiscard]] std::string_view name() const override;
   [[nodiscard]] common::Status store(const std::string &key, const std::string &content,
                                      MemoryCategory category) override;
+  // Embeds the batch with one embed_batch() call and writes it in one transaction.
+  [[nodiscard]] common::Status store_batch(const std::vector<MemoryEntry> &entries) override;
   [[nodiscard]] common::Result<std::vector<MemoryEntry>>
   recall(const std::string &query, std::size_t limit) override;
   [[nodiscard]] common::Result<std::optional<MemoryEntry>> get(const std::string &key) override;
@@ -30,9 +33,15 @@ public:
   [[nodiscard]] common::Status reindex() override;
   [[nodiscard]] bool health_check() override;
   [[nodiscard]] MemoryStats stats() override;
+  [[nodiscard]] std::optional<std::uint64_t> write_epoch() const override;
 
 private:
   [[nodiscard]] common::Status init_schema();
+  [[nodiscard]] common::Status write_entry(const std::string &key, const std::string &content,
+                                           MemoryCategory category,
+                                           const std::optional<std::vector<float>> &embedding);
+  [[nodiscard]] common::Status
+  update_vector_index(const std::string &key, const std::optional<std::vector<float>> &embedding);
   [[nodiscard]] common::Result<std::vector<float>> embedding_for_text(const std::string &text);
   [[nodiscard]] common::Status cache_embedding(const std::string &text,
                                                const std::vector<float> &embedding);
@@ -49,6 +58,7 @@ private:
   VectorIndex vector_index_;
   config::MemoryConfig config_;
   MemoryStats stats_;
+  std::atomic<std::uint64_t> write_epoch_{next_write_epoch()};
 };
 
 } // namespace ghostclaw::memory
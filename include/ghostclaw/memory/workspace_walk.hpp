@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace ghostclaw::memory {
+
+struct WorkspaceFile {
+  std::filesystem::path path;
+  // Relative to the workspace root, with '/' separators.
+  std::string relative;
+  std::uintmax_t size = 0;
+  std::filesystem::file_time_type mtime{};
+};
+
+// Visits every regular file under `root` that git would track: .git and .ghostclaw are
+// skipped, every .gitignore on the way down is honoured (including negations), ignored
+// directories are not descended into, and symlinks are never followed.
+void walk_workspace(const std::filesystem::path &root,
+                    const std::function<void(const WorkspaceFile &)> &visit);
+
+// True when `path` (relative, '/'-separated) matches the gitignore glob `pattern`, where
+// `*` and `?` stay within one segment and `**` spans segments.
+[[nodiscard]] bool gitignore_glob_match(std::string_view pattern, std::string_view path);
+
+} // namespace ghostclaw::memory
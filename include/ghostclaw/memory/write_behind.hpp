@@ -0,0 +1,85 @@
+#pragma once
+
+#include "ghostclaw/memory/memory.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace ghostclaw::memory {
+
+struct WriteBehindOptions {
+  // How long the writer waits for more entries before storing a partial batch.
+  std::chrono::milliseconds linger{250};
+  std::size_t max_batch = 16;
+  // Wait before retrying a batch the backend rejected; grows with each attempt.
+  std::chrono::milliseconds retry_backoff{500};
+};
+
+// Wraps a backend so entries passed to enqueue() are stored in batches on a background
+// thread instead of on the caller's. Every other call, store() included, goes straight
+// to the backend; store() and forget() first drop queued writes of the same key, or wait
+// for one the writer thread already holds to land. Queued entries stay visible to
+// get/list/recall until written; recall matches them on keywords only since they have no
+// embedding yet. A batch the backend rejects is retried a few times, then dropped and
+// logged; flush() reports the error. count() and stats() add queued keys the backend
+// does not hold yet, so they can be briefly off while a batch lands. Destruction flushes.
+// The backend is called from the writer thread concurrently with the caller's thread.
+class WriteBehindMemory final : public IMemory {
+public:
+  explicit WriteBehindMemory(std::unique_ptr<IMemory> inner, WriteBehindOptions options = {});
+  ~WriteBehindMemory() override;
+
+  WriteBehindMemory(const WriteBehindMemory &) = delete;
+  WriteBehindMemory &operator=(const WriteBehindMemory &) = delete;
+
+  void enqueue(std::string key, std::string content, MemoryCategory category);
+  [[nodiscard]] std::size_t pending() const;
+
+  [[nodiscard]] std::string_view name() const override;
+  [[nodiscard]] common::Status store(const std::string &key, const std::string &content,
+                                     MemoryCategory category) override;
+  [[nodiscard]] common::Status store_batch(const std::vector<MemoryEntry> &entries) override;
+  [[nodiscard]] common::Result<std::vector<MemoryEntry>>
+  recall(const std::string &query, std::size_t limit) override;
+  [[nodiscard]] common::Result<std::optional<MemoryEntry>> get(const std::string &key) override;
+  [[nodiscard]] common::Result<std::vector<MemoryEntry>>
+  list(std::optional<MemoryCategory> category) override;
+  [[nodiscard]] common::Result<bool> forget(const std::string &key) override;
+  [[nodiscard]] common::Result<std::size_t> count() override;
+  [[nodiscard]] common::Status reindex() override;
+  [[nodiscard]] bool health_check() override;
+  [[nodiscard]] MemoryStats stats() override;
+  [[nodiscard]] common::Status flush() override;
+  // The newer of the queue's epoch and the backend's; nullopt if the backend has none.
+  [[nodiscard]] std::optional<std::uint64_t> write_epoch() const override;
+
+private:
+  void writer_loop();
+  void drop_queued_locked(const std::string &key);
+  // Blocks until no batch being written by the writer thread holds `key`.
+  void wait_for_in_flight_locked(std::unique_lock<std::mutex> &lock, const std::string &key);
+  [[nodiscard]] std::vector<MemoryEntry> pending_entries() const;
+  // Distinct queued keys not yet in the backend.
+  [[nodiscard]] std::size_t unstored_pending();
+
+  std::unique_ptr<IMemory> inner_;
+  WriteBehindOptions options_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable drained_cv_;
+  std::deque<MemoryEntry> queue_;
+  std::vector<MemoryEntry> in_flight_;
+  bool flush_requested_ = false;
+  bool stopping_ = false;
+  std::string last_error_;
+  // Bumped when the queue gains or loses entries visible to recall.
+  std::atomic<std::uint64_t> queue_epoch_{next_write_epoch()};
+  std::thread writer_;
+};
+
+} // namespace ghostclaw::memory
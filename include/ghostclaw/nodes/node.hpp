@@ -4,6 +4,7 @@
 #include "ghostclaw/security/policy.hpp"
 #include "ghostclaw/tools/tool.hpp"
 
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -39,6 +40,8 @@ struct NodeActionResult {
   std::unordered_map<std::string, std::string> metadata;
 };
 
+using NodeOutputCallback = std::function<void(std::string_view chunk)>;
+
 class NodeRegistry {
 public:
   NodeRegistry() = default;
@@ -68,6 +71,11 @@ public:
   [[nodiscard]] common::Result<NodeActionResult> invoke(std::string_view action,
                                                         const tools::ToolArgs &args,
                                                         const tools::ToolContext &ctx) const;
+  // Same as invoke(), but forwards system.run output chunks as they are read.
+  [[nodiscard]] common::Result<NodeActionResult> invoke(std::string_view action,
+                                                        const tools::ToolArgs &args,
+                                                        const tools::ToolContext &ctx,
+                                                        const NodeOutputCallback &on_output) const;
 
 private:
   std::shared_ptr<security::SecurityPolicy> policy_;
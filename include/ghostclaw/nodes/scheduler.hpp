@@ -0,0 +1,124 @@
+#pragma once
+
+#include "ghostclaw/common/result.hpp"
+#include "ghostclaw/nodes/node.hpp"
+#include "ghostclaw/tools/tool.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ghostclaw::nodes {
+
+using NodeRpcMap = std::unordered_map<std::string, std::string>;
+
+class INodeTransport {
+public:
+  virtual ~INodeTransport() = default;
+  // Gives up early, closing the connection, once `cancel_token` fires. The node does not
+  // stop an action it has accepted; it runs to completion and its result is discarded.
+  [[nodiscard]] virtual common::Result<NodeActionResult>
+  invoke(const NodeDescriptor &node, std::string_view action, const tools::ToolArgs &args,
+         const NodeOutputCallback &on_output, std::chrono::milliseconds timeout,
+         const std::shared_ptr<common::CancelToken> &cancel_token) = 0;
+};
+
+// Runs node.invoke over the gateway websocket RPC envelope: one connection per call,
+// output chunks arrive as rpc.event frames, the final NodeActionResult as rpc.result.
+class WebSocketNodeTransport final : public INodeTransport {
+public:
+  [[nodiscard]] common::Result<NodeActionResult>
+  invoke(const NodeDescriptor &node, std::string_view action, const tools::ToolArgs &args,
+         const NodeOutputCallback &on_output, std::chrono::milliseconds timeout,
+         const std::shared_ptr<common::CancelToken> &cancel_token) override;
+};
+
+struct NodeLoadStats {
+  std::string node_id;
+  std::size_t in_flight = 0;
+  std::size_t completed = 0;
+  std::size_t failed = 0;
+  double latency_ewma_ms = 0.0;
+};
+
+struct NodeSchedulerOptions {
+  std::size_t max_in_flight_per_node = 4;
+  double initial_latency_ms = 50.0;
+  double load_penalty_ms = 250.0;
+  double failure_penalty_ms = 1000.0;
+  double latency_smoothing = 0.3;
+  bool local_fallback = true;
+  std::chrono::milliseconds timeout{120'000};
+};
+
+struct NodeDispatchResult {
+  NodeActionResult result;
+  std::string node_id;
+  bool remote = false;
+  std::size_t attempts = 0;
+};
+
+class NodeScheduler {
+public:
+  NodeScheduler(std::shared_ptr<NodeRegistry> registry,
+                std::shared_ptr<INodeTransport> transport = nullptr,
+                std::shared_ptr<NodeActionExecutor> local = nullptr,
+                NodeSchedulerOptions options = {});
+
+  // Routes calls of tool_name to the given node action (e.g. "shell" -> "system.run").
+  void set_tool_action(const std::string &tool_name, const std::string &action);
+  [[nodiscard]] std::optional<std::string> action_for_tool(std::string_view tool_name) const;
+
+  // Paired, connected nodes advertising the action, best candidate first.
+  [[nodiscard]] std::vector<NodeDescriptor> rank_candidates(std::string_view action) const;
+
+  [[nodiscard]] common::Result<NodeDispatchResult>
+  dispatch(std::string_view action, const tools::ToolArgs &args, const tools::ToolContext &ctx,
+           const NodeOutputCallback &on_output = {});
+
+  [[nodiscard]] std::vector<NodeLoadStats> stats() const;
+  [[nodiscard]] bool local_fallback_enabled() const { return options_.local_fallback; }
+
+private:
+  [[nodiscard]] double score_locked(const std::string &node_id) const;
+  [[nodiscard]] bool try_reserve(const std::string &node_id);
+  void release(const std::string &node_id, bool ok, double latency_ms);
+
+  std::shared_ptr<NodeRegistry> registry_;
+  std::shared_ptr<INodeTransport> transport_;
+  std::shared_ptr<NodeActionExecutor> local_;
+  NodeSchedulerOptions options_;
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, NodeLoadStats> load_;
+  std::unordered_map<std::string, std::string> tool_actions_;
+};
+
+// Node action that can stand in for a local tool, if any (e.g. "shell" -> "system.run").
+// Only the shell family has a node action so far; browser and file tools always run locally.
+[[nodiscard]] std::optional<std::string> default_offload_action(std::string_view tool_name);
+
+[[nodiscard]] bool node_supports_action(const NodeDescriptor &node, std::string_view action);
+
+[[nodiscard]] std::string encode_node_invoke_request(const std::string &request_id,
+                                                     std::string_view action,
+                                                     const tools::ToolArgs &args,
+                                                     const std::string &token);
+
+// Node-side handler for a node.invoke RPC payload (as parsed by the gateway websocket).
+// Output chunks are emitted as {"event":"node.output","text":...} maps. Refuses every
+// call when `expected_token` is empty, so a node never runs commands for anonymous peers.
+// The action runs to completion: a caller that disconnects or cancels does not stop it.
+[[nodiscard]] common::Result<NodeRpcMap>
+serve_node_invoke(const NodeActionExecutor &executor, const NodeRpcMap &payload,
+                  const tools::ToolContext &ctx, std::string_view expected_token,
+                  const std::function<void(const NodeRpcMap &)> &emit);
+
+} // namespace ghostclaw::nodes
@@ -46,6 +46,9 @@ struct RequestLatencyMetric {
 
 struct TokensUsedMetric {
   std::uint64_t tokens = 0;
+  std::uint64_t prompt_tokens = 0;
+  std::uint64_t completion_tokens = 0;
+  std::uint64_t cached_prompt_tokens = 0;
 };
 
 struct ActiveSessionsMetric {
@@ -56,8 +59,16 @@ struct QueueDepthMetric {
   std::uint64_t depth = 0;
 };
 
-using ObserverMetric =
-    std::variant<RequestLatencyMetric, TokensUsedMetric, ActiveSessionsMetric, QueueDepthMetric>;
+// One lookup in the tool result cache, with the cache's running totals.
+struct ToolCacheMetric {
+  std::string tool;
+  bool hit = false;
+  std::uint64_t hits = 0;
+  std::uint64_t misses = 0;
+};
+
+using ObserverMetric = std::variant<RequestLatencyMetric, TokensUsedMetric, ActiveSessionsMetric,
+                                    QueueDepthMetric, ToolCacheMetric>;
 
 class IObserver {
 public:
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "ghostclaw/common/result.hpp"
+#include "ghostclaw/config/schema.hpp"
+#include "ghostclaw/providers/traits.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ghostclaw::providers {
+
+// Deferred is background work that can also wait minutes or hours for its answer, so it may
+// go through a provider batch API (see BatchLane).
+enum class RequestPriority { Interactive, Background, Deferred };
+
+// Like cancellation and usage, the kind of work a provider request belongs to does not fit
+// the provider interface. The caller installs it for its thread; admission reads it.
+// Without one, requests count as interactive with no session.
+class ScopedRequestClass {
+public:
+  ScopedRequestClass(RequestPriority priority, std::string session);
+  ~ScopedRequestClass();
+
+  ScopedRequestClass(const ScopedRequestClass &) = delete;
+  ScopedRequestClass &operator=(const ScopedRequestClass &) = delete;
+
+private:
+  friend RequestPriority current_request_priority();
+  friend std::string current_request_session();
+
+  RequestPriority priority_;
+  std::string session_;
+  ScopedRequestClass *previous_ = nullptr;
+};
+
+[[nodiscard]] RequestPriority current_request_priority();
+[[nodiscard]] std::string current_request_session();
+
+struct AdmissionStats {
+  std::string key;
+  std::uint64_t admitted_interactive = 0;
+  std::uint64_t admitted_background = 0;
+  std::uint64_t waited_ms_interactive = 0;
+  std::uint64_t waited_ms_background = 0;
+  std::uint64_t rate_limited = 0;
+  std::uint64_t timed_out = 0;
+  std::size_t queued = 0;
+  std::size_t in_flight = 0;
+  // Rolling one-minute window.
+  std::size_t window_requests = 0;
+  std::uint64_t window_tokens = 0;
+};
+
+// Process-wide gate in front of upstream providers. Every request takes a ticket for its
+// provider/key before it is sent. Requests wait while the key is over its per-minute
+// request or token budget, at its concurrency limit, or cooling down after a 429. Waiters
+// are served interactive first, then the session with the fewest recent requests, then in
+// arrival order. Background work only gets a configured share of each budget, so it backs
+// off before interactive turns would hit the limit.
+class AdmissionController {
+  struct Bucket;
+
+public:
+  using Clock = std::chrono::steady_clock;
+
+  class Ticket {
+  public:
+    Ticket() = default;
+    ~Ticket();
+    Ticket(Ticket &&other) noexcept;
+    Ticket &operator=(Ticket &&other) noexcept;
+    Ticket(const Ticket &) = delete;
+    Ticket &operator=(const Ticket &) = delete;
+
+    // Replaces the token estimate with what the provider reported; empty usage keeps it.
+    void complete(const TokenUsage &usage);
+    // Pauses the key for retry_after seconds, or an exponential backoff without one.
+    void rate_limited(std::optional<std::uint64_t> retry_after_secs);
+
+  private:
+    friend class AdmissionController;
+
+    void release();
+
+    AdmissionController *owner_ = nullptr;
+    std::shared_ptr<Bucket> bucket_;
+    std::uint64_t entry_ = 0;
+    std::string session_;
+  };
+
+  [[nodiscard]] static AdmissionController &shared();
+
+  void configure(const config::AdmissionConfig &config);
+  [[nodiscard]] config::AdmissionConfig config() const;
+
+  // Blocks until the request may go. Fails when the thread's cancel token fires or the
+  // wait exceeds max_wait_secs. The priority and session come from ScopedRequestClass.
+  [[nodiscard]] common::Result<Ticket> acquire(const std::string &key,
+                                               std::uint64_t prompt_tokens);
+
+  [[nodiscard]] std::vector<AdmissionStats> stats() const;
+
+private:
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  config::AdmissionConfig config_;
+  std::unordered_map<std::string, std::shared_ptr<Bucket>> buckets_;
+};
+
+// Sends every request of `inner` through AdmissionController::shared() under `key`, and
+// reports 429s back to it so the whole process cools down together.
+class AdmittedProvider final : public Provider {
+public:
+  AdmittedProvider(std::shared_ptr<Provider> inner, std::string key);
+
+  [[nodiscard]] common::Result<std::string> chat(const std::string &message,
+                                                 const std::string &model,
+                                                 double temperature) override;
+  [[nodiscard]] common::Result<std::string>
+  chat_with_system(const std::optional<std::string> &system_prompt, const std::string &message,
+                   const std::string &model, double temperature) override;
+  [[nodiscard]] common::Result<std::string> chat_with_system_tools(
+      const std::optional<std::string> &system_prompt, const std::string &message,
+      const std::string &model, double temperature,
+      const std::vector<tools::ToolSpec> &tools) override;
+  [[nodiscard]] common::Result<std::string>
+  chat_with_system_stream(const std::optional<std::string> &system_prompt,
+                          const std::string &message, const std::string &model,
+                          double temperature, const StreamChunkCallback &on_chunk) override;
+
+  [[nodiscard]] common::Status warmup() override;
+  [[nodiscard]] std::string name() const override;
+
+  [[nodiscard]] const std::string &key() const { return key_; }
+
+private:
+  template <typename Send>
+  [[nodiscard]] common::Result<std::string> admit(std::size_t prompt_chars, const Send &send);
+
+  std::shared_ptr<Provider> inner_;
+  std::string key_;
+};
+
+// "Provider error [rate_limit] ..." as produced by ProviderError::to_string().
+[[nodiscard]] bool is_rate_limit_error(const std::string &error);
+
+} // namespace ghostclaw::providers
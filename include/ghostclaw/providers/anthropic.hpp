@@ -31,6 +31,8 @@ public:
   [[nodiscard]] common::Status warmup() override;
   [[nodiscard]] std::string name() const override;
 
+  [[nodiscard]] const std::string &base_url() const { return base_url_; }
+
 private:
   [[nodiscard]] std::unordered_map<std::string, std::string>
   build_headers(bool stream) const;
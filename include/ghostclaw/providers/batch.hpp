@@ -0,0 +1,231 @@
+#pragma once
+
+#include "ghostclaw/common/result.hpp"
+#include "ghostclaw/config/schema.hpp"
+#include "ghostclaw/providers/traits.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace ghostclaw::providers {
+
+struct BatchRequest {
+  // Assigned by BatchLane; unique within one batch.
+  std::string custom_id;
+  std::optional<std::string> system_prompt;
+  std::string message;
+  std::string model;
+  double temperature = 0.7;
+  std::vector<tools::ToolSpec> tools;
+};
+
+struct BatchOutcome {
+  std::string custom_id;
+  std::string content;
+  // Empty when the request succeeded.
+  std::string error;
+  // False once the request may have run upstream, so a direct retry could bill it twice.
+  bool retryable = true;
+  std::optional<TokenUsage> usage;
+};
+
+struct BatchPoll {
+  bool done = false;
+  // The provider's status string, for error messages.
+  std::string status;
+  // Set once done; requests missing here count as failed.
+  std::vector<BatchOutcome> outcomes;
+};
+
+// A provider's asynchronous batch endpoint: submit many requests at once, then poll
+// until the provider has processed all of them.
+class BatchBackend {
+public:
+  virtual ~BatchBackend() = default;
+  // Returns the provider's id for the new batch.
+  [[nodiscard]] virtual common::Result<std::string>
+  submit(const std::vector<BatchRequest> &requests) = 0;
+  [[nodiscard]] virtual common::Result<BatchPoll> poll(const std::string &batch_id) = 0;
+  // Asks the provider to stop processing a batch whose results are no longer wanted.
+  [[nodiscard]] virtual common::Status cancel(const std::string &batch_id) = 0;
+};
+
+// Anthropic Message Batches: POST /v1/messages/batches, then GET the batch until it has
+// ended and read its results_url (JSONL). Like AnthropicProvider, tools are not sent.
+class AnthropicBatchBackend final : public BatchBackend {
+public:
+  AnthropicBatchBackend(std::string api_key, std::string base_url,
+                        std::shared_ptr<HttpClient> http_client);
+
+  [[nodiscard]] common::Result<std::string>
+  submit(const std::vector<BatchRequest> &requests) override;
+  [[nodiscard]] common::Result<BatchPoll> poll(const std::string &batch_id) override;
+  [[nodiscard]] common::Status cancel(const std::string &batch_id) override;
+
+private:
+  [[nodiscard]] std::unordered_map<std::string, std::string> build_headers() const;
+
+  std::string api_key_;
+  std::string base_url_;
+  std::shared_ptr<HttpClient> http_client_;
+};
+
+// OpenAI Batch: upload the requests as a JSONL file, POST /batches against
+// /v1/chat/completions, then GET the batch until it completes and read its output file.
+class OpenAiBatchBackend final : public BatchBackend {
+public:
+  OpenAiBatchBackend(std::string api_key, std::string base_url,
+                     std::shared_ptr<HttpClient> http_client);
+
+  [[nodiscard]] common::Result<std::string>
+  submit(const std::vector<BatchRequest> &requests) override;
+  [[nodiscard]] common::Result<BatchPoll> poll(const std::string &batch_id) override;
+  [[nodiscard]] common::Status cancel(const std::string &batch_id) override;
+
+private:
+  [[nodiscard]] common::Result<std::vector<BatchOutcome>> read_file(const std::string &file_id);
+
+  std::string api_key_;
+  std::string base_url_;
+  std::shared_ptr<HttpClient> http_client_;
+};
+
+struct BatchStats {
+  std::string key;
+  std::size_t queued = 0;
+  std::size_t in_flight_batches = 0;
+  std::size_t in_flight_requests = 0;
+  std::uint64_t submitted_batches = 0;
+  std::uint64_t completed = 0;
+  std::uint64_t failed = 0;
+};
+
+// Process-wide lane for deferred requests. Requests queue per provider/key until a batch
+// is full or its oldest request has waited max_delay_secs; one worker thread then submits
+// the batch, polls it, and hands each result to the callback of the request it answers.
+class BatchLane {
+public:
+  using Clock = std::chrono::steady_clock;
+  using Callback = std::function<void(BatchOutcome)>;
+
+  BatchLane() = default;
+  ~BatchLane();
+
+  BatchLane(const BatchLane &) = delete;
+  BatchLane &operator=(const BatchLane &) = delete;
+
+  [[nodiscard]] static BatchLane &shared();
+
+  void configure(const config::BatchConfig &config);
+  [[nodiscard]] config::BatchConfig config() const;
+
+  // `on_done` runs on the worker thread, with an error outcome when the batch fails.
+  // Returns the custom_id assigned to the request.
+  std::string enqueue(const std::string &key, std::shared_ptr<BatchBackend> backend,
+                      BatchRequest request, Callback on_done);
+  // enqueue() that blocks the calling thread for its outcome. Fails when the thread's
+  // cancel token fires, the lane stops, or the result takes longer than max_wait_secs;
+  // the request is then withdrawn, cancelling its batch upstream once nothing else
+  // waits on it.
+  [[nodiscard]] common::Result<BatchOutcome> submit(const std::string &key,
+                                                    std::shared_ptr<BatchBackend> backend,
+                                                    BatchRequest request);
+  // Submits everything queued without waiting for full batches.
+  void flush();
+  // Stops the worker and fails every queued and in-flight request; requests enqueued
+  // meanwhile fail too. The worker starts again on the next enqueue().
+  void stop();
+
+  [[nodiscard]] std::vector<BatchStats> stats() const;
+
+private:
+  struct Pending {
+    BatchRequest request;
+    Callback on_done;
+    Clock::time_point queued_at;
+  };
+  struct InFlight {
+    std::string batch_id;
+    std::shared_ptr<BatchBackend> backend;
+    std::unordered_map<std::string, Callback> callbacks;
+    Clock::time_point submitted_at;
+    Clock::time_point next_poll;
+  };
+  struct Queue {
+    std::shared_ptr<BatchBackend> backend;
+    std::vector<Pending> pending;
+    std::vector<InFlight> in_flight;
+    BatchStats stats;
+  };
+
+  void worker_loop();
+  void submit_batch(const std::string &key, const std::shared_ptr<BatchBackend> &backend,
+                    std::vector<Pending> batch);
+  void poll_batch(const std::string &key, const std::shared_ptr<BatchBackend> &backend,
+                  const std::string &batch_id);
+  void fail_all(const std::string &error);
+  // Drops one request; returns the batch to cancel upstream when it was the last waiter.
+  [[nodiscard]] std::optional<std::pair<std::shared_ptr<BatchBackend>, std::string>>
+  withdraw(const std::string &key, const std::string &custom_id);
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  config::BatchConfig config_;
+  std::unordered_map<std::string, Queue> queues_;
+  std::uint64_t next_id_ = 1;
+  bool flush_requested_ = false;
+  bool stopping_ = false;
+  std::thread worker_;
+};
+
+// Sends deferred requests (RequestPriority::Deferred, with batching enabled) through
+// BatchLane::shared() and everything else straight to `inner`. A request the batch API
+// rejected is retried directly, so a failed batch only costs latency; one that timed out
+// or was cancelled fails instead, since it may still have been billed upstream.
+class BatchedProvider final : public Provider {
+public:
+  BatchedProvider(std::shared_ptr<Provider> inner, std::shared_ptr<BatchBackend> backend,
+                  std::string key);
+
+  [[nodiscard]] common::Result<std::string> chat(const std::string &message,
+                                                 const std::string &model,
+                                                 double temperature) override;
+  [[nodiscard]] common::Result<std::string>
+  chat_with_system(const std::optional<std::string> &system_prompt, const std::string &message,
+                   const std::string &model, double temperature) override;
+  [[nodiscard]] common::Result<std::string> chat_with_system_tools(
+      const std::optional<std::string> &system_prompt, const std::string &message,
+      const std::string &model, double temperature,
+      const std::vector<tools::ToolSpec> &tools) override;
+  [[nodiscard]] common::Result<std::string>
+  chat_with_system_stream(const std::optional<std::string> &system_prompt,
+                          const std::string &message, const std::string &model,
+                          double temperature, const StreamChunkCallback &on_chunk) override;
+
+  [[nodiscard]] common::Status warmup() override;
+  [[nodiscard]] std::string name() const override;
+
+  [[nodiscard]] const std::shared_ptr<Provider> &inner() const { return inner_; }
+
+private:
+  // Empty when the request should go to `inner` instead.
+  [[nodiscard]] std::optional<common::Result<std::string>>
+  try_batch(const std::optional<std::string> &system_prompt, const std::string &message,
+            const std::string &model, double temperature,
+            const std::vector<tools::ToolSpec> &tools);
+
+  std::shared_ptr<Provider> inner_;
+  std::shared_ptr<BatchBackend> backend_;
+  std::string key_;
+};
+
+} // namespace ghostclaw::providers
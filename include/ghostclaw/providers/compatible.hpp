@@ -34,6 +34,11 @@ public:
   [[nodiscard]] common::Status warmup() override;
   [[nodiscard]] std::string name() const override;
 
+  [[nodiscard]] const std::string &base_url() const { return base_url_; }
+
+  // Maps a transport failure or non-2xx status to a ProviderError status.
+  [[nodiscard]] static common::Status validate_response_status(const HttpResponse &response);
+
 private:
   [[nodiscard]] std::string build_body(const std::optional<std::string> &system_prompt,
                                        const std::string &message, const std::string &model,
@@ -42,7 +47,6 @@ private:
                                        bool stream = false) const;
 
   [[nodiscard]] common::Result<std::string> handle_response(const HttpResponse &response) const;
-  [[nodiscard]] common::Status validate_response_status(const HttpResponse &response) const;
   [[nodiscard]] static bool is_sse_response(const HttpResponse &response);
   [[nodiscard]] static common::Result<std::string> parse_sse_response(const HttpResponse &response);
 
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "ghostclaw/common/result.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ghostclaw::providers {
+
+// Tensor encodings from ggml that the local runtime can read.
+enum class GgmlType : std::uint32_t {
+  F32 = 0,
+  F16 = 1,
+  Q4_0 = 2,
+  Q8_0 = 8,
+  Q4_K = 12,
+  Q6_K = 14,
+  BF16 = 30,
+};
+
+[[nodiscard]] bool ggml_type_supported(std::uint32_t type);
+// Values per quantisation block (1 for float types).
+[[nodiscard]] std::uint64_t ggml_block_size(std::uint32_t type);
+// Bytes taken by `elements` values; elements must be a multiple of the block size.
+[[nodiscard]] std::uint64_t ggml_row_bytes(std::uint32_t type, std::uint64_t elements);
+// Decodes `count` values starting at a block boundary.
+void ggml_dequantize(std::uint32_t type, const std::uint8_t *src, float *dst, std::uint64_t count);
+
+struct GgufValue {
+  enum class Kind { Integer, Float, Bool, String, StringArray, NumberArray };
+  Kind kind = Kind::Integer;
+  std::int64_t integer = 0;
+  double number = 0.0;
+  bool boolean = false;
+  std::string string;
+  std::vector<std::string> strings;
+  std::vector<double> numbers;
+};
+
+struct GgufTensor {
+  std::string name;
+  // dims[0] is the contiguous row length, as in ggml's ne[0].
+  std::vector<std::uint64_t> dims;
+  std::uint32_t type = 0;
+  const std::uint8_t *data = nullptr;
+
+  [[nodiscard]] std::uint64_t row_length() const { return dims.empty() ? 0 : dims[0]; }
+  [[nodiscard]] std::uint64_t rows() const;
+};
+
+// A memory-mapped GGUF file: metadata plus pointers into the tensor data.
+class GgufFile {
+public:
+  [[nodiscard]] static common::Result<std::shared_ptr<GgufFile>>
+  open(const std::filesystem::path &path);
+  ~GgufFile();
+
+  GgufFile(const GgufFile &) = delete;
+  GgufFile &operator=(const GgufFile &) = delete;
+
+  [[nodiscard]] const GgufValue *find(const std::string &key) const;
+  [[nodiscard]] std::int64_t get_int(const std::string &key, std::int64_t fallback) const;
+  [[nodiscard]] double get_float(const std::string &key, double fallback) const;
+  [[nodiscard]] bool get_bool(const std::string &key, bool fallback) const;
+  [[nodiscard]] std::string get_string(const std::string &key, const std::string &fallback) const;
+
+  [[nodiscard]] const GgufTensor *tensor(const std::string &name) const;
+  [[nodiscard]] const std::vector<GgufTensor> &tensors() const { return tensors_; }
+
+private:
+  GgufFile() = default;
+
+  std::unordered_map<std::string, GgufValue> metadata_;
+  std::vector<GgufTensor> tensors_;
+  std::unordered_map<std::string, std::size_t> tensor_index_;
+  const std::uint8_t *mapped_ = nullptr;
+  std::size_t mapped_size_ = 0;
+  std::vector<std::uint8_t> buffer_;
+};
+
+// Writes GGUF v3 files; used to build small fixtures and benchmark models.
+class GgufWriter {
+public:
+  void set_uint(const std::string &key, std::uint32_t value);
+  void set_float(const std::string &key, float value);
+  void set_bool(const std::string &key, bool value);
+  void set_string(const std::string &key, const std::string &value);
+  void set_strings(const std::string &key, const std::vector<std::string> &values);
+  void set_floats(const std::string &key, const std::vector<float> &values);
+  void set_ints(const std::string &key, const std::vector<std::int32_t> &values);
+
+  void add_tensor(const std::string &name, std::vector<std::uint64_t> dims, GgmlType type,
+                  std::vector<std::uint8_t> data);
+  void add_f32(const std::string &name, std::vector<std::uint64_t> dims,
+               const std::vector<float> &values);
+
+  [[nodiscard]] common::Status write(const std::filesystem::path &path) const;
+
+private:
+  struct PendingTensor {
+    std::string name;
+    std::vector<std::uint64_t> dims;
+    GgmlType type = GgmlType::F32;
+    std::vector<std::uint8_t> data;
+  };
+
+  std::vector<std::pair<std::string, std::string>> metadata_;
+  std::vector<PendingTensor> tensors_;
+};
+
+// Q8_0 encoding of `values` (a multiple of 32 long).
+[[nodiscard]] std::vector<std::uint8_t> quantize_q8_0(const std::vector<float> &values);
+
+} // namespace ghostclaw::providers
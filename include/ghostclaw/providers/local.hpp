@@ -0,0 +1,62 @@
+#pragma once
+
+#include "ghostclaw/config/schema.hpp"
+#include "ghostclaw/providers/local_model.hpp"
+#include "ghostclaw/providers/traits.hpp"
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace ghostclaw::providers {
+
+// Serves chats from a GGUF model running in this process ("gguf:<path>" providers). The
+// model argument of each call is ignored; the file decides the model.
+class LocalProvider final : public Provider {
+public:
+  LocalProvider(std::shared_ptr<LocalModel> model, std::uint32_t max_tokens);
+
+  [[nodiscard]] common::Result<std::string> chat(const std::string &message,
+                                                 const std::string &model,
+                                                 double temperature) override;
+  [[nodiscard]] common::Result<std::string>
+  chat_with_system(const std::optional<std::string> &system_prompt, const std::string &message,
+                   const std::string &model, double temperature) override;
+  [[nodiscard]] common::Result<std::string>
+  chat_with_system_stream(const std::optional<std::string> &system_prompt,
+                          const std::string &message, const std::string &model,
+                          double temperature, const StreamChunkCallback &on_chunk) override;
+
+  [[nodiscard]] common::Status warmup() override;
+  [[nodiscard]] std::string name() const override;
+
+  [[nodiscard]] const std::shared_ptr<LocalModel> &model() const { return model_; }
+
+private:
+  std::shared_ptr<LocalModel> model_;
+  std::uint32_t max_tokens_;
+};
+
+// Loaded models by path, so the agent, the router and pooled agents that name the same
+// file share its mapping, worker threads and KV caches. A model is unloaded when the last
+// provider using it goes away.
+class LocalModelCache {
+public:
+  [[nodiscard]] static LocalModelCache &shared();
+
+  // Applies to models loaded afterwards.
+  void configure(const config::LocalModelConfig &config);
+  [[nodiscard]] config::LocalModelConfig config() const;
+
+  [[nodiscard]] common::Result<std::shared_ptr<LocalModel>>
+  acquire(const std::filesystem::path &path);
+
+private:
+  mutable std::mutex mutex_;
+  config::LocalModelConfig config_;
+  std::unordered_map<std::string, std::weak_ptr<LocalModel>> models_;
+};
+
+} // namespace ghostclaw::providers
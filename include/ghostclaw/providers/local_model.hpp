@@ -0,0 +1,224 @@
+#pragma once
+
+#include "ghostclaw/common/result.hpp"
+#include "ghostclaw/providers/gguf.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace ghostclaw::providers {
+
+struct LocalModelOptions {
+  // 0 uses every hardware thread.
+  std::uint32_t threads = 0;
+  // Capped at the context length the model was trained with.
+  std::uint32_t context_length = 2048;
+  // Earlier prompts whose KV state is kept for prefix reuse.
+  std::uint32_t cache_slots = 4;
+};
+
+struct LocalGenerateOptions {
+  std::uint32_t max_tokens = 512;
+  float temperature = 0.7F;
+  std::uint32_t top_k = 40;
+  // 0 seeds from std::random_device.
+  std::uint64_t seed = 0;
+};
+
+struct LocalGenerateStats {
+  std::size_t prompt_tokens = 0;
+  // Prompt tokens whose KV state came from an earlier call.
+  std::size_t reused_tokens = 0;
+  std::size_t generated_tokens = 0;
+};
+
+// SentencePiece ("llama") or byte-level BPE ("gpt2") vocabulary read from GGUF metadata.
+class LocalTokenizer {
+public:
+  [[nodiscard]] static common::Result<LocalTokenizer> from_gguf(const GgufFile &file);
+
+  // Control and user-defined token strings in `text` become their ids when parse_special is
+  // set. No BOS is added.
+  [[nodiscard]] std::vector<std::int32_t> encode(std::string_view text, bool parse_special) const;
+  // encode() appending to `out`. Text that does not start the prompt gets no SentencePiece
+  // space prefix, so a prompt can be encoded piece by piece.
+  void encode_into(std::string_view text, bool parse_special, bool at_start,
+                   std::vector<std::int32_t> &out) const;
+  // Bytes of one token; empty for control tokens.
+  [[nodiscard]] std::string decode(std::int32_t token) const;
+  [[nodiscard]] std::optional<std::int32_t> find(const std::string &piece) const;
+
+  [[nodiscard]] bool is_control(std::int32_t token) const;
+  [[nodiscard]] std::int32_t bos() const { return bos_; }
+  [[nodiscard]] std::int32_t eos() const { return eos_; }
+  [[nodiscard]] bool add_bos() const { return add_bos_; }
+  [[nodiscard]] std::size_t size() const { return pieces_.size(); }
+
+private:
+  enum class Kind { Spm, Bpe };
+
+  void encode_spm(std::string_view text, bool first, std::vector<std::int32_t> &out) const;
+  void encode_bpe(std::string_view text, std::vector<std::int32_t> &out) const;
+  void encode_bpe_word(const std::string &word, std::vector<std::int32_t> &out) const;
+  void push_bytes(std::string_view bytes, std::vector<std::int32_t> &out) const;
+
+  Kind kind_ = Kind::Spm;
+  std::vector<std::string> pieces_;
+  std::vector<float> scores_;
+  std::vector<std::int32_t> types_;
+  std::unordered_map<std::string, std::int32_t> ids_;
+  std::unordered_map<std::string, std::int32_t> merge_ranks_;
+  // Control/user-defined pieces, longest first, for literal matching in prompts.
+  std::vector<std::pair<std::string, std::int32_t>> specials_;
+  std::int32_t bos_ = -1;
+  std::int32_t eos_ = -1;
+  std::int32_t unk_ = -1;
+  bool add_bos_ = true;
+  bool add_space_prefix_ = true;
+};
+
+// Fixed set of threads for the matrix kernels; the calling thread takes the first share.
+class WorkerPool {
+public:
+  explicit WorkerPool(std::size_t threads);
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+
+  // Calls fn(begin, end) over [0, count) split into one contiguous range per thread.
+  void run(std::size_t count, const std::function<void(std::size_t, std::size_t)> &fn);
+  [[nodiscard]] std::size_t size() const { return workers_.size() + 1; }
+
+private:
+  void worker_loop(std::size_t index);
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable start_cv_;
+  std::condition_variable done_cv_;
+  const std::function<void(std::size_t, std::size_t)> *job_ = nullptr;
+  std::size_t count_ = 0;
+  std::size_t pending_ = 0;
+  std::uint64_t generation_ = 0;
+  bool stopping_ = false;
+};
+
+// A llama-family decoder (llama, qwen2 GGUF architectures) evaluated on the CPU from a
+// memory-mapped GGUF file. Quantised weights are decoded row by row inside the matrix
+// kernels, so memory use stays close to the file size plus the KV caches.
+class LocalModel {
+public:
+  [[nodiscard]] static common::Result<std::shared_ptr<LocalModel>>
+  load(const std::filesystem::path &path, const LocalModelOptions &options = {});
+
+  [[nodiscard]] const LocalTokenizer &tokenizer() const { return tokenizer_; }
+  [[nodiscard]] const std::string &architecture() const { return architecture_; }
+  [[nodiscard]] std::uint32_t context_length() const { return context_length_; }
+  [[nodiscard]] std::size_t threads() const { return pool_->size(); }
+
+  // One turn in the model's chat format, picked from the special tokens in its vocabulary.
+  // Only the template's markers become special tokens; the system prompt and message stay
+  // plain text, so role markers inside them cannot open a new turn. Past `max_tokens` the
+  // middle of the system prompt goes first (its instructions lead, recent history trails),
+  // then the start of the message; the markers are always kept.
+  [[nodiscard]] std::vector<std::int32_t>
+  encode_chat(const std::optional<std::string> &system_prompt, const std::string &message,
+              std::size_t max_tokens) const;
+
+  // Continues `prompt` (special tokens allowed). The KV cache of the earlier prompt that
+  // shares the longest token prefix is reused, so follow-up turns of a conversation only
+  // evaluate their new tokens. on_text receives decoded text as it is produced, possibly
+  // empty; returning false stops generation.
+  [[nodiscard]] common::Result<std::string>
+  generate(const std::string &prompt, const LocalGenerateOptions &options,
+           const std::function<bool(std::string_view)> &on_text = {},
+           LocalGenerateStats *stats = nullptr);
+  // generate() for an encode_chat() turn sized to leave room for the reply.
+  [[nodiscard]] common::Result<std::string>
+  chat(const std::optional<std::string> &system_prompt, const std::string &message,
+       const LocalGenerateOptions &options,
+       const std::function<bool(std::string_view)> &on_text = {},
+       LocalGenerateStats *stats = nullptr);
+
+private:
+  enum class ChatTemplate { ChatMl, Llama3, Zephyr, Llama2 };
+
+  struct Layer {
+    std::vector<float> attn_norm;
+    std::vector<float> ffn_norm;
+    std::vector<float> bq;
+    std::vector<float> bk;
+    std::vector<float> bv;
+    const GgufTensor *wq = nullptr;
+    const GgufTensor *wk = nullptr;
+    const GgufTensor *wv = nullptr;
+    const GgufTensor *wo = nullptr;
+    const GgufTensor *w_gate = nullptr;
+    const GgufTensor *w_up = nullptr;
+    const GgufTensor *w_down = nullptr;
+  };
+
+  struct CacheSlot {
+    std::vector<std::int32_t> tokens;
+    // Per layer, position-major rows of kv_dim values.
+    std::vector<std::vector<float>> k;
+    std::vector<std::vector<float>> v;
+    std::uint64_t last_used = 0;
+  };
+
+  LocalModel() = default;
+
+  void matmul(const GgufTensor &w, const float *x, std::size_t n, float *y);
+  // Evaluates `count` tokens at positions [start, start + count) into `slot`; writes the
+  // logits of the last token when `logits` is set.
+  void forward(const std::int32_t *tokens, std::size_t count, std::size_t start,
+               CacheSlot &slot, float *logits);
+  [[nodiscard]] CacheSlot &pick_slot(const std::vector<std::int32_t> &prompt,
+                                     std::size_t &reuse);
+  // Prompt tokens that fit while keeping room for the reply.
+  [[nodiscard]] std::size_t prompt_budget(const LocalGenerateOptions &options) const;
+  [[nodiscard]] common::Result<std::string>
+  generate_tokens(std::vector<std::int32_t> tokens, const LocalGenerateOptions &options,
+                  const std::function<bool(std::string_view)> &on_text, LocalGenerateStats *stats);
+
+  std::shared_ptr<GgufFile> file_;
+  LocalTokenizer tokenizer_;
+  std::string architecture_;
+  ChatTemplate template_ = ChatTemplate::Llama2;
+
+  std::size_t n_embd_ = 0;
+  std::size_t n_layer_ = 0;
+  std::size_t n_head_ = 0;
+  std::size_t n_head_kv_ = 0;
+  std::size_t head_dim_ = 0;
+  std::size_t n_ff_ = 0;
+  std::size_t n_vocab_ = 0;
+  std::size_t n_rot_ = 0;
+  float rope_base_ = 10000.0F;
+  float norm_eps_ = 1e-5F;
+  bool rope_neox_ = false;
+  std::uint32_t context_length_ = 0;
+
+  const GgufTensor *token_embd_ = nullptr;
+  const GgufTensor *output_ = nullptr;
+  std::vector<float> output_norm_;
+  std::vector<Layer> layers_;
+
+  std::mutex mutex_;
+  std::vector<CacheSlot> slots_;
+  std::uint64_t use_clock_ = 0;
+  std::unique_ptr<WorkerPool> pool_;
+};
+
+} // namespace ghostclaw::providers
@@ -8,6 +8,8 @@ class OpenAiProvider final : public CompatibleProvider {
 public:
   explicit OpenAiProvider(const std::string &api_key,
                           std::shared_ptr<HttpClient> http_client = std::make_shared<CurlHttpClient>());
+  OpenAiProvider(const std::string &api_key, std::string base_url,
+                 std::shared_ptr<HttpClient> http_client = std::make_shared<CurlHttpClient>());
 };
 
 } // namespace ghostclaw::providers
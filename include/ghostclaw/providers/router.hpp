@@ -0,0 +1,79 @@
+#pragma once
+
+#include "ghostclaw/common/result.hpp"
+#include "ghostclaw/config/schema.hpp"
+#include "ghostclaw/providers/traits.hpp"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace ghostclaw::providers {
+
+enum class RouteTier { Fast, Strong };
+
+struct RouteSignals {
+  std::string_view message;
+  // A skill matched the message; skill instructions need the default model.
+  bool skill_match = false;
+  // The caller chose a model or provider for this turn.
+  bool pinned = false;
+};
+
+struct RouteDecision {
+  RouteTier tier = RouteTier::Strong;
+  double confidence = 1.0;
+  std::string reason;
+};
+
+// Running totals for tuning the thresholds. Latency and usage are booked to the tier
+// that produced the final answer.
+struct RouterStats {
+  std::uint64_t fast_turns = 0;
+  std::uint64_t strong_turns = 0;
+  // Turns routed fast that the default model finished.
+  std::uint64_t escalations = 0;
+  std::uint64_t classifier_calls = 0;
+  std::uint64_t fast_latency_ms = 0;
+  std::uint64_t strong_latency_ms = 0;
+  TokenUsage fast_usage;
+  TokenUsage strong_usage;
+};
+
+// Picks a model tier per turn from cheap signals: message length and shape, likely
+// tool use, and skill matches, with an optional one-word classification by the fast
+// model for borderline turns.
+class ModelRouter {
+public:
+  ModelRouter(config::RouterConfig config, std::shared_ptr<Provider> fast);
+
+  [[nodiscard]] RouteDecision route(const RouteSignals &signals);
+  // A fast reply the default model should redo: empty or openly unsure.
+  [[nodiscard]] static bool should_escalate(const std::string &reply);
+
+  [[nodiscard]] Provider &fast_provider() const { return *fast_; }
+  [[nodiscard]] const std::string &fast_model() const { return config_.fast_model; }
+
+  void record(RouteTier served, bool escalated, std::chrono::milliseconds latency,
+              const TokenUsage &usage);
+  [[nodiscard]] RouterStats stats() const;
+
+private:
+  [[nodiscard]] RouteDecision score(std::string_view message) const;
+  [[nodiscard]] std::optional<RouteTier> classify(std::string_view message);
+
+  config::RouterConfig config_;
+  std::shared_ptr<Provider> fast_;
+  mutable std::mutex mutex_;
+  RouterStats stats_;
+};
+
+// Null when config.router is disabled.
+[[nodiscard]] common::Result<std::shared_ptr<ModelRouter>>
+create_model_router(const config::Config &config,
+                    std::shared_ptr<HttpClient> http_client = std::make_shared<CurlHttpClient>());
+
+} // namespace ghostclaw::providers
@@ -52,11 +52,49 @@ struct HttpResponse {
   std::unordered_map<std::string, std::string> headers;
   bool timeout = false;
   bool network_error = false;
+  bool cancelled = false;
   std::string network_error_message;
 };
 
+// Token counts reported by the API. prompt_tokens includes cached_prompt_tokens.
+struct TokenUsage {
+  std::uint64_t prompt_tokens = 0;
+  std::uint64_t completion_tokens = 0;
+  std::uint64_t cached_prompt_tokens = 0;
+
+  [[nodiscard]] std::uint64_t total_tokens() const { return prompt_tokens + completion_tokens; }
+  [[nodiscard]] bool empty() const { return total_tokens() == 0 && cached_prompt_tokens == 0; }
+  TokenUsage &operator+=(const TokenUsage &other);
+};
+
+// Like cancellation, usage does not fit the string-returning provider interface. A caller
+// opens a capture on its thread; providers report the usage of every request they complete
+// on that thread and the capture sums them. Reports with no capture open are dropped.
+class ScopedUsageCapture {
+public:
+  ScopedUsageCapture();
+  ~ScopedUsageCapture();
+
+  ScopedUsageCapture(const ScopedUsageCapture &) = delete;
+  ScopedUsageCapture &operator=(const ScopedUsageCapture &) = delete;
+
+  [[nodiscard]] const TokenUsage &usage() const { return usage_; }
+
+private:
+  friend void report_usage(const TokenUsage &usage);
+
+  TokenUsage usage_;
+  ScopedUsageCapture *previous_ = nullptr;
+};
+
+void report_usage(const TokenUsage &usage);
+
 using StreamChunkCallback = std::function<void(std::string_view)>;
 
+// Splits a complete reply into word-sized stream chunks. Each chunk keeps its trailing
+// whitespace so concatenating the chunks reproduces the reply exactly.
+[[nodiscard]] std::vector<std::string_view> split_stream_chunks(std::string_view text);
+
 class HttpClient {
 public:
   virtual ~HttpClient() = default;
@@ -71,6 +109,10 @@ public:
   [[nodiscard]] virtual HttpResponse
   head(const std::string &url, const std::unordered_map<std::string, std::string> &headers,
        std::uint64_t timeout_ms) = 0;
+  // Only the batch APIs need GET; clients without it report a network error.
+  [[nodiscard]] virtual HttpResponse
+  get(const std::string &url, const std::unordered_map<std::string, std::string> &headers,
+      std::uint64_t timeout_ms);
 };
 
 class CurlHttpClient final : public HttpClient {
@@ -89,6 +131,9 @@ public:
   [[nodiscard]] HttpResponse
   head(const std::string &url, const std::unordered_map<std::string, std::string> &headers,
        std::uint64_t timeout_ms) override;
+  [[nodiscard]] HttpResponse
+  get(const std::string &url, const std::unordered_map<std::string, std::string> &headers,
+      std::uint64_t timeout_ms) override;
 };
 
 class Provider {
@@ -124,15 +169,8 @@ public:
       return result;
     }
     if (on_chunk) {
-      std::istringstream stream(result.value());
-      std::string token;
-      bool emitted = false;
-      while (stream >> token) {
-        on_chunk(token);
-        emitted = true;
-      }
-      if (!emitted && !result.value().empty()) {
-        on_chunk(result.value());
+      for (const auto chunk : split_stream_chunks(result.value())) {
+        on_chunk(chunk);
       }
     }
     return result;
@@ -149,5 +187,13 @@ public:
 [[nodiscard]] common::Result<std::string> parse_openai_sse_content(const std::string &response);
 [[nodiscard]] common::Result<std::string> parse_anthropic_sse_event_delta(const std::string &event_data);
 [[nodiscard]] common::Result<std::string> parse_anthropic_sse_content(const std::string &response);
+// Usage parsers return nothing when the payload carries no usage block. The SSE event
+// variants read a single event; the stream variants scan a whole buffered stream.
+[[nodiscard]] std::optional<TokenUsage> parse_openai_usage(const std::string &response);
+[[nodiscard]] std::optional<TokenUsage> parse_openai_sse_usage(const std::string &response);
+[[nodiscard]] std::optional<TokenUsage> parse_anthropic_usage(const std::string &response);
+[[nodiscard]] std::optional<TokenUsage>
+parse_anthropic_sse_event_usage(const std::string &event_data);
+[[nodiscard]] std::optional<TokenUsage> parse_anthropic_sse_usage(const std::string &response);
 
 } // namespace ghostclaw::providers
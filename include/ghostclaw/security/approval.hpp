@@ -8,6 +8,7 @@
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <thread>
 #include <vector>
@@ -103,7 +104,15 @@ public:
   [[nodiscard]] bool is_allowlisted(const std::string &command) const;
   [[nodiscard]] bool needs_approval(const ApprovalRequest &request) const;
 
+  // The decision the policy and allowlists give without asking anyone; nullopt when a
+  // human has to decide.
+  [[nodiscard]] std::optional<ApprovalDecision>
+  decide_without_prompt(const ApprovalRequest &request) const;
+  // Asks over the approval socket when decide_without_prompt() cannot decide. Blocks for
+  // up to request.timeout.
   [[nodiscard]] common::Result<ApprovalDecision> authorize(const ApprovalRequest &request);
+  // Applies a decision made out of band (e.g. for a parked turn): AllowAlways is remembered.
+  void record_decision(const std::string &command, ApprovalDecision decision);
 
 private:
   [[nodiscard]] bool matches_allowlist(const std::string &command,
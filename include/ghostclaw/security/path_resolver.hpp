@@ -0,0 +1,82 @@
+#pragma once
+
+#include "ghostclaw/common/result.hpp"
+#include "ghostclaw/security/policy.hpp"
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <unordered_map>
+
+namespace ghostclaw::security {
+
+// Where a tool's path argument points. `relative` is set for paths beneath the workspace
+// root and empty for paths outside it (only possible when workspace_only is off).
+struct ResolvedPath {
+  std::filesystem::path absolute;
+  std::filesystem::path relative;
+
+  [[nodiscard]] bool beneath_root() const { return !relative.empty(); }
+};
+
+// A workspace directory canonicalised once and held open. Paths beneath it are opened
+// relative to the held descriptor with openat2(RESOLVE_BENEATH | RESOLVE_NO_SYMLINKS), so
+// the file that was checked is the file that gets opened, and symlinks are never followed.
+// Without openat2 (macOS, old kernels) each component is opened with O_NOFOLLOW instead.
+class WorkspaceRoot {
+public:
+  WorkspaceRoot(std::filesystem::path canonical, int fd);
+  ~WorkspaceRoot();
+
+  WorkspaceRoot(const WorkspaceRoot &) = delete;
+  WorkspaceRoot &operator=(const WorkspaceRoot &) = delete;
+
+  [[nodiscard]] const std::filesystem::path &path() const { return path_; }
+  [[nodiscard]] int fd() const { return fd_; }
+
+  // Applies the policy's workspace_only and forbidden_paths rules. Paths that are lexically
+  // beneath the root cost no syscalls; others are canonicalised like validate_path().
+  [[nodiscard]] common::Result<ResolvedPath> resolve(const std::string &path,
+                                                     const SecurityPolicy &policy) const;
+
+  // Returns an owned descriptor (O_CLOEXEC is added).
+  [[nodiscard]] common::Result<int> open(const ResolvedPath &path, int flags,
+                                         mode_t mode = 0) const;
+  // Descriptor of the directory containing `path`, for creating siblings and renameat().
+  // Missing directories beneath the root are created when `create` is set.
+  [[nodiscard]] common::Result<int> open_parent(const ResolvedPath &path, bool create) const;
+
+private:
+  std::filesystem::path path_;
+  int fd_ = -1;
+};
+
+// Per-process cache of workspace roots, so file tools skip create_directories and
+// canonicalisation of the workspace on every call.
+struct TempFile {
+  int fd = -1;
+  std::string name;
+};
+
+// Creates "<name>.tmp.<random>" in `dir_fd` with O_EXCL, for writing a replacement that is
+// then renameat() over `name`.
+[[nodiscard]] common::Result<TempFile> create_temp_file(int dir_fd, const std::string &name,
+                                                        mode_t mode);
+
+class PathResolver {
+public:
+  [[nodiscard]] static PathResolver &shared();
+
+  // Creates the workspace when missing. A root whose directory was removed is reopened.
+  [[nodiscard]] common::Result<std::shared_ptr<const WorkspaceRoot>>
+  root(const std::filesystem::path &workspace);
+  void clear();
+
+private:
+  std::mutex mutex_;
+  std::unordered_map<std::string, std::shared_ptr<const WorkspaceRoot>> roots_;
+};
+
+} // namespace ghostclaw::security
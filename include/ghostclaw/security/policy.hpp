@@ -40,5 +40,10 @@ public:
 
 [[nodiscard]] common::Result<std::filesystem::path> validate_path(const std::string &path,
                                                                   const SecurityPolicy &policy);
+// Same, against `canonical_workspace` instead of policy.workspace_dir, which callers that
+// already resolved the workspace pass to skip canonicalising it again.
+[[nodiscard]] common::Result<std::filesystem::path>
+validate_path(const std::string &path, const SecurityPolicy &policy,
+              const std::filesystem::path &canonical_workspace);
 
 } // namespace ghostclaw::security
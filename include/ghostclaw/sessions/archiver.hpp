@@ -0,0 +1,44 @@
+#pragma once
+
+#include "ghostclaw/common/result.hpp"
+#include "ghostclaw/sessions/store.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace ghostclaw::sessions {
+
+struct ArchiverOptions {
+  // Sessions not updated for this long are moved to the archive.
+  std::chrono::seconds idle_after = std::chrono::hours(24 * 7);
+  std::chrono::seconds interval = std::chrono::hours(1);
+};
+
+// Periodically runs SessionStore::archive_idle() on a background thread, so the hot
+// session index only holds recently active sessions.
+class SessionArchiver {
+public:
+  SessionArchiver(SessionStore *store, ArchiverOptions options = {});
+  ~SessionArchiver();
+
+  SessionArchiver(const SessionArchiver &) = delete;
+  SessionArchiver &operator=(const SessionArchiver &) = delete;
+
+  // One pass on the calling thread; returns how many sessions were archived.
+  [[nodiscard]] common::Result<std::size_t> run_once();
+
+private:
+  void worker_loop();
+
+  SessionStore *store_;
+  ArchiverOptions options_;
+
+  std::mutex mutex_;
+  std::condition_variable stop_cv_;
+  bool stopping_ = false;
+  std::thread worker_;
+};
+
+} // namespace ghostclaw::sessions
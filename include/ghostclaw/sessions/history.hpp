@@ -0,0 +1,94 @@
+#pragma once
+
+#include "ghostclaw/common/cancel.hpp"
+#include "ghostclaw/common/result.hpp"
+#include "ghostclaw/sessions/store.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace ghostclaw::sessions {
+
+struct HistoryOptions {
+  // User/assistant messages kept verbatim at the end of the context.
+  std::size_t recent_messages = 8;
+  // Older messages are folded into the summary once this many are waiting, so the
+  // summariser runs every few turns rather than after every one.
+  std::size_t summarize_batch = 4;
+  std::size_t summary_token_budget = 400;
+  std::size_t message_token_budget = 300;
+};
+
+// Rough count at four characters per token; good enough for budgeting prompts.
+[[nodiscard]] std::size_t estimate_tokens(std::string_view text);
+// Keeps the head of `text` within `budget` tokens, marking the cut.
+[[nodiscard]] std::string truncate_to_tokens(std::string text, std::size_t budget);
+
+// Summary plus the unsummarised tail of the transcript, at most
+// recent_messages + summarize_batch messages. `transcript` may be the whole transcript
+// or any suffix of it; entries at or before summary_through are skipped by id.
+// Empty when there is no history.
+[[nodiscard]] std::string build_history_context(const SessionState &state,
+                                                const std::vector<TranscriptEntry> &transcript,
+                                                const HistoryOptions &options = {});
+
+// Folds `new_messages` into `previous_summary`, keeping the result near `token_budget`.
+using HistorySummarizer = std::function<common::Result<std::string>(
+    const std::string &previous_summary, const std::string &new_messages,
+    std::size_t token_budget)>;
+
+// Fallback summariser: appends a clipped line per message and drops the oldest lines
+// once over budget. Needs no provider call.
+[[nodiscard]] common::Result<std::string> extractive_summary(const std::string &previous_summary,
+                                                             const std::string &new_messages,
+                                                             std::size_t token_budget);
+
+// Serves per-session history context and refreshes the stored summaries on a
+// background thread, so a turn never waits on summarisation.
+class SessionHistory {
+public:
+  SessionHistory(SessionStore *store, HistorySummarizer summarizer, HistoryOptions options = {});
+  // Drops queued refreshes and cancels the one in flight; a dropped session is simply
+  // summarised after its next turn.
+  ~SessionHistory();
+
+  SessionHistory(const SessionHistory &) = delete;
+  SessionHistory &operator=(const SessionHistory &) = delete;
+
+  // Call before the turn's own user message is appended to the transcript.
+  [[nodiscard]] std::string context_for(const std::string &session_id) const;
+  // Queues a summary refresh after a turn; returns immediately.
+  void schedule_refresh(const std::string &session_id);
+  // Summarises now on the calling thread when enough messages are waiting.
+  [[nodiscard]] common::Status refresh(const std::string &session_id);
+  // Waits until every queued refresh has run.
+  void flush();
+
+private:
+  void worker_loop();
+
+  SessionStore *store_;
+  HistorySummarizer summarizer_;
+  HistoryOptions options_;
+
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable idle_cv_;
+  std::deque<std::string> queue_;
+  std::unordered_set<std::string> queued_;
+  bool busy_ = false;
+  bool stopping_ = false;
+  // Installed for the worker's refreshes so a summariser calling a provider stops early.
+  std::shared_ptr<common::CancelToken> cancel_ = std::make_shared<common::CancelToken>();
+  std::thread worker_;
+};
+
+} // namespace ghostclaw::sessions
@@ -2,11 +2,25 @@
 
 #include "ghostclaw/common/result.hpp"
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
 namespace ghostclaw::sessions {
 
+// Running totals for the turns of a session, or of every session on a channel.
+struct SessionUsage {
+  std::uint64_t turns = 0;
+  std::uint64_t prompt_tokens = 0;
+  std::uint64_t completion_tokens = 0;
+  std::uint64_t cached_prompt_tokens = 0;
+  std::uint64_t tool_calls = 0;
+  std::uint64_t tool_ms = 0;
+  std::uint64_t latency_ms = 0;
+
+  SessionUsage &operator+=(const SessionUsage &other);
+};
+
 struct SessionState {
   std::string session_id;
   std::string agent_id;
@@ -18,6 +32,11 @@ struct SessionState {
   std::string delivery_context;
   std::string updated_at;
   std::vector<std::string> subagents;
+  SessionUsage usage;
+  // Rolling summary of the first `summary_through` transcript entries; see
+  // sessions/history.hpp.
+  std::string history_summary;
+  std::uint64_t summary_through = 0;
 };
 
 [[nodiscard]] std::string encode_session_state_jsonl(const SessionState &state);
@@ -4,7 +4,10 @@
 #include "ghostclaw/sessions/session.hpp"
 #include "ghostclaw/sessions/transcript.hpp"
 
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
+#include <list>
 #include <mutex>
 #include <string>
 #include <unordered_map>
@@ -12,6 +15,23 @@
 
 namespace ghostclaw::sessions {
 
+// Selects a window of transcript entries by id. With `after` set, the first `limit`
+// entries after it; with `before` set, the last `limit` entries before it; otherwise the
+// latest `limit` entries. A limit of 0 means no limit.
+struct TranscriptCursor {
+  std::uint64_t before = 0;
+  std::uint64_t after = 0;
+  std::size_t limit = 50;
+};
+
+struct TranscriptPage {
+  std::vector<TranscriptEntry> entries;
+  // Entries in the whole transcript, including ones outside this page.
+  std::uint64_t total = 0;
+  bool has_more_before = false;
+  bool has_more_after = false;
+};
+
 class SessionStore {
 public:
   explicit SessionStore(std::filesystem::path root_dir);
@@ -24,27 +44,97 @@ public:
   [[nodiscard]] common::Status set_group(const std::string &session_id,
                                          const std::string &group_id);
 
+  // Adds one turn's usage to the session's totals; the session must already exist.
+  [[nodiscard]] common::Status record_usage(const std::string &session_id,
+                                            const SessionUsage &turn);
+  // Replaces the session's rolling history summary unless a newer one (covering more
+  // transcript entries) has already been stored.
+  [[nodiscard]] common::Status set_history_summary(const std::string &session_id,
+                                                   const std::string &summary,
+                                                   std::uint64_t summary_through);
+  // Totals summed over every session, keyed by channel_id.
+  [[nodiscard]] common::Result<std::unordered_map<std::string, SessionUsage>>
+  usage_by_channel() const;
+
   [[nodiscard]] common::Status append_transcript(const std::string &session_id,
                                                  const TranscriptEntry &entry);
   [[nodiscard]] common::Result<std::vector<TranscriptEntry>>
   load_transcript(const std::string &session_id, std::size_t limit = 0) const;
+  // Reads only the requested entries, located through a per-session index of line
+  // offsets that is extended as the transcript grows.
+  [[nodiscard]] common::Result<TranscriptPage>
+  load_transcript_page(const std::string &session_id, const TranscriptCursor &cursor) const;
 
   [[nodiscard]] common::Status register_subagent(const std::string &session_id,
                                                  const std::string &subagent_id);
   [[nodiscard]] common::Status unregister_subagent(const std::string &session_id,
                                                    const std::string &subagent_id);
 
+  // Moves sessions not updated for `idle_for` (and without registered subagents) out of the
+  // hot index into gzip archive segments under <root>/archive. They drop out of
+  // list_states() and come back transparently on any call naming them. Returns how many
+  // sessions were archived.
+  [[nodiscard]] common::Result<std::size_t> archive_idle(std::chrono::seconds idle_for);
+  // States of archived sessions, newest first, read from the archive index alone.
+  [[nodiscard]] common::Result<std::vector<SessionState>> list_archived() const;
+
 private:
+  // Byte offset of every complete line in one transcript file.
+  struct TranscriptIndex {
+    std::vector<std::uint64_t> line_starts;
+    // End of the last indexed line; scanning resumes here.
+    std::uint64_t indexed_bytes = 0;
+    // Identity of the indexed file; a transcript replaced by another file starts over.
+    std::uint64_t device = 0;
+    std::uint64_t inode = 0;
+    // This session's place in transcript_index_lru_.
+    std::list<std::string>::iterator lru;
+  };
+
+  // An archived session: its state, and its transcript as one gzip member of a segment.
+  struct ArchiveEntry {
+    SessionState state;
+    std::string segment;
+    std::uint64_t offset = 0;
+    std::uint64_t length = 0;
+  };
+
   [[nodiscard]] common::Status load_state_index();
+  // Re-reads the index when another process replaced it since our last read/write.
+  void refresh_state_index_locked() const;
   [[nodiscard]] common::Status persist_state_index() const;
+  // Same mtime/size check as the state index; the archive index is read on first use.
+  void refresh_archive_index_locked() const;
+  [[nodiscard]] common::Status persist_archive_index() const;
+  // Restores an archived session into the hot index and transcripts/. The caller holds
+  // mutex_ and the file lock; sessions that are not archived are left alone.
+  [[nodiscard]] common::Status rehydrate_locked(const std::string &session_id) const;
+  // For readers holding only mutex_: takes the file lock when there is something to restore.
+  [[nodiscard]] common::Status ensure_hot_locked(const std::string &session_id) const;
   [[nodiscard]] std::filesystem::path transcript_path(const std::string &session_id) const;
+  // Marks the session's index most recently used, evicting the least recently used one
+  // past kMaxTranscriptIndexes. The caller holds transcript_index_mutex_.
+  [[nodiscard]] TranscriptIndex &transcript_index_locked(const std::string &session_id) const;
+  void drop_transcript_index_locked(const std::string &session_id) const;
   [[nodiscard]] common::Result<SessionState> normalize_state(const SessionState &state) const;
 
   std::filesystem::path root_dir_;
   std::filesystem::path state_index_path_;
   std::filesystem::path transcript_dir_;
+  std::filesystem::path lock_path_;
+  std::filesystem::path archive_dir_;
+  std::filesystem::path archive_index_path_;
   mutable std::mutex mutex_;
-  std::unordered_map<std::string, SessionState> states_;
+  mutable std::unordered_map<std::string, SessionState> states_;
+  mutable std::filesystem::file_time_type index_mtime_{};
+  mutable std::uintmax_t index_size_ = 0;
+  mutable std::unordered_map<std::string, ArchiveEntry> archived_;
+  mutable std::filesystem::file_time_type archive_mtime_{};
+  mutable std::uintmax_t archive_size_ = static_cast<std::uintmax_t>(-1);
+  mutable std::mutex transcript_index_mutex_;
+  mutable std::unordered_map<std::string, TranscriptIndex> transcript_indexes_;
+  // Most recently used first.
+  mutable std::list<std::string> transcript_index_lru_;
 };
 
 } // namespace ghostclaw::sessions
@@ -2,6 +2,7 @@
 
 #include "ghostclaw/common/result.hpp"
 
+#include <cstdint>
 #include <optional>
 #include <string>
 #include <unordered_map>
@@ -34,6 +35,8 @@ struct TranscriptEntry {
   std::optional<std::string> model;
   std::optional<InputProvenance> input_provenance;
   std::unordered_map<std::string, std::string> metadata;
+  // 1-based position in the session's transcript. Assigned when loaded, never stored.
+  std::uint64_t id = 0;
 };
 
 [[nodiscard]] std::string encode_transcript_entry_jsonl(const TranscriptEntry &entry);
@@ -19,6 +19,8 @@ public:
 
   [[nodiscard]] bool is_safe() const override;
   [[nodiscard]] std::string_view group() const override;
+  [[nodiscard]] std::optional<ToolCachePolicy> cache_policy(const ToolArgs &args,
+                                                            const ToolContext &ctx) const override;
 
 private:
   std::shared_ptr<security::SecurityPolicy> policy_;
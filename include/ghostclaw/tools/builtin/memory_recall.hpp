@@ -17,6 +17,8 @@ public:
 
   [[nodiscard]] bool is_safe() const override;
   [[nodiscard]] std::string_view group() const override;
+  [[nodiscard]] std::optional<ToolCachePolicy> cache_policy(const ToolArgs &args,
+                                                            const ToolContext &ctx) const override;
 
 private:
   memory::IMemory *memory_;
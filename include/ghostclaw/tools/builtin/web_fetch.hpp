@@ -14,6 +14,8 @@ public:
 
   [[nodiscard]] bool is_safe() const override;
   [[nodiscard]] std::string_view group() const override;
+  [[nodiscard]] std::optional<ToolCachePolicy> cache_policy(const ToolArgs &args,
+                                                            const ToolContext &ctx) const override;
 };
 
 } // namespace ghostclaw::tools
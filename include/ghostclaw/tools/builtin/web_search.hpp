@@ -23,6 +23,8 @@ public:
 
   [[nodiscard]] bool is_safe() const override;
   [[nodiscard]] std::string_view group() const override;
+  [[nodiscard]] std::optional<ToolCachePolicy> cache_policy(const ToolArgs &args,
+                                                            const ToolContext &ctx) const override;
 
 private:
   [[nodiscard]] common::Result<ToolResult> search_brave(const std::string &query);
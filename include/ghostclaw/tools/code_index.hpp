@@ -0,0 +1,109 @@
+#pragma once
+
+#include "ghostclaw/common/result.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ghostclaw::tools {
+
+struct CodeQuery {
+  std::string pattern;
+  bool regex = false;
+  bool case_sensitive = true;
+  // Only files under this workspace-relative directory.
+  std::string path_prefix{};
+  std::size_t max_results = 50;
+};
+
+struct CodeMatch {
+  std::string path;
+  std::size_t line = 0;
+  std::string text;
+};
+
+struct CodeSearchResult {
+  std::vector<CodeMatch> matches;
+  // Files the index could not rule out, and how many of those were read.
+  std::size_t candidates = 0;
+  std::size_t files_scanned = 0;
+  // Lines too long for a regex search (minified or generated code); literal queries
+  // still match them.
+  std::size_t long_lines_skipped = 0;
+  bool truncated = false;
+};
+
+// Trigram index over a workspace's text files, kept under
+// <workspace>/.ghostclaw/code-index. Each file's set of (lowercased) trigrams is stored;
+// a query's required trigrams narrow the search to the files that contain all of them,
+// and only those are read and matched line by line. Files are found with
+// memory::walk_workspace, so .gitignore applies, and are re-indexed only when their size
+// or mtime changes. A refresh touches only the postings of changed files and appends
+// them to a journal next to the snapshot; the snapshot is rewritten once the journal
+// outgrows it.
+class CodeIndex {
+public:
+  CodeIndex(std::filesystem::path workspace, std::filesystem::path index_path);
+
+  // One index per workspace for the whole process, loaded from disk on first use.
+  [[nodiscard]] static std::shared_ptr<CodeIndex> for_workspace(const std::filesystem::path &workspace);
+  [[nodiscard]] static std::filesystem::path default_path(const std::filesystem::path &workspace);
+
+  // Brings the index up to date with the workspace and saves it if anything changed.
+  [[nodiscard]] common::Status refresh();
+  // Runs the query, refreshing first unless the last rescan was under a second ago, so a
+  // burst of searches walks the workspace once. Candidate files are read and matched
+  // without holding the index lock.
+  [[nodiscard]] common::Result<CodeSearchResult> search(const CodeQuery &query);
+
+  [[nodiscard]] std::size_t file_count() const;
+
+private:
+  struct IndexedFile {
+    std::string path;
+    std::uint64_t size = 0;
+    std::int64_t mtime = 0;
+    // Sorted; empty for files skipped as binary or too large.
+    std::vector<std::uint32_t> trigrams;
+    bool searchable = false;
+  };
+
+  [[nodiscard]] common::Status refresh_locked();
+  void load_locked();
+  [[nodiscard]] common::Status save_locked();
+  [[nodiscard]] common::Status persist_locked(const std::vector<std::uint32_t> &updated,
+                                              const std::vector<std::string> &removed);
+  [[nodiscard]] std::filesystem::path journal_path() const;
+  void rebuild_postings_locked();
+  void add_postings_locked(std::uint32_t id);
+  void remove_postings_locked(std::uint32_t id);
+  [[nodiscard]] std::vector<std::uint32_t> candidates_locked(const CodeQuery &query) const;
+
+  std::filesystem::path workspace_;
+  std::filesystem::path index_path_;
+  mutable std::mutex mutex_;
+  bool loaded_ = false;
+  std::chrono::steady_clock::time_point last_scan_;
+  // Removed files leave an empty slot (no path, not searchable) so other ids stay put;
+  // new files reuse the slots in free_ids_.
+  std::vector<IndexedFile> files_;
+  std::unordered_map<std::string, std::uint32_t> ids_by_path_;
+  std::vector<std::uint32_t> free_ids_;
+  // trigram -> indexes into files_, ascending.
+  std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> postings_;
+  // Records appended to the journal since the snapshot was written.
+  std::size_t journal_records_ = 0;
+  bool journal_damaged_ = false;
+};
+
+// Trigrams every match of `pattern` must contain, lowercased. Empty when the pattern
+// cannot be narrowed (short literals, alternation, ...) and every file is a candidate.
+[[nodiscard]] std::vector<std::uint32_t> required_trigrams(const std::string &pattern, bool regex);
+
+} // namespace ghostclaw::tools
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "ghostclaw/common/result.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+namespace ghostclaw::tools {
+
+// Read-only mapping of a whole file. Pages are faulted in only when touched, so reading
+// a range of a large file costs the range, not the file. The descriptor stays open for
+// the lifetime of the view so callers can hand it to copy_file_range.
+class FileView {
+public:
+  [[nodiscard]] static common::Result<FileView> open(const std::filesystem::path &path);
+  // Takes ownership of `fd`, e.g. one opened through security::WorkspaceRoot.
+  [[nodiscard]] static common::Result<FileView> adopt(int fd, const std::filesystem::path &path);
+
+  FileView() = default;
+  FileView(FileView &&other) noexcept;
+  FileView &operator=(FileView &&other) noexcept;
+  FileView(const FileView &) = delete;
+  FileView &operator=(const FileView &) = delete;
+  ~FileView();
+
+  [[nodiscard]] std::string_view data() const { return {data_, size_}; }
+  [[nodiscard]] std::size_t size() const { return size_; }
+  [[nodiscard]] int fd() const { return fd_; }
+  [[nodiscard]] std::uint32_t mode() const { return mode_; }
+  [[nodiscard]] std::int64_t mtime_ns() const { return mtime_ns_; }
+  [[nodiscard]] const std::filesystem::path &path() const { return path_; }
+
+private:
+  void reset();
+
+  std::filesystem::path path_;
+  const char *data_ = nullptr;
+  std::size_t size_ = 0;
+  int fd_ = -1;
+  std::uint32_t mode_ = 0;
+  std::int64_t mtime_ns_ = 0;
+};
+
+struct LineSpan {
+  std::size_t begin = 0;
+  std::size_t end = 0;
+  // 1-based number of the line at `begin`; 0 when not known (tail reads).
+  std::size_t first_line = 0;
+};
+
+// Byte range of `count` lines starting at 1-based `first_line` (count 0 means to the end
+// of the file). Every 1024th line start is cached per path, size and mtime, so repeated
+// reads of a large file only scan from the nearest checkpoint.
+[[nodiscard]] LineSpan locate_lines(const FileView &file, std::size_t first_line,
+                                    std::size_t count);
+
+// Byte range of the last `count` lines, found by scanning backwards from the end.
+[[nodiscard]] LineSpan tail_lines(const FileView &file, std::size_t count);
+
+} // namespace ghostclaw::tools
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "ghostclaw/common/result.hpp"
+
+#include <filesystem>
+#include <string>
+
+namespace ghostclaw::tools {
+
+struct StoredOutput {
+  std::string handle;
+  std::size_t bytes = 0;
+  std::size_t lines = 0;
+};
+
+// Full tool outputs kept on disk per session so prompts can carry a preview and a
+// handle instead of the whole text. Each session keeps its newest `max_per_session`
+// outputs.
+class ToolOutputStore {
+public:
+  explicit ToolOutputStore(std::filesystem::path root, std::size_t max_per_session = 64);
+
+  // <workspace>/.ghostclaw/tool-outputs, shared by the agent and the tool_output tool.
+  [[nodiscard]] static std::filesystem::path default_root(const std::filesystem::path &workspace);
+
+  [[nodiscard]] common::Result<StoredOutput> put(const std::string &session_id,
+                                                 const std::string &content);
+  [[nodiscard]] common::Result<std::string> get(const std::string &session_id,
+                                                const std::string &handle) const;
+
+private:
+  [[nodiscard]] std::filesystem::path session_dir(const std::string &session_id) const;
+  void prune(const std::filesystem::path &dir) const;
+
+  std::filesystem::path root_;
+  std::size_t max_per_session_;
+};
+
+// Head and tail of `output` within about `preview_bytes`, followed by the handle and
+// how to read the rest with tool_output.
+[[nodiscard]] std::string spill_preview(const std::string &output, const StoredOutput &stored,
+                                        std::size_t preview_bytes);
+
+} // namespace ghostclaw::tools
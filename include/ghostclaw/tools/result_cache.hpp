@@ -0,0 +1,65 @@
+#pragma once
+
+#include "ghostclaw/tools/tool.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace ghostclaw::tools {
+
+struct ToolResultCacheStats {
+  std::uint64_t hits = 0;
+  std::uint64_t misses = 0;
+  std::size_t entries = 0;
+  std::size_t bytes = 0;
+};
+
+// Results of cacheable tool calls (see ITool::cache_policy), shared by every executor in
+// the process. Bounded by entry count and by the total size of stored outputs; the least
+// recently used entries go first. An entry is reused only while its policy's version is
+// unchanged and its TTL has not run out.
+class ToolResultCache {
+public:
+  explicit ToolResultCache(std::size_t max_entries = 256, std::size_t max_bytes = 8 * 1024 * 1024);
+
+  [[nodiscard]] static std::shared_ptr<ToolResultCache> shared();
+
+  [[nodiscard]] std::optional<ToolResult> lookup(const std::string &tool,
+                                                 const ToolCachePolicy &policy);
+  void store(const std::string &tool, const ToolCachePolicy &policy, const ToolResult &result);
+  void clear();
+
+  [[nodiscard]] ToolResultCacheStats stats() const;
+
+private:
+  struct Entry {
+    std::string key;
+    std::string version;
+    std::chrono::steady_clock::time_point expires;
+    ToolResult result;
+    std::size_t bytes = 0;
+  };
+
+  void evict_locked();
+
+  std::size_t max_entries_;
+  std::size_t max_bytes_;
+  mutable std::mutex mutex_;
+  // Most recently used first.
+  std::list<Entry> entries_;
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+  std::size_t bytes_ = 0;
+  std::uint64_t hits_ = 0;
+  std::uint64_t misses_ = 0;
+};
+
+// Stable "name=value" encoding of a call's arguments, for building cache keys.
+[[nodiscard]] std::string canonical_args(const ToolArgs &args);
+
+} // namespace ghostclaw::tools
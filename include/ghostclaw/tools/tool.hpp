@@ -1,9 +1,14 @@
 #pragma once
 
+#include "ghostclaw/common/cancel.hpp"
 #include "ghostclaw/common/result.hpp"
 
+#include <chrono>
 #include <cstdint>
 #include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -20,12 +25,27 @@ struct ToolResult {
   std::unordered_map<std::string, std::string> metadata;
 };
 
+// Output a tool produced while still running, e.g. a shell command's lines as they appear.
+struct ToolOutputChunk {
+  // Filled in by agent::ToolExecutor.
+  std::string call_id;
+  std::string tool;
+  // "stdout" or "stderr".
+  std::string stream;
+  std::string text;
+  // Lines dropped by rate limiting since the previous chunk of this stream.
+  std::size_t skipped_lines = 0;
+};
+
 struct ToolSpec {
   std::string name;
   std::string description;
   std::string parameters_json;
   bool safe = false;
   std::string group;
+  // OpenAI-style {"type":"function",...} entry, filled in by ToolCatalog so providers
+  // can splice it into the request body instead of re-escaping every turn.
+  std::string function_json{};
 };
 
 struct ToolContext {
@@ -38,6 +58,21 @@ struct ToolContext {
   std::string channel_id;
   std::string group_id;
   bool sandbox_enabled = true;
+  // Set for agent turns; long-running tools abort when it fires.
+  std::shared_ptr<common::CancelToken> cancel_token;
+  // Set when someone is watching the turn live. Called from tool threads.
+  std::function<void(const ToolOutputChunk &)> on_output;
+  // Calls that need a human decision come back unexecuted and marked as awaiting approval
+  // (see agent::ToolExecutor) instead of blocking on the approval socket.
+  bool park_approvals = false;
+};
+
+// How a call's result may be reused by agent::ToolExecutor. Two calls share a result when
+// their keys match; it is recomputed once the version changes or the TTL (0 = none) ends.
+struct ToolCachePolicy {
+  std::string key;
+  std::string version;
+  std::chrono::milliseconds ttl{0};
 };
 
 class ITool {
@@ -53,6 +88,11 @@ public:
   [[nodiscard]] virtual bool is_safe() const = 0;
   [[nodiscard]] virtual std::uint32_t timeout_ms() const { return 60'000; }
   [[nodiscard]] virtual std::string_view group() const = 0;
+  // Only idempotent tools return a policy; nullopt means always execute.
+  [[nodiscard]] virtual std::optional<ToolCachePolicy> cache_policy(const ToolArgs &,
+                                                                    const ToolContext &) const {
+    return std::nullopt;
+  }
 
   [[nodiscard]] ToolSpec spec() const;
 };
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "ghostclaw/tools/tool_registry.hpp"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace ghostclaw::tools {
+
+[[nodiscard]] std::string serialize_function_spec(const ToolSpec &spec);
+
+struct ToolSelectionRequest {
+  std::string message;
+  // Memory and skill context for the turn; only tool names mentioned here count.
+  std::string context;
+  std::vector<std::string> recent_tools;
+  // Tools rejected here are never offered, e.g. those the tool policy would block.
+  std::function<bool(const ToolSpec &)> allow;
+  // 0 means no limit.
+  std::size_t max_tools = 0;
+};
+
+// Snapshot of a registry's tool specs with their provider JSON serialised once, plus
+// keyword terms used to pick the tools worth sending on a given turn.
+class ToolCatalog {
+public:
+  ToolCatalog() = default;
+  ToolCatalog(const ToolRegistry &registry, std::vector<std::string> core_tools);
+
+  [[nodiscard]] const std::vector<ToolSpec> &specs() const { return specs_; }
+  [[nodiscard]] std::size_t size() const { return specs_.size(); }
+
+  // Core tools first, then the best-scoring rest up to max_tools. When every allowed
+  // tool fits, all of them are returned. Results keep registry order so an unchanged
+  // selection serialises to the same request prefix.
+  [[nodiscard]] std::vector<ToolSpec> select(const ToolSelectionRequest &request) const;
+
+private:
+  struct Entry {
+    std::vector<std::string> name_forms;
+    std::vector<std::string> terms;
+    std::string group;
+    bool core = false;
+  };
+
+  std::vector<ToolSpec> specs_;
+  std::vector<Entry> entries_;
+};
+
+} // namespace ghostclaw::tools
@@ -0,0 +1,317 @@
+#include "ghostclaw/agent/continuation.hpp"
+
+#include "ghostclaw/common/fs.hpp"
+#include "ghostclaw/common/json_util.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+namespace ghostclaw::agent {
+
+namespace {
+
+constexpr std::string_view kSuffix = ".json";
+constexpr std::string_view kClaimedSuffix = ".claimed";
+
+std::string quoted(const std::string &value) { return "\"" + common::json_escape(value) + "\""; }
+
+std::size_t to_size(const std::string &value, const std::size_t fallback) {
+  try {
+    return value.empty() ? fallback : static_cast<std::size_t>(std::stoull(value));
+  } catch (...) {
+    return fallback;
+  }
+}
+
+std::string args_to_json(const tools::ToolArgs &args) {
+  std::vector<std::pair<std::string, std::string>> sorted(args.begin(), args.end());
+  std::sort(sorted.begin(), sorted.end());
+  std::string out = "{";
+  for (const auto &[name, value] : sorted) {
+    if (out.size() > 1) {
+      out += ',';
+    }
+    out += quoted(name) + ":" + quoted(value);
+  }
+  return out + "}";
+}
+
+// Scalars are written before nested values: the json_util lookups take the first match.
+std::string result_to_json(const ToolCallResult &result) {
+  std::ostringstream out;
+  out << "{\"id\":" << quoted(result.id) << ",\"name\":" << quoted(result.name)
+      << ",\"success\":" << (result.result.success ? "true" : "false")
+      << ",\"truncated\":" << (result.result.truncated ? "true" : "false")
+      << ",\"awaiting_approval\":" << (result.awaiting_approval ? "true" : "false")
+      << ",\"duration_ms\":" << result.duration.count()
+      << ",\"output\":" << quoted(result.result.output)
+      << ",\"metadata\":" << args_to_json(result.result.metadata) << "}";
+  return out.str();
+}
+
+ToolCallResult result_from_json(const std::string &json) {
+  ToolCallResult result;
+  result.id = common::json_get_string(json, "id");
+  result.name = common::json_get_string(json, "name");
+  result.result.success = common::json_get_number(json, "success") == "true";
+  result.result.truncated = common::json_get_number(json, "truncated") == "true";
+  result.awaiting_approval = common::json_get_number(json, "awaiting_approval") == "true";
+  result.duration = std::chrono::milliseconds(to_size(common::json_get_number(json, "duration_ms"), 0));
+  result.result.output = common::json_get_string(json, "output");
+  for (auto &[key, value] : common::json_parse_flat(common::json_get_object(json, "metadata"))) {
+    result.result.metadata[key] = std::move(value);
+  }
+  return result;
+}
+
+std::string request_to_json(const ToolCallRequest &request) {
+  return "{\"id\":" + quoted(request.id) + ",\"name\":" + quoted(request.name) +
+         ",\"arguments\":" + args_to_json(request.arguments) + "}";
+}
+
+ToolCallRequest request_from_json(const std::string &json) {
+  ToolCallRequest request;
+  request.id = common::json_get_string(json, "id");
+  request.name = common::json_get_string(json, "name");
+  for (auto &[key, value] : common::json_parse_flat(common::json_get_object(json, "arguments"))) {
+    request.arguments[key] = std::move(value);
+  }
+  return request;
+}
+
+std::string new_turn_id() {
+  static std::atomic<std::uint32_t> sequence{0};
+  thread_local std::mt19937 rng{std::random_device{}()};
+  std::ostringstream out;
+  out << "ap" << std::hex << (rng() & 0xffffffU) << (sequence.fetch_add(1) & 0xfffU);
+  return out.str();
+}
+
+bool valid_id(const std::string &id) {
+  return !id.empty() && id.size() <= 64 &&
+         std::all_of(id.begin(), id.end(), [](const char ch) {
+           return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') ||
+                  ch == '-' || ch == '_';
+         });
+}
+
+} // namespace
+
+std::string parked_turn_to_json(const ParkedTurn &turn) {
+  std::ostringstream out;
+  out << "{\"id\":" << quoted(turn.id) << ",\"session_id\":" << quoted(turn.session_id)
+      << ",\"agent_id\":" << quoted(turn.agent_id) << ",\"channel_id\":" << quoted(turn.channel_id)
+      << ",\"group_id\":" << quoted(turn.group_id) << ",\"tool_profile\":" << quoted(turn.tool_profile)
+      << ",\"model\":" << quoted(turn.model) << ",\"temperature\":" << quoted(std::to_string(turn.temperature))
+      << ",\"iteration\":" << turn.iteration << ",\"max_tool_iterations\":" << turn.max_tool_iterations
+      << ",\"batch_start\":" << turn.batch_start << ",\"command\":" << quoted(turn.command)
+      << ",\"created_at\":" << quoted(turn.created_at) << ",\"message\":" << quoted(turn.message)
+      << ",\"system_prompt\":" << quoted(turn.system_prompt)
+      << ",\"memory_context\":" << quoted(turn.memory_context)
+      << ",\"current_prompt\":" << quoted(turn.current_prompt) << ",\"pending\":[";
+  for (std::size_t i = 0; i < turn.pending.size(); ++i) {
+    out << (i == 0 ? "" : ",") << request_to_json(turn.pending[i]);
+  }
+  out << "],\"completed\":[";
+  for (std::size_t i = 0; i < turn.completed.size(); ++i) {
+    out << (i == 0 ? "" : ",") << result_to_json(turn.completed[i]);
+  }
+  out << "]}";
+  return out.str();
+}
+
+common::Result<ParkedTurn> parked_turn_from_json(const std::string &json) {
+  ParkedTurn turn;
+  turn.id = common::json_get_string(json, "id");
+  if (turn.id.empty()) {
+    return common::Result<ParkedTurn>::failure("parked turn without id");
+  }
+  turn.session_id = common::json_get_string(json, "session_id");
+  turn.agent_id = common::json_get_string(json, "agent_id");
+  turn.channel_id = common::json_get_string(json, "channel_id");
+  turn.group_id = common::json_get_string(json, "group_id");
+  turn.tool_profile = common::json_get_string(json, "tool_profile");
+  turn.model = common::json_get_string(json, "model");
+  try {
+    turn.temperature = std::stod(common::json_get_string(json, "temperature"));
+  } catch (...) {
+  }
+  turn.iteration = to_size(common::json_get_number(json, "iteration"), 0);
+  turn.max_tool_iterations = to_size(common::json_get_number(json, "max_tool_iterations"), 10);
+  turn.batch_start = to_size(common::json_get_number(json, "batch_start"), 0);
+  turn.command = common::json_get_string(json, "command");
+  turn.created_at = common::json_get_string(json, "created_at");
+  turn.message = common::json_get_string(json, "message");
+  turn.system_prompt = common::json_get_string(json, "system_prompt");
+  turn.memory_context = common::json_get_string(json, "memory_context");
+  turn.current_prompt = common::json_get_string(json, "current_prompt");
+  for (const auto &object : common::json_split_top_level_objects(common::json_get_array(json, "pending"))) {
+    turn.pending.push_back(request_from_json(object));
+  }
+  for (const auto &object :
+       common::json_split_top_level_objects(common::json_get_array(json, "completed"))) {
+    turn.completed.push_back(result_from_json(object));
+  }
+  turn.batch_start = std::min(turn.batch_start, turn.completed.size());
+  return common::Result<ParkedTurn>::success(std::move(turn));
+}
+
+std::optional<ApprovalReply> parse_approval_reply(const std::string &text) {
+  std::istringstream in(common::trim(text));
+  std::string verb;
+  std::string id;
+  std::string extra;
+  if (!(in >> verb >> id) || (in >> extra) || !valid_id(id)) {
+    return std::nullopt;
+  }
+  verb = common::to_lower(verb.substr(0, verb.find('@')));
+  if (verb == "/approve") {
+    return ApprovalReply{.id = id, .decision = security::ApprovalDecision::AllowOnce};
+  }
+  if (verb == "/approve-always") {
+    return ApprovalReply{.id = id, .decision = security::ApprovalDecision::AllowAlways};
+  }
+  if (verb == "/deny") {
+    return ApprovalReply{.id = id, .decision = security::ApprovalDecision::Deny};
+  }
+  return std::nullopt;
+}
+
+ContinuationStore::ContinuationStore(std::filesystem::path root, const std::chrono::seconds ttl)
+    : root_(std::move(root)), ttl_(ttl) {}
+
+std::filesystem::path ContinuationStore::default_root(const std::filesystem::path &workspace) {
+  return workspace / ".ghostclaw" / "parked-turns";
+}
+
+std::filesystem::path ContinuationStore::path_for(const std::string &id) const {
+  return root_ / (id + std::string(kSuffix));
+}
+
+std::filesystem::path ContinuationStore::claimed_path_for(const std::string &id) const {
+  return root_ / (id + std::string(kClaimedSuffix));
+}
+
+bool ContinuationStore::expired(const std::filesystem::path &path) const {
+  std::error_code ec;
+  const auto written = std::filesystem::last_write_time(path, ec);
+  return !ec && std::filesystem::file_time_type::clock::now() - written > ttl_;
+}
+
+common::Result<std::string> ContinuationStore::park(ParkedTurn turn) {
+  if (turn.id.empty()) {
+    turn.id = new_turn_id();
+  }
+  if (!valid_id(turn.id)) {
+    return common::Result<std::string>::failure("invalid parked turn id: " + turn.id);
+  }
+  (void)sweep();
+  std::error_code ec;
+  std::filesystem::create_directories(root_, ec);
+  if (ec) {
+    return common::Result<std::string>::failure("failed to create " + root_.string() + ": " +
+                                                ec.message());
+  }
+  const auto target = path_for(turn.id);
+  const auto temp = root_ / (turn.id + ".tmp");
+  {
+    std::ofstream out(temp, std::ios::trunc);
+    out << parked_turn_to_json(turn);
+    if (!out) {
+      return common::Result<std::string>::failure("failed to write parked turn");
+    }
+  }
+  std::filesystem::rename(temp, target, ec);
+  if (ec) {
+    std::filesystem::remove(temp, ec);
+    return common::Result<std::string>::failure("failed to store parked turn");
+  }
+  return common::Result<std::string>::success(turn.id);
+}
+
+common::Result<ParkedTurn> ContinuationStore::take(const std::string &id) {
+  if (!valid_id(id)) {
+    return common::Result<ParkedTurn>::failure("unknown approval id: " + id);
+  }
+  // rename() succeeds for exactly one caller; the rest see the file gone.
+  const auto claimed = claimed_path_for(id);
+  std::error_code ec;
+  std::filesystem::rename(path_for(id), claimed, ec);
+  if (ec) {
+    return common::Result<ParkedTurn>::failure("unknown approval id: " + id);
+  }
+  if (expired(claimed)) {
+    std::filesystem::remove(claimed, ec);
+    return common::Result<ParkedTurn>::failure("approval expired: " + id);
+  }
+  std::ifstream in(claimed);
+  std::stringstream buffer;
+  buffer << in.rdbuf();
+  in.close();
+  auto turn = parked_turn_from_json(buffer.str());
+  if (!turn.ok()) {
+    std::filesystem::remove(claimed, ec);
+  }
+  return turn;
+}
+
+void ContinuationStore::finish(const std::string &id) {
+  if (!valid_id(id)) {
+    return;
+  }
+  std::error_code ec;
+  std::filesystem::remove(claimed_path_for(id), ec);
+}
+
+void ContinuationStore::release(const std::string &id) {
+  if (!valid_id(id)) {
+    return;
+  }
+  std::error_code ec;
+  std::filesystem::rename(claimed_path_for(id), path_for(id), ec);
+}
+
+std::size_t ContinuationStore::sweep() {
+  std::vector<std::filesystem::path> stale;
+  std::error_code ec;
+  for (const auto &entry : std::filesystem::directory_iterator(root_, ec)) {
+    if (entry.is_regular_file(ec) && expired(entry.path())) {
+      stale.push_back(entry.path());
+    }
+  }
+  std::size_t removed = 0;
+  for (const auto &path : stale) {
+    if (std::filesystem::remove(path, ec)) {
+      ++removed;
+    }
+  }
+  return removed;
+}
+
+std::vector<ParkedTurn> ContinuationStore::list(const std::optional<std::string> &session_id) const {
+  std::vector<ParkedTurn> turns;
+  std::error_code ec;
+  for (const auto &entry : std::filesystem::directory_iterator(root_, ec)) {
+    if (entry.path().extension() != kSuffix) {
+      continue;
+    }
+    std::ifstream in(entry.path());
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    auto parsed = parked_turn_from_json(buffer.str());
+    if (!parsed.ok() || (session_id.has_value() && parsed.value().session_id != *session_id)) {
+      continue;
+    }
+    turns.push_back(std::move(parsed.value()));
+  }
+  std::sort(turns.begin(), turns.end(), [](const ParkedTurn &lhs, const ParkedTurn &rhs) {
+    return lhs.created_at < rhs.created_at;
+  });
+  return turns;
+}
+
+} // namespace ghostclaw::agent
@@ -2,6 +2,7 @@
 
 #include "ghostclaw/agent/stream_parser.hpp"
 #include "ghostclaw/common/fs.hpp"
+#include "ghostclaw/nodes/scheduler.hpp"
 #include "ghostclaw/observability/global.hpp"
 #include "ghostclaw/sandbox/sandbox.hpp"
 #include "ghostclaw/security/approval.hpp"
@@ -9,9 +10,12 @@
 #include "ghostclaw/security/tool_policy.hpp"
 #include "ghostclaw/skills/compat.hpp"
 #include "ghostclaw/skills/registry.hpp"
+#include "ghostclaw/tools/result_cache.hpp"
 
+#include <algorithm>
 #include <ctime>
 #include <iomanip>
+#include <iterator>
 #include <fstream>
 #include <iostream>
 #include <regex>
@@ -35,6 +39,19 @@ security::ExternalSource source_for_tool(const std::string_view name) {
   return security::ExternalSource::Unknown;
 }
 
+security::ToolPolicyRequest tool_policy_request(const tools::ToolContext &ctx) {
+  security::ToolPolicyRequest policy_request;
+  policy_request.provider = ctx.provider;
+  policy_request.agent_id = ctx.agent_id;
+  policy_request.channel_id = ctx.channel_id;
+  policy_request.group_id = ctx.group_id;
+  if (const auto profile = security::ToolPolicyPipeline::profile_from_string(ctx.tool_profile);
+      profile.ok()) {
+    policy_request.profile = profile.value();
+  }
+  return policy_request;
+}
+
 bool should_wrap_tool_output(const std::string_view name) {
   const std::string normalized = common::to_lower(std::string(name));
   return normalized == "web_search" || normalized == "web_fetch" || normalized == "browser";
@@ -87,6 +104,30 @@ std::vector<std::string> build_interactive_skill_prompts(const std::vector<skill
   return prompts;
 }
 
+Usage usage_from_capture(const providers::ScopedUsageCapture &capture) {
+  const auto &captured = capture.usage();
+  Usage usage;
+  usage.prompt_tokens = static_cast<std::size_t>(captured.prompt_tokens);
+  usage.completion_tokens = static_cast<std::size_t>(captured.completion_tokens);
+  usage.total_tokens = static_cast<std::size_t>(captured.total_tokens());
+  usage.cached_prompt_tokens = static_cast<std::size_t>(captured.cached_prompt_tokens);
+  return usage;
+}
+
+void record_turn_end(const AgentResponse &response) {
+  if (response.usage.total_tokens == 0) {
+    observability::record_agent_end(response.duration);
+    return;
+  }
+  observability::record_metric(observability::TokensUsedMetric{
+      .tokens = response.usage.total_tokens,
+      .prompt_tokens = response.usage.prompt_tokens,
+      .completion_tokens = response.usage.completion_tokens,
+      .cached_prompt_tokens = response.usage.cached_prompt_tokens});
+  observability::record_agent_end(response.duration,
+                                  static_cast<std::uint64_t>(response.usage.total_tokens));
+}
+
 } // namespace
 
 AgentEngine::AgentEngine(const config::Config &config, std::shared_ptr<providers::Provider> provider,
@@ -94,9 +135,21 @@ AgentEngine::AgentEngine(const config::Config &config, std::shared_ptr<providers
                          std::filesystem::path workspace,
                          std::vector<std::string> skill_instructions)
     : config_(config), provider_(std::move(provider)), memory_(std::move(memory)),
-      tools_(std::move(tools)), tool_executor_(tools_), context_builder_(workspace, config.identity),
-      workspace_(std::move(workspace)), skill_instructions_(std::move(skill_instructions)) {
-  auto tool_policy = std::make_shared<security::ToolPolicyPipeline>();
+      tools_(std::move(tools)), tool_catalog_(tools_, config.tools.core), tool_executor_(tools_),
+      continuations_(ContinuationStore::default_root(workspace),
+                     std::chrono::seconds(config.autonomy.approval_ttl_secs)),
+      context_builder_(workspace, config.identity),
+      workspace_(std::move(workspace)),
+      output_store_(tools::ToolOutputStore::default_root(workspace_)),
+      skill_instructions_(std::move(skill_instructions)) {
+  if (config_.memory.auto_save && memory_ != nullptr) {
+    // Conversation auto-saves are written behind the response; see WriteBehindMemory.
+    auto write_behind = std::make_unique<memory::WriteBehindMemory>(std::move(memory_));
+    auto_save_ = write_behind.get();
+    memory_ = std::move(write_behind);
+  }
+
+  tool_policy_ = std::make_shared<security::ToolPolicyPipeline>();
   if (!config_.tools.allow.groups.empty() || !config_.tools.allow.tools.empty() ||
       !config_.tools.allow.deny.empty()) {
     security::ToolPolicy policy;
@@ -108,9 +161,9 @@ AgentEngine::AgentEngine(const config::Config &config, std::shared_ptr<providers
       policy.allow.push_back(tool);
     }
     policy.deny = config_.tools.allow.deny;
-    tool_policy->set_global_policy(std::move(policy));
+    tool_policy_->set_global_policy(std::move(policy));
   }
-  tool_executor_.set_tool_policy_pipeline(tool_policy);
+  tool_executor_.set_tool_policy_pipeline(tool_policy_);
 
   sandbox::SandboxConfig sandbox_config;
   sandbox_config.mode = sandbox::SandboxConfig::Mode::Off;
@@ -120,8 +173,48 @@ AgentEngine::AgentEngine(const config::Config &config, std::shared_ptr<providers
   security::ApprovalPolicy approval_policy;
   approval_policy.security = security::ExecSecurity::Full;
   approval_policy.ask = security::ExecAsk::Off;
-  auto approval_manager = std::make_shared<security::ApprovalManager>(approval_policy);
-  tool_executor_.set_approval_manager(approval_manager);
+  if (auto security = security::exec_security_from_string(config_.autonomy.approval_security);
+      security.ok()) {
+    approval_policy.security = security.value();
+  }
+  if (auto ask = security::exec_ask_from_string(config_.autonomy.approval_ask); ask.ok()) {
+    approval_policy.ask = ask.value();
+  }
+  approval_policy.allowlist = config_.autonomy.approval_allowlist;
+  approval_ = std::make_shared<security::ApprovalManager>(approval_policy);
+  tool_executor_.set_approval_manager(approval_);
+  if (config_.tools.result_cache) {
+    tool_executor_.set_result_cache(tools::ToolResultCache::shared());
+  }
+
+  if (!config_.nodes.offload_tools.empty() && !config_.nodes.remotes.empty()) {
+    auto node_registry = std::make_shared<nodes::NodeRegistry>();
+    for (const auto &remote : config_.nodes.remotes) {
+      if (!remote.enabled) {
+        continue;
+      }
+      (void)node_registry->advertise(nodes::NodeDescriptor{.node_id = remote.id,
+                                                           .display_name = remote.id,
+                                                           .endpoint = remote.endpoint,
+                                                           .capabilities = remote.capabilities,
+                                                           .paired = true,
+                                                           .connected = true,
+                                                           .pair_token = remote.token,
+                                                           .updated_at = {}});
+    }
+    nodes::NodeSchedulerOptions scheduler_options;
+    scheduler_options.max_in_flight_per_node =
+        std::max<std::size_t>(1, config_.nodes.max_in_flight_per_node);
+    scheduler_options.local_fallback = config_.nodes.local_fallback;
+    auto scheduler = std::make_shared<nodes::NodeScheduler>(std::move(node_registry), nullptr,
+                                                            nullptr, scheduler_options);
+    for (const auto &tool_name : config_.nodes.offload_tools) {
+      if (const auto action = nodes::default_offload_action(tool_name); action.has_value()) {
+        scheduler->set_tool_action(tool_name, *action);
+      }
+    }
+    tool_executor_.set_node_scheduler(std::move(scheduler));
+  }
 
   const auto skill_catalog = load_skill_catalog(workspace_);
   skill_index_entries_ = build_skill_index_entries(skill_catalog);
@@ -136,7 +229,7 @@ AgentEngine::AgentEngine(const config::Config &config, std::shared_ptr<providers
 }
 
 std::string AgentEngine::build_system_prompt() {
-  return context_builder_.build_system_prompt(tools_.all_specs(), skill_index_entries_);
+  return context_builder_.build_system_prompt(tool_catalog_.specs(), skill_index_entries_);
 }
 
 std::string AgentEngine::build_memory_context(const std::string &message) {
@@ -165,6 +258,95 @@ std::string AgentEngine::build_memory_context(const std::string &message) {
   return out.str();
 }
 
+void AgentEngine::set_model_router(std::shared_ptr<providers::ModelRouter> router) {
+  router_ = std::move(router);
+}
+
+std::optional<providers::RouterStats> AgentEngine::router_stats() const {
+  if (router_ == nullptr) {
+    return std::nullopt;
+  }
+  return router_->stats();
+}
+
+common::Result<std::string> AgentEngine::summarize_history(const std::string &previous_summary,
+                                                           const std::string &new_messages,
+                                                           const std::size_t token_budget) {
+  std::ostringstream system;
+  system << "You maintain a running summary of a conversation. Merge the new messages into "
+            "the existing summary. Keep facts, decisions, open questions and user preferences; "
+            "drop pleasantries. Reply with the updated summary only, in at most "
+         << token_budget * 3 / 4 << " words.";
+  std::ostringstream message;
+  message << "Existing summary:\n"
+          << (previous_summary.empty() ? std::string("(none)") : previous_summary)
+          << "\n\nNew messages:\n"
+          << new_messages;
+  // Summaries are upkeep; they should not hold up a turn that is waiting on the provider.
+  providers::ScopedRequestClass request_class(providers::RequestPriority::Background, "");
+  return provider_->chat_with_system(system.str(), message.str(), config_.default_model, 0.2);
+}
+
+void AgentEngine::start_provider_warmup() {
+  if (warmup_started_.exchange(true)) {
+    return;
+  }
+  // Runs once per engine and is never awaited: the first provider call should not wait
+  // on a HEAD request that only primes DNS and TLS state.
+  warmup_future_ = std::async(std::launch::async, [provider = provider_]() {
+    (void)provider->warmup();
+  });
+}
+
+AgentEngine::TurnPreparation AgentEngine::prepare_turn(const std::string &message,
+                                                       const AgentOptions &options) {
+  start_provider_warmup();
+
+  // Memory recall may need an embedding round-trip and skill search walks the skill
+  // directories; overlap both with the prompt build so the turn waits on the slowest.
+  // The workers re-install the caller's cancel token and request class, and hand their
+  // usage back so it is reported against this turn.
+  const auto cancel_token = common::current_cancel_token();
+  const auto priority = providers::current_request_priority();
+  const auto session = providers::current_request_session();
+  const auto in_turn_scope = [&cancel_token, priority, &session](auto work) {
+    return [&cancel_token, priority, &session, work = std::move(work)]() {
+      common::ScopedCancelToken cancel_scope(cancel_token);
+      providers::ScopedRequestClass request_class(priority, session);
+      providers::ScopedUsageCapture usage_capture;
+      std::string result = work();
+      return std::make_pair(std::move(result), usage_capture.usage());
+    };
+  };
+  auto memory_context = std::async(
+      std::launch::async, in_turn_scope([this, &message]() { return build_memory_context(message); }));
+  auto skills_context = std::async(std::launch::async, in_turn_scope([this, &message]() {
+                                     return build_relevant_skill_context(message);
+                                   }));
+
+  TurnPreparation prepared;
+  prepared.system_prompt = build_system_prompt();
+  auto [memory, memory_usage] = memory_context.get();
+  providers::report_usage(memory_usage);
+  prepared.context = std::move(memory);
+  auto [skills, skills_usage] = skills_context.get();
+  providers::report_usage(skills_usage);
+  prepared.skills_matched = !skills.empty();
+  if (!skills.empty()) {
+    if (!prepared.context.empty()) {
+      prepared.context += "\n";
+    }
+    prepared.context += skills;
+  }
+  if (!options.history_context.empty()) {
+    if (!prepared.context.empty()) {
+      prepared.context += "\n";
+    }
+    prepared.context += options.history_context;
+  }
+  return prepared;
+}
+
 std::string AgentEngine::build_relevant_skill_context(const std::string &message) const {
   const std::string query = common::trim(message);
   if (query.empty()) {
@@ -233,20 +415,152 @@ bool AgentEngine::detect_prompt_leak(const std::string &output) const {
          lower.find("you are ghostclaw") != std::string::npos;
 }
 
+std::vector<tools::ToolSpec> AgentEngine::select_tools(const std::string &message,
+                                                       const std::string &context,
+                                                       const tools::ToolContext &ctx) const {
+  tools::ToolSelectionRequest request;
+  request.message = message;
+  request.context = context;
+  request.max_tools = config_.tools.max_per_turn;
+  {
+    std::lock_guard<std::mutex> lock(recent_tools_mutex_);
+    if (const auto it = recent_tools_.find(ctx.session_id); it != recent_tools_.end()) {
+      request.recent_tools = it->second;
+    }
+  }
+
+  const auto policy_request = tool_policy_request(ctx);
+  // Tools the executor would refuse are not worth their schema tokens.
+  request.allow = [this, &policy_request](const tools::ToolSpec &spec) {
+    return tool_policy_->evaluate_tool(spec.name, policy_request).allowed;
+  };
+  return tool_catalog_.select(request);
+}
+
+void AgentEngine::remember_tools(const std::string &session_id,
+                                 const std::vector<ToolCallResult> &results) {
+  constexpr std::size_t kRecentToolsPerSession = 8;
+  constexpr std::size_t kMaxTrackedSessions = 1024;
+
+  std::lock_guard<std::mutex> lock(recent_tools_mutex_);
+  if (recent_tools_.size() >= kMaxTrackedSessions && !recent_tools_.contains(session_id)) {
+    recent_tools_.clear();
+  }
+  auto &recent = recent_tools_[session_id];
+  for (const auto &result : results) {
+    recent.erase(std::remove(recent.begin(), recent.end(), result.name), recent.end());
+    recent.push_back(result.name);
+  }
+  if (recent.size() > kRecentToolsPerSession) {
+    recent.erase(recent.begin(),
+                 recent.begin() + static_cast<std::ptrdiff_t>(recent.size() - kRecentToolsPerSession));
+  }
+}
+
+std::string AgentEngine::prompt_tool_output(const ToolCallResult &result,
+                                           const tools::ToolContext &ctx) {
+  const std::size_t threshold = config_.tools.spill_threshold_bytes;
+  const std::string &output = result.result.output;
+  // tool_output pages are already bounded; spilling them again would loop.
+  if (threshold == 0 || output.size() <= threshold || result.name == "tool_output") {
+    return output;
+  }
+  // A preview is only useful if the model may page the rest back in.
+  if (tools_.get_tool("tool_output") == nullptr ||
+      !tool_policy_->evaluate_tool("tool_output", tool_policy_request(ctx)).allowed) {
+    return output;
+  }
+  auto stored = output_store_.put(ctx.session_id, output);
+  if (!stored.ok()) {
+    std::cerr << "[agent] failed to store output of " << result.name << ": " << stored.error()
+              << "\n";
+    return output;
+  }
+  return tools::spill_preview(output, stored.value(), threshold / 2);
+}
+
+tools::ToolContext AgentEngine::tool_context(const AgentOptions &options) const {
+  tools::ToolContext ctx;
+  ctx.workspace_path = workspace_;
+  ctx.session_id = options.session_id.value_or("default");
+  ctx.agent_id = options.agent_id.value_or("ghostclaw");
+  ctx.main_session_id = options.session_id.value_or("main");
+  ctx.provider = config_.default_provider;
+  ctx.tool_profile = options.tool_profile.value_or(config_.tools.profile);
+  ctx.channel_id = options.channel_id.value_or("");
+  ctx.group_id = options.group_id.value_or("");
+  ctx.sandbox_enabled = true;
+  ctx.cancel_token = options.cancel_token;
+  ctx.on_output = options.on_tool_output;
+  ctx.park_approvals = options.park_on_approval;
+  return ctx;
+}
+
 common::Result<AgentResponse> AgentEngine::process_with_tools(const std::string &message,
                                                               const std::string &system_prompt,
                                                               const std::string &memory_context,
-                                                              const AgentOptions &options) {
+                                                              const AgentOptions &options,
+                                                              providers::RouteTier &tier) {
   const std::string model = options.model_override.value_or(config_.default_model);
   const double temperature = options.temperature_override.value_or(config_.default_temperature);
 
-  std::string current_prompt = message;
-  std::vector<ToolCallResult> all_tool_results;
-  std::string final_content;
+  const tools::ToolContext ctx = tool_context(options);
+  const auto tool_specs = select_tools(message, memory_context, ctx);
+
+  if (tier == providers::RouteTier::Fast && router_ != nullptr) {
+    auto fast = router_->fast_provider().chat_with_system_tools(
+        system_prompt + "\n" + memory_context, message, router_->fast_model(), temperature,
+        tool_specs);
+    if (common::is_cancelled(options.cancel_token)) {
+      return common::Result<AgentResponse>::failure(std::string(kTurnCancelled));
+    }
+    if (fast.ok()) {
+      StreamParser parser;
+      parser.feed(fast.value());
+      parser.finish();
+      if (parser.tool_calls().empty() &&
+          !providers::ModelRouter::should_escalate(parser.accumulated_content())) {
+        AgentResponse out;
+        out.content = parser.accumulated_content();
+        return common::Result<AgentResponse>::success(std::move(out));
+      }
+    }
+    // Tool use, an unsure answer or a failed local call: the default model takes the turn.
+    tier = providers::RouteTier::Strong;
+  }
+
+  ParkedTurn turn;
+  turn.session_id = ctx.session_id;
+  turn.agent_id = ctx.agent_id;
+  turn.channel_id = ctx.channel_id;
+  turn.group_id = ctx.group_id;
+  turn.tool_profile = ctx.tool_profile;
+  turn.model = model;
+  turn.temperature = temperature;
+  turn.message = message;
+  turn.system_prompt = system_prompt;
+  turn.memory_context = memory_context;
+  turn.current_prompt = message;
+  turn.max_tool_iterations = options.max_tool_iterations;
+  return tool_loop(turn, ctx, tool_specs, options);
+}
 
-  for (std::size_t iter = 0; iter < options.max_tool_iterations; ++iter) {
-    auto response = provider_->chat_with_system_tools(
-        system_prompt + "\n" + memory_context, current_prompt, model, temperature, tools_.all_specs());
+common::Result<AgentResponse> AgentEngine::tool_loop(ParkedTurn &turn,
+                                                     const tools::ToolContext &ctx,
+                                                     const std::vector<tools::ToolSpec> &tool_specs,
+                                                     const AgentOptions &options) {
+  std::string final_content;
+  for (; turn.iteration < turn.max_tool_iterations; ++turn.iteration) {
+    if (common::is_cancelled(options.cancel_token)) {
+      return common::Result<AgentResponse>::failure(std::string(kTurnCancelled));
+    }
+    auto response = provider_->chat_with_system_tools(turn.system_prompt + "\n" +
+                                                          turn.memory_context,
+                                                      turn.current_prompt, turn.model,
+                                                      turn.temperature, tool_specs);
+    if (common::is_cancelled(options.cancel_token)) {
+      return common::Result<AgentResponse>::failure(std::string(kTurnCancelled));
+    }
     if (!response.ok()) {
       return common::Result<AgentResponse>::failure(response.error());
     }
@@ -267,42 +581,93 @@ common::Result<AgentResponse> AgentEngine::process_with_tools(const std::string
       requests.push_back(ToolCallRequest{.id = call.id, .name = call.name, .arguments = call.arguments});
     }
 
-    tools::ToolContext ctx;
-    ctx.workspace_path = workspace_;
-    ctx.session_id = options.session_id.value_or("default");
-    ctx.agent_id = options.agent_id.value_or("ghostclaw");
-    ctx.main_session_id = options.session_id.value_or("main");
-    ctx.provider = config_.default_provider;
-    ctx.tool_profile = options.tool_profile.value_or(config_.tools.profile);
-    ctx.channel_id = options.channel_id.value_or("");
-    ctx.group_id = options.group_id.value_or("");
-    ctx.sandbox_enabled = true;
-
     auto results = tool_executor_.execute(requests, ctx);
-    all_tool_results.insert(all_tool_results.end(), results.begin(), results.end());
-
-    std::ostringstream next_message;
-    next_message << message << "\n\nTool results:\n";
-    for (const auto &result : results) {
-      std::string output = result.result.output;
-      if (should_wrap_tool_output(result.name)) {
-        output = security::wrap_external_content(output, source_for_tool(result.name),
-                                                 std::nullopt, std::nullopt, true);
+    if (common::is_cancelled(options.cancel_token)) {
+      return common::Result<AgentResponse>::failure(std::string(kTurnCancelled));
+    }
+    remember_tools(ctx.session_id, results);
+
+    std::vector<ToolCallRequest> pending;
+    for (std::size_t i = 0; i < results.size(); ++i) {
+      if (results[i].awaiting_approval) {
+        pending.push_back(requests[i]);
       }
-      next_message << "- " << result.id << " (" << (result.result.success ? "ok" : "error")
-                   << "): " << output << "\n";
     }
-    current_prompt = next_message.str();
+    const std::size_t batch_start = turn.completed.size();
+    turn.completed.insert(turn.completed.end(), std::make_move_iterator(results.begin()),
+                          std::make_move_iterator(results.end()));
+    if (!pending.empty()) {
+      return park_turn(std::move(turn), batch_start, std::move(pending));
+    }
+    turn.current_prompt = tool_results_prompt(turn, batch_start, ctx);
   }
 
   AgentResponse out;
   out.content = final_content;
-  out.tool_results = std::move(all_tool_results);
+  out.tool_results = std::move(turn.completed);
+  return common::Result<AgentResponse>::success(std::move(out));
+}
+
+common::Result<AgentResponse> AgentEngine::park_turn(ParkedTurn turn, const std::size_t batch_start,
+                                                     std::vector<ToolCallRequest> pending) {
+  std::string command;
+  for (std::size_t i = batch_start; i < turn.completed.size(); ++i) {
+    const auto &result = turn.completed[i];
+    if (!result.awaiting_approval) {
+      continue;
+    }
+    const auto it = result.result.metadata.find("approval_command");
+    command += (command.empty() ? "" : "\n") +
+               (it != result.result.metadata.end() ? it->second : result.name);
+  }
+  turn.batch_start = batch_start;
+  turn.pending = std::move(pending);
+  turn.command = command;
+  turn.created_at = memory::now_rfc3339();
+
+  auto parked = continuations_.park(turn);
+  if (!parked.ok()) {
+    return common::Result<AgentResponse>::failure("failed to park turn for approval: " +
+                                                  parked.error());
+  }
+
+  AgentResponse out;
+  out.content = "Waiting for approval to run:\n" + command + "\n\nReply /approve " +
+                parked.value() + " to run it once, /approve-always " + parked.value() +
+                " to allow it from now on, or /deny " + parked.value() + ".";
+  for (auto &result : turn.completed) {
+    if (!result.awaiting_approval) {
+      out.tool_results.push_back(std::move(result));
+    }
+  }
+  out.pending_approval_id = parked.value();
+  out.pending_approval_command = std::move(command);
   return common::Result<AgentResponse>::success(std::move(out));
 }
 
+std::string AgentEngine::tool_results_prompt(const ParkedTurn &turn, const std::size_t from,
+                                             const tools::ToolContext &ctx) {
+  std::ostringstream next_message;
+  next_message << turn.message << "\n\nTool results:\n";
+  for (std::size_t i = from; i < turn.completed.size(); ++i) {
+    const auto &result = turn.completed[i];
+    std::string output = prompt_tool_output(result, ctx);
+    if (should_wrap_tool_output(result.name)) {
+      output = security::wrap_external_content(output, source_for_tool(result.name),
+                                               std::nullopt, std::nullopt, true);
+    }
+    next_message << "- " << result.id << " (" << (result.result.success ? "ok" : "error")
+                 << "): " << output << "\n";
+  }
+  return next_message.str();
+}
+
 common::Result<AgentResponse> AgentEngine::run(const std::string &message,
                                                 const AgentOptions &options) {
+  if (common::is_cancelled(options.cancel_token)) {
+    // Superseded while queued behind another turn: skip recall and the provider call.
+    return common::Result<AgentResponse>::failure(std::string(kTurnCancelled));
+  }
   const auto start = std::chrono::steady_clock::now();
   observability::record_agent_start(provider_->name(),
                                     options.model_override.value_or(config_.default_model));
@@ -311,17 +676,25 @@ common::Result<AgentResponse> AgentEngine::run(const std::string &message,
     std::cerr << "[warn] possible prompt injection detected\n";
   }
 
-  const std::string system_prompt = build_system_prompt();
-  std::string context = build_memory_context(message);
-  const std::string skills_context = build_relevant_skill_context(message);
-  if (!skills_context.empty()) {
-    if (!context.empty()) {
-      context += "\n";
-    }
-    context += skills_context;
+  // Installed before preparation so recall and skill search run inside this turn.
+  common::ScopedCancelToken cancel_scope(options.cancel_token);
+  providers::ScopedRequestClass request_class(
+      options.priority, options.session_id.value_or(options.agent_id.value_or("")));
+  providers::ScopedUsageCapture usage_capture;
+  auto prepared = prepare_turn(message, options);
+  const std::string &system_prompt = prepared.system_prompt;
+  const std::string &context = prepared.context;
+  providers::RouteTier tier = providers::RouteTier::Strong;
+  if (router_ != nullptr) {
+    tier = router_
+               ->route({.message = message,
+                        .skill_match = prepared.skills_matched,
+                        .pinned = options.model_override.has_value() ||
+                                  options.provider_override.has_value()})
+               .tier;
   }
-
-  auto result = process_with_tools(message, system_prompt, context, options);
+  const providers::RouteTier routed = tier;
+  auto result = process_with_tools(message, system_prompt, context, options, tier);
   if (!result.ok()) {
     observability::record_error("agent", result.error());
     return result;
@@ -331,36 +704,145 @@ common::Result<AgentResponse> AgentEngine::run(const std::string &message,
     std::cerr << "[warn] possible system prompt leak detected\n";
   }
 
-  if (config_.memory.auto_save) {
-    const std::string key = "conversation_" + std::to_string(std::time(nullptr));
-    (void)memory_->store(key, "User: " + message + "\nAssistant: " + result.value().content,
-                         memory::MemoryCategory::Daily);
+  // A parked turn is saved once it has been resumed and has its real answer.
+  if (auto_save_ != nullptr && !result.value().pending_approval_id.has_value()) {
+    auto_save_->enqueue(memory::unique_memory_key("conversation"),
+                        "User: " + message + "\nAssistant: " + result.value().content,
+                        memory::MemoryCategory::Daily);
   }
 
   const auto end = std::chrono::steady_clock::now();
   result.value().duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+  result.value().usage = usage_from_capture(usage_capture);
+  if (router_ != nullptr) {
+    router_->record(tier, routed != tier, result.value().duration, usage_capture.usage());
+  }
   observability::record_metric(
       observability::RequestLatencyMetric{.latency = result.value().duration});
   for (const auto &tool_result : result.value().tool_results) {
-    observability::record_tool_call(tool_result.name, std::chrono::milliseconds(0),
+    observability::record_tool_call(tool_result.name, tool_result.duration,
                                     tool_result.result.success);
   }
-  if (result.value().usage.total_tokens > 0) {
-    observability::record_metric(
-        observability::TokensUsedMetric{.tokens = result.value().usage.total_tokens});
-    observability::record_agent_end(
-        result.value().duration,
-        static_cast<std::uint64_t>(result.value().usage.total_tokens));
+  record_turn_end(result.value());
+  return result;
+}
+
+common::Result<AgentResponse> AgentEngine::resume(const std::string &approval_id,
+                                                   const security::ApprovalDecision decision,
+                                                   const AgentOptions &options) {
+  auto taken = continuations_.take(approval_id);
+  if (!taken.ok()) {
+    return common::Result<AgentResponse>::failure(taken.error());
+  }
+  ParkedTurn turn = std::move(taken.value());
+  if (options.session_id.has_value() && *options.session_id != turn.session_id) {
+    continuations_.release(approval_id);
+    return common::Result<AgentResponse>::failure("unknown approval id: " + approval_id);
+  }
+  // The claimed turn stays on disk until this resume has run its course.
+  struct FinishClaim {
+    ContinuationStore &store;
+    const std::string &id;
+    ~FinishClaim() { store.finish(id); }
+  } finish_claim{continuations_, approval_id};
+
+  const auto start = std::chrono::steady_clock::now();
+  observability::record_agent_start(provider_->name(), turn.model);
+
+  AgentOptions resumed = options;
+  resumed.session_id = turn.session_id;
+  resumed.agent_id = turn.agent_id;
+  resumed.channel_id = turn.channel_id;
+  resumed.group_id = turn.group_id;
+  resumed.tool_profile = turn.tool_profile;
+  resumed.max_tool_iterations = turn.max_tool_iterations;
+  const tools::ToolContext ctx = tool_context(resumed);
+
+  common::ScopedCancelToken cancel_scope(options.cancel_token);
+  providers::ScopedRequestClass request_class(options.priority, turn.session_id);
+  providers::ScopedUsageCapture usage_capture;
+
+  std::vector<ToolCallResult> decided;
+  if (decision == security::ApprovalDecision::Deny) {
+    for (const auto &call : turn.pending) {
+      ToolCallResult denied;
+      denied.id = call.id;
+      denied.name = call.name;
+      denied.result.success = false;
+      denied.result.output = "Tool execution denied by approver";
+      decided.push_back(std::move(denied));
+    }
   } else {
-    observability::record_agent_end(result.value().duration);
+    for (std::size_t i = turn.batch_start; i < turn.completed.size(); ++i) {
+      const auto &metadata = turn.completed[i].result.metadata;
+      if (const auto it = metadata.find("approval_command"); it != metadata.end()) {
+        approval_->record_decision(it->second, decision);
+      }
+    }
+    decided = tool_executor_.execute_approved(turn.pending, ctx);
+    remember_tools(ctx.session_id, decided);
+  }
+  for (const auto &result : decided) {
+    observability::record_tool_call(result.name, result.duration, result.result.success);
+  }
+  if (common::is_cancelled(options.cancel_token)) {
+    return common::Result<AgentResponse>::failure(std::string(kTurnCancelled));
+  }
+
+  // Decided results take the place of their placeholders, keeping the batch in call order.
+  const auto batch = turn.completed.begin() + static_cast<std::ptrdiff_t>(turn.batch_start);
+  for (auto &result : decided) {
+    const auto it = std::find_if(batch, turn.completed.end(), [&](const ToolCallResult &entry) {
+      return entry.awaiting_approval && entry.id == result.id;
+    });
+    if (it != turn.completed.end()) {
+      *it = std::move(result);
+    } else {
+      turn.completed.push_back(std::move(result));
+    }
+  }
+  const std::size_t resumed_from = turn.completed.size();
+  turn.current_prompt = tool_results_prompt(turn, turn.batch_start, ctx);
+  turn.pending.clear();
+  ++turn.iteration;
+
+  const auto tool_specs = select_tools(turn.message, turn.memory_context, ctx);
+  auto result = tool_loop(turn, ctx, tool_specs, resumed);
+  if (!result.ok()) {
+    observability::record_error("agent", result.error());
+    return result;
   }
+
+  if (auto_save_ != nullptr && !result.value().pending_approval_id.has_value()) {
+    auto_save_->enqueue(memory::unique_memory_key("conversation"),
+                        "User: " + turn.message + "\nAssistant: " + result.value().content,
+                        memory::MemoryCategory::Daily);
+  }
+
+  result.value().duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start);
+  result.value().usage = usage_from_capture(usage_capture);
+  observability::record_metric(
+      observability::RequestLatencyMetric{.latency = result.value().duration});
+  // Calls up to the parked batch were recorded by the turn that ran them.
+  const auto &tool_results = result.value().tool_results;
+  for (std::size_t i = std::min(resumed_from, tool_results.size()); i < tool_results.size(); ++i) {
+    observability::record_tool_call(tool_results[i].name, tool_results[i].duration,
+                                    tool_results[i].result.success);
+  }
+  record_turn_end(result.value());
   return result;
 }
 
+std::vector<ParkedTurn>
+AgentEngine::parked_turns(const std::optional<std::string> &session_id) const {
+  return continuations_.list(session_id);
+}
+
 common::Status AgentEngine::run_stream(const std::string &message, const StreamCallbacks &callbacks,
                                        const AgentOptions &options) {
   // Keep tool-capable runs on the existing full response path to avoid exposing intermediate tool payloads.
-  if (!tools_.all_specs().empty()) {
+  if (tool_catalog_.size() > 0) {
     auto result = run(message, options);
     if (!result.ok()) {
       if (callbacks.on_error) {
@@ -369,11 +851,9 @@ common::Status AgentEngine::run_stream(const std::string &message, const StreamC
       return common::Status::error(result.error());
     }
 
-    std::istringstream stream(result.value().content);
-    std::string token;
-    while (stream >> token) {
-      if (callbacks.on_token) {
-        callbacks.on_token(token);
+    if (callbacks.on_token) {
+      for (const auto chunk : providers::split_stream_chunks(result.value().content)) {
+        callbacks.on_token(chunk);
       }
     }
 
@@ -383,6 +863,13 @@ common::Status AgentEngine::run_stream(const std::string &message, const StreamC
     return common::Status::success();
   }
 
+  if (common::is_cancelled(options.cancel_token)) {
+    if (callbacks.on_error) {
+      callbacks.on_error(std::string(kTurnCancelled));
+    }
+    return common::Status::error(std::string(kTurnCancelled));
+  }
+
   const auto start = std::chrono::steady_clock::now();
   observability::record_agent_start(provider_->name(),
                                     options.model_override.value_or(config_.default_model));
@@ -391,25 +878,26 @@ common::Status AgentEngine::run_stream(const std::string &message, const StreamC
     std::cerr << "[warn] possible prompt injection detected\n";
   }
 
-  const std::string system_prompt = build_system_prompt();
-  std::string context = build_memory_context(message);
-  const std::string skills_context = build_relevant_skill_context(message);
-  if (!skills_context.empty()) {
-    if (!context.empty()) {
-      context += "\n";
-    }
-    context += skills_context;
-  }
+  // Installed before preparation so recall and skill search run inside this turn.
+  common::ScopedCancelToken cancel_scope(options.cancel_token);
+  providers::ScopedRequestClass request_class(
+      options.priority, options.session_id.value_or(options.agent_id.value_or("")));
+  providers::ScopedUsageCapture usage_capture;
+  auto prepared = prepare_turn(message, options);
+  const std::string &system_prompt = prepared.system_prompt;
+  const std::string &context = prepared.context;
   const std::string model = options.model_override.value_or(config_.default_model);
   const double temperature = options.temperature_override.value_or(config_.default_temperature);
-
   auto streamed = provider_->chat_with_system_stream(
       system_prompt + "\n" + context, message, model, temperature,
       [&](std::string_view chunk) {
-        if (callbacks.on_token) {
+        if (callbacks.on_token && !common::is_cancelled(options.cancel_token)) {
           callbacks.on_token(chunk);
         }
       });
+  if (common::is_cancelled(options.cancel_token)) {
+    streamed = common::Result<std::string>::failure(std::string(kTurnCancelled));
+  }
   if (!streamed.ok()) {
     observability::record_error("agent", streamed.error());
     if (callbacks.on_error) {
@@ -424,16 +912,17 @@ common::Status AgentEngine::run_stream(const std::string &message, const StreamC
     std::cerr << "[warn] possible system prompt leak detected\n";
   }
 
-  if (config_.memory.auto_save) {
-    const std::string key = "conversation_" + std::to_string(std::time(nullptr));
-    (void)memory_->store(key, "User: " + message + "\nAssistant: " + response.content,
-                         memory::MemoryCategory::Daily);
+  if (auto_save_ != nullptr) {
+    auto_save_->enqueue(memory::unique_memory_key("conversation"),
+                        "User: " + message + "\nAssistant: " + response.content,
+                        memory::MemoryCategory::Daily);
   }
 
   const auto end = std::chrono::steady_clock::now();
   response.duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+  response.usage = usage_from_capture(usage_capture);
   observability::record_metric(observability::RequestLatencyMetric{.latency = response.duration});
-  observability::record_agent_end(response.duration);
+  record_turn_end(response);
 
   if (callbacks.on_done) {
     callbacks.on_done(response);
@@ -463,7 +952,7 @@ common::Status AgentEngine::run_interactive(const AgentOptions &options) {
 
   std::cout << DIM << "  Provider: " << RESET << BOLD << provider_->name() << RESET
             << DIM << "  •  Model: " << RESET << BOLD << config_.default_model << RESET
-            << DIM << "  •  Tools: " << RESET << BOLD << tools_.all_specs().size() << RESET << "\n";
+            << DIM << "  •  Tools: " << RESET << BOLD << tool_catalog_.size() << RESET << "\n";
 
   if (!skill_prompts_.empty()) {
     std::cout << DIM << "  Skills: " << RESET << BOLD << skill_prompts_.size() << " loaded" << RESET << "\n";
@@ -499,7 +988,7 @@ common::Status AgentEngine::run_interactive(const AgentOptions &options) {
 
   // ── Tool listing helper ──
   auto list_tools = [&]() {
-    auto specs = tools_.all_specs();
+    const auto &specs = tool_catalog_.specs();
     if (specs.empty()) {
       std::cout << YELLOW << "  No tools registered." << RESET << "\n";
       return;
@@ -670,7 +1159,7 @@ common::Status AgentEngine::run_interactive(const AgentOptions &options) {
       std::cout << "\n" << BOLD << "  ── Agent Status ──" << RESET << "\n\n";
       std::cout << "  " << DIM << "Provider:" << RESET << "    " << BOLD << provider_->name() << RESET << "\n";
       std::cout << "  " << DIM << "Model:" << RESET << "       " << BOLD << config_.default_model << RESET << "\n";
-      std::cout << "  " << DIM << "Tools:" << RESET << "       " << tools_.all_specs().size() << " registered\n";
+      std::cout << "  " << DIM << "Tools:" << RESET << "       " << tool_catalog_.size() << " registered\n";
       std::cout << "  " << DIM << "Skills:" << RESET << "      " << skill_prompts_.size() << " loaded\n";
       std::cout << "  " << DIM << "Messages:" << RESET << "    " << message_count << " this session\n";
       std::cout << "  " << DIM << "Tokens:" << RESET << "      " << total_tokens << " used\n";
@@ -1,7 +1,25 @@
 #include "ghostclaw/agent/message_queue.hpp"
 
+#include "ghostclaw/common/fs.hpp"
+
+#include <algorithm>
+
 namespace ghostclaw::agent {
 
+std::optional<QueueMode> queue_mode_from_string(const std::string_view value) {
+  const std::string normalized = common::to_lower(common::trim(std::string(value)));
+  if (normalized == "steer") {
+    return QueueMode::Steer;
+  }
+  if (normalized == "followup" || normalized == "follow_up") {
+    return QueueMode::Followup;
+  }
+  if (normalized == "collect") {
+    return QueueMode::Collect;
+  }
+  return std::nullopt;
+}
+
 MessageQueue::MessageQueue(const QueueMode mode) : mode_(mode) {}
 
 void MessageQueue::push(QueuedMessage message) {
@@ -45,4 +63,67 @@ bool MessageQueue::empty() const {
   return queue_.empty();
 }
 
+std::shared_ptr<common::CancelToken> ActiveTurns::begin(const std::string &session_id,
+                                                        const QueueMode mode) {
+  auto token = std::make_shared<common::CancelToken>();
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto &turns = turns_[session_id];
+  if (mode == QueueMode::Steer) {
+    for (const auto &superseded : turns) {
+      superseded->cancel();
+    }
+    turns.clear();
+  }
+  turns.push_back(token);
+  return token;
+}
+
+void ActiveTurns::end(const std::string &session_id,
+                      const std::shared_ptr<common::CancelToken> &token) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto it = turns_.find(session_id);
+  if (it == turns_.end()) {
+    return;
+  }
+  auto &turns = it->second;
+  turns.erase(std::remove(turns.begin(), turns.end(), token), turns.end());
+  if (turns.empty()) {
+    turns_.erase(it);
+  }
+}
+
+std::size_t ActiveTurns::cancel(const std::string &session_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto it = turns_.find(session_id);
+  if (it == turns_.end()) {
+    return 0;
+  }
+  const std::size_t count = it->second.size();
+  for (const auto &token : it->second) {
+    token->cancel();
+  }
+  turns_.erase(it);
+  return count;
+}
+
+std::size_t ActiveTurns::cancel_all() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::size_t count = 0;
+  for (const auto &[session_id, tokens] : turns_) {
+    (void)session_id;
+    for (const auto &token : tokens) {
+      token->cancel();
+    }
+    count += tokens.size();
+  }
+  turns_.clear();
+  return count;
+}
+
+ActiveTurn::ActiveTurn(ActiveTurns &turns, std::string session_id, const QueueMode mode)
+    : turns_(turns), session_id_(std::move(session_id)),
+      token_(turns_.begin(session_id_, mode)) {}
+
+ActiveTurn::~ActiveTurn() { turns_.end(session_id_, token_); }
+
 } // namespace ghostclaw::agent
@@ -1,11 +1,15 @@
 #include "ghostclaw/agent/tool_executor.hpp"
 
 #include "ghostclaw/common/fs.hpp"
+#include "ghostclaw/nodes/scheduler.hpp"
+#include "ghostclaw/observability/global.hpp"
 #include "ghostclaw/sandbox/sandbox.hpp"
 #include "ghostclaw/security/approval.hpp"
 #include "ghostclaw/security/tool_policy.hpp"
+#include "ghostclaw/tools/result_cache.hpp"
 
 #include <future>
+#include <optional>
 
 namespace ghostclaw::agent {
 
@@ -48,130 +52,250 @@ void ToolExecutor::set_approval_manager(std::shared_ptr<security::ApprovalManage
   dependencies_.approval = std::move(approval);
 }
 
-std::vector<ToolCallResult> ToolExecutor::execute(const std::vector<ToolCallRequest> &calls,
-                                                  const tools::ToolContext &ctx) {
-  std::vector<std::future<ToolCallResult>> futures;
-  futures.reserve(calls.size());
+void ToolExecutor::set_node_scheduler(std::shared_ptr<nodes::NodeScheduler> node_scheduler) {
+  std::lock_guard<std::mutex> lock(state_mutex_);
+  dependencies_.node_scheduler = std::move(node_scheduler);
+}
 
-  const auto now = std::chrono::steady_clock::now();
+void ToolExecutor::set_result_cache(std::shared_ptr<tools::ToolResultCache> result_cache) {
+  std::lock_guard<std::mutex> lock(state_mutex_);
+  dependencies_.result_cache = std::move(result_cache);
+}
 
-  for (const auto &call : calls) {
-    futures.push_back(std::async(std::launch::async, [this, call, ctx, now]() {
-      ToolCallResult out;
-      out.id = call.id;
-      out.name = call.name;
-
-      Dependencies deps;
-      {
-        std::lock_guard<std::mutex> lock(state_mutex_);
-        deps = dependencies_;
-      }
+ToolCallResult ToolExecutor::execute_one(const ToolCallRequest &call, const tools::ToolContext &ctx,
+                                        const std::chrono::steady_clock::time_point now,
+                                        const bool approved) {
+  ToolCallResult out;
+  out.id = call.id;
+  out.name = call.name;
 
-      if (deps.tool_policy) {
-        security::ToolPolicyRequest policy_request;
-        policy_request.tool_name = call.name;
-        policy_request.provider = ctx.provider;
-        policy_request.agent_id = ctx.agent_id;
-        policy_request.channel_id = ctx.channel_id;
-        policy_request.group_id = ctx.group_id;
-        const auto profile = security::ToolPolicyPipeline::profile_from_string(ctx.tool_profile);
-        if (profile.ok()) {
-          policy_request.profile = profile.value();
-        }
-
-        const auto decision = deps.tool_policy->evaluate_tool(policy_request);
-        if (!decision.allowed) {
-          out.result.success = false;
-          out.result.output =
-              "Tool blocked by policy (" + decision.blocked_by + "): " + decision.reason;
-          return out;
-        }
-      }
+  if (common::is_cancelled(ctx.cancel_token)) {
+    out.result.success = false;
+    out.result.output = "Tool call cancelled";
+    return out;
+  }
 
-      tools::ITool *tool = registry_.get_tool(call.name);
-      if (tool == nullptr) {
+  Dependencies deps;
+  {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    deps = dependencies_;
+  }
+
+  if (deps.tool_policy) {
+    security::ToolPolicyRequest policy_request;
+    policy_request.tool_name = call.name;
+    policy_request.provider = ctx.provider;
+    policy_request.agent_id = ctx.agent_id;
+    policy_request.channel_id = ctx.channel_id;
+    policy_request.group_id = ctx.group_id;
+    const auto profile = security::ToolPolicyPipeline::profile_from_string(ctx.tool_profile);
+    if (profile.ok()) {
+      policy_request.profile = profile.value();
+    }
+
+    const auto decision = deps.tool_policy->evaluate_tool(policy_request);
+    if (!decision.allowed) {
+      out.result.success = false;
+      out.result.output =
+          "Tool blocked by policy (" + decision.blocked_by + "): " + decision.reason;
+      return out;
+    }
+  }
+
+  tools::ITool *tool = registry_.get_tool(call.name);
+  if (tool == nullptr) {
+    out.result.success = false;
+    out.result.output = "Unknown tool: " + call.name;
+    return out;
+  }
+
+  if (ctx.sandbox_enabled && deps.sandbox) {
+    sandbox::SandboxRequest request;
+    request.session_id = ctx.session_id;
+    request.main_session_id = ctx.main_session_id;
+    request.agent_id = ctx.agent_id;
+    request.workspace_dir = ctx.workspace_path;
+    request.agent_workspace_dir = ctx.workspace_path;
+
+    auto runtime = deps.sandbox->resolve_runtime(request);
+    if (!runtime.ok()) {
+      out.result.success = false;
+      out.result.output = "Sandbox resolve failed: " + runtime.error();
+      return out;
+    }
+
+    if (runtime.value().enabled) {
+      if (!deps.sandbox->is_tool_allowed(call.name)) {
         out.result.success = false;
-        out.result.output = "Unknown tool: " + call.name;
+        out.result.output = "Tool blocked by sandbox policy: " + call.name;
         return out;
       }
 
-      if (ctx.sandbox_enabled && deps.sandbox) {
-        sandbox::SandboxRequest request;
-        request.session_id = ctx.session_id;
-        request.main_session_id = ctx.main_session_id;
-        request.agent_id = ctx.agent_id;
-        request.workspace_dir = ctx.workspace_path;
-        request.agent_workspace_dir = ctx.workspace_path;
-
-        auto runtime = deps.sandbox->resolve_runtime(request);
-        if (!runtime.ok()) {
-          out.result.success = false;
-          out.result.output = "Sandbox resolve failed: " + runtime.error();
-          return out;
-        }
-
-        if (runtime.value().enabled) {
-          if (!deps.sandbox->is_tool_allowed(call.name)) {
-            out.result.success = false;
-            out.result.output = "Tool blocked by sandbox policy: " + call.name;
-            return out;
-          }
-
-          auto ensured = deps.sandbox->ensure_runtime(request);
-          if (!ensured.ok()) {
-            out.result.success = false;
-            out.result.output = "Sandbox setup failed: " + ensured.error();
-            return out;
-          }
-        }
+      auto ensured = deps.sandbox->ensure_runtime(request);
+      if (!ensured.ok()) {
+        out.result.success = false;
+        out.result.output = "Sandbox setup failed: " + ensured.error();
+        return out;
       }
+    }
+  }
 
-      {
-        std::lock_guard<std::mutex> lock(state_mutex_);
-        const auto it = cooldowns_.find(call.name);
-        if (it != cooldowns_.end() && now < it->second) {
-          out.result.success = false;
-          out.result.output = "Tool in cooldown: " + call.name;
-          return out;
-        }
-      }
+  {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    const auto it = cooldowns_.find(call.name);
+    if (it != cooldowns_.end() && now < it->second) {
+      out.result.success = false;
+      out.result.output = "Tool in cooldown: " + call.name;
+      return out;
+    }
+  }
+
+  if (deps.approval && !approved && is_dangerous_tool(*tool)) {
+    security::ApprovalRequest request;
+    request.command = approval_command_for_call(call, *tool);
+    request.session_id = ctx.session_id;
+    request.timeout = std::chrono::seconds(120);
 
-      if (deps.approval && is_dangerous_tool(*tool)) {
-        security::ApprovalRequest request;
-        request.command = approval_command_for_call(call, *tool);
-        request.session_id = ctx.session_id;
-        request.timeout = std::chrono::seconds(120);
-
-        auto decision = deps.approval->authorize(request);
-        if (!decision.ok()) {
-          out.result.success = false;
-          out.result.output = "Approval check failed: " + decision.error();
-          return out;
-        }
-
-        if (decision.value() == security::ApprovalDecision::Deny) {
-          out.result.success = false;
-          out.result.output = "Tool execution denied by approval policy";
-          return out;
-        }
+    std::optional<security::ApprovalDecision> decision;
+    if (ctx.park_approvals) {
+      decision = deps.approval->decide_without_prompt(request);
+      if (!decision.has_value()) {
+        out.awaiting_approval = true;
+        out.result.success = false;
+        out.result.output = "Awaiting approval: " + request.command;
+        out.result.metadata["approval"] = "pending";
+        out.result.metadata["approval_command"] = request.command;
+        return out;
       }
+    } else {
+      auto authorized = deps.approval->authorize(request);
+      if (!authorized.ok()) {
+        out.result.success = false;
+        out.result.output = "Approval check failed: " + authorized.error();
+        return out;
+      }
+      decision = authorized.value();
+    }
 
-      auto result = tool->execute(call.arguments, ctx);
-      if (result.ok()) {
-        out.result = result.value();
-        std::lock_guard<std::mutex> lock(state_mutex_);
-        failure_counts_[call.name] = 0;
-      } else {
+    if (*decision == security::ApprovalDecision::Deny) {
+      out.result.success = false;
+      out.result.output = "Tool execution denied by approval policy";
+      return out;
+    }
+  }
+
+  // Looked up after policy and approval so a cached result never bypasses either. The
+  // policy is taken before executing: a write racing the call leaves a stale version.
+  std::optional<tools::ToolCachePolicy> cache_policy;
+  if (deps.result_cache) {
+    cache_policy = tool->cache_policy(call.arguments, ctx);
+  }
+  if (cache_policy.has_value()) {
+    auto cached = deps.result_cache->lookup(call.name, *cache_policy);
+    const auto stats = deps.result_cache->stats();
+    observability::record_metric(observability::ToolCacheMetric{
+        .tool = call.name, .hit = cached.has_value(), .hits = stats.hits, .misses = stats.misses});
+    if (cached.has_value()) {
+      out.result = std::move(*cached);
+      out.result.metadata["cache"] = "hit";
+      return out;
+    }
+  }
+
+  if (deps.node_scheduler) {
+    const auto action = deps.node_scheduler->action_for_tool(call.name);
+    if (action.has_value()) {
+      // Remote output arrives as plain text; surface it as the call's stdout.
+      nodes::NodeOutputCallback forward_output;
+      if (ctx.on_output) {
+        forward_output = [&ctx](const std::string_view chunk) {
+          ctx.on_output(tools::ToolOutputChunk{
+              .call_id = {}, .tool = {}, .stream = "stdout", .text = std::string(chunk),
+              .skipped_lines = 0});
+        };
+      }
+      auto offloaded =
+          deps.node_scheduler->dispatch(*action, call.arguments, ctx, forward_output);
+      if (offloaded.ok()) {
+        out.result.success = offloaded.value().result.success;
+        out.result.truncated = offloaded.value().result.truncated;
+        out.result.output = offloaded.value().result.output;
+        out.result.metadata = offloaded.value().result.metadata;
+        out.result.metadata["node_id"] = offloaded.value().node_id;
+        return out;
+      }
+      if (!deps.node_scheduler->local_fallback_enabled()) {
         out.result.success = false;
-        out.result.output = result.error();
-        std::lock_guard<std::mutex> lock(state_mutex_);
-        auto &count = failure_counts_[call.name];
-        ++count;
-        if (count >= 3U) {
-          cooldowns_[call.name] = std::chrono::steady_clock::now() + std::chrono::seconds(30);
-        }
+        out.result.output = "Node offload failed: " + offloaded.error();
+        return out;
       }
+      // No node could take the call; fall through to local execution.
+    }
+  }
 
+  auto result = tool->execute(call.arguments, ctx);
+  if (common::is_cancelled(ctx.cancel_token)) {
+    // An aborted call says nothing about the tool's health; skip failure accounting.
+    out.result.success = false;
+    out.result.output = result.ok() ? result.value().output : result.error();
+    return out;
+  }
+  if (result.ok()) {
+    out.result = result.value();
+    if (cache_policy.has_value() && out.result.success) {
+      deps.result_cache->store(call.name, *cache_policy, out.result);
+    }
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    failure_counts_[call.name] = 0;
+  } else {
+    out.result.success = false;
+    out.result.output = result.error();
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    auto &count = failure_counts_[call.name];
+    ++count;
+    if (count >= 3U) {
+      cooldowns_[call.name] = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    }
+  }
+
+  return out;
+}
+
+std::vector<ToolCallResult> ToolExecutor::execute(const std::vector<ToolCallRequest> &calls,
+                                                  const tools::ToolContext &ctx) {
+  return execute_batch(calls, ctx, false);
+}
+
+std::vector<ToolCallResult>
+ToolExecutor::execute_approved(const std::vector<ToolCallRequest> &calls,
+                               const tools::ToolContext &ctx) {
+  return execute_batch(calls, ctx, true);
+}
+
+std::vector<ToolCallResult> ToolExecutor::execute_batch(const std::vector<ToolCallRequest> &calls,
+                                                        const tools::ToolContext &ctx,
+                                                        const bool approved) {
+  std::vector<std::future<ToolCallResult>> futures;
+  futures.reserve(calls.size());
+
+  const auto now = std::chrono::steady_clock::now();
+
+  for (const auto &call : calls) {
+    futures.push_back(std::async(std::launch::async, [this, call, ctx, now, approved]() {
+      tools::ToolContext call_ctx = ctx;
+      if (call_ctx.on_output) {
+        call_ctx.on_output = [forward = ctx.on_output, id = call.id,
+                              name = call.name](const tools::ToolOutputChunk &chunk) {
+          tools::ToolOutputChunk tagged = chunk;
+          tagged.call_id = id;
+          tagged.tool = name;
+          forward(tagged);
+        };
+      }
+      const auto started = std::chrono::steady_clock::now();
+      auto out = execute_one(call, call_ctx, now, approved);
+      out.duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - started);
       return out;
     }));
   }
@@ -207,6 +207,9 @@ std::string random_websocket_key() {
 
 class WebSocketTcpTransport final : public ICDPTransport {
 public:
+  WebSocketTcpTransport() = default;
+  explicit WebSocketTcpTransport(std::string bearer_token)
+      : bearer_token_(std::move(bearer_token)) {}
   ~WebSocketTcpTransport() override { close(); }
 
   common::Status connect(const std::string &ws_url) override {
@@ -249,6 +252,9 @@ public:
     req << "Connection: Upgrade\r\n";
     req << "Sec-WebSocket-Key: " << ws_key << "\r\n";
     req << "Sec-WebSocket-Version: 13\r\n";
+    if (!bearer_token_.empty()) {
+      req << "Authorization: Bearer " << bearer_token_ << "\r\n";
+    }
     req << "\r\n";
     const std::string handshake = req.str();
     if (!send_all(fd, reinterpret_cast<const std::uint8_t *>(handshake.data()), handshake.size())) {
@@ -444,6 +450,7 @@ public:
   }
 
 private:
+  std::string bearer_token_;
   mutable std::mutex io_mutex_;
   int fd_ = -1;
   std::atomic<bool> connected_{false};
@@ -452,6 +459,15 @@ private:
 
 } // namespace
 
+std::unique_ptr<ICDPTransport> make_websocket_transport(std::string bearer_token) {
+#ifdef _WIN32
+  (void)bearer_token;
+  return nullptr;
+#else
+  return std::make_unique<WebSocketTcpTransport>(std::move(bearer_token));
+#endif
+}
+
 CDPClient::CDPClient()
 #ifdef _WIN32
     : transport_(nullptr) {}
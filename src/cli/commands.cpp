@@ -7,11 +7,10 @@
 #include "ghostclaw/channels/channel_manager.hpp"
 #include "ghostclaw/common/fs.hpp"
 #include "ghostclaw/config/config.hpp"
+#include "ghostclaw/daemon/control.hpp"
 #include "ghostclaw/daemon/daemon.hpp"
 #include "ghostclaw/doctor/diagnostics.hpp"
 #include "ghostclaw/gateway/server.hpp"
-#include "ghostclaw/heartbeat/cron.hpp"
-#include "ghostclaw/heartbeat/cron_store.hpp"
 #include "ghostclaw/integrations/registry.hpp"
 #include "ghostclaw/migration/module.hpp"
 #include "ghostclaw/onboard/wizard.hpp"
@@ -141,6 +140,55 @@ std::string read_stdin_all() {
 
 bool stdin_is_tty() { return GHOSTCLAW_ISATTY(GHOSTCLAW_FILENO(stdin)) != 0; }
 
+// Sends the request to a running daemon over its control socket so the command reuses
+// the daemon's warm engine; only when no daemon answers is the work done in-process.
+common::Result<daemon::ControlMap> call_runtime(const std::string &method,
+                                                const daemon::ControlMap &params,
+                                                const bool local_only,
+                                                const daemon::ControlEmit &on_event = {}) {
+  auto loaded = config::load_config();
+  config::Config config = loaded.ok() ? loaded.value() : config::Config{};
+  if (!local_only) {
+    daemon::ControlClient client(daemon::control_socket_path(config));
+    if (client.available()) {
+      return client.call(method, params, on_event);
+    }
+  }
+
+  auto workspace = config::workspace_dir();
+  if (!workspace.ok()) {
+    return common::Result<daemon::ControlMap>::failure(workspace.error());
+  }
+  // An in-process run lives for one command, so the caller's own --provider is fine here.
+  auto providers = daemon::configured_providers(config);
+  if (const auto provider = params.find("provider"); provider != params.end()) {
+    providers.push_back(provider->second);
+  }
+  auto context = std::make_shared<runtime::RuntimeContext>(std::move(config));
+  daemon::ControlService service(
+      workspace.value(),
+      [context](const std::string &provider) {
+        if (!provider.empty()) {
+          context->mutable_config().default_provider = provider;
+        }
+        return context->create_agent_engine();
+      },
+      std::move(providers));
+  return service.handle(method, params, on_event);
+}
+
+int print_runtime_result(const common::Result<daemon::ControlMap> &result) {
+  if (!result.ok()) {
+    std::cerr << result.error() << "\n";
+    return 1;
+  }
+  const auto output = result.value().find("output");
+  if (output != result.value().end()) {
+    std::cout << output->second;
+  }
+  return 0;
+}
+
 int run_agent(std::vector<std::string> args);
 
 int run_onboard(std::vector<std::string> args) {
@@ -212,23 +260,63 @@ int run_agent(std::vector<std::string> args) {
       return 1;
     }
   }
-  auto context = runtime::RuntimeContext::from_disk();
-  if (!context.ok()) {
-    std::cerr << context.error() << "\n";
-    return 1;
-  }
-  auto runtime_context = std::move(context.value());
-
   std::string message;
   std::string provider;
   std::string model;
   std::string temperature_raw;
+  std::string session_id;
   (void)take_option(args, "--message", "-m", message);
   (void)take_option(args, "--provider", "", provider);
   (void)take_option(args, "--model", "", model);
   (void)take_option(args, "--temperature", "-t", temperature_raw);
+  (void)take_option(args, "--session", "", session_id);
+  const bool local_only = take_flag(args, "--local");
+
+  if (!message.empty() && !local_only) {
+    auto loaded = config::load_config();
+    daemon::ControlClient client(
+        daemon::control_socket_path(loaded.ok() ? loaded.value() : config::Config{}));
+    if (client.available()) {
+      bool streamed = false;
+      auto result = client.call("agent.run",
+                                {{"message", message},
+                                 {"provider", provider},
+                                 {"model", model},
+                                 {"temperature", temperature_raw},
+                                 {"session_id", session_id}},
+                                [&](const daemon::ControlMap &event) {
+                                  const auto text = event.find("text");
+                                  if (text != event.end()) {
+                                    std::cout << text->second << std::flush;
+                                    streamed = true;
+                                  }
+                                });
+      if (!result.ok()) {
+        if (streamed) {
+          std::cout << "\n";
+        }
+        std::cerr << result.error() << "\n";
+        return 1;
+      }
+      if (!streamed) {
+        std::cout << result.value()["content"];
+      }
+      std::cout << "\n";
+      return 0;
+    }
+  }
+
+  auto context = runtime::RuntimeContext::from_disk();
+  if (!context.ok()) {
+    std::cerr << context.error() << "\n";
+    return 1;
+  }
+  auto runtime_context = std::move(context.value());
 
   agent::AgentOptions options;
+  if (!session_id.empty()) {
+    options.session_id = session_id;
+  }
   if (!provider.empty()) {
     options.provider_override = provider;
     runtime_context.mutable_config().default_provider = provider;
@@ -478,24 +566,10 @@ int run_daemon(std::vector<std::string> args) {
 }
 
 int run_cron(std::vector<std::string> args) {
-  auto workspace = config::workspace_dir();
-  if (!workspace.ok()) {
-    std::cerr << workspace.error() << "\n";
-    return 1;
-  }
-
-  heartbeat::CronStore store(workspace.value() / "cron" / "jobs.db");
+  const bool local_only = take_flag(args, "--local");
 
   if (args.empty() || args[0] == "list") {
-    auto jobs = store.list_jobs();
-    if (!jobs.ok()) {
-      std::cerr << jobs.error() << "\n";
-      return 1;
-    }
-    for (const auto &job : jobs.value()) {
-      std::cout << job.id << " | " << job.expression << " | " << job.command << "\n";
-    }
-    return 0;
+    return print_runtime_result(call_runtime("cron.list", {}, local_only));
   }
 
   if (args[0] == "add") {
@@ -503,46 +577,72 @@ int run_cron(std::vector<std::string> args) {
       std::cerr << "usage: ghostclaw cron add <expression> <command>\n";
       return 1;
     }
-    auto expression = heartbeat::CronExpression::parse(args[1]);
-    if (!expression.ok()) {
-      std::cerr << expression.error() << "\n";
+    return print_runtime_result(call_runtime(
+        "cron.add", {{"expression", args[1]}, {"command", join_tokens(args, 2)}}, local_only));
+  }
+
+  if (args[0] == "remove") {
+    if (args.size() < 2) {
+      std::cerr << "usage: ghostclaw cron remove <id>\n";
       return 1;
     }
+    return print_runtime_result(call_runtime("cron.remove", {{"id", args[1]}}, local_only));
+  }
 
-    std::string command = args[2];
-    for (std::size_t i = 3; i < args.size(); ++i) {
-      command += " " + args[i];
-    }
+  std::cerr << "unknown cron subcommand\n";
+  return 1;
+}
+
+int run_memory(std::vector<std::string> args) {
+  const bool local_only = take_flag(args, "--local");
+  std::string limit;
+  std::string category;
+  (void)take_option(args, "--limit", "-n", limit);
+  (void)take_option(args, "--category", "", category);
 
-    heartbeat::CronJob job;
-    job.id = "job-" + std::to_string(std::time(nullptr));
-    job.expression = args[1];
-    job.command = command;
-    job.next_run = expression.value().next_occurrence();
-    auto added = store.add_job(job);
-    if (!added.ok()) {
-      std::cerr << added.error() << "\n";
+  if (!args.empty() && args[0] == "recall") {
+    if (args.size() < 2) {
+      std::cerr << "usage: ghostclaw memory recall <query> [--limit N]\n";
       return 1;
     }
-    std::cout << "Added cron job: " << job.id << "\n";
-    return 0;
+    return print_runtime_result(call_runtime(
+        "memory.recall", {{"query", join_tokens(args, 1)}, {"limit", limit}}, local_only));
   }
 
-  if (args[0] == "remove") {
-    if (args.size() < 2) {
-      std::cerr << "usage: ghostclaw cron remove <id>\n";
+  if (!args.empty() && args[0] == "store") {
+    if (args.size() < 3) {
+      std::cerr << "usage: ghostclaw memory store <key> <content> [--category NAME]\n";
       return 1;
     }
-    auto removed = store.remove_job(args[1]);
-    if (!removed.ok()) {
-      std::cerr << removed.error() << "\n";
+    return print_runtime_result(call_runtime(
+        "memory.store",
+        {{"key", args[1]}, {"content", join_tokens(args, 2)}, {"category", category}},
+        local_only));
+  }
+
+  std::cerr << "usage: ghostclaw memory <recall|store> ...\n";
+  return 1;
+}
+
+int run_sessions(std::vector<std::string> args) {
+  const bool local_only = take_flag(args, "--local");
+  std::string limit;
+  (void)take_option(args, "--limit", "-n", limit);
+
+  if (args.empty() || args[0] == "list") {
+    return print_runtime_result(call_runtime("sessions.list", {{"limit", limit}}, local_only));
+  }
+
+  if (args[0] == "history") {
+    if (args.size() < 2) {
+      std::cerr << "usage: ghostclaw sessions history <session-id> [--limit N]\n";
       return 1;
     }
-    std::cout << (removed.value() ? "Removed" : "Not found") << "\n";
-    return 0;
+    return print_runtime_result(call_runtime(
+        "sessions.history", {{"session_id", args[1]}, {"limit", limit}}, local_only));
   }
 
-  std::cerr << "unknown cron subcommand\n";
+  std::cerr << "unknown sessions subcommand\n";
   return 1;
 }
 
@@ -1428,10 +1528,14 @@ void print_help() {
 
   std::cout << BOLD << "  OTHER" << RESET << "\n";
   std::cout << "  " << GREEN << "cron" << RESET << DIM << "           Manage scheduled tasks" << RESET << "\n";
+  std::cout << "  " << GREEN << "memory" << RESET << DIM << "         Recall or store memories" << RESET << "\n";
+  std::cout << "  " << GREEN << "sessions" << RESET << DIM << "       List sessions and transcripts" << RESET << "\n";
   std::cout << "  " << GREEN << "tts" << RESET << DIM << "            Text-to-speech" << RESET << "\n";
   std::cout << "  " << GREEN << "voice" << RESET << DIM << "          Voice control (wake word / push-to-talk)" << RESET << "\n";
   std::cout << "  " << GREEN << "message" << RESET << DIM << "        Send message to a channel" << RESET << "\n";
-  std::cout << "  " << GREEN << "version" << RESET << DIM << "        Show version" << RESET << "\n\n";
+  std::cout << "  " << GREEN << "version" << RESET << DIM << "        Show version" << RESET << "\n";
+  std::cout << DIM << "  agent -m, cron, memory and sessions attach to a running daemon;"
+            << " pass --local to run in-process." << RESET << "\n\n";
 
   std::cout << BOLD << "  INTERACTIVE MODE COMMANDS" << RESET << DIM << " (inside 'ghostclaw agent')" << RESET << "\n";
   std::cout << "  " << YELLOW << "/help" << RESET << "  " << YELLOW << "/skills" << RESET
@@ -1550,6 +1654,12 @@ int run_cli(int argc, char **argv) {
   if (subcommand == "cron") {
     return run_cron(std::move(args));
   }
+  if (subcommand == "memory") {
+    return run_memory(std::move(args));
+  }
+  if (subcommand == "sessions") {
+    return run_sessions(std::move(args));
+  }
   if (subcommand == "channel") {
     return run_channel(std::move(args));
   }
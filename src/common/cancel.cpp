@@ -0,0 +1,79 @@
+#include "ghostclaw/common/cancel.hpp"
+
+namespace ghostclaw::common {
+
+namespace {
+
+thread_local std::shared_ptr<CancelToken> tls_cancel_token;
+
+} // namespace
+
+void CancelToken::cancel() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (cancelled_.exchange(true)) {
+    return;
+  }
+  for (auto &[id, callback] : callbacks_) {
+    (void)id;
+    if (callback) {
+      callback();
+    }
+  }
+  callbacks_.clear();
+  cv_.notify_all();
+}
+
+std::uint64_t CancelToken::subscribe(Callback callback) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (cancelled_.load()) {
+    if (callback) {
+      callback();
+    }
+    return 0;
+  }
+  const std::uint64_t id = next_id_++;
+  callbacks_.emplace(id, std::move(callback));
+  return id;
+}
+
+void CancelToken::unsubscribe(const std::uint64_t id) {
+  if (id == 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  callbacks_.erase(id);
+}
+
+bool CancelToken::wait_for(const std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return cv_.wait_for(lock, timeout, [this]() { return cancelled_.load(); });
+}
+
+CancelSubscription::CancelSubscription(std::shared_ptr<CancelToken> token,
+                                       CancelToken::Callback callback)
+    : token_(std::move(token)) {
+  if (token_ != nullptr) {
+    id_ = token_->subscribe(std::move(callback));
+  }
+}
+
+CancelSubscription::~CancelSubscription() { reset(); }
+
+void CancelSubscription::reset() {
+  if (token_ != nullptr) {
+    token_->unsubscribe(id_);
+    token_.reset();
+  }
+  id_ = 0;
+}
+
+std::shared_ptr<CancelToken> current_cancel_token() { return tls_cancel_token; }
+
+ScopedCancelToken::ScopedCancelToken(std::shared_ptr<CancelToken> token)
+    : previous_(std::move(tls_cancel_token)) {
+  tls_cancel_token = std::move(token);
+}
+
+ScopedCancelToken::~ScopedCancelToken() { tls_cancel_token = std::move(previous_); }
+
+} // namespace ghostclaw::common
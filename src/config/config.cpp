@@ -3,6 +3,7 @@
 #include "ghostclaw/auth/oauth.hpp"
 #include "ghostclaw/common/fs.hpp"
 #include "ghostclaw/common/toml.hpp"
+#include "ghostclaw/security/approval.hpp"
 
 #include <filesystem>
 #include <fstream>
@@ -170,6 +171,8 @@ void load_dotenv_files() {
 }
 
 void load_channel_config(Config &config, const common::TomlDocument &doc) {
+  config.channels.queue_mode = doc.get_string("channels.queue_mode", config.channels.queue_mode);
+
   if (doc.has("channels.telegram.bot_token")) {
     TelegramConfig telegram;
     telegram.bot_token = expand_config_value(doc.get_string("channels.telegram.bot_token"));
@@ -321,7 +324,8 @@ std::string normalize_provider_alias(const std::string &provider) {
 }
 
 bool provider_is_known(const std::string &provider) {
-  if (common::starts_with(common::to_lower(common::trim(provider)), "custom:")) {
+  const std::string lowered = common::to_lower(common::trim(provider));
+  if (common::starts_with(lowered, "custom:") || common::starts_with(lowered, "gguf:")) {
     return true;
   }
   const std::string normalized = normalize_provider_alias(provider);
@@ -337,6 +341,12 @@ bool provider_is_known(const std::string &provider) {
 void load_daemon_config(Config &config, const common::TomlDocument &doc) {
   config.daemon.auto_start_schedules =
       doc.get_bool("daemon.auto_start_schedules", config.daemon.auto_start_schedules);
+  config.daemon.control_socket_enabled =
+      doc.get_bool("daemon.control_socket_enabled", config.daemon.control_socket_enabled);
+  config.daemon.control_socket = doc.get_string("daemon.control_socket", config.daemon.control_socket);
+  if (!config.daemon.control_socket.empty()) {
+    config.daemon.control_socket = expand_config_path(config.daemon.control_socket);
+  }
 
   std::set<std::string> schedule_ids;
   for (const auto &[key, val] : doc.values) {
@@ -393,6 +403,40 @@ void load_mcp_config(Config &config, const common::TomlDocument &doc) {
   }
 }
 
+void load_nodes_config(Config &config, const common::TomlDocument &doc) {
+  config.nodes.serve = doc.get_bool("nodes.serve", config.nodes.serve);
+  config.nodes.serve_token =
+      expand_config_value(doc.get_string("nodes.serve_token", config.nodes.serve_token));
+  config.nodes.offload_tools = doc.get_string_array("nodes.offload_tools", config.nodes.offload_tools);
+  config.nodes.max_in_flight_per_node = static_cast<std::size_t>(
+      doc.get_u64("nodes.max_in_flight_per_node", config.nodes.max_in_flight_per_node));
+  config.nodes.local_fallback = doc.get_bool("nodes.local_fallback", config.nodes.local_fallback);
+
+  std::set<std::string> remote_ids;
+  for (const auto &[key, val] : doc.values) {
+    if (common::starts_with(key, "nodes.remotes.")) {
+      const auto after = key.substr(14); // skip "nodes.remotes."
+      const auto dot = after.find('.');
+      if (dot != std::string::npos) {
+        remote_ids.insert(after.substr(0, dot));
+      }
+    }
+  }
+
+  for (const auto &id : remote_ids) {
+    RemoteNodeConfig remote;
+    remote.id = id;
+    const std::string prefix = "nodes.remotes." + id + ".";
+    remote.endpoint = doc.get_string(prefix + "endpoint");
+    if (doc.has(prefix + "capabilities")) {
+      remote.capabilities = doc.get_string_array(prefix + "capabilities", remote.capabilities);
+    }
+    remote.token = expand_config_value(doc.get_string(prefix + "token"));
+    remote.enabled = doc.get_bool(prefix + "enabled", remote.enabled);
+    config.nodes.remotes.push_back(std::move(remote));
+  }
+}
+
 void load_google_config(Config &config, const common::TomlDocument &doc) {
   config.google.client_id =
       expand_config_value(doc.get_string("google.client_id", config.google.client_id));
@@ -685,6 +729,8 @@ common::Result<Config> load_config() {
       doc.get_string("gateway.websocket_tls_cert_file", config.gateway.websocket_tls_cert_file);
   config.gateway.websocket_tls_key_file =
       doc.get_string("gateway.websocket_tls_key_file", config.gateway.websocket_tls_key_file);
+  config.gateway.websocket_replay_events = static_cast<std::size_t>(
+      doc.get_u64("gateway.websocket_replay_events", config.gateway.websocket_replay_events));
   config.gateway.session_send_policy_enabled = doc.get_bool(
       "gateway.session_send_policy_enabled", config.gateway.session_send_policy_enabled);
   config.gateway.session_send_policy_max_per_window = static_cast<std::uint32_t>(doc.get_u64(
@@ -693,6 +739,29 @@ common::Result<Config> load_config() {
   config.gateway.session_send_policy_window_seconds = static_cast<std::uint32_t>(doc.get_u64(
       "gateway.session_send_policy_window_seconds",
       config.gateway.session_send_policy_window_seconds));
+  config.gateway.session_history_enabled =
+      doc.get_bool("gateway.session_history_enabled", config.gateway.session_history_enabled);
+  config.gateway.session_history_recent_messages = static_cast<std::size_t>(
+      doc.get_u64("gateway.session_history_recent_messages",
+                  config.gateway.session_history_recent_messages));
+  config.gateway.session_history_summary_tokens = static_cast<std::size_t>(
+      doc.get_u64("gateway.session_history_summary_tokens",
+                  config.gateway.session_history_summary_tokens));
+  config.gateway.session_archive_idle_hours = static_cast<std::uint32_t>(
+      doc.get_u64("gateway.session_archive_idle_hours",
+                  config.gateway.session_archive_idle_hours));
+  config.gateway.cluster_enabled =
+      doc.get_bool("gateway.cluster_enabled", config.gateway.cluster_enabled);
+  config.gateway.cluster_dir = doc.get_string("gateway.cluster_dir", config.gateway.cluster_dir);
+  config.gateway.cluster_worker_id =
+      doc.get_string("gateway.cluster_worker_id", config.gateway.cluster_worker_id);
+  config.gateway.cluster_advertise_url =
+      doc.get_string("gateway.cluster_advertise_url", config.gateway.cluster_advertise_url);
+  config.gateway.cluster_lease_seconds = static_cast<std::uint32_t>(
+      doc.get_u64("gateway.cluster_lease_seconds", config.gateway.cluster_lease_seconds));
+  if (!config.gateway.cluster_dir.empty()) {
+    config.gateway.cluster_dir = expand_config_path(config.gateway.cluster_dir);
+  }
   if (!config.gateway.websocket_tls_cert_file.empty()) {
     config.gateway.websocket_tls_cert_file =
         expand_config_path(config.gateway.websocket_tls_cert_file);
@@ -712,12 +781,20 @@ common::Result<Config> load_config() {
       static_cast<std::uint32_t>(doc.get_u64("autonomy.max_actions_per_hour", config.autonomy.max_actions_per_hour));
   config.autonomy.max_cost_per_day_cents =
       static_cast<std::uint32_t>(doc.get_u64("autonomy.max_cost_per_day_cents", config.autonomy.max_cost_per_day_cents));
+  config.autonomy.approval_security =
+      doc.get_string("autonomy.approval_security", config.autonomy.approval_security);
+  config.autonomy.approval_ask = doc.get_string("autonomy.approval_ask", config.autonomy.approval_ask);
+  config.autonomy.approval_allowlist =
+      doc.get_string_array("autonomy.approval_allowlist", config.autonomy.approval_allowlist);
+  config.autonomy.approval_ttl_secs =
+      doc.get_u64("autonomy.approval_ttl_secs", config.autonomy.approval_ttl_secs);
 
   load_channel_config(config, doc);
   load_tunnel_config(config, doc);
   load_multi_config(config, doc);
   load_daemon_config(config, doc);
   load_mcp_config(config, doc);
+  load_nodes_config(config, doc);
   load_google_config(config, doc);
 
   config.observability.backend = doc.get_string("observability.backend", config.observability.backend);
@@ -738,6 +815,44 @@ common::Result<Config> load_config() {
   config.reliability.scheduler_retries =
       static_cast<std::uint32_t>(doc.get_u64("reliability.scheduler_retries", config.reliability.scheduler_retries));
 
+  config.router.enabled = doc.get_bool("router.enabled", config.router.enabled);
+  config.router.fast_provider = doc.get_string("router.fast_provider", config.router.fast_provider);
+  config.router.fast_model = doc.get_string("router.fast_model", config.router.fast_model);
+  config.router.max_fast_chars = static_cast<std::size_t>(
+      doc.get_u64("router.max_fast_chars", config.router.max_fast_chars));
+  config.router.min_confidence =
+      doc.get_double("router.min_confidence", config.router.min_confidence);
+  config.router.classifier = doc.get_bool("router.classifier", config.router.classifier);
+
+  config.admission.enabled = doc.get_bool("admission.enabled", config.admission.enabled);
+  config.admission.requests_per_minute = static_cast<std::uint32_t>(
+      doc.get_u64("admission.requests_per_minute", config.admission.requests_per_minute));
+  config.admission.tokens_per_minute =
+      doc.get_u64("admission.tokens_per_minute", config.admission.tokens_per_minute);
+  config.admission.max_concurrent = static_cast<std::uint32_t>(
+      doc.get_u64("admission.max_concurrent", config.admission.max_concurrent));
+  config.admission.background_share =
+      doc.get_double("admission.background_share", config.admission.background_share);
+  config.admission.max_wait_secs =
+      doc.get_u64("admission.max_wait_secs", config.admission.max_wait_secs);
+
+  config.batch.enabled = doc.get_bool("batch.enabled", config.batch.enabled);
+  config.batch.max_batch_size = static_cast<std::uint32_t>(
+      doc.get_u64("batch.max_batch_size", config.batch.max_batch_size));
+  config.batch.max_delay_secs = doc.get_u64("batch.max_delay_secs", config.batch.max_delay_secs);
+  config.batch.poll_interval_secs =
+      doc.get_u64("batch.poll_interval_secs", config.batch.poll_interval_secs);
+  config.batch.max_wait_secs = doc.get_u64("batch.max_wait_secs", config.batch.max_wait_secs);
+
+  config.local_model.threads = static_cast<std::uint32_t>(
+      doc.get_u64("local_model.threads", config.local_model.threads));
+  config.local_model.context_length = static_cast<std::uint32_t>(
+      doc.get_u64("local_model.context_length", config.local_model.context_length));
+  config.local_model.max_tokens = static_cast<std::uint32_t>(
+      doc.get_u64("local_model.max_tokens", config.local_model.max_tokens));
+  config.local_model.cache_slots = static_cast<std::uint32_t>(
+      doc.get_u64("local_model.cache_slots", config.local_model.cache_slots));
+
   config.heartbeat.enabled = doc.get_bool("heartbeat.enabled", config.heartbeat.enabled);
   config.heartbeat.interval_minutes =
       doc.get_u64("heartbeat.interval_minutes", config.heartbeat.interval_minutes);
@@ -753,6 +868,12 @@ common::Result<Config> load_config() {
       doc.get_string_array("tools.allow.groups", config.tools.allow.groups);
   config.tools.allow.tools = doc.get_string_array("tools.allow.tools", config.tools.allow.tools);
   config.tools.allow.deny = doc.get_string_array("tools.allow.deny", config.tools.allow.deny);
+  config.tools.max_per_turn = static_cast<std::size_t>(
+      doc.get_u64("tools.max_per_turn", config.tools.max_per_turn));
+  config.tools.core = doc.get_string_array("tools.core", config.tools.core);
+  config.tools.spill_threshold_bytes = static_cast<std::size_t>(
+      doc.get_u64("tools.spill_threshold_bytes", config.tools.spill_threshold_bytes));
+  config.tools.result_cache = doc.get_bool("tools.result_cache", config.tools.result_cache);
 
   config.calendar.backend = doc.get_string("calendar.backend", config.calendar.backend);
   config.calendar.default_calendar =
@@ -858,12 +979,29 @@ common::Status save_config(const Config &config) {
        << common::quote_toml_string(config.gateway.websocket_tls_cert_file) << "\n";
   file << "websocket_tls_key_file = "
        << common::quote_toml_string(config.gateway.websocket_tls_key_file) << "\n";
+  file << "websocket_replay_events = " << config.gateway.websocket_replay_events << "\n";
   file << "session_send_policy_enabled = "
        << bool_to_toml(config.gateway.session_send_policy_enabled) << "\n";
   file << "session_send_policy_max_per_window = "
        << config.gateway.session_send_policy_max_per_window << "\n";
   file << "session_send_policy_window_seconds = "
        << config.gateway.session_send_policy_window_seconds << "\n";
+  file << "session_history_enabled = " << bool_to_toml(config.gateway.session_history_enabled)
+       << "\n";
+  file << "session_history_recent_messages = "
+       << config.gateway.session_history_recent_messages << "\n";
+  file << "session_history_summary_tokens = " << config.gateway.session_history_summary_tokens
+       << "\n";
+  file << "session_archive_idle_hours = " << config.gateway.session_archive_idle_hours << "\n";
+  if (config.gateway.cluster_enabled) {
+    file << "cluster_enabled = true\n";
+    file << "cluster_dir = " << common::quote_toml_string(config.gateway.cluster_dir) << "\n";
+    file << "cluster_worker_id = " << common::quote_toml_string(config.gateway.cluster_worker_id)
+         << "\n";
+    file << "cluster_advertise_url = "
+         << common::quote_toml_string(config.gateway.cluster_advertise_url) << "\n";
+    file << "cluster_lease_seconds = " << config.gateway.cluster_lease_seconds << "\n";
+  }
 
   file << "\n[autonomy]\n";
   file << "level = " << common::quote_toml_string(config.autonomy.level) << "\n";
@@ -872,6 +1010,12 @@ common::Status save_config(const Config &config) {
   file << "forbidden_paths = " << string_array_to_toml(config.autonomy.forbidden_paths) << "\n";
   file << "max_actions_per_hour = " << config.autonomy.max_actions_per_hour << "\n";
   file << "max_cost_per_day_cents = " << config.autonomy.max_cost_per_day_cents << "\n";
+  file << "approval_security = " << common::quote_toml_string(config.autonomy.approval_security)
+       << "\n";
+  file << "approval_ask = " << common::quote_toml_string(config.autonomy.approval_ask) << "\n";
+  file << "approval_allowlist = " << string_array_to_toml(config.autonomy.approval_allowlist)
+       << "\n";
+  file << "approval_ttl_secs = " << config.autonomy.approval_ttl_secs << "\n";
 
   file << "\n[tunnel]\n";
   file << "provider = " << common::quote_toml_string(config.tunnel.provider) << "\n";
@@ -896,6 +1040,10 @@ common::Status save_config(const Config &config) {
     file << "args = " << string_array_to_toml(config.tunnel.custom->args) << "\n";
   }
 
+  if (config.channels.queue_mode != ChannelsConfig{}.queue_mode) {
+    file << "\n[channels]\n";
+    file << "queue_mode = " << common::quote_toml_string(config.channels.queue_mode) << "\n";
+  }
   if (config.channels.telegram.has_value()) {
     file << "\n[channels.telegram]\n";
     file << "bot_token = " << common::quote_toml_string(config.channels.telegram->bot_token)
@@ -957,11 +1105,44 @@ common::Status save_config(const Config &config) {
 
   file << "\n[tools]\n";
   file << "profile = " << common::quote_toml_string(config.tools.profile) << "\n";
+  file << "max_per_turn = " << config.tools.max_per_turn << "\n";
+  file << "core = " << string_array_to_toml(config.tools.core) << "\n";
+  file << "spill_threshold_bytes = " << config.tools.spill_threshold_bytes << "\n";
+  file << "result_cache = " << bool_to_toml(config.tools.result_cache) << "\n";
   file << "\n[tools.allow]\n";
   file << "groups = " << string_array_to_toml(config.tools.allow.groups) << "\n";
   file << "tools = " << string_array_to_toml(config.tools.allow.tools) << "\n";
   file << "deny = " << string_array_to_toml(config.tools.allow.deny) << "\n";
 
+  file << "\n[router]\n";
+  file << "enabled = " << bool_to_toml(config.router.enabled) << "\n";
+  file << "fast_provider = " << common::quote_toml_string(config.router.fast_provider) << "\n";
+  file << "fast_model = " << common::quote_toml_string(config.router.fast_model) << "\n";
+  file << "max_fast_chars = " << config.router.max_fast_chars << "\n";
+  file << "min_confidence = " << config.router.min_confidence << "\n";
+  file << "classifier = " << bool_to_toml(config.router.classifier) << "\n";
+
+  file << "\n[admission]\n";
+  file << "enabled = " << bool_to_toml(config.admission.enabled) << "\n";
+  file << "requests_per_minute = " << config.admission.requests_per_minute << "\n";
+  file << "tokens_per_minute = " << config.admission.tokens_per_minute << "\n";
+  file << "max_concurrent = " << config.admission.max_concurrent << "\n";
+  file << "background_share = " << config.admission.background_share << "\n";
+  file << "max_wait_secs = " << config.admission.max_wait_secs << "\n";
+
+  file << "\n[batch]\n";
+  file << "enabled = " << bool_to_toml(config.batch.enabled) << "\n";
+  file << "max_batch_size = " << config.batch.max_batch_size << "\n";
+  file << "max_delay_secs = " << config.batch.max_delay_secs << "\n";
+  file << "poll_interval_secs = " << config.batch.poll_interval_secs << "\n";
+  file << "max_wait_secs = " << config.batch.max_wait_secs << "\n";
+
+  file << "\n[local_model]\n";
+  file << "threads = " << config.local_model.threads << "\n";
+  file << "context_length = " << config.local_model.context_length << "\n";
+  file << "max_tokens = " << config.local_model.max_tokens << "\n";
+  file << "cache_slots = " << config.local_model.cache_slots << "\n";
+
   file << "\n[calendar]\n";
   file << "backend = " << common::quote_toml_string(config.calendar.backend) << "\n";
   file << "default_calendar = "
@@ -1034,9 +1215,16 @@ common::Status save_config(const Config &config) {
   }
 
   // Daemon schedules
-  if (!config.daemon.schedules.empty() || !config.daemon.auto_start_schedules) {
+  if (!config.daemon.schedules.empty() || !config.daemon.auto_start_schedules ||
+      !config.daemon.control_socket_enabled || !config.daemon.control_socket.empty()) {
     file << "\n[daemon]\n";
     file << "auto_start_schedules = " << bool_to_toml(config.daemon.auto_start_schedules) << "\n";
+    file << "control_socket_enabled = " << bool_to_toml(config.daemon.control_socket_enabled)
+         << "\n";
+    if (!config.daemon.control_socket.empty()) {
+      file << "control_socket = " << common::quote_toml_string(config.daemon.control_socket)
+           << "\n";
+    }
     for (const auto &entry : config.daemon.schedules) {
       file << "\n[daemon.schedules." << entry.id << "]\n";
       file << "expression = " << common::quote_toml_string(entry.expression) << "\n";
@@ -1060,6 +1248,27 @@ common::Status save_config(const Config &config) {
     }
   }
 
+  // Remote nodes
+  if (config.nodes.serve || !config.nodes.offload_tools.empty() || !config.nodes.remotes.empty()) {
+    file << "\n[nodes]\n";
+    file << "serve = " << bool_to_toml(config.nodes.serve) << "\n";
+    if (!config.nodes.serve_token.empty()) {
+      file << "serve_token = " << common::quote_toml_string(config.nodes.serve_token) << "\n";
+    }
+    file << "offload_tools = " << string_array_to_toml(config.nodes.offload_tools) << "\n";
+    file << "max_in_flight_per_node = " << config.nodes.max_in_flight_per_node << "\n";
+    file << "local_fallback = " << bool_to_toml(config.nodes.local_fallback) << "\n";
+    for (const auto &remote : config.nodes.remotes) {
+      file << "\n[nodes.remotes." << remote.id << "]\n";
+      file << "endpoint = " << common::quote_toml_string(remote.endpoint) << "\n";
+      file << "capabilities = " << string_array_to_toml(remote.capabilities) << "\n";
+      if (!remote.token.empty()) {
+        file << "token = " << common::quote_toml_string(remote.token) << "\n";
+      }
+      file << "enabled = " << bool_to_toml(remote.enabled) << "\n";
+    }
+  }
+
   // Google config
   if (!config.google.client_id.empty()) {
     file << "\n[google]\n";
@@ -1096,6 +1305,16 @@ common::Result<std::vector<std::string>> validate_config(const Config &config) {
         "default_temperature must be between 0.0 and 2.0");
   }
 
+  if (config.admission.background_share <= 0.0 || config.admission.background_share > 1.0) {
+    return common::Result<std::vector<std::string>>::failure(
+        "admission.background_share must be greater than 0.0 and at most 1.0");
+  }
+
+  if (config.batch.max_batch_size == 0) {
+    return common::Result<std::vector<std::string>>::failure(
+        "batch.max_batch_size must be at least 1");
+  }
+
   const std::string memory_backend = common::to_lower(config.memory.backend);
   if (memory_backend != "sqlite" && memory_backend != "markdown" && memory_backend != "none") {
     return common::Result<std::vector<std::string>>::failure("Invalid memory.backend: " +
@@ -1112,6 +1331,14 @@ common::Result<std::vector<std::string>> validate_config(const Config &config) {
     return common::Result<std::vector<std::string>>::failure("Invalid autonomy.level: " +
                                                               config.autonomy.level);
   }
+  if (!security::exec_security_from_string(config.autonomy.approval_security).ok()) {
+    return common::Result<std::vector<std::string>>::failure(
+        "Invalid autonomy.approval_security: " + config.autonomy.approval_security);
+  }
+  if (!security::exec_ask_from_string(config.autonomy.approval_ask).ok()) {
+    return common::Result<std::vector<std::string>>::failure("Invalid autonomy.approval_ask: " +
+                                                              config.autonomy.approval_ask);
+  }
 
   if (common::to_lower(config.runtime.kind) != "native") {
     return common::Result<std::vector<std::string>>::failure("Unsupported runtime.kind: " +
@@ -1184,6 +1411,15 @@ common::Result<std::vector<std::string>> validate_config(const Config &config) {
     return common::Result<std::vector<std::string>>::failure(
         "gateway.session_send_policy_window_seconds must be > 0");
   }
+  if (config.gateway.cluster_enabled && config.gateway.cluster_lease_seconds == 0) {
+    return common::Result<std::vector<std::string>>::failure(
+        "gateway.cluster_lease_seconds must be > 0");
+  }
+  const std::string channel_queue_mode = common::to_lower(common::trim(config.channels.queue_mode));
+  if (channel_queue_mode != "followup" && channel_queue_mode != "steer") {
+    return common::Result<std::vector<std::string>>::failure(
+        "channels.queue_mode must be 'followup' or 'steer'");
+  }
 
   if (config.gateway.allow_public_bind && tunnel_provider == "none") {
     warnings.push_back("gateway.allow_public_bind is true without tunnel provider configured");
@@ -1331,6 +1567,16 @@ common::Result<std::vector<std::string>> validate_config(const Config &config) {
     }
   }
 
+  // Remote node validation
+  for (const auto &remote : config.nodes.remotes) {
+    if (remote.enabled && !common::starts_with(common::trim(remote.endpoint), "ws://")) {
+      warnings.push_back("node remote '" + remote.id + "' endpoint must be a ws:// url");
+    }
+  }
+  if (config.nodes.max_in_flight_per_node == 0) {
+    warnings.push_back("nodes.max_in_flight_per_node must be greater than 0");
+  }
+
   // Google config validation
   const std::string email_backend = common::to_lower(common::trim(config.email.backend));
   const std::string cal_backend = common::to_lower(common::trim(config.calendar.backend));
@@ -0,0 +1,663 @@
+#include "ghostclaw/daemon/control.hpp"
+
+#include "ghostclaw/common/fs.hpp"
+#include "ghostclaw/common/json_util.hpp"
+#include "ghostclaw/config/config.hpp"
+#include "ghostclaw/heartbeat/cron.hpp"
+#include "ghostclaw/heartbeat/cron_store.hpp"
+#include "ghostclaw/sessions/store.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <map>
+#include <sstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace ghostclaw::daemon {
+
+namespace {
+
+constexpr std::size_t kMaxFrameBytes = 4 * 1024 * 1024;
+
+std::string encode_frame(const std::string &type, const ControlMap &fields) {
+  // Sorted keys keep frames stable for logs and tests.
+  const std::map<std::string, std::string> ordered(fields.begin(), fields.end());
+  std::string out = "{\"type\":\"" + common::json_escape(type) + "\"";
+  for (const auto &[key, value] : ordered) {
+    if (key == "type") {
+      continue;
+    }
+    out += ",\"" + common::json_escape(key) + "\":\"" + common::json_escape(value) + "\"";
+  }
+  out += "}\n";
+  return out;
+}
+
+std::string param_or(const ControlMap &params, const std::string &key,
+                     const std::string &fallback = "") {
+  const auto it = params.find(key);
+  if (it == params.end()) {
+    return fallback;
+  }
+  const std::string value = common::trim(it->second);
+  return value.empty() ? fallback : value;
+}
+
+std::size_t param_size(const ControlMap &params, const std::string &key, std::size_t fallback) {
+  const std::string raw = param_or(params, key);
+  if (raw.empty()) {
+    return fallback;
+  }
+  try {
+    return static_cast<std::size_t>(std::stoull(raw));
+  } catch (...) {
+    return fallback;
+  }
+}
+
+#ifndef _WIN32
+bool write_all(const int fd, const std::string &data) {
+  std::size_t written = 0;
+  while (written < data.size()) {
+    const ssize_t n = ::send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+    if (n <= 0) {
+      return false;
+    }
+    written += static_cast<std::size_t>(n);
+  }
+  return true;
+}
+
+// SOCK_CLOEXEC and accept4 are Linux-only; macOS needs the flag set afterwards.
+int cloexec(const int fd) {
+  if (fd >= 0) {
+    (void)::fcntl(fd, F_SETFD, FD_CLOEXEC);
+  }
+  return fd;
+}
+
+int connect_unix(const std::filesystem::path &path) {
+  const std::string socket = path.string();
+  sockaddr_un addr{};
+  if (socket.empty() || socket.size() >= sizeof(addr.sun_path)) {
+    return -1;
+  }
+  const int fd = cloexec(::socket(AF_UNIX, SOCK_STREAM, 0));
+  if (fd < 0) {
+    return -1;
+  }
+  addr.sun_family = AF_UNIX;
+  std::snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket.c_str());
+  if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+#endif
+
+} // namespace
+
+std::vector<std::string> configured_providers(const config::Config &config) {
+  std::vector<std::string> providers;
+  const auto add = [&providers](const std::string &provider) {
+    const std::string trimmed = common::trim(provider);
+    if (!trimmed.empty() &&
+        std::find(providers.begin(), providers.end(), trimmed) == providers.end()) {
+      providers.push_back(trimmed);
+    }
+  };
+  add(config.default_provider);
+  for (const auto &fallback : config.reliability.fallback_providers) {
+    add(fallback);
+  }
+  if (config.router.enabled) {
+    add(config.router.fast_provider);
+  }
+  return providers;
+}
+
+std::filesystem::path control_socket_path(const config::Config &config) {
+  if (!common::trim(config.daemon.control_socket).empty()) {
+    return config.daemon.control_socket;
+  }
+  if (auto dir = config::config_dir(); dir.ok()) {
+    return dir.value() / "daemon.sock";
+  }
+  // Never a shared name in a world-writable directory: another user could squat on it.
+  if (const char *runtime = std::getenv("XDG_RUNTIME_DIR");
+      runtime != nullptr && *runtime != '\0') {
+    return std::filesystem::path(runtime) / "ghostclaw" / "daemon.sock";
+  }
+#ifndef _WIN32
+  return std::filesystem::temp_directory_path() /
+         ("ghostclaw-" + std::to_string(::getuid())) / "daemon.sock";
+#else
+  return std::filesystem::temp_directory_path() / "ghostclaw" / "daemon.sock";
+#endif
+}
+
+ControlServer::ControlServer(std::filesystem::path socket_path, ControlHandler handler)
+    : socket_path_(std::move(socket_path)), handler_(std::move(handler)) {}
+
+ControlServer::~ControlServer() { stop(); }
+
+common::Status ControlServer::start() {
+#ifdef _WIN32
+  return common::Status::error("daemon control socket is not supported on Windows");
+#else
+  if (running_.exchange(true)) {
+    return common::Status::success();
+  }
+
+  const auto fail = [this](const std::string &message) {
+    if (listen_fd_ >= 0) {
+      ::close(listen_fd_);
+      listen_fd_ = -1;
+    }
+    running_ = false;
+    return common::Status::error(message);
+  };
+
+  const std::string socket = socket_path_.string();
+  if (socket.size() >= sizeof(sockaddr_un::sun_path)) {
+    return fail("control socket path is too long");
+  }
+  std::filesystem::path dir = socket_path_.parent_path();
+  if (dir.empty()) {
+    dir = ".";
+  }
+  std::error_code ec;
+  if (!std::filesystem::exists(dir, ec)) {
+    std::filesystem::create_directories(dir, ec);
+    ::chmod(dir.c_str(), 0700);
+  }
+  // Anyone who can write to the directory could swap the socket for their own.
+  struct stat dir_info{};
+  if (::lstat(dir.c_str(), &dir_info) != 0 || !S_ISDIR(dir_info.st_mode) ||
+      dir_info.st_uid != ::geteuid() || (dir_info.st_mode & (S_IWGRP | S_IWOTH)) != 0) {
+    return fail("control socket directory must be a directory owned by this user and "
+                "writable by no one else: " + dir.string());
+  }
+  // A live daemon still answers; only a stale socket file may be replaced.
+  if (const int existing = connect_unix(socket_path_); existing >= 0) {
+    ::close(existing);
+    return fail("another daemon is already listening on " + socket);
+  }
+
+  // Bind inside a private 0700 directory and move the socket into place, so it is never
+  // reachable before its mode is 0600. The rename also replaces a stale socket atomically.
+  const auto staging = dir / (".ctl-" + std::to_string(::getpid()));
+  const auto staged = staging / "s";
+  if (staged.string().size() >= sizeof(sockaddr_un::sun_path)) {
+    return fail("control socket path is too long");
+  }
+  std::filesystem::remove_all(staging, ec);
+  if (::mkdir(staging.c_str(), 0700) != 0) {
+    return fail("failed to create control socket staging directory: " + staging.string());
+  }
+  listen_fd_ = cloexec(::socket(AF_UNIX, SOCK_STREAM, 0));
+  if (listen_fd_ < 0) {
+    ::rmdir(staging.c_str());
+    return fail("failed to create control socket");
+  }
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  std::snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", staged.c_str());
+  const bool bound = ::bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0 &&
+                     ::chmod(staged.c_str(), 0600) == 0 &&
+                     ::rename(staged.c_str(), socket.c_str()) == 0;
+  ::unlink(staged.c_str());
+  ::rmdir(staging.c_str());
+  if (!bound || ::listen(listen_fd_, 16) != 0) {
+    return fail("failed to bind control socket: " + socket);
+  }
+
+  accept_thread_ = std::thread([this]() { accept_loop(); });
+  return common::Status::success();
+#endif
+}
+
+void ControlServer::stop() {
+#ifndef _WIN32
+  if (!running_.exchange(false)) {
+    return;
+  }
+  if (listen_fd_ >= 0) {
+    ::shutdown(listen_fd_, SHUT_RDWR);
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+  }
+  if (accept_thread_.joinable()) {
+    accept_thread_.join();
+  }
+  {
+    // Idle clients wake on shutdown; a running agent turn is allowed to finish.
+    std::unique_lock<std::mutex> lock(clients_mutex_);
+    for (const int fd : client_fds_) {
+      ::shutdown(fd, SHUT_RD);
+    }
+    clients_cv_.wait(lock, [this]() { return client_fds_.empty(); });
+  }
+  ::unlink(socket_path_.c_str());
+#endif
+}
+
+void ControlServer::accept_loop() {
+#ifndef _WIN32
+  while (running_) {
+    const int client = cloexec(::accept(listen_fd_, nullptr, nullptr));
+    if (client < 0) {
+      if (running_) {
+        continue;
+      }
+      break;
+    }
+    std::lock_guard<std::mutex> lock(clients_mutex_);
+    if (!running_) {
+      ::close(client);
+      break;
+    }
+    client_fds_.push_back(client);
+    std::thread([this, client]() { serve_client(client); }).detach();
+  }
+#endif
+}
+
+void ControlServer::serve_client(const int client_fd) {
+#ifndef _WIN32
+  std::string line;
+  std::array<char, 4096> chunk{};
+  while (line.find('\n') == std::string::npos && line.size() < kMaxFrameBytes) {
+    const ssize_t bytes = ::read(client_fd, chunk.data(), chunk.size());
+    if (bytes <= 0) {
+      break;
+    }
+    line.append(chunk.data(), static_cast<std::size_t>(bytes));
+  }
+  line = line.substr(0, line.find('\n'));
+
+  if (!common::trim(line).empty()) {
+    auto params = common::json_parse_flat(line);
+    const std::string method = params["method"];
+    params.erase("method");
+
+    bool connected = true;
+    const ControlEmit emit = [&](const ControlMap &event) {
+      if (connected) {
+        connected = write_all(client_fd, encode_frame("event", event));
+      }
+    };
+    common::Result<ControlMap> result =
+        method.empty() ? common::Result<ControlMap>::failure("missing method")
+        : handler_     ? handler_(method, params, emit)
+                       : common::Result<ControlMap>::failure("no handler");
+    if (connected) {
+      (void)write_all(client_fd, result.ok() ? encode_frame("result", result.value())
+                                             : encode_frame("error", {{"error", result.error()}}));
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(clients_mutex_);
+  client_fds_.erase(std::remove(client_fds_.begin(), client_fds_.end(), client_fd),
+                    client_fds_.end());
+  ::close(client_fd);
+  clients_cv_.notify_all();
+#else
+  (void)client_fd;
+#endif
+}
+
+ControlClient::ControlClient(std::filesystem::path socket_path)
+    : socket_path_(std::move(socket_path)) {}
+
+bool ControlClient::available() const {
+#ifdef _WIN32
+  return false;
+#else
+  const int fd = connect_unix(socket_path_);
+  if (fd < 0) {
+    return false;
+  }
+  ::close(fd);
+  return true;
+#endif
+}
+
+common::Result<ControlMap> ControlClient::call(const std::string &method, const ControlMap &params,
+                                               const ControlEmit &on_event,
+                                               const std::chrono::milliseconds timeout) const {
+#ifdef _WIN32
+  (void)method;
+  (void)params;
+  (void)on_event;
+  (void)timeout;
+  return common::Result<ControlMap>::failure("daemon control socket is not supported on Windows");
+#else
+  const int fd = connect_unix(socket_path_);
+  if (fd < 0) {
+    return common::Result<ControlMap>::failure("daemon is not running");
+  }
+  ControlMap request = params;
+  request["method"] = method;
+  std::string frame = encode_frame("request", request);
+  if (!write_all(fd, frame)) {
+    ::close(fd);
+    return common::Result<ControlMap>::failure("failed to send daemon request");
+  }
+
+  std::string buffer;
+  std::array<char, 4096> chunk{};
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (std::chrono::steady_clock::now() < deadline) {
+    std::size_t newline = buffer.find('\n');
+    while (newline != std::string::npos) {
+      const std::string line = buffer.substr(0, newline);
+      buffer.erase(0, newline + 1);
+      auto fields = common::json_parse_flat(line);
+      const std::string type = fields["type"];
+      fields.erase("type");
+      if (type == "event") {
+        if (on_event) {
+          on_event(fields);
+        }
+      } else if (type == "result") {
+        ::close(fd);
+        return common::Result<ControlMap>::success(std::move(fields));
+      } else if (type == "error") {
+        ::close(fd);
+        return common::Result<ControlMap>::failure(fields["error"]);
+      }
+      newline = buffer.find('\n');
+    }
+
+    pollfd pfd{};
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    if (::poll(&pfd, 1, 250) <= 0) {
+      continue;
+    }
+    const ssize_t bytes = ::read(fd, chunk.data(), chunk.size());
+    if (bytes <= 0) {
+      ::close(fd);
+      return common::Result<ControlMap>::failure("daemon closed the connection without a result");
+    }
+    buffer.append(chunk.data(), static_cast<std::size_t>(bytes));
+  }
+  ::close(fd);
+  const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(timeout).count();
+  return common::Result<ControlMap>::failure("daemon did not answer within " +
+                                             std::to_string(seconds) + "s");
+#endif
+}
+
+ControlService::ControlService(std::filesystem::path workspace, EngineFactory engine_factory,
+                               std::vector<std::string> providers)
+    : workspace_(std::move(workspace)), engine_factory_(std::move(engine_factory)),
+      providers_(std::move(providers)) {}
+
+common::Result<std::shared_ptr<agent::AgentEngine>>
+ControlService::engine(const std::string &provider) {
+  if (!provider.empty() &&
+      std::find(providers_.begin(), providers_.end(), provider) == providers_.end()) {
+    return common::Result<std::shared_ptr<agent::AgentEngine>>::failure(
+        "unknown provider: " + provider);
+  }
+  std::lock_guard<std::mutex> lock(engine_mutex_);
+  const auto cached = engines_.find(provider);
+  if (cached != engines_.end()) {
+    return common::Result<std::shared_ptr<agent::AgentEngine>>::success(cached->second);
+  }
+  if (!engine_factory_) {
+    return common::Result<std::shared_ptr<agent::AgentEngine>>::failure(
+        "agent engine unavailable");
+  }
+  auto created = engine_factory_(provider);
+  if (created.ok()) {
+    engines_.emplace(provider, created.value());
+  }
+  return created;
+}
+
+common::Status ControlService::warm() {
+  auto created = engine();
+  if (!created.ok()) {
+    return common::Status::error(created.error());
+  }
+  return common::Status::success();
+}
+
+common::Result<ControlMap> ControlService::handle(const std::string &method,
+                                                  const ControlMap &params,
+                                                  const ControlEmit &emit) {
+  if (method == "ping") {
+    return common::Result<ControlMap>::success({{"status", "ok"}});
+  }
+  if (method == "agent.run") {
+    return agent_run(params, emit);
+  }
+  if (method == "memory.recall") {
+    return memory_recall(params);
+  }
+  if (method == "memory.store") {
+    return memory_store(params);
+  }
+  if (method == "sessions.list") {
+    return sessions_list(params);
+  }
+  if (method == "sessions.history") {
+    return sessions_history(params);
+  }
+  if (common::starts_with(method, "cron.")) {
+    return cron_request(method, params);
+  }
+  return common::Result<ControlMap>::failure("unknown method: " + method);
+}
+
+common::Result<ControlMap> ControlService::agent_run(const ControlMap &params,
+                                                     const ControlEmit &emit) {
+  const auto message_it = params.find("message");
+  if (message_it == params.end() || common::trim(message_it->second).empty()) {
+    return common::Result<ControlMap>::failure("missing message");
+  }
+  // The provider is fixed when an engine is built, so an override selects the engine.
+  const std::string provider = param_or(params, "provider");
+  auto created = engine(provider);
+  if (!created.ok()) {
+    return common::Result<ControlMap>::failure(created.error());
+  }
+
+  agent::AgentOptions options;
+  if (!provider.empty()) {
+    options.provider_override = provider;
+  }
+  if (const auto model = param_or(params, "model"); !model.empty()) {
+    options.model_override = model;
+  }
+  if (const auto session = param_or(params, "session_id"); !session.empty()) {
+    options.session_id = session;
+  }
+  if (const auto temperature = param_or(params, "temperature"); !temperature.empty()) {
+    try {
+      options.temperature_override = std::stod(temperature);
+    } catch (...) {
+      return common::Result<ControlMap>::failure("invalid temperature: " + temperature);
+    }
+  }
+
+  agent::AgentResponse response;
+  std::string stream_error;
+  std::lock_guard<std::mutex> lock(run_mutex_);
+  auto status = created.value()->run_stream(
+      message_it->second,
+      {.on_token =
+           [&](std::string_view token) {
+             if (emit) {
+               emit({{"event", "assistant.token"}, {"text", std::string(token)}});
+             }
+           },
+       .on_done = [&](const agent::AgentResponse &done) { response = done; },
+       .on_error = [&](const std::string &error) { stream_error = error; }},
+      options);
+  if (!status.ok()) {
+    return common::Result<ControlMap>::failure(stream_error.empty() ? status.error()
+                                                                    : stream_error);
+  }
+  return common::Result<ControlMap>::success(
+      {{"content", response.content},
+       {"duration_ms", std::to_string(response.duration.count())},
+       {"tool_calls", std::to_string(response.tool_results.size())},
+       {"prompt_tokens", std::to_string(response.usage.prompt_tokens)},
+       {"completion_tokens", std::to_string(response.usage.completion_tokens)},
+       {"cached_prompt_tokens", std::to_string(response.usage.cached_prompt_tokens)}});
+}
+
+common::Result<ControlMap> ControlService::memory_recall(const ControlMap &params) {
+  const std::string query = param_or(params, "query");
+  if (query.empty()) {
+    return common::Result<ControlMap>::failure("missing query");
+  }
+  auto created = engine();
+  if (!created.ok()) {
+    return common::Result<ControlMap>::failure(created.error());
+  }
+  auto entries = created.value()->memory()->recall(query, param_size(params, "limit", 5));
+  if (!entries.ok()) {
+    return common::Result<ControlMap>::failure(entries.error());
+  }
+  std::ostringstream output;
+  for (const auto &entry : entries.value()) {
+    output << "[" << memory::category_to_string(entry.category) << "] " << entry.key << ": "
+           << entry.content << "\n";
+  }
+  return common::Result<ControlMap>::success(
+      {{"count", std::to_string(entries.value().size())}, {"output", output.str()}});
+}
+
+common::Result<ControlMap> ControlService::memory_store(const ControlMap &params) {
+  const std::string key = param_or(params, "key");
+  const auto content_it = params.find("content");
+  if (key.empty() || content_it == params.end() || content_it->second.empty()) {
+    return common::Result<ControlMap>::failure("key and content are required");
+  }
+  auto created = engine();
+  if (!created.ok()) {
+    return common::Result<ControlMap>::failure(created.error());
+  }
+  auto stored = created.value()->memory()->store(
+      key, content_it->second, memory::category_from_string(param_or(params, "category", "core")));
+  if (!stored.ok()) {
+    return common::Result<ControlMap>::failure(stored.error());
+  }
+  return common::Result<ControlMap>::success({{"output", "Stored memory: " + key + "\n"}});
+}
+
+common::Result<ControlMap> ControlService::sessions_list(const ControlMap &params) {
+  sessions::SessionStore store(workspace_ / "sessions");
+  auto states = store.list_states();
+  if (!states.ok()) {
+    return common::Result<ControlMap>::failure(states.error());
+  }
+  const std::size_t limit = param_size(params, "limit", 0);
+  std::ostringstream output;
+  std::size_t shown = 0;
+  for (const auto &state : states.value()) {
+    if (limit > 0 && shown >= limit) {
+      break;
+    }
+    output << state.session_id << " | " << (state.model.empty() ? "-" : state.model) << " | "
+           << state.updated_at << "\n";
+    ++shown;
+  }
+  return common::Result<ControlMap>::success(
+      {{"count", std::to_string(states.value().size())}, {"output", output.str()}});
+}
+
+common::Result<ControlMap> ControlService::sessions_history(const ControlMap &params) {
+  const std::string session_id = param_or(params, "session_id");
+  if (session_id.empty()) {
+    return common::Result<ControlMap>::failure("missing session_id");
+  }
+  sessions::SessionStore store(workspace_ / "sessions");
+  auto entries = store.load_transcript(session_id, param_size(params, "limit", 50));
+  if (!entries.ok()) {
+    return common::Result<ControlMap>::failure(entries.error());
+  }
+  std::ostringstream output;
+  for (const auto &entry : entries.value()) {
+    output << entry.timestamp << " " << sessions::role_to_string(entry.role) << ": "
+           << entry.content << "\n";
+  }
+  return common::Result<ControlMap>::success(
+      {{"count", std::to_string(entries.value().size())}, {"output", output.str()}});
+}
+
+common::Result<ControlMap> ControlService::cron_request(const std::string &method,
+                                                        const ControlMap &params) {
+  heartbeat::CronStore store(workspace_ / "cron" / "jobs.db");
+
+  if (method == "cron.list") {
+    auto jobs = store.list_jobs();
+    if (!jobs.ok()) {
+      return common::Result<ControlMap>::failure(jobs.error());
+    }
+    std::ostringstream output;
+    for (const auto &job : jobs.value()) {
+      output << job.id << " | " << job.expression << " | " << job.command << "\n";
+    }
+    return common::Result<ControlMap>::success(
+        {{"count", std::to_string(jobs.value().size())}, {"output", output.str()}});
+  }
+
+  if (method == "cron.add") {
+    const std::string expression_raw = param_or(params, "expression");
+    const std::string command = param_or(params, "command");
+    if (expression_raw.empty() || command.empty()) {
+      return common::Result<ControlMap>::failure("expression and command are required");
+    }
+    auto expression = heartbeat::CronExpression::parse(expression_raw);
+    if (!expression.ok()) {
+      return common::Result<ControlMap>::failure(expression.error());
+    }
+    heartbeat::CronJob job;
+    job.id = param_or(params, "id", "job-" + std::to_string(std::time(nullptr)));
+    job.expression = expression_raw;
+    job.command = command;
+    job.next_run = expression.value().next_occurrence();
+    auto added = store.add_job(job);
+    if (!added.ok()) {
+      return common::Result<ControlMap>::failure(added.error());
+    }
+    return common::Result<ControlMap>::success(
+        {{"id", job.id}, {"output", "Added cron job: " + job.id + "\n"}});
+  }
+
+  if (method == "cron.remove") {
+    const std::string id = param_or(params, "id");
+    if (id.empty()) {
+      return common::Result<ControlMap>::failure("missing id");
+    }
+    auto removed = store.remove_job(id);
+    if (!removed.ok()) {
+      return common::Result<ControlMap>::failure(removed.error());
+    }
+    return common::Result<ControlMap>::success(
+        {{"removed", removed.value() ? "true" : "false"},
+         {"output", removed.value() ? "Removed\n" : "Not found\n"}});
+  }
+
+  return common::Result<ControlMap>::failure("unknown method: " + method);
+}
+
+} // namespace ghostclaw::daemon
@@ -1,9 +1,11 @@
 #include "ghostclaw/daemon/daemon.hpp"
 
 #include "ghostclaw/agent/engine.hpp"
+#include "ghostclaw/agent/message_queue.hpp"
 #include "ghostclaw/channels/channel_manager.hpp"
 #include "ghostclaw/common/fs.hpp"
 #include "ghostclaw/config/config.hpp"
+#include "ghostclaw/daemon/control.hpp"
 #include "ghostclaw/daemon/pid_file.hpp"
 #include "ghostclaw/daemon/state_writer.hpp"
 #include "ghostclaw/gateway/server.hpp"
@@ -11,9 +13,13 @@
 #include "ghostclaw/heartbeat/cron_store.hpp"
 #include "ghostclaw/heartbeat/engine.hpp"
 #include "ghostclaw/heartbeat/scheduler.hpp"
+#include "ghostclaw/mcp/fleet.hpp"
 #include "ghostclaw/observability/global.hpp"
+#include "ghostclaw/providers/batch.hpp"
 #include "ghostclaw/runtime/app.hpp"
+#include "ghostclaw/sessions/history.hpp"
 #include "ghostclaw/sessions/session_key.hpp"
+#include "ghostclaw/sessions/store.hpp"
 
 #include <algorithm>
 #include <chrono>
@@ -23,9 +29,35 @@
 #include <sstream>
 #include <system_error>
 #include <thread>
+#include <vector>
 
 namespace ghostclaw::daemon {
 
+namespace {
+
+// Keeps the session state (which holds the history summary) alongside the entry itself.
+void record_channel_entry(sessions::SessionStore *store, const std::string &session_id,
+                          const std::string &channel, const sessions::TranscriptRole role,
+                          const std::string &content) {
+  sessions::SessionState state;
+  state.session_id = session_id;
+  if (auto parsed = sessions::parse_session_key(session_id); parsed.ok()) {
+    state.agent_id = parsed.value().agent_id;
+    state.channel_id = parsed.value().channel_id;
+    state.peer_id = parsed.value().peer_id;
+  }
+  state.delivery_context = channel;
+  (void)store->upsert_state(state);
+
+  sessions::TranscriptEntry entry;
+  entry.role = role;
+  entry.content = content;
+  entry.metadata = {{"channel", channel}, {"source", "channel"}};
+  (void)store->append_transcript(session_id, entry);
+}
+
+} // namespace
+
 Daemon::Daemon(const config::Config &config) : config_(config) {}
 
 Daemon::~Daemon() { stop(); }
@@ -99,9 +131,34 @@ common::Status Daemon::start(const DaemonOptions &options) {
       return;
     }
 
+    // Channel turns keep a transcript like gateway sessions do, so the same summary plus
+    // recent-messages context carries a conversation across turns.
+    std::unique_ptr<sessions::SessionStore> session_store;
+    std::unique_ptr<sessions::SessionHistory> session_history;
+    if (config_.gateway.session_history_enabled) {
+      if (auto workspace = config::workspace_dir(); workspace.ok()) {
+        session_store = std::make_unique<sessions::SessionStore>(workspace.value() / "sessions");
+        sessions::HistoryOptions history_options;
+        history_options.recent_messages = config_.gateway.session_history_recent_messages;
+        history_options.summary_token_budget = config_.gateway.session_history_summary_tokens;
+        session_history = std::make_unique<sessions::SessionHistory>(
+            session_store.get(),
+            [agent = engine.value()](const std::string &previous, const std::string &messages,
+                                     const std::size_t budget) {
+              return agent->summarize_history(previous, messages, budget);
+            },
+            history_options);
+      }
+    }
+
     auto manager = channels::create_channel_manager(config_);
     auto run_mutex = std::make_shared<std::mutex>();
-    auto status = manager->start_all([&manager, &engine, run_mutex](const channels::ChannelMessage &msg) {
+    auto active_turns = std::make_shared<agent::ActiveTurns>();
+    const auto queue_mode =
+        agent::queue_mode_from_string(config_.channels.queue_mode).value_or(agent::QueueMode::Followup);
+    auto status = manager->start_all([&manager, &engine, &session_store, &session_history,
+                                      run_mutex, active_turns,
+                                      queue_mode](const channels::ChannelMessage &msg) {
       try {
         if (msg.content.empty()) {
           std::cerr << "[daemon][channels] skip empty message channel=" << msg.channel << "\n";
@@ -139,11 +196,31 @@ common::Status Daemon::start(const DaemonOptions &options) {
         options.agent_id = "ghostclaw";
         options.channel_id = msg.channel;
         options.tool_profile = "full";
+        // A turn waiting on approval parks and frees run_mutex; the reply resumes it.
+        options.park_on_approval = true;
+        const auto approval_reply = agent::parse_approval_reply(msg.content);
+
+        // Registered before waiting on run_mutex so a steering message can cancel both the
+        // running turn and any turn still queued for this session.
+        agent::ActiveTurn turn(*active_turns, session_key.value(), queue_mode);
+        options.cancel_token = turn.token();
 
         const auto response = [&]() {
           std::lock_guard<std::mutex> lock(*run_mutex);
+          if (approval_reply.has_value()) {
+            return engine.value()->resume(approval_reply->id, approval_reply->decision, options);
+          }
+          if (session_history) {
+            options.history_context = session_history->context_for(session_key.value());
+            record_channel_entry(session_store.get(), session_key.value(), msg.channel,
+                                 sessions::TranscriptRole::User, msg.content);
+          }
           return engine.value()->run(msg.content, options);
         }();
+        if (!response.ok() && turn.cancelled()) {
+          std::cerr << "[daemon][channels] superseded session=" << session_key.value() << "\n";
+          return;
+        }
         if (!response.ok()) {
           observability::record_error("channels", "agent_error: " + response.error());
           std::cerr << "[daemon][channels] agent_error session=" << session_key.value()
@@ -151,9 +228,19 @@ common::Status Daemon::start(const DaemonOptions &options) {
           return;
         }
 
+        if (session_history && !response.value().content.empty()) {
+          record_channel_entry(session_store.get(), session_key.value(), msg.channel,
+                               sessions::TranscriptRole::Assistant, response.value().content);
+          session_history->schedule_refresh(session_key.value());
+        }
+
         std::cerr << "[daemon][channels] agent_done session=" << session_key.value()
                   << " tool_calls=" << response.value().tool_results.size()
-                  << " latency_ms=" << response.value().duration.count() << "\n";
+                  << " latency_ms=" << response.value().duration.count()
+                  << (response.value().pending_approval_id.has_value()
+                          ? " approval=" + *response.value().pending_approval_id
+                          : std::string())
+                  << "\n";
 
         auto *channel = manager->get_channel(msg.channel);
         if (channel == nullptr) {
@@ -268,6 +355,18 @@ common::Status Daemon::start(const DaemonOptions &options) {
         std::chrono::milliseconds(config_.reliability.scheduler_poll_secs * 1000);
     scheduler_config.max_retries = config_.reliability.scheduler_retries;
 
+    // Workers sharing a workspace share the cron store, so only the holder of the runner
+    // lock fires jobs; a standby takes over when the holder exits.
+    const auto runner_path = workspace.value() / "cron" / "runner.lock";
+    auto runner = gateway::ClusterLock::try_acquire(runner_path);
+    while (!runner.held() && running_) {
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+      runner = gateway::ClusterLock::try_acquire(runner_path);
+    }
+    if (!runner.held()) {
+      return;
+    }
+
     heartbeat::Scheduler scheduler(store, *engine.value(), scheduler_config, &config_);
     scheduler.start();
     health::mark_component_ok("scheduler");
@@ -277,6 +376,80 @@ common::Status Daemon::start(const DaemonOptions &options) {
     scheduler.stop();
   }));
 
+  if (config_.daemon.control_socket_enabled) {
+    component_threads_.push_back(std::thread([this]() {
+      health::mark_component_starting("control");
+      auto workspace = config::workspace_dir();
+      if (!workspace.ok()) {
+        health::mark_component_error("control", workspace.error());
+        return;
+      }
+
+      // One warm engine serves every attached CLI invocation; a configured --provider gets
+      // its own. Engines refer to their context's config, so a context is kept only for an
+      // engine that was built, and lives as long as the service.
+      auto contexts = std::make_shared<std::vector<std::unique_ptr<runtime::RuntimeContext>>>();
+      ControlService service(
+          workspace.value(),
+          [this, contexts](const std::string &provider) {
+            auto context = std::make_unique<runtime::RuntimeContext>(config_);
+            if (!provider.empty()) {
+              context->mutable_config().default_provider = provider;
+            }
+            auto engine = context->create_agent_engine();
+            if (engine.ok()) {
+              contexts->push_back(std::move(context));
+            }
+            return engine;
+          },
+          configured_providers(config_));
+      ControlServer server(control_socket_path(config_),
+                           [&service](const std::string &method, const ControlMap &params,
+                                      const ControlEmit &emit) {
+                             return service.handle(method, params, emit);
+                           });
+      auto started = server.start();
+      if (!started.ok()) {
+        health::mark_component_error("control", started.error());
+        return;
+      }
+      auto warmed = service.warm();
+      if (warmed.ok()) {
+        health::mark_component_ok("control");
+      } else {
+        health::mark_component_error("control", warmed.error());
+      }
+      while (running_) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+      }
+      server.stop();
+    }));
+  }
+
+  if (!config_.mcp.servers.empty()) {
+    component_threads_.push_back(std::thread([this]() {
+      // Components share one MCP fleet; restart servers that died between tool calls.
+      constexpr auto kCheckInterval = std::chrono::seconds(30);
+      health::mark_component_ok("mcp");
+      auto next_check = std::chrono::steady_clock::now() + kCheckInterval;
+      while (running_) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        if (std::chrono::steady_clock::now() < next_check) {
+          continue;
+        }
+        next_check = std::chrono::steady_clock::now() + kCheckInterval;
+        auto &fleet = mcp::McpFleet::shared();
+        const std::size_t running = fleet.running_count();
+        if (fleet.check_health() < running) {
+          health::mark_component_error("mcp", "MCP server restart failed");
+          health::bump_component_restart("mcp");
+        } else {
+          health::mark_component_ok("mcp");
+        }
+      }
+    }));
+  }
+
   component_threads_.push_back(std::thread([this, pid, state_writer]() {
     while (running_) {
       std::this_thread::sleep_for(std::chrono::milliseconds(200));
@@ -303,6 +476,8 @@ void Daemon::stop() {
     }
   }
   component_threads_.clear();
+  // Heartbeat and cron turns are cancelled by now; fail whatever they left queued.
+  providers::BatchLane::shared().stop();
 }
 
 bool Daemon::is_running() const { return running_; }
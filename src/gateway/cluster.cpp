@@ -0,0 +1,360 @@
+#include "ghostclaw/gateway/cluster.hpp"
+
+#include "ghostclaw/common/fs.hpp"
+#include "ghostclaw/common/json_util.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+namespace ghostclaw::gateway {
+
+namespace {
+
+constexpr std::string_view kLeaseSuffix = ".worker";
+constexpr std::string_view kKeyFile = "cluster.key";
+constexpr std::string_view kSessionLockDir = "session-locks";
+constexpr std::uint64_t kSessionLockBuckets = 1024;
+
+std::int64_t now_ms() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+std::string sanitize_worker_id(std::string_view worker_id) {
+  std::string out;
+  out.reserve(worker_id.size());
+  for (const char ch : worker_id) {
+    if ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') ||
+        ch == '-' || ch == '_' || ch == '.') {
+      out.push_back(ch);
+    } else {
+      out.push_back('_');
+    }
+  }
+  return out.empty() ? "worker" : out;
+}
+
+std::uint64_t rendezvous_weight(std::string_view session_id, std::string_view worker_id) {
+  std::uint64_t hash = 14695981039346656037ULL;
+  auto mix = [&hash](const char ch) {
+    hash ^= static_cast<unsigned char>(ch);
+    hash *= 1099511628211ULL;
+  };
+  for (const char ch : session_id) {
+    mix(ch);
+  }
+  mix('\0');
+  for (const char ch : worker_id) {
+    mix(ch);
+  }
+  // splitmix64 finalizer so similar ids do not produce correlated weights.
+  hash ^= hash >> 30U;
+  hash *= 0xbf58476d1ce4e5b9ULL;
+  hash ^= hash >> 27U;
+  hash *= 0x94d049bb133111ebULL;
+  hash ^= hash >> 31U;
+  return hash;
+}
+
+std::int64_t parse_i64(const std::string &value) {
+  try {
+    return value.empty() ? 0 : static_cast<std::int64_t>(std::stoll(value));
+  } catch (...) {
+    return 0;
+  }
+}
+
+std::string read_key(const std::filesystem::path &path) {
+  std::ifstream in(path);
+  std::string key;
+  std::getline(in, key);
+  return common::trim(key);
+}
+
+// The key is written to a private temp file and hard-linked into place, so concurrent
+// first starts agree on whichever link lands first and never read a partial key.
+common::Result<std::string> load_or_create_key(const std::filesystem::path &dir) {
+  const auto path = dir / kKeyFile;
+  if (auto existing = read_key(path); !existing.empty()) {
+    return common::Result<std::string>::success(std::move(existing));
+  }
+
+  std::random_device random;
+  std::ostringstream key;
+  for (int i = 0; i < 8; ++i) {
+    key << std::hex << std::setw(8) << std::setfill('0') << random();
+  }
+  const auto temp = dir / (std::string(kKeyFile) + ".tmp." + std::to_string(now_ms()) + "." +
+                           std::to_string(random()));
+  {
+    std::ofstream out(temp, std::ios::trunc);
+    out << key.str() << "\n";
+  }
+  std::error_code ec;
+  std::filesystem::permissions(temp, std::filesystem::perms::owner_read |
+                                         std::filesystem::perms::owner_write,
+                               ec);
+  std::filesystem::create_hard_link(temp, path, ec);
+  std::filesystem::remove(temp, ec);
+
+  auto stored = read_key(path);
+  if (stored.empty()) {
+    return common::Result<std::string>::failure("failed to create " + path.string());
+  }
+  return common::Result<std::string>::success(std::move(stored));
+}
+
+} // namespace
+
+ClusterLock::ClusterLock(const std::filesystem::path &path, const bool wait) {
+#ifndef _WIN32
+  fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd_ < 0) {
+    return;
+  }
+  held_ = ::flock(fd_, wait ? LOCK_EX : LOCK_EX | LOCK_NB) == 0;
+  if (!held_) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+#else
+  (void)path;
+  (void)wait;
+  held_ = true;
+#endif
+}
+
+ClusterLock::~ClusterLock() { release(); }
+
+ClusterLock::ClusterLock(ClusterLock &&other) noexcept
+    : fd_(std::exchange(other.fd_, -1)), held_(std::exchange(other.held_, false)) {}
+
+ClusterLock &ClusterLock::operator=(ClusterLock &&other) noexcept {
+  if (this != &other) {
+    release();
+    fd_ = std::exchange(other.fd_, -1);
+    held_ = std::exchange(other.held_, false);
+  }
+  return *this;
+}
+
+ClusterLock ClusterLock::acquire(const std::filesystem::path &path) { return {path, true}; }
+
+ClusterLock ClusterLock::try_acquire(const std::filesystem::path &path) { return {path, false}; }
+
+void ClusterLock::release() {
+#ifndef _WIN32
+  if (fd_ >= 0) {
+    (void)::flock(fd_, LOCK_UN);
+    ::close(fd_);
+  }
+#endif
+  fd_ = -1;
+  held_ = false;
+}
+
+WorkerRegistry::WorkerRegistry(std::filesystem::path dir, const std::chrono::milliseconds lease_ttl)
+    : dir_(std::move(dir)), lease_ttl_(lease_ttl) {
+  std::error_code ec;
+  std::filesystem::create_directories(dir_, ec);
+}
+
+std::filesystem::path WorkerRegistry::lease_path(const std::string_view worker_id) const {
+  return dir_ / (sanitize_worker_id(worker_id) + std::string(kLeaseSuffix));
+}
+
+common::Status WorkerRegistry::heartbeat(const ClusterWorker &worker) const {
+  if (common::trim(worker.worker_id).empty()) {
+    return common::Status::error("worker_id is required");
+  }
+  const auto path = lease_path(worker.worker_id);
+  std::filesystem::path tmp = path;
+  tmp += ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::trunc);
+    if (!out) {
+      return common::Status::error("failed to open worker lease");
+    }
+    out << "{\"worker_id\":\"" << common::json_escape(worker.worker_id) << "\",\"endpoint\":\""
+        << common::json_escape(worker.endpoint) << "\",\"pid\":" << worker.pid
+        << ",\"heartbeat_ms\":" << (worker.heartbeat_ms > 0 ? worker.heartbeat_ms : now_ms())
+        << "}\n";
+    if (!out) {
+      return common::Status::error("failed writing worker lease");
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp, path, ec);
+  if (ec) {
+    return common::Status::error("failed replacing worker lease: " + ec.message());
+  }
+  return common::Status::success();
+}
+
+common::Status WorkerRegistry::remove(const std::string_view worker_id) const {
+  std::error_code ec;
+  std::filesystem::remove(lease_path(worker_id), ec);
+  if (ec) {
+    return common::Status::error("failed removing worker lease: " + ec.message());
+  }
+  return common::Status::success();
+}
+
+std::vector<ClusterWorker> WorkerRegistry::live_workers() const {
+  std::vector<ClusterWorker> workers;
+  std::error_code ec;
+  if (!std::filesystem::exists(dir_, ec)) {
+    return workers;
+  }
+  const std::int64_t cutoff = now_ms() - static_cast<std::int64_t>(lease_ttl_.count());
+  for (const auto &entry : std::filesystem::directory_iterator(dir_, ec)) {
+    if (!entry.is_regular_file() || entry.path().extension() != kLeaseSuffix) {
+      continue;
+    }
+    std::ifstream in(entry.path());
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    const std::string json = buffer.str();
+
+    ClusterWorker worker;
+    worker.worker_id = common::json_get_string(json, "worker_id");
+    worker.endpoint = common::json_get_string(json, "endpoint");
+    worker.pid = parse_i64(common::json_get_number(json, "pid"));
+    worker.heartbeat_ms = parse_i64(common::json_get_number(json, "heartbeat_ms"));
+    if (worker.worker_id.empty()) {
+      continue;
+    }
+    if (worker.heartbeat_ms < cutoff) {
+      // Expired lease: drop it so a crashed worker's sessions fail over.
+      std::error_code remove_ec;
+      std::filesystem::remove(entry.path(), remove_ec);
+      continue;
+    }
+    workers.push_back(std::move(worker));
+  }
+  std::sort(workers.begin(), workers.end(), [](const ClusterWorker &a, const ClusterWorker &b) {
+    return a.worker_id < b.worker_id;
+  });
+  return workers;
+}
+
+std::optional<ClusterWorker> route_session(const std::string_view session_id,
+                                           const std::vector<ClusterWorker> &workers) {
+  const ClusterWorker *best = nullptr;
+  std::uint64_t best_weight = 0;
+  for (const auto &worker : workers) {
+    const std::uint64_t weight = rendezvous_weight(session_id, worker.worker_id);
+    if (best == nullptr || weight > best_weight ||
+        (weight == best_weight && worker.worker_id < best->worker_id)) {
+      best = &worker;
+      best_weight = weight;
+    }
+  }
+  if (best == nullptr) {
+    return std::nullopt;
+  }
+  return *best;
+}
+
+ClusterCoordinator::ClusterCoordinator(std::filesystem::path dir, ClusterWorker self,
+                                       const std::chrono::milliseconds lease_ttl)
+    : registry_(dir, lease_ttl), dir_(std::move(dir)), self_(std::move(self)),
+      lease_ttl_(lease_ttl) {}
+
+ClusterCoordinator::~ClusterCoordinator() { stop(); }
+
+common::Status ClusterCoordinator::start() {
+  if (running_.exchange(true)) {
+    return common::Status::success();
+  }
+  auto status = registry_.heartbeat(self_);
+  if (status.ok()) {
+    auto key = load_or_create_key(dir_);
+    if (key.ok()) {
+      key_ = std::move(key.value());
+    } else {
+      status = common::Status::error(key.error());
+    }
+  }
+  if (!status.ok()) {
+    running_ = false;
+    return status;
+  }
+  refresh();
+  heartbeat_thread_ = std::thread([this]() { heartbeat_loop(); });
+  return common::Status::success();
+}
+
+void ClusterCoordinator::stop() {
+  if (!running_.exchange(false)) {
+    return;
+  }
+  cv_.notify_all();
+  if (heartbeat_thread_.joinable()) {
+    heartbeat_thread_.join();
+  }
+  (void)registry_.remove(self_.worker_id);
+}
+
+void ClusterCoordinator::refresh() {
+  auto members = registry_.live_workers();
+  const bool has_self =
+      std::any_of(members.begin(), members.end(),
+                  [&](const ClusterWorker &worker) { return worker.worker_id == self_.worker_id; });
+  if (!has_self && running_) {
+    members.push_back(self_);
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  members_ = std::move(members);
+}
+
+void ClusterCoordinator::heartbeat_loop() {
+  // Renew at a third of the lease so one missed beat does not expire us.
+  const auto interval = std::max(std::chrono::milliseconds(50), lease_ttl_ / 3);
+  while (running_) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait_for(lock, interval, [this]() { return !running_; });
+    }
+    if (!running_) {
+      break;
+    }
+    (void)registry_.heartbeat(self_);
+    refresh();
+  }
+}
+
+std::optional<ClusterWorker> ClusterCoordinator::remote_owner(const std::string_view session_id) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto owner = route_session(session_id, members_);
+  if (!owner.has_value() || owner->worker_id == self_.worker_id) {
+    return std::nullopt;
+  }
+  return owner;
+}
+
+std::vector<ClusterWorker> ClusterCoordinator::members() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return members_;
+}
+
+ClusterLock ClusterCoordinator::lock_session(const std::string_view session_id) const {
+  const auto dir = dir_ / kSessionLockDir;
+  std::error_code ec;
+  std::filesystem::create_directories(dir, ec);
+  const std::uint64_t bucket = rendezvous_weight(session_id, kSessionLockDir) % kSessionLockBuckets;
+  return ClusterLock::acquire(dir / (std::to_string(bucket) + ".lock"));
+}
+
+} // namespace ghostclaw::gateway
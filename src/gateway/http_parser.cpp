@@ -0,0 +1,444 @@
+#include "ghostclaw/gateway/http_parser.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace ghostclaw::gateway {
+
+namespace {
+
+// Chunk-size lines carry at most a hex length and short extensions.
+constexpr std::size_t kMaxChunkLine = 1024;
+
+bool is_tchar(const char ch) {
+  if ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9')) {
+    return true;
+  }
+  return std::strchr("!#$%&'*+-.^_`|~", ch) != nullptr && ch != '\0';
+}
+
+bool is_token(const std::string_view text) {
+  return !text.empty() && std::all_of(text.begin(), text.end(), is_tchar);
+}
+
+char lower(const char ch) { return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch + 32) : ch; }
+
+bool iequals(const std::string_view a, const std::string_view b) {
+  return a.size() == b.size() &&
+         std::equal(a.begin(), a.end(), b.begin(),
+                    [](const char x, const char y) { return lower(x) == lower(y); });
+}
+
+std::string_view trim_ows(std::string_view text) {
+  while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+    text.remove_prefix(1);
+  }
+  while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) {
+    text.remove_suffix(1);
+  }
+  return text;
+}
+
+// True when the comma-separated list `value` contains `token`.
+bool has_token(std::string_view value, const std::string_view token) {
+  while (!value.empty()) {
+    const auto comma = value.find(',');
+    if (iequals(trim_ows(value.substr(0, comma)), token)) {
+      return true;
+    }
+    if (comma == std::string_view::npos) {
+      break;
+    }
+    value.remove_prefix(comma + 1);
+  }
+  return false;
+}
+
+std::optional<std::size_t> parse_decimal(const std::string_view text) {
+  if (text.empty()) {
+    return std::nullopt;
+  }
+  std::size_t value = 0;
+  for (const char ch : text) {
+    if (ch < '0' || ch > '9') {
+      return std::nullopt;
+    }
+    const auto digit = static_cast<std::size_t>(ch - '0');
+    if (value > (std::numeric_limits<std::size_t>::max() - digit) / 10) {
+      return std::nullopt;
+    }
+    value = value * 10 + digit;
+  }
+  return value;
+}
+
+std::optional<std::size_t> parse_hex(const std::string_view text) {
+  if (text.empty()) {
+    return std::nullopt;
+  }
+  std::size_t value = 0;
+  for (const char ch : text) {
+    std::size_t digit = 0;
+    if (ch >= '0' && ch <= '9') {
+      digit = static_cast<std::size_t>(ch - '0');
+    } else if (lower(ch) >= 'a' && lower(ch) <= 'f') {
+      digit = static_cast<std::size_t>(lower(ch) - 'a' + 10);
+    } else {
+      return std::nullopt;
+    }
+    if (value > (std::numeric_limits<std::size_t>::max() >> 4)) {
+      return std::nullopt;
+    }
+    value = (value << 4) | digit;
+  }
+  return value;
+}
+
+} // namespace
+
+std::optional<std::string_view> HttpRequestView::header(const std::string_view name) const {
+  for (const auto &header : headers) {
+    if (iequals(header.name, name)) {
+      return header.value;
+    }
+  }
+  return std::nullopt;
+}
+
+HttpRequestParser::HttpRequestParser(const HttpParserLimits limits)
+    : limits_(limits),
+      // Head and trailers at their limits, the body, and room for chunk framing.
+      capacity_(2 * limits.max_head_bytes + limits.max_body_bytes + kMaxChunkLine) {
+  data_ = std::make_unique<char[]>(capacity_);
+  request_.headers.reserve(limits_.max_headers);
+}
+
+std::span<char> HttpRequestParser::buffer() {
+  return {data_.get() + size_, capacity_ - size_};
+}
+
+HttpParseStatus HttpRequestParser::commit(const std::size_t bytes) {
+  size_ += std::min(bytes, capacity_ - size_);
+  if (state_ == State::Done || state_ == State::Failed) {
+    return status();
+  }
+  const auto result = parse();
+  if (result == HttpParseStatus::NeedMore && size_ == capacity_) {
+    return fail(413, "request exceeds buffer");
+  }
+  return result;
+}
+
+std::size_t HttpRequestParser::feed(const std::string_view bytes) {
+  const auto space = buffer();
+  const std::size_t taken = std::min(space.size(), bytes.size());
+  std::memcpy(space.data(), bytes.data(), taken);
+  (void)commit(taken);
+  return taken;
+}
+
+HttpParseStatus HttpRequestParser::consume() {
+  if (state_ != State::Done) {
+    return status();
+  }
+  const std::size_t leftover = size_ - pos_;
+  std::memmove(data_.get(), data_.get() + pos_, leftover);
+  size_ = leftover;
+  pos_ = 0;
+  scan_ = 0;
+  section_start_ = 0;
+  body_start_ = 0;
+  body_end_ = 0;
+  remaining_ = 0;
+  content_length_.reset();
+  chunked_ = false;
+  state_ = State::RequestLine;
+  request_.method = {};
+  request_.target = {};
+  request_.version_minor = 1;
+  request_.headers.clear();
+  request_.body = {};
+  request_.keep_alive = true;
+  return parse();
+}
+
+HttpParseStatus HttpRequestParser::status() const {
+  switch (state_) {
+  case State::Done:
+    return HttpParseStatus::Complete;
+  case State::Failed:
+    return HttpParseStatus::Error;
+  default:
+    return HttpParseStatus::NeedMore;
+  }
+}
+
+bool HttpRequestParser::has_pipelined() const { return state_ == State::Done && pos_ < size_; }
+
+HttpParseStatus HttpRequestParser::fail(const int status, const std::string_view message) {
+  state_ = State::Failed;
+  error_status_ = status;
+  error_ = message;
+  return HttpParseStatus::Error;
+}
+
+std::optional<std::string_view> HttpRequestParser::next_line() {
+  const char *begin = data_.get();
+  const void *found = std::memchr(begin + scan_, '\n', size_ - scan_);
+  if (found == nullptr) {
+    scan_ = size_;
+    return std::nullopt;
+  }
+  const auto end = static_cast<std::size_t>(static_cast<const char *>(found) - begin);
+  std::string_view line(begin + pos_, end - pos_);
+  if (!line.empty() && line.back() == '\r') {
+    line.remove_suffix(1);
+  }
+  pos_ = end + 1;
+  scan_ = pos_;
+  return line;
+}
+
+bool HttpRequestParser::parse_request_line(const std::string_view line) {
+  const auto first = line.find(' ');
+  const auto second = first == std::string_view::npos ? first : line.find(' ', first + 1);
+  if (second == std::string_view::npos || line.find(' ', second + 1) != std::string_view::npos) {
+    return false;
+  }
+  request_.method = line.substr(0, first);
+  request_.target = line.substr(first + 1, second - first - 1);
+  const auto version = line.substr(second + 1);
+  if (!is_token(request_.method) || request_.target.empty()) {
+    return false;
+  }
+  for (const char ch : request_.target) {
+    if (static_cast<unsigned char>(ch) <= 0x20 || ch == 0x7f) {
+      return false;
+    }
+  }
+  if (version.size() != 8 || version.substr(0, 7) != "HTTP/1.") {
+    error_status_ = version.substr(0, 5) == "HTTP/" ? 505 : 400;
+    return false;
+  }
+  if (version[7] != '0' && version[7] != '1') {
+    error_status_ = 505;
+    return false;
+  }
+  request_.version_minor = version[7] - '0';
+  request_.keep_alive = request_.version_minor == 1;
+  return true;
+}
+
+bool HttpRequestParser::parse_header(const std::string_view line) {
+  // Obsolete line folding is a smuggling vector, so it is refused (RFC 9112 5.2).
+  if (line.front() == ' ' || line.front() == '\t') {
+    return false;
+  }
+  const auto colon = line.find(':');
+  if (colon == std::string_view::npos || !is_token(line.substr(0, colon))) {
+    return false;
+  }
+  const HttpHeaderView header{line.substr(0, colon), trim_ows(line.substr(colon + 1))};
+  for (const char ch : header.value) {
+    if ((static_cast<unsigned char>(ch) < 0x20 && ch != '\t') || ch == 0x7f) {
+      return false;
+    }
+  }
+
+  if (iequals(header.name, "content-length")) {
+    const auto length = parse_decimal(header.value);
+    if (!length.has_value() || (content_length_.has_value() && *content_length_ != *length)) {
+      return false;
+    }
+    content_length_ = length;
+  } else if (iequals(header.name, "transfer-encoding")) {
+    // Only a plain "chunked" is understood; anything else cannot be framed.
+    if (!iequals(header.value, "chunked") || chunked_) {
+      error_status_ = 501;
+      return false;
+    }
+    chunked_ = true;
+  } else if (iequals(header.name, "connection")) {
+    if (has_token(header.value, "close")) {
+      request_.keep_alive = false;
+    } else if (has_token(header.value, "keep-alive")) {
+      request_.keep_alive = true;
+    }
+  }
+  request_.headers.push_back(header);
+  return true;
+}
+
+HttpParseStatus HttpRequestParser::start_body() {
+  if (chunked_ && content_length_.has_value()) {
+    return fail(400, "both Content-Length and Transfer-Encoding");
+  }
+  body_start_ = pos_;
+  body_end_ = pos_;
+  if (chunked_) {
+    state_ = State::ChunkSize;
+    return HttpParseStatus::NeedMore;
+  }
+  remaining_ = content_length_.value_or(0);
+  if (remaining_ > limits_.max_body_bytes) {
+    return fail(413, "body too large");
+  }
+  state_ = State::Body;
+  return HttpParseStatus::NeedMore;
+}
+
+void HttpRequestParser::finish() {
+  request_.body = std::string_view(data_.get() + body_start_, body_end_ - body_start_);
+  state_ = State::Done;
+}
+
+void HttpRequestParser::compact_chunked() {
+  // Moves unparsed bytes down over the framing already decoded, so long chunked bodies
+  // only ever occupy their decoded size.
+  if (pos_ == body_end_) {
+    return;
+  }
+  const std::size_t shift = pos_ - body_end_;
+  std::memmove(data_.get() + body_end_, data_.get() + pos_, size_ - pos_);
+  size_ -= shift;
+  scan_ -= shift;
+  pos_ = body_end_;
+}
+
+HttpParseStatus HttpRequestParser::parse() {
+  while (true) {
+    switch (state_) {
+    case State::RequestLine: {
+      const auto line = next_line();
+      if (!line.has_value()) {
+        if (size_ - section_start_ > limits_.max_head_bytes) {
+          return fail(431, "request line too long");
+        }
+        return HttpParseStatus::NeedMore;
+      }
+      if (line->empty()) {
+        // Tolerate stray line breaks between pipelined requests (RFC 9112 2.2).
+        section_start_ = pos_;
+        continue;
+      }
+      if (!parse_request_line(*line)) {
+        return fail(error_status_ != 0 ? error_status_ : 400, "invalid request line");
+      }
+      state_ = State::Headers;
+      continue;
+    }
+    case State::Headers: {
+      const auto line = next_line();
+      if (!line.has_value()) {
+        if (size_ - section_start_ > limits_.max_head_bytes) {
+          return fail(431, "headers too large");
+        }
+        return HttpParseStatus::NeedMore;
+      }
+      if (pos_ - section_start_ > limits_.max_head_bytes) {
+        return fail(431, "headers too large");
+      }
+      if (line->empty()) {
+        if (start_body() == HttpParseStatus::Error) {
+          return HttpParseStatus::Error;
+        }
+        continue;
+      }
+      if (request_.headers.size() >= limits_.max_headers) {
+        return fail(431, "too many headers");
+      }
+      if (!parse_header(*line)) {
+        return fail(error_status_ != 0 ? error_status_ : 400, "invalid header");
+      }
+      continue;
+    }
+    case State::Body: {
+      if (size_ - body_start_ < remaining_) {
+        return HttpParseStatus::NeedMore;
+      }
+      pos_ = body_start_ + remaining_;
+      body_end_ = pos_;
+      scan_ = pos_;
+      finish();
+      return HttpParseStatus::Complete;
+    }
+    case State::ChunkSize: {
+      const auto line = next_line();
+      if (!line.has_value()) {
+        compact_chunked();
+        if (size_ - pos_ > kMaxChunkLine) {
+          return fail(400, "chunk size line too long");
+        }
+        return HttpParseStatus::NeedMore;
+      }
+      const auto size = parse_hex(trim_ows(line->substr(0, line->find(';'))));
+      if (!size.has_value()) {
+        return fail(400, "invalid chunk size");
+      }
+      if (*size > limits_.max_body_bytes - (body_end_ - body_start_)) {
+        return fail(413, "body too large");
+      }
+      if (*size == 0) {
+        state_ = State::Trailers;
+        section_start_ = pos_;
+        continue;
+      }
+      remaining_ = *size;
+      state_ = State::ChunkData;
+      continue;
+    }
+    case State::ChunkData: {
+      const std::size_t take = std::min(remaining_, size_ - pos_);
+      std::memmove(data_.get() + body_end_, data_.get() + pos_, take);
+      body_end_ += take;
+      pos_ += take;
+      scan_ = pos_;
+      remaining_ -= take;
+      if (remaining_ > 0) {
+        compact_chunked();
+        return HttpParseStatus::NeedMore;
+      }
+      state_ = State::ChunkEnd;
+      continue;
+    }
+    case State::ChunkEnd: {
+      const auto line = next_line();
+      if (!line.has_value()) {
+        compact_chunked();
+        if (size_ - pos_ > 2) {
+          return fail(400, "missing chunk terminator");
+        }
+        return HttpParseStatus::NeedMore;
+      }
+      if (!line->empty()) {
+        return fail(400, "missing chunk terminator");
+      }
+      state_ = State::ChunkSize;
+      continue;
+    }
+    case State::Trailers: {
+      // Trailer fields are read past and dropped.
+      const auto line = next_line();
+      if (!line.has_value()) {
+        if (size_ - section_start_ > limits_.max_head_bytes) {
+          return fail(431, "trailers too large");
+        }
+        return HttpParseStatus::NeedMore;
+      }
+      if (!line->empty()) {
+        continue;
+      }
+      // The decoded body stays where it is; the request ends after the trailers.
+      finish();
+      return HttpParseStatus::Complete;
+    }
+    case State::Done:
+      return HttpParseStatus::Complete;
+    case State::Failed:
+      return HttpParseStatus::Error;
+    }
+  }
+}
+
+} // namespace ghostclaw::gateway
@@ -2,6 +2,8 @@
 
 #include "ghostclaw/common/fs.hpp"
 #include "ghostclaw/common/json_util.hpp"
+#include "ghostclaw/providers/admission.hpp"
+#include "ghostclaw/providers/batch.hpp"
 #include "ghostclaw/providers/traits.hpp"
 #include "ghostclaw/sessions/session_key.hpp"
 
@@ -13,6 +15,9 @@ namespace ghostclaw::gateway {
 
 namespace {
 
+constexpr std::uint64_t kDefaultHistoryPage = 50;
+constexpr std::uint64_t kMaxHistoryPage = 500;
+
 std::string to_json_object(const RpcMap &map) {
   std::ostringstream out;
   out << "{";
@@ -126,6 +131,17 @@ void append_transcript_entry(sessions::SessionStore *store, const std::string &s
   (void)store->append_transcript(session_id, entry);
 }
 
+void add_session_usage_fields(RpcMap &map, const sessions::SessionUsage &usage) {
+  map["turns"] = std::to_string(usage.turns);
+  map["prompt_tokens"] = std::to_string(usage.prompt_tokens);
+  map["completion_tokens"] = std::to_string(usage.completion_tokens);
+  map["cached_prompt_tokens"] = std::to_string(usage.cached_prompt_tokens);
+  map["total_tokens"] = std::to_string(usage.prompt_tokens + usage.completion_tokens);
+  map["tool_calls"] = std::to_string(usage.tool_calls);
+  map["tool_ms"] = std::to_string(usage.tool_ms);
+  map["latency_ms"] = std::to_string(usage.latency_ms);
+}
+
 } // namespace
 
 std::string RpcResponse::to_json() const {
@@ -154,6 +170,9 @@ std::string WsServerMessage::to_json() const {
   if (error.has_value()) {
     out << ",\"error\":\"" << common::json_escape(*error) << "\"";
   }
+  if (seq != 0) {
+    out << ",\"seq\":" << seq;
+  }
   if (!payload.empty()) {
     out << ",\"payload\":" << to_json_object(payload);
   }
@@ -252,6 +271,14 @@ common::Result<WsClientMessage> parse_ws_client_message(const std::string &json)
       message.payload["temperature"] = numeric_temperature;
     }
   }
+  const std::string action = find_json_string_field(json, "action");
+  if (!action.empty()) {
+    message.payload["action"] = action;
+  }
+  const std::string args_json = find_json_string_field(json, "args_json");
+  if (!args_json.empty()) {
+    message.payload["args_json"] = args_json;
+  }
   const std::string key = find_json_string_field(json, "key");
   if (!key.empty()) {
     message.payload["key"] = key;
@@ -265,15 +292,48 @@ common::Result<WsClientMessage> parse_ws_client_message(const std::string &json)
       message.payload["limit"] = numeric_limit;
     }
   }
+  for (const char *field : {"since", "before", "after"}) {
+    const std::string value = find_json_numeric_field(json, field);
+    if (!value.empty()) {
+      message.payload[field] = value;
+    }
+  }
   if (!message.session.empty()) {
     message.payload["session_id"] = message.session;
   }
   return common::Result<WsClientMessage>::success(std::move(message));
 }
 
+void record_turn_usage(sessions::SessionStore *store, const std::string &session_id,
+                       const agent::AgentResponse &response) {
+  if (store == nullptr || session_id.empty()) {
+    return;
+  }
+  sessions::SessionUsage turn;
+  turn.turns = 1;
+  turn.prompt_tokens = response.usage.prompt_tokens;
+  turn.completion_tokens = response.usage.completion_tokens;
+  turn.cached_prompt_tokens = response.usage.cached_prompt_tokens;
+  turn.tool_calls = response.tool_results.size();
+  for (const auto &tool_result : response.tool_results) {
+    turn.tool_ms += static_cast<std::uint64_t>(tool_result.duration.count());
+  }
+  turn.latency_ms = static_cast<std::uint64_t>(response.duration.count());
+  (void)store->record_usage(session_id, turn);
+}
+
+void add_turn_usage_fields(RpcMap &map, const agent::AgentResponse &response) {
+  map["prompt_tokens"] = std::to_string(response.usage.prompt_tokens);
+  map["completion_tokens"] = std::to_string(response.usage.completion_tokens);
+  map["cached_prompt_tokens"] = std::to_string(response.usage.cached_prompt_tokens);
+  map["total_tokens"] = std::to_string(response.usage.total_tokens);
+}
+
 RpcHandler::RpcHandler(std::shared_ptr<agent::AgentEngine> agent, memory::IMemory *memory,
-                       sessions::SessionStore *session_store, const config::Config &config)
-    : agent_(std::move(agent)), memory_(memory), session_store_(session_store), config_(config) {}
+                       sessions::SessionStore *session_store, const config::Config &config,
+                       sessions::SessionHistory *history)
+    : agent_(std::move(agent)), memory_(memory), session_store_(session_store), config_(config),
+      history_(history) {}
 
 RpcResponse RpcHandler::handle(const RpcRequest &request) {
   if (request.method == "agent.run") {
@@ -297,9 +357,27 @@ RpcResponse RpcHandler::handle(const RpcRequest &request) {
   if (request.method == "session.group.list") {
     return handle_session_group_list(request);
   }
+  if (request.method == "session.usage") {
+    return handle_session_usage(request);
+  }
+  if (request.method == "router.stats") {
+    return handle_router_stats(request);
+  }
+  if (request.method == "providers.admission") {
+    return handle_admission_stats(request);
+  }
+  if (request.method == "providers.batch") {
+    return handle_batch_stats(request);
+  }
   if (request.method == "health") {
     return handle_health(request);
   }
+  if (request.method == "approval.list") {
+    return handle_approval_list(request);
+  }
+  if (request.method == "approval.resolve") {
+    return handle_approval_resolve(request);
+  }
 
   return RpcResponse{.id = request.id, .error = "unknown method: " + request.method};
 }
@@ -399,6 +477,8 @@ RpcResponse RpcHandler::handle_agent_run(const RpcRequest &request) {
 
   upsert_session_state(session_store_, session_id, effective_model, thinking_level, delivery_context,
                        group_id);
+  const std::string history =
+      history_ != nullptr ? history_->context_for(session_id) : std::string();
   append_transcript_entry(session_store_, session_id, sessions::TranscriptRole::User, message,
                           effective_model,
                           {{"channel", channel},
@@ -409,6 +489,8 @@ RpcResponse RpcHandler::handle_agent_run(const RpcRequest &request) {
 
   agent::AgentOptions options;
   options.model_override = effective_model;
+  options.history_context = history;
+  options.park_on_approval = true;
   const auto temperature_it = request.params.find("temperature");
   if (temperature_it != request.params.end() && !temperature_it->second.empty()) {
     try {
@@ -444,17 +526,26 @@ RpcResponse RpcHandler::handle_agent_run(const RpcRequest &request) {
                            {"group_id", group_id}});
   upsert_session_state(session_store_, session_id, effective_model, thinking_level, delivery_context,
                        group_id);
+  record_turn_usage(session_store_, session_id, result.value());
+  if (history_ != nullptr) {
+    history_->schedule_refresh(session_id);
+  }
 
   RpcMap map;
   map["content"] = result.value().content;
   map["duration_ms"] = std::to_string(result.value().duration.count());
   map["tool_calls"] = std::to_string(result.value().tool_results.size());
+  add_turn_usage_fields(map, result.value());
   map["session_id"] = session_id;
   map["model"] = effective_model;
   map["thinking_level"] = thinking_level;
   if (!group_id.empty()) {
     map["group_id"] = group_id;
   }
+  if (result.value().pending_approval_id.has_value()) {
+    map["approval_id"] = *result.value().pending_approval_id;
+    map["approval_command"] = result.value().pending_approval_command;
+  }
   return RpcResponse{.id = request.id, .result = std::move(map)};
 }
 
@@ -507,40 +598,52 @@ RpcResponse RpcHandler::handle_session_history(const RpcRequest &request) const
   if (session_it == request.params.end() || common::trim(session_it->second).empty()) {
     return RpcResponse{.id = request.id, .error = "missing session_id param"};
   }
-  std::size_t limit = 50;
-  const auto limit_it = request.params.find("limit");
-  if (limit_it != request.params.end()) {
+  const auto param_u64 = [&](const std::string &key, const std::uint64_t fallback) {
+    const auto it = request.params.find(key);
+    if (it == request.params.end()) {
+      return fallback;
+    }
     try {
-      limit = static_cast<std::size_t>(std::stoull(limit_it->second));
+      return static_cast<std::uint64_t>(std::stoull(it->second));
     } catch (...) {
-      limit = 50;
+      return fallback;
     }
-  }
+  };
+  // One page has to fit comfortably in a single websocket frame, so "all" (0) and larger
+  // limits are capped.
+  const std::uint64_t limit = param_u64("limit", kDefaultHistoryPage);
+  sessions::TranscriptCursor cursor;
+  cursor.limit = static_cast<std::size_t>(
+      limit == 0 ? kMaxHistoryPage : std::min(limit, kMaxHistoryPage));
+  cursor.before = param_u64("before", 0);
+  cursor.after = param_u64("after", 0);
   const std::string session_id = common::trim(session_it->second);
-  auto entries = session_store_->load_transcript(session_id, limit);
-  if (!entries.ok()) {
-    return RpcResponse{.id = request.id, .error = entries.error()};
+  auto page = session_store_->load_transcript_page(session_id, cursor);
+  if (!page.ok()) {
+    return RpcResponse{.id = request.id, .error = page.error()};
   }
+  const auto &entries = page.value().entries;
   std::ostringstream history;
   history << "[";
-  for (std::size_t i = 0; i < entries.value().size(); ++i) {
+  for (std::size_t i = 0; i < entries.size(); ++i) {
     if (i > 0) {
       history << ",";
     }
     history << "{";
+    history << "\"id\":" << entries[i].id << ",";
     history << "\"role\":\""
-            << common::json_escape(sessions::role_to_string(entries.value()[i].role))
+            << common::json_escape(sessions::role_to_string(entries[i].role))
             << "\",";
-    history << "\"content\":\"" << common::json_escape(entries.value()[i].content) << "\",";
-    history << "\"timestamp\":\"" << common::json_escape(entries.value()[i].timestamp)
+    history << "\"content\":\"" << common::json_escape(entries[i].content) << "\",";
+    history << "\"timestamp\":\"" << common::json_escape(entries[i].timestamp)
             << "\"";
-    if (entries.value()[i].model.has_value() && !entries.value()[i].model->empty()) {
-      history << ",\"model\":\"" << common::json_escape(*entries.value()[i].model) << "\"";
+    if (entries[i].model.has_value() && !entries[i].model->empty()) {
+      history << ",\"model\":\"" << common::json_escape(*entries[i].model) << "\"";
     }
-    if (!entries.value()[i].metadata.empty()) {
+    if (!entries[i].metadata.empty()) {
       history << ",\"metadata\":{";
       bool first_meta = true;
-      for (const auto &[meta_key, meta_value] : entries.value()[i].metadata) {
+      for (const auto &[meta_key, meta_value] : entries[i].metadata) {
         if (!first_meta) {
           history << ",";
         }
@@ -550,31 +653,31 @@ RpcResponse RpcHandler::handle_session_history(const RpcRequest &request) const
       }
       history << "}";
     }
-    if (entries.value()[i].input_provenance.has_value() &&
-        !common::trim(entries.value()[i].input_provenance->kind).empty()) {
+    if (entries[i].input_provenance.has_value() &&
+        !common::trim(entries[i].input_provenance->kind).empty()) {
       history << ",\"input_provenance\":{";
       history << "\"kind\":\""
-              << common::json_escape(entries.value()[i].input_provenance->kind) << "\"";
-      if (entries.value()[i].input_provenance->source_session_id.has_value()) {
+              << common::json_escape(entries[i].input_provenance->kind) << "\"";
+      if (entries[i].input_provenance->source_session_id.has_value()) {
         history << ",\"source_session_id\":\""
                 << common::json_escape(
-                       *entries.value()[i].input_provenance->source_session_id)
+                       *entries[i].input_provenance->source_session_id)
                 << "\"";
       }
-      if (entries.value()[i].input_provenance->source_channel.has_value()) {
+      if (entries[i].input_provenance->source_channel.has_value()) {
         history << ",\"source_channel\":\""
-                << common::json_escape(*entries.value()[i].input_provenance->source_channel)
+                << common::json_escape(*entries[i].input_provenance->source_channel)
                 << "\"";
       }
-      if (entries.value()[i].input_provenance->source_tool.has_value()) {
+      if (entries[i].input_provenance->source_tool.has_value()) {
         history << ",\"source_tool\":\""
-                << common::json_escape(*entries.value()[i].input_provenance->source_tool)
+                << common::json_escape(*entries[i].input_provenance->source_tool)
                 << "\"";
       }
-      if (entries.value()[i].input_provenance->source_message_id.has_value()) {
+      if (entries[i].input_provenance->source_message_id.has_value()) {
         history << ",\"source_message_id\":\""
                 << common::json_escape(
-                       *entries.value()[i].input_provenance->source_message_id)
+                       *entries[i].input_provenance->source_message_id)
                 << "\"";
       }
       history << "}";
@@ -586,10 +689,15 @@ RpcResponse RpcHandler::handle_session_history(const RpcRequest &request) const
   RpcMap map;
   map["session_id"] = session_id;
   map["entries_json"] = history.str();
-  map["count"] = std::to_string(entries.value().size());
-  if (!entries.value().empty()) {
-    map["last_role"] = sessions::role_to_string(entries.value().back().role);
-    map["last_content"] = entries.value().back().content;
+  map["count"] = std::to_string(entries.size());
+  map["total"] = std::to_string(page.value().total);
+  map["has_more_before"] = page.value().has_more_before ? "true" : "false";
+  map["has_more_after"] = page.value().has_more_after ? "true" : "false";
+  if (!entries.empty()) {
+    map["first_id"] = std::to_string(entries.front().id);
+    map["last_id"] = std::to_string(entries.back().id);
+    map["last_role"] = sessions::role_to_string(entries.back().role);
+    map["last_content"] = entries.back().content;
   }
   return RpcResponse{.id = request.id, .result = std::move(map)};
 }
@@ -723,6 +831,182 @@ RpcResponse RpcHandler::handle_session_group_list(const RpcRequest &request) con
   return RpcResponse{.id = request.id, .result = std::move(map)};
 }
 
+RpcResponse RpcHandler::handle_session_usage(const RpcRequest &request) const {
+  if (session_store_ == nullptr) {
+    return RpcResponse{.id = request.id, .error = "session store unavailable"};
+  }
+
+  RpcMap map;
+  const auto session_it = request.params.find("session_id");
+  if (session_it != request.params.end() && !common::trim(session_it->second).empty()) {
+    const auto channel_it = request.params.find("channel");
+    const std::string channel =
+        (channel_it != request.params.end() && !channel_it->second.empty())
+            ? common::trim(channel_it->second)
+            : "rpc";
+    const std::string session_id = normalize_session_id(common::trim(session_it->second), channel,
+                                                        common::trim(session_it->second));
+    auto state = session_store_->get_state(session_id);
+    if (!state.ok()) {
+      return RpcResponse{.id = request.id, .error = state.error()};
+    }
+    map["session_id"] = state.value().session_id;
+    map["channel"] = state.value().channel_id;
+    add_session_usage_fields(map, state.value().usage);
+    return RpcResponse{.id = request.id, .result = std::move(map)};
+  }
+
+  auto by_channel = session_store_->usage_by_channel();
+  if (!by_channel.ok()) {
+    return RpcResponse{.id = request.id, .error = by_channel.error()};
+  }
+  const auto channel_it = request.params.find("channel");
+  if (channel_it != request.params.end() && !common::trim(channel_it->second).empty()) {
+    const std::string channel = common::trim(channel_it->second);
+    const auto found = by_channel.value().find(channel);
+    map["channel"] = channel;
+    add_session_usage_fields(map, found != by_channel.value().end() ? found->second
+                                                                    : sessions::SessionUsage{});
+    return RpcResponse{.id = request.id, .result = std::move(map)};
+  }
+
+  std::vector<std::string> channels;
+  sessions::SessionUsage total;
+  for (const auto &[channel, usage] : by_channel.value()) {
+    channels.push_back(channel);
+    total += usage;
+  }
+  std::sort(channels.begin(), channels.end());
+  map["count"] = std::to_string(channels.size());
+  for (std::size_t i = 0; i < channels.size(); ++i) {
+    map["channel_" + std::to_string(i)] = channels[i];
+  }
+  add_session_usage_fields(map, total);
+  return RpcResponse{.id = request.id, .result = std::move(map)};
+}
+
+RpcResponse RpcHandler::handle_router_stats(const RpcRequest &request) const {
+  const auto stats = agent_ != nullptr ? agent_->router_stats() : std::nullopt;
+  if (!stats.has_value()) {
+    return RpcResponse{.id = request.id, .error = "model router disabled"};
+  }
+  const auto average = [](const std::uint64_t total_ms, const std::uint64_t turns) {
+    return std::to_string(turns == 0 ? 0 : total_ms / turns);
+  };
+  RpcMap map;
+  map["fast_model"] = config_.router.fast_model;
+  map["fast_turns"] = std::to_string(stats->fast_turns);
+  map["strong_turns"] = std::to_string(stats->strong_turns);
+  map["escalations"] = std::to_string(stats->escalations);
+  map["classifier_calls"] = std::to_string(stats->classifier_calls);
+  map["fast_avg_latency_ms"] = average(stats->fast_latency_ms, stats->fast_turns);
+  map["strong_avg_latency_ms"] = average(stats->strong_latency_ms, stats->strong_turns);
+  map["fast_total_tokens"] = std::to_string(stats->fast_usage.total_tokens());
+  map["strong_total_tokens"] = std::to_string(stats->strong_usage.total_tokens());
+  return RpcResponse{.id = request.id, .result = std::move(map)};
+}
+
+RpcResponse RpcHandler::handle_approval_list(const RpcRequest &request) const {
+  if (agent_ == nullptr) {
+    return RpcResponse{.id = request.id, .error = "agent unavailable"};
+  }
+  std::optional<std::string> session_id;
+  if (const auto it = request.params.find("session_id");
+      it != request.params.end() && !common::trim(it->second).empty()) {
+    session_id = common::trim(it->second);
+  }
+  const auto turns = agent_->parked_turns(session_id);
+  RpcMap map;
+  map["count"] = std::to_string(turns.size());
+  for (std::size_t i = 0; i < turns.size(); ++i) {
+    const std::string prefix = "approval_" + std::to_string(i);
+    map[prefix] = turns[i].id;
+    map[prefix + ".session_id"] = turns[i].session_id;
+    map[prefix + ".command"] = turns[i].command;
+    map[prefix + ".created_at"] = turns[i].created_at;
+  }
+  return RpcResponse{.id = request.id, .result = std::move(map)};
+}
+
+RpcResponse RpcHandler::handle_approval_resolve(const RpcRequest &request) {
+  if (agent_ == nullptr) {
+    return RpcResponse{.id = request.id, .error = "agent unavailable"};
+  }
+  const auto id_it = request.params.find("id");
+  if (id_it == request.params.end() || common::trim(id_it->second).empty()) {
+    return RpcResponse{.id = request.id, .error = "missing id param"};
+  }
+  const auto decision_it = request.params.find("decision");
+  if (decision_it == request.params.end()) {
+    return RpcResponse{.id = request.id, .error = "missing decision param"};
+  }
+  const auto decision = security::approval_decision_from_string(decision_it->second);
+  if (!decision.ok()) {
+    return RpcResponse{.id = request.id, .error = decision.error()};
+  }
+  // Only the session a turn was parked in may resolve it.
+  const auto session_it = request.params.find("session_id");
+  if (session_it == request.params.end() || common::trim(session_it->second).empty()) {
+    return RpcResponse{.id = request.id, .error = "missing session_id param"};
+  }
+
+  agent::AgentOptions options;
+  options.session_id = common::trim(session_it->second);
+  options.park_on_approval = true;
+  auto result = agent_->resume(common::trim(id_it->second), decision.value(), options);
+  if (!result.ok()) {
+    return RpcResponse{.id = request.id, .error = result.error()};
+  }
+
+  RpcMap map;
+  map["content"] = result.value().content;
+  map["duration_ms"] = std::to_string(result.value().duration.count());
+  map["tool_calls"] = std::to_string(result.value().tool_results.size());
+  add_turn_usage_fields(map, result.value());
+  if (result.value().pending_approval_id.has_value()) {
+    map["approval_id"] = *result.value().pending_approval_id;
+    map["approval_command"] = result.value().pending_approval_command;
+  }
+  return RpcResponse{.id = request.id, .result = std::move(map)};
+}
+
+RpcResponse RpcHandler::handle_admission_stats(const RpcRequest &request) const {
+  // One flat entry per field, keyed "<provider key>.<field>".
+  RpcMap map;
+  for (const auto &stats : providers::AdmissionController::shared().stats()) {
+    const auto average = [](const std::uint64_t total_ms, const std::uint64_t count) {
+      return std::to_string(count == 0 ? 0 : total_ms / count);
+    };
+    map[stats.key + ".admitted_interactive"] = std::to_string(stats.admitted_interactive);
+    map[stats.key + ".admitted_background"] = std::to_string(stats.admitted_background);
+    map[stats.key + ".interactive_avg_wait_ms"] =
+        average(stats.waited_ms_interactive, stats.admitted_interactive);
+    map[stats.key + ".background_avg_wait_ms"] =
+        average(stats.waited_ms_background, stats.admitted_background);
+    map[stats.key + ".rate_limited"] = std::to_string(stats.rate_limited);
+    map[stats.key + ".timed_out"] = std::to_string(stats.timed_out);
+    map[stats.key + ".queued"] = std::to_string(stats.queued);
+    map[stats.key + ".in_flight"] = std::to_string(stats.in_flight);
+    map[stats.key + ".window_requests"] = std::to_string(stats.window_requests);
+    map[stats.key + ".window_tokens"] = std::to_string(stats.window_tokens);
+  }
+  return RpcResponse{.id = request.id, .result = std::move(map)};
+}
+
+RpcResponse RpcHandler::handle_batch_stats(const RpcRequest &request) const {
+  // Same layout as providers.admission: "<provider key>.<field>".
+  RpcMap map;
+  for (const auto &stats : providers::BatchLane::shared().stats()) {
+    map[stats.key + ".queued"] = std::to_string(stats.queued);
+    map[stats.key + ".in_flight_batches"] = std::to_string(stats.in_flight_batches);
+    map[stats.key + ".in_flight_requests"] = std::to_string(stats.in_flight_requests);
+    map[stats.key + ".submitted_batches"] = std::to_string(stats.submitted_batches);
+    map[stats.key + ".completed"] = std::to_string(stats.completed);
+    map[stats.key + ".failed"] = std::to_string(stats.failed);
+  }
+  return RpcResponse{.id = request.id, .result = std::move(map)};
+}
+
 RpcResponse RpcHandler::handle_health(const RpcRequest &request) const {
   RpcMap map;
   map["status"] = "ok";
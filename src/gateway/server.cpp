@@ -3,15 +3,17 @@
 #include "ghostclaw/common/fs.hpp"
 #include "ghostclaw/common/json_util.hpp"
 #include "ghostclaw/config/config.hpp"
+#include "ghostclaw/gateway/http_parser.hpp"
+#include "ghostclaw/nodes/scheduler.hpp"
 #include "ghostclaw/observability/global.hpp"
 #include "ghostclaw/providers/traits.hpp"
+#include "ghostclaw/security/policy.hpp"
 #include "ghostclaw/sessions/session_key.hpp"
 #include "ghostclaw/tunnel/factory.hpp"
 
 #include <openssl/sha.h>
 
 #include <algorithm>
-#include <array>
 #include <cerrno>
 #include <cctype>
 #include <chrono>
@@ -20,11 +22,14 @@
 #include <iomanip>
 #include <limits>
 #include <sstream>
+#include <system_error>
 
 #ifndef _WIN32
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <sys/socket.h>
+#include <sys/time.h>
 #include <unistd.h>
 #endif
 
@@ -33,9 +38,18 @@ namespace ghostclaw::gateway {
 namespace {
 
 constexpr std::size_t kMaxBodySize = 64 * 1024;
+constexpr std::size_t kMaxHeadSize = 16 * 1024;
+constexpr std::size_t kMaxHeaders = 64;
+constexpr auto kKeepAliveIdle = std::chrono::seconds(5);
+// A client that stalls mid-request is dropped after this.
+constexpr int kReadTimeoutSecs = 30;
 constexpr int kListenBacklog = 64;
+constexpr const char *kForwardedHeader = "x-ghostclaw-forwarded";
+constexpr const char *kClusterKeyHeader = "x-ghostclaw-cluster-key";
+constexpr std::uint64_t kForwardTimeoutMs = 300000;
+// Connections served at once; further clients get a 503 instead of a thread.
+constexpr std::size_t kMaxHttpClients = 64;
 
-std::string trim_copy(const std::string &value) { return common::trim(value); }
 bool is_loopback_host(const std::string &host) {
   const std::string lowered = common::to_lower(common::trim(host));
   return lowered == "127.0.0.1" || lowered == "localhost" || lowered == "::1" ||
@@ -125,6 +139,18 @@ std::optional<double> thinking_level_temperature(const std::string &thinking_lev
   return std::nullopt;
 }
 
+RpcMap tool_output_event(const tools::ToolOutputChunk &chunk) {
+  RpcMap event{{"event", "tool.output"},
+               {"call_id", chunk.call_id},
+               {"tool", chunk.tool},
+               {"stream", chunk.stream},
+               {"text", chunk.text}};
+  if (chunk.skipped_lines > 0) {
+    event["skipped_lines"] = std::to_string(chunk.skipped_lines);
+  }
+  return event;
+}
+
 void append_transcript_entry(sessions::SessionStore *store, const std::string &session_id,
                              const sessions::TranscriptRole role, const std::string &content,
                              const std::string &model,
@@ -188,12 +214,20 @@ std::string status_text(int status) {
     return "Forbidden";
   case 404:
     return "Not Found";
+  case 409:
+    return "Conflict";
   case 413:
     return "Payload Too Large";
   case 429:
     return "Too Many Requests";
+  case 431:
+    return "Request Header Fields Too Large";
   case 500:
     return "Internal Server Error";
+  case 501:
+    return "Not Implemented";
+  case 505:
+    return "HTTP Version Not Supported";
   default:
     return "OK";
   }
@@ -233,12 +267,26 @@ HttpResponse make_text_response(int status, const std::string &body) {
   return response;
 }
 
-std::string render_http_response(const HttpResponse &response) {
+// A newer message for the session superseded this turn.
+HttpResponse cancelled_turn_response(sessions::SessionStore *store, const std::string &session_id,
+                                     const std::string &model, const std::string &thinking_level,
+                                     const std::string &group_id) {
+  append_transcript_entry(store, session_id, sessions::TranscriptRole::System,
+                          "agent.run cancelled", model,
+                          {{"channel", "webhook"},
+                           {"source", "http"},
+                           {"event", "assistant.cancelled"},
+                           {"thinking_level", thinking_level},
+                           {"group_id", group_id}});
+  return make_json_response(409, R"({"error":"turn_cancelled"})");
+}
+
+std::string render_http_response(const HttpResponse &response, const bool keep_alive = false) {
   std::ostringstream out;
   out << "HTTP/1.1 " << response.status << " " << status_text(response.status) << "\r\n";
   out << "Content-Type: " << response.content_type << "\r\n";
   out << "Content-Length: " << response.body.size() << "\r\n";
-  out << "Connection: close\r\n";
+  out << "Connection: " << (keep_alive ? "keep-alive" : "close") << "\r\n";
   for (const auto &[k, v] : response.headers) {
     out << k << ": " << v << "\r\n";
   }
@@ -247,48 +295,18 @@ std::string render_http_response(const HttpResponse &response) {
   return out.str();
 }
 
-common::Result<HttpRequest> parse_http_request(const std::string &raw) {
-  const auto header_end = raw.find("\r\n\r\n");
-  if (header_end == std::string::npos) {
-    return common::Result<HttpRequest>::failure("incomplete request");
-  }
-
-  const std::string headers_part = raw.substr(0, header_end);
-  const std::string body = raw.substr(header_end + 4);
-
-  std::istringstream head_stream(headers_part);
-  std::string line;
-  if (!std::getline(head_stream, line)) {
-    return common::Result<HttpRequest>::failure("missing request line");
-  }
-  if (!line.empty() && line.back() == '\r') {
-    line.pop_back();
-  }
-
-  std::istringstream req_line(line);
+HttpRequest to_http_request(const HttpRequestView &view) {
   HttpRequest request;
-  std::string http_version;
-  if (!(req_line >> request.method >> request.raw_path >> http_version)) {
-    return common::Result<HttpRequest>::failure("invalid request line");
-  }
-
-  while (std::getline(head_stream, line)) {
-    if (!line.empty() && line.back() == '\r') {
-      line.pop_back();
-    }
-    if (line.empty()) {
-      continue;
-    }
-    const auto colon = line.find(':');
-    if (colon == std::string::npos) {
-      continue;
-    }
-    const std::string key = common::to_lower(trim_copy(line.substr(0, colon)));
-    const std::string value = trim_copy(line.substr(colon + 1));
-    request.headers[key] = value;
-  }
-
-  request.body = body;
+  request.method.assign(view.method);
+  request.raw_path.assign(view.target);
+  request.headers.reserve(view.headers.size());
+  for (const auto &header : view.headers) {
+    std::string key(header.name);
+    std::transform(key.begin(), key.end(), key.begin(),
+                   [](const unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+    request.headers[std::move(key)].assign(header.value);
+  }
+  request.body.assign(view.body);
   const auto qpos = request.raw_path.find('?');
   if (qpos == std::string::npos) {
     request.path = request.raw_path;
@@ -296,9 +314,39 @@ common::Result<HttpRequest> parse_http_request(const std::string &raw) {
     request.path = request.raw_path.substr(0, qpos);
     request.query = parse_query_string(request.raw_path.substr(qpos + 1));
   }
+  return request;
+}
 
-  return common::Result<HttpRequest>::success(std::move(request));
+#ifndef _WIN32
+bool send_all(const int fd, const std::string &text) {
+  std::size_t sent = 0;
+  while (sent < text.size()) {
+    const ssize_t n = send(fd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+    if (n <= 0) {
+      return false;
+    }
+    sent += static_cast<std::size_t>(n);
+  }
+  return true;
+}
+
+// Waits for the next request on an idle keep-alive connection until it idles out or the
+// server stops. Each connection has its own thread, so new clients do not cut the wait.
+bool wait_for_next_request(const int client_fd, const std::atomic<bool> &running) {
+  const auto deadline = std::chrono::steady_clock::now() + kKeepAliveIdle;
+  while (running && std::chrono::steady_clock::now() < deadline) {
+    pollfd fd{.fd = client_fd, .events = POLLIN, .revents = 0};
+    const int ready = poll(&fd, 1, 100);
+    if (ready < 0 && errno != EINTR) {
+      return false;
+    }
+    if (fd.revents != 0) {
+      return true;
+    }
+  }
+  return false;
 }
+#endif
 
 } // namespace
 
@@ -413,6 +461,26 @@ common::Status GatewayServer::start(const GatewayOptions &options) {
           std::filesystem::temp_directory_path() / "ghostclaw-sessions-fallback");
     }
   }
+  if (config_.gateway.session_history_enabled && !session_history_) {
+    sessions::HistoryOptions history_options;
+    history_options.recent_messages = config_.gateway.session_history_recent_messages;
+    history_options.summary_token_budget = config_.gateway.session_history_summary_tokens;
+    sessions::HistorySummarizer summarizer;
+    if (agent_) {
+      summarizer = [agent = agent_](const std::string &previous, const std::string &messages,
+                                    const std::size_t budget) {
+        return agent->summarize_history(previous, messages, budget);
+      };
+    }
+    session_history_ = std::make_unique<sessions::SessionHistory>(
+        session_store_.get(), std::move(summarizer), history_options);
+  }
+  if (config_.gateway.session_archive_idle_hours > 0 && !session_archiver_) {
+    sessions::ArchiverOptions archiver_options;
+    archiver_options.idle_after = std::chrono::hours(config_.gateway.session_archive_idle_hours);
+    session_archiver_ =
+        std::make_unique<sessions::SessionArchiver>(session_store_.get(), archiver_options);
+  }
   if (config_.gateway.session_send_policy_enabled) {
     send_policy_ = std::make_unique<sessions::SessionSendPolicy>(
         config_.gateway.session_send_policy_max_per_window,
@@ -421,6 +489,20 @@ common::Status GatewayServer::start(const GatewayOptions &options) {
     send_policy_.reset();
   }
 
+  node_executor_.reset();
+  node_workspace_.clear();
+  if (config_.nodes.serve) {
+    auto policy = security::SecurityPolicy::from_config(config_);
+    if (policy.ok()) {
+      node_executor_ = std::make_shared<nodes::NodeActionExecutor>(
+          std::make_shared<security::SecurityPolicy>(std::move(policy.value())));
+    }
+    auto workspace = config::workspace_dir();
+    if (workspace.ok()) {
+      node_workspace_ = workspace.value().string();
+    }
+  }
+
   websocket_port_ = 0;
   websocket_server_.reset();
   if (config_.gateway.websocket_enabled) {
@@ -448,6 +530,7 @@ common::Status GatewayServer::start(const GatewayOptions &options) {
     ws_options.tls_enabled = config_.gateway.websocket_tls_enabled;
     ws_options.tls_cert_file = config_.gateway.websocket_tls_cert_file;
     ws_options.tls_key_file = config_.gateway.websocket_tls_key_file;
+    ws_options.replay_events_per_session = config_.gateway.websocket_replay_events;
     ws_options.require_authorization = config_.gateway.require_pairing;
     ws_options.authorize = [this](const std::string &authorization) {
       if (!config_.gateway.require_pairing) {
@@ -468,6 +551,35 @@ common::Status GatewayServer::start(const GatewayOptions &options) {
         return common::Result<RpcMap>::success({{"status", "ok"}});
       }
 
+      if (method == "node.invoke") {
+        if (node_executor_ == nullptr) {
+          return common::Result<RpcMap>::failure("node actions disabled");
+        }
+        // No cancel token: the action runs to completion even if the caller goes away.
+        tools::ToolContext node_ctx;
+        node_ctx.workspace_path = node_workspace_;
+        node_ctx.session_id = request.session;
+        return nodes::serve_node_invoke(*node_executor_, request.payload, node_ctx,
+                                        config_.nodes.serve_token, emit_event);
+      }
+
+      if (method == "agent.cancel") {
+        const auto peer_it = request.payload.find("peer_id");
+        const std::string fallback_peer =
+            (peer_it != request.payload.end() && !peer_it->second.empty()) ? peer_it->second
+                                                                            : "default";
+        const auto session_param_it = request.payload.find("session_id");
+        const std::string session_candidate =
+            (session_param_it != request.payload.end() && !session_param_it->second.empty())
+                ? session_param_it->second
+                : request.session;
+        const std::string session =
+            normalize_session_id(session_candidate, "websocket", fallback_peer);
+        const std::size_t cancelled = active_turns_.cancel(session);
+        return common::Result<RpcMap>::success(
+            RpcMap{{"session_id", session}, {"cancelled", std::to_string(cancelled)}});
+      }
+
       if (method == "agent.run") {
         const auto message_it = request.payload.find("message");
         if (message_it == request.payload.end() || message_it->second.empty()) {
@@ -489,6 +601,12 @@ common::Status GatewayServer::start(const GatewayOptions &options) {
         const std::string session =
             normalize_session_id(session_candidate, "websocket", fallback_peer);
 
+        // Same session affinity as /webhook: the owning worker runs the turn.
+        if (auto forwarded = forward_run_to_owner(session, request.payload);
+            forwarded.has_value()) {
+          return std::move(*forwarded);
+        }
+
         if (send_policy_ != nullptr && !send_policy_->allow(session)) {
           const RpcMap rate_limited{{"event", "assistant.error"},
                                     {"error", "session_rate_limited"},
@@ -556,13 +674,15 @@ common::Status GatewayServer::start(const GatewayOptions &options) {
 
         upsert_session_state(session_store_.get(), session, model, thinking_level, "websocket",
                              group_id);
-        append_transcript_entry(session_store_.get(), session, sessions::TranscriptRole::User,
-                                message_it->second, model,
-                                {{"channel", "websocket"},
-                                 {"source", "rpc"},
-                                 {"thinking_level", thinking_level},
-                                 {"group_id", group_id}},
-                                provenance);
+
+        // queue_mode=steer supersedes whatever this session is still running, so the
+        // lane frees up as soon as the old turn notices its token.
+        const auto queue_mode_it = request.payload.find("queue_mode");
+        agent::ActiveTurn turn(
+            active_turns_, session,
+            agent::queue_mode_from_string(
+                queue_mode_it != request.payload.end() ? queue_mode_it->second : "")
+                .value_or(agent::QueueMode::Followup));
 
         const auto lane = session_lane(session);
         std::unique_lock<std::mutex> lane_lock(*lane, std::defer_lock);
@@ -574,6 +694,19 @@ common::Status GatewayServer::start(const GatewayOptions &options) {
           }
           lane_lock.lock();
         }
+        // The lane only orders turns in this process; this orders them across workers.
+        const auto cluster_lock =
+            cluster_ != nullptr ? cluster_->lock_session(session) : ClusterLock{};
+        // Inside the lane, so the history reflects every turn queued ahead of this one.
+        const std::string history =
+            session_history_ ? session_history_->context_for(session) : std::string();
+        append_transcript_entry(session_store_.get(), session, sessions::TranscriptRole::User,
+                                message_it->second, model,
+                                {{"channel", "websocket"},
+                                 {"source", "rpc"},
+                                 {"thinking_level", thinking_level},
+                                 {"group_id", group_id}},
+                                provenance);
 
         const RpcMap start{{"event", "assistant.start"}, {"channel", "websocket"}};
         emit_event(start);
@@ -586,6 +719,15 @@ common::Status GatewayServer::start(const GatewayOptions &options) {
         agent::AgentResponse response;
         agent::AgentOptions run_options;
         run_options.model_override = model;
+        run_options.cancel_token = turn.token();
+        run_options.history_context = history;
+        run_options.on_tool_output = [&](const tools::ToolOutputChunk &chunk) {
+          const RpcMap event = tool_output_event(chunk);
+          emit_event(event);
+          if (ws_raw != nullptr) {
+            (void)ws_raw->publish_session_event(session, event);
+          }
+        };
         const auto temperature_it = request.payload.find("temperature");
         if (temperature_it != request.payload.end() && !temperature_it->second.empty()) {
           try {
@@ -620,6 +762,21 @@ common::Status GatewayServer::start(const GatewayOptions &options) {
           stream_failed = true;
           stream_error = status.error();
         }
+        if (stream_failed && turn.cancelled()) {
+          const RpcMap event{{"event", "assistant.cancelled"}, {"channel", "websocket"}};
+          emit_event(event);
+          if (ws_raw != nullptr) {
+            (void)ws_raw->publish_session_event(session, event);
+          }
+          append_transcript_entry(session_store_.get(), session, sessions::TranscriptRole::System,
+                                  "agent.run cancelled", model,
+                                  {{"channel", "websocket"},
+                                   {"source", "rpc"},
+                                   {"event", "assistant.cancelled"},
+                                   {"thinking_level", thinking_level},
+                                   {"group_id", group_id}});
+          return common::Result<RpcMap>::failure(std::string(agent::kTurnCancelled));
+        }
         if (stream_failed) {
           const RpcMap event{{"event", "assistant.error"}, {"error", stream_error}};
           emit_event(event);
@@ -654,12 +811,17 @@ common::Status GatewayServer::start(const GatewayOptions &options) {
              {"group_id", group_id}});
         upsert_session_state(session_store_.get(), session, model, thinking_level, "websocket",
                              group_id);
+        record_turn_usage(session_store_.get(), session, response);
+        if (session_history_) {
+          session_history_->schedule_refresh(session);
+        }
 
         RpcMap result;
         result["content"] = response.content;
         result["session_id"] = session;
         result["duration_ms"] = std::to_string(response.duration.count());
         result["tool_calls"] = std::to_string(response.tool_results.size());
+        add_turn_usage_fields(result, response);
         result["model"] = model;
         result["thinking_level"] = thinking_level;
         if (!group_id.empty()) {
@@ -668,7 +830,7 @@ common::Status GatewayServer::start(const GatewayOptions &options) {
         return common::Result<RpcMap>::success(std::move(result));
       }
 
-      RpcHandler rpc(agent_, memory_, session_store_.get(), config_);
+      RpcHandler rpc(agent_, memory_, session_store_.get(), config_, session_history_.get());
       RpcRequest rpc_request;
       rpc_request.id = request.id;
       rpc_request.method = method;
@@ -700,6 +862,48 @@ common::Status GatewayServer::start(const GatewayOptions &options) {
     websocket_server_ = std::move(server);
   }
 
+  cluster_.reset();
+  if (config_.gateway.cluster_enabled) {
+    std::filesystem::path cluster_dir = config_.gateway.cluster_dir;
+    if (cluster_dir.empty()) {
+      auto workspace = config::workspace_dir();
+      cluster_dir = workspace.ok() ? workspace.value() / "cluster"
+                                   : std::filesystem::temp_directory_path() / "ghostclaw-cluster";
+    }
+    ClusterWorker self;
+    self.pid = static_cast<std::int64_t>(::getpid());
+    self.worker_id = common::trim(config_.gateway.cluster_worker_id);
+    if (self.worker_id.empty()) {
+      self.worker_id = "worker-" + std::to_string(self.pid);
+    }
+    self.endpoint = common::trim(config_.gateway.cluster_advertise_url);
+    if (self.endpoint.empty()) {
+      const std::string advertise_host =
+          (options.host.empty() || options.host == "0.0.0.0") ? "127.0.0.1" : options.host;
+      self.endpoint = "http://" + advertise_host + ":" + std::to_string(bound_port_);
+    }
+    auto coordinator = std::make_unique<ClusterCoordinator>(
+        cluster_dir, std::move(self),
+        std::chrono::seconds(std::max<std::uint32_t>(1, config_.gateway.cluster_lease_seconds)));
+    auto cluster_status = coordinator->start();
+    if (!cluster_status.ok()) {
+      if (websocket_server_ != nullptr) {
+        websocket_server_->stop();
+        websocket_server_.reset();
+      }
+      if (listen_fd_ >= 0) {
+        shutdown(listen_fd_, SHUT_RDWR);
+        close(listen_fd_);
+        listen_fd_ = -1;
+      }
+      if (tunnel_ != nullptr) {
+        (void)tunnel_->stop();
+      }
+      return common::Status::error("failed to join gateway cluster: " + cluster_status.error());
+    }
+    cluster_ = std::move(coordinator);
+  }
+
   running_ = true;
   accept_thread_ = std::thread([this]() { accept_loop(); });
   return common::Status::success();
@@ -720,11 +924,27 @@ void GatewayServer::stop() {
   if (accept_thread_.joinable()) {
     accept_thread_.join();
   }
+  // Unblock connection threads and wait for them; they use the store and agent below.
+  (void)active_turns_.cancel_all();
+  {
+    std::unique_lock<std::mutex> lock(clients_mutex_);
+    for (const int fd : client_fds_) {
+      shutdown(fd, SHUT_RDWR);
+    }
+    clients_cv_.wait(lock, [this]() { return client_fds_.empty(); });
+  }
   if (websocket_server_ != nullptr) {
     websocket_server_->stop();
     websocket_server_.reset();
   }
   websocket_port_ = 0;
+  if (cluster_ != nullptr) {
+    cluster_->stop();
+    cluster_.reset();
+  }
+  // The summary and archive workers hold raw pointers into the store; join them first.
+  session_history_.reset();
+  session_archiver_.reset();
   session_store_.reset();
   send_policy_.reset();
   if (tunnel_ != nullptr) {
@@ -878,10 +1098,121 @@ bool GatewayServer::validate_bearer(const std::string &authorization) const {
   return false;
 }
 
+bool GatewayServer::is_cluster_request(const HttpRequest &request) const {
+  if (cluster_ == nullptr || cluster_->key().empty() ||
+      header_lookup(request, kForwardedHeader).empty()) {
+    return false;
+  }
+  return security::constant_time_equals(header_lookup(request, kClusterKeyHeader),
+                                        cluster_->key());
+}
+
+std::optional<HttpResponse> GatewayServer::forward_to_owner(const HttpRequest &request,
+                                                           const std::string &session_id) {
+  if (!header_lookup(request, kForwardedHeader).empty()) {
+    return std::nullopt;
+  }
+  return post_to_owner(session_id, request.body, header_lookup(request, "authorization"));
+}
+
+std::optional<common::Result<RpcMap>>
+GatewayServer::forward_run_to_owner(const std::string &session_id, const RpcMap &payload) {
+  const auto message_it = payload.find("message");
+  if (cluster_ == nullptr || message_it == payload.end()) {
+    return std::nullopt;
+  }
+  std::ostringstream body;
+  body << "{\"message\":" << json_string(message_it->second)
+       << ",\"session_id\":" << json_string(session_id);
+  for (const char *field :
+       {"model", "thinking_level", "group_id", "queue_mode", "input_provenance_kind",
+        "input_provenance_source_session_id", "input_provenance_source_channel",
+        "input_provenance_source_tool", "input_provenance_source_message_id"}) {
+    const auto it = payload.find(field);
+    if (it != payload.end() && !common::trim(it->second).empty()) {
+      body << ",\"" << field << "\":" << json_string(it->second);
+    }
+  }
+  if (!payload.contains("input_provenance_kind")) {
+    body << ",\"input_provenance_kind\":\"websocket\"";
+  }
+  if (const auto it = payload.find("temperature"); it != payload.end() && !it->second.empty()) {
+    try {
+      body << ",\"temperature\":" << std::stod(it->second);
+    } catch (...) {
+      return common::Result<RpcMap>::failure("invalid temperature");
+    }
+  }
+  body << "}";
+
+  auto forwarded = post_to_owner(session_id, body.str(), "");
+  if (!forwarded.has_value()) {
+    return std::nullopt;
+  }
+  const std::string &json = forwarded->body;
+  if (forwarded->status != 200) {
+    const std::string error = common::json_get_string(json, "error");
+    return common::Result<RpcMap>::failure(
+        error.empty() ? "owner returned HTTP " + std::to_string(forwarded->status) : error);
+  }
+  RpcMap result;
+  result["content"] = common::json_get_string(json, "response");
+  result["session_id"] = common::json_get_string(json, "session_id");
+  result["model"] = common::json_get_string(json, "model");
+  result["thinking_level"] = common::json_get_string(json, "thinking_level");
+  if (const auto group = common::json_get_string(json, "group_id"); !group.empty()) {
+    result["group_id"] = group;
+  }
+  result["duration_ms"] = common::json_get_number(json, "duration_ms");
+  result["tool_calls"] = common::json_get_number(json, "tool_calls");
+  const std::string usage = common::json_get_object(json, "usage");
+  for (const char *field : {"prompt_tokens", "completion_tokens", "cached_prompt_tokens"}) {
+    result[field] = common::json_get_number(usage, field);
+  }
+  result["worker"] = forwarded->headers["X-Ghostclaw-Worker"];
+  return common::Result<RpcMap>::success(std::move(result));
+}
+
+std::optional<HttpResponse> GatewayServer::post_to_owner(const std::string &session_id,
+                                                        const std::string &body,
+                                                        const std::string &authorization) {
+  if (cluster_ == nullptr) {
+    return std::nullopt;
+  }
+  const auto owner = cluster_->remote_owner(session_id);
+  if (!owner.has_value() || owner->endpoint.empty()) {
+    return std::nullopt;
+  }
+
+  std::unordered_map<std::string, std::string> headers;
+  if (!authorization.empty()) {
+    headers["Authorization"] = authorization;
+  }
+  headers["X-Ghostclaw-Forwarded"] = cluster_->self().worker_id;
+  headers["X-Ghostclaw-Cluster-Key"] = cluster_->key();
+  // Runs on the requesting connection's own thread, so a long turn on the owner only
+  // holds up this one client.
+  providers::CurlHttpClient client;
+  const auto response =
+      client.post_json(owner->endpoint + "/webhook", headers, body, kForwardTimeoutMs);
+  if (response.network_error || response.timeout || response.status == 0) {
+    // Owner is unreachable: serve the turn here. Session state lives in the shared
+    // store, so the next worker to own the session picks up where we left off, and the
+    // cluster session lock keeps this turn from overlapping one the owner still runs.
+    observability::record_error("gateway.cluster",
+                                "forward to " + owner->worker_id + " failed, handling locally");
+    cluster_->refresh();
+    return std::nullopt;
+  }
+  HttpResponse forwarded = make_json_response(response.status, response.body);
+  forwarded.headers["X-Ghostclaw-Worker"] = owner->worker_id;
+  return forwarded;
+}
+
 HttpResponse GatewayServer::handle_webhook(const HttpRequest &request) {
   if (config_.gateway.require_pairing) {
     const std::string auth = header_lookup(request, "authorization");
-    if (!validate_bearer(auth)) {
+    if (!validate_bearer(auth) && !is_cluster_request(request)) {
       return make_json_response(401, R"({"error":"unauthorized"})");
     }
   }
@@ -902,6 +1233,10 @@ HttpResponse GatewayServer::handle_webhook(const HttpRequest &request) {
     return make_json_response(400, R"({"error":"invalid_body"})");
   }
 
+  if (auto forwarded = forward_to_owner(request, session); forwarded.has_value()) {
+    return std::move(*forwarded);
+  }
+
   if (send_policy_ != nullptr && !send_policy_->allow(session)) {
     return make_json_response(429, R"({"error":"session_rate_limited"})");
   }
@@ -957,18 +1292,15 @@ HttpResponse GatewayServer::handle_webhook(const HttpRequest &request) {
     return make_json_response(500, R"({"error":"agent_unavailable"})");
   }
   upsert_session_state(session_store_.get(), session, model, thinking_level, "webhook", group_id);
-  append_transcript_entry(session_store_.get(), session, sessions::TranscriptRole::User, message,
-                          model,
-                          {{"channel", "webhook"},
-                           {"source", "http"},
-                           {"thinking_level", thinking_level},
-                           {"group_id", group_id}},
-                          provenance);
 
   bool stream_failed = false;
   std::string stream_error;
   agent::AgentResponse agent_response;
   const bool ws_enabled = websocket_server_ != nullptr && websocket_server_->is_running();
+  agent::ActiveTurn turn(
+      active_turns_, session,
+      agent::queue_mode_from_string(find_json_string_field(request.body, "queue_mode"))
+          .value_or(agent::QueueMode::Followup));
   const auto lane = session_lane(session);
   std::unique_lock<std::mutex> lane_lock(*lane, std::defer_lock);
   if (!lane_lock.try_lock()) {
@@ -979,8 +1311,22 @@ HttpResponse GatewayServer::handle_webhook(const HttpRequest &request) {
     }
     lane_lock.lock();
   }
+  // A worker covering for an unreachable owner must not run the session beside it.
+  const auto cluster_lock = cluster_ != nullptr ? cluster_->lock_session(session) : ClusterLock{};
+  // Inside the lane, so the history reflects every turn queued ahead of this one.
+  const std::string history =
+      session_history_ ? session_history_->context_for(session) : std::string();
+  append_transcript_entry(session_store_.get(), session, sessions::TranscriptRole::User, message,
+                          model,
+                          {{"channel", "webhook"},
+                           {"source", "http"},
+                           {"thinking_level", thinking_level},
+                           {"group_id", group_id}},
+                          provenance);
   agent::AgentOptions run_options;
   run_options.model_override = model;
+  run_options.cancel_token = turn.token();
+  run_options.history_context = history;
   const std::string explicit_temperature = common::trim(find_json_numeric_field(request.body, "temperature"));
   if (!explicit_temperature.empty()) {
     try {
@@ -994,6 +1340,9 @@ HttpResponse GatewayServer::handle_webhook(const HttpRequest &request) {
     run_options.temperature_override = *derived_temperature;
   }
   if (ws_enabled) {
+    run_options.on_tool_output = [&](const tools::ToolOutputChunk &chunk) {
+      (void)websocket_server_->publish_session_event(session, tool_output_event(chunk));
+    };
     (void)websocket_server_->publish_session_event(session,
                                                    {{"event", "assistant.start"},
                                                     {"channel", "webhook"}});
@@ -1015,6 +1364,13 @@ HttpResponse GatewayServer::handle_webhook(const HttpRequest &request) {
       stream_failed = true;
       stream_error = status.error();
     }
+    if (stream_failed && turn.cancelled()) {
+      (void)websocket_server_->publish_session_event(session,
+                                                     {{"event", "assistant.cancelled"},
+                                                      {"channel", "webhook"}});
+      return cancelled_turn_response(session_store_.get(), session, model, thinking_level,
+                                     group_id);
+    }
     if (stream_failed) {
       observability::record_error("gateway.webhook", stream_error);
       (void)websocket_server_->publish_session_event(session,
@@ -1036,6 +1392,10 @@ HttpResponse GatewayServer::handle_webhook(const HttpRequest &request) {
          {"tool_calls", std::to_string(agent_response.tool_results.size())}});
   } else {
     auto response = agent_->run(message, run_options);
+    if (!response.ok() && turn.cancelled()) {
+      return cancelled_turn_response(session_store_.get(), session, model, thinking_level,
+                                     group_id);
+    }
     if (!response.ok()) {
       observability::record_error("gateway.webhook", response.error());
       append_transcript_entry(session_store_.get(), session, sessions::TranscriptRole::System,
@@ -1059,6 +1419,10 @@ HttpResponse GatewayServer::handle_webhook(const HttpRequest &request) {
        {"thinking_level", thinking_level},
        {"group_id", group_id}});
   upsert_session_state(session_store_.get(), session, model, thinking_level, "webhook", group_id);
+  record_turn_usage(session_store_.get(), session, agent_response);
+  if (session_history_) {
+    session_history_->schedule_refresh(session);
+  }
 
   observability::record_channel_message("webhook", "outbound");
   std::ostringstream body;
@@ -1071,7 +1435,10 @@ HttpResponse GatewayServer::handle_webhook(const HttpRequest &request) {
     body << "\"group_id\":" << json_string(group_id) << ",";
   }
   body << "\"duration_ms\":" << agent_response.duration.count() << ",";
-  body << "\"tool_calls\":" << agent_response.tool_results.size();
+  body << "\"tool_calls\":" << agent_response.tool_results.size() << ",";
+  body << "\"usage\":{\"prompt_tokens\":" << agent_response.usage.prompt_tokens
+       << ",\"completion_tokens\":" << agent_response.usage.completion_tokens
+       << ",\"cached_prompt_tokens\":" << agent_response.usage.cached_prompt_tokens << "}";
   body << "}";
   return make_json_response(200, body.str());
 }
@@ -1116,69 +1483,73 @@ void GatewayServer::accept_loop() {
       }
       continue;
     }
-    handle_client(client);
-    close(client);
+    // A turn or a forwarded request can take minutes, so each connection is served on
+    // its own thread and this loop only accepts.
+    {
+      std::lock_guard<std::mutex> lock(clients_mutex_);
+      if (client_fds_.size() >= kMaxHttpClients) {
+        (void)send_all(client, render_http_response(make_json_response(
+                                   503, R"({"error":"too_many_connections"})")));
+        close(client);
+        continue;
+      }
+      client_fds_.insert(client);
+    }
+    const auto finish = [this, client]() {
+      std::lock_guard<std::mutex> lock(clients_mutex_);
+      client_fds_.erase(client);
+      close(client);
+      clients_cv_.notify_all();
+    };
+    try {
+      std::thread([this, client, finish]() {
+        handle_client(client);
+        finish();
+      }).detach();
+    } catch (const std::system_error &) {
+      finish();
+    }
   }
 #endif
 }
 
 void GatewayServer::handle_client(int client_fd) {
 #ifndef _WIN32
-  std::string raw;
-  raw.reserve(4096);
-  std::array<char, 4096> buf{};
-
-  std::size_t content_length = 0;
-  bool header_parsed = false;
-  while (raw.size() < (kMaxBodySize + 8192)) {
-    const ssize_t n = recv(client_fd, buf.data(), buf.size(), 0);
-    if (n <= 0) {
-      break;
-    }
-    raw.append(buf.data(), static_cast<std::size_t>(n));
-
-    if (!header_parsed) {
-      const auto header_end = raw.find("\r\n\r\n");
-      if (header_end != std::string::npos) {
-        header_parsed = true;
-        auto parsed = parse_http_request(raw.substr(0, header_end + 4));
-        if (parsed.ok()) {
-          const std::string cl = header_lookup(parsed.value(), "content-length");
-          if (!cl.empty()) {
-            try {
-              content_length = static_cast<std::size_t>(std::stoull(cl));
-            } catch (...) {
-              content_length = 0;
-            }
-          }
-        }
-        if (content_length > kMaxBodySize) {
-          const auto text = render_http_response(
-              make_json_response(413, R"({"error":"request_too_large"})"));
-          send(client_fd, text.data(), text.size(), 0);
-          return;
-        }
+  timeval read_timeout{};
+  read_timeout.tv_sec = kReadTimeoutSecs;
+  setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &read_timeout, sizeof(read_timeout));
+
+  HttpRequestParser parser(
+      {.max_head_bytes = kMaxHeadSize, .max_headers = kMaxHeaders, .max_body_bytes = kMaxBodySize});
+  while (running_) {
+    auto status = parser.status();
+    while (status == HttpParseStatus::NeedMore) {
+      const auto space = parser.buffer();
+      const ssize_t n = recv(client_fd, space.data(), space.size(), 0);
+      if (n <= 0) {
+        return;
       }
+      status = parser.commit(static_cast<std::size_t>(n));
     }
 
-    if (header_parsed) {
-      const auto header_end = raw.find("\r\n\r\n");
-      if (header_end != std::string::npos &&
-          raw.size() >= header_end + 4 + content_length) {
-        break;
-      }
+    if (status == HttpParseStatus::Error) {
+      const int code = parser.error_status();
+      const auto response = make_json_response(
+          code, code == 413 ? R"({"error":"request_too_large"})" : R"({"error":"invalid_request"})");
+      (void)send_all(client_fd, render_http_response(response));
+      return;
     }
-  }
 
-  auto parsed = parse_http_request(raw);
-  HttpResponse response;
-  if (!parsed.ok()) {
-    response = make_json_response(400, R"({"error":"invalid_request"})");
-  } else {
-    response = dispatch_for_test(parsed.value());
+    const auto response = dispatch_for_test(to_http_request(parser.request()));
+    const bool keep_alive = parser.request().keep_alive && running_;
+    if (!send_all(client_fd, render_http_response(response, keep_alive)) || !keep_alive) {
+      return;
+    }
+    if (parser.consume() == HttpParseStatus::NeedMore &&
+        !wait_for_next_request(client_fd, running_)) {
+      return;
+    }
   }
-  const std::string text = render_http_response(response);
-  send(client_fd, text.data(), text.size(), 0);
 #endif
 }
 
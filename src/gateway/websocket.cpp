@@ -6,6 +6,7 @@
 #include <openssl/evp.h>
 #include <openssl/sha.h>
 #include <openssl/ssl.h>
+#include <zlib.h>
 
 #include <algorithm>
 #include <array>
@@ -29,6 +30,11 @@ namespace {
 
 constexpr std::size_t kMaxHandshakeBytes = 8 * 1024;
 constexpr std::size_t kMaxFramePayloadBytes = 1024 * 1024;
+// Smaller messages go out uncompressed; deflate framing would outweigh the savings.
+constexpr std::size_t kDeflateMinBytes = 128;
+// Gateway traffic is JSON, which level 1 already shrinks most of the way for far less CPU.
+constexpr int kDeflateLevel = 1;
+constexpr std::array<unsigned char, 4> kDeflateTail = {0x00, 0x00, 0xff, 0xff};
 constexpr int kListenBacklog = 64;
 constexpr std::string_view kWebSocketGuid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
 
@@ -151,14 +157,19 @@ bool send_http_response(const int fd, SSL *ssl, const int status, const std::str
   return send_all(fd, ssl, reinterpret_cast<const std::uint8_t *>(text.data()), text.size());
 }
 
-bool read_next_frame(const int fd, SSL *ssl, std::uint8_t &opcode, std::string &payload) {
+bool read_next_frame(const int fd, SSL *ssl, std::uint8_t &opcode, bool &compressed,
+                     std::string &payload) {
   std::array<std::uint8_t, 2> header{};
   if (!recv_exact(fd, ssl, header.data(), header.size())) {
     return false;
   }
 
   const bool fin = (header[0] & 0x80u) != 0;
+  compressed = (header[0] & 0x40u) != 0;
   opcode = static_cast<std::uint8_t>(header[0] & 0x0Fu);
+  if ((header[0] & 0x30u) != 0) {
+    return false;
+  }
   const bool masked = (header[1] & 0x80u) != 0;
   std::uint64_t payload_len = static_cast<std::uint64_t>(header[1] & 0x7Fu);
 
@@ -206,10 +217,12 @@ bool read_next_frame(const int fd, SSL *ssl, std::uint8_t &opcode, std::string &
   return true;
 }
 
-bool send_frame(const int fd, SSL *ssl, const std::uint8_t opcode, const std::string &payload) {
+bool send_frame(const int fd, SSL *ssl, const std::uint8_t opcode, const std::string &payload,
+                const bool compressed = false) {
   std::vector<std::uint8_t> frame;
   frame.reserve(payload.size() + 16);
-  frame.push_back(static_cast<std::uint8_t>(0x80u | (opcode & 0x0Fu)));
+  frame.push_back(
+      static_cast<std::uint8_t>(0x80u | (compressed ? 0x40u : 0x00u) | (opcode & 0x0Fu)));
 
   const auto size = payload.size();
   if (size <= 125u) {
@@ -228,6 +241,163 @@ bool send_frame(const int fd, SSL *ssl, const std::uint8_t opcode, const std::st
   frame.insert(frame.end(), payload.begin(), payload.end());
   return send_all(fd, ssl, frame.data(), frame.size());
 }
+
+// Reused per thread: deflateInit allocates the whole window, a reset only clears it.
+class Deflater {
+public:
+  ~Deflater() {
+    if (bits_ != 0) {
+      deflateEnd(&stream_);
+    }
+  }
+
+  std::optional<std::string> compress(const std::string &text, const int window_bits) {
+    if (bits_ != window_bits) {
+      if (bits_ != 0) {
+        deflateEnd(&stream_);
+        bits_ = 0;
+      }
+      stream_ = z_stream{};
+      if (deflateInit2(&stream_, kDeflateLevel, Z_DEFLATED, -window_bits, 8,
+                       Z_DEFAULT_STRATEGY) != Z_OK) {
+        return std::nullopt;
+      }
+      bits_ = window_bits;
+    } else if (deflateReset(&stream_) != Z_OK) {
+      return std::nullopt;
+    }
+
+    std::string out(deflateBound(&stream_, static_cast<uLong>(text.size())) + 8, '\0');
+    stream_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(text.data()));
+    stream_.avail_in = static_cast<uInt>(text.size());
+    stream_.next_out = reinterpret_cast<Bytef *>(out.data());
+    stream_.avail_out = static_cast<uInt>(out.size());
+    if (deflate(&stream_, Z_SYNC_FLUSH) != Z_OK || stream_.avail_in != 0) {
+      return std::nullopt;
+    }
+    out.resize(out.size() - stream_.avail_out);
+    // RFC 7692: the sync flush's empty stored block is implied, not sent.
+    if (out.size() >= kDeflateTail.size() &&
+        std::memcmp(out.data() + out.size() - kDeflateTail.size(), kDeflateTail.data(),
+                    kDeflateTail.size()) == 0) {
+      out.resize(out.size() - kDeflateTail.size());
+    }
+    return out;
+  }
+
+private:
+  z_stream stream_{};
+  int bits_ = 0;
+};
+
+class Inflater {
+public:
+  ~Inflater() {
+    if (ready_) {
+      inflateEnd(&stream_);
+    }
+  }
+
+  // Fails on corrupt input or output past `max_bytes`.
+  bool decompress(const std::string &payload, const std::size_t max_bytes, std::string &out) {
+    if (!ready_) {
+      stream_ = z_stream{};
+      if (inflateInit2(&stream_, -15) != Z_OK) {
+        return false;
+      }
+      ready_ = true;
+    } else if (inflateReset(&stream_) != Z_OK) {
+      return false;
+    }
+
+    out.clear();
+    std::array<char, 16 * 1024> chunk{};
+    const auto run = [&](const unsigned char *data, const std::size_t size) {
+      stream_.next_in = const_cast<Bytef *>(data);
+      stream_.avail_in = static_cast<uInt>(size);
+      // Keep going while input remains or the last call filled the chunk completely.
+      do {
+        stream_.next_out = reinterpret_cast<Bytef *>(chunk.data());
+        stream_.avail_out = static_cast<uInt>(chunk.size());
+        const int rc = inflate(&stream_, Z_SYNC_FLUSH);
+        if (rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR) {
+          return false;
+        }
+        const auto produced = chunk.size() - stream_.avail_out;
+        if (out.size() + produced > max_bytes) {
+          return false;
+        }
+        out.append(chunk.data(), produced);
+        if (rc == Z_STREAM_END || (rc == Z_BUF_ERROR && produced == 0)) {
+          break;
+        }
+      } while (stream_.avail_in > 0 || stream_.avail_out == 0);
+      return true;
+    };
+    return run(reinterpret_cast<const unsigned char *>(payload.data()), payload.size()) &&
+           run(kDeflateTail.data(), kDeflateTail.size());
+  }
+
+private:
+  z_stream stream_{};
+  bool ready_ = false;
+};
+
+// Picks the first permessage-deflate offer we can honour and returns the response
+// header. Both directions run without context takeover, so no compressor state outlives
+// a message and the server's window size is the only parameter that matters.
+std::optional<std::string> negotiate_deflate(const std::string &extensions, int &window_bits) {
+  std::istringstream offers(extensions);
+  std::string offer;
+  while (std::getline(offers, offer, ',')) {
+    std::istringstream params(offer);
+    std::string param;
+    if (!std::getline(params, param, ';') || lower_trimmed(param) != "permessage-deflate") {
+      continue;
+    }
+    bool acceptable = true;
+    int bits = 15;
+    std::unordered_set<std::string> seen;
+    while (acceptable && std::getline(params, param, ';')) {
+      const auto eq = param.find('=');
+      const std::string name = lower_trimmed(param.substr(0, eq));
+      std::string value = eq == std::string::npos ? "" : common::trim(param.substr(eq + 1));
+      if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+        value = value.substr(1, value.size() - 2);
+      }
+      if (!seen.insert(name).second) {
+        acceptable = false;
+      } else if (name == "server_max_window_bits") {
+        // zlib cannot produce raw deflate with an 8-bit window.
+        acceptable = value.size() == 2 && value >= "09" && value <= "15";
+        if (acceptable) {
+          bits = std::stoi(value);
+        }
+      } else if (name == "client_max_window_bits") {
+        acceptable = value.empty() || (value.size() <= 2 && std::all_of(value.begin(), value.end(),
+                                                                          [](const char ch) {
+                                                                            return ch >= '0' &&
+                                                                                   ch <= '9';
+                                                                          }));
+      } else if (name == "server_no_context_takeover" || name == "client_no_context_takeover") {
+        acceptable = value.empty();
+      } else {
+        acceptable = false;
+      }
+    }
+    if (!acceptable) {
+      continue;
+    }
+    window_bits = bits;
+    std::string response =
+        "permessage-deflate; server_no_context_takeover; client_no_context_takeover";
+    if (bits != 15) {
+      response += "; server_max_window_bits=" + std::to_string(bits);
+    }
+    return response;
+  }
+  return std::nullopt;
+}
 #endif
 
 } // namespace
@@ -403,6 +573,13 @@ WebSocketStats WebSocketServer::stats() const {
     (void)fd;
     out.total_subscriptions += client->sessions.size();
   }
+  std::lock_guard<std::mutex> streams_lock(streams_mutex_);
+  out.replay_sessions = streams_.size();
+  for (const auto &[session, stream] : streams_) {
+    (void)session;
+    std::lock_guard<std::mutex> stream_lock(stream->mutex);
+    out.replay_events += stream->events.size();
+  }
   return out;
 }
 
@@ -413,7 +590,18 @@ std::size_t WebSocketServer::publish_session_event(const std::string &session,
   (void)payload;
   return 0;
 #else
-  WsServerMessage message{.type = "event", .session = session, .payload = payload};
+  const auto stream = stream_for(session);
+  std::lock_guard<std::mutex> stream_lock(stream->mutex);
+  WsServerMessage message{
+      .type = "event", .session = session, .payload = payload, .seq = ++stream->last_seq};
+  const std::string json = message.to_json();
+  if (options_.replay_events_per_session > 0) {
+    stream->events.emplace_back(message.seq, json);
+    while (stream->events.size() > options_.replay_events_per_session) {
+      stream->events.pop_front();
+    }
+  }
+
   std::vector<std::shared_ptr<ClientState>> recipients;
   {
     std::lock_guard<std::mutex> lock(clients_mutex_);
@@ -427,8 +615,9 @@ std::size_t WebSocketServer::publish_session_event(const std::string &session,
   }
 
   std::size_t delivered = 0;
+  std::optional<std::string> deflated;
   for (const auto &client : recipients) {
-    if (send_server_message(client, message)) {
+    if (send_text_frame(client, json, &deflated)) {
       ++delivered;
     } else {
       remove_client(client->fd);
@@ -438,6 +627,45 @@ std::size_t WebSocketServer::publish_session_event(const std::string &session,
 #endif
 }
 
+std::uint64_t WebSocketServer::last_session_seq(const std::string &session) const {
+  std::shared_ptr<SessionStream> stream;
+  {
+    std::lock_guard<std::mutex> lock(streams_mutex_);
+    const auto it = streams_.find(session);
+    if (it == streams_.end()) {
+      return 0;
+    }
+    stream = it->second;
+  }
+  std::lock_guard<std::mutex> stream_lock(stream->mutex);
+  return stream->last_seq;
+}
+
+std::shared_ptr<WebSocketServer::SessionStream>
+WebSocketServer::stream_for(const std::string &session) {
+  std::lock_guard<std::mutex> lock(streams_mutex_);
+  auto &stream = streams_[session];
+  if (stream == nullptr) {
+    stream = std::make_shared<SessionStream>();
+    // Over the cap, forget the least recently used session. Its subscribers resubscribing
+    // later are told their position is gone rather than silently missing events.
+    if (streams_.size() > std::max<std::size_t>(options_.replay_max_sessions, 1)) {
+      auto oldest = streams_.end();
+      for (auto it = streams_.begin(); it != streams_.end(); ++it) {
+        if (it->second != stream &&
+            (oldest == streams_.end() || it->second->last_used < oldest->second->last_used)) {
+          oldest = it;
+        }
+      }
+      if (oldest != streams_.end()) {
+        streams_.erase(oldest);
+      }
+    }
+  }
+  stream->last_used = ++stream_clock_;
+  return stream;
+}
+
 common::Status WebSocketServer::validate_bind_address(const std::string &host) const {
   if (common::trim(host).empty()) {
     return common::Status::error("websocket host is empty");
@@ -511,10 +739,20 @@ void WebSocketServer::client_loop(const std::shared_ptr<ClientState> client) {
 
   while (running_) {
     std::uint8_t opcode = 0;
+    bool compressed = false;
     std::string payload;
-    if (!read_next_frame(client->fd, client->ssl, opcode, payload)) {
+    if (!read_next_frame(client->fd, client->ssl, opcode, compressed, payload)) {
       break;
     }
+    if (compressed) {
+      thread_local Inflater inflater;
+      std::string inflated;
+      if (!client->deflate || opcode >= 0x8u ||
+          !inflater.decompress(payload, kMaxFramePayloadBytes, inflated)) {
+        break;
+      }
+      payload = std::move(inflated);
+    }
     if (opcode == 0x8u) {
       break;
     }
@@ -603,10 +841,18 @@ bool WebSocketServer::perform_handshake(const std::shared_ptr<ClientState> &clie
   }
 
   const std::string accept_key = websocket_accept(common::trim(key_it->second));
-  return send_http_response(fd, ssl, 101, "Switching Protocols",
-                            {{"Upgrade", "websocket"},
-                             {"Connection", "Upgrade"},
-                             {"Sec-WebSocket-Accept", accept_key}});
+  std::vector<std::pair<std::string, std::string>> response_headers = {
+      {"Upgrade", "websocket"}, {"Connection", "Upgrade"}, {"Sec-WebSocket-Accept", accept_key}};
+  if (const auto extensions_it = headers.find("sec-websocket-extensions");
+      extensions_it != headers.end()) {
+    int window_bits = 15;
+    if (auto accepted = negotiate_deflate(extensions_it->second, window_bits)) {
+      response_headers.emplace_back("Sec-WebSocket-Extensions", std::move(*accepted));
+      client->deflate = true;
+      client->deflate_window_bits = window_bits;
+    }
+  }
+  return send_http_response(fd, ssl, 101, "Switching Protocols", response_headers);
 #else
   (void)client;
   return false;
@@ -644,17 +890,86 @@ void WebSocketServer::remove_client(const int fd) {
 #endif
 }
 
+void WebSocketServer::subscribe_client(const std::shared_ptr<ClientState> &client,
+                                       const WsClientMessage &message) {
+  std::optional<std::uint64_t> since;
+  if (const auto it = message.payload.find("since"); it != message.payload.end()) {
+    try {
+      since = std::stoull(it->second);
+    } catch (...) {
+      (void)send_server_message(client, WsServerMessage{.type = "error",
+                                                        .id = message.id,
+                                                        .error = "invalid since"});
+      return;
+    }
+  }
+
+  // Holding the stream lock keeps live events out until the replay has been sent.
+  const auto stream = stream_for(message.session);
+  std::lock_guard<std::mutex> stream_lock(stream->mutex);
+  {
+    std::lock_guard<std::mutex> lock(clients_mutex_);
+    client->sessions.insert(message.session);
+  }
+
+  RpcMap ack{{"action", "subscribe"}, {"seq", std::to_string(stream->last_seq)}};
+  std::vector<const std::string *> replay;
+  if (since.has_value()) {
+    const std::uint64_t oldest =
+        stream->events.empty() ? stream->last_seq + 1 : stream->events.front().first;
+    // The client is behind what is still kept, or ahead of this stream (which was
+    // forgotten or restarted), so replay cannot make it whole.
+    const bool truncated = *since + 1 < oldest || *since > stream->last_seq;
+    ack["truncated"] = truncated ? "true" : "false";
+    for (const auto &[seq, json] : stream->events) {
+      if (seq > *since) {
+        replay.push_back(&json);
+      }
+    }
+    ack["replayed"] = std::to_string(replay.size());
+  }
+  if (!send_server_message(client, WsServerMessage{.type = "ack",
+                                                   .id = message.id,
+                                                   .session = message.session,
+                                                   .payload = std::move(ack)})) {
+    return;
+  }
+  for (const auto *json : replay) {
+    if (!send_text_frame(client, *json)) {
+      return;
+    }
+  }
+}
+
 bool WebSocketServer::send_text_frame(const std::shared_ptr<ClientState> &client,
-                                      const std::string &payload) const {
+                                      const std::string &payload,
+                                      std::optional<std::string> *deflated) const {
 #ifndef _WIN32
   if (client == nullptr || client->fd < 0) {
     return false;
   }
+  if (client->deflate && payload.size() >= kDeflateMinBytes) {
+    thread_local Deflater deflater;
+    std::optional<std::string> own;
+    auto *compressed = (deflated != nullptr && client->deflate_window_bits == 15) ? deflated : &own;
+    if (!compressed->has_value()) {
+      *compressed = deflater.compress(payload, client->deflate_window_bits);
+      if (!compressed->has_value()) {
+        // Remembered as "not worth it" for the other recipients too.
+        *compressed = std::string();
+      }
+    }
+    if (!(*compressed)->empty() && (*compressed)->size() < payload.size()) {
+      std::lock_guard<std::mutex> write_lock(client->write_mutex);
+      return send_frame(client->fd, client->ssl, 0x1u, **compressed, true);
+    }
+  }
   std::lock_guard<std::mutex> write_lock(client->write_mutex);
   return send_frame(client->fd, client->ssl, 0x1u, payload);
 #else
   (void)client;
   (void)payload;
+  (void)deflated;
   return false;
 #endif
 }
@@ -675,12 +990,7 @@ void WebSocketServer::handle_client_message(const std::shared_ptr<ClientState> &
                                                 .error = "missing session"});
       return;
     }
-    client->sessions.insert(message.session);
-    (void)send_server_message(
-        client, WsServerMessage{.type = "ack",
-                                .id = message.id,
-                                .session = message.session,
-                                .payload = {{"action", "subscribe"}}});
+    subscribe_client(client, message);
     return;
   }
 
@@ -692,7 +1002,10 @@ void WebSocketServer::handle_client_message(const std::shared_ptr<ClientState> &
                                                 .error = "missing session"});
       return;
     }
-    (void)client->sessions.erase(message.session);
+    {
+      std::lock_guard<std::mutex> lock(clients_mutex_);
+      (void)client->sessions.erase(message.session);
+    }
     (void)send_server_message(
         client, WsServerMessage{.type = "ack",
                                 .id = message.id,
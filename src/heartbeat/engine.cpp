@@ -3,6 +3,7 @@
 #include "ghostclaw/common/fs.hpp"
 #include "ghostclaw/health/health.hpp"
 #include "ghostclaw/observability/global.hpp"
+#include "ghostclaw/providers/batch.hpp"
 
 #include <algorithm>
 #include <fstream>
@@ -19,14 +20,24 @@ void HeartbeatEngine::start() {
     return;
   }
   running_ = true;
+  cancel_ = std::make_shared<common::CancelToken>();
+  // Without batching, one thread keeps tasks running one after another as before.
+  tasks_ = std::make_unique<JobPool>(
+      providers::BatchLane::shared().config().enabled ? kBatchedJobThreads : 1);
   thread_ = std::thread([this]() { run_loop(); });
 }
 
 void HeartbeatEngine::stop() {
   running_ = false;
+  if (cancel_ != nullptr) {
+    cancel_->cancel();
+  }
   if (thread_.joinable()) {
     thread_.join();
   }
+  if (tasks_ != nullptr) {
+    tasks_->stop();
+  }
 }
 
 bool HeartbeatEngine::is_running() const { return running_; }
@@ -59,17 +70,20 @@ void HeartbeatEngine::run_loop() {
   while (running_) {
     observability::record_heartbeat_tick();
     health::mark_component_ok("heartbeat");
-    const auto tasks = parse_heartbeat_file(config_.tasks_file);
-    for (const auto &task : tasks) {
-      if (!running_) {
-        break;
-      }
-      (void)agent_.run(task.description);
+    // A task still running from an earlier tick is not started again.
+    for (auto &task : parse_heartbeat_file(config_.tasks_file)) {
+      const std::string key = task.description;
+      (void)tasks_->post(key, [this, description = std::move(task.description)]() {
+        agent::AgentOptions options;
+        options.priority = providers::RequestPriority::Deferred;
+        options.cancel_token = cancel_;
+        (void)agent_.run(description, options);
+      });
     }
-    const auto wait_ms = std::chrono::duration_cast<std::chrono::milliseconds>(config_.interval);
-    const auto steps = std::max<long long>(1, wait_ms.count() / 100);
-    for (long long i = 0; i < steps && running_; ++i) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    if (running_) {
+      (void)cancel_->wait_for(
+          std::max(std::chrono::duration_cast<std::chrono::milliseconds>(config_.interval),
+                   std::chrono::milliseconds(100)));
     }
   }
 }
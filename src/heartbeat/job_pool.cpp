@@ -0,0 +1,67 @@
+#include "ghostclaw/heartbeat/job_pool.hpp"
+
+#include <algorithm>
+
+namespace ghostclaw::heartbeat {
+
+JobPool::JobPool(const std::size_t threads) {
+  const std::size_t count = std::max<std::size_t>(1, threads);
+  workers_.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    workers_.emplace_back([this]() { worker_loop(); });
+  }
+}
+
+JobPool::~JobPool() { stop(); }
+
+bool JobPool::post(const std::string &key, std::function<void()> job) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_ || !busy_keys_.insert(key).second) {
+      return false;
+    }
+    queue_.emplace_back(key, std::move(job));
+  }
+  cv_.notify_one();
+  return true;
+}
+
+void JobPool::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    for (const auto &[key, job] : queue_) {
+      busy_keys_.erase(key);
+    }
+    queue_.clear();
+  }
+  cv_.notify_all();
+  for (auto &worker : workers_) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+}
+
+std::size_t JobPool::busy() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return busy_keys_.size();
+}
+
+void JobPool::worker_loop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    cv_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+    if (stopping_) {
+      return;
+    }
+    auto [key, job] = std::move(queue_.front());
+    queue_.pop_front();
+    lock.unlock();
+    job();
+    lock.lock();
+    busy_keys_.erase(key);
+  }
+}
+
+} // namespace ghostclaw::heartbeat
@@ -3,6 +3,7 @@
 #include "ghostclaw/channels/send_service.hpp"
 #include "ghostclaw/common/fs.hpp"
 #include "ghostclaw/common/json_util.hpp"
+#include "ghostclaw/providers/batch.hpp"
 
 #include <algorithm>
 #include <thread>
@@ -20,14 +21,24 @@ void Scheduler::start() {
     return;
   }
   running_ = true;
+  cancel_ = std::make_shared<common::CancelToken>();
+  // Without batching, one thread keeps jobs running one after another as before.
+  jobs_ = std::make_unique<JobPool>(
+      providers::BatchLane::shared().config().enabled ? kBatchedJobThreads : 1);
   thread_ = std::thread([this]() { run_loop(); });
 }
 
 void Scheduler::stop() {
   running_ = false;
+  if (cancel_ != nullptr) {
+    cancel_->cancel();
+  }
   if (thread_.joinable()) {
     thread_.join();
   }
+  if (jobs_ != nullptr) {
+    jobs_->stop();
+  }
 }
 
 bool Scheduler::is_running() const { return running_; }
@@ -36,13 +47,14 @@ void Scheduler::run_loop() {
   while (running_) {
     auto due_jobs = store_.get_due_jobs();
     if (due_jobs.ok()) {
-      for (const auto &job : due_jobs.value()) {
-        execute_job(job);
+      // A job stays due until its run finishes; the pool skips the ones still going.
+      for (auto &job : due_jobs.value()) {
+        const std::string key = job.id;
+        (void)jobs_->post(key, [this, job = std::move(job)]() { execute_job(job); });
       }
     }
-    const auto wait_steps = std::max<long long>(1, config_.poll_interval.count() / 100);
-    for (long long i = 0; i < wait_steps && running_; ++i) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    if (running_) {
+      (void)cancel_->wait_for(std::max(config_.poll_interval, std::chrono::milliseconds(100)));
     }
   }
 }
@@ -59,15 +71,18 @@ void Scheduler::execute_job(const CronJob &job) {
       }
       status = sent.error();
     } else {
-      auto result = agent_.run(job.command);
+      agent::AgentOptions options;
+      options.priority = providers::RequestPriority::Deferred;
+      options.cancel_token = cancel_;
+      auto result = agent_.run(job.command, options);
       if (result.ok()) {
         status = "ok";
         break;
       }
       status = result.error();
     }
-    if (attempt < config_.max_retries) {
-      std::this_thread::sleep_for(std::chrono::seconds(1));
+    if (attempt < config_.max_retries && cancel_->wait_for(std::chrono::seconds(1))) {
+      break;
     }
   }
 
@@ -9,6 +9,7 @@
 #include <fcntl.h>
 #include <iostream>
 #include <poll.h>
+#include <pthread.h>
 #include <sstream>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -18,6 +19,7 @@ namespace ghostclaw::mcp {
 namespace {
 
 constexpr int READ_TIMEOUT_MS = 30000;
+constexpr int POLL_SLICE_MS = 20;
 
 std::string build_jsonrpc_request(int id, const std::string &method,
                                    const std::string &params_json) {
@@ -32,8 +34,41 @@ std::string build_jsonrpc_request(int id, const std::string &method,
   return out.str();
 }
 
-std::string build_jsonrpc_notification(const std::string &method) {
-  return R"({"jsonrpc":"2.0","method":")" + method + R"(","params":{}})";
+std::string build_jsonrpc_notification(const std::string &method,
+                                       const std::string &params_json = "{}") {
+  return R"({"jsonrpc":"2.0","method":")" + method + R"(","params":)" + params_json + "}";
+}
+
+// Writes the whole line. SIGPIPE from a server that already exited is blocked for the
+// calling thread and discarded, so a dead server surfaces as an error instead of
+// terminating the process.
+bool write_all(const int fd, const std::string &data) {
+  sigset_t pipe_set;
+  sigset_t old_set;
+  sigemptyset(&pipe_set);
+  sigaddset(&pipe_set, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &pipe_set, &old_set);
+
+  bool ok = true;
+  std::size_t offset = 0;
+  while (offset < data.size()) {
+    const ssize_t written = write(fd, data.data() + offset, data.size() - offset);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EPIPE) {
+        const timespec no_wait{0, 0};
+        (void)sigtimedwait(&pipe_set, nullptr, &no_wait);
+      }
+      ok = false;
+      break;
+    }
+    offset += static_cast<std::size_t>(written);
+  }
+
+  pthread_sigmask(SIG_SETMASK, &old_set, nullptr);
+  return ok;
 }
 
 } // namespace
@@ -43,6 +78,11 @@ McpClient::McpClient(config::McpServerConfig config) : config_(std::move(config)
 McpClient::~McpClient() { stop(); }
 
 common::Status McpClient::start() {
+  std::lock_guard<std::mutex> lock(io_mutex_);
+  return start_locked();
+}
+
+common::Status McpClient::start_locked() {
   if (pid_ != -1) {
     return common::Status::error("MCP client already running");
   }
@@ -95,6 +135,8 @@ common::Status McpClient::start() {
   pid_ = pid;
   stdin_fd_ = to_child[1];
   stdout_fd_ = from_child[0];
+  started_once_ = true;
+  broken_ = false;
 
   // Set stdout non-blocking
   const int flags = fcntl(stdout_fd_, F_GETFL, 0);
@@ -106,28 +148,32 @@ common::Status McpClient::start() {
   auto init_request = build_jsonrpc_request(init_id, "initialize", init_params);
   init_request += '\n';
 
-  const ssize_t written = write(stdin_fd_, init_request.c_str(), init_request.size());
-  if (written < 0) {
-    stop();
+  if (!write_all(stdin_fd_, init_request)) {
+    stop_locked();
     return common::Status::error("failed to send initialize request");
   }
 
   // Read initialize response
   auto init_response = read_response(init_id);
   if (!init_response.ok()) {
-    stop();
+    stop_locked();
     return common::Status::error("MCP initialize failed: " + init_response.error());
   }
 
   // Send initialized notification
   auto notification = build_jsonrpc_notification("notifications/initialized");
   notification += '\n';
-  (void)write(stdin_fd_, notification.c_str(), notification.size());
+  (void)write_all(stdin_fd_, notification);
 
   return common::Status::success();
 }
 
 void McpClient::stop() {
+  std::lock_guard<std::mutex> lock(io_mutex_);
+  stop_locked();
+}
+
+void McpClient::stop_locked() {
   if (stdin_fd_ != -1) {
     close(stdin_fd_);
     stdin_fd_ = -1;
@@ -145,10 +191,51 @@ void McpClient::stop() {
   read_buffer_.clear();
 }
 
-bool McpClient::is_running() const { return pid_ != -1; }
+bool McpClient::is_running() const {
+  std::lock_guard<std::mutex> lock(io_mutex_);
+  return pid_ != -1;
+}
+
+bool McpClient::exited_locked() {
+  if (pid_ == -1) {
+    return true;
+  }
+  int status = 0;
+  const pid_t reaped = waitpid(pid_, &status, WNOHANG);
+  if (reaped == pid_ || (reaped < 0 && errno == ECHILD)) {
+    pid_ = -1;
+    return true;
+  }
+  return false;
+}
+
+common::Status McpClient::ensure_running_locked() {
+  const bool was_started = started_once_;
+  if (pid_ != -1 && !broken_ && !exited_locked()) {
+    return common::Status::success();
+  }
+  stop_locked();
+  auto status = start_locked();
+  if (status.ok() && was_started) {
+    restarts_.fetch_add(1);
+    std::cerr << "[mcp] restarted server '" << config_.id << "'\n";
+  }
+  return status;
+}
+
+bool McpClient::health_check() {
+  std::lock_guard<std::mutex> lock(io_mutex_);
+  if (!started_once_) {
+    return false;
+  }
+  return ensure_running_locked().ok();
+}
 
 common::Result<std::vector<McpToolInfo>> McpClient::list_tools() {
   std::lock_guard<std::mutex> lock(io_mutex_);
+  if (auto status = ensure_running_locked(); !status.ok()) {
+    return common::Result<std::vector<McpToolInfo>>::failure(status.error());
+  }
 
   auto response = send_request("tools/list", "{}");
   if (!response.ok()) {
@@ -187,9 +274,13 @@ common::Result<std::vector<McpToolInfo>> McpClient::list_tools() {
   return common::Result<std::vector<McpToolInfo>>::success(std::move(tools));
 }
 
-common::Result<std::string> McpClient::call_tool(const std::string &tool_name,
-                                                   const std::string &arguments_json) {
+common::Result<std::string>
+McpClient::call_tool(const std::string &tool_name, const std::string &arguments_json,
+                     const std::shared_ptr<common::CancelToken> &cancel_token) {
   std::lock_guard<std::mutex> lock(io_mutex_);
+  if (auto status = ensure_running_locked(); !status.ok()) {
+    return common::Result<std::string>::failure(status.error());
+  }
 
   std::string params = R"({"name":")" + common::json_escape(tool_name) + R"(","arguments":)";
   if (arguments_json.empty()) {
@@ -199,7 +290,13 @@ common::Result<std::string> McpClient::call_tool(const std::string &tool_name,
   }
   params += "}";
 
-  auto response = send_request("tools/call", params);
+  auto response = send_request("tools/call", params, cancel_token);
+  if (!response.ok() && broken_ && !written_) {
+    // The request never reached the server, so it is safe to send again.
+    if (auto status = ensure_running_locked(); status.ok()) {
+      response = send_request("tools/call", params, cancel_token);
+    }
+  }
   if (!response.ok()) {
     return common::Result<std::string>::failure(response.error());
   }
@@ -232,8 +329,9 @@ common::Result<std::string> McpClient::call_tool(const std::string &tool_name,
   return common::Result<std::string>::success(text);
 }
 
-common::Result<std::string> McpClient::send_request(const std::string &method,
-                                                      const std::string &params_json) {
+common::Result<std::string>
+McpClient::send_request(const std::string &method, const std::string &params_json,
+                        const std::shared_ptr<common::CancelToken> &cancel_token) {
   if (pid_ == -1 || stdin_fd_ == -1) {
     return common::Result<std::string>::failure("MCP client not running");
   }
@@ -242,15 +340,19 @@ common::Result<std::string> McpClient::send_request(const std::string &method,
   auto request = build_jsonrpc_request(id, method, params_json);
   request += '\n';
 
-  const ssize_t written = write(stdin_fd_, request.c_str(), request.size());
-  if (written < 0) {
+  written_ = false;
+  if (!write_all(stdin_fd_, request)) {
+    broken_ = true;
     return common::Result<std::string>::failure("failed to write to MCP server stdin");
   }
+  written_ = true;
 
-  return read_response(id);
+  return read_response(id, cancel_token);
 }
 
-common::Result<std::string> McpClient::read_response(int expected_id) {
+common::Result<std::string>
+McpClient::read_response(int expected_id,
+                         const std::shared_ptr<common::CancelToken> &cancel_token) {
   if (stdout_fd_ == -1) {
     return common::Result<std::string>::failure("MCP stdout not available");
   }
@@ -259,6 +361,15 @@ common::Result<std::string> McpClient::read_response(int expected_id) {
   int elapsed = 0;
 
   while (elapsed < deadline_ms) {
+    if (common::is_cancelled(cancel_token)) {
+      auto cancel = build_jsonrpc_notification(
+          "notifications/cancelled",
+          R"({"requestId":)" + std::to_string(expected_id) + R"(,"reason":"cancelled by client"})");
+      cancel += '\n';
+      (void)write_all(stdin_fd_, cancel);
+      return common::Result<std::string>::failure("MCP request cancelled");
+    }
+
     // Check if we have a complete line in the buffer
     auto newline_pos = read_buffer_.find('\n');
     if (newline_pos != std::string::npos) {
@@ -303,8 +414,8 @@ common::Result<std::string> McpClient::read_response(int expected_id) {
     struct pollfd pfd{};
     pfd.fd = stdout_fd_;
     pfd.events = POLLIN;
-    const int poll_result = poll(&pfd, 1, 100);
-    elapsed += 100;
+    const int poll_result = poll(&pfd, 1, POLL_SLICE_MS);
+    elapsed += POLL_SLICE_MS;
 
     if (poll_result > 0 && (pfd.revents & POLLIN) != 0) {
       std::array<char, 4096> buf{};
@@ -312,6 +423,7 @@ common::Result<std::string> McpClient::read_response(int expected_id) {
       if (bytes > 0) {
         read_buffer_.append(buf.data(), static_cast<std::size_t>(bytes));
       } else if (bytes == 0) {
+        broken_ = true;
         return common::Result<std::string>::failure("MCP server closed stdout");
       }
     }
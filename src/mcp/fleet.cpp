@@ -0,0 +1,202 @@
+#include "ghostclaw/mcp/fleet.hpp"
+
+#include "ghostclaw/common/json_util.hpp"
+#include "ghostclaw/mcp/tool.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <sstream>
+
+namespace ghostclaw::mcp {
+
+namespace {
+
+// Servers are the same when they would be launched the same way.
+std::string server_key(const config::McpServerConfig &server) {
+  std::vector<std::pair<std::string, std::string>> env(server.env.begin(), server.env.end());
+  std::sort(env.begin(), env.end());
+  std::string key = server.id;
+  key.push_back('\0');
+  key += server.command;
+  for (const auto &arg : server.args) {
+    key.push_back('\0');
+    key += arg;
+  }
+  for (const auto &[name, value] : env) {
+    key.push_back('\0');
+    key += name + "=" + value;
+  }
+  return key;
+}
+
+std::filesystem::path cache_path(const std::filesystem::path &cache_dir,
+                                 const config::McpServerConfig &server) {
+  std::ostringstream name;
+  name << server.id << "-" << std::hex << std::hash<std::string>{}(server_key(server))
+       << ".tools.json";
+  return cache_dir / name.str();
+}
+
+std::string serialize_tools(const std::vector<McpToolInfo> &tools) {
+  std::ostringstream out;
+  out << "[";
+  for (std::size_t i = 0; i < tools.size(); ++i) {
+    if (i > 0) {
+      out << ",";
+    }
+    out << "{\"name\":\"" << common::json_escape(tools[i].name) << "\",\"description\":\""
+        << common::json_escape(tools[i].description)
+        << "\",\"inputSchema\":" << tools[i].input_schema_json << "}";
+  }
+  out << "]";
+  return out.str();
+}
+
+void store_cached_tools(const std::filesystem::path &path, const std::vector<McpToolInfo> &tools) {
+  std::error_code ec;
+  std::filesystem::create_directories(path.parent_path(), ec);
+  const auto tmp = path.string() + ".tmp";
+  {
+    std::ofstream file(tmp, std::ios::trunc);
+    if (!file) {
+      return;
+    }
+    file << serialize_tools(tools);
+  }
+  std::filesystem::rename(tmp, path, ec);
+}
+
+} // namespace
+
+McpFleet &McpFleet::shared() {
+  static McpFleet fleet;
+  return fleet;
+}
+
+std::shared_ptr<McpClient> McpFleet::acquire(const config::McpServerConfig &server) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto &slot = servers_[server_key(server)];
+  if (auto client = slot.client.lock()) {
+    return client;
+  }
+  auto client = std::make_shared<McpClient>(server);
+  slot.client = client;
+  return client;
+}
+
+std::optional<std::vector<McpToolInfo>>
+McpFleet::load_cached_tools(const std::filesystem::path &path) const {
+  std::error_code ec;
+  const auto modified = std::filesystem::last_write_time(path, ec);
+  if (ec || std::filesystem::file_time_type::clock::now() - modified > cache_ttl_) {
+    return std::nullopt;
+  }
+  std::ifstream file(path);
+  if (!file) {
+    return std::nullopt;
+  }
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+
+  std::vector<McpToolInfo> tools;
+  for (const auto &tool_json : common::json_split_top_level_objects(buffer.str())) {
+    McpToolInfo info;
+    info.name = common::json_get_string(tool_json, "name");
+    info.description = common::json_get_string(tool_json, "description");
+    info.input_schema_json = common::json_get_object(tool_json, "inputSchema");
+    if (info.name.empty() || info.input_schema_json.empty()) {
+      return std::nullopt;
+    }
+    tools.push_back(std::move(info));
+  }
+  return tools;
+}
+
+std::vector<std::unique_ptr<tools::ITool>>
+McpFleet::collect_tools(const std::vector<config::McpServerConfig> &servers,
+                        const std::filesystem::path &cache_dir) {
+  struct Pending {
+    const config::McpServerConfig *server = nullptr;
+    std::shared_ptr<McpClient> client;
+    std::optional<std::vector<McpToolInfo>> tools;
+    std::future<common::Result<std::vector<McpToolInfo>>> listing;
+  };
+
+  std::vector<Pending> entries;
+  for (const auto &server : servers) {
+    if (!server.enabled) continue;
+    Pending entry;
+    entry.server = &server;
+    entry.client = acquire(server);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      entry.tools = servers_[server_key(server)].tools;
+    }
+    if (!entry.tools.has_value() && !cache_dir.empty()) {
+      entry.tools = load_cached_tools(cache_path(cache_dir, server));
+    }
+    if (!entry.tools.has_value()) {
+      // list_tools starts the server; each initialize handshake runs on its own thread.
+      entry.listing = std::async(std::launch::async,
+                                 [client = entry.client]() { return client->list_tools(); });
+    }
+    entries.push_back(std::move(entry));
+  }
+
+  std::vector<std::unique_ptr<tools::ITool>> tools;
+  for (auto &entry : entries) {
+    if (entry.listing.valid()) {
+      auto listed = entry.listing.get();
+      if (!listed.ok()) {
+        std::cerr << "[mcp] failed to list tools for server '" << entry.server->id
+                  << "': " << listed.error() << "\n";
+        continue;
+      }
+      entry.tools = std::move(listed.value());
+      if (!cache_dir.empty()) {
+        store_cached_tools(cache_path(cache_dir, *entry.server), *entry.tools);
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      servers_[server_key(*entry.server)].tools = entry.tools;
+    }
+    for (auto &info : *entry.tools) {
+      tools.push_back(std::make_unique<McpTool>(entry.server->id, std::move(info), entry.client));
+    }
+  }
+
+  return tools;
+}
+
+std::vector<std::shared_ptr<McpClient>> McpFleet::live_clients() const {
+  std::vector<std::shared_ptr<McpClient>> clients;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto &[key, slot] : servers_) {
+    (void)key;
+    if (auto client = slot.client.lock()) {
+      clients.push_back(std::move(client));
+    }
+  }
+  return clients;
+}
+
+std::size_t McpFleet::check_health() {
+  std::size_t healthy = 0;
+  for (const auto &client : live_clients()) {
+    if (client->health_check()) {
+      ++healthy;
+    }
+  }
+  return healthy;
+}
+
+std::size_t McpFleet::running_count() const {
+  const auto clients = live_clients();
+  return static_cast<std::size_t>(std::count_if(
+      clients.begin(), clients.end(), [](const auto &client) { return client->is_running(); }));
+}
+
+} // namespace ghostclaw::mcp
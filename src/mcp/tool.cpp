@@ -24,7 +24,7 @@ std::string_view McpTool::description() const { return info_.description; }
 std::string McpTool::parameters_schema() const { return info_.input_schema_json; }
 
 common::Result<tools::ToolResult> McpTool::execute(const tools::ToolArgs &args,
-                                                    const tools::ToolContext &) {
+                                                    const tools::ToolContext &ctx) {
   // Convert ToolArgs map to JSON object
   std::ostringstream json;
   json << '{';
@@ -36,7 +36,7 @@ common::Result<tools::ToolResult> McpTool::execute(const tools::ToolArgs &args,
   }
   json << '}';
 
-  auto result = client_->call_tool(info_.name, json.str());
+  auto result = client_->call_tool(info_.name, json.str(), ctx.cancel_token);
   if (!result.ok()) {
     return common::Result<tools::ToolResult>::failure(result.error());
   }
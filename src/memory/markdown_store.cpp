@@ -88,6 +88,7 @@ common::Status MarkdownMemory::append_entry(const std::filesystem::path &path,
 
 common::Status MarkdownMemory::store(const std::string &key, const std::string &content,
                                      const MemoryCategory category) {
+  std::lock_guard<std::mutex> lock(mutex_);
   MemoryEntry entry;
   entry.key = key;
   entry.content = content;
@@ -143,6 +144,7 @@ common::Result<std::vector<MemoryEntry>> MarkdownMemory::load_all() const {
 
 common::Result<std::vector<MemoryEntry>> MarkdownMemory::recall(const std::string &query,
                                                                 const std::size_t limit) {
+  std::lock_guard<std::mutex> lock(mutex_);
   auto all = load_all();
   if (!all.ok()) {
     return all;
@@ -169,6 +171,7 @@ common::Result<std::vector<MemoryEntry>> MarkdownMemory::recall(const std::strin
 }
 
 common::Result<std::optional<MemoryEntry>> MarkdownMemory::get(const std::string &key) {
+  std::lock_guard<std::mutex> lock(mutex_);
   auto all = load_all();
   if (!all.ok()) {
     return common::Result<std::optional<MemoryEntry>>::failure(all.error());
@@ -185,6 +188,7 @@ common::Result<std::optional<MemoryEntry>> MarkdownMemory::get(const std::string
 
 common::Result<std::vector<MemoryEntry>>
 MarkdownMemory::list(const std::optional<MemoryCategory> category) {
+  std::lock_guard<std::mutex> lock(mutex_);
   auto all = load_all();
   if (!all.ok()) {
     return all;
@@ -204,6 +208,7 @@ MarkdownMemory::list(const std::optional<MemoryCategory> category) {
 }
 
 common::Result<bool> MarkdownMemory::forget(const std::string &key) {
+  std::lock_guard<std::mutex> lock(mutex_);
   auto all = load_all();
   if (!all.ok()) {
     return common::Result<bool>::failure(all.error());
@@ -237,6 +242,7 @@ common::Result<bool> MarkdownMemory::forget(const std::string &key) {
 }
 
 common::Result<std::size_t> MarkdownMemory::count() {
+  std::lock_guard<std::mutex> lock(mutex_);
   auto all = load_all();
   if (!all.ok()) {
     return common::Result<std::size_t>::failure(all.error());
@@ -6,8 +6,10 @@
 #include "ghostclaw/memory/sqlite_store.hpp"
 #include "ghostclaw/memory/embedder.hpp"
 
+#include <atomic>
 #include <cmath>
 #include <chrono>
+#include <random>
 #include <ctime>
 #include <iomanip>
 #include <sstream>
@@ -57,6 +59,23 @@ std::string now_rfc3339() {
   return out.str();
 }
 
+std::string unique_memory_key(const std::string_view prefix) {
+  static std::atomic<std::uint32_t> sequence{0};
+  static const std::uint32_t process_salt = static_cast<std::uint32_t>(std::random_device{}());
+  const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(
+                           std::chrono::system_clock::now().time_since_epoch())
+                           .count();
+  std::ostringstream out;
+  out << prefix << '_' << seconds << '_' << std::hex << std::setfill('0') << std::setw(8)
+      << process_salt << std::setw(4) << (sequence.fetch_add(1) & 0xffffU);
+  return out.str();
+}
+
+std::uint64_t next_write_epoch() {
+  static std::atomic<std::uint64_t> epoch{0};
+  return epoch.fetch_add(1) + 1;
+}
+
 double recency_score(const std::string &updated_at, const double half_life_days) {
   std::tm tm{};
   std::istringstream in(updated_at);
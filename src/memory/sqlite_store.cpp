@@ -93,6 +93,11 @@ common::Status SqliteMemory::init_schema() {
   if (!status.ok()) {
     return status;
   }
+  // Gateway workers share this database; wait on a writer instead of failing with SQLITE_BUSY.
+  status = exec_sql(db_, "PRAGMA busy_timeout=5000;");
+  if (!status.ok()) {
+    return status;
+  }
 
   status = exec_sql(db_, R"(
 CREATE TABLE IF NOT EXISTS memories (
@@ -267,6 +272,92 @@ common::Status SqliteMemory::store(const std::string &key, const std::string &co
     embedding = std::move(embedded.value());
   }
 
+  auto status = write_entry(key, content, category, embedding);
+  if (!status.ok()) {
+    return status;
+  }
+  return update_vector_index(key, embedding);
+}
+
+common::Status SqliteMemory::store_batch(const std::vector<MemoryEntry> &entries) {
+  if (entries.empty()) {
+    return common::Status::success();
+  }
+
+  std::vector<std::optional<std::vector<float>>> embeddings(entries.size());
+  std::vector<std::size_t> missing;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (db_ == nullptr) {
+      return common::Status::error("database not initialized");
+    }
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+      auto cached = cached_embedding(entries[i].content);
+      if (cached.ok() && cached.value().has_value()) {
+        embeddings[i] = std::move(*cached.value());
+      } else {
+        missing.push_back(i);
+      }
+    }
+  }
+
+  // One embedding request for the whole batch, made without the lock so recall is not
+  // stuck behind the round trip.
+  std::vector<std::size_t> fresh;
+  if (!missing.empty()) {
+    std::vector<std::string> texts;
+    texts.reserve(missing.size());
+    for (const auto index : missing) {
+      texts.push_back(entries[index].content);
+    }
+    auto embedded = embedder_->embed_batch(texts);
+    if (embedded.ok() && embedded.value().size() == missing.size()) {
+      for (std::size_t i = 0; i < missing.size(); ++i) {
+        if (!embedded.value()[i].empty()) {
+          embeddings[missing[i]] = std::move(embedded.value()[i]);
+          fresh.push_back(missing[i]);
+        }
+      }
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (db_ == nullptr) {
+    return common::Status::error("database not initialized");
+  }
+  auto status = exec_sql(db_, "BEGIN IMMEDIATE;");
+  if (!status.ok()) {
+    return status;
+  }
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    status = write_entry(entries[i].key, entries[i].content, entries[i].category, embeddings[i]);
+    if (!status.ok()) {
+      (void)exec_sql(db_, "ROLLBACK;");
+      return status;
+    }
+  }
+  for (const auto index : fresh) {
+    (void)cache_embedding(entries[index].content, *embeddings[index]);
+  }
+  status = exec_sql(db_, "COMMIT;");
+  if (!status.ok()) {
+    (void)exec_sql(db_, "ROLLBACK;");
+    return status;
+  }
+
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    status = update_vector_index(entries[i].key, embeddings[i]);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  return common::Status::success();
+}
+
+common::Status SqliteMemory::write_entry(const std::string &key, const std::string &content,
+                                         const MemoryCategory category,
+                                         const std::optional<std::vector<float>> &embedding) {
+  write_epoch_ = next_write_epoch();
   std::string created_at = now_rfc3339();
   std::string updated_at = created_at;
 
@@ -313,16 +404,15 @@ ON CONFLICT(key) DO UPDATE SET
   if (rc != SQLITE_DONE) {
     return common::Status::error(sqlite3_errmsg(db_));
   }
+  return common::Status::success();
+}
 
+common::Status SqliteMemory::update_vector_index(const std::string &key,
+                                                 const std::optional<std::vector<float>> &embedding) {
   if (embedding.has_value()) {
-    auto index_status = vector_index_.add(key, *embedding);
-    if (!index_status.ok()) {
-      return index_status;
-    }
-  } else {
-    (void)vector_index_.remove(key);
+    return vector_index_.add(key, *embedding);
   }
-
+  (void)vector_index_.remove(key);
   return common::Status::success();
 }
 
@@ -536,6 +626,7 @@ common::Result<bool> SqliteMemory::forget(const std::string &key) {
   const bool removed = sqlite3_changes(db_) > 0;
   if (removed) {
     (void)vector_index_.remove(key);
+    write_epoch_ = next_write_epoch();
   }
 
   return common::Result<bool>::success(removed);
@@ -558,6 +649,7 @@ common::Result<std::size_t> SqliteMemory::count() {
 
 common::Status SqliteMemory::reindex() {
   std::lock_guard<std::mutex> lock(mutex_);
+  write_epoch_ = next_write_epoch();
   vector_index_ = VectorIndex(embedder_->dimensions());
 
   sqlite3_stmt *stmt = nullptr;
@@ -584,6 +676,8 @@ common::Status SqliteMemory::reindex() {
   return common::Status::success();
 }
 
+std::optional<std::uint64_t> SqliteMemory::write_epoch() const { return write_epoch_.load(); }
+
 bool SqliteMemory::health_check() {
   std::lock_guard<std::mutex> lock(mutex_);
   if (db_ == nullptr) {
@@ -1,6 +1,7 @@
 #include "ghostclaw/memory/workspace_indexer.hpp"
 
 #include "ghostclaw/memory/chunker.hpp"
+#include "ghostclaw/memory/workspace_walk.hpp"
 
 #include <fstream>
 #include <sstream>
@@ -50,23 +51,15 @@ common::Status WorkspaceIndexer::index_workspace() {
     return common::Status::error("workspace missing");
   }
 
-  for (const auto &entry : std::filesystem::recursive_directory_iterator(workspace_)) {
-    if (!entry.is_regular_file()) {
-      continue;
+  common::Status status = common::Status::success();
+  walk_workspace(workspace_, [&](const WorkspaceFile &file) {
+    const auto ext = file.path.extension().string();
+    if (!status.ok() || (ext != ".md" && ext != ".txt")) {
+      return;
     }
-
-    const auto ext = entry.path().extension().string();
-    if (ext != ".md" && ext != ".txt") {
-      continue;
-    }
-
-    auto status = index_file(entry.path());
-    if (!status.ok()) {
-      return status;
-    }
-  }
-
-  return common::Status::success();
+    status = index_file(file.path);
+  });
+  return status;
 }
 
 common::Status WorkspaceIndexer::watch_for_changes() {
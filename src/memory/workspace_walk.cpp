@@ -0,0 +1,261 @@
+#include "ghostclaw/memory/workspace_walk.hpp"
+
+#include "ghostclaw/common/fs.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+namespace ghostclaw::memory {
+
+namespace {
+
+struct IgnoreRule {
+  // Directory of the .gitignore that declared the rule, relative to the root ("" at top).
+  std::string base;
+  std::string pattern;
+  bool negated = false;
+  bool directory_only = false;
+  // Patterns with a '/' before their end match from `base`; others match any basename.
+  bool anchored = false;
+};
+
+bool match_class(std::string_view pattern, std::size_t &pi, const char ch) {
+  // pattern[pi] == '['; on return pi is just past the closing ']'.
+  std::size_t i = pi + 1;
+  bool negate = false;
+  if (i < pattern.size() && (pattern[i] == '!' || pattern[i] == '^')) {
+    negate = true;
+    ++i;
+  }
+  bool matched = false;
+  bool first = true;
+  while (i < pattern.size() && (first || pattern[i] != ']')) {
+    first = false;
+    char lo = pattern[i];
+    char hi = lo;
+    if (i + 2 < pattern.size() && pattern[i + 1] == '-' && pattern[i + 2] != ']') {
+      hi = pattern[i + 2];
+      i += 2;
+    }
+    if (ch >= lo && ch <= hi) {
+      matched = true;
+    }
+    ++i;
+  }
+  pi = i < pattern.size() ? i + 1 : i;
+  return matched != negate;
+}
+
+bool glob_match(std::string_view pattern, std::string_view path) {
+  std::size_t pi = 0;
+  std::size_t si = 0;
+  // Backtracking points for the most recent `*` and `**`.
+  std::size_t star_p = std::string_view::npos;
+  std::size_t star_s = 0;
+  std::size_t globstar_p = std::string_view::npos;
+  std::size_t globstar_s = 0;
+  // `**/` resumes only at the start of a segment.
+  bool globstar_segment = false;
+  while (si < path.size()) {
+    if (pi < pattern.size()) {
+      if (pattern.substr(pi, 2) == "**") {
+        pi += 2;
+        globstar_segment = pi < pattern.size() && pattern[pi] == '/';
+        if (globstar_segment) {
+          ++pi;
+        }
+        globstar_p = pi;
+        globstar_s = si;
+        star_p = std::string_view::npos;
+        continue;
+      }
+      const char pc = pattern[pi];
+      if (pc == '*') {
+        star_p = ++pi;
+        star_s = si;
+        continue;
+      }
+      if (pc == '?' && path[si] != '/') {
+        ++pi;
+        ++si;
+        continue;
+      }
+      if (pc == '[' && path[si] != '/') {
+        std::size_t next = pi;
+        if (match_class(pattern, next, path[si])) {
+          pi = next;
+          ++si;
+          continue;
+        }
+      } else if (pc == '\\' && pi + 1 < pattern.size() && pattern[pi + 1] == path[si]) {
+        pi += 2;
+        ++si;
+        continue;
+      } else if (pc != '?' && pc != '[' && pc == path[si]) {
+        ++pi;
+        ++si;
+        continue;
+      }
+    }
+    if (star_p != std::string_view::npos && path[star_s] != '/') {
+      pi = star_p;
+      si = ++star_s;
+      continue;
+    }
+    if (globstar_p != std::string_view::npos) {
+      if (globstar_segment) {
+        const auto slash = path.find('/', globstar_s);
+        if (slash == std::string_view::npos) {
+          return false;
+        }
+        globstar_s = slash + 1;
+      } else {
+        ++globstar_s;
+      }
+      pi = globstar_p;
+      si = globstar_s;
+      star_p = std::string_view::npos;
+      continue;
+    }
+    return false;
+  }
+  while (pi < pattern.size() && pattern[pi] == '*') {
+    ++pi;
+  }
+  return pi == pattern.size();
+}
+
+void load_gitignore(const std::filesystem::path &file, const std::string &base,
+                    std::vector<IgnoreRule> &rules) {
+  std::ifstream in(file);
+  std::string line;
+  while (std::getline(in, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    while (!line.empty() && line.back() == ' ' &&
+           (line.size() < 2 || line[line.size() - 2] != '\\')) {
+      line.pop_back();
+    }
+    if (line.empty() || line.front() == '#') {
+      continue;
+    }
+    IgnoreRule rule;
+    rule.base = base;
+    if (line.front() == '!') {
+      rule.negated = true;
+      line.erase(0, 1);
+    } else if (line.front() == '\\' && line.size() > 1 && (line[1] == '!' || line[1] == '#')) {
+      line.erase(0, 1);
+    }
+    if (!line.empty() && line.back() == '/') {
+      rule.directory_only = true;
+      line.pop_back();
+    }
+    rule.anchored = line.find('/') != std::string::npos;
+    if (!line.empty() && line.front() == '/') {
+      line.erase(0, 1);
+    }
+    if (line.empty()) {
+      continue;
+    }
+    rule.pattern = std::move(line);
+    rules.push_back(std::move(rule));
+  }
+}
+
+bool is_ignored(const std::vector<IgnoreRule> &rules, const std::string &relative,
+                const bool is_directory) {
+  bool ignored = false;
+  const auto slash = relative.rfind('/');
+  const std::string_view basename =
+      slash == std::string::npos ? std::string_view(relative)
+                                 : std::string_view(relative).substr(slash + 1);
+  for (const auto &rule : rules) {
+    if (ignored != rule.negated || (rule.directory_only && !is_directory)) {
+      continue;
+    }
+    bool matched = false;
+    if (rule.anchored) {
+      if (rule.base.empty()) {
+        matched = glob_match(rule.pattern, relative);
+      } else if (relative.size() > rule.base.size() &&
+                 relative.compare(0, rule.base.size(), rule.base) == 0 &&
+                 relative[rule.base.size()] == '/') {
+        matched = glob_match(rule.pattern,
+                             std::string_view(relative).substr(rule.base.size() + 1));
+      }
+    } else {
+      matched = glob_match(rule.pattern, basename);
+    }
+    if (matched) {
+      ignored = !rule.negated;
+    }
+  }
+  return ignored;
+}
+
+void walk_dir(const std::filesystem::path &dir, const std::string &relative_dir,
+              std::vector<IgnoreRule> &rules,
+              const std::function<void(const WorkspaceFile &)> &visit) {
+  const std::size_t inherited_rules = rules.size();
+  std::error_code ec;
+  if (std::filesystem::is_regular_file(dir / ".gitignore", ec)) {
+    load_gitignore(dir / ".gitignore", relative_dir, rules);
+  }
+
+  std::vector<std::filesystem::directory_entry> entries;
+  for (std::filesystem::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+    entries.push_back(*it);
+  }
+  // A stable order keeps results and the persisted index deterministic.
+  std::sort(entries.begin(), entries.end(),
+            [](const auto &a, const auto &b) { return a.path().filename() < b.path().filename(); });
+
+  for (const auto &entry : entries) {
+    const std::string name = entry.path().filename().string();
+    const std::string relative = relative_dir.empty() ? name : relative_dir + "/" + name;
+    const auto status = entry.symlink_status(ec);
+    if (ec || std::filesystem::is_symlink(status)) {
+      continue;
+    }
+    if (std::filesystem::is_directory(status)) {
+      if (name == ".git" || name == ".ghostclaw" || is_ignored(rules, relative, true)) {
+        continue;
+      }
+      walk_dir(entry.path(), relative, rules, visit);
+      continue;
+    }
+    if (!std::filesystem::is_regular_file(status) || is_ignored(rules, relative, false)) {
+      continue;
+    }
+    WorkspaceFile file;
+    file.path = entry.path();
+    file.relative = relative;
+    file.size = entry.file_size(ec);
+    if (ec) {
+      continue;
+    }
+    file.mtime = entry.last_write_time(ec);
+    if (ec) {
+      continue;
+    }
+    visit(file);
+  }
+  rules.resize(inherited_rules);
+}
+
+} // namespace
+
+void walk_workspace(const std::filesystem::path &root,
+                    const std::function<void(const WorkspaceFile &)> &visit) {
+  std::vector<IgnoreRule> rules;
+  walk_dir(root, "", rules, visit);
+}
+
+bool gitignore_glob_match(const std::string_view pattern, const std::string_view path) {
+  return glob_match(pattern, path);
+}
+
+} // namespace ghostclaw::memory
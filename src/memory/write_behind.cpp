@@ -0,0 +1,333 @@
+#include "ghostclaw/memory/write_behind.hpp"
+
+#include "ghostclaw/common/fs.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <unordered_set>
+#include <utility>
+
+namespace ghostclaw::memory {
+
+namespace {
+
+// A batch the backend rejects is retried this many times in all before it is dropped.
+constexpr int kMaxStoreAttempts = 3;
+
+std::vector<std::string> keyword_terms(const std::string &text) {
+  std::vector<std::string> terms;
+  std::string current;
+  for (const char ch : text) {
+    if (std::isalnum(static_cast<unsigned char>(ch)) != 0) {
+      current.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(ch))));
+      continue;
+    }
+    if (current.size() >= 2) {
+      terms.push_back(current);
+    }
+    current.clear();
+  }
+  if (current.size() >= 2) {
+    terms.push_back(current);
+  }
+  return terms;
+}
+
+// Fraction of query terms present in the entry; 0 when nothing matches.
+double keyword_score(const std::vector<std::string> &terms, const MemoryEntry &entry) {
+  if (terms.empty()) {
+    return 0.5;
+  }
+  const std::string haystack = common::to_lower(entry.key + " " + entry.content);
+  std::size_t hits = 0;
+  for (const auto &term : terms) {
+    if (haystack.find(term) != std::string::npos) {
+      ++hits;
+    }
+  }
+  return static_cast<double>(hits) / static_cast<double>(terms.size());
+}
+
+} // namespace
+
+WriteBehindMemory::WriteBehindMemory(std::unique_ptr<IMemory> inner, WriteBehindOptions options)
+    : inner_(std::move(inner)), options_(options) {
+  options_.max_batch = std::max<std::size_t>(1, options_.max_batch);
+  writer_ = std::thread([this]() { writer_loop(); });
+}
+
+WriteBehindMemory::~WriteBehindMemory() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  work_cv_.notify_all();
+  if (writer_.joinable()) {
+    writer_.join();
+  }
+}
+
+void WriteBehindMemory::enqueue(std::string key, std::string content,
+                                const MemoryCategory category) {
+  MemoryEntry entry;
+  entry.key = std::move(key);
+  entry.content = std::move(content);
+  entry.category = category;
+  entry.created_at = now_rfc3339();
+  entry.updated_at = entry.created_at;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.push_back(std::move(entry));
+    queue_epoch_ = next_write_epoch();
+  }
+  work_cv_.notify_one();
+}
+
+std::size_t WriteBehindMemory::pending() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return queue_.size() + in_flight_.size();
+}
+
+void WriteBehindMemory::writer_loop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    work_cv_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+    if (queue_.empty()) {
+      break;
+    }
+    // Linger briefly so turns that finish close together share one embedding request.
+    if (!stopping_ && !flush_requested_ && queue_.size() < options_.max_batch) {
+      work_cv_.wait_for(lock, options_.linger, [this]() {
+        return stopping_ || flush_requested_ || queue_.size() >= options_.max_batch;
+      });
+    }
+
+    const std::size_t take = std::min(queue_.size(), options_.max_batch);
+    in_flight_.assign(std::make_move_iterator(queue_.begin()),
+                      std::make_move_iterator(queue_.begin() + static_cast<std::ptrdiff_t>(take)));
+    queue_.erase(queue_.begin(), queue_.begin() + static_cast<std::ptrdiff_t>(take));
+
+    const auto batch = in_flight_;
+    lock.unlock();
+    auto status = inner_->store_batch(batch);
+    lock.lock();
+    // Retry in place so the entries stay visible and keep their order against later
+    // writes of the same keys; back off unless shutting down.
+    for (int attempt = 1; !status.ok() && attempt < kMaxStoreAttempts; ++attempt) {
+      work_cv_.wait_for(lock, options_.retry_backoff * attempt, [this]() { return stopping_; });
+      lock.unlock();
+      status = inner_->store_batch(batch);
+      lock.lock();
+    }
+
+    if (!status.ok()) {
+      last_error_ = status.error();
+      std::cerr << "[memory] write-behind dropped " << batch.size() << " entries after "
+                << kMaxStoreAttempts << " attempts: " << status.error() << "\n";
+    }
+    in_flight_.clear();
+    if (queue_.empty()) {
+      flush_requested_ = false;
+    }
+    drained_cv_.notify_all();
+  }
+  drained_cv_.notify_all();
+}
+
+common::Status WriteBehindMemory::flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  flush_requested_ = true;
+  work_cv_.notify_all();
+  drained_cv_.wait(lock, [this]() { return queue_.empty() && in_flight_.empty(); });
+  const std::string error = std::exchange(last_error_, std::string());
+  lock.unlock();
+
+  auto inner_status = inner_->flush();
+  if (!error.empty()) {
+    return common::Status::error("write-behind store failed: " + error);
+  }
+  return inner_status;
+}
+
+void WriteBehindMemory::drop_queued_locked(const std::string &key) {
+  const auto kept = std::remove_if(queue_.begin(), queue_.end(),
+                                   [&key](const MemoryEntry &entry) { return entry.key == key; });
+  if (kept != queue_.end()) {
+    queue_.erase(kept, queue_.end());
+    queue_epoch_ = next_write_epoch();
+  }
+}
+
+void WriteBehindMemory::wait_for_in_flight_locked(std::unique_lock<std::mutex> &lock,
+                                                  const std::string &key) {
+  drained_cv_.wait(lock, [this, &key]() {
+    return std::none_of(in_flight_.begin(), in_flight_.end(),
+                        [&key](const MemoryEntry &entry) { return entry.key == key; });
+  });
+}
+
+std::vector<MemoryEntry> WriteBehindMemory::pending_entries() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<MemoryEntry> out(in_flight_.begin(), in_flight_.end());
+  out.insert(out.end(), queue_.begin(), queue_.end());
+  return out;
+}
+
+std::size_t WriteBehindMemory::unstored_pending() {
+  std::unordered_set<std::string> keys;
+  for (const auto &entry : pending_entries()) {
+    keys.insert(entry.key);
+  }
+  std::size_t unstored = 0;
+  for (const auto &key : keys) {
+    auto stored = inner_->get(key);
+    if (!stored.ok() || !stored.value().has_value()) {
+      ++unstored;
+    }
+  }
+  return unstored;
+}
+
+std::string_view WriteBehindMemory::name() const { return inner_->name(); }
+
+common::Status WriteBehindMemory::store(const std::string &key, const std::string &content,
+                                        const MemoryCategory category) {
+  {
+    // An explicit write supersedes a queued one for the same key. One already handed to
+    // the backend is older too; let it land first so it cannot overwrite this one.
+    std::unique_lock<std::mutex> lock(mutex_);
+    drop_queued_locked(key);
+    wait_for_in_flight_locked(lock, key);
+  }
+  return inner_->store(key, content, category);
+}
+
+common::Status WriteBehindMemory::store_batch(const std::vector<MemoryEntry> &entries) {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (const auto &entry : entries) {
+      drop_queued_locked(entry.key);
+      wait_for_in_flight_locked(lock, entry.key);
+    }
+  }
+  return inner_->store_batch(entries);
+}
+
+common::Result<std::vector<MemoryEntry>> WriteBehindMemory::recall(const std::string &query,
+                                                                   const std::size_t limit) {
+  auto recalled = inner_->recall(query, limit);
+  auto pending = pending_entries();
+  if (!recalled.ok() || pending.empty()) {
+    return recalled;
+  }
+
+  const auto terms = keyword_terms(query);
+  std::vector<MemoryEntry> merged;
+  std::unordered_set<std::string> seen;
+  for (auto &entry : pending) {
+    const double score = keyword_score(terms, entry);
+    if (score <= 0.0 || !seen.insert(entry.key).second) {
+      continue;
+    }
+    entry.score = score;
+    merged.push_back(std::move(entry));
+  }
+  if (merged.empty()) {
+    return recalled;
+  }
+  for (auto &entry : recalled.value()) {
+    if (seen.insert(entry.key).second) {
+      merged.push_back(std::move(entry));
+    }
+  }
+  std::stable_sort(merged.begin(), merged.end(), [](const MemoryEntry &a, const MemoryEntry &b) {
+    return a.score.value_or(0.0) > b.score.value_or(0.0);
+  });
+  if (merged.size() > limit) {
+    merged.resize(limit);
+  }
+  return common::Result<std::vector<MemoryEntry>>::success(std::move(merged));
+}
+
+common::Result<std::optional<MemoryEntry>> WriteBehindMemory::get(const std::string &key) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Newest queued write for the key wins.
+    for (auto it = queue_.rbegin(); it != queue_.rend(); ++it) {
+      if (it->key == key) {
+        return common::Result<std::optional<MemoryEntry>>::success(*it);
+      }
+    }
+    for (const auto &entry : in_flight_) {
+      if (entry.key == key) {
+        return common::Result<std::optional<MemoryEntry>>::success(entry);
+      }
+    }
+  }
+  return inner_->get(key);
+}
+
+common::Result<std::vector<MemoryEntry>>
+WriteBehindMemory::list(const std::optional<MemoryCategory> category) {
+  auto listed = inner_->list(category);
+  if (!listed.ok()) {
+    return listed;
+  }
+  std::unordered_set<std::string> seen;
+  for (const auto &entry : listed.value()) {
+    seen.insert(entry.key);
+  }
+  for (auto &entry : pending_entries()) {
+    if ((!category.has_value() || entry.category == *category) && seen.insert(entry.key).second) {
+      listed.value().push_back(std::move(entry));
+    }
+  }
+  return listed;
+}
+
+common::Result<bool> WriteBehindMemory::forget(const std::string &key) {
+  bool dropped = false;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const std::size_t before = queue_.size();
+    drop_queued_locked(key);
+    dropped = queue_.size() != before;
+    // A batch already handed to the backend may hold the key; let it land first so the
+    // forget below removes it.
+    wait_for_in_flight_locked(lock, key);
+  }
+  auto removed = inner_->forget(key);
+  if (!removed.ok()) {
+    return removed;
+  }
+  return common::Result<bool>::success(removed.value() || dropped);
+}
+
+common::Result<std::size_t> WriteBehindMemory::count() {
+  auto counted = inner_->count();
+  if (!counted.ok()) {
+    return counted;
+  }
+  return common::Result<std::size_t>::success(counted.value() + unstored_pending());
+}
+
+common::Status WriteBehindMemory::reindex() { return inner_->reindex(); }
+
+bool WriteBehindMemory::health_check() { return inner_->health_check(); }
+
+std::optional<std::uint64_t> WriteBehindMemory::write_epoch() const {
+  const auto inner = inner_->write_epoch();
+  if (!inner.has_value()) {
+    return std::nullopt;
+  }
+  return std::max(*inner, queue_epoch_.load());
+}
+
+MemoryStats WriteBehindMemory::stats() {
+  auto stats = inner_->stats();
+  stats.total_entries += unstored_pending();
+  return stats;
+}
+
+} // namespace ghostclaw::memory
@@ -288,6 +288,10 @@ void Orchestrator::process_message(const std::string &agent_id,
   // Set agent-specific options
   agent::AgentOptions options;
   options.agent_id = agent_id;
+  if (msg.sender_agent_id != "__user__") {
+    // Agent-to-agent chains run unattended behind the user's own turns.
+    options.priority = providers::RequestPriority::Background;
+  }
 
   for (const auto &ac : config_.multi.agents) {
     if (ac.id == agent_id) {
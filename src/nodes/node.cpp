@@ -126,7 +126,8 @@ bool command_exists(const std::string &command) {
 
 common::Result<NodeActionResult>
 run_system_command(const std::shared_ptr<security::SecurityPolicy> &policy,
-                   const tools::ToolArgs &args, const tools::ToolContext &ctx);
+                   const tools::ToolArgs &args, const tools::ToolContext &ctx,
+                   const NodeOutputCallback &on_output = {});
 
 common::Result<NodeActionResult> run_unrestricted_command(const std::string &command,
                                                           const std::uint64_t timeout_ms,
@@ -139,7 +140,8 @@ common::Result<NodeActionResult> run_unrestricted_command(const std::string &com
 
 common::Result<NodeActionResult>
 run_system_command(const std::shared_ptr<security::SecurityPolicy> &policy,
-                   const tools::ToolArgs &args, const tools::ToolContext &ctx) {
+                   const tools::ToolArgs &args, const tools::ToolContext &ctx,
+                   const NodeOutputCallback &on_output) {
   auto command = required_arg(args, "command");
   if (!command.ok()) {
     return common::Result<NodeActionResult>::failure(command.error());
@@ -156,6 +158,7 @@ run_system_command(const std::shared_ptr<security::SecurityPolicy> &policy,
 
 #ifdef _WIN32
   (void)ctx;
+  (void)on_output;
   NodeActionResult result;
   result.success = false;
   result.output = "system.run is not implemented on Windows";
@@ -225,6 +228,9 @@ run_system_command(const std::shared_ptr<security::SecurityPolicy> &policy,
           kMaxOutputBytes > output.size() ? kMaxOutputBytes - output.size() : 0;
       const std::size_t to_copy = std::min<std::size_t>(remaining, static_cast<std::size_t>(bytes));
       output.append(buffer.data(), to_copy);
+      if (on_output && to_copy > 0) {
+        on_output(std::string_view(buffer.data(), to_copy));
+      }
       if (to_copy < static_cast<std::size_t>(bytes) || output.size() >= kMaxOutputBytes) {
         truncated = true;
       }
@@ -245,6 +251,9 @@ run_system_command(const std::shared_ptr<security::SecurityPolicy> &policy,
     const std::size_t remaining = kMaxOutputBytes > output.size() ? kMaxOutputBytes - output.size() : 0;
     const std::size_t to_copy = std::min<std::size_t>(remaining, static_cast<std::size_t>(bytes));
     output.append(tail.data(), to_copy);
+    if (on_output && to_copy > 0) {
+      on_output(std::string_view(tail.data(), to_copy));
+    }
     if (to_copy < static_cast<std::size_t>(bytes) || output.size() >= kMaxOutputBytes) {
       truncated = true;
     }
@@ -424,10 +433,17 @@ NodeActionExecutor::NodeActionExecutor(std::shared_ptr<security::SecurityPolicy>
 common::Result<NodeActionResult> NodeActionExecutor::invoke(std::string_view action,
                                                             const tools::ToolArgs &args,
                                                             const tools::ToolContext &ctx) const {
+  return invoke(action, args, ctx, {});
+}
+
+common::Result<NodeActionResult> NodeActionExecutor::invoke(std::string_view action,
+                                                            const tools::ToolArgs &args,
+                                                            const tools::ToolContext &ctx,
+                                                            const NodeOutputCallback &on_output) const {
   const std::string normalized = common::to_lower(common::trim(std::string(action)));
 
   if (normalized == "system.run") {
-    return run_system_command(policy_, args, ctx);
+    return run_system_command(policy_, args, ctx, on_output);
   }
 
   if (normalized == "system.notify") {
@@ -0,0 +1,393 @@
+#include "ghostclaw/nodes/scheduler.hpp"
+
+#include "ghostclaw/browser/cdp.hpp"
+#include "ghostclaw/common/fs.hpp"
+#include "ghostclaw/common/json_util.hpp"
+#include "ghostclaw/security/pairing.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <sstream>
+
+namespace ghostclaw::nodes {
+
+namespace {
+
+constexpr std::string_view kMetaPrefix = "meta.";
+// How often a waiting invoke checks its cancel token.
+constexpr std::chrono::milliseconds kCancelPollInterval{250};
+
+std::string next_request_id() {
+  static std::atomic<std::uint64_t> counter{0};
+  const auto now = std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                       .count();
+  return "node-" + std::to_string(now) + "-" + std::to_string(counter.fetch_add(1) + 1);
+}
+
+std::string encode_args_json(const tools::ToolArgs &args) {
+  std::vector<std::pair<std::string, std::string>> sorted(args.begin(), args.end());
+  std::sort(sorted.begin(), sorted.end());
+  std::ostringstream out;
+  out << "{";
+  bool first = true;
+  for (const auto &[key, value] : sorted) {
+    if (!first) {
+      out << ",";
+    }
+    first = false;
+    out << "\"" << common::json_escape(key) << "\":\"" << common::json_escape(value) << "\"";
+  }
+  out << "}";
+  return out.str();
+}
+
+NodeActionResult decode_action_result(const common::JsonFlatMap &payload) {
+  NodeActionResult result;
+  const auto success_it = payload.find("success");
+  result.success = success_it == payload.end() || success_it->second == "true";
+  const auto truncated_it = payload.find("truncated");
+  result.truncated = truncated_it != payload.end() && truncated_it->second == "true";
+  const auto output_it = payload.find("output");
+  if (output_it != payload.end()) {
+    result.output = output_it->second;
+  }
+  for (const auto &[key, value] : payload) {
+    if (common::starts_with(key, std::string(kMetaPrefix))) {
+      result.metadata[key.substr(kMetaPrefix.size())] = value;
+    }
+  }
+  return result;
+}
+
+} // namespace
+
+std::optional<std::string> default_offload_action(const std::string_view tool_name) {
+  const std::string normalized = common::to_lower(common::trim(std::string(tool_name)));
+  if (normalized == "shell" || normalized == "exec") {
+    return std::string("system.run");
+  }
+  return std::nullopt;
+}
+
+bool node_supports_action(const NodeDescriptor &node, const std::string_view action) {
+  const std::string normalized = common::to_lower(common::trim(std::string(action)));
+  if (normalized.empty()) {
+    return false;
+  }
+  const auto dot = normalized.find('.');
+  const std::string family = dot == std::string::npos ? normalized : normalized.substr(0, dot);
+  return std::any_of(node.capabilities.begin(), node.capabilities.end(),
+                     [&](const std::string &capability) {
+                       const std::string value = common::to_lower(capability);
+                       return value == normalized || value == family;
+                     });
+}
+
+std::string encode_node_invoke_request(const std::string &request_id, const std::string_view action,
+                                       const tools::ToolArgs &args, const std::string &token) {
+  std::ostringstream out;
+  out << "{\"type\":\"rpc\",\"id\":\"" << common::json_escape(request_id)
+      << "\",\"method\":\"node.invoke\",\"action\":\"" << common::json_escape(std::string(action))
+      << "\",\"args_json\":\"" << common::json_escape(encode_args_json(args)) << "\"";
+  if (!token.empty()) {
+    out << ",\"token\":\"" << common::json_escape(token) << "\"";
+  }
+  out << "}";
+  return out.str();
+}
+
+common::Result<NodeActionResult>
+WebSocketNodeTransport::invoke(const NodeDescriptor &node, const std::string_view action,
+                               const tools::ToolArgs &args, const NodeOutputCallback &on_output,
+                               const std::chrono::milliseconds timeout,
+                               const std::shared_ptr<common::CancelToken> &cancel_token) {
+  auto transport = browser::make_websocket_transport(node.pair_token);
+  if (transport == nullptr) {
+    return common::Result<NodeActionResult>::failure("websocket transport unavailable");
+  }
+  auto connected = transport->connect(node.endpoint);
+  if (!connected.ok()) {
+    return common::Result<NodeActionResult>::failure(connected.error());
+  }
+
+  const std::string request_id = next_request_id();
+  auto sent =
+      transport->send_text(encode_node_invoke_request(request_id, action, args, node.pair_token));
+  if (!sent.ok()) {
+    transport->close();
+    return common::Result<NodeActionResult>::failure(sent.error());
+  }
+
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (true) {
+    const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    if (remaining.count() <= 0) {
+      transport->close();
+      return common::Result<NodeActionResult>::failure("node invoke timed out");
+    }
+    if (common::is_cancelled(cancel_token)) {
+      // Only the wait is abandoned: the node runs an accepted action to completion and
+      // its late result is dropped with the connection.
+      transport->close();
+      return common::Result<NodeActionResult>::failure("node invoke cancelled");
+    }
+    auto frame = transport->receive_text(std::min(remaining, kCancelPollInterval));
+    if (!frame.ok()) {
+      if (frame.error() == "ping" || frame.error() == "timeout") {
+        continue;
+      }
+      transport->close();
+      return common::Result<NodeActionResult>::failure(frame.error());
+    }
+
+    const std::string &json = frame.value();
+    const std::string type = common::json_get_string(json, "type");
+    if (type == "hello" || common::json_get_string(json, "id") != request_id) {
+      continue;
+    }
+    if (type == "error") {
+      transport->close();
+      const std::string error = common::json_get_string(json, "error");
+      return common::Result<NodeActionResult>::failure(error.empty() ? "node invoke failed"
+                                                                     : error);
+    }
+    const auto payload = common::json_parse_flat(common::json_get_object(json, "payload"));
+    if (type == "rpc.event") {
+      const auto event_it = payload.find("event");
+      const auto text_it = payload.find("text");
+      if (on_output && event_it != payload.end() && event_it->second == "node.output" &&
+          text_it != payload.end()) {
+        on_output(text_it->second);
+      }
+      continue;
+    }
+    if (type == "rpc.result") {
+      transport->close();
+      return common::Result<NodeActionResult>::success(decode_action_result(payload));
+    }
+  }
+}
+
+NodeScheduler::NodeScheduler(std::shared_ptr<NodeRegistry> registry,
+                             std::shared_ptr<INodeTransport> transport,
+                             std::shared_ptr<NodeActionExecutor> local,
+                             NodeSchedulerOptions options)
+    : registry_(std::move(registry)),
+      transport_(transport ? std::move(transport) : std::make_shared<WebSocketNodeTransport>()),
+      local_(std::move(local)), options_(options) {}
+
+void NodeScheduler::set_tool_action(const std::string &tool_name, const std::string &action) {
+  const std::string key = common::to_lower(common::trim(tool_name));
+  if (key.empty()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (common::trim(action).empty()) {
+    tool_actions_.erase(key);
+  } else {
+    tool_actions_[key] = common::to_lower(common::trim(action));
+  }
+}
+
+std::optional<std::string> NodeScheduler::action_for_tool(const std::string_view tool_name) const {
+  const std::string key = common::to_lower(common::trim(std::string(tool_name)));
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto it = tool_actions_.find(key);
+  if (it == tool_actions_.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+double NodeScheduler::score_locked(const std::string &node_id) const {
+  const auto it = load_.find(node_id);
+  if (it == load_.end()) {
+    return options_.initial_latency_ms;
+  }
+  return it->second.latency_ewma_ms +
+         static_cast<double>(it->second.in_flight) * options_.load_penalty_ms;
+}
+
+std::vector<NodeDescriptor> NodeScheduler::rank_candidates(const std::string_view action) const {
+  std::vector<NodeDescriptor> candidates;
+  if (registry_ == nullptr) {
+    return candidates;
+  }
+  for (auto &node : registry_->list()) {
+    if (node.paired && node.connected && !node.endpoint.empty() &&
+        node_supports_action(node, action)) {
+      candidates.push_back(std::move(node));
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::pair<double, NodeDescriptor>> scored;
+  scored.reserve(candidates.size());
+  for (auto &node : candidates) {
+    const auto it = load_.find(node.node_id);
+    if (it != load_.end() && it->second.in_flight >= options_.max_in_flight_per_node) {
+      continue;
+    }
+    scored.emplace_back(score_locked(node.node_id), std::move(node));
+  }
+  std::sort(scored.begin(), scored.end(), [](const auto &a, const auto &b) {
+    if (a.first != b.first) {
+      return a.first < b.first;
+    }
+    return a.second.node_id < b.second.node_id;
+  });
+
+  std::vector<NodeDescriptor> ranked;
+  ranked.reserve(scored.size());
+  for (auto &[score, node] : scored) {
+    (void)score;
+    ranked.push_back(std::move(node));
+  }
+  return ranked;
+}
+
+bool NodeScheduler::try_reserve(const std::string &node_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto &load = load_[node_id];
+  if (load.node_id.empty()) {
+    load.node_id = node_id;
+    load.latency_ewma_ms = options_.initial_latency_ms;
+  }
+  if (load.in_flight >= options_.max_in_flight_per_node) {
+    return false;
+  }
+  ++load.in_flight;
+  return true;
+}
+
+void NodeScheduler::release(const std::string &node_id, const bool ok, const double latency_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto &load = load_[node_id];
+  if (load.in_flight > 0) {
+    --load.in_flight;
+  }
+  const double sample = ok ? latency_ms : latency_ms + options_.failure_penalty_ms;
+  load.latency_ewma_ms = (1.0 - options_.latency_smoothing) * load.latency_ewma_ms +
+                         options_.latency_smoothing * sample;
+  if (ok) {
+    ++load.completed;
+  } else {
+    ++load.failed;
+  }
+}
+
+common::Result<NodeDispatchResult> NodeScheduler::dispatch(const std::string_view action,
+                                                           const tools::ToolArgs &args,
+                                                           const tools::ToolContext &ctx,
+                                                           const NodeOutputCallback &on_output) {
+  NodeDispatchResult dispatched;
+  std::string last_error;
+
+  for (const auto &node : rank_candidates(action)) {
+    if (common::is_cancelled(ctx.cancel_token)) {
+      return common::Result<NodeDispatchResult>::failure("node invoke cancelled");
+    }
+    if (!try_reserve(node.node_id)) {
+      continue;
+    }
+    ++dispatched.attempts;
+    const auto started = std::chrono::steady_clock::now();
+    auto result =
+        transport_->invoke(node, action, args, on_output, options_.timeout, ctx.cancel_token);
+    const double elapsed_ms = std::chrono::duration<double, std::milli>(
+                                  std::chrono::steady_clock::now() - started)
+                                  .count();
+    release(node.node_id, result.ok(), elapsed_ms);
+    if (result.ok()) {
+      dispatched.result = std::move(result.value());
+      dispatched.node_id = node.node_id;
+      dispatched.remote = true;
+      return common::Result<NodeDispatchResult>::success(std::move(dispatched));
+    }
+    last_error = node.node_id + ": " + result.error();
+  }
+
+  if (common::is_cancelled(ctx.cancel_token)) {
+    return common::Result<NodeDispatchResult>::failure("node invoke cancelled");
+  }
+  if (options_.local_fallback && local_ != nullptr) {
+    auto local = local_->invoke(action, args, ctx, on_output);
+    if (!local.ok()) {
+      return common::Result<NodeDispatchResult>::failure(local.error());
+    }
+    dispatched.result = std::move(local.value());
+    dispatched.node_id = "local";
+    dispatched.remote = false;
+    return common::Result<NodeDispatchResult>::success(std::move(dispatched));
+  }
+
+  return common::Result<NodeDispatchResult>::failure(
+      last_error.empty() ? "no node available for " + std::string(action)
+                         : "all nodes failed (" + last_error + ")");
+}
+
+std::vector<NodeLoadStats> NodeScheduler::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<NodeLoadStats> out;
+  out.reserve(load_.size());
+  for (const auto &[node_id, load] : load_) {
+    (void)node_id;
+    out.push_back(load);
+  }
+  std::sort(out.begin(), out.end(),
+            [](const NodeLoadStats &a, const NodeLoadStats &b) { return a.node_id < b.node_id; });
+  return out;
+}
+
+common::Result<NodeRpcMap> serve_node_invoke(const NodeActionExecutor &executor,
+                                             const NodeRpcMap &payload,
+                                             const tools::ToolContext &ctx,
+                                             const std::string_view expected_token,
+                                             const std::function<void(const NodeRpcMap &)> &emit) {
+  if (expected_token.empty()) {
+    return common::Result<NodeRpcMap>::failure("node serving requires nodes.serve_token");
+  }
+  const auto token_it = payload.find("token");
+  if (token_it == payload.end() ||
+      !security::constant_time_equals(token_it->second, std::string(expected_token))) {
+    return common::Result<NodeRpcMap>::failure("node token rejected");
+  }
+  const auto action_it = payload.find("action");
+  if (action_it == payload.end() || common::trim(action_it->second).empty()) {
+    return common::Result<NodeRpcMap>::failure("missing action");
+  }
+
+  tools::ToolArgs args;
+  const auto args_it = payload.find("args_json");
+  if (args_it != payload.end()) {
+    for (auto &[key, value] : common::json_parse_flat(args_it->second)) {
+      args[key] = std::move(value);
+    }
+  }
+
+  auto result = executor.invoke(action_it->second, args, ctx, [&](const std::string_view chunk) {
+    if (emit) {
+      emit({{"event", "node.output"}, {"text", std::string(chunk)}});
+    }
+  });
+
+  NodeRpcMap out;
+  if (!result.ok()) {
+    // Rejections are results, not transport errors, so the caller does not retry elsewhere.
+    out["success"] = "false";
+    out["truncated"] = "false";
+    out["output"] = result.error();
+    return common::Result<NodeRpcMap>::success(std::move(out));
+  }
+  out["success"] = result.value().success ? "true" : "false";
+  out["truncated"] = result.value().truncated ? "true" : "false";
+  out["output"] = result.value().output;
+  for (const auto &[key, value] : result.value().metadata) {
+    out[std::string(kMetaPrefix) + key] = value;
+  }
+  return common::Result<NodeRpcMap>::success(std::move(out));
+}
+
+} // namespace ghostclaw::nodes
@@ -44,11 +44,22 @@ void LogObserver::record_metric(const ObserverMetric &metric) {
         if constexpr (std::is_same_v<T, RequestLatencyMetric>) {
           log_line("DEBUG", "metric.request_latency_ms=" + std::to_string(m.latency.count()));
         } else if constexpr (std::is_same_v<T, TokensUsedMetric>) {
-          log_line("DEBUG", "metric.tokens_used=" + std::to_string(m.tokens));
+          log_line("DEBUG", "metric.tokens_used=" + std::to_string(m.tokens) +
+                                " prompt=" + std::to_string(m.prompt_tokens) +
+                                " completion=" + std::to_string(m.completion_tokens) +
+                                " cached=" + std::to_string(m.cached_prompt_tokens));
         } else if constexpr (std::is_same_v<T, ActiveSessionsMetric>) {
           log_line("DEBUG", "metric.active_sessions=" + std::to_string(m.count));
         } else if constexpr (std::is_same_v<T, QueueDepthMetric>) {
           log_line("DEBUG", "metric.queue_depth=" + std::to_string(m.depth));
+        } else if constexpr (std::is_same_v<T, ToolCacheMetric>) {
+          const auto total = m.hits + m.misses;
+          const auto rate_pct = total == 0 ? 0 : m.hits * 100 / total;
+          log_line("DEBUG", "metric.tool_cache tool=" + m.tool +
+                                " hit=" + (m.hit ? std::string("true") : std::string("false")) +
+                                " hits=" + std::to_string(m.hits) +
+                                " misses=" + std::to_string(m.misses) +
+                                " hit_rate_pct=" + std::to_string(rate_pct));
         }
       },
       metric);
@@ -0,0 +1,420 @@
+#include "ghostclaw/providers/admission.hpp"
+
+#include "ghostclaw/common/cancel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <tuple>
+
+namespace ghostclaw::providers {
+
+namespace {
+
+thread_local ScopedRequestClass *tls_request_class = nullptr;
+
+constexpr auto kWindow = std::chrono::seconds(60);
+constexpr std::uint64_t kInitialCompletionEstimate = 256;
+constexpr std::uint64_t kMaxBackoffSecs = 60;
+// Polling interval while a cancel token is installed; waits are otherwise woken by
+// notifications or by the next budget change.
+constexpr auto kCancelPoll = std::chrono::milliseconds(100);
+
+std::uint64_t scaled_limit(const std::uint64_t limit, const double share) {
+  return std::max<std::uint64_t>(
+      1, static_cast<std::uint64_t>(std::floor(static_cast<double>(limit) * share)));
+}
+
+} // namespace
+
+ScopedRequestClass::ScopedRequestClass(const RequestPriority priority, std::string session)
+    : priority_(priority), session_(std::move(session)), previous_(tls_request_class) {
+  tls_request_class = this;
+}
+
+ScopedRequestClass::~ScopedRequestClass() { tls_request_class = previous_; }
+
+RequestPriority current_request_priority() {
+  return tls_request_class != nullptr ? tls_request_class->priority_
+                                      : RequestPriority::Interactive;
+}
+
+std::string current_request_session() {
+  return tls_request_class != nullptr ? tls_request_class->session_ : std::string();
+}
+
+struct AdmissionController::Bucket {
+  struct Entry {
+    std::uint64_t id = 0;
+    Clock::time_point at;
+    std::uint64_t tokens = 0;
+    std::string session;
+  };
+  struct Waiter {
+    RequestPriority priority = RequestPriority::Interactive;
+    std::string session;
+    std::uint64_t seq = 0;
+    std::uint64_t tokens = 0;
+  };
+
+  std::string key;
+  // Requests sent in the last minute, oldest first.
+  std::deque<Entry> window;
+  std::uint64_t window_tokens = 0;
+  std::vector<const Waiter *> waiters;
+  std::unordered_map<std::string, std::size_t> in_flight_by_session;
+  std::size_t in_flight = 0;
+  std::uint64_t next_id = 0;
+  Clock::time_point paused_until{};
+  std::uint64_t backoff_secs = 0;
+  std::uint64_t completion_estimate = kInitialCompletionEstimate;
+  AdmissionStats stats;
+
+  void expire(const Clock::time_point now) {
+    while (!window.empty() && window.front().at + kWindow <= now) {
+      window_tokens -= window.front().tokens;
+      window.pop_front();
+    }
+  }
+
+  [[nodiscard]] std::size_t recent(const std::string &session) const {
+    std::size_t count = 0;
+    for (const auto &entry : window) {
+      count += entry.session == session ? 1 : 0;
+    }
+    const auto it = in_flight_by_session.find(session);
+    return count + (it != in_flight_by_session.end() ? it->second : 0);
+  }
+
+  [[nodiscard]] const Waiter *head() const {
+    const Waiter *best = nullptr;
+    std::tuple<int, std::size_t, std::uint64_t> best_rank{};
+    for (const auto *waiter : waiters) {
+      const std::tuple<int, std::size_t, std::uint64_t> rank{
+          waiter->priority == RequestPriority::Interactive ? 0 : 1, recent(waiter->session),
+          waiter->seq};
+      if (best == nullptr || rank < best_rank) {
+        best = waiter;
+        best_rank = rank;
+      }
+    }
+    return best;
+  }
+
+  [[nodiscard]] bool fits(const Waiter &waiter, const config::AdmissionConfig &config,
+                          const Clock::time_point now) const {
+    if (now < paused_until) {
+      return false;
+    }
+    const double share =
+        waiter.priority == RequestPriority::Interactive ? 1.0 : config.background_share;
+    if (config.max_concurrent != 0 && in_flight >= scaled_limit(config.max_concurrent, share)) {
+      return false;
+    }
+    if (config.requests_per_minute != 0 &&
+        window.size() >= scaled_limit(config.requests_per_minute, share)) {
+      return false;
+    }
+    // A request larger than the whole budget still goes once the window is empty.
+    if (config.tokens_per_minute != 0 && !window.empty() &&
+        window_tokens + waiter.tokens > scaled_limit(config.tokens_per_minute, share)) {
+      return false;
+    }
+    return true;
+  }
+};
+
+AdmissionController::Ticket::~Ticket() { release(); }
+
+AdmissionController::Ticket::Ticket(Ticket &&other) noexcept
+    : owner_(other.owner_), bucket_(std::move(other.bucket_)), entry_(other.entry_),
+      session_(std::move(other.session_)) {
+  other.owner_ = nullptr;
+}
+
+AdmissionController::Ticket &AdmissionController::Ticket::operator=(Ticket &&other) noexcept {
+  if (this != &other) {
+    release();
+    owner_ = other.owner_;
+    bucket_ = std::move(other.bucket_);
+    entry_ = other.entry_;
+    session_ = std::move(other.session_);
+    other.owner_ = nullptr;
+  }
+  return *this;
+}
+
+void AdmissionController::Ticket::release() {
+  if (owner_ == nullptr || bucket_ == nullptr) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(owner_->mutex_);
+    --bucket_->in_flight;
+    const auto session = bucket_->in_flight_by_session.find(session_);
+    if (session != bucket_->in_flight_by_session.end() && --session->second == 0) {
+      bucket_->in_flight_by_session.erase(session);
+    }
+  }
+  owner_->cv_.notify_all();
+  owner_ = nullptr;
+  bucket_.reset();
+}
+
+void AdmissionController::Ticket::complete(const TokenUsage &usage) {
+  if (owner_ == nullptr) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(owner_->mutex_);
+  bucket_->backoff_secs = 0;
+  if (usage.empty()) {
+    return;
+  }
+  bucket_->completion_estimate = (bucket_->completion_estimate * 3 + usage.completion_tokens) / 4;
+  for (auto it = bucket_->window.rbegin(); it != bucket_->window.rend(); ++it) {
+    if (it->id == entry_) {
+      bucket_->window_tokens = bucket_->window_tokens - it->tokens + usage.total_tokens();
+      it->tokens = usage.total_tokens();
+      break;
+    }
+  }
+}
+
+void AdmissionController::Ticket::rate_limited(const std::optional<std::uint64_t> retry_after_secs) {
+  if (owner_ == nullptr) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(owner_->mutex_);
+  auto &bucket = *bucket_;
+  std::uint64_t pause = 0;
+  if (retry_after_secs.has_value()) {
+    pause = std::min(*retry_after_secs, kMaxBackoffSecs);
+  } else {
+    bucket.backoff_secs =
+        bucket.backoff_secs == 0 ? 1 : std::min(bucket.backoff_secs * 2, kMaxBackoffSecs);
+    pause = bucket.backoff_secs;
+  }
+  bucket.paused_until =
+      std::max(bucket.paused_until, Clock::now() + std::chrono::seconds(pause));
+  ++bucket.stats.rate_limited;
+}
+
+AdmissionController &AdmissionController::shared() {
+  static AdmissionController controller;
+  return controller;
+}
+
+void AdmissionController::configure(const config::AdmissionConfig &config) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+  }
+  cv_.notify_all();
+}
+
+config::AdmissionConfig AdmissionController::config() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return config_;
+}
+
+common::Result<AdmissionController::Ticket>
+AdmissionController::acquire(const std::string &key, const std::uint64_t prompt_tokens) {
+  using R = common::Result<Ticket>;
+  const auto cancel = common::current_cancel_token();
+  const auto start = Clock::now();
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto &slot = buckets_[key];
+  if (slot == nullptr) {
+    slot = std::make_shared<Bucket>();
+    slot->key = key;
+    slot->stats.key = key;
+  }
+  const std::shared_ptr<Bucket> bucket = slot;
+
+  Bucket::Waiter self{.priority = current_request_priority(),
+                      .session = current_request_session(),
+                      .seq = ++bucket->next_id,
+                      .tokens = prompt_tokens + bucket->completion_estimate};
+  bucket->waiters.push_back(&self);
+  const auto leave = [&]() {
+    bucket->waiters.erase(std::find(bucket->waiters.begin(), bucket->waiters.end(), &self));
+  };
+
+  while (true) {
+    const auto now = Clock::now();
+    bucket->expire(now);
+    if (!config_.enabled || (bucket->head() == &self && bucket->fits(self, config_, now))) {
+      break;
+    }
+    if (common::is_cancelled(cancel)) {
+      leave();
+      lock.unlock();
+      cv_.notify_all();
+      return R::failure("request cancelled");
+    }
+    const auto deadline = start + std::chrono::seconds(config_.max_wait_secs);
+    if (now >= deadline) {
+      ++bucket->stats.timed_out;
+      leave();
+      lock.unlock();
+      cv_.notify_all();
+      ProviderError error;
+      error.code = ProviderErrorCode::Timeout;
+      error.message = "admission wait exceeded for " + key;
+      return R::failure(error.to_string());
+    }
+
+    // Sleep until something other than a release could change the answer.
+    auto wake = deadline;
+    if (bucket->paused_until > now) {
+      wake = std::min(wake, bucket->paused_until);
+    }
+    if (!bucket->window.empty()) {
+      wake = std::min(wake, bucket->window.front().at + kWindow);
+    }
+    if (cancel != nullptr) {
+      wake = std::min(wake, now + kCancelPoll);
+    }
+    cv_.wait_until(lock, wake);
+  }
+
+  leave();
+  const auto now = Clock::now();
+  const auto waited =
+      static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count());
+  if (self.priority == RequestPriority::Interactive) {
+    ++bucket->stats.admitted_interactive;
+    bucket->stats.waited_ms_interactive += waited;
+  } else {
+    ++bucket->stats.admitted_background;
+    bucket->stats.waited_ms_background += waited;
+  }
+  const std::uint64_t id = ++bucket->next_id;
+  bucket->window.push_back({.id = id, .at = now, .tokens = self.tokens, .session = self.session});
+  bucket->window_tokens += self.tokens;
+  ++bucket->in_flight;
+  ++bucket->in_flight_by_session[self.session];
+  lock.unlock();
+  // The next waiter may now be the head.
+  cv_.notify_all();
+
+  Ticket ticket;
+  ticket.owner_ = this;
+  ticket.bucket_ = bucket;
+  ticket.entry_ = id;
+  ticket.session_ = std::move(self.session);
+  return R::success(std::move(ticket));
+}
+
+std::vector<AdmissionStats> AdmissionController::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<AdmissionStats> out;
+  const auto now = Clock::now();
+  for (const auto &[key, bucket] : buckets_) {
+    bucket->expire(now);
+    auto stats = bucket->stats;
+    stats.queued = bucket->waiters.size();
+    stats.in_flight = bucket->in_flight;
+    stats.window_requests = bucket->window.size();
+    stats.window_tokens = bucket->window_tokens;
+    out.push_back(std::move(stats));
+  }
+  std::sort(out.begin(), out.end(),
+            [](const AdmissionStats &a, const AdmissionStats &b) { return a.key < b.key; });
+  return out;
+}
+
+bool is_rate_limit_error(const std::string &error) {
+  return error.find("Provider error [rate_limit]") != std::string::npos;
+}
+
+namespace {
+
+std::optional<std::uint64_t> parse_retry_after(const std::string &error) {
+  static constexpr std::string_view kField = " retry_after=";
+  const auto pos = error.find(kField);
+  if (pos == std::string::npos) {
+    return std::nullopt;
+  }
+  std::uint64_t value = 0;
+  std::size_t i = pos + kField.size();
+  const std::size_t begin = i;
+  while (i < error.size() && error[i] >= '0' && error[i] <= '9') {
+    value = value * 10 + static_cast<std::uint64_t>(error[i] - '0');
+    ++i;
+  }
+  if (i == begin) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+std::size_t tool_chars(const std::vector<tools::ToolSpec> &tools) {
+  std::size_t chars = 0;
+  for (const auto &tool : tools) {
+    chars += tool.name.size() + tool.description.size() + tool.parameters_json.size();
+  }
+  return chars;
+}
+
+} // namespace
+
+AdmittedProvider::AdmittedProvider(std::shared_ptr<Provider> inner, std::string key)
+    : inner_(std::move(inner)), key_(std::move(key)) {}
+
+template <typename Send>
+common::Result<std::string> AdmittedProvider::admit(const std::size_t prompt_chars,
+                                                    const Send &send) {
+  // About four characters per token for English text and JSON.
+  auto ticket = AdmissionController::shared().acquire(key_, prompt_chars / 4 + 1);
+  if (!ticket.ok()) {
+    return common::Result<std::string>::failure(ticket.error());
+  }
+  ScopedUsageCapture capture;
+  auto result = send();
+  if (result.ok()) {
+    ticket.value().complete(capture.usage());
+  } else if (is_rate_limit_error(result.error())) {
+    ticket.value().rate_limited(parse_retry_after(result.error()));
+  }
+  return result;
+}
+
+common::Result<std::string> AdmittedProvider::chat(const std::string &message,
+                                                   const std::string &model,
+                                                   const double temperature) {
+  return admit(message.size(), [&]() { return inner_->chat(message, model, temperature); });
+}
+
+common::Result<std::string>
+AdmittedProvider::chat_with_system(const std::optional<std::string> &system_prompt,
+                                   const std::string &message, const std::string &model,
+                                   const double temperature) {
+  return admit(system_prompt.value_or("").size() + message.size(), [&]() {
+    return inner_->chat_with_system(system_prompt, message, model, temperature);
+  });
+}
+
+common::Result<std::string> AdmittedProvider::chat_with_system_tools(
+    const std::optional<std::string> &system_prompt, const std::string &message,
+    const std::string &model, const double temperature,
+    const std::vector<tools::ToolSpec> &tools) {
+  return admit(system_prompt.value_or("").size() + message.size() + tool_chars(tools), [&]() {
+    return inner_->chat_with_system_tools(system_prompt, message, model, temperature, tools);
+  });
+}
+
+common::Result<std::string> AdmittedProvider::chat_with_system_stream(
+    const std::optional<std::string> &system_prompt, const std::string &message,
+    const std::string &model, const double temperature, const StreamChunkCallback &on_chunk) {
+  return admit(system_prompt.value_or("").size() + message.size(), [&]() {
+    return inner_->chat_with_system_stream(system_prompt, message, model, temperature, on_chunk);
+  });
+}
+
+common::Status AdmittedProvider::warmup() { return inner_->warmup(); }
+
+std::string AdmittedProvider::name() const { return inner_->name(); }
+
+} // namespace ghostclaw::providers
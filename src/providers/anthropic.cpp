@@ -155,6 +155,9 @@ AnthropicProvider::chat_with_system(const std::optional<std::string> &system_pro
           ProviderError{.code = ProviderErrorCode::InvalidResponse, .message = parsed.error()}
               .to_string());
     }
+    if (const auto usage = parse_anthropic_sse_usage(response.body); usage.has_value()) {
+      report_usage(*usage);
+    }
     return parsed;
   }
 
@@ -163,6 +166,9 @@ AnthropicProvider::chat_with_system(const std::optional<std::string> &system_pro
     return common::Result<std::string>::failure(
         ProviderError{.code = ProviderErrorCode::InvalidResponse, .message = parsed.error()}.to_string());
   }
+  if (const auto usage = parse_anthropic_usage(response.body); usage.has_value()) {
+    report_usage(*usage);
+  }
 
   return parsed;
 }
@@ -182,8 +188,19 @@ AnthropicProvider::chat_with_system_stream(const std::optional<std::string> &sys
   std::string aggregated;
   std::string line_buffer;
   std::string event_data;
+  TokenUsage stream_usage;
   const auto stream_handler = [&](const std::string_view bytes) {
     parse_sse_bytes(bytes, line_buffer, event_data, [&](const std::string &event) {
+      if (const auto usage = parse_anthropic_sse_event_usage(event); usage.has_value()) {
+        if (usage->prompt_tokens > 0) {
+          stream_usage.prompt_tokens = usage->prompt_tokens;
+          stream_usage.cached_prompt_tokens = usage->cached_prompt_tokens;
+        }
+        if (usage->completion_tokens > 0) {
+          stream_usage.completion_tokens = usage->completion_tokens;
+        }
+        return;
+      }
       auto delta = parse_anthropic_sse_event_delta(event);
       if (!delta.ok() || delta.value().empty()) {
         return;
@@ -207,6 +224,7 @@ AnthropicProvider::chat_with_system_stream(const std::optional<std::string> &sys
 
   if (is_sse_response(response)) {
     if (!aggregated.empty()) {
+      report_usage(stream_usage);
       return common::Result<std::string>::success(aggregated);
     }
     const auto parsed = parse_anthropic_sse_content(response.body);
@@ -215,6 +233,9 @@ AnthropicProvider::chat_with_system_stream(const std::optional<std::string> &sys
           ProviderError{.code = ProviderErrorCode::InvalidResponse, .message = parsed.error()}
               .to_string());
     }
+    if (const auto usage = parse_anthropic_sse_usage(response.body); usage.has_value()) {
+      report_usage(*usage);
+    }
     return parsed;
   }
 
@@ -223,6 +244,9 @@ AnthropicProvider::chat_with_system_stream(const std::optional<std::string> &sys
     return common::Result<std::string>::failure(
         ProviderError{.code = ProviderErrorCode::InvalidResponse, .message = parsed.error()}.to_string());
   }
+  if (const auto usage = parse_anthropic_usage(response.body); usage.has_value()) {
+    report_usage(*usage);
+  }
   if (on_chunk) {
     std::istringstream stream(parsed.value());
     std::string token;
@@ -0,0 +1,763 @@
+#include "ghostclaw/providers/batch.hpp"
+
+#include "ghostclaw/common/cancel.hpp"
+#include "ghostclaw/common/fs.hpp"
+#include "ghostclaw/common/json_util.hpp"
+#include "ghostclaw/providers/admission.hpp"
+#include "ghostclaw/providers/compatible.hpp"
+#include "ghostclaw/tools/tool_catalog.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+
+namespace ghostclaw::providers {
+
+namespace {
+
+constexpr std::uint64_t kRequestTimeoutMs = 60'000;
+// Polling interval for threads blocked in BatchLane::submit() so cancellation is noticed.
+constexpr auto kCancelPoll = std::chrono::milliseconds(100);
+
+common::Status check_response(const HttpResponse &response) {
+  return CompatibleProvider::validate_response_status(response);
+}
+
+std::string invalid_response_error(const std::string &message) {
+  ProviderError error;
+  error.code = ProviderErrorCode::InvalidResponse;
+  error.message = message;
+  return error.to_string();
+}
+
+common::Result<std::string> invalid_response(const std::string &message) {
+  return common::Result<std::string>::failure(invalid_response_error(message));
+}
+
+std::vector<std::string> jsonl_lines(const std::string &body) {
+  std::vector<std::string> lines;
+  std::istringstream in(body);
+  std::string line;
+  while (std::getline(in, line)) {
+    line = common::trim(line);
+    if (!line.empty()) {
+      lines.push_back(std::move(line));
+    }
+  }
+  return lines;
+}
+
+BatchOutcome failed_outcome(std::string custom_id, std::string error) {
+  BatchOutcome outcome;
+  outcome.custom_id = std::move(custom_id);
+  outcome.error = std::move(error);
+  return outcome;
+}
+
+std::string anthropic_params(const BatchRequest &request) {
+  std::ostringstream body;
+  body << "{";
+  body << "\"model\":\"" << json_escape(request.model) << "\",";
+  body << "\"max_tokens\":4096,";
+  if (request.system_prompt.has_value()) {
+    body << "\"system\":\"" << json_escape(*request.system_prompt) << "\",";
+  }
+  body << "\"messages\":[{\"role\":\"user\",\"content\":\"" << json_escape(request.message)
+       << "\"}],";
+  body << "\"temperature\":" << request.temperature;
+  body << "}";
+  return body.str();
+}
+
+std::string openai_body(const BatchRequest &request) {
+  std::ostringstream body;
+  body << "{";
+  body << "\"model\":\"" << json_escape(request.model) << "\",";
+  body << "\"messages\":[";
+  if (request.system_prompt.has_value()) {
+    body << "{\"role\":\"system\",\"content\":\"" << json_escape(*request.system_prompt)
+         << "\"},";
+  }
+  body << "{\"role\":\"user\",\"content\":\"" << json_escape(request.message) << "\"}";
+  body << "],";
+  if (!request.tools.empty()) {
+    body << "\"tools\":[";
+    for (std::size_t i = 0; i < request.tools.size(); ++i) {
+      if (i > 0) {
+        body << ',';
+      }
+      const auto &tool = request.tools[i];
+      if (!tool.function_json.empty()) {
+        body << tool.function_json;
+      } else {
+        body << tools::serialize_function_spec(tool);
+      }
+    }
+    body << "],";
+    body << "\"tool_choice\":\"auto\",";
+  }
+  body << "\"temperature\":" << request.temperature;
+  body << "}";
+  return body.str();
+}
+
+} // namespace
+
+AnthropicBatchBackend::AnthropicBatchBackend(std::string api_key, std::string base_url,
+                                             std::shared_ptr<HttpClient> http_client)
+    : api_key_(std::move(api_key)), base_url_(std::move(base_url)),
+      http_client_(std::move(http_client)) {
+  while (!base_url_.empty() && base_url_.back() == '/') {
+    base_url_.pop_back();
+  }
+}
+
+std::unordered_map<std::string, std::string> AnthropicBatchBackend::build_headers() const {
+  return {
+      {"Content-Type", "application/json"},
+      {"anthropic-version", "2023-06-01"},
+      {"x-api-key", api_key_},
+  };
+}
+
+common::Result<std::string>
+AnthropicBatchBackend::submit(const std::vector<BatchRequest> &requests) {
+  std::ostringstream body;
+  body << "{\"requests\":[";
+  for (std::size_t i = 0; i < requests.size(); ++i) {
+    if (i > 0) {
+      body << ',';
+    }
+    body << "{\"custom_id\":\"" << json_escape(requests[i].custom_id)
+         << "\",\"params\":" << anthropic_params(requests[i]) << "}";
+  }
+  body << "]}";
+
+  const auto response = http_client_->post_json(base_url_ + "/v1/messages/batches",
+                                                build_headers(), body.str(), kRequestTimeoutMs);
+  if (auto status = check_response(response); !status.ok()) {
+    return common::Result<std::string>::failure(status.error());
+  }
+  const std::string id = common::json_get_string(response.body, "id");
+  if (id.empty()) {
+    return invalid_response("batch response has no id");
+  }
+  return common::Result<std::string>::success(id);
+}
+
+common::Result<BatchPoll> AnthropicBatchBackend::poll(const std::string &batch_id) {
+  const auto headers = build_headers();
+  const auto response =
+      http_client_->get(base_url_ + "/v1/messages/batches/" + batch_id, headers, kRequestTimeoutMs);
+  if (auto status = check_response(response); !status.ok()) {
+    return common::Result<BatchPoll>::failure(status.error());
+  }
+
+  BatchPoll poll;
+  poll.status = common::json_get_string(response.body, "processing_status");
+  if (poll.status != "ended") {
+    return common::Result<BatchPoll>::success(std::move(poll));
+  }
+  const std::string results_url = common::json_get_string(response.body, "results_url");
+  if (results_url.empty()) {
+    return common::Result<BatchPoll>::failure(
+        invalid_response_error("ended batch has no results_url"));
+  }
+
+  const auto results = http_client_->get(results_url, headers, kRequestTimeoutMs);
+  if (auto status = check_response(results); !status.ok()) {
+    return common::Result<BatchPoll>::failure(status.error());
+  }
+  for (const auto &line : jsonl_lines(results.body)) {
+    const std::string custom_id = common::json_get_string(line, "custom_id");
+    const std::string result = common::json_get_object(line, "result");
+    const std::string type = common::json_get_string(result, "type");
+    const std::string message = common::json_get_object(result, "message");
+    if (type != "succeeded" || message.empty()) {
+      poll.outcomes.push_back(failed_outcome(
+          custom_id, "batch request " + (type.empty() ? std::string("failed") : type) + ": " +
+                         common::json_get_object(result, "error")));
+      continue;
+    }
+    auto content = parse_anthropic_content(message);
+    if (!content.ok()) {
+      poll.outcomes.push_back(failed_outcome(custom_id, content.error()));
+      continue;
+    }
+    BatchOutcome outcome;
+    outcome.custom_id = custom_id;
+    outcome.content = content.value();
+    outcome.usage = parse_anthropic_usage(message);
+    poll.outcomes.push_back(std::move(outcome));
+  }
+  poll.done = true;
+  return common::Result<BatchPoll>::success(std::move(poll));
+}
+
+common::Status AnthropicBatchBackend::cancel(const std::string &batch_id) {
+  const auto response =
+      http_client_->post_json(base_url_ + "/v1/messages/batches/" + batch_id + "/cancel",
+                              build_headers(), "{}", kRequestTimeoutMs);
+  return check_response(response);
+}
+
+OpenAiBatchBackend::OpenAiBatchBackend(std::string api_key, std::string base_url,
+                                       std::shared_ptr<HttpClient> http_client)
+    : api_key_(std::move(api_key)), base_url_(std::move(base_url)),
+      http_client_(std::move(http_client)) {
+  while (!base_url_.empty() && base_url_.back() == '/') {
+    base_url_.pop_back();
+  }
+}
+
+common::Result<std::string> OpenAiBatchBackend::submit(const std::vector<BatchRequest> &requests) {
+  std::ostringstream jsonl;
+  for (const auto &request : requests) {
+    jsonl << "{\"custom_id\":\"" << json_escape(request.custom_id)
+          << "\",\"method\":\"POST\",\"url\":\"/v1/chat/completions\",\"body\":"
+          << openai_body(request) << "}\n";
+  }
+
+  // The input file goes up as multipart/form-data; the body is sent as given.
+  const std::string boundary = "ghostclaw-batch-" + requests.front().custom_id;
+  std::ostringstream upload;
+  upload << "--" << boundary << "\r\n"
+         << "Content-Disposition: form-data; name=\"purpose\"\r\n\r\nbatch\r\n"
+         << "--" << boundary << "\r\n"
+         << "Content-Disposition: form-data; name=\"file\"; filename=\"batch.jsonl\"\r\n"
+         << "Content-Type: application/jsonl\r\n\r\n"
+         << jsonl.str() << "\r\n"
+         << "--" << boundary << "--\r\n";
+  const auto file = http_client_->post_json(
+      base_url_ + "/files",
+      {{"Content-Type", "multipart/form-data; boundary=" + boundary},
+       {"Authorization", "Bearer " + api_key_}},
+      upload.str(), kRequestTimeoutMs);
+  if (auto status = check_response(file); !status.ok()) {
+    return common::Result<std::string>::failure(status.error());
+  }
+  const std::string file_id = common::json_get_string(file.body, "id");
+  if (file_id.empty()) {
+    return invalid_response("file upload response has no id");
+  }
+
+  const auto batch = http_client_->post_json(
+      base_url_ + "/batches",
+      {{"Content-Type", "application/json"}, {"Authorization", "Bearer " + api_key_}},
+      "{\"input_file_id\":\"" + json_escape(file_id) +
+          "\",\"endpoint\":\"/v1/chat/completions\",\"completion_window\":\"24h\"}",
+      kRequestTimeoutMs);
+  if (auto status = check_response(batch); !status.ok()) {
+    return common::Result<std::string>::failure(status.error());
+  }
+  const std::string id = common::json_get_string(batch.body, "id");
+  if (id.empty()) {
+    return invalid_response("batch response has no id");
+  }
+  return common::Result<std::string>::success(id);
+}
+
+common::Result<BatchPoll> OpenAiBatchBackend::poll(const std::string &batch_id) {
+  const auto response = http_client_->get(
+      base_url_ + "/batches/" + batch_id, {{"Authorization", "Bearer " + api_key_}},
+      kRequestTimeoutMs);
+  if (auto status = check_response(response); !status.ok()) {
+    return common::Result<BatchPoll>::failure(status.error());
+  }
+
+  BatchPoll poll;
+  poll.status = common::json_get_string(response.body, "status");
+  if (poll.status != "completed" && poll.status != "failed" && poll.status != "expired" &&
+      poll.status != "cancelled") {
+    return common::Result<BatchPoll>::success(std::move(poll));
+  }
+  // Expired and cancelled batches still report the requests they finished.
+  for (const char *field : {"output_file_id", "error_file_id"}) {
+    const std::string file_id = common::json_get_string(response.body, field);
+    if (file_id.empty()) {
+      continue;
+    }
+    auto outcomes = read_file(file_id);
+    if (!outcomes.ok()) {
+      return common::Result<BatchPoll>::failure(outcomes.error());
+    }
+    std::move(outcomes.value().begin(), outcomes.value().end(), std::back_inserter(poll.outcomes));
+  }
+  poll.done = true;
+  return common::Result<BatchPoll>::success(std::move(poll));
+}
+
+common::Status OpenAiBatchBackend::cancel(const std::string &batch_id) {
+  const auto response = http_client_->post_json(
+      base_url_ + "/batches/" + batch_id + "/cancel",
+      {{"Content-Type", "application/json"}, {"Authorization", "Bearer " + api_key_}}, "{}",
+      kRequestTimeoutMs);
+  return check_response(response);
+}
+
+common::Result<std::vector<BatchOutcome>> OpenAiBatchBackend::read_file(const std::string &file_id) {
+  const auto response = http_client_->get(base_url_ + "/files/" + file_id + "/content",
+                                          {{"Authorization", "Bearer " + api_key_}},
+                                          kRequestTimeoutMs);
+  if (auto status = check_response(response); !status.ok()) {
+    return common::Result<std::vector<BatchOutcome>>::failure(status.error());
+  }
+
+  std::vector<BatchOutcome> outcomes;
+  for (const auto &line : jsonl_lines(response.body)) {
+    const std::string custom_id = common::json_get_string(line, "custom_id");
+    const std::string reply = common::json_get_object(line, "response");
+    const std::string status_code = common::json_get_number(reply, "status_code");
+    const std::string body = common::json_get_object(reply, "body");
+    if (status_code != "200" || body.empty()) {
+      const std::string error = common::json_get_object(line, "error");
+      outcomes.push_back(failed_outcome(
+          custom_id, "batch request failed" +
+                         (status_code.empty() ? std::string() : " [" + status_code + "]") + ": " +
+                         (error.empty() ? body : error)));
+      continue;
+    }
+    auto content = parse_openai_content(body);
+    if (!content.ok()) {
+      outcomes.push_back(failed_outcome(custom_id, content.error()));
+      continue;
+    }
+    BatchOutcome outcome;
+    outcome.custom_id = custom_id;
+    outcome.content = content.value();
+    outcome.usage = parse_openai_usage(body);
+    outcomes.push_back(std::move(outcome));
+  }
+  return common::Result<std::vector<BatchOutcome>>::success(std::move(outcomes));
+}
+
+BatchLane::~BatchLane() { stop(); }
+
+void BatchLane::stop() {
+  std::thread worker;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    worker = std::move(worker_);
+  }
+  cv_.notify_all();
+  if (worker.joinable()) {
+    worker.join();
+  }
+  fail_all("batch lane stopped");
+  std::lock_guard<std::mutex> lock(mutex_);
+  stopping_ = false;
+}
+
+BatchLane &BatchLane::shared() {
+  static BatchLane lane;
+  return lane;
+}
+
+void BatchLane::configure(const config::BatchConfig &config) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+  }
+  cv_.notify_all();
+}
+
+config::BatchConfig BatchLane::config() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return config_;
+}
+
+std::string BatchLane::enqueue(const std::string &key, std::shared_ptr<BatchBackend> backend,
+                               BatchRequest request, Callback on_done) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (stopping_) {
+    lock.unlock();
+    on_done(failed_outcome(request.custom_id, "batch lane stopped"));
+    return request.custom_id;
+  }
+  auto &queue = queues_[key];
+  queue.backend = std::move(backend);
+  queue.stats.key = key;
+  request.custom_id = "req-" + std::to_string(next_id_++);
+  std::string custom_id = request.custom_id;
+  queue.pending.push_back(
+      Pending{.request = std::move(request), .on_done = std::move(on_done), .queued_at = Clock::now()});
+  if (!worker_.joinable()) {
+    worker_ = std::thread([this]() { worker_loop(); });
+  }
+  lock.unlock();
+  cv_.notify_all();
+  return custom_id;
+}
+
+common::Result<BatchOutcome> BatchLane::submit(const std::string &key,
+                                               std::shared_ptr<BatchBackend> backend,
+                                               BatchRequest request) {
+  struct Slot {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::optional<BatchOutcome> outcome;
+  };
+  auto slot = std::make_shared<Slot>();
+  const auto deadline = Clock::now() + std::chrono::seconds(config().max_wait_secs);
+  const std::string custom_id =
+      enqueue(key, std::move(backend), std::move(request), [slot](BatchOutcome outcome) {
+        {
+          std::lock_guard<std::mutex> lock(slot->mutex);
+          slot->outcome = std::move(outcome);
+        }
+        slot->cv.notify_all();
+      });
+
+  const auto cancel = common::current_cancel_token();
+  std::unique_lock<std::mutex> lock(slot->mutex);
+  while (!slot->outcome.has_value()) {
+    std::string failure;
+    if (common::is_cancelled(cancel)) {
+      failure = "batch request cancelled";
+    } else if (Clock::now() >= deadline) {
+      failure = "batch request timed out";
+    }
+    if (!failure.empty()) {
+      lock.unlock();
+      // Nobody will read the result, so stop paying for it when no one else waits on it.
+      if (const auto orphan = withdraw(key, custom_id); orphan.has_value()) {
+        (void)orphan->first->cancel(orphan->second);
+      }
+      return common::Result<BatchOutcome>::failure(failure);
+    }
+    slot->cv.wait_for(lock, kCancelPoll);
+  }
+  return common::Result<BatchOutcome>::success(std::move(*slot->outcome));
+}
+
+std::optional<std::pair<std::shared_ptr<BatchBackend>, std::string>>
+BatchLane::withdraw(const std::string &key, const std::string &custom_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto queue_it = queues_.find(key);
+  if (queue_it == queues_.end()) {
+    return std::nullopt;
+  }
+  auto &queue = queue_it->second;
+  const auto pending =
+      std::find_if(queue.pending.begin(), queue.pending.end(),
+                   [&](const Pending &entry) { return entry.request.custom_id == custom_id; });
+  if (pending != queue.pending.end()) {
+    queue.pending.erase(pending);
+    ++queue.stats.failed;
+    return std::nullopt;
+  }
+  for (auto it = queue.in_flight.begin(); it != queue.in_flight.end(); ++it) {
+    if (it->callbacks.erase(custom_id) == 0) {
+      continue;
+    }
+    ++queue.stats.failed;
+    if (!it->callbacks.empty()) {
+      return std::nullopt;
+    }
+    auto orphan = std::make_pair(it->backend, it->batch_id);
+    queue.in_flight.erase(it);
+    return orphan;
+  }
+  return std::nullopt;
+}
+
+void BatchLane::flush() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flush_requested_ = true;
+    const auto now = Clock::now();
+    for (auto &[key, queue] : queues_) {
+      for (auto &flight : queue.in_flight) {
+        flight.next_poll = std::min(flight.next_poll, now);
+      }
+    }
+  }
+  cv_.notify_all();
+}
+
+std::vector<BatchStats> BatchLane::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<BatchStats> out;
+  out.reserve(queues_.size());
+  for (const auto &[key, queue] : queues_) {
+    BatchStats stats = queue.stats;
+    stats.queued = queue.pending.size();
+    stats.in_flight_batches = queue.in_flight.size();
+    for (const auto &flight : queue.in_flight) {
+      stats.in_flight_requests += flight.callbacks.size();
+    }
+    out.push_back(std::move(stats));
+  }
+  std::sort(out.begin(), out.end(),
+            [](const BatchStats &a, const BatchStats &b) { return a.key < b.key; });
+  return out;
+}
+
+void BatchLane::worker_loop() {
+  struct Submission {
+    std::string key;
+    std::shared_ptr<BatchBackend> backend;
+    std::vector<Pending> batch;
+  };
+  struct Poll {
+    std::string key;
+    std::shared_ptr<BatchBackend> backend;
+    std::string batch_id;
+  };
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopping_) {
+    const auto now = Clock::now();
+    const auto max_delay = std::chrono::seconds(config_.max_delay_secs);
+    const std::size_t max_size = std::max<std::size_t>(1, config_.max_batch_size);
+    auto wake = Clock::time_point::max();
+    std::vector<Submission> submissions;
+    std::vector<Poll> polls;
+    for (auto &[key, queue] : queues_) {
+      while (!queue.pending.empty()) {
+        const auto oldest = queue.pending.front().queued_at;
+        if (!flush_requested_ && queue.pending.size() < max_size && now - oldest < max_delay) {
+          wake = std::min(wake, oldest + max_delay);
+          break;
+        }
+        const auto count = std::min(max_size, queue.pending.size());
+        const auto end = queue.pending.begin() + static_cast<std::ptrdiff_t>(count);
+        submissions.push_back({key, queue.backend,
+                               std::vector<Pending>(std::make_move_iterator(queue.pending.begin()),
+                                                    std::make_move_iterator(end))});
+        queue.pending.erase(queue.pending.begin(), end);
+      }
+      for (auto &flight : queue.in_flight) {
+        if (flight.next_poll <= now) {
+          polls.push_back({key, flight.backend, flight.batch_id});
+          // poll_batch() schedules the next one.
+          flight.next_poll = Clock::time_point::max();
+        } else {
+          wake = std::min(wake, flight.next_poll);
+        }
+      }
+    }
+    flush_requested_ = false;
+
+    if (submissions.empty() && polls.empty()) {
+      if (wake == Clock::time_point::max()) {
+        cv_.wait(lock);
+      } else {
+        cv_.wait_until(lock, wake);
+      }
+      continue;
+    }
+
+    lock.unlock();
+    for (auto &submission : submissions) {
+      submit_batch(submission.key, submission.backend, std::move(submission.batch));
+    }
+    for (const auto &poll : polls) {
+      poll_batch(poll.key, poll.backend, poll.batch_id);
+    }
+    lock.lock();
+  }
+}
+
+void BatchLane::submit_batch(const std::string &key, const std::shared_ptr<BatchBackend> &backend,
+                             std::vector<Pending> batch) {
+  std::vector<BatchRequest> requests;
+  requests.reserve(batch.size());
+  for (const auto &pending : batch) {
+    requests.push_back(pending.request);
+  }
+  auto batch_id = backend->submit(requests);
+  if (!batch_id.ok()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queues_[key].stats.failed += batch.size();
+    }
+    for (auto &pending : batch) {
+      pending.on_done(failed_outcome(pending.request.custom_id, batch_id.error()));
+    }
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  InFlight flight;
+  flight.batch_id = batch_id.value();
+  flight.backend = backend;
+  for (auto &pending : batch) {
+    flight.callbacks.emplace(pending.request.custom_id, std::move(pending.on_done));
+  }
+  flight.submitted_at = Clock::now();
+  flight.next_poll = flight.submitted_at + std::chrono::seconds(std::max<std::uint64_t>(
+                                               1, config_.poll_interval_secs));
+  auto &queue = queues_[key];
+  ++queue.stats.submitted_batches;
+  queue.in_flight.push_back(std::move(flight));
+}
+
+void BatchLane::poll_batch(const std::string &key, const std::shared_ptr<BatchBackend> &backend,
+                           const std::string &batch_id) {
+  auto polled = backend->poll(batch_id);
+
+  std::vector<std::pair<Callback, BatchOutcome>> deliveries;
+  bool expired = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &queue = queues_[key];
+    const auto it = std::find_if(queue.in_flight.begin(), queue.in_flight.end(),
+                                 [&](const InFlight &flight) { return flight.batch_id == batch_id; });
+    if (it == queue.in_flight.end()) {
+      return;
+    }
+    const auto now = Clock::now();
+    if (polled.ok() && polled.value().done) {
+      for (auto &outcome : polled.value().outcomes) {
+        const auto callback = it->callbacks.find(outcome.custom_id);
+        if (callback == it->callbacks.end()) {
+          continue;
+        }
+        ++(outcome.error.empty() ? queue.stats.completed : queue.stats.failed);
+        deliveries.emplace_back(std::move(callback->second), std::move(outcome));
+        it->callbacks.erase(callback);
+      }
+      for (auto &[custom_id, callback] : it->callbacks) {
+        ++queue.stats.failed;
+        deliveries.emplace_back(std::move(callback),
+                                failed_outcome(custom_id, "missing from results of batch " +
+                                                              batch_id + " (" +
+                                                              polled.value().status + ")"));
+      }
+      queue.in_flight.erase(it);
+    } else if (now - it->submitted_at >= std::chrono::seconds(config_.max_wait_secs)) {
+      const std::string error =
+          "batch " + batch_id + " did not finish in time" +
+          (polled.ok() ? std::string() : ": " + polled.error());
+      for (auto &[custom_id, callback] : it->callbacks) {
+        ++queue.stats.failed;
+        auto outcome = failed_outcome(custom_id, error);
+        outcome.retryable = false;
+        deliveries.emplace_back(std::move(callback), std::move(outcome));
+      }
+      queue.in_flight.erase(it);
+      expired = true;
+    } else {
+      // Failed polls are retried on the next interval; the batch keeps running upstream.
+      it->next_poll =
+          now + std::chrono::seconds(std::max<std::uint64_t>(1, config_.poll_interval_secs));
+    }
+  }
+  if (expired) {
+    (void)backend->cancel(batch_id);
+  }
+  for (auto &[callback, outcome] : deliveries) {
+    callback(std::move(outcome));
+  }
+}
+
+void BatchLane::fail_all(const std::string &error) {
+  std::vector<std::pair<Callback, BatchOutcome>> deliveries;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &[key, queue] : queues_) {
+      for (auto &pending : queue.pending) {
+        deliveries.emplace_back(std::move(pending.on_done),
+                                failed_outcome(pending.request.custom_id, error));
+      }
+      for (auto &flight : queue.in_flight) {
+        for (auto &[custom_id, callback] : flight.callbacks) {
+          auto outcome = failed_outcome(custom_id, error);
+          outcome.retryable = false;
+          deliveries.emplace_back(std::move(callback), std::move(outcome));
+        }
+      }
+    }
+    queues_.clear();
+  }
+  for (auto &[callback, outcome] : deliveries) {
+    callback(std::move(outcome));
+  }
+}
+
+BatchedProvider::BatchedProvider(std::shared_ptr<Provider> inner,
+                                 std::shared_ptr<BatchBackend> backend, std::string key)
+    : inner_(std::move(inner)), backend_(std::move(backend)), key_(std::move(key)) {}
+
+std::optional<common::Result<std::string>>
+BatchedProvider::try_batch(const std::optional<std::string> &system_prompt,
+                           const std::string &message, const std::string &model,
+                           const double temperature, const std::vector<tools::ToolSpec> &tools) {
+  auto &lane = BatchLane::shared();
+  if (current_request_priority() != RequestPriority::Deferred || !lane.config().enabled) {
+    return std::nullopt;
+  }
+  BatchRequest request;
+  request.system_prompt = system_prompt;
+  request.message = message;
+  request.model = model;
+  request.temperature = temperature;
+  request.tools = tools;
+  auto outcome = lane.submit(key_, backend_, std::move(request));
+  if (common::is_cancelled(common::current_cancel_token())) {
+    return common::Result<std::string>::failure("request cancelled");
+  }
+  // A timed-out request may still be billed upstream, so it is not sent again.
+  if (!outcome.ok()) {
+    return common::Result<std::string>::failure(outcome.error());
+  }
+  if (!outcome.value().error.empty()) {
+    if (outcome.value().retryable) {
+      return std::nullopt;
+    }
+    return common::Result<std::string>::failure(outcome.value().error);
+  }
+  if (outcome.value().usage.has_value()) {
+    report_usage(*outcome.value().usage);
+  }
+  return common::Result<std::string>::success(std::move(outcome.value().content));
+}
+
+common::Result<std::string> BatchedProvider::chat(const std::string &message,
+                                                  const std::string &model,
+                                                  const double temperature) {
+  if (auto batched = try_batch(std::nullopt, message, model, temperature, {});
+      batched.has_value()) {
+    return std::move(*batched);
+  }
+  return inner_->chat(message, model, temperature);
+}
+
+common::Result<std::string>
+BatchedProvider::chat_with_system(const std::optional<std::string> &system_prompt,
+                                  const std::string &message, const std::string &model,
+                                  const double temperature) {
+  if (auto batched = try_batch(system_prompt, message, model, temperature, {});
+      batched.has_value()) {
+    return std::move(*batched);
+  }
+  return inner_->chat_with_system(system_prompt, message, model, temperature);
+}
+
+common::Result<std::string> BatchedProvider::chat_with_system_tools(
+    const std::optional<std::string> &system_prompt, const std::string &message,
+    const std::string &model, const double temperature,
+    const std::vector<tools::ToolSpec> &tools) {
+  if (auto batched = try_batch(system_prompt, message, model, temperature, tools);
+      batched.has_value()) {
+    return std::move(*batched);
+  }
+  return inner_->chat_with_system_tools(system_prompt, message, model, temperature, tools);
+}
+
+common::Result<std::string>
+BatchedProvider::chat_with_system_stream(const std::optional<std::string> &system_prompt,
+                                         const std::string &message, const std::string &model,
+                                         const double temperature,
+                                         const StreamChunkCallback &on_chunk) {
+  // Someone is watching a stream, so it is never deferred.
+  return inner_->chat_with_system_stream(system_prompt, message, model, temperature, on_chunk);
+}
+
+common::Status BatchedProvider::warmup() { return inner_->warmup(); }
+
+std::string BatchedProvider::name() const { return inner_->name(); }
+
+} // namespace ghostclaw::providers
@@ -1,6 +1,7 @@
 #include "ghostclaw/providers/compatible.hpp"
 
 #include "ghostclaw/common/fs.hpp"
+#include "ghostclaw/tools/tool_catalog.hpp"
 
 #include <sstream>
 
@@ -93,25 +94,26 @@ std::string CompatibleProvider::build_body(const std::optional<std::string> &sys
         body << ',';
       }
       const auto &tool = tools[i];
-      body << "{";
-      body << "\"type\":\"function\",";
-      body << "\"function\":{";
-      body << "\"name\":\"" << json_escape(tool.name) << "\",";
-      body << "\"description\":\"" << json_escape(tool.description) << "\",";
-      body << "\"parameters\":" << tool.parameters_json;
-      body << "}";
-      body << "}";
+      if (!tool.function_json.empty()) {
+        body << tool.function_json;
+      } else {
+        body << tools::serialize_function_spec(tool);
+      }
     }
     body << "],";
     body << "\"tool_choice\":\"auto\",";
   }
   body << "\"temperature\":" << temperature << ",";
   body << "\"stream\":" << (stream ? "true" : "false");
+  if (stream) {
+    // Without this the stream never reports token usage.
+    body << ",\"stream_options\":{\"include_usage\":true}";
+  }
   body << "}";
   return body.str();
 }
 
-common::Status CompatibleProvider::validate_response_status(const HttpResponse &response) const {
+common::Status CompatibleProvider::validate_response_status(const HttpResponse &response) {
   if (response.timeout) {
     return common::Status::error(
         ProviderError{.code = ProviderErrorCode::Timeout, .message = "request timed out"}.to_string());
@@ -176,6 +178,9 @@ bool CompatibleProvider::is_sse_response(const HttpResponse &response) {
 common::Result<std::string> CompatibleProvider::parse_sse_response(const HttpResponse &response) {
   auto parsed = parse_openai_sse_content(response.body);
   if (parsed.ok()) {
+    if (const auto usage = parse_openai_sse_usage(response.body); usage.has_value()) {
+      report_usage(*usage);
+    }
     return parsed;
   }
   return common::Result<std::string>::failure(
@@ -197,6 +202,9 @@ common::Result<std::string> CompatibleProvider::handle_response(const HttpRespon
     return provider_error_result(
         {.code = ProviderErrorCode::InvalidResponse, .message = parsed.error()});
   }
+  if (const auto usage = parse_openai_usage(response.body); usage.has_value()) {
+    report_usage(*usage);
+  }
 
   return parsed;
 }
@@ -264,12 +272,16 @@ CompatibleProvider::chat_with_system_stream(const std::optional<std::string> &sy
   std::string line_buffer;
   std::string event_data;
   bool saw_done = false;
+  std::optional<TokenUsage> stream_usage;
   const auto stream_handler = [&](const std::string_view bytes) {
     parse_sse_bytes(bytes, line_buffer, event_data, [&](const std::string &event) {
       if (common::trim(event) == "[DONE]") {
         saw_done = true;
         return;
       }
+      if (auto usage = parse_openai_usage(event); usage.has_value() && !usage->empty()) {
+        stream_usage = usage;
+      }
       auto delta = parse_openai_sse_event_delta(event);
       if (!delta.ok() || delta.value().empty()) {
         return;
@@ -295,6 +307,9 @@ CompatibleProvider::chat_with_system_stream(const std::optional<std::string> &sy
 
   if (is_sse_response(response)) {
     if (!aggregated.empty() || saw_done) {
+      if (stream_usage.has_value()) {
+        report_usage(*stream_usage);
+      }
       return common::Result<std::string>::success(aggregated);
     }
     return parse_sse_response(response);
@@ -2,8 +2,11 @@
 
 #include "ghostclaw/auth/oauth.hpp"
 #include "ghostclaw/common/fs.hpp"
+#include "ghostclaw/providers/admission.hpp"
 #include "ghostclaw/providers/anthropic.hpp"
+#include "ghostclaw/providers/batch.hpp"
 #include "ghostclaw/providers/compatible.hpp"
+#include "ghostclaw/providers/local.hpp"
 #include "ghostclaw/providers/ollama.hpp"
 #include "ghostclaw/providers/openai.hpp"
 #include "ghostclaw/providers/openrouter.hpp"
@@ -184,11 +187,9 @@ common::Result<std::shared_ptr<Provider>> make_anthropic(
       name, api_key.value_or(""), base_url, http_client, use_bearer_auth, std::move(extra_headers)));
 }
 
-} // namespace
-
 common::Result<std::shared_ptr<Provider>>
-create_provider(const std::string &name, const std::optional<std::string> &api_key,
-                std::shared_ptr<HttpClient> http_client) {
+create_upstream_provider(const std::string &name, const std::optional<std::string> &api_key,
+                         const std::shared_ptr<HttpClient> &http_client) {
   const std::string normalized = normalize_provider_id(name);
   auto resolved_key = resolve_api_key(normalized, api_key);
 
@@ -209,11 +210,15 @@ create_provider(const std::string &name, const std::optional<std::string> &api_k
   }
   if (normalized == "anthropic") {
     return common::Result<std::shared_ptr<Provider>>::success(
-        std::make_shared<AnthropicProvider>(resolved_key.value_or(""), http_client));
+        std::make_shared<AnthropicProvider>(
+            "anthropic", resolved_key.value_or(""),
+            resolve_base_url(normalized, "https://api.anthropic.com"), http_client));
   }
   if (normalized == "openai") {
     return common::Result<std::shared_ptr<Provider>>::success(
-        std::make_shared<OpenAiProvider>(resolved_key.value_or(""), http_client));
+        std::make_shared<OpenAiProvider>(resolved_key.value_or(""),
+                                         resolve_base_url(normalized, "https://api.openai.com/v1"),
+                                         http_client));
   }
   if (normalized == "ollama") {
     return common::Result<std::shared_ptr<Provider>>::success(
@@ -300,6 +305,62 @@ create_provider(const std::string &name, const std::optional<std::string> &api_k
   return common::Result<std::shared_ptr<Provider>>::failure("Unknown provider: " + name);
 }
 
+} // namespace
+
+common::Result<std::shared_ptr<Provider>>
+create_provider(const std::string &name, const std::optional<std::string> &api_key,
+                std::shared_ptr<HttpClient> http_client) {
+  const std::string trimmed_name = common::trim(name);
+  // Local models run in-process and have no upstream budget to share.
+  if (common::starts_with(common::to_lower(trimmed_name), "gguf:")) {
+    const std::string path = common::trim(trimmed_name.substr(5));
+    if (path.empty()) {
+      return common::Result<std::shared_ptr<Provider>>::failure(
+          "Local provider requires a model path: gguf:/path/to/model.gguf");
+    }
+    auto &cache = LocalModelCache::shared();
+    auto model = cache.acquire(common::expand_path(path));
+    if (!model.ok()) {
+      return common::Result<std::shared_ptr<Provider>>::failure(model.error());
+    }
+    return common::Result<std::shared_ptr<Provider>>::success(
+        std::make_shared<LocalProvider>(model.value(), cache.config().max_tokens));
+  }
+
+  auto provider = create_upstream_provider(name, api_key, http_client);
+  if (!provider.ok()) {
+    return provider;
+  }
+  // Budgets are per provider and per key, so two keys for one provider queue separately.
+  const std::string normalized = normalize_provider_id(name);
+  std::string key = normalized;
+  const auto resolved_key = resolve_api_key(normalized, api_key);
+  if (resolved_key.has_value()) {
+    key += "#" + std::to_string(std::hash<std::string>{}(*resolved_key) % 1000000);
+  }
+  std::shared_ptr<Provider> admitted = std::make_shared<AdmittedProvider>(provider.value(), key);
+
+  // Deferred work skips admission: batch APIs have their own, much larger quotas.
+  // Batches go to the same base URL as direct calls, so proxies keep working.
+  std::shared_ptr<BatchBackend> batch_backend;
+  if (resolved_key.has_value() && normalized == "anthropic") {
+    if (const auto anthropic = std::dynamic_pointer_cast<AnthropicProvider>(provider.value())) {
+      batch_backend = std::make_shared<AnthropicBatchBackend>(*resolved_key, anthropic->base_url(),
+                                                              http_client);
+    }
+  } else if (resolved_key.has_value() && normalized == "openai") {
+    if (const auto openai = std::dynamic_pointer_cast<CompatibleProvider>(provider.value())) {
+      batch_backend =
+          std::make_shared<OpenAiBatchBackend>(*resolved_key, openai->base_url(), http_client);
+    }
+  }
+  if (batch_backend != nullptr) {
+    return common::Result<std::shared_ptr<Provider>>::success(std::make_shared<BatchedProvider>(
+        std::move(admitted), std::move(batch_backend), std::move(key)));
+  }
+  return common::Result<std::shared_ptr<Provider>>::success(std::move(admitted));
+}
+
 common::Result<std::shared_ptr<Provider>> create_reliable_provider(
     const std::string &primary_name, const std::optional<std::string> &api_key,
     const config::ReliabilityConfig &reliability, std::shared_ptr<HttpClient> http_client) {
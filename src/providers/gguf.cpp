@@ -0,0 +1,736 @@
+#include "ghostclaw/providers/gguf.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ghostclaw::providers {
+
+namespace {
+
+constexpr std::uint32_t kGgufMagic = 0x46554747; // "GGUF" little-endian
+constexpr std::uint64_t kDefaultAlignment = 32;
+constexpr std::uint64_t kQk = 32;   // Q4_0 / Q8_0 block
+constexpr std::uint64_t kQkK = 256; // k-quant super-block
+
+enum class ValueType : std::uint32_t {
+  Uint8 = 0,
+  Int8 = 1,
+  Uint16 = 2,
+  Int16 = 3,
+  Uint32 = 4,
+  Int32 = 5,
+  Float32 = 6,
+  Bool = 7,
+  String = 8,
+  Array = 9,
+  Uint64 = 10,
+  Int64 = 11,
+  Float64 = 12,
+};
+
+float fp16_to_float(const std::uint16_t half) {
+  const std::uint32_t sign = (half & 0x8000U) << 16U;
+  const std::uint32_t exponent = (half >> 10U) & 0x1FU;
+  std::uint32_t mantissa = half & 0x3FFU;
+  std::uint32_t bits = 0;
+  if (exponent == 0) {
+    if (mantissa == 0) {
+      bits = sign;
+    } else {
+      // Subnormal: renormalise into a float exponent.
+      std::uint32_t e = 127 - 15 + 1;
+      while ((mantissa & 0x400U) == 0) {
+        mantissa <<= 1U;
+        --e;
+      }
+      mantissa &= 0x3FFU;
+      bits = sign | (e << 23U) | (mantissa << 13U);
+    }
+  } else if (exponent == 0x1F) {
+    bits = sign | 0x7F800000U | (mantissa << 13U);
+  } else {
+    bits = sign | ((exponent + 127 - 15) << 23U) | (mantissa << 13U);
+  }
+  float out = 0.0F;
+  std::memcpy(&out, &bits, sizeof(out));
+  return out;
+}
+
+std::uint16_t float_to_fp16(const float value) {
+  std::uint32_t bits = 0;
+  std::memcpy(&bits, &value, sizeof(bits));
+  const std::uint32_t sign = (bits >> 16U) & 0x8000U;
+  const std::int32_t exponent = static_cast<std::int32_t>((bits >> 23U) & 0xFFU) - 127 + 15;
+  std::uint32_t mantissa = bits & 0x7FFFFFU;
+  if (exponent <= 0) {
+    if (exponent < -10) {
+      return static_cast<std::uint16_t>(sign);
+    }
+    mantissa |= 0x800000U;
+    const auto shift = static_cast<std::uint32_t>(14 - exponent);
+    return static_cast<std::uint16_t>(sign | ((mantissa + (1U << (shift - 1U))) >> shift));
+  }
+  if (exponent >= 31) {
+    return static_cast<std::uint16_t>(sign | 0x7C00U);
+  }
+  // Round to nearest; a carry out of the mantissa correctly bumps the exponent.
+  return static_cast<std::uint16_t>(
+      sign | ((static_cast<std::uint32_t>(exponent) << 10U) + ((mantissa + 0x1000U) >> 13U)));
+}
+
+std::uint16_t read_u16(const std::uint8_t *p) {
+  std::uint16_t value = 0;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+void dequantize_q4_0(const std::uint8_t *src, float *dst, const std::uint64_t count) {
+  for (std::uint64_t block = 0; block < count / kQk; ++block) {
+    const std::uint8_t *b = src + block * 18;
+    const float d = fp16_to_float(read_u16(b));
+    const std::uint8_t *qs = b + 2;
+    float *y = dst + block * kQk;
+    for (std::uint64_t j = 0; j < kQk / 2; ++j) {
+      y[j] = static_cast<float>(static_cast<int>(qs[j] & 0x0FU) - 8) * d;
+      y[j + kQk / 2] = static_cast<float>(static_cast<int>(qs[j] >> 4U) - 8) * d;
+    }
+  }
+}
+
+void dequantize_q8_0(const std::uint8_t *src, float *dst, const std::uint64_t count) {
+  for (std::uint64_t block = 0; block < count / kQk; ++block) {
+    const std::uint8_t *b = src + block * 34;
+    const float d = fp16_to_float(read_u16(b));
+    const auto *qs = reinterpret_cast<const std::int8_t *>(b + 2);
+    float *y = dst + block * kQk;
+    for (std::uint64_t j = 0; j < kQk; ++j) {
+      y[j] = static_cast<float>(qs[j]) * d;
+    }
+  }
+}
+
+void k4_scale_min(const int j, const std::uint8_t *q, std::uint8_t &scale, std::uint8_t &min) {
+  if (j < 4) {
+    scale = q[j] & 63U;
+    min = q[j + 4] & 63U;
+  } else {
+    scale = static_cast<std::uint8_t>((q[j + 4] & 0x0FU) | ((q[j - 4] >> 6U) << 4U));
+    min = static_cast<std::uint8_t>((q[j + 4] >> 4U) | ((q[j] >> 6U) << 4U));
+  }
+}
+
+// block_q4_K: d, dmin (fp16), scales[12], qs[128].
+void dequantize_q4_k(const std::uint8_t *src, float *dst, const std::uint64_t count) {
+  for (std::uint64_t block = 0; block < count / kQkK; ++block) {
+    const std::uint8_t *b = src + block * 144;
+    const float d = fp16_to_float(read_u16(b));
+    const float dmin = fp16_to_float(read_u16(b + 2));
+    const std::uint8_t *scales = b + 4;
+    const std::uint8_t *q = b + 16;
+    float *y = dst + block * kQkK;
+    int is = 0;
+    for (std::uint64_t j = 0; j < kQkK; j += 64) {
+      std::uint8_t sc = 0;
+      std::uint8_t m = 0;
+      k4_scale_min(is, scales, sc, m);
+      const float d1 = d * sc;
+      const float m1 = dmin * m;
+      k4_scale_min(is + 1, scales, sc, m);
+      const float d2 = d * sc;
+      const float m2 = dmin * m;
+      for (int l = 0; l < 32; ++l) {
+        *y++ = d1 * static_cast<float>(q[l] & 0x0FU) - m1;
+      }
+      for (int l = 0; l < 32; ++l) {
+        *y++ = d2 * static_cast<float>(q[l] >> 4U) - m2;
+      }
+      q += 32;
+      is += 2;
+    }
+  }
+}
+
+// block_q6_K: ql[128], qh[64], scales[16] (int8), d (fp16).
+void dequantize_q6_k(const std::uint8_t *src, float *dst, const std::uint64_t count) {
+  for (std::uint64_t block = 0; block < count / kQkK; ++block) {
+    const std::uint8_t *b = src + block * 210;
+    const std::uint8_t *ql = b;
+    const std::uint8_t *qh = b + 128;
+    const auto *sc = reinterpret_cast<const std::int8_t *>(b + 192);
+    const float d = fp16_to_float(read_u16(b + 208));
+    float *y = dst + block * kQkK;
+    for (std::uint64_t n = 0; n < kQkK; n += 128) {
+      for (int l = 0; l < 32; ++l) {
+        const int is = l / 16;
+        const int q1 = static_cast<int>((ql[l] & 0x0FU) | (((qh[l] >> 0U) & 3U) << 4U)) - 32;
+        const int q2 = static_cast<int>((ql[l + 32] & 0x0FU) | (((qh[l] >> 2U) & 3U) << 4U)) - 32;
+        const int q3 = static_cast<int>((ql[l] >> 4U) | (((qh[l] >> 4U) & 3U) << 4U)) - 32;
+        const int q4 = static_cast<int>((ql[l + 32] >> 4U) | (((qh[l] >> 6U) & 3U) << 4U)) - 32;
+        y[l] = d * static_cast<float>(sc[is]) * static_cast<float>(q1);
+        y[l + 32] = d * static_cast<float>(sc[is + 2]) * static_cast<float>(q2);
+        y[l + 64] = d * static_cast<float>(sc[is + 4]) * static_cast<float>(q3);
+        y[l + 96] = d * static_cast<float>(sc[is + 6]) * static_cast<float>(q4);
+      }
+      y += 128;
+      ql += 64;
+      qh += 32;
+      sc += 8;
+    }
+  }
+}
+
+class Reader {
+public:
+  Reader(const std::uint8_t *data, const std::size_t size) : data_(data), size_(size) {}
+
+  template <typename T> bool read(T &out) {
+    if (size_ - pos_ < sizeof(T)) {
+      return false;
+    }
+    std::memcpy(&out, data_ + pos_, sizeof(T));
+    pos_ += sizeof(T);
+    return true;
+  }
+
+  bool read_string(std::string &out) {
+    std::uint64_t length = 0;
+    if (!read(length) || size_ - pos_ < length) {
+      return false;
+    }
+    out.assign(reinterpret_cast<const char *>(data_ + pos_), static_cast<std::size_t>(length));
+    pos_ += static_cast<std::size_t>(length);
+    return true;
+  }
+
+  [[nodiscard]] std::size_t position() const { return pos_; }
+  [[nodiscard]] std::size_t remaining() const { return size_ - pos_; }
+
+private:
+  const std::uint8_t *data_;
+  std::size_t size_;
+  std::size_t pos_ = 0;
+};
+
+bool read_scalar(Reader &reader, const ValueType type, GgufValue &out) {
+  const auto as_int = [&](auto value) {
+    out.kind = GgufValue::Kind::Integer;
+    out.integer = static_cast<std::int64_t>(value);
+    out.number = static_cast<double>(value);
+    return true;
+  };
+  switch (type) {
+  case ValueType::Uint8: {
+    std::uint8_t v = 0;
+    return reader.read(v) && as_int(v);
+  }
+  case ValueType::Int8: {
+    std::int8_t v = 0;
+    return reader.read(v) && as_int(v);
+  }
+  case ValueType::Uint16: {
+    std::uint16_t v = 0;
+    return reader.read(v) && as_int(v);
+  }
+  case ValueType::Int16: {
+    std::int16_t v = 0;
+    return reader.read(v) && as_int(v);
+  }
+  case ValueType::Uint32: {
+    std::uint32_t v = 0;
+    return reader.read(v) && as_int(v);
+  }
+  case ValueType::Int32: {
+    std::int32_t v = 0;
+    return reader.read(v) && as_int(v);
+  }
+  case ValueType::Uint64: {
+    std::uint64_t v = 0;
+    return reader.read(v) && as_int(v);
+  }
+  case ValueType::Int64: {
+    std::int64_t v = 0;
+    return reader.read(v) && as_int(v);
+  }
+  case ValueType::Float32: {
+    float v = 0;
+    if (!reader.read(v)) return false;
+    out.kind = GgufValue::Kind::Float;
+    out.number = v;
+    return true;
+  }
+  case ValueType::Float64: {
+    double v = 0;
+    if (!reader.read(v)) return false;
+    out.kind = GgufValue::Kind::Float;
+    out.number = v;
+    return true;
+  }
+  case ValueType::Bool: {
+    std::uint8_t v = 0;
+    if (!reader.read(v)) return false;
+    out.kind = GgufValue::Kind::Bool;
+    out.boolean = v != 0;
+    return true;
+  }
+  case ValueType::String:
+    out.kind = GgufValue::Kind::String;
+    return reader.read_string(out.string);
+  default:
+    return false;
+  }
+}
+
+bool read_value(Reader &reader, const ValueType type, GgufValue &out) {
+  if (type != ValueType::Array) {
+    return read_scalar(reader, type, out);
+  }
+  std::uint32_t element_type = 0;
+  std::uint64_t count = 0;
+  if (!reader.read(element_type) || !reader.read(count)) {
+    return false;
+  }
+  const auto element = static_cast<ValueType>(element_type);
+  // Every element takes at least a byte; reject counts a corrupt file cannot back.
+  if (element == ValueType::Array || count > reader.remaining()) {
+    return false;
+  }
+  if (element == ValueType::String) {
+    out.kind = GgufValue::Kind::StringArray;
+    out.strings.resize(static_cast<std::size_t>(count));
+    for (auto &value : out.strings) {
+      if (!reader.read_string(value)) return false;
+    }
+    return true;
+  }
+  out.kind = GgufValue::Kind::NumberArray;
+  out.numbers.reserve(static_cast<std::size_t>(count));
+  GgufValue scalar;
+  for (std::uint64_t i = 0; i < count; ++i) {
+    if (!read_scalar(reader, element, scalar)) return false;
+    out.numbers.push_back(scalar.kind == GgufValue::Kind::Bool ? (scalar.boolean ? 1.0 : 0.0)
+                                                               : scalar.number);
+  }
+  return true;
+}
+
+// False when a * b does not fit; tensor shapes come straight from the file.
+bool checked_mul(const std::uint64_t a, const std::uint64_t b, std::uint64_t &out) {
+  if (b != 0 && a > std::numeric_limits<std::uint64_t>::max() / b) {
+    return false;
+  }
+  out = a * b;
+  return true;
+}
+
+template <typename T> void append_raw(std::string &out, const T &value) {
+  out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+void append_string(std::string &out, const std::string &value) {
+  append_raw(out, static_cast<std::uint64_t>(value.size()));
+  out += value;
+}
+
+} // namespace
+
+bool ggml_type_supported(const std::uint32_t type) {
+  switch (static_cast<GgmlType>(type)) {
+  case GgmlType::F32:
+  case GgmlType::F16:
+  case GgmlType::BF16:
+  case GgmlType::Q4_0:
+  case GgmlType::Q8_0:
+  case GgmlType::Q4_K:
+  case GgmlType::Q6_K:
+    return true;
+  }
+  return false;
+}
+
+std::uint64_t ggml_block_size(const std::uint32_t type) {
+  switch (static_cast<GgmlType>(type)) {
+  case GgmlType::Q4_0:
+  case GgmlType::Q8_0:
+    return kQk;
+  case GgmlType::Q4_K:
+  case GgmlType::Q6_K:
+    return kQkK;
+  default:
+    return 1;
+  }
+}
+
+std::uint64_t ggml_row_bytes(const std::uint32_t type, const std::uint64_t elements) {
+  switch (static_cast<GgmlType>(type)) {
+  case GgmlType::F32:
+    return elements * 4;
+  case GgmlType::F16:
+  case GgmlType::BF16:
+    return elements * 2;
+  case GgmlType::Q4_0:
+    return elements / kQk * 18;
+  case GgmlType::Q8_0:
+    return elements / kQk * 34;
+  case GgmlType::Q4_K:
+    return elements / kQkK * 144;
+  case GgmlType::Q6_K:
+    return elements / kQkK * 210;
+  }
+  return 0;
+}
+
+void ggml_dequantize(const std::uint32_t type, const std::uint8_t *src, float *dst,
+                     const std::uint64_t count) {
+  switch (static_cast<GgmlType>(type)) {
+  case GgmlType::F32:
+    std::memcpy(dst, src, static_cast<std::size_t>(count) * sizeof(float));
+    return;
+  case GgmlType::F16:
+    for (std::uint64_t i = 0; i < count; ++i) {
+      dst[i] = fp16_to_float(read_u16(src + i * 2));
+    }
+    return;
+  case GgmlType::BF16:
+    for (std::uint64_t i = 0; i < count; ++i) {
+      const std::uint32_t bits = static_cast<std::uint32_t>(read_u16(src + i * 2)) << 16U;
+      std::memcpy(&dst[i], &bits, sizeof(float));
+    }
+    return;
+  case GgmlType::Q4_0:
+    dequantize_q4_0(src, dst, count);
+    return;
+  case GgmlType::Q8_0:
+    dequantize_q8_0(src, dst, count);
+    return;
+  case GgmlType::Q4_K:
+    dequantize_q4_k(src, dst, count);
+    return;
+  case GgmlType::Q6_K:
+    dequantize_q6_k(src, dst, count);
+    return;
+  }
+}
+
+std::uint64_t GgufTensor::rows() const {
+  std::uint64_t rows = 1;
+  for (std::size_t i = 1; i < dims.size(); ++i) {
+    rows *= dims[i];
+  }
+  return rows;
+}
+
+common::Result<std::shared_ptr<GgufFile>> GgufFile::open(const std::filesystem::path &path) {
+  using R = common::Result<std::shared_ptr<GgufFile>>;
+  std::shared_ptr<GgufFile> file(new GgufFile());
+
+#ifndef _WIN32
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return R::failure("cannot open model file: " + path.string());
+  }
+  struct stat st {};
+  if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+    ::close(fd);
+    return R::failure("cannot stat model file: " + path.string());
+  }
+  // Weights stay in the page cache and are shared between processes; nothing is copied.
+  void *mapped = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapped == MAP_FAILED) {
+    return R::failure("cannot map model file: " + path.string());
+  }
+  file->mapped_ = static_cast<const std::uint8_t *>(mapped);
+  file->mapped_size_ = static_cast<std::size_t>(st.st_size);
+#else
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return R::failure("cannot open model file: " + path.string());
+  }
+  file->buffer_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  file->mapped_ = file->buffer_.data();
+  file->mapped_size_ = file->buffer_.size();
+#endif
+
+  Reader reader(file->mapped_, file->mapped_size_);
+  std::uint32_t magic = 0;
+  std::uint32_t version = 0;
+  std::uint64_t tensor_count = 0;
+  std::uint64_t kv_count = 0;
+  if (!reader.read(magic) || magic != kGgufMagic) {
+    return R::failure("not a GGUF file: " + path.string());
+  }
+  if (!reader.read(version) || version < 2 || version > 3) {
+    return R::failure("unsupported GGUF version " + std::to_string(version));
+  }
+  if (!reader.read(tensor_count) || !reader.read(kv_count)) {
+    return R::failure("truncated GGUF header");
+  }
+
+  for (std::uint64_t i = 0; i < kv_count; ++i) {
+    std::string key;
+    std::uint32_t type = 0;
+    GgufValue value;
+    if (!reader.read_string(key) || !reader.read(type) ||
+        !read_value(reader, static_cast<ValueType>(type), value)) {
+      return R::failure("malformed GGUF metadata");
+    }
+    file->metadata_[key] = std::move(value);
+  }
+
+  // A tensor info takes at least 32 bytes (name length, one dim, type, offset); reject
+  // counts the file cannot back before reserving for them.
+  constexpr std::uint64_t kMinTensorInfoBytes = 32;
+  if (tensor_count > reader.remaining() / kMinTensorInfoBytes) {
+    return R::failure("malformed GGUF tensor count");
+  }
+  file->tensors_.reserve(static_cast<std::size_t>(tensor_count));
+  std::vector<std::uint64_t> offsets;
+  for (std::uint64_t i = 0; i < tensor_count; ++i) {
+    GgufTensor tensor;
+    std::uint32_t n_dims = 0;
+    if (!reader.read_string(tensor.name) || !reader.read(n_dims) || n_dims == 0 || n_dims > 4) {
+      return R::failure("malformed GGUF tensor info");
+    }
+    tensor.dims.resize(n_dims);
+    for (auto &dim : tensor.dims) {
+      if (!reader.read(dim)) return R::failure("malformed GGUF tensor info");
+    }
+    std::uint64_t offset = 0;
+    if (!reader.read(tensor.type) || !reader.read(offset)) {
+      return R::failure("malformed GGUF tensor info");
+    }
+    offsets.push_back(offset);
+    file->tensors_.push_back(std::move(tensor));
+  }
+
+  const auto alignment = static_cast<std::uint64_t>(
+      std::max<std::int64_t>(
+          1, file->get_int("general.alignment", static_cast<std::int64_t>(kDefaultAlignment))));
+  if (alignment > file->mapped_size_) {
+    return R::failure("malformed GGUF alignment");
+  }
+  const std::uint64_t data_start = (reader.position() + alignment - 1) / alignment * alignment;
+  if (data_start > file->mapped_size_) {
+    return R::failure("GGUF tensor data starts past the end of the file");
+  }
+  const std::uint64_t data_size = file->mapped_size_ - data_start;
+  for (std::size_t i = 0; i < file->tensors_.size(); ++i) {
+    auto &tensor = file->tensors_[i];
+    if (!ggml_type_supported(tensor.type)) {
+      return R::failure("tensor '" + tensor.name + "' has unsupported type " +
+                        std::to_string(tensor.type));
+    }
+    const std::uint64_t block = ggml_block_size(tensor.type);
+    if (tensor.row_length() % block != 0) {
+      return R::failure("tensor '" + tensor.name + "' rows are not whole blocks");
+    }
+    std::uint64_t elements = 1;
+    for (const auto dim : tensor.dims) {
+      if (!checked_mul(elements, dim, elements)) {
+        return R::failure("tensor '" + tensor.name + "' is too large");
+      }
+    }
+    std::uint64_t bytes = 0;
+    if (!checked_mul(elements / block, ggml_row_bytes(tensor.type, block), bytes)) {
+      return R::failure("tensor '" + tensor.name + "' is too large");
+    }
+    if (offsets[i] > data_size || bytes > data_size - offsets[i]) {
+      return R::failure("tensor '" + tensor.name + "' runs past the end of the file");
+    }
+    tensor.data = file->mapped_ + data_start + offsets[i];
+    file->tensor_index_[tensor.name] = i;
+  }
+  return R::success(std::move(file));
+}
+
+GgufFile::~GgufFile() {
+#ifndef _WIN32
+  if (mapped_ != nullptr && buffer_.empty()) {
+    ::munmap(const_cast<std::uint8_t *>(mapped_), mapped_size_);
+  }
+#endif
+}
+
+const GgufValue *GgufFile::find(const std::string &key) const {
+  const auto it = metadata_.find(key);
+  return it == metadata_.end() ? nullptr : &it->second;
+}
+
+std::int64_t GgufFile::get_int(const std::string &key, const std::int64_t fallback) const {
+  const auto *value = find(key);
+  if (value == nullptr) return fallback;
+  if (value->kind == GgufValue::Kind::Integer) return value->integer;
+  if (value->kind == GgufValue::Kind::Float) return static_cast<std::int64_t>(value->number);
+  return fallback;
+}
+
+double GgufFile::get_float(const std::string &key, const double fallback) const {
+  const auto *value = find(key);
+  if (value == nullptr) return fallback;
+  if (value->kind == GgufValue::Kind::Integer || value->kind == GgufValue::Kind::Float) {
+    return value->number;
+  }
+  return fallback;
+}
+
+bool GgufFile::get_bool(const std::string &key, const bool fallback) const {
+  const auto *value = find(key);
+  return value != nullptr && value->kind == GgufValue::Kind::Bool ? value->boolean : fallback;
+}
+
+std::string GgufFile::get_string(const std::string &key, const std::string &fallback) const {
+  const auto *value = find(key);
+  return value != nullptr && value->kind == GgufValue::Kind::String ? value->string : fallback;
+}
+
+const GgufTensor *GgufFile::tensor(const std::string &name) const {
+  const auto it = tensor_index_.find(name);
+  return it == tensor_index_.end() ? nullptr : &tensors_[it->second];
+}
+
+void GgufWriter::set_uint(const std::string &key, const std::uint32_t value) {
+  std::string encoded;
+  append_raw(encoded, static_cast<std::uint32_t>(ValueType::Uint32));
+  append_raw(encoded, value);
+  metadata_.emplace_back(key, std::move(encoded));
+}
+
+void GgufWriter::set_float(const std::string &key, const float value) {
+  std::string encoded;
+  append_raw(encoded, static_cast<std::uint32_t>(ValueType::Float32));
+  append_raw(encoded, value);
+  metadata_.emplace_back(key, std::move(encoded));
+}
+
+void GgufWriter::set_bool(const std::string &key, const bool value) {
+  std::string encoded;
+  append_raw(encoded, static_cast<std::uint32_t>(ValueType::Bool));
+  append_raw(encoded, static_cast<std::uint8_t>(value ? 1 : 0));
+  metadata_.emplace_back(key, std::move(encoded));
+}
+
+void GgufWriter::set_string(const std::string &key, const std::string &value) {
+  std::string encoded;
+  append_raw(encoded, static_cast<std::uint32_t>(ValueType::String));
+  append_string(encoded, value);
+  metadata_.emplace_back(key, std::move(encoded));
+}
+
+void GgufWriter::set_strings(const std::string &key, const std::vector<std::string> &values) {
+  std::string encoded;
+  append_raw(encoded, static_cast<std::uint32_t>(ValueType::Array));
+  append_raw(encoded, static_cast<std::uint32_t>(ValueType::String));
+  append_raw(encoded, static_cast<std::uint64_t>(values.size()));
+  for (const auto &value : values) {
+    append_string(encoded, value);
+  }
+  metadata_.emplace_back(key, std::move(encoded));
+}
+
+void GgufWriter::set_floats(const std::string &key, const std::vector<float> &values) {
+  std::string encoded;
+  append_raw(encoded, static_cast<std::uint32_t>(ValueType::Array));
+  append_raw(encoded, static_cast<std::uint32_t>(ValueType::Float32));
+  append_raw(encoded, static_cast<std::uint64_t>(values.size()));
+  for (const float value : values) {
+    append_raw(encoded, value);
+  }
+  metadata_.emplace_back(key, std::move(encoded));
+}
+
+void GgufWriter::set_ints(const std::string &key, const std::vector<std::int32_t> &values) {
+  std::string encoded;
+  append_raw(encoded, static_cast<std::uint32_t>(ValueType::Array));
+  append_raw(encoded, static_cast<std::uint32_t>(ValueType::Int32));
+  append_raw(encoded, static_cast<std::uint64_t>(values.size()));
+  for (const auto value : values) {
+    append_raw(encoded, value);
+  }
+  metadata_.emplace_back(key, std::move(encoded));
+}
+
+void GgufWriter::add_tensor(const std::string &name, std::vector<std::uint64_t> dims,
+                            const GgmlType type, std::vector<std::uint8_t> data) {
+  tensors_.push_back({name, std::move(dims), type, std::move(data)});
+}
+
+void GgufWriter::add_f32(const std::string &name, std::vector<std::uint64_t> dims,
+                         const std::vector<float> &values) {
+  std::vector<std::uint8_t> data(values.size() * sizeof(float));
+  std::memcpy(data.data(), values.data(), data.size());
+  add_tensor(name, std::move(dims), GgmlType::F32, std::move(data));
+}
+
+common::Status GgufWriter::write(const std::filesystem::path &path) const {
+  std::string header;
+  append_raw(header, kGgufMagic);
+  append_raw(header, static_cast<std::uint32_t>(3));
+  append_raw(header, static_cast<std::uint64_t>(tensors_.size()));
+  append_raw(header, static_cast<std::uint64_t>(metadata_.size()));
+  for (const auto &[key, encoded] : metadata_) {
+    append_string(header, key);
+    header += encoded;
+  }
+
+  const auto align = [](const std::uint64_t value) {
+    return (value + kDefaultAlignment - 1) / kDefaultAlignment * kDefaultAlignment;
+  };
+  std::uint64_t offset = 0;
+  for (const auto &tensor : tensors_) {
+    append_string(header, tensor.name);
+    append_raw(header, static_cast<std::uint32_t>(tensor.dims.size()));
+    for (const auto dim : tensor.dims) {
+      append_raw(header, dim);
+    }
+    append_raw(header, static_cast<std::uint32_t>(tensor.type));
+    append_raw(header, offset);
+    offset = align(offset + tensor.data.size());
+  }
+  header.resize(static_cast<std::size_t>(align(header.size())), '\0');
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    return common::Status::error("cannot write " + path.string());
+  }
+  out.write(header.data(), static_cast<std::streamsize>(header.size()));
+  for (const auto &tensor : tensors_) {
+    out.write(reinterpret_cast<const char *>(tensor.data.data()),
+              static_cast<std::streamsize>(tensor.data.size()));
+    const std::string padding(static_cast<std::size_t>(align(tensor.data.size()) - tensor.data.size()),
+                              '\0');
+    out.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+  }
+  return out ? common::Status::success() : common::Status::error("short write to " + path.string());
+}
+
+std::vector<std::uint8_t> quantize_q8_0(const std::vector<float> &values) {
+  std::vector<std::uint8_t> out((values.size() / kQk) * 34);
+  for (std::size_t block = 0; block < values.size() / kQk; ++block) {
+    const float *x = values.data() + block * kQk;
+    float amax = 0.0F;
+    for (std::size_t j = 0; j < kQk; ++j) {
+      amax = std::max(amax, std::fabs(x[j]));
+    }
+    const float d = amax / 127.0F;
+    const float id = d != 0.0F ? 1.0F / d : 0.0F;
+    std::uint8_t *b = out.data() + block * 34;
+    const std::uint16_t half = float_to_fp16(d);
+    std::memcpy(b, &half, sizeof(half));
+    for (std::size_t j = 0; j < kQk; ++j) {
+      b[2 + j] = static_cast<std::uint8_t>(static_cast<std::int8_t>(std::lround(x[j] * id)));
+    }
+  }
+  return out;
+}
+
+} // namespace ghostclaw::providers
@@ -0,0 +1,97 @@
+#include "ghostclaw/providers/local.hpp"
+
+#include "ghostclaw/common/cancel.hpp"
+
+namespace ghostclaw::providers {
+
+LocalProvider::LocalProvider(std::shared_ptr<LocalModel> model, const std::uint32_t max_tokens)
+    : model_(std::move(model)), max_tokens_(max_tokens) {}
+
+common::Result<std::string> LocalProvider::chat(const std::string &message,
+                                                const std::string &model,
+                                                const double temperature) {
+  return chat_with_system_stream(std::nullopt, message, model, temperature, {});
+}
+
+common::Result<std::string> LocalProvider::chat_with_system(
+    const std::optional<std::string> &system_prompt, const std::string &message,
+    const std::string &model, const double temperature) {
+  return chat_with_system_stream(system_prompt, message, model, temperature, {});
+}
+
+common::Result<std::string> LocalProvider::chat_with_system_stream(
+    const std::optional<std::string> &system_prompt, const std::string &message,
+    const std::string &model, const double temperature, const StreamChunkCallback &on_chunk) {
+  (void)model;
+  const auto cancel = common::current_cancel_token();
+  bool cancelled = false;
+  const auto on_text = [&](const std::string_view text) {
+    if (common::is_cancelled(cancel)) {
+      cancelled = true;
+      return false;
+    }
+    if (on_chunk && !text.empty()) {
+      on_chunk(text);
+    }
+    return true;
+  };
+
+  LocalGenerateOptions options;
+  options.max_tokens = max_tokens_;
+  options.temperature = static_cast<float>(temperature);
+  LocalGenerateStats stats;
+  auto result = model_->chat(system_prompt, message, options, on_text, &stats);
+  report_usage(TokenUsage{.prompt_tokens = stats.prompt_tokens,
+                          .completion_tokens = stats.generated_tokens,
+                          .cached_prompt_tokens = stats.reused_tokens});
+  if (cancelled) {
+    return common::Result<std::string>::failure("request cancelled");
+  }
+  return result;
+}
+
+common::Status LocalProvider::warmup() { return common::Status::success(); }
+
+std::string LocalProvider::name() const { return "gguf"; }
+
+LocalModelCache &LocalModelCache::shared() {
+  static LocalModelCache cache;
+  return cache;
+}
+
+void LocalModelCache::configure(const config::LocalModelConfig &config) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  config_ = config;
+}
+
+config::LocalModelConfig LocalModelCache::config() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return config_;
+}
+
+common::Result<std::shared_ptr<LocalModel>>
+LocalModelCache::acquire(const std::filesystem::path &path) {
+  std::error_code ec;
+  auto canonical = std::filesystem::weakly_canonical(path, ec);
+  const std::string key = ec ? path.string() : canonical.string();
+
+  // Loading maps the file and validates every tensor; holding the lock keeps two callers
+  // from loading the same model twice.
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (auto existing = models_[key].lock()) {
+    return common::Result<std::shared_ptr<LocalModel>>::success(std::move(existing));
+  }
+  LocalModelOptions options;
+  options.threads = config_.threads;
+  options.context_length = config_.context_length;
+  options.cache_slots = config_.cache_slots;
+  auto loaded = LocalModel::load(path, options);
+  if (!loaded.ok()) {
+    models_.erase(key);
+    return loaded;
+  }
+  models_[key] = loaded.value();
+  return loaded;
+}
+
+} // namespace ghostclaw::providers
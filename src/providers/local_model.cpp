@@ -0,0 +1,1125 @@
+#include "ghostclaw/providers/local_model.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <queue>
+#include <random>
+
+namespace ghostclaw::providers {
+
+namespace {
+
+constexpr std::int32_t kTokenControl = 3;
+constexpr std::int32_t kTokenUserDefined = 4;
+constexpr std::int32_t kTokenByte = 6;
+// Prompt tokens evaluated per forward pass; bounds the activation buffers.
+constexpr std::size_t kPrefillBatch = 128;
+constexpr std::string_view kSpmSpace = "\xE2\x96\x81"; // U+2581
+
+std::size_t utf8_length(const unsigned char lead) {
+  if (lead < 0x80) return 1;
+  if ((lead >> 5U) == 0x6) return 2;
+  if ((lead >> 4U) == 0xE) return 3;
+  if ((lead >> 3U) == 0x1E) return 4;
+  return 1;
+}
+
+std::vector<std::string_view> utf8_chars(std::string_view text) {
+  std::vector<std::string_view> out;
+  for (std::size_t i = 0; i < text.size();) {
+    const std::size_t len =
+        std::min(utf8_length(static_cast<unsigned char>(text[i])), text.size() - i);
+    out.push_back(text.substr(i, len));
+    i += len;
+  }
+  return out;
+}
+
+// Length of the prefix of `text` that ends on a whole UTF-8 character.
+std::size_t utf8_complete_prefix(const std::string &text) {
+  const std::size_t n = text.size();
+  for (std::size_t back = 1; back <= std::min<std::size_t>(4, n); ++back) {
+    const auto c = static_cast<unsigned char>(text[n - back]);
+    if ((c & 0xC0U) != 0x80U) {
+      return back >= utf8_length(c) ? n : n - back;
+    }
+  }
+  return n;
+}
+
+std::string utf8_encode(const std::uint32_t cp) {
+  std::string out;
+  if (cp < 0x80) {
+    out.push_back(static_cast<char>(cp));
+  } else if (cp < 0x800) {
+    out.push_back(static_cast<char>(0xC0U | (cp >> 6U)));
+    out.push_back(static_cast<char>(0x80U | (cp & 0x3FU)));
+  } else {
+    out.push_back(static_cast<char>(0xE0U | (cp >> 12U)));
+    out.push_back(static_cast<char>(0x80U | ((cp >> 6U) & 0x3FU)));
+    out.push_back(static_cast<char>(0x80U | (cp & 0x3FU)));
+  }
+  return out;
+}
+
+// GPT-2 byte-level BPE maps every byte to a printable code point.
+const std::array<std::string, 256> &byte_to_unicode() {
+  static const std::array<std::string, 256> table = [] {
+    std::array<std::string, 256> out;
+    std::uint32_t extra = 0;
+    for (std::uint32_t b = 0; b < 256; ++b) {
+      const bool printable = (b >= 33 && b <= 126) || (b >= 161 && b <= 172) || b >= 174;
+      out[b] = utf8_encode(printable ? b : 256 + extra++);
+    }
+    return out;
+  }();
+  return table;
+}
+
+const std::unordered_map<std::string, unsigned char> &unicode_to_byte() {
+  static const std::unordered_map<std::string, unsigned char> table = [] {
+    std::unordered_map<std::string, unsigned char> out;
+    const auto &forward = byte_to_unicode();
+    for (std::size_t b = 0; b < forward.size(); ++b) {
+      out[forward[b]] = static_cast<unsigned char>(b);
+    }
+    return out;
+  }();
+  return table;
+}
+
+enum class CharClass { Letter, Digit, Space, Other };
+
+CharClass classify(const char ch) {
+  const auto c = static_cast<unsigned char>(ch);
+  if (c >= 0x80 || std::isalpha(c) != 0) return CharClass::Letter;
+  if (std::isdigit(c) != 0) return CharClass::Digit;
+  if (std::isspace(c) != 0) return CharClass::Space;
+  return CharClass::Other;
+}
+
+// Hand-written approximation of the GPT-2 pre-tokenizer regex: contractions, words with
+// an optional leading space, digit runs of up to three, punctuation runs and whitespace.
+// Non-ASCII bytes count as letters.
+std::vector<std::string_view> pretokenize(std::string_view s) {
+  static constexpr std::array<std::string_view, 7> kContractions = {"s",  "t",  "re", "ve",
+                                                                    "m",  "ll", "d"};
+  std::vector<std::string_view> out;
+  std::size_t i = 0;
+  while (i < s.size()) {
+    if (s[i] == '\'') {
+      bool matched = false;
+      for (const auto suffix : kContractions) {
+        if (i + 1 + suffix.size() <= s.size()) {
+          bool equal = true;
+          for (std::size_t k = 0; k < suffix.size(); ++k) {
+            equal = equal && std::tolower(static_cast<unsigned char>(s[i + 1 + k])) == suffix[k];
+          }
+          if (equal) {
+            out.push_back(s.substr(i, suffix.size() + 1));
+            i += suffix.size() + 1;
+            matched = true;
+            break;
+          }
+        }
+      }
+      if (matched) continue;
+    }
+
+    const std::size_t start = i;
+    std::size_t j = i;
+    if (s[j] == ' ' && j + 1 < s.size() && classify(s[j + 1]) != CharClass::Space) {
+      ++j;
+    }
+    const CharClass cls = classify(s[j]);
+    if (cls == CharClass::Letter) {
+      while (j < s.size() && classify(s[j]) == CharClass::Letter && (j == start || s[j] != '\'')) ++j;
+    } else if (cls == CharClass::Digit) {
+      for (std::size_t k = 0; k < 3 && j < s.size() && classify(s[j]) == CharClass::Digit; ++k) ++j;
+    } else if (cls == CharClass::Other) {
+      while (j < s.size() && classify(s[j]) == CharClass::Other) ++j;
+    } else {
+      while (j < s.size() && classify(s[j]) == CharClass::Space) ++j;
+      // Leave the last space to lead the next word.
+      if (j < s.size() && j - start > 1 && s[j - 1] == ' ') --j;
+    }
+    out.push_back(s.substr(start, j - start));
+    i = j;
+  }
+  return out;
+}
+
+float dot(const float *a, const float *b, const std::size_t n) {
+  // Independent lanes let the compiler vectorise without reassociating a single sum.
+  std::array<float, 8> acc{};
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    for (std::size_t k = 0; k < 8; ++k) {
+      acc[k] += a[i + k] * b[i + k];
+    }
+  }
+  float sum = 0.0F;
+  for (; i < n; ++i) {
+    sum += a[i] * b[i];
+  }
+  return sum + ((acc[0] + acc[1]) + (acc[2] + acc[3])) + ((acc[4] + acc[5]) + (acc[6] + acc[7]));
+}
+
+void rms_norm(const float *x, const std::vector<float> &weight, const float eps, float *out) {
+  const std::size_t n = weight.size();
+  const float mean = dot(x, x, n) / static_cast<float>(n);
+  const float scale = 1.0F / std::sqrt(mean + eps);
+  for (std::size_t i = 0; i < n; ++i) {
+    out[i] = x[i] * scale * weight[i];
+  }
+}
+
+std::int32_t sample(const std::vector<float> &logits, const LocalGenerateOptions &options,
+                    std::mt19937_64 &rng) {
+  const auto best = std::max_element(logits.begin(), logits.end());
+  if (options.temperature <= 0.0F || options.top_k == 1) {
+    return static_cast<std::int32_t>(best - logits.begin());
+  }
+  const std::size_t k = options.top_k == 0 ? logits.size()
+                                           : std::min<std::size_t>(options.top_k, logits.size());
+  std::vector<std::int32_t> ids(logits.size());
+  std::iota(ids.begin(), ids.end(), 0);
+  std::partial_sort(ids.begin(), ids.begin() + static_cast<std::ptrdiff_t>(k), ids.end(),
+                    [&](const std::int32_t a, const std::int32_t b) { return logits[a] > logits[b]; });
+  std::vector<double> weights(k);
+  for (std::size_t i = 0; i < k; ++i) {
+    weights[i] = std::exp((logits[ids[i]] - *best) / options.temperature);
+  }
+  std::discrete_distribution<std::size_t> pick(weights.begin(), weights.end());
+  return ids[pick(rng)];
+}
+
+common::Result<std::vector<float>> read_vector(const GgufFile &file, const std::string &name,
+                                               const std::size_t expected, const bool required) {
+  using R = common::Result<std::vector<float>>;
+  const auto *tensor = file.tensor(name);
+  if (tensor == nullptr) {
+    return required ? R::failure("model is missing tensor " + name) : R::success({});
+  }
+  const auto count = tensor->row_length() * tensor->rows();
+  if (!ggml_type_supported(tensor->type) || count != expected ||
+      count % ggml_block_size(tensor->type) != 0) {
+    return R::failure("unexpected shape or type for tensor " + name);
+  }
+  std::vector<float> out(static_cast<std::size_t>(count));
+  ggml_dequantize(tensor->type, tensor->data, out.data(), count);
+  return R::success(std::move(out));
+}
+
+common::Result<const GgufTensor *> read_matrix(const GgufFile &file, const std::string &name,
+                                               const std::size_t columns, const std::size_t rows) {
+  using R = common::Result<const GgufTensor *>;
+  const auto *tensor = file.tensor(name);
+  if (tensor == nullptr) {
+    return R::failure("model is missing tensor " + name);
+  }
+  if (!ggml_type_supported(tensor->type)) {
+    return R::failure("tensor " + name + " uses unsupported type " + std::to_string(tensor->type));
+  }
+  if (tensor->row_length() != columns || tensor->rows() != rows ||
+      columns % ggml_block_size(tensor->type) != 0) {
+    return R::failure("unexpected shape for tensor " + name);
+  }
+  return R::success(tensor);
+}
+
+} // namespace
+
+// --- LocalTokenizer ---------------------------------------------------------------------
+
+common::Result<LocalTokenizer> LocalTokenizer::from_gguf(const GgufFile &file) {
+  using R = common::Result<LocalTokenizer>;
+  LocalTokenizer tok;
+  const std::string model = file.get_string("tokenizer.ggml.model", "llama");
+  if (model == "llama") {
+    tok.kind_ = Kind::Spm;
+  } else if (model == "gpt2") {
+    tok.kind_ = Kind::Bpe;
+  } else {
+    return R::failure("unsupported tokenizer model: " + model);
+  }
+
+  const auto *tokens = file.find("tokenizer.ggml.tokens");
+  if (tokens == nullptr || tokens->kind != GgufValue::Kind::StringArray || tokens->strings.empty()) {
+    return R::failure("model has no tokenizer vocabulary");
+  }
+  tok.pieces_ = tokens->strings;
+  tok.scores_.assign(tok.pieces_.size(), 0.0F);
+  tok.types_.assign(tok.pieces_.size(), 1);
+  if (const auto *scores = file.find("tokenizer.ggml.scores");
+      scores != nullptr && scores->numbers.size() == tok.pieces_.size()) {
+    std::transform(scores->numbers.begin(), scores->numbers.end(), tok.scores_.begin(),
+                   [](const double v) { return static_cast<float>(v); });
+  }
+  if (const auto *types = file.find("tokenizer.ggml.token_type");
+      types != nullptr && types->numbers.size() == tok.pieces_.size()) {
+    std::transform(types->numbers.begin(), types->numbers.end(), tok.types_.begin(),
+                   [](const double v) { return static_cast<std::int32_t>(v); });
+  }
+  for (std::size_t i = 0; i < tok.pieces_.size(); ++i) {
+    tok.ids_.emplace(tok.pieces_[i], static_cast<std::int32_t>(i));
+    const auto type = tok.types_[i];
+    if ((type == kTokenControl || type == kTokenUserDefined) && !tok.pieces_[i].empty()) {
+      tok.specials_.emplace_back(tok.pieces_[i], static_cast<std::int32_t>(i));
+    }
+  }
+  std::stable_sort(tok.specials_.begin(), tok.specials_.end(), [](const auto &a, const auto &b) {
+    return a.first.size() > b.first.size();
+  });
+
+  if (tok.kind_ == Kind::Bpe) {
+    const auto *merges = file.find("tokenizer.ggml.merges");
+    if (merges == nullptr || merges->kind != GgufValue::Kind::StringArray) {
+      return R::failure("BPE tokenizer has no merges");
+    }
+    for (std::size_t i = 0; i < merges->strings.size(); ++i) {
+      tok.merge_ranks_.emplace(merges->strings[i], static_cast<std::int32_t>(i));
+    }
+  }
+
+  const bool spm = tok.kind_ == Kind::Spm;
+  tok.bos_ = static_cast<std::int32_t>(file.get_int("tokenizer.ggml.bos_token_id", spm ? 1 : -1));
+  tok.eos_ = static_cast<std::int32_t>(file.get_int("tokenizer.ggml.eos_token_id", spm ? 2 : -1));
+  tok.unk_ = static_cast<std::int32_t>(file.get_int("tokenizer.ggml.unknown_token_id", spm ? 0 : -1));
+  tok.add_bos_ = file.get_bool("tokenizer.ggml.add_bos_token", spm) && tok.bos_ >= 0;
+  tok.add_space_prefix_ = file.get_bool("tokenizer.ggml.add_space_prefix", true);
+  return R::success(std::move(tok));
+}
+
+std::vector<std::int32_t> LocalTokenizer::encode(const std::string_view text,
+                                                 const bool parse_special) const {
+  std::vector<std::int32_t> out;
+  encode_into(text, parse_special, true, out);
+  return out;
+}
+
+void LocalTokenizer::encode_into(const std::string_view text, const bool parse_special,
+                                 const bool at_start, std::vector<std::int32_t> &out) const {
+  std::size_t segment_start = 0;
+  const auto flush = [&](const std::size_t end) {
+    if (end > segment_start) {
+      const auto segment = text.substr(segment_start, end - segment_start);
+      if (kind_ == Kind::Spm) {
+        encode_spm(segment, at_start && segment_start == 0, out);
+      } else {
+        encode_bpe(segment, out);
+      }
+    }
+  };
+
+  if (parse_special && !specials_.empty()) {
+    std::size_t pos = 0;
+    while (pos < text.size()) {
+      bool matched = false;
+      for (const auto &[piece, id] : specials_) {
+        if (piece[0] == text[pos] && text.compare(pos, piece.size(), piece) == 0) {
+          flush(pos);
+          out.push_back(id);
+          pos += piece.size();
+          segment_start = pos;
+          matched = true;
+          break;
+        }
+      }
+      if (!matched) ++pos;
+    }
+  }
+  flush(text.size());
+}
+
+void LocalTokenizer::push_bytes(const std::string_view bytes, std::vector<std::int32_t> &out) const {
+  static constexpr char kHex[] = "0123456789ABCDEF";
+  for (const char ch : bytes) {
+    const auto c = static_cast<unsigned char>(ch);
+    std::string key;
+    if (kind_ == Kind::Spm) {
+      key = std::string("<0x") + kHex[c >> 4U] + kHex[c & 0x0FU] + ">";
+    } else {
+      key = byte_to_unicode()[c];
+    }
+    const auto it = ids_.find(key);
+    if (it != ids_.end()) {
+      out.push_back(it->second);
+    } else if (unk_ >= 0) {
+      out.push_back(unk_);
+    }
+  }
+}
+
+void LocalTokenizer::encode_spm(const std::string_view text, const bool first,
+                                std::vector<std::int32_t> &out) const {
+  std::string normalized;
+  if (first && add_space_prefix_) {
+    normalized = kSpmSpace;
+  }
+  for (const char ch : text) {
+    if (ch == ' ') {
+      normalized += kSpmSpace;
+    } else {
+      normalized.push_back(ch);
+    }
+  }
+
+  struct Symbol {
+    int prev;
+    int next;
+    std::size_t start;
+    std::size_t len;
+  };
+  std::vector<Symbol> symbols;
+  for (const auto ch : utf8_chars(normalized)) {
+    const int index = static_cast<int>(symbols.size());
+    symbols.push_back({index - 1, index + 1, static_cast<std::size_t>(ch.data() - normalized.data()),
+                       ch.size()});
+  }
+  if (symbols.empty()) return;
+  symbols.back().next = -1;
+
+  // Highest-scoring merge first, leftmost on ties, as in SentencePiece.
+  struct Bigram {
+    int left;
+    int right;
+    float score;
+    std::size_t len;
+    bool operator<(const Bigram &other) const {
+      return score < other.score || (score == other.score && left > other.left);
+    }
+  };
+  std::priority_queue<Bigram> queue;
+  const auto try_add = [&](const int left, const int right) {
+    if (left < 0 || right < 0) return;
+    const std::size_t len = symbols[left].len + symbols[right].len;
+    const auto it = ids_.find(normalized.substr(symbols[left].start, len));
+    if (it != ids_.end()) {
+      queue.push({left, right, scores_[static_cast<std::size_t>(it->second)], len});
+    }
+  };
+  for (std::size_t i = 1; i < symbols.size(); ++i) {
+    try_add(static_cast<int>(i - 1), static_cast<int>(i));
+  }
+  while (!queue.empty()) {
+    const Bigram top = queue.top();
+    queue.pop();
+    auto &left = symbols[top.left];
+    auto &right = symbols[top.right];
+    if (left.len == 0 || right.len == 0 || left.len + right.len != top.len ||
+        left.next != top.right) {
+      continue; // stale
+    }
+    left.len += right.len;
+    right.len = 0;
+    left.next = right.next;
+    if (right.next >= 0) {
+      symbols[right.next].prev = top.left;
+    }
+    try_add(left.prev, top.left);
+    try_add(top.left, left.next);
+  }
+
+  for (int i = 0; i != -1; i = symbols[i].next) {
+    const auto piece = normalized.substr(symbols[i].start, symbols[i].len);
+    const auto it = ids_.find(piece);
+    if (it != ids_.end()) {
+      out.push_back(it->second);
+    } else {
+      push_bytes(piece, out);
+    }
+  }
+}
+
+void LocalTokenizer::encode_bpe(const std::string_view text, std::vector<std::int32_t> &out) const {
+  const auto &table = byte_to_unicode();
+  for (const auto word : pretokenize(text)) {
+    std::string mapped;
+    for (const char ch : word) {
+      mapped += table[static_cast<unsigned char>(ch)];
+    }
+    encode_bpe_word(mapped, out);
+  }
+}
+
+void LocalTokenizer::encode_bpe_word(const std::string &word, std::vector<std::int32_t> &out) const {
+  std::vector<std::string> parts;
+  for (const auto ch : utf8_chars(word)) {
+    parts.emplace_back(ch);
+  }
+  while (parts.size() > 1) {
+    std::int32_t best_rank = INT32_MAX;
+    std::size_t best = 0;
+    for (std::size_t i = 0; i + 1 < parts.size(); ++i) {
+      const auto it = merge_ranks_.find(parts[i] + " " + parts[i + 1]);
+      if (it != merge_ranks_.end() && it->second < best_rank) {
+        best_rank = it->second;
+        best = i;
+      }
+    }
+    if (best_rank == INT32_MAX) break;
+    parts[best] += parts[best + 1];
+    parts.erase(parts.begin() + static_cast<std::ptrdiff_t>(best) + 1);
+  }
+  for (const auto &part : parts) {
+    const auto it = ids_.find(part);
+    if (it != ids_.end()) {
+      out.push_back(it->second);
+      continue;
+    }
+    for (const auto ch : utf8_chars(part)) {
+      const auto found = ids_.find(std::string(ch));
+      if (found != ids_.end()) {
+        out.push_back(found->second);
+      } else if (unk_ >= 0) {
+        out.push_back(unk_);
+      }
+    }
+  }
+}
+
+std::string LocalTokenizer::decode(const std::int32_t token) const {
+  if (token < 0 || static_cast<std::size_t>(token) >= pieces_.size()) {
+    return "";
+  }
+  const auto &piece = pieces_[static_cast<std::size_t>(token)];
+  const auto type = types_[static_cast<std::size_t>(token)];
+  if (type == kTokenControl) {
+    return "";
+  }
+  if (type == kTokenUserDefined) {
+    return piece;
+  }
+  if (kind_ == Kind::Spm) {
+    if (type == kTokenByte && piece.size() == 6 && piece.rfind("<0x", 0) == 0) {
+      return std::string(1, static_cast<char>(std::stoi(piece.substr(3, 2), nullptr, 16)));
+    }
+    std::string out;
+    for (std::size_t i = 0; i < piece.size();) {
+      if (piece.compare(i, kSpmSpace.size(), kSpmSpace) == 0) {
+        out.push_back(' ');
+        i += kSpmSpace.size();
+      } else {
+        out.push_back(piece[i++]);
+      }
+    }
+    return out;
+  }
+  const auto &reverse = unicode_to_byte();
+  std::string out;
+  for (const auto ch : utf8_chars(piece)) {
+    const auto it = reverse.find(std::string(ch));
+    if (it != reverse.end()) {
+      out.push_back(static_cast<char>(it->second));
+    } else {
+      out += ch;
+    }
+  }
+  return out;
+}
+
+std::optional<std::int32_t> LocalTokenizer::find(const std::string &piece) const {
+  const auto it = ids_.find(piece);
+  if (it == ids_.end()) return std::nullopt;
+  return it->second;
+}
+
+bool LocalTokenizer::is_control(const std::int32_t token) const {
+  return token >= 0 && static_cast<std::size_t>(token) < types_.size() &&
+         types_[static_cast<std::size_t>(token)] == kTokenControl;
+}
+
+// --- WorkerPool -------------------------------------------------------------------------
+
+WorkerPool::WorkerPool(const std::size_t threads) {
+  for (std::size_t i = 1; i < std::max<std::size_t>(1, threads); ++i) {
+    workers_.emplace_back([this, i]() { worker_loop(i); });
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  start_cv_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+void WorkerPool::run(const std::size_t count,
+                     const std::function<void(std::size_t, std::size_t)> &fn) {
+  if (count == 0) return;
+  if (workers_.empty() || count == 1) {
+    fn(0, count);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    job_ = &fn;
+    count_ = count;
+    pending_ = workers_.size();
+    ++generation_;
+  }
+  start_cv_.notify_all();
+  const std::size_t chunk = (count + size() - 1) / size();
+  fn(0, std::min(chunk, count));
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cv_.wait(lock, [this]() { return pending_ == 0; });
+  job_ = nullptr;
+}
+
+void WorkerPool::worker_loop(const std::size_t index) {
+  std::uint64_t seen = 0;
+  while (true) {
+    const std::function<void(std::size_t, std::size_t)> *job = nullptr;
+    std::size_t count = 0;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_cv_.wait(lock, [&]() { return stopping_ || generation_ != seen; });
+      if (stopping_) return;
+      seen = generation_;
+      job = job_;
+      count = count_;
+    }
+    const std::size_t chunk = (count + size() - 1) / size();
+    const std::size_t begin = std::min(index * chunk, count);
+    const std::size_t end = std::min(begin + chunk, count);
+    if (begin < end) {
+      (*job)(begin, end);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--pending_ == 0) {
+      done_cv_.notify_one();
+    }
+  }
+}
+
+// --- LocalModel -------------------------------------------------------------------------
+
+common::Result<std::shared_ptr<LocalModel>> LocalModel::load(const std::filesystem::path &path,
+                                                             const LocalModelOptions &options) {
+  using R = common::Result<std::shared_ptr<LocalModel>>;
+  auto file = GgufFile::open(path);
+  if (!file.ok()) {
+    return R::failure(file.error());
+  }
+  std::shared_ptr<LocalModel> model(new LocalModel());
+  model->file_ = file.value();
+  const GgufFile &gguf = *model->file_;
+
+  model->architecture_ = gguf.get_string("general.architecture", "");
+  if (model->architecture_ != "llama" && model->architecture_ != "qwen2") {
+    return R::failure("unsupported model architecture: " +
+                      (model->architecture_.empty() ? std::string("(none)") : model->architecture_));
+  }
+  auto tokenizer = LocalTokenizer::from_gguf(gguf);
+  if (!tokenizer.ok()) {
+    return R::failure(tokenizer.error());
+  }
+  model->tokenizer_ = std::move(tokenizer.value());
+
+  const std::string arch = model->architecture_ + ".";
+  const auto hparam = [&](const std::string &key, const std::int64_t fallback) {
+    return static_cast<std::size_t>(std::max<std::int64_t>(0, gguf.get_int(arch + key, fallback)));
+  };
+  model->n_embd_ = hparam("embedding_length", 0);
+  model->n_layer_ = hparam("block_count", 0);
+  model->n_head_ = hparam("attention.head_count", 0);
+  model->n_head_kv_ = hparam("attention.head_count_kv", static_cast<std::int64_t>(model->n_head_));
+  model->n_ff_ = hparam("feed_forward_length", 0);
+  if (model->n_embd_ == 0 || model->n_layer_ == 0 || model->n_head_ == 0 ||
+      model->n_head_kv_ == 0 || model->n_ff_ == 0 || model->n_head_ % model->n_head_kv_ != 0) {
+    return R::failure("model has missing or inconsistent hyperparameters");
+  }
+  model->head_dim_ =
+      hparam("attention.key_length", static_cast<std::int64_t>(model->n_embd_ / model->n_head_));
+  model->n_rot_ = std::min(hparam("rope.dimension_count", static_cast<std::int64_t>(model->head_dim_)),
+                           model->head_dim_);
+  model->rope_base_ = static_cast<float>(gguf.get_float(arch + "rope.freq_base", 10000.0));
+  model->norm_eps_ =
+      static_cast<float>(gguf.get_float(arch + "attention.layer_norm_rms_epsilon", 1e-5));
+  // llama GGUFs store Q/K permuted for interleaved rotary pairs; qwen2 uses split halves.
+  model->rope_neox_ = model->architecture_ == "qwen2";
+  const auto trained_context = static_cast<std::uint32_t>(hparam("context_length", 2048));
+  model->context_length_ =
+      options.context_length == 0 ? trained_context : std::min(options.context_length, trained_context);
+  if (model->context_length_ < 8) {
+    return R::failure("context length too small");
+  }
+
+  model->token_embd_ = gguf.tensor("token_embd.weight");
+  if (model->token_embd_ == nullptr || model->token_embd_->row_length() != model->n_embd_ ||
+      !ggml_type_supported(model->token_embd_->type)) {
+    return R::failure("model has no usable token_embd.weight");
+  }
+  model->n_vocab_ = static_cast<std::size_t>(model->token_embd_->rows());
+  if (model->n_vocab_ < model->tokenizer_.size()) {
+    return R::failure("embedding table is smaller than the vocabulary");
+  }
+  if (gguf.tensor("output.weight") != nullptr) {
+    auto output = read_matrix(gguf, "output.weight", model->n_embd_, model->n_vocab_);
+    if (!output.ok()) return R::failure(output.error());
+    model->output_ = output.value();
+  } else {
+    model->output_ = model->token_embd_; // tied embeddings
+  }
+  auto output_norm = read_vector(gguf, "output_norm.weight", model->n_embd_, true);
+  if (!output_norm.ok()) return R::failure(output_norm.error());
+  model->output_norm_ = std::move(output_norm.value());
+
+  const std::size_t q_dim = model->n_head_ * model->head_dim_;
+  const std::size_t kv_dim = model->n_head_kv_ * model->head_dim_;
+  model->layers_.resize(model->n_layer_);
+  for (std::size_t i = 0; i < model->n_layer_; ++i) {
+    const std::string prefix = "blk." + std::to_string(i) + ".";
+    auto &layer = model->layers_[i];
+    const std::array<std::tuple<const char *, std::size_t, std::size_t, const GgufTensor **>, 7>
+        matrices = {{{"attn_q.weight", model->n_embd_, q_dim, &layer.wq},
+                     {"attn_k.weight", model->n_embd_, kv_dim, &layer.wk},
+                     {"attn_v.weight", model->n_embd_, kv_dim, &layer.wv},
+                     {"attn_output.weight", q_dim, model->n_embd_, &layer.wo},
+                     {"ffn_gate.weight", model->n_embd_, model->n_ff_, &layer.w_gate},
+                     {"ffn_up.weight", model->n_embd_, model->n_ff_, &layer.w_up},
+                     {"ffn_down.weight", model->n_ff_, model->n_embd_, &layer.w_down}}};
+    for (const auto &[name, columns, rows, target] : matrices) {
+      auto tensor = read_matrix(gguf, prefix + name, columns, rows);
+      if (!tensor.ok()) return R::failure(tensor.error());
+      *target = tensor.value();
+    }
+    const std::array<std::tuple<const char *, std::size_t, bool, std::vector<float> *>, 5> vectors = {
+        {{"attn_norm.weight", model->n_embd_, true, &layer.attn_norm},
+         {"ffn_norm.weight", model->n_embd_, true, &layer.ffn_norm},
+         {"attn_q.bias", q_dim, false, &layer.bq},
+         {"attn_k.bias", kv_dim, false, &layer.bk},
+         {"attn_v.bias", kv_dim, false, &layer.bv}}};
+    for (const auto &[name, size, required, target] : vectors) {
+      auto values = read_vector(gguf, prefix + name, size, required);
+      if (!values.ok()) return R::failure(values.error());
+      *target = std::move(values.value());
+    }
+  }
+
+  const auto &tok = model->tokenizer_;
+  if (tok.find("<|im_start|>").has_value()) {
+    model->template_ = ChatTemplate::ChatMl;
+  } else if (tok.find("<|start_header_id|>").has_value()) {
+    model->template_ = ChatTemplate::Llama3;
+  } else if (tok.find("<|user|>").has_value()) {
+    model->template_ = ChatTemplate::Zephyr;
+  }
+
+  model->slots_.resize(std::max<std::uint32_t>(1, options.cache_slots));
+  for (auto &slot : model->slots_) {
+    slot.k.resize(model->n_layer_);
+    slot.v.resize(model->n_layer_);
+  }
+  const std::size_t threads =
+      options.threads != 0 ? options.threads
+                           : std::max<std::size_t>(1, std::thread::hardware_concurrency());
+  model->pool_ = std::make_unique<WorkerPool>(threads);
+  return R::success(std::move(model));
+}
+
+std::vector<std::int32_t> LocalModel::encode_chat(const std::optional<std::string> &system_prompt,
+                                                  const std::string &message,
+                                                  const std::size_t max_tokens) const {
+  // Markers are parsed for special tokens; the two bodies never are.
+  enum class Part { Marker, System, Message };
+  const bool has_system = system_prompt.has_value() && !system_prompt->empty();
+  const std::string system = has_system ? *system_prompt : std::string();
+  std::vector<std::pair<Part, std::string>> parts;
+  const auto marker = [&](std::string text) { parts.emplace_back(Part::Marker, std::move(text)); };
+  switch (template_) {
+  case ChatTemplate::ChatMl:
+    if (has_system) {
+      marker("<|im_start|>system\n");
+      parts.emplace_back(Part::System, system);
+      marker("<|im_end|>\n");
+    }
+    marker("<|im_start|>user\n");
+    parts.emplace_back(Part::Message, message);
+    marker("<|im_end|>\n<|im_start|>assistant\n");
+    break;
+  case ChatTemplate::Llama3:
+    if (has_system) {
+      marker("<|start_header_id|>system<|end_header_id|>\n\n");
+      parts.emplace_back(Part::System, system);
+      marker("<|eot_id|>");
+    }
+    marker("<|start_header_id|>user<|end_header_id|>\n\n");
+    parts.emplace_back(Part::Message, message);
+    marker("<|eot_id|><|start_header_id|>assistant<|end_header_id|>\n\n");
+    break;
+  case ChatTemplate::Zephyr:
+    if (has_system) {
+      marker("<|system|>\n");
+      parts.emplace_back(Part::System, system);
+      marker("</s>\n");
+    }
+    marker("<|user|>\n");
+    parts.emplace_back(Part::Message, message);
+    marker("</s>\n<|assistant|>\n");
+    break;
+  case ChatTemplate::Llama2:
+    marker("[INST] ");
+    if (has_system) {
+      marker("<<SYS>>\n");
+      parts.emplace_back(Part::System, system);
+      marker("\n<</SYS>>\n\n");
+    }
+    parts.emplace_back(Part::Message, message);
+    marker(" [/INST]");
+    break;
+  }
+
+  std::vector<std::vector<std::int32_t>> encoded(parts.size());
+  std::size_t total = tokenizer_.add_bos() ? 1 : 0;
+  bool at_start = true;
+  for (std::size_t i = 0; i < parts.size(); ++i) {
+    if (parts[i].second.empty()) continue;
+    tokenizer_.encode_into(parts[i].second, parts[i].first == Part::Marker, at_start, encoded[i]);
+    at_start = false;
+    total += encoded[i].size();
+  }
+
+  std::size_t excess = total > max_tokens ? total - max_tokens : 0;
+  for (std::size_t i = 0; i < parts.size() && excess > 0; ++i) {
+    if (parts[i].first != Part::System) continue;
+    auto &body = encoded[i];
+    const std::size_t drop = std::min(excess, body.size());
+    const auto first = body.begin() + static_cast<std::ptrdiff_t>((body.size() - drop + 1) / 2);
+    body.erase(first, first + static_cast<std::ptrdiff_t>(drop));
+    excess -= drop;
+  }
+  for (std::size_t i = 0; i < parts.size() && excess > 0; ++i) {
+    if (parts[i].first != Part::Message) continue;
+    auto &body = encoded[i];
+    const std::size_t drop = std::min(excess, body.size());
+    body.erase(body.begin(), body.begin() + static_cast<std::ptrdiff_t>(drop));
+    excess -= drop;
+  }
+
+  std::vector<std::int32_t> tokens;
+  tokens.reserve(total);
+  if (tokenizer_.add_bos()) {
+    tokens.push_back(tokenizer_.bos());
+  }
+  for (const auto &part : encoded) {
+    tokens.insert(tokens.end(), part.begin(), part.end());
+  }
+  if (excess > 0) {
+    // Only the markers are left and even they do not fit.
+    const auto first = tokens.begin() + (tokenizer_.add_bos() ? 1 : 0);
+    tokens.erase(first, first + static_cast<std::ptrdiff_t>(std::min(
+                                    excess, static_cast<std::size_t>(tokens.end() - first))));
+  }
+  return tokens;
+}
+
+void LocalModel::matmul(const GgufTensor &w, const float *x, const std::size_t n, float *y) {
+  const auto columns = static_cast<std::size_t>(w.row_length());
+  const auto rows = static_cast<std::size_t>(w.rows());
+  const auto row_bytes = static_cast<std::size_t>(ggml_row_bytes(w.type, columns));
+  const bool f32 = static_cast<GgmlType>(w.type) == GgmlType::F32;
+  pool_->run(rows, [&](const std::size_t begin, const std::size_t end) {
+    thread_local std::vector<float> scratch;
+    if (scratch.size() < columns) scratch.resize(columns);
+    for (std::size_t r = begin; r < end; ++r) {
+      const std::uint8_t *src = w.data + r * row_bytes;
+      const float *row = nullptr;
+      if (f32) {
+        row = reinterpret_cast<const float *>(src);
+      } else {
+        // Each row is decoded once and reused for every token in the batch.
+        ggml_dequantize(w.type, src, scratch.data(), columns);
+        row = scratch.data();
+      }
+      for (std::size_t i = 0; i < n; ++i) {
+        y[i * rows + r] = dot(row, x + i * columns, columns);
+      }
+    }
+  });
+}
+
+void LocalModel::forward(const std::int32_t *tokens, const std::size_t count,
+                         const std::size_t start, CacheSlot &slot, float *logits) {
+  const std::size_t d = n_embd_;
+  const std::size_t hd = head_dim_;
+  const std::size_t q_dim = n_head_ * hd;
+  const std::size_t kv_dim = n_head_kv_ * hd;
+  const std::size_t group = n_head_ / n_head_kv_;
+  const std::size_t end = start + count;
+
+  std::vector<float> x(count * d);
+  std::vector<float> xb(count * std::max(d, q_dim));
+  std::vector<float> q(count * q_dim);
+  std::vector<float> k(count * kv_dim);
+  std::vector<float> v(count * kv_dim);
+  std::vector<float> att(count * q_dim);
+  std::vector<float> gate(count * n_ff_);
+  std::vector<float> up(count * n_ff_);
+  std::vector<float> out(count * d);
+
+  const auto embd_row_bytes = static_cast<std::size_t>(ggml_row_bytes(token_embd_->type, d));
+  for (std::size_t i = 0; i < count; ++i) {
+    const auto token = static_cast<std::size_t>(std::clamp<std::int64_t>(
+        tokens[i], 0, static_cast<std::int64_t>(n_vocab_) - 1));
+    ggml_dequantize(token_embd_->type, token_embd_->data + token * embd_row_bytes, x.data() + i * d,
+                    d);
+  }
+
+  std::vector<float> inv_freq(n_rot_ / 2);
+  for (std::size_t j = 0; j < inv_freq.size(); ++j) {
+    inv_freq[j] = std::pow(rope_base_, -2.0F * static_cast<float>(j) / static_cast<float>(n_rot_));
+  }
+  const auto rope = [&](float *rows, const std::size_t heads, const std::size_t stride) {
+    for (std::size_t i = 0; i < count; ++i) {
+      const auto pos = static_cast<float>(start + i);
+      for (std::size_t h = 0; h < heads; ++h) {
+        float *head = rows + i * stride + h * hd;
+        for (std::size_t j = 0; j < inv_freq.size(); ++j) {
+          const float angle = pos * inv_freq[j];
+          const float c = std::cos(angle);
+          const float s = std::sin(angle);
+          float &a = rope_neox_ ? head[j] : head[2 * j];
+          float &b = rope_neox_ ? head[j + n_rot_ / 2] : head[2 * j + 1];
+          const float a0 = a;
+          a = a0 * c - b * s;
+          b = a0 * s + b * c;
+        }
+      }
+    }
+  };
+  const auto add_bias = [&](std::vector<float> &rows, const std::vector<float> &bias) {
+    if (bias.empty()) return;
+    for (std::size_t i = 0; i < count; ++i) {
+      for (std::size_t j = 0; j < bias.size(); ++j) {
+        rows[i * bias.size() + j] += bias[j];
+      }
+    }
+  };
+  const float scale = 1.0F / std::sqrt(static_cast<float>(hd));
+
+  for (std::size_t l = 0; l < n_layer_; ++l) {
+    const auto &layer = layers_[l];
+    for (std::size_t i = 0; i < count; ++i) {
+      rms_norm(x.data() + i * d, layer.attn_norm, norm_eps_, xb.data() + i * d);
+    }
+    matmul(*layer.wq, xb.data(), count, q.data());
+    matmul(*layer.wk, xb.data(), count, k.data());
+    matmul(*layer.wv, xb.data(), count, v.data());
+    add_bias(q, layer.bq);
+    add_bias(k, layer.bk);
+    add_bias(v, layer.bv);
+    rope(q.data(), n_head_, q_dim);
+    rope(k.data(), n_head_kv_, kv_dim);
+
+    auto &k_cache = slot.k[l];
+    auto &v_cache = slot.v[l];
+    if (k_cache.size() < end * kv_dim) {
+      k_cache.resize(end * kv_dim);
+      v_cache.resize(end * kv_dim);
+    }
+    std::copy(k.begin(), k.end(), k_cache.begin() + static_cast<std::ptrdiff_t>(start * kv_dim));
+    std::copy(v.begin(), v.end(), v_cache.begin() + static_cast<std::ptrdiff_t>(start * kv_dim));
+
+    pool_->run(count * n_head_, [&](const std::size_t begin, const std::size_t finish) {
+      thread_local std::vector<float> scores;
+      for (std::size_t index = begin; index < finish; ++index) {
+        const std::size_t i = index / n_head_;
+        const std::size_t h = index % n_head_;
+        const std::size_t span = start + i + 1;
+        const std::size_t kv_offset = (h / group) * hd;
+        const float *query = q.data() + i * q_dim + h * hd;
+        if (scores.size() < span) scores.resize(span);
+        float max_score = -INFINITY;
+        for (std::size_t t = 0; t < span; ++t) {
+          scores[t] = dot(query, k_cache.data() + t * kv_dim + kv_offset, hd) * scale;
+          max_score = std::max(max_score, scores[t]);
+        }
+        float total = 0.0F;
+        for (std::size_t t = 0; t < span; ++t) {
+          scores[t] = std::exp(scores[t] - max_score);
+          total += scores[t];
+        }
+        float *result = att.data() + i * q_dim + h * hd;
+        std::fill(result, result + hd, 0.0F);
+        for (std::size_t t = 0; t < span; ++t) {
+          const float weight = scores[t] / total;
+          const float *value = v_cache.data() + t * kv_dim + kv_offset;
+          for (std::size_t j = 0; j < hd; ++j) {
+            result[j] += weight * value[j];
+          }
+        }
+      }
+    });
+
+    matmul(*layer.wo, att.data(), count, out.data());
+    for (std::size_t j = 0; j < x.size(); ++j) x[j] += out[j];
+
+    for (std::size_t i = 0; i < count; ++i) {
+      rms_norm(x.data() + i * d, layer.ffn_norm, norm_eps_, xb.data() + i * d);
+    }
+    matmul(*layer.w_gate, xb.data(), count, gate.data());
+    matmul(*layer.w_up, xb.data(), count, up.data());
+    for (std::size_t j = 0; j < gate.size(); ++j) {
+      const float g = gate[j];
+      gate[j] = g / (1.0F + std::exp(-g)) * up[j]; // SwiGLU
+    }
+    matmul(*layer.w_down, gate.data(), count, out.data());
+    for (std::size_t j = 0; j < x.size(); ++j) x[j] += out[j];
+  }
+
+  if (logits != nullptr) {
+    rms_norm(x.data() + (count - 1) * d, output_norm_, norm_eps_, xb.data());
+    matmul(*output_, xb.data(), 1, logits);
+  }
+}
+
+LocalModel::CacheSlot &LocalModel::pick_slot(const std::vector<std::int32_t> &prompt,
+                                             std::size_t &reuse) {
+  CacheSlot *best = nullptr;
+  std::size_t best_common = 0;
+  CacheSlot *oldest = nullptr;
+  for (auto &slot : slots_) {
+    const auto mismatch = std::mismatch(slot.tokens.begin(), slot.tokens.end(), prompt.begin(),
+                                        prompt.end());
+    const auto common = static_cast<std::size_t>(mismatch.first - slot.tokens.begin());
+    // Ties go to the older slot so the newer one survives if the winner gets truncated.
+    if (best == nullptr || common > best_common ||
+        (common == best_common && slot.last_used < best->last_used)) {
+      best = &slot;
+      best_common = common;
+    }
+    if (oldest == nullptr || slot.last_used < oldest->last_used) {
+      oldest = &slot;
+    }
+  }
+  // At least one token must be evaluated to get logits for the next one.
+  reuse = std::min(best_common, prompt.size() - 1);
+
+  CacheSlot *target = best;
+  if (reuse < best->tokens.size() && oldest != best) {
+    // Another conversation that only shares a prefix (say, the system prompt) would throw
+    // away this slot's tail. Evict the oldest slot instead and copy the prefix over.
+    const auto floats = static_cast<std::ptrdiff_t>(reuse * n_head_kv_ * head_dim_);
+    oldest->tokens.assign(best->tokens.begin(),
+                          best->tokens.begin() + static_cast<std::ptrdiff_t>(reuse));
+    for (std::size_t l = 0; l < n_layer_; ++l) {
+      oldest->k[l].assign(best->k[l].begin(), best->k[l].begin() + floats);
+      oldest->v[l].assign(best->v[l].begin(), best->v[l].begin() + floats);
+    }
+    target = oldest;
+  }
+  target->tokens.resize(reuse);
+  target->last_used = ++use_clock_;
+  return *target;
+}
+
+std::size_t LocalModel::prompt_budget(const LocalGenerateOptions &options) const {
+  const std::size_t reserve = std::min<std::size_t>(std::max<std::uint32_t>(1, options.max_tokens),
+                                                    context_length_ / 4);
+  return context_length_ - reserve;
+}
+
+common::Result<std::string> LocalModel::generate(const std::string &prompt,
+                                                 const LocalGenerateOptions &options,
+                                                 const std::function<bool(std::string_view)> &on_text,
+                                                 LocalGenerateStats *stats) {
+  auto tokens = tokenizer_.encode(prompt, true);
+  const bool has_bos = tokenizer_.add_bos();
+  if (has_bos && (tokens.empty() || tokens.front() != tokenizer_.bos())) {
+    tokens.insert(tokens.begin(), tokenizer_.bos());
+  }
+  // Keep room to answer: drop the oldest prompt tokens (after BOS) when the context is short.
+  const std::size_t budget = prompt_budget(options);
+  if (tokens.size() > budget) {
+    const std::size_t drop = tokens.size() - budget;
+    const auto first = tokens.begin() + (has_bos ? 1 : 0);
+    tokens.erase(first, first + static_cast<std::ptrdiff_t>(drop));
+  }
+  return generate_tokens(std::move(tokens), options, on_text, stats);
+}
+
+common::Result<std::string> LocalModel::chat(const std::optional<std::string> &system_prompt,
+                                             const std::string &message,
+                                             const LocalGenerateOptions &options,
+                                             const std::function<bool(std::string_view)> &on_text,
+                                             LocalGenerateStats *stats) {
+  return generate_tokens(encode_chat(system_prompt, message, prompt_budget(options)), options,
+                         on_text, stats);
+}
+
+common::Result<std::string>
+LocalModel::generate_tokens(std::vector<std::int32_t> tokens, const LocalGenerateOptions &options,
+                            const std::function<bool(std::string_view)> &on_text,
+                            LocalGenerateStats *stats) {
+  if (tokens.empty()) {
+    return common::Result<std::string>::failure("empty prompt");
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::size_t reuse = 0;
+  CacheSlot &slot = pick_slot(tokens, reuse);
+  if (stats != nullptr) {
+    *stats = LocalGenerateStats{.prompt_tokens = tokens.size(), .reused_tokens = reuse};
+  }
+
+  std::vector<float> logits(n_vocab_);
+  for (std::size_t pos = reuse; pos < tokens.size(); pos += kPrefillBatch) {
+    const std::size_t count = std::min(kPrefillBatch, tokens.size() - pos);
+    const bool last = pos + count == tokens.size();
+    forward(tokens.data() + pos, count, pos, slot, last ? logits.data() : nullptr);
+    slot.tokens.insert(slot.tokens.end(), tokens.begin() + static_cast<std::ptrdiff_t>(pos),
+                       tokens.begin() + static_cast<std::ptrdiff_t>(pos + count));
+    if (!last && on_text && !on_text({})) {
+      return common::Result<std::string>::success("");
+    }
+  }
+
+  std::mt19937_64 rng(options.seed != 0 ? options.seed : std::random_device{}());
+  std::string output;
+  std::string pending;
+  for (std::uint32_t produced = 0;
+       produced < options.max_tokens && slot.tokens.size() < context_length_; ++produced) {
+    const std::int32_t next = sample(logits, options, rng);
+    if (next == tokenizer_.eos() || tokenizer_.is_control(next)) {
+      break;
+    }
+    if (stats != nullptr) {
+      ++stats->generated_tokens;
+    }
+    pending += tokenizer_.decode(next);
+    if (output.empty()) {
+      // SentencePiece pieces start with their word's space; drop it at the start of a reply.
+      pending.erase(0, pending.find_first_not_of(' ') == std::string::npos
+                           ? pending.size()
+                           : pending.find_first_not_of(' '));
+    }
+    const std::size_t complete = utf8_complete_prefix(pending);
+    const std::string_view ready(pending.data(), complete);
+    output.append(ready);
+    const bool keep_going = !on_text || on_text(ready);
+    pending.erase(0, complete);
+    if (!keep_going) {
+      return common::Result<std::string>::success(std::move(output));
+    }
+    forward(&next, 1, slot.tokens.size(), slot, logits.data());
+    slot.tokens.push_back(next);
+  }
+  if (!pending.empty()) {
+    output += pending;
+    if (on_text) (void)on_text(pending);
+  }
+  return common::Result<std::string>::success(std::move(output));
+}
+
+} // namespace ghostclaw::providers
@@ -1,5 +1,9 @@
 #include "ghostclaw/providers/reliable.hpp"
 
+#include "ghostclaw/common/cancel.hpp"
+#include "ghostclaw/providers/admission.hpp"
+#include "ghostclaw/providers/batch.hpp"
+
 #include <chrono>
 #include <thread>
 
@@ -23,6 +27,12 @@ ReliableProvider::execute_with_provider(const std::shared_ptr<Provider> &provide
                                         const std::string &message, const std::string &model,
                                         const double temperature) const {
   std::string last_error;
+  const auto cancel = common::current_cancel_token();
+
+  const Provider *upstream = provider.get();
+  if (const auto *batched = dynamic_cast<const BatchedProvider *>(upstream); batched != nullptr) {
+    upstream = batched->inner().get();
+  }
 
   for (std::uint32_t attempt = 0; attempt <= max_retries_; ++attempt) {
     auto result = provider->chat_with_system(system_prompt, message, model, temperature);
@@ -31,9 +41,24 @@ ReliableProvider::execute_with_provider(const std::shared_ptr<Provider> &provide
     }
 
     last_error = result.error();
+    if (common::is_cancelled(cancel)) {
+      break;
+    }
     if (attempt < max_retries_) {
-      const std::uint64_t delay = backoff_ms_ * (1ULL << attempt);
-      std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+      if (is_rate_limit_error(last_error) &&
+          dynamic_cast<const AdmittedProvider *>(upstream) != nullptr &&
+          AdmissionController::shared().config().enabled) {
+        // The admission queue holds the retry until the provider's cool-down is over.
+        continue;
+      }
+      const auto delay = std::chrono::milliseconds(backoff_ms_ * (1ULL << attempt));
+      if (cancel != nullptr) {
+        if (cancel->wait_for(delay)) {
+          break;
+        }
+      } else {
+        std::this_thread::sleep_for(delay);
+      }
     }
   }
 
@@ -51,6 +76,9 @@ ReliableProvider::chat_with_system(const std::optional<std::string> &system_prom
 
   std::string last_error = result.error();
   for (const auto &fallback : fallbacks_) {
+    if (common::is_cancelled(common::current_cancel_token())) {
+      break;
+    }
     result = execute_with_provider(fallback, system_prompt, message, model, temperature);
     if (result.ok()) {
       return result;
@@ -0,0 +1,189 @@
+#include "ghostclaw/providers/router.hpp"
+
+#include "ghostclaw/common/fs.hpp"
+#include "ghostclaw/providers/factory.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <vector>
+
+namespace ghostclaw::providers {
+
+namespace {
+
+// Whole messages a small model answers as well as a large one.
+constexpr std::array<std::string_view, 24> kTrivialMessages = {
+    "ok",        "okay",        "k",           "thanks",    "thank you", "thx",
+    "ty",        "yes",         "no",          "yep",       "nope",      "sure",
+    "cool",      "great",       "nice",        "hi",        "hello",     "hey",
+    "got it",    "sounds good", "good morning", "good night", "ping",     "heartbeat"};
+
+// Words that usually mean the turn needs a tool.
+constexpr std::array<std::string_view, 22> kToolWords = {
+    "run",    "execute", "file",   "files",  "read",     "write",   "edit",    "search",
+    "fetch",  "open",    "download", "install", "create", "delete", "schedule", "remind",
+    "email",  "send",    "browse", "commit", "deploy",  "http"};
+
+// Words that usually mean the turn needs reasoning.
+constexpr std::array<std::string_view, 14> kReasoningWords = {
+    "why",    "explain", "analyze",  "analyse",   "compare", "design", "debug",
+    "plan",   "refactor", "prove",   "implement", "code",    "review", "summarize"};
+
+constexpr std::array<std::string_view, 7> kUnsureReplies = {
+    "i'm not sure", "i am not sure", "i don't know", "i do not know",
+    "i can't help", "i cannot help", "as an ai"};
+
+std::vector<std::string> words(const std::string &lowered) {
+  std::vector<std::string> out;
+  std::string current;
+  for (const char ch : lowered) {
+    if (std::isalnum(static_cast<unsigned char>(ch)) != 0 || ch == '\'') {
+      current.push_back(ch);
+    } else if (!current.empty()) {
+      out.push_back(std::move(current));
+      current.clear();
+    }
+  }
+  if (!current.empty()) {
+    out.push_back(std::move(current));
+  }
+  return out;
+}
+
+template <std::size_t N>
+bool contains_any(const std::vector<std::string> &tokens,
+                  const std::array<std::string_view, N> &needles) {
+  return std::any_of(tokens.begin(), tokens.end(), [&](const std::string &token) {
+    return std::find(needles.begin(), needles.end(), token) != needles.end();
+  });
+}
+
+} // namespace
+
+ModelRouter::ModelRouter(config::RouterConfig config, std::shared_ptr<Provider> fast)
+    : config_(std::move(config)), fast_(std::move(fast)) {}
+
+RouteDecision ModelRouter::score(const std::string_view message) const {
+  const std::string text = common::to_lower(common::trim(std::string(message)));
+  if (text.size() > config_.max_fast_chars) {
+    return {.tier = RouteTier::Strong, .confidence = 1.0, .reason = "long message"};
+  }
+  if (text.find("```") != std::string::npos ||
+      std::count(text.begin(), text.end(), '\n') > 2) {
+    return {.tier = RouteTier::Strong, .confidence = 0.9, .reason = "structured input"};
+  }
+
+  const auto tokens = words(text);
+  std::string joined;
+  for (const auto &token : tokens) {
+    joined += (joined.empty() ? "" : " ") + token;
+  }
+  if (std::find(kTrivialMessages.begin(), kTrivialMessages.end(), joined) !=
+      kTrivialMessages.end()) {
+    return {.tier = RouteTier::Fast, .confidence = 0.95, .reason = "acknowledgement"};
+  }
+  if (contains_any(tokens, kToolWords) || text.find('/') != std::string::npos) {
+    return {.tier = RouteTier::Strong, .confidence = 0.8, .reason = "tool use likely"};
+  }
+  if (contains_any(tokens, kReasoningWords)) {
+    return {.tier = RouteTier::Strong, .confidence = 0.7, .reason = "reasoning requested"};
+  }
+
+  // Short plain questions lean fast; confidence falls as the message grows.
+  const double fill = static_cast<double>(text.size()) /
+                      static_cast<double>(std::max<std::size_t>(1, config_.max_fast_chars));
+  const double confidence = 0.9 - 0.4 * fill;
+  return {.tier = confidence >= config_.min_confidence ? RouteTier::Fast : RouteTier::Strong,
+          .confidence = confidence,
+          .reason = "short message"};
+}
+
+std::optional<RouteTier> ModelRouter::classify(const std::string_view message) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.classifier_calls;
+  }
+  auto reply = fast_->chat_with_system(
+      "Decide whether a small model can answer the user's message directly, without tools "
+      "or multi-step reasoning. Reply with exactly one word: SIMPLE or COMPLEX.",
+      std::string(message), config_.fast_model, 0.0);
+  if (!reply.ok()) {
+    return std::nullopt;
+  }
+  const std::string verdict = common::to_lower(reply.value());
+  if (verdict.find("simple") != std::string::npos) {
+    return RouteTier::Fast;
+  }
+  if (verdict.find("complex") != std::string::npos) {
+    return RouteTier::Strong;
+  }
+  return std::nullopt;
+}
+
+RouteDecision ModelRouter::route(const RouteSignals &signals) {
+  if (signals.pinned) {
+    return {.tier = RouteTier::Strong, .confidence = 1.0, .reason = "model pinned"};
+  }
+  if (signals.skill_match) {
+    return {.tier = RouteTier::Strong, .confidence = 0.9, .reason = "skill matched"};
+  }
+  auto decision = score(signals.message);
+  if (config_.classifier && decision.reason == "short message" &&
+      decision.confidence < config_.min_confidence + 0.15) {
+    if (const auto verdict = classify(signals.message); verdict.has_value()) {
+      decision.tier = *verdict;
+      decision.reason = "classifier";
+    }
+  }
+  return decision;
+}
+
+bool ModelRouter::should_escalate(const std::string &reply) {
+  const std::string text = common::to_lower(common::trim(reply));
+  if (text.empty()) {
+    return true;
+  }
+  return std::any_of(kUnsureReplies.begin(), kUnsureReplies.end(), [&](const std::string_view phrase) {
+    return text.find(phrase) != std::string::npos;
+  });
+}
+
+void ModelRouter::record(const RouteTier served, const bool escalated,
+                         const std::chrono::milliseconds latency, const TokenUsage &usage) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto ms = static_cast<std::uint64_t>(latency.count());
+  if (served == RouteTier::Fast) {
+    ++stats_.fast_turns;
+    stats_.fast_latency_ms += ms;
+    stats_.fast_usage += usage;
+  } else {
+    ++stats_.strong_turns;
+    stats_.strong_latency_ms += ms;
+    stats_.strong_usage += usage;
+  }
+  if (escalated) {
+    ++stats_.escalations;
+  }
+}
+
+RouterStats ModelRouter::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+common::Result<std::shared_ptr<ModelRouter>>
+create_model_router(const config::Config &config, std::shared_ptr<HttpClient> http_client) {
+  if (!config.router.enabled) {
+    return common::Result<std::shared_ptr<ModelRouter>>::success(nullptr);
+  }
+  auto fast = create_provider(config.router.fast_provider, std::nullopt, std::move(http_client));
+  if (!fast.ok()) {
+    return common::Result<std::shared_ptr<ModelRouter>>::failure("router fast_provider: " +
+                                                                 fast.error());
+  }
+  return common::Result<std::shared_ptr<ModelRouter>>::success(
+      std::make_shared<ModelRouter>(config.router, fast.value()));
+}
+
+} // namespace ghostclaw::providers
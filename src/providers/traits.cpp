@@ -1,9 +1,12 @@
 #include "ghostclaw/providers/traits.hpp"
 
+#include "ghostclaw/common/cancel.hpp"
 #include "ghostclaw/common/fs.hpp"
+#include "ghostclaw/common/json_util.hpp"
 
 #include <curl/curl.h>
 
+#include <cctype>
 #include <regex>
 #include <sstream>
 
@@ -11,6 +14,8 @@ namespace ghostclaw::providers {
 
 namespace {
 
+thread_local ScopedUsageCapture *tls_usage_capture = nullptr;
+
 size_t write_callback(char *ptr, size_t size, size_t nmemb, void *userdata) {
   const auto total = size * nmemb;
   auto *output = static_cast<std::string *>(userdata);
@@ -50,6 +55,79 @@ size_t header_callback(char *buffer, size_t size, size_t nitems, void *userdata)
   return total;
 }
 
+int cancel_progress_callback(void *userdata, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+  const auto *token = static_cast<const common::CancelToken *>(userdata);
+  return token->is_cancelled() ? 1 : 0;
+}
+
+// Without a cancel token this is a plain blocking perform. With one, the transfer is
+// driven through a multi handle so cancel() can wake curl_multi_poll immediately; the
+// progress callback then aborts the transfer instead of waiting for the next byte.
+CURLcode perform_cancellable(CURL *curl, const std::shared_ptr<common::CancelToken> &token) {
+  if (token == nullptr) {
+    return curl_easy_perform(curl);
+  }
+  if (token->is_cancelled()) {
+    return CURLE_ABORTED_BY_CALLBACK;
+  }
+
+  curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, cancel_progress_callback);
+  curl_easy_setopt(curl, CURLOPT_XFERINFODATA, token.get());
+  curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+
+  CURLM *multi = curl_multi_init();
+  if (multi == nullptr) {
+    return curl_easy_perform(curl);
+  }
+  curl_multi_add_handle(multi, curl);
+
+  CURLcode result = CURLE_OK;
+  {
+    common::CancelSubscription wake(token, [multi]() { curl_multi_wakeup(multi); });
+    int running = 1;
+    while (running > 0) {
+      if (token->is_cancelled()) {
+        result = CURLE_ABORTED_BY_CALLBACK;
+        break;
+      }
+      if (curl_multi_perform(multi, &running) != CURLM_OK) {
+        result = CURLE_FAILED_INIT;
+        break;
+      }
+      if (running > 0 && curl_multi_poll(multi, nullptr, 0, 1000, nullptr) != CURLM_OK) {
+        result = CURLE_FAILED_INIT;
+        break;
+      }
+    }
+    int pending = 0;
+    while (CURLMsg *message = curl_multi_info_read(multi, &pending)) {
+      if (message->msg == CURLMSG_DONE && message->easy_handle == curl) {
+        result = message->data.result;
+      }
+    }
+  }
+
+  curl_multi_remove_handle(multi, curl);
+  curl_multi_cleanup(multi);
+  return result;
+}
+
+void perform_transfer(CURL *curl, HttpResponse &response) {
+  const auto token = common::current_cancel_token();
+  const CURLcode code = perform_cancellable(curl, token);
+  if (code != CURLE_OK) {
+    response.network_error = true;
+    response.cancelled = common::is_cancelled(token);
+    response.network_error_message =
+        response.cancelled ? "request cancelled" : curl_easy_strerror(code);
+    response.timeout = code == CURLE_OPERATION_TIMEDOUT;
+  } else {
+    long status = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    response.status = static_cast<std::uint16_t>(status);
+  }
+}
+
 HttpResponse execute_request(const std::string &url,
                              const std::unordered_map<std::string, std::string> &headers,
                              const std::optional<std::string> &body, const bool use_head,
@@ -93,16 +171,7 @@ HttpResponse execute_request(const std::string &url,
       curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header_list);
     }
 
-    const CURLcode code = curl_easy_perform(curl);
-    if (code != CURLE_OK) {
-      response.network_error = true;
-      response.network_error_message = curl_easy_strerror(code);
-      response.timeout = code == CURLE_OPERATION_TIMEDOUT;
-    } else {
-      long status = 0;
-      curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
-      response.status = static_cast<std::uint16_t>(status);
-    }
+    perform_transfer(curl, response);
 
     if (header_list != nullptr) {
       curl_slist_free_all(header_list);
@@ -136,16 +205,7 @@ HttpResponse execute_request(const std::string &url,
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header_list);
   }
 
-  const CURLcode code = curl_easy_perform(curl);
-  if (code != CURLE_OK) {
-    response.network_error = true;
-    response.network_error_message = curl_easy_strerror(code);
-    response.timeout = code == CURLE_OPERATION_TIMEDOUT;
-  } else {
-    long status = 0;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
-    response.status = static_cast<std::uint16_t>(status);
-  }
+  perform_transfer(curl, response);
 
   if (header_list != nullptr) {
     curl_slist_free_all(header_list);
@@ -322,8 +382,62 @@ std::vector<std::string> extract_sse_data_events(const std::string &response) {
   return events;
 }
 
+std::uint64_t usage_number(const std::string &json, const std::string &field) {
+  const std::string value = common::json_get_number(json, field);
+  if (value.empty()) {
+    return 0;
+  }
+  try {
+    return static_cast<std::uint64_t>(std::stoull(value));
+  } catch (...) {
+    return 0;
+  }
+}
+
 } // namespace
 
+TokenUsage &TokenUsage::operator+=(const TokenUsage &other) {
+  prompt_tokens += other.prompt_tokens;
+  completion_tokens += other.completion_tokens;
+  cached_prompt_tokens += other.cached_prompt_tokens;
+  return *this;
+}
+
+ScopedUsageCapture::ScopedUsageCapture() : previous_(tls_usage_capture) {
+  tls_usage_capture = this;
+}
+
+ScopedUsageCapture::~ScopedUsageCapture() {
+  tls_usage_capture = previous_;
+  if (previous_ != nullptr) {
+    // Nested captures still count towards the enclosing one.
+    previous_->usage_ += usage_;
+  }
+}
+
+void report_usage(const TokenUsage &usage) {
+  if (tls_usage_capture != nullptr) {
+    tls_usage_capture->usage_ += usage;
+  }
+}
+
+std::vector<std::string_view> split_stream_chunks(const std::string_view text) {
+  std::vector<std::string_view> chunks;
+  std::size_t start = 0;
+  while (start < text.size()) {
+    std::size_t pos = start;
+    while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos])) == 0) {
+      ++pos;
+    }
+    while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos])) != 0) {
+      ++pos;
+    }
+    chunks.push_back(text.substr(start, pos - start));
+    start = pos;
+  }
+  return chunks;
+}
+
 std::string ProviderError::to_string() const {
   std::ostringstream stream;
   stream << "Provider error [";
@@ -385,6 +499,20 @@ HttpResponse CurlHttpClient::head(const std::string &url,
   return execute_request(url, headers, std::nullopt, true, timeout_ms);
 }
 
+HttpResponse CurlHttpClient::get(const std::string &url,
+                                 const std::unordered_map<std::string, std::string> &headers,
+                                 const std::uint64_t timeout_ms) {
+  return execute_request(url, headers, std::nullopt, false, timeout_ms);
+}
+
+HttpResponse HttpClient::get(const std::string &, const std::unordered_map<std::string, std::string> &,
+                             std::uint64_t) {
+  HttpResponse response;
+  response.network_error = true;
+  response.network_error_message = "GET is not supported by this HTTP client";
+  return response;
+}
+
 std::string json_escape(const std::string &value) {
   std::string escaped;
   escaped.reserve(value.size() + 8);
@@ -524,4 +652,75 @@ common::Result<std::string> parse_anthropic_sse_content(const std::string &respo
   return common::Result<std::string>::success(content);
 }
 
+std::optional<TokenUsage> parse_openai_usage(const std::string &response) {
+  const std::string usage = common::json_get_object(response, "usage");
+  if (usage.empty()) {
+    return std::nullopt;
+  }
+  TokenUsage out;
+  out.prompt_tokens = usage_number(usage, "prompt_tokens");
+  out.completion_tokens = usage_number(usage, "completion_tokens");
+  const std::string details = common::json_get_object(usage, "prompt_tokens_details");
+  if (!details.empty()) {
+    out.cached_prompt_tokens = usage_number(details, "cached_tokens");
+  }
+  return out;
+}
+
+std::optional<TokenUsage> parse_openai_sse_usage(const std::string &response) {
+  // Only the final chunk carries usage, and only when stream_options.include_usage is set.
+  std::optional<TokenUsage> out;
+  for (const auto &event_data : extract_sse_data_events(response)) {
+    if (auto usage = parse_openai_usage(event_data); usage.has_value() && !usage->empty()) {
+      out = usage;
+    }
+  }
+  return out;
+}
+
+std::optional<TokenUsage> parse_anthropic_usage(const std::string &response) {
+  const std::string usage = common::json_get_object(response, "usage");
+  if (usage.empty()) {
+    return std::nullopt;
+  }
+  // input_tokens excludes cache reads and writes; fold them in so prompt_tokens means the
+  // same thing for every provider.
+  TokenUsage out;
+  out.cached_prompt_tokens = usage_number(usage, "cache_read_input_tokens");
+  out.prompt_tokens = usage_number(usage, "input_tokens") + out.cached_prompt_tokens +
+                      usage_number(usage, "cache_creation_input_tokens");
+  out.completion_tokens = usage_number(usage, "output_tokens");
+  return out;
+}
+
+std::optional<TokenUsage> parse_anthropic_sse_event_usage(const std::string &event_data) {
+  if (event_data.find("\"message_start\"") == std::string::npos &&
+      event_data.find("\"message_delta\"") == std::string::npos) {
+    return std::nullopt;
+  }
+  return parse_anthropic_usage(event_data);
+}
+
+std::optional<TokenUsage> parse_anthropic_sse_usage(const std::string &response) {
+  // message_start reports the prompt side; message_delta reports cumulative output tokens.
+  std::optional<TokenUsage> out;
+  for (const auto &event_data : extract_sse_data_events(response)) {
+    const auto usage = parse_anthropic_sse_event_usage(event_data);
+    if (!usage.has_value()) {
+      continue;
+    }
+    if (!out.has_value()) {
+      out = TokenUsage{};
+    }
+    if (usage->prompt_tokens > 0) {
+      out->prompt_tokens = usage->prompt_tokens;
+      out->cached_prompt_tokens = usage->cached_prompt_tokens;
+    }
+    if (usage->completion_tokens > 0) {
+      out->completion_tokens = usage->completion_tokens;
+    }
+  }
+  return out;
+}
+
 } // namespace ghostclaw::providers
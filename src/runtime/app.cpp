@@ -4,7 +4,11 @@
 #include "ghostclaw/memory/memory.hpp"
 #include "ghostclaw/observability/factory.hpp"
 #include "ghostclaw/observability/global.hpp"
+#include "ghostclaw/providers/admission.hpp"
+#include "ghostclaw/providers/batch.hpp"
 #include "ghostclaw/providers/factory.hpp"
+#include "ghostclaw/providers/local.hpp"
+#include "ghostclaw/providers/router.hpp"
 #include "ghostclaw/security/policy.hpp"
 #include "ghostclaw/tools/tool_registry.hpp"
 
@@ -32,11 +36,18 @@ common::Result<std::shared_ptr<agent::AgentEngine>> RuntimeContext::create_agent
     return common::Result<std::shared_ptr<agent::AgentEngine>>::failure(workspace.error());
   }
 
+  providers::AdmissionController::shared().configure(config_.admission);
+  providers::BatchLane::shared().configure(config_.batch);
+  providers::LocalModelCache::shared().configure(config_.local_model);
   auto provider = providers::create_reliable_provider(
       config_.default_provider, config_.api_key, config_.reliability);
   if (!provider.ok()) {
     return common::Result<std::shared_ptr<agent::AgentEngine>>::failure(provider.error());
   }
+  auto router = providers::create_model_router(config_);
+  if (!router.ok()) {
+    return common::Result<std::shared_ptr<agent::AgentEngine>>::failure(router.error());
+  }
 
   auto memory = memory::create_memory(config_, workspace.value());
   if (memory == nullptr) {
@@ -54,6 +65,7 @@ common::Result<std::shared_ptr<agent::AgentEngine>> RuntimeContext::create_agent
 
   auto engine = std::make_shared<agent::AgentEngine>(
       config_, provider.value(), std::move(memory), std::move(registry), workspace.value());
+  engine->set_model_router(router.value());
 
   return common::Result<std::shared_ptr<agent::AgentEngine>>::success(std::move(engine));
 }
@@ -390,6 +390,8 @@ void ApprovalSocketServer::stop() {
   }
 
   if (listen_fd_ >= 0) {
+    // close() alone does not wake a thread blocked in accept() on Linux.
+    ::shutdown(listen_fd_, SHUT_RDWR);
     close(listen_fd_);
     listen_fd_ = -1;
   }
@@ -487,22 +489,30 @@ bool ApprovalManager::needs_approval(const ApprovalRequest &request) const {
   return !allowlisted;
 }
 
-common::Result<ApprovalDecision> ApprovalManager::authorize(const ApprovalRequest &request) {
+std::optional<ApprovalDecision>
+ApprovalManager::decide_without_prompt(const ApprovalRequest &request) const {
   const bool allowlisted = is_allowlisted(request.command);
 
   if (policy_.security == ExecSecurity::Deny) {
-    return common::Result<ApprovalDecision>::success(ApprovalDecision::Deny);
+    return ApprovalDecision::Deny;
   }
 
   if (policy_.security == ExecSecurity::Allowlist && !allowlisted && policy_.ask == ExecAsk::Off) {
-    return common::Result<ApprovalDecision>::success(ApprovalDecision::Deny);
+    return ApprovalDecision::Deny;
   }
 
   if (!needs_approval(request)) {
     if (policy_.security == ExecSecurity::Allowlist && !allowlisted) {
-      return common::Result<ApprovalDecision>::success(ApprovalDecision::Deny);
+      return ApprovalDecision::Deny;
     }
-    return common::Result<ApprovalDecision>::success(ApprovalDecision::AllowOnce);
+    return ApprovalDecision::AllowOnce;
+  }
+  return std::nullopt;
+}
+
+common::Result<ApprovalDecision> ApprovalManager::authorize(const ApprovalRequest &request) {
+  if (const auto decided = decide_without_prompt(request); decided.has_value()) {
+    return common::Result<ApprovalDecision>::success(*decided);
   }
 
   auto decision = client_.request(request);
@@ -510,12 +520,15 @@ common::Result<ApprovalDecision> ApprovalManager::authorize(const ApprovalReques
     return common::Result<ApprovalDecision>::success(fail_safe_decision());
   }
 
-  if (decision.value() == ApprovalDecision::AllowAlways) {
-    store_.add(request.command);
+  record_decision(request.command, decision.value());
+  return decision;
+}
+
+void ApprovalManager::record_decision(const std::string &command, const ApprovalDecision decision) {
+  if (decision == ApprovalDecision::AllowAlways) {
+    store_.add(command);
     (void)store_.save();
   }
-
-  return decision;
 }
 
 bool ApprovalManager::matches_allowlist(const std::string &command,
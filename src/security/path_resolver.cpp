@@ -0,0 +1,251 @@
+#include "ghostclaw/security/path_resolver.hpp"
+
+#include "ghostclaw/common/fs.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#if defined(__linux__) && __has_include(<linux/openat2.h>)
+#include <linux/openat2.h>
+#include <sys/syscall.h>
+#if defined(SYS_openat2)
+#define GHOSTCLAW_HAVE_OPENAT2 1
+#endif
+#endif
+
+namespace ghostclaw::security {
+
+namespace {
+
+constexpr std::size_t kMaxRoots = 64;
+
+// Opens each component with O_NOFOLLOW and refuses "..", so nothing resolves outside
+// `root`. With `create_dirs`, missing directories (the leaf too, for O_DIRECTORY) are made.
+int walk_beneath(const int root, const std::filesystem::path &relative, const int flags,
+                 const mode_t mode, const bool create_dirs) {
+  std::vector<std::string> parts;
+  for (const auto &part : relative) {
+    const auto name = part.string();
+    if (name.empty() || name == ".") {
+      continue;
+    }
+    if (name == "..") {
+      errno = EXDEV;
+      return -1;
+    }
+    parts.push_back(name);
+  }
+  if (parts.empty()) {
+    return ::openat(root, ".", flags, mode);
+  }
+
+  int dir = root;
+  const auto close_dir = [&dir, root]() {
+    if (dir != root) {
+      const int saved = errno;
+      ::close(dir);
+      errno = saved;
+    }
+  };
+  for (std::size_t i = 0; i + 1 < parts.size(); ++i) {
+    int next = ::openat(dir, parts[i].c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (next < 0 && errno == ENOENT && create_dirs) {
+      if (::mkdirat(dir, parts[i].c_str(), 0777) != 0 && errno != EEXIST) {
+        close_dir();
+        return -1;
+      }
+      next = ::openat(dir, parts[i].c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    }
+    close_dir();
+    if (next < 0) {
+      return -1;
+    }
+    dir = next;
+  }
+  const char *leaf = parts.back().c_str();
+  int fd = ::openat(dir, leaf, flags | O_NOFOLLOW, mode);
+  if (fd < 0 && errno == ENOENT && create_dirs && (flags & O_DIRECTORY) != 0) {
+    if (::mkdirat(dir, leaf, 0777) == 0 || errno == EEXIST) {
+      fd = ::openat(dir, leaf, flags | O_NOFOLLOW, mode);
+    }
+  }
+  close_dir();
+  return fd;
+}
+
+int open_beneath(const int root, const std::filesystem::path &relative, const int flags,
+                 const mode_t mode) {
+#if defined(GHOSTCLAW_HAVE_OPENAT2)
+  open_how how{};
+  how.flags = static_cast<std::uint64_t>(flags);
+  how.mode = (flags & O_CREAT) != 0 ? mode : 0;
+  how.resolve = RESOLVE_BENEATH | RESOLVE_NO_SYMLINKS;
+  const long fd = ::syscall(SYS_openat2, root, relative.c_str(), &how, sizeof(how));
+  // ENOSYS before Linux 5.6; EPERM where a seccomp filter does not know the syscall.
+  if (fd >= 0 || (errno != ENOSYS && errno != EPERM)) {
+    return static_cast<int>(fd);
+  }
+#endif
+  return walk_beneath(root, relative, flags, mode, false);
+}
+
+common::Result<int> open_result(const int fd, const std::filesystem::path &shown) {
+  if (fd >= 0) {
+    return common::Result<int>::success(fd);
+  }
+  if (errno == ELOOP) {
+    return common::Result<int>::failure("Symlinks are not followed inside the workspace: " +
+                                        shown.string());
+  }
+  if (errno == EXDEV) {
+    return common::Result<int>::failure("Path escapes workspace");
+  }
+  return common::Result<int>::failure("Failed to open " + shown.string() + ": " +
+                                      std::strerror(errno));
+}
+
+} // namespace
+
+WorkspaceRoot::WorkspaceRoot(std::filesystem::path canonical, const int fd)
+    : path_(std::move(canonical)), fd_(fd) {}
+
+WorkspaceRoot::~WorkspaceRoot() {
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+}
+
+common::Result<ResolvedPath> WorkspaceRoot::resolve(const std::string &path,
+                                                    const SecurityPolicy &policy) const {
+  using R = common::Result<ResolvedPath>;
+  if (path.find('\0') != std::string::npos) {
+    return R::failure("Path contains null byte");
+  }
+
+  // expand_path runs a regex; most arguments have nothing to expand.
+  std::filesystem::path expanded(path.find_first_of("~$") == std::string::npos
+                                     ? path
+                                     : common::expand_path(path));
+  if (expanded.empty()) {
+    expanded = ".";
+  }
+  const auto lexical = (expanded.is_relative() ? path_ / expanded : expanded).lexically_normal();
+  if (common::is_subpath(lexical, path_)) {
+    return R::success(ResolvedPath{.absolute = lexical, .relative = lexical.lexically_relative(path_)});
+  }
+
+  // Lexically outside: it may still reach the workspace through a symlinked prefix, or be
+  // an outside path the policy permits.
+  auto validated = validate_path(path, policy, path_);
+  if (!validated.ok()) {
+    return R::failure(validated.error());
+  }
+  if (common::is_subpath(validated.value(), path_)) {
+    return R::success(ResolvedPath{.absolute = validated.value(),
+                                   .relative = validated.value().lexically_relative(path_)});
+  }
+  return R::success(ResolvedPath{.absolute = validated.value(), .relative = {}});
+}
+
+common::Result<int> WorkspaceRoot::open(const ResolvedPath &path, const int flags,
+                                        const mode_t mode) const {
+  if (!path.beneath_root()) {
+    return open_result(::open(path.absolute.c_str(), flags | O_CLOEXEC, mode), path.absolute);
+  }
+  return open_result(open_beneath(fd_, path.relative, flags | O_CLOEXEC, mode), path.relative);
+}
+
+common::Result<int> WorkspaceRoot::open_parent(const ResolvedPath &path, const bool create) const {
+  constexpr int kDirFlags = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+  if (!path.beneath_root()) {
+    const auto parent = path.absolute.parent_path();
+    if (create) {
+      std::error_code ec;
+      std::filesystem::create_directories(parent, ec);
+    }
+    return open_result(::open(parent.c_str(), kDirFlags), parent);
+  }
+
+  auto parent = path.relative.parent_path();
+  if (parent.empty()) {
+    parent = ".";
+  }
+  int fd = open_beneath(fd_, parent, kDirFlags, 0);
+  if (fd < 0 && errno == ENOENT && create) {
+    fd = walk_beneath(fd_, parent, kDirFlags, 0, true);
+  }
+  return open_result(fd, parent);
+}
+
+common::Result<TempFile> create_temp_file(const int dir_fd, const std::string &name,
+                                          const mode_t mode) {
+  thread_local std::mt19937_64 rng{std::random_device{}()};
+  for (int attempt = 0; attempt < 16; ++attempt) {
+    char suffix[17];
+    std::snprintf(suffix, sizeof(suffix), "%016llx", static_cast<unsigned long long>(rng()));
+    TempFile temp{.fd = -1, .name = name + ".tmp." + suffix};
+    temp.fd = ::openat(dir_fd, temp.name.c_str(),
+                       O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, mode);
+    if (temp.fd >= 0) {
+      return common::Result<TempFile>::success(std::move(temp));
+    }
+    if (errno != EEXIST) {
+      break;
+    }
+  }
+  return common::Result<TempFile>::failure(std::string("Failed to create temporary file: ") +
+                                           std::strerror(errno));
+}
+
+PathResolver &PathResolver::shared() {
+  static PathResolver resolver;
+  return resolver;
+}
+
+common::Result<std::shared_ptr<const WorkspaceRoot>>
+PathResolver::root(const std::filesystem::path &workspace) {
+  using R = common::Result<std::shared_ptr<const WorkspaceRoot>>;
+  if (workspace.empty()) {
+    return R::failure("Workspace path is not set");
+  }
+  const std::string key = workspace.string();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (const auto it = roots_.find(key); it != roots_.end()) {
+    struct stat st {};
+    if (::fstat(it->second->fd(), &st) == 0 && st.st_nlink > 0) {
+      return R::success(it->second);
+    }
+    roots_.erase(it);
+  }
+
+  std::error_code ec;
+  std::filesystem::create_directories(workspace, ec);
+  const auto canonical = std::filesystem::canonical(workspace, ec);
+  if (ec) {
+    return R::failure("Workspace unavailable: " + ec.message());
+  }
+  const int fd = ::open(canonical.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) {
+    return R::failure(std::string("Workspace unavailable: ") + std::strerror(errno));
+  }
+  if (roots_.size() >= kMaxRoots) {
+    roots_.erase(roots_.begin());
+  }
+  auto root = std::make_shared<const WorkspaceRoot>(canonical, fd);
+  roots_[key] = root;
+  return R::success(std::move(root));
+}
+
+void PathResolver::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  roots_.clear();
+}
+
+} // namespace ghostclaw::security
@@ -130,6 +130,18 @@ void SecurityPolicy::record_action() { tracker.record(); }
 
 common::Result<std::filesystem::path> validate_path(const std::string &path,
                                                     const SecurityPolicy &policy) {
+  std::error_code ec;
+  const auto canonical_workspace = std::filesystem::weakly_canonical(policy.workspace_dir, ec);
+  if (ec) {
+    return common::Result<std::filesystem::path>::failure("Workspace canonicalization failed: " +
+                                                           ec.message());
+  }
+  return validate_path(path, policy, canonical_workspace);
+}
+
+common::Result<std::filesystem::path> validate_path(const std::string &path,
+                                                    const SecurityPolicy &policy,
+                                                    const std::filesystem::path &canonical_workspace) {
   if (path.find('\0') != std::string::npos) {
     return common::Result<std::filesystem::path>::failure("Path contains null byte");
   }
@@ -141,7 +153,7 @@ common::Result<std::filesystem::path> validate_path(const std::string &path,
 
   std::filesystem::path candidate = expanded;
   if (expanded.is_relative()) {
-    candidate = policy.workspace_dir / expanded;
+    candidate = canonical_workspace / expanded;
   }
 
   std::error_code ec;
@@ -151,12 +163,6 @@ common::Result<std::filesystem::path> validate_path(const std::string &path,
                                                            ec.message());
   }
 
-  const auto canonical_workspace = std::filesystem::weakly_canonical(policy.workspace_dir, ec);
-  if (ec) {
-    return common::Result<std::filesystem::path>::failure("Workspace canonicalization failed: " +
-                                                           ec.message());
-  }
-
   if (policy.workspace_only && !common::is_subpath(canonical_candidate, canonical_workspace)) {
     return common::Result<std::filesystem::path>::failure("Path escapes workspace");
   }
@@ -350,10 +350,10 @@ std::vector<std::string> ToolPolicyPipeline::expand_group(std::string_view group
   }
 
   static const std::unordered_map<std::string, std::vector<std::string>> groups = {
-      {"group:fs", {"read", "write", "edit"}},
+      {"group:fs", {"read", "write", "edit", "code_search"}},
       {"group:runtime", {"exec", "process"}},
       {"group:memory", {"memory_store", "memory_recall", "memory_forget"}},
-      {"group:sessions", {"sessions", "subagents", "skills"}},
+      {"group:sessions", {"sessions", "subagents", "skills", "tool_output"}},
       {"group:skills", {"skills"}},
       {"group:ui", {"browser", "canvas"}},
       {"group:automation", {"cron", "gateway"}},
@@ -438,7 +438,7 @@ std::string ToolPolicyPipeline::profile_to_string(const ToolProfile profile) {
 ToolPolicy ToolPolicyPipeline::default_profile_policy(const ToolProfile profile) {
   switch (profile) {
   case ToolProfile::Minimal:
-    return ToolPolicy{.allow = {"read"}, .deny = {}};
+    return ToolPolicy{.allow = {"read", "tool_output"}, .deny = {}};
   case ToolProfile::Coding:
     return ToolPolicy{.allow = {"group:fs", "group:runtime", "group:sessions", "group:web"},
                       .deny = {}};
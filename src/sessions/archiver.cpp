@@ -0,0 +1,40 @@
+#include "ghostclaw/sessions/archiver.hpp"
+
+namespace ghostclaw::sessions {
+
+SessionArchiver::SessionArchiver(SessionStore *store, ArchiverOptions options)
+    : store_(store), options_(options) {
+  if (store_ != nullptr && options_.idle_after.count() > 0 && options_.interval.count() > 0) {
+    worker_ = std::thread([this]() { worker_loop(); });
+  }
+}
+
+SessionArchiver::~SessionArchiver() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  stop_cv_.notify_all();
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+
+common::Result<std::size_t> SessionArchiver::run_once() {
+  if (store_ == nullptr) {
+    return common::Result<std::size_t>::failure("session store is not available");
+  }
+  return store_->archive_idle(options_.idle_after);
+}
+
+void SessionArchiver::worker_loop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopping_) {
+    lock.unlock();
+    (void)run_once();
+    lock.lock();
+    stop_cv_.wait_for(lock, options_.interval, [this]() { return stopping_; });
+  }
+}
+
+} // namespace ghostclaw::sessions
@@ -0,0 +1,255 @@
+#include "ghostclaw/sessions/history.hpp"
+
+#include "ghostclaw/common/fs.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+namespace ghostclaw::sessions {
+
+namespace {
+
+constexpr std::size_t kCharsPerToken = 4;
+constexpr std::size_t kSummaryLineTokens = 40;
+
+bool is_conversational(const TranscriptEntry &entry) {
+  return entry.role == TranscriptRole::User || entry.role == TranscriptRole::Assistant;
+}
+
+std::string speaker(const TranscriptEntry &entry) {
+  return entry.role == TranscriptRole::User ? "User" : "Assistant";
+}
+
+// Indices of user/assistant entries not yet covered by the summary. Entry ids are
+// transcript line numbers, so this works on a page as well as the whole transcript.
+std::vector<std::size_t> unsummarised(const SessionState &state,
+                                      const std::vector<TranscriptEntry> &transcript) {
+  std::vector<std::size_t> out;
+  for (std::size_t i = 0; i < transcript.size(); ++i) {
+    if (transcript[i].id > state.summary_through && is_conversational(transcript[i])) {
+      out.push_back(i);
+    }
+  }
+  return out;
+}
+
+// Only the entries after the summary cursor; the folded prefix is never re-read.
+common::Result<TranscriptPage> load_unsummarised(const SessionStore &store,
+                                                 const std::string &session_id,
+                                                 const SessionState &state) {
+  return store.load_transcript_page(session_id,
+                                    TranscriptCursor{.after = state.summary_through, .limit = 0});
+}
+
+} // namespace
+
+std::size_t estimate_tokens(const std::string_view text) {
+  return (text.size() + kCharsPerToken - 1) / kCharsPerToken;
+}
+
+std::string truncate_to_tokens(std::string text, const std::size_t budget) {
+  if (estimate_tokens(text) <= budget) {
+    return text;
+  }
+  std::size_t cut = budget * kCharsPerToken;
+  // Do not split a UTF-8 sequence.
+  while (cut > 0 && (static_cast<unsigned char>(text[cut]) & 0xC0U) == 0x80U) {
+    --cut;
+  }
+  text.resize(cut);
+  text += " [...]";
+  return text;
+}
+
+std::string build_history_context(const SessionState &state,
+                                  const std::vector<TranscriptEntry> &transcript,
+                                  const HistoryOptions &options) {
+  auto pending = unsummarised(state, transcript);
+  const std::size_t cap = options.recent_messages + options.summarize_batch;
+  if (pending.size() > cap) {
+    // The summariser is behind; stay within the size bound and let it catch up.
+    pending.erase(pending.begin(), pending.end() - static_cast<std::ptrdiff_t>(cap));
+  }
+  const std::string summary = common::trim(state.history_summary);
+  if (summary.empty() && pending.empty()) {
+    return "";
+  }
+
+  std::ostringstream out;
+  out << "[Conversation History]\n";
+  if (!summary.empty()) {
+    out << "Summary of earlier conversation:\n" << summary << "\n";
+  }
+  if (!pending.empty()) {
+    out << "Recent messages:\n";
+    for (const auto index : pending) {
+      const auto &entry = transcript[index];
+      out << speaker(entry) << ": "
+          << truncate_to_tokens(entry.content, options.message_token_budget) << "\n";
+    }
+  }
+  out << "[End Conversation History]\n";
+  return out.str();
+}
+
+common::Result<std::string> extractive_summary(const std::string &previous_summary,
+                                               const std::string &new_messages,
+                                               const std::size_t token_budget) {
+  std::vector<std::string> lines;
+  std::istringstream previous(previous_summary);
+  std::string line;
+  while (std::getline(previous, line)) {
+    if (!common::trim(line).empty()) {
+      lines.push_back(line);
+    }
+  }
+  std::istringstream added(new_messages);
+  while (std::getline(added, line)) {
+    line = common::trim(line);
+    if (!line.empty()) {
+      lines.push_back("- " + truncate_to_tokens(line, kSummaryLineTokens));
+    }
+  }
+
+  std::size_t tokens = 0;
+  std::size_t first = lines.size();
+  while (first > 0 && tokens + estimate_tokens(lines[first - 1]) + 1 <= token_budget) {
+    --first;
+    tokens += estimate_tokens(lines[first]) + 1;
+  }
+  std::string out;
+  for (std::size_t i = first; i < lines.size(); ++i) {
+    out += lines[i];
+    out += "\n";
+  }
+  return common::Result<std::string>::success(std::move(out));
+}
+
+SessionHistory::SessionHistory(SessionStore *store, HistorySummarizer summarizer,
+                               HistoryOptions options)
+    : store_(store), summarizer_(std::move(summarizer)), options_(options) {
+  if (!summarizer_) {
+    summarizer_ = extractive_summary;
+  }
+  worker_ = std::thread([this]() { worker_loop(); });
+}
+
+SessionHistory::~SessionHistory() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    queue_.clear();
+    queued_.clear();
+  }
+  cancel_->cancel();
+  work_cv_.notify_all();
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+
+std::string SessionHistory::context_for(const std::string &session_id) const {
+  if (store_ == nullptr || common::trim(session_id).empty()) {
+    return "";
+  }
+  auto state = store_->get_state(session_id);
+  if (!state.ok()) {
+    return "";
+  }
+  auto page = load_unsummarised(*store_, session_id, state.value());
+  if (!page.ok()) {
+    return "";
+  }
+  return build_history_context(state.value(), page.value().entries, options_);
+}
+
+void SessionHistory::schedule_refresh(const std::string &session_id) {
+  if (store_ == nullptr || common::trim(session_id).empty()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!queued_.insert(session_id).second) {
+      return;
+    }
+    queue_.push_back(session_id);
+  }
+  work_cv_.notify_one();
+}
+
+common::Status SessionHistory::refresh(const std::string &session_id) {
+  if (store_ == nullptr) {
+    return common::Status::error("session store unavailable");
+  }
+  auto state = store_->get_state(session_id);
+  if (!state.ok()) {
+    return common::Status::error(state.error());
+  }
+  auto page = load_unsummarised(*store_, session_id, state.value());
+  if (!page.ok()) {
+    return common::Status::error(page.error());
+  }
+  const auto &transcript = page.value().entries;
+
+  const auto pending = unsummarised(state.value(), transcript);
+  if (pending.size() < options_.recent_messages + options_.summarize_batch) {
+    return common::Status::success();
+  }
+  const std::size_t fold = pending.size() - options_.recent_messages;
+  std::ostringstream messages;
+  for (std::size_t i = 0; i < fold; ++i) {
+    const auto &entry = transcript[pending[i]];
+    messages << speaker(entry) << ": "
+             << truncate_to_tokens(entry.content, options_.message_token_budget) << "\n";
+  }
+
+  auto summary =
+      summarizer_(state.value().history_summary, messages.str(), options_.summary_token_budget);
+  if (!summary.ok()) {
+    return common::Status::error(summary.error());
+  }
+  if (common::is_cancelled(common::current_cancel_token())) {
+    return common::Status::error("history refresh cancelled");
+  }
+  return store_->set_history_summary(
+      session_id, truncate_to_tokens(common::trim(summary.value()), options_.summary_token_budget),
+      transcript[pending[fold - 1]].id);
+}
+
+void SessionHistory::flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_cv_.wait(lock, [this]() { return queue_.empty() && !busy_; });
+}
+
+void SessionHistory::worker_loop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    work_cv_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+    if (stopping_) {
+      break;
+    }
+    std::string session_id = std::move(queue_.front());
+    queue_.pop_front();
+    queued_.erase(session_id);
+    busy_ = true;
+    lock.unlock();
+
+    common::Status status = common::Status::success();
+    {
+      common::ScopedCancelToken cancel_scope(cancel_);
+      status = refresh(session_id);
+    }
+    if (!status.ok() && !cancel_->is_cancelled()) {
+      std::cerr << "[sessions] history summary for '" << session_id
+                << "' failed: " << status.error() << "\n";
+    }
+
+    lock.lock();
+    busy_ = false;
+    idle_cv_.notify_all();
+  }
+  idle_cv_.notify_all();
+}
+
+} // namespace ghostclaw::sessions
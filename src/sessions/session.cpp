@@ -20,8 +20,31 @@ std::vector<std::string> find_json_string_array_field(const std::string &json,
   return common::json_get_string_array(json, field);
 }
 
+std::uint64_t find_json_u64_field(const std::string &json, const std::string &field) {
+  const std::string value = common::json_get_number(json, field);
+  if (value.empty()) {
+    return 0;
+  }
+  try {
+    return static_cast<std::uint64_t>(std::stoull(value));
+  } catch (...) {
+    return 0;
+  }
+}
+
 } // namespace
 
+SessionUsage &SessionUsage::operator+=(const SessionUsage &other) {
+  turns += other.turns;
+  prompt_tokens += other.prompt_tokens;
+  completion_tokens += other.completion_tokens;
+  cached_prompt_tokens += other.cached_prompt_tokens;
+  tool_calls += other.tool_calls;
+  tool_ms += other.tool_ms;
+  latency_ms += other.latency_ms;
+  return *this;
+}
+
 std::string encode_session_state_jsonl(const SessionState &state) {
   std::ostringstream out;
   out << "{";
@@ -42,6 +65,18 @@ std::string encode_session_state_jsonl(const SessionState &state) {
     out << "\"" << json_escape(state.subagents[i]) << "\"";
   }
   out << "]";
+  out << ",\"usage\":{";
+  out << "\"turns\":" << state.usage.turns << ",";
+  out << "\"prompt_tokens\":" << state.usage.prompt_tokens << ",";
+  out << "\"completion_tokens\":" << state.usage.completion_tokens << ",";
+  out << "\"cached_prompt_tokens\":" << state.usage.cached_prompt_tokens << ",";
+  out << "\"tool_calls\":" << state.usage.tool_calls << ",";
+  out << "\"tool_ms\":" << state.usage.tool_ms << ",";
+  out << "\"latency_ms\":" << state.usage.latency_ms;
+  out << "}";
+  // Last, so free text in the summary never precedes the keys looked up above.
+  out << ",\"summary_through\":" << state.summary_through;
+  out << ",\"history_summary\":\"" << json_escape(state.history_summary) << "\"";
   out << "}";
   return out.str();
 }
@@ -64,6 +99,18 @@ common::Result<SessionState> parse_session_state_jsonl(const std::string &line)
   state.delivery_context = find_json_string_field(line, "delivery_context");
   state.updated_at = find_json_string_field(line, "updated_at");
   state.subagents = find_json_string_array_field(line, "subagents");
+  const std::string usage = common::json_get_object(line, "usage");
+  if (!usage.empty()) {
+    state.usage.turns = find_json_u64_field(usage, "turns");
+    state.usage.prompt_tokens = find_json_u64_field(usage, "prompt_tokens");
+    state.usage.completion_tokens = find_json_u64_field(usage, "completion_tokens");
+    state.usage.cached_prompt_tokens = find_json_u64_field(usage, "cached_prompt_tokens");
+    state.usage.tool_calls = find_json_u64_field(usage, "tool_calls");
+    state.usage.tool_ms = find_json_u64_field(usage, "tool_ms");
+    state.usage.latency_ms = find_json_u64_field(usage, "latency_ms");
+  }
+  state.summary_through = find_json_u64_field(line, "summary_through");
+  state.history_summary = find_json_string_field(line, "history_summary");
   return common::Result<SessionState>::success(std::move(state));
 }
 
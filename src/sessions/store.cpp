@@ -1,11 +1,25 @@
 #include "ghostclaw/sessions/store.hpp"
 
 #include "ghostclaw/common/fs.hpp"
+#include "ghostclaw/common/json_util.hpp"
 #include "ghostclaw/memory/memory.hpp"
 #include "ghostclaw/sessions/session_key.hpp"
 
 #include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
 #include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <zlib.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace ghostclaw::sessions {
 
@@ -30,6 +44,133 @@ std::string sanitize_session_filename(const std::string &session_id) {
 
 std::string now_timestamp() { return memory::now_rfc3339(); }
 
+// Line indexes kept for paging transcripts; the least recently paged session goes first.
+constexpr std::size_t kMaxTranscriptIndexes = 256;
+
+// Segments roll over at this size so a rehydrate never has to skip through a huge file.
+constexpr std::uint64_t kArchiveSegmentBytes = 64ULL * 1024 * 1024;
+constexpr std::string_view kSegmentPrefix = "segment-";
+constexpr std::string_view kSegmentSuffix = ".gz";
+
+// Same format as memory::now_rfc3339(), so timestamps compare as strings.
+std::string rfc3339_at(const std::chrono::system_clock::time_point at) {
+  const std::time_t t = std::chrono::system_clock::to_time_t(at);
+  std::tm tm{};
+#ifdef _WIN32
+  gmtime_s(&tm, &t);
+#else
+  gmtime_r(&t, &tm);
+#endif
+  std::ostringstream out;
+  out << std::put_time(&tm, "%Y-%m-%dT%H:%M:%SZ");
+  return out.str();
+}
+
+// One complete gzip member, so a segment is a plain multi-member .gz file.
+common::Result<std::string> gzip_bytes(const std::string &input) {
+  z_stream stream{};
+  if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) !=
+      Z_OK) {
+    return common::Result<std::string>::failure("deflateInit2 failed");
+  }
+  std::string out(deflateBound(&stream, static_cast<uLong>(input.size())) + 32, '\0');
+  stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+  stream.avail_in = static_cast<uInt>(input.size());
+  stream.next_out = reinterpret_cast<Bytef *>(out.data());
+  stream.avail_out = static_cast<uInt>(out.size());
+  const int rc = deflate(&stream, Z_FINISH);
+  out.resize(stream.total_out);
+  deflateEnd(&stream);
+  if (rc != Z_STREAM_END) {
+    return common::Result<std::string>::failure("deflate failed");
+  }
+  return common::Result<std::string>::success(std::move(out));
+}
+
+common::Result<std::string> gunzip_bytes(const std::string &input) {
+  z_stream stream{};
+  if (inflateInit2(&stream, 15 + 16) != Z_OK) {
+    return common::Result<std::string>::failure("inflateInit2 failed");
+  }
+  stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+  stream.avail_in = static_cast<uInt>(input.size());
+  std::string out;
+  std::string chunk(64 * 1024, '\0');
+  int rc = Z_OK;
+  while (rc == Z_OK) {
+    stream.next_out = reinterpret_cast<Bytef *>(chunk.data());
+    stream.avail_out = static_cast<uInt>(chunk.size());
+    rc = inflate(&stream, Z_NO_FLUSH);
+    out.append(chunk.data(), chunk.size() - stream.avail_out);
+  }
+  inflateEnd(&stream);
+  if (rc != Z_STREAM_END) {
+    return common::Result<std::string>::failure("archived transcript is corrupt");
+  }
+  return common::Result<std::string>::success(std::move(out));
+}
+
+#ifndef _WIN32
+common::Result<std::string> read_fd(const int fd) {
+  std::string out;
+  std::string chunk(64 * 1024, '\0');
+  (void)::lseek(fd, 0, SEEK_SET);
+  while (true) {
+    const ssize_t n = ::read(fd, chunk.data(), chunk.size());
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      return common::Result<std::string>::failure(std::string("failed reading transcript: ") +
+                                                  std::strerror(errno));
+    }
+    if (n == 0) {
+      break;
+    }
+    out.append(chunk.data(), static_cast<std::size_t>(n));
+  }
+  return common::Result<std::string>::success(std::move(out));
+}
+#endif
+
+// Scalars first: json_get_* take the first occurrence of a key.
+std::string encode_archive_line(const std::string &segment, const std::uint64_t offset,
+                                const std::uint64_t length, const SessionState &state) {
+  return "{\"segment\":\"" + common::json_escape(segment) + "\",\"offset\":" +
+         std::to_string(offset) + ",\"length\":" + std::to_string(length) +
+         ",\"state\":" + encode_session_state_jsonl(state) + "}";
+}
+
+// Advisory cross-process lock so several gateway workers can share one session
+// directory without losing each other's index updates.
+class ScopedFileLock {
+public:
+  explicit ScopedFileLock(const std::filesystem::path &path) {
+#ifndef _WIN32
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd_ >= 0 && ::flock(fd_, LOCK_EX) != 0) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+#else
+    (void)path;
+#endif
+  }
+  ~ScopedFileLock() {
+#ifndef _WIN32
+    if (fd_ >= 0) {
+      (void)::flock(fd_, LOCK_UN);
+      ::close(fd_);
+    }
+#endif
+  }
+  ScopedFileLock(const ScopedFileLock &) = delete;
+  ScopedFileLock &operator=(const ScopedFileLock &) = delete;
+
+private:
+  int fd_ = -1;
+};
+
 } // namespace
 
 SessionStore::SessionStore(std::filesystem::path root_dir) : root_dir_(std::move(root_dir)) {
@@ -38,16 +179,41 @@ SessionStore::SessionStore(std::filesystem::path root_dir) : root_dir_(std::move
   transcript_dir_ = root_dir_ / "transcripts";
   std::filesystem::create_directories(transcript_dir_, ec);
   state_index_path_ = root_dir_ / "states.jsonl";
+  lock_path_ = root_dir_ / "states.lock";
+  archive_dir_ = root_dir_ / "archive";
+  archive_index_path_ = archive_dir_ / "index.jsonl";
   (void)load_state_index();
 }
 
 common::Status SessionStore::load_state_index() {
   std::lock_guard<std::mutex> lock(mutex_);
-  states_.clear();
+  index_size_ = static_cast<std::uintmax_t>(-1);
+  refresh_state_index_locked();
+  return common::Status::success();
+}
 
+void SessionStore::refresh_state_index_locked() const {
+  std::error_code ec;
+  const auto mtime = std::filesystem::last_write_time(state_index_path_, ec);
+  if (ec) {
+    if (index_size_ != 0 || index_mtime_ != std::filesystem::file_time_type{}) {
+      states_.clear();
+    }
+    index_mtime_ = {};
+    index_size_ = 0;
+    return;
+  }
+  const auto size = std::filesystem::file_size(state_index_path_, ec);
+  if (!ec && mtime == index_mtime_ && size == index_size_) {
+    return;
+  }
+
+  states_.clear();
+  index_mtime_ = mtime;
+  index_size_ = ec ? 0 : size;
   std::ifstream in(state_index_path_);
   if (!in) {
-    return common::Status::success();
+    return;
   }
 
   std::string line;
@@ -58,7 +224,6 @@ common::Status SessionStore::load_state_index() {
     }
     states_[parsed.value().session_id] = parsed.value();
   }
-  return common::Status::success();
 }
 
 common::Status SessionStore::persist_state_index() const {
@@ -91,9 +256,174 @@ common::Status SessionStore::persist_state_index() const {
   if (ec) {
     return common::Status::error("failed replacing session index: " + ec.message());
   }
+  index_mtime_ = std::filesystem::last_write_time(state_index_path_, ec);
+  index_size_ = std::filesystem::file_size(state_index_path_, ec);
   return common::Status::success();
 }
 
+void SessionStore::refresh_archive_index_locked() const {
+  std::error_code ec;
+  const auto mtime = std::filesystem::last_write_time(archive_index_path_, ec);
+  if (ec) {
+    archived_.clear();
+    archive_mtime_ = {};
+    archive_size_ = 0;
+    return;
+  }
+  const auto size = std::filesystem::file_size(archive_index_path_, ec);
+  if (!ec && mtime == archive_mtime_ && size == archive_size_) {
+    return;
+  }
+
+  archived_.clear();
+  archive_mtime_ = mtime;
+  archive_size_ = ec ? 0 : size;
+  std::ifstream in(archive_index_path_);
+  std::string line;
+  while (std::getline(in, line)) {
+    auto state = parse_session_state_jsonl(common::json_get_object(line, "state"));
+    if (!state.ok()) {
+      continue;
+    }
+    ArchiveEntry entry;
+    entry.segment = common::json_get_string(line, "segment");
+    try {
+      entry.offset = std::stoull(common::json_get_number(line, "offset"));
+      entry.length = std::stoull(common::json_get_number(line, "length"));
+    } catch (...) {
+      continue;
+    }
+    entry.state = std::move(state.value());
+    // Later lines win: a session archived again after a restore.
+    archived_[entry.state.session_id] = std::move(entry);
+  }
+}
+
+common::Status SessionStore::persist_archive_index() const {
+  std::filesystem::path tmp = archive_index_path_;
+  tmp += ".tmp";
+  std::ofstream out(tmp, std::ios::trunc);
+  if (!out) {
+    return common::Status::error("failed to open temporary archive index");
+  }
+  for (const auto &[id, entry] : archived_) {
+    (void)id;
+    out << encode_archive_line(entry.segment, entry.offset, entry.length, entry.state) << "\n";
+  }
+  out.close();
+  if (!out) {
+    return common::Status::error("failed writing temporary archive index");
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp, archive_index_path_, ec);
+  if (ec) {
+    return common::Status::error("failed replacing archive index: " + ec.message());
+  }
+  archive_mtime_ = std::filesystem::last_write_time(archive_index_path_, ec);
+  archive_size_ = std::filesystem::file_size(archive_index_path_, ec);
+  return common::Status::success();
+}
+
+common::Status SessionStore::rehydrate_locked(const std::string &session_id) const {
+  refresh_archive_index_locked();
+  const auto it = archived_.find(session_id);
+  if (it == archived_.end()) {
+    return common::Status::success();
+  }
+  const ArchiveEntry entry = it->second;
+
+  std::ifstream segment(archive_dir_ / entry.segment, std::ios::binary);
+  std::string compressed(static_cast<std::size_t>(entry.length), '\0');
+  segment.seekg(static_cast<std::streamoff>(entry.offset));
+  segment.read(compressed.data(), static_cast<std::streamsize>(compressed.size()));
+  if (!segment || static_cast<std::size_t>(segment.gcount()) != compressed.size()) {
+    return common::Status::error("failed reading archive segment " + entry.segment);
+  }
+  auto archived = gunzip_bytes(compressed);
+  if (!archived.ok()) {
+    return common::Status::error(archived.error());
+  }
+
+  const auto path = transcript_path(session_id);
+#ifndef _WIN32
+  // Normally there is no transcript file. One that survived an interrupted archive run
+  // already starts with the archived lines; anything else was appended since.
+  const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    return common::Status::error("failed opening transcript file");
+  }
+  (void)::flock(fd, LOCK_EX);
+  const auto read = read_fd(fd);
+  if (!read.ok()) {
+    (void)::flock(fd, LOCK_UN);
+    ::close(fd);
+    return common::Status::error(read.error());
+  }
+  const std::string &existing = read.value();
+  if (existing.compare(0, archived.value().size(), archived.value()) != 0) {
+    const std::string merged = archived.value() + existing;
+    std::size_t written = 0;
+    (void)::ftruncate(fd, 0);
+    (void)::lseek(fd, 0, SEEK_SET);
+    while (written < merged.size()) {
+      const ssize_t n = ::write(fd, merged.data() + written, merged.size() - written);
+      if (n <= 0) {
+        break;
+      }
+      written += static_cast<std::size_t>(n);
+    }
+    if (written != merged.size()) {
+      (void)::flock(fd, LOCK_UN);
+      ::close(fd);
+      return common::Status::error("failed restoring transcript");
+    }
+  }
+  (void)::flock(fd, LOCK_UN);
+  ::close(fd);
+#else
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out << archived.value();
+  if (!out) {
+    return common::Status::error("failed restoring transcript");
+  }
+#endif
+
+  // A hot state only coexists with the archived one after an interrupted run; it is newer.
+  states_.try_emplace(session_id, entry.state);
+  archived_.erase(session_id);
+  {
+    std::lock_guard<std::mutex> index_lock(transcript_index_mutex_);
+    drop_transcript_index_locked(session_id);
+  }
+  auto persisted = persist_state_index();
+  if (!persisted.ok()) {
+    return persisted;
+  }
+  persisted = persist_archive_index();
+  if (!persisted.ok()) {
+    return persisted;
+  }
+
+  const bool segment_in_use =
+      std::any_of(archived_.begin(), archived_.end(),
+                  [&](const auto &other) { return other.second.segment == entry.segment; });
+  if (!segment_in_use) {
+    std::error_code ec;
+    std::filesystem::remove(archive_dir_ / entry.segment, ec);
+  }
+  return common::Status::success();
+}
+
+common::Status SessionStore::ensure_hot_locked(const std::string &session_id) const {
+  refresh_archive_index_locked();
+  if (!archived_.contains(session_id)) {
+    return common::Status::success();
+  }
+  ScopedFileLock file_lock(lock_path_);
+  refresh_state_index_locked();
+  return rehydrate_locked(session_id);
+}
+
 std::filesystem::path SessionStore::transcript_path(const std::string &session_id) const {
   return transcript_dir_ / (sanitize_session_filename(session_id) + ".jsonl");
 }
@@ -153,6 +483,11 @@ common::Status SessionStore::upsert_state(const SessionState &state) {
   }
 
   std::lock_guard<std::mutex> lock(mutex_);
+  ScopedFileLock file_lock(lock_path_);
+  refresh_state_index_locked();
+  if (auto restored = rehydrate_locked(normalized.value().session_id); !restored.ok()) {
+    return restored;
+  }
   SessionState merged = normalized.value();
   const auto existing_it = states_.find(merged.session_id);
   if (existing_it != states_.end()) {
@@ -181,6 +516,14 @@ common::Status SessionStore::upsert_state(const SessionState &state) {
     if (state.subagents.empty()) {
       merged.subagents = existing.subagents;
     }
+    // Totals only move through record_usage(); a plain upsert never resets them.
+    if (state.usage.turns == 0) {
+      merged.usage = existing.usage;
+    }
+    if (state.summary_through <= existing.summary_through) {
+      merged.history_summary = existing.history_summary;
+      merged.summary_through = existing.summary_through;
+    }
   }
   if (state.updated_at.empty()) {
     merged.updated_at = now_timestamp();
@@ -191,6 +534,10 @@ common::Status SessionStore::upsert_state(const SessionState &state) {
 
 common::Result<SessionState> SessionStore::get_state(const std::string &session_id) const {
   std::lock_guard<std::mutex> lock(mutex_);
+  refresh_state_index_locked();
+  if (auto restored = ensure_hot_locked(session_id); !restored.ok()) {
+    return common::Result<SessionState>::failure(restored.error());
+  }
   const auto it = states_.find(session_id);
   if (it == states_.end()) {
     return common::Result<SessionState>::failure("session not found");
@@ -200,6 +547,7 @@ common::Result<SessionState> SessionStore::get_state(const std::string &session_
 
 common::Result<std::vector<SessionState>> SessionStore::list_states() const {
   std::lock_guard<std::mutex> lock(mutex_);
+  refresh_state_index_locked();
   std::vector<SessionState> out;
   out.reserve(states_.size());
   for (const auto &[session_id, state] : states_) {
@@ -215,6 +563,7 @@ common::Result<std::vector<SessionState>>
 SessionStore::list_states_by_group(const std::string &group_id) const {
   const std::string normalized_group = common::trim(group_id);
   std::lock_guard<std::mutex> lock(mutex_);
+  refresh_state_index_locked();
   std::vector<SessionState> out;
   out.reserve(states_.size());
   for (const auto &[session_id, state] : states_) {
@@ -233,6 +582,11 @@ common::Status SessionStore::set_group(const std::string &session_id, const std:
     return common::Status::error("session_id is required");
   }
   std::lock_guard<std::mutex> lock(mutex_);
+  ScopedFileLock file_lock(lock_path_);
+  refresh_state_index_locked();
+  if (auto restored = rehydrate_locked(session_id); !restored.ok()) {
+    return restored;
+  }
   auto it = states_.find(session_id);
   if (it == states_.end()) {
     SessionState state;
@@ -248,6 +602,67 @@ common::Status SessionStore::set_group(const std::string &session_id, const std:
   return persist_state_index();
 }
 
+common::Status SessionStore::record_usage(const std::string &session_id,
+                                          const SessionUsage &turn) {
+  if (common::trim(session_id).empty()) {
+    return common::Status::error("session_id is required");
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  ScopedFileLock file_lock(lock_path_);
+  refresh_state_index_locked();
+  if (auto restored = rehydrate_locked(session_id); !restored.ok()) {
+    return restored;
+  }
+  auto it = states_.find(session_id);
+  if (it == states_.end()) {
+    return common::Status::error("session not found");
+  }
+  it->second.usage += turn;
+  return persist_state_index();
+}
+
+common::Status SessionStore::set_history_summary(const std::string &session_id,
+                                                 const std::string &summary,
+                                                 const std::uint64_t summary_through) {
+  if (common::trim(session_id).empty()) {
+    return common::Status::error("session_id is required");
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  ScopedFileLock file_lock(lock_path_);
+  refresh_state_index_locked();
+  if (auto restored = rehydrate_locked(session_id); !restored.ok()) {
+    return restored;
+  }
+  auto it = states_.find(session_id);
+  if (it == states_.end()) {
+    return common::Status::error("session not found");
+  }
+  if (summary_through <= it->second.summary_through) {
+    return common::Status::success();
+  }
+  it->second.history_summary = summary;
+  it->second.summary_through = summary_through;
+  return persist_state_index();
+}
+
+common::Result<std::unordered_map<std::string, SessionUsage>>
+SessionStore::usage_by_channel() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  refresh_state_index_locked();
+  refresh_archive_index_locked();
+  std::unordered_map<std::string, SessionUsage> out;
+  for (const auto &[session_id, state] : states_) {
+    (void)session_id;
+    out[state.channel_id] += state.usage;
+  }
+  for (const auto &[session_id, entry] : archived_) {
+    if (!states_.contains(session_id)) {
+      out[entry.state.channel_id] += entry.state.usage;
+    }
+  }
+  return common::Result<std::unordered_map<std::string, SessionUsage>>::success(std::move(out));
+}
+
 common::Status SessionStore::append_transcript(const std::string &session_id,
                                                const TranscriptEntry &entry) {
   if (session_id.empty()) {
@@ -260,16 +675,63 @@ common::Status SessionStore::append_transcript(const std::string &session_id,
   }
 
   const auto path = transcript_path(session_id);
+  const std::string line = encode_transcript_entry_jsonl(normalized_entry) + "\n";
+#ifndef _WIN32
+  // One O_APPEND write under flock keeps lines from concurrent workers whole. The archiver
+  // unlinks a transcript under the same flock; a file found unlinked is restored first.
+  int fd = -1;
+  for (int attempt = 0; attempt < 3 && fd < 0; ++attempt) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (auto restored = ensure_hot_locked(session_id); !restored.ok()) {
+        return restored;
+      }
+    }
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (fd < 0) {
+      return common::Status::error("failed opening transcript file");
+    }
+    (void)::flock(fd, LOCK_EX);
+    struct stat st {};
+    if (::fstat(fd, &st) == 0 && st.st_nlink == 0) {
+      (void)::flock(fd, LOCK_UN);
+      ::close(fd);
+      fd = -1;
+    }
+  }
+  if (fd < 0) {
+    return common::Status::error("transcript kept moving to the archive");
+  }
+  std::size_t written = 0;
+  while (written < line.size()) {
+    const ssize_t n = ::write(fd, line.data() + written, line.size() - written);
+    if (n <= 0) {
+      break;
+    }
+    written += static_cast<std::size_t>(n);
+  }
+  (void)::flock(fd, LOCK_UN);
+  ::close(fd);
+  if (written != line.size()) {
+    return common::Status::error("failed appending transcript");
+  }
+#else
   std::ofstream out(path, std::ios::app);
   if (!out) {
     return common::Status::error("failed opening transcript file");
   }
-  out << encode_transcript_entry_jsonl(normalized_entry) << "\n";
+  out << line;
   if (!out) {
     return common::Status::error("failed appending transcript");
   }
+#endif
 
   std::lock_guard<std::mutex> lock(mutex_);
+  ScopedFileLock file_lock(lock_path_);
+  refresh_state_index_locked();
+  if (auto restored = rehydrate_locked(session_id); !restored.ok()) {
+    return restored;
+  }
   auto it = states_.find(session_id);
   if (it != states_.end()) {
     it->second.updated_at = normalized_entry.timestamp;
@@ -290,6 +752,20 @@ SessionStore::load_transcript(const std::string &session_id, const std::size_t l
   if (session_id.empty()) {
     return common::Result<std::vector<TranscriptEntry>>::failure("session_id is required");
   }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (auto restored = ensure_hot_locked(session_id); !restored.ok()) {
+      return common::Result<std::vector<TranscriptEntry>>::failure(restored.error());
+    }
+  }
+  if (limit > 0) {
+    auto page = load_transcript_page(session_id, TranscriptCursor{.limit = limit});
+    if (!page.ok()) {
+      return common::Result<std::vector<TranscriptEntry>>::failure(page.error());
+    }
+    return common::Result<std::vector<TranscriptEntry>>::success(
+        std::move(page.value().entries));
+  }
 
   std::ifstream in(transcript_path(session_id));
   if (!in) {
@@ -298,18 +774,164 @@ SessionStore::load_transcript(const std::string &session_id, const std::size_t l
 
   std::vector<TranscriptEntry> entries;
   std::string line;
+  std::uint64_t id = 0;
   while (std::getline(in, line)) {
+    ++id;
     auto parsed = parse_transcript_entry_jsonl(line);
     if (!parsed.ok()) {
       continue;
     }
-    entries.push_back(parsed.value());
+    parsed.value().id = id;
+    entries.push_back(std::move(parsed.value()));
   }
+  return common::Result<std::vector<TranscriptEntry>>::success(std::move(entries));
+}
 
-  if (limit > 0 && entries.size() > limit) {
-    entries.erase(entries.begin(), entries.end() - static_cast<long>(limit));
+common::Result<TranscriptPage>
+SessionStore::load_transcript_page(const std::string &session_id,
+                                   const TranscriptCursor &cursor) const {
+  if (session_id.empty()) {
+    return common::Result<TranscriptPage>::failure("session_id is required");
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (auto restored = ensure_hot_locked(session_id); !restored.ok()) {
+      return common::Result<TranscriptPage>::failure(restored.error());
+    }
+  }
+
+  std::ifstream in(transcript_path(session_id), std::ios::binary);
+  if (!in) {
+    return common::Result<TranscriptPage>::success({});
+  }
+  in.seekg(0, std::ios::end);
+  const auto file_size = static_cast<std::uint64_t>(in.tellg());
+  std::uint64_t device = 0;
+  std::uint64_t inode = 0;
+#ifndef _WIN32
+  struct stat info {};
+  if (::stat(transcript_path(session_id).c_str(), &info) == 0) {
+    device = static_cast<std::uint64_t>(info.st_dev);
+    inode = static_cast<std::uint64_t>(info.st_ino);
+  }
+#endif
+
+  std::lock_guard<std::mutex> lock(transcript_index_mutex_);
+  auto &index = transcript_index_locked(session_id);
+  bool appended_only = index.device == device && index.inode == inode &&
+                       file_size >= index.indexed_bytes;
+  if (appended_only && index.indexed_bytes > 0) {
+    // The last indexed line must still end where it did.
+    char last = '\0';
+    in.seekg(static_cast<std::streamoff>(index.indexed_bytes - 1));
+    appended_only = in.get(last) && last == '\n';
+    in.clear();
+  }
+  if (!appended_only) {
+    // Replaced or rewritten rather than appended to; start over.
+    index.line_starts.clear();
+    index.indexed_bytes = 0;
+    index.device = device;
+    index.inode = inode;
+  }
+  if (file_size > index.indexed_bytes) {
+    in.seekg(static_cast<std::streamoff>(index.indexed_bytes));
+    std::string chunk(64 * 1024, '\0');
+    std::uint64_t chunk_start = index.indexed_bytes;
+    std::uint64_t line_start = index.indexed_bytes;
+    while (chunk_start < file_size) {
+      in.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+      const auto got = static_cast<std::size_t>(in.gcount());
+      if (got == 0) {
+        break;
+      }
+      const char *cursor_ptr = chunk.data();
+      const char *end = chunk.data() + got;
+      while (const auto *newline =
+                 static_cast<const char *>(std::memchr(cursor_ptr, '\n', end - cursor_ptr))) {
+        index.line_starts.push_back(line_start);
+        line_start = chunk_start + static_cast<std::uint64_t>(newline - chunk.data()) + 1;
+        cursor_ptr = newline + 1;
+      }
+      chunk_start += got;
+    }
+    // A trailing partial line is left for the next call.
+    index.indexed_bytes = line_start;
+    in.clear();
+  }
+
+  const std::uint64_t total = index.line_starts.size();
+  const std::uint64_t limit = cursor.limit == 0 ? total : cursor.limit;
+  std::uint64_t first = 0;
+  std::uint64_t last = total;
+  if (cursor.after > 0) {
+    first = std::min(cursor.after, total);
+    last = std::min(first + limit, total);
+  } else {
+    if (cursor.before > 0) {
+      last = std::min(cursor.before - 1, total);
+    }
+    first = last > limit ? last - limit : 0;
+  }
+
+  TranscriptPage page;
+  page.total = total;
+  page.has_more_before = first > 0;
+  page.has_more_after = last < total;
+  if (first == last) {
+    return common::Result<TranscriptPage>::success(std::move(page));
+  }
+
+  const std::uint64_t begin_offset = index.line_starts[first];
+  const std::uint64_t end_offset =
+      last < total ? index.line_starts[last] : index.indexed_bytes;
+  std::string bytes(static_cast<std::size_t>(end_offset - begin_offset), '\0');
+  in.seekg(static_cast<std::streamoff>(begin_offset));
+  in.read(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+  if (static_cast<std::size_t>(in.gcount()) != bytes.size()) {
+    return common::Result<TranscriptPage>::failure("failed reading transcript");
+  }
+
+  page.entries.reserve(static_cast<std::size_t>(last - first));
+  std::size_t pos = 0;
+  for (std::uint64_t id = first + 1; id <= last; ++id) {
+    const auto newline = bytes.find('\n', pos);
+    const auto line_end = newline == std::string::npos ? bytes.size() : newline;
+    auto parsed = parse_transcript_entry_jsonl(bytes.substr(pos, line_end - pos));
+    pos = line_end + 1;
+    if (!parsed.ok()) {
+      continue;
+    }
+    parsed.value().id = id;
+    page.entries.push_back(std::move(parsed.value()));
+  }
+  return common::Result<TranscriptPage>::success(std::move(page));
+}
+
+SessionStore::TranscriptIndex &
+SessionStore::transcript_index_locked(const std::string &session_id) const {
+  auto it = transcript_indexes_.find(session_id);
+  if (it != transcript_indexes_.end()) {
+    transcript_index_lru_.splice(transcript_index_lru_.begin(), transcript_index_lru_,
+                                 it->second.lru);
+    return it->second;
+  }
+  while (transcript_indexes_.size() >= kMaxTranscriptIndexes && !transcript_index_lru_.empty()) {
+    transcript_indexes_.erase(transcript_index_lru_.back());
+    transcript_index_lru_.pop_back();
+  }
+  transcript_index_lru_.push_front(session_id);
+  auto &index = transcript_indexes_[session_id];
+  index.lru = transcript_index_lru_.begin();
+  return index;
+}
+
+void SessionStore::drop_transcript_index_locked(const std::string &session_id) const {
+  const auto it = transcript_indexes_.find(session_id);
+  if (it != transcript_indexes_.end()) {
+    transcript_index_lru_.erase(it->second.lru);
+    transcript_indexes_.erase(it);
   }
-  return common::Result<std::vector<TranscriptEntry>>::success(std::move(entries));
 }
 
 common::Status SessionStore::register_subagent(const std::string &session_id,
@@ -319,6 +941,11 @@ common::Status SessionStore::register_subagent(const std::string &session_id,
   }
 
   std::lock_guard<std::mutex> lock(mutex_);
+  ScopedFileLock file_lock(lock_path_);
+  refresh_state_index_locked();
+  if (auto restored = rehydrate_locked(session_id); !restored.ok()) {
+    return restored;
+  }
   auto it = states_.find(session_id);
   if (it == states_.end()) {
     SessionState state;
@@ -341,6 +968,11 @@ common::Status SessionStore::register_subagent(const std::string &session_id,
 common::Status SessionStore::unregister_subagent(const std::string &session_id,
                                                  const std::string &subagent_id) {
   std::lock_guard<std::mutex> lock(mutex_);
+  ScopedFileLock file_lock(lock_path_);
+  refresh_state_index_locked();
+  if (auto restored = rehydrate_locked(session_id); !restored.ok()) {
+    return restored;
+  }
   const auto it = states_.find(session_id);
   if (it == states_.end()) {
     return common::Status::success();
@@ -351,4 +983,160 @@ common::Status SessionStore::unregister_subagent(const std::string &session_id,
   return persist_state_index();
 }
 
+common::Result<std::size_t> SessionStore::archive_idle(const std::chrono::seconds idle_for) {
+  using R = common::Result<std::size_t>;
+  const std::string cutoff = rfc3339_at(std::chrono::system_clock::now() - idle_for);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  ScopedFileLock file_lock(lock_path_);
+  refresh_state_index_locked();
+  refresh_archive_index_locked();
+
+  std::vector<std::string> idle;
+  for (const auto &[session_id, state] : states_) {
+    if (state.updated_at < cutoff && state.subagents.empty()) {
+      idle.push_back(session_id);
+    }
+  }
+  if (idle.empty()) {
+    return R::success(0);
+  }
+
+  std::error_code ec;
+  std::filesystem::create_directories(archive_dir_, ec);
+  if (ec) {
+    return R::failure("failed to create session archive: " + ec.message());
+  }
+  // Append to the newest segment until it is full.
+  std::uint64_t segment_number = 1;
+  for (const auto &file : std::filesystem::directory_iterator(archive_dir_, ec)) {
+    const std::string name = file.path().filename().string();
+    if (name.starts_with(kSegmentPrefix) && name.ends_with(kSegmentSuffix)) {
+      try {
+        segment_number = std::max<std::uint64_t>(
+            segment_number, std::stoull(name.substr(kSegmentPrefix.size())));
+      } catch (...) {
+      }
+    }
+  }
+  const auto segment_name = [](const std::uint64_t number) {
+    std::ostringstream name;
+    name << kSegmentPrefix << std::setw(6) << std::setfill('0') << number << kSegmentSuffix;
+    return name.str();
+  };
+  std::string segment = segment_name(segment_number);
+  std::uint64_t segment_size = 0;
+  if (const auto size = std::filesystem::file_size(archive_dir_ / segment, ec); !ec) {
+    segment_size = size;
+  }
+
+  std::ofstream index_out(archive_index_path_, std::ios::app);
+  if (!index_out) {
+    return R::failure("failed to open archive index");
+  }
+  std::size_t archived_count = 0;
+  for (const auto &session_id : idle) {
+    if (segment_size >= kArchiveSegmentBytes) {
+      segment = segment_name(++segment_number);
+      segment_size = 0;
+    }
+    const auto path = transcript_path(session_id);
+    std::string transcript;
+#ifndef _WIN32
+    // Held until the unlink so no append lands in between. A transcript that cannot be
+    // read stays where it is; only a missing one archives as empty.
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0 && errno != ENOENT) {
+      continue;
+    }
+    const auto release = [fd]() {
+      if (fd >= 0) {
+        (void)::flock(fd, LOCK_UN);
+        ::close(fd);
+      }
+    };
+    if (fd >= 0) {
+      (void)::flock(fd, LOCK_EX);
+      auto read = read_fd(fd);
+      if (!read.ok()) {
+        release();
+        continue;
+      }
+      transcript = std::move(read.value());
+    }
+#else
+    if (std::filesystem::exists(path, ec)) {
+      std::ifstream in(path, std::ios::binary);
+      std::ostringstream bytes;
+      bytes << in.rdbuf();
+      if (!in || !bytes) {
+        continue;
+      }
+      transcript = bytes.str();
+    } else if (ec) {
+      continue;
+    }
+    const auto release = []() {};
+#endif
+    auto compressed = gzip_bytes(transcript);
+    if (!compressed.ok()) {
+      release();
+      continue;
+    }
+    std::ofstream segment_out(archive_dir_ / segment, std::ios::binary | std::ios::app);
+    segment_out.write(compressed.value().data(),
+                      static_cast<std::streamsize>(compressed.value().size()));
+    segment_out.close();
+    if (!segment_out) {
+      release();
+      return R::failure("failed writing archive segment " + segment);
+    }
+    ArchiveEntry entry{.state = states_.at(session_id),
+                       .segment = segment,
+                       .offset = segment_size,
+                       .length = compressed.value().size()};
+    segment_size += entry.length;
+    index_out << encode_archive_line(entry.segment, entry.offset, entry.length, entry.state)
+              << "\n";
+    index_out.flush();
+    if (!index_out) {
+      release();
+      return R::failure("failed writing archive index");
+    }
+    std::filesystem::remove(path, ec);
+    release();
+
+    archived_[session_id] = std::move(entry);
+    states_.erase(session_id);
+    {
+      std::lock_guard<std::mutex> index_lock(transcript_index_mutex_);
+      drop_transcript_index_locked(session_id);
+    }
+    ++archived_count;
+  }
+  index_out.close();
+  archive_mtime_ = std::filesystem::last_write_time(archive_index_path_, ec);
+  archive_size_ = std::filesystem::file_size(archive_index_path_, ec);
+
+  auto persisted = persist_state_index();
+  if (!persisted.ok()) {
+    return R::failure(persisted.error());
+  }
+  return R::success(archived_count);
+}
+
+common::Result<std::vector<SessionState>> SessionStore::list_archived() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  refresh_archive_index_locked();
+  std::vector<SessionState> out;
+  out.reserve(archived_.size());
+  for (const auto &[session_id, entry] : archived_) {
+    (void)session_id;
+    out.push_back(entry.state);
+  }
+  std::sort(out.begin(), out.end(),
+            [](const SessionState &a, const SessionState &b) { return a.updated_at > b.updated_at; });
+  return common::Result<std::vector<SessionState>>::success(std::move(out));
+}
+
 } // namespace ghostclaw::sessions
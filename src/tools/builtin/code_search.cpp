@@ -0,0 +1,135 @@
+#include "ghostclaw/tools/builtin/code_search.hpp"
+
+#include "ghostclaw/common/fs.hpp"
+#include "ghostclaw/tools/code_index.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+namespace ghostclaw::tools {
+
+namespace {
+
+constexpr std::size_t kDefaultMaxResults = 50;
+
+bool parse_flag(const ToolArgs &args, const std::string &name, const bool fallback) {
+  const auto it = args.find(name);
+  if (it == args.end() || common::trim(it->second).empty()) {
+    return fallback;
+  }
+  const std::string value = common::to_lower(common::trim(it->second));
+  return value == "true" || value == "1" || value == "yes";
+}
+
+std::size_t parse_count(const ToolArgs &args, const std::string &name, const std::size_t fallback) {
+  const auto it = args.find(name);
+  if (it == args.end()) {
+    return fallback;
+  }
+  try {
+    return static_cast<std::size_t>(std::stoull(it->second));
+  } catch (...) {
+    return fallback;
+  }
+}
+
+// Workspace-relative directory with '/' separators and no trailing slash; empty for the
+// whole workspace. Absolute paths and ".." are refused.
+common::Result<std::string> normalize_prefix(const ToolArgs &args) {
+  const auto it = args.find("path");
+  if (it == args.end()) {
+    return common::Result<std::string>::success("");
+  }
+  std::string prefix = common::trim(it->second);
+  std::replace(prefix.begin(), prefix.end(), '\\', '/');
+  while (prefix.rfind("./", 0) == 0) {
+    prefix.erase(0, 2);
+  }
+  while (!prefix.empty() && prefix.back() == '/') {
+    prefix.pop_back();
+  }
+  if (prefix == ".") {
+    prefix.clear();
+  }
+  if (!prefix.empty() && prefix.front() == '/') {
+    return common::Result<std::string>::failure("path must be relative to the workspace");
+  }
+  std::istringstream segments(prefix);
+  std::string segment;
+  while (std::getline(segments, segment, '/')) {
+    if (segment == "..") {
+      return common::Result<std::string>::failure("path must stay inside the workspace");
+    }
+  }
+  return common::Result<std::string>::success(std::move(prefix));
+}
+
+} // namespace
+
+std::string_view CodeSearchTool::name() const { return "code_search"; }
+
+std::string_view CodeSearchTool::description() const {
+  return "Search workspace files (respecting .gitignore) for a literal string or regex; "
+         "returns path:line: text matches";
+}
+
+std::string CodeSearchTool::parameters_schema() const {
+  return R"({"type":"object","required":["query"],"properties":{"query":{"type":"string"},"regex":{"type":"boolean","description":"treat query as an ECMAScript regex"},"case_sensitive":{"type":"boolean","description":"default true"},"path":{"type":"string","description":"limit to this workspace-relative directory"},"max_results":{"type":"integer","description":"default 50, at most 500"}}})";
+}
+
+common::Result<ToolResult> CodeSearchTool::execute(const ToolArgs &args, const ToolContext &ctx) {
+  const auto query_it = args.find("query");
+  if (query_it == args.end() || query_it->second.empty()) {
+    return common::Result<ToolResult>::failure("Missing argument: query");
+  }
+  if (ctx.workspace_path.empty()) {
+    return common::Result<ToolResult>::failure("workspace unavailable");
+  }
+  auto prefix = normalize_prefix(args);
+  if (!prefix.ok()) {
+    return common::Result<ToolResult>::failure(prefix.error());
+  }
+
+  CodeQuery query;
+  query.pattern = query_it->second;
+  query.regex = parse_flag(args, "regex", false);
+  query.case_sensitive = parse_flag(args, "case_sensitive", true);
+  query.path_prefix = prefix.value();
+  query.max_results = parse_count(args, "max_results", kDefaultMaxResults);
+
+  auto index = CodeIndex::for_workspace(ctx.workspace_path);
+  auto found = index->search(query);
+  if (!found.ok()) {
+    return common::Result<ToolResult>::failure(found.error());
+  }
+
+  ToolResult result;
+  std::ostringstream out;
+  for (const auto &match : found.value().matches) {
+    out << match.path << ":" << match.line << ": " << match.text << "\n";
+  }
+  if (found.value().matches.empty()) {
+    out << "No matches\n";
+  } else if (found.value().truncated) {
+    out << "[Stopped at " << found.value().matches.size()
+        << " matches; narrow the query or raise max_results.]\n";
+  }
+  if (found.value().long_lines_skipped > 0) {
+    out << "[" << found.value().long_lines_skipped
+        << " overlong lines were not regex-searched; try a literal query.]\n";
+  }
+  result.output = out.str();
+  result.truncated = found.value().truncated;
+  result.metadata["matches"] = std::to_string(found.value().matches.size());
+  result.metadata["candidates"] = std::to_string(found.value().candidates);
+  result.metadata["files_scanned"] = std::to_string(found.value().files_scanned);
+  result.metadata["long_lines_skipped"] = std::to_string(found.value().long_lines_skipped);
+  result.metadata["indexed_files"] = std::to_string(index->file_count());
+  return common::Result<ToolResult>::success(std::move(result));
+}
+
+bool CodeSearchTool::is_safe() const { return true; }
+
+std::string_view CodeSearchTool::group() const { return "fs"; }
+
+} // namespace ghostclaw::tools
@@ -1,13 +1,26 @@
 #include "ghostclaw/tools/builtin/file_edit.hpp"
 
-#include <filesystem>
-#include <fstream>
-#include <sstream>
+#include "ghostclaw/common/json_util.hpp"
+#include "ghostclaw/security/path_resolver.hpp"
+#include "ghostclaw/tools/file_view.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
 
 namespace ghostclaw::tools {
 
 namespace {
 
+struct Replacement {
+  std::string old_string;
+  std::string new_string;
+  std::size_t offset = 0;
+};
+
 common::Result<std::string> required_arg(const ToolArgs &args, const std::string &name) {
   const auto it = args.find(name);
   if (it == args.end()) {
@@ -16,16 +29,128 @@ common::Result<std::string> required_arg(const ToolArgs &args, const std::string
   return common::Result<std::string>::success(it->second);
 }
 
-security::SecurityPolicy scoped_policy(const security::SecurityPolicy &policy,
-                                       const tools::ToolContext &ctx) {
-  security::SecurityPolicy copy = policy;
-  if (!ctx.workspace_path.empty()) {
-    std::error_code ec;
-    std::filesystem::create_directories(ctx.workspace_path, ec);
-    auto canonical = std::filesystem::weakly_canonical(ctx.workspace_path, ec);
-    copy.workspace_dir = ec ? ctx.workspace_path : canonical;
+common::Result<std::shared_ptr<const security::WorkspaceRoot>>
+workspace_root(const security::SecurityPolicy &policy, const tools::ToolContext &ctx) {
+  return security::PathResolver::shared().root(ctx.workspace_path.empty() ? policy.workspace_dir
+                                                                          : ctx.workspace_path);
+}
+
+common::Result<std::vector<Replacement>> collect_replacements(const ToolArgs &args) {
+  using R = common::Result<std::vector<Replacement>>;
+  std::vector<Replacement> replacements;
+  const auto edits_it = args.find("edits");
+  if (edits_it != args.end() && !edits_it->second.empty()) {
+    if (args.contains("old_string")) {
+      return R::failure("Pass either edits or old_string/new_string, not both");
+    }
+    for (const auto &object : common::json_split_top_level_objects(edits_it->second)) {
+      if (common::json_find_key(object, "old_string") == std::string::npos ||
+          common::json_find_key(object, "new_string") == std::string::npos) {
+        return R::failure("Each edit needs old_string and new_string");
+      }
+      replacements.push_back({.old_string = common::json_get_string(object, "old_string"),
+                              .new_string = common::json_get_string(object, "new_string")});
+    }
+    if (replacements.empty()) {
+      return R::failure("edits must be a JSON array of {old_string, new_string} objects");
+    }
+    return R::success(std::move(replacements));
+  }
+
+  auto old_arg = required_arg(args, "old_string");
+  auto new_arg = required_arg(args, "new_string");
+  if (!old_arg.ok() || !new_arg.ok()) {
+    return R::failure("Missing required arguments");
+  }
+  replacements.push_back({.old_string = old_arg.value(), .new_string = new_arg.value()});
+  return R::success(std::move(replacements));
+}
+
+// Finds every old_string in the original content and orders the edits by position.
+// Each must occur exactly once, and no two may overlap.
+common::Status locate_replacements(std::string_view content, std::vector<Replacement> &replacements) {
+  const bool batch = replacements.size() > 1;
+  for (std::size_t i = 0; i < replacements.size(); ++i) {
+    auto &replacement = replacements[i];
+    const std::string label = batch ? "edit " + std::to_string(i + 1) + ": " : "";
+    if (replacement.old_string.empty()) {
+      return common::Status::error(label + "old_string must not be empty");
+    }
+    const auto first = content.find(replacement.old_string);
+    if (first == std::string_view::npos) {
+      return common::Status::error(label + "old_string not found");
+    }
+    if (content.find(replacement.old_string, first + replacement.old_string.size()) !=
+        std::string_view::npos) {
+      return common::Status::error(label + "old_string must be unique");
+    }
+    replacement.offset = first;
+  }
+  std::sort(replacements.begin(), replacements.end(),
+            [](const Replacement &lhs, const Replacement &rhs) { return lhs.offset < rhs.offset; });
+  for (std::size_t i = 1; i < replacements.size(); ++i) {
+    const auto &previous = replacements[i - 1];
+    if (previous.offset + previous.old_string.size() > replacements[i].offset) {
+      return common::Status::error("edits overlap");
+    }
+  }
+  return common::Status::success();
+}
+
+bool write_all(const int fd, const char *data, std::size_t size) {
+  while (size > 0) {
+    const auto written = ::write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += written;
+    size -= static_cast<std::size_t>(written);
+  }
+  return true;
+}
+
+// Copies [offset, offset + size) of the source to the end of `out`. On Linux the kernel
+// moves the bytes (or shares extents on reflink-capable filesystems); elsewhere, or when
+// the filesystem refuses, the mapped pages are written out instead.
+bool copy_region(const FileView &source, std::size_t offset, std::size_t size, const int out) {
+#if defined(__linux__)
+  auto in_offset = static_cast<off_t>(offset);
+  while (size > 0) {
+    const auto copied = ::copy_file_range(source.fd(), &in_offset, out, nullptr, size, 0);
+    if (copied < 0 && errno == EINTR) {
+      continue;
+    }
+    if (copied <= 0) {
+      break;
+    }
+    size -= static_cast<std::size_t>(copied);
   }
-  return copy;
+  offset = static_cast<std::size_t>(in_offset);
+#endif
+  return write_all(out, source.data().data() + offset, size);
+}
+
+common::Result<std::size_t> write_edited(const FileView &source,
+                                         const std::vector<Replacement> &replacements,
+                                         const int out) {
+  using R = common::Result<std::size_t>;
+  std::size_t cursor = 0;
+  std::size_t written = 0;
+  for (const auto &replacement : replacements) {
+    if (!copy_region(source, cursor, replacement.offset - cursor, out) ||
+        !write_all(out, replacement.new_string.data(), replacement.new_string.size())) {
+      return R::failure("Failed to write temporary file");
+    }
+    written += replacement.offset - cursor + replacement.new_string.size();
+    cursor = replacement.offset + replacement.old_string.size();
+  }
+  if (!copy_region(source, cursor, source.size() - cursor, out)) {
+    return R::failure("Failed to write temporary file");
+  }
+  return R::success(written + source.size() - cursor);
 }
 
 } // namespace
@@ -35,11 +160,11 @@ FileEditTool::FileEditTool(std::shared_ptr<security::SecurityPolicy> policy) : p
 std::string_view FileEditTool::name() const { return "file_edit"; }
 
 std::string_view FileEditTool::description() const {
-  return "Replace a unique substring in a text file";
+  return "Replace unique substrings in a text file, atomically";
 }
 
 std::string FileEditTool::parameters_schema() const {
-  return R"({"type":"object","required":["path","old_string","new_string"],"properties":{"path":{"type":"string"},"old_string":{"type":"string"},"new_string":{"type":"string"}}})";
+  return R"({"type":"object","required":["path"],"properties":{"path":{"type":"string"},"old_string":{"type":"string"},"new_string":{"type":"string"},"edits":{"type":"string","description":"JSON array of {\"old_string\",\"new_string\"} objects applied together; each old_string must be unique"}}})";
 }
 
 common::Result<ToolResult> FileEditTool::execute(const ToolArgs &args, const ToolContext &ctx) {
@@ -52,56 +177,74 @@ common::Result<ToolResult> FileEditTool::execute(const ToolArgs &args, const Too
   }
 
   auto path_arg = required_arg(args, "path");
-  auto old_arg = required_arg(args, "old_string");
-  auto new_arg = required_arg(args, "new_string");
-  if (!path_arg.ok() || !old_arg.ok() || !new_arg.ok()) {
+  if (!path_arg.ok()) {
     return common::Result<ToolResult>::failure("Missing required arguments");
   }
-
-  const auto effective_policy = scoped_policy(*policy_, ctx);
-  auto validated = security::validate_path(path_arg.value(), effective_policy);
-  if (!validated.ok()) {
-    return common::Result<ToolResult>::failure(validated.error());
+  auto replacements = collect_replacements(args);
+  if (!replacements.ok()) {
+    return common::Result<ToolResult>::failure(replacements.error());
   }
 
-  std::ifstream in(validated.value());
-  if (!in) {
+  auto root = workspace_root(*policy_, ctx);
+  if (!root.ok()) {
+    return common::Result<ToolResult>::failure(root.error());
+  }
+  auto resolved = root.value()->resolve(path_arg.value(), *policy_);
+  if (!resolved.ok()) {
+    return common::Result<ToolResult>::failure(resolved.error());
+  }
+  auto source_fd = root.value()->open(resolved.value(), O_RDONLY);
+  if (!source_fd.ok()) {
+    return common::Result<ToolResult>::failure(source_fd.error());
+  }
+  auto source = FileView::adopt(source_fd.value(), resolved.value().absolute);
+  if (!source.ok()) {
     return common::Result<ToolResult>::failure("Failed to read target file");
   }
-  std::stringstream buffer;
-  buffer << in.rdbuf();
-  std::string content = buffer.str();
-
-  const auto first = content.find(old_arg.value());
-  if (first == std::string::npos) {
-    return common::Result<ToolResult>::failure("old_string not found");
+  auto located = locate_replacements(source.value().data(), replacements.value());
+  if (!located.ok()) {
+    return common::Result<ToolResult>::failure(located.error());
   }
 
-  const auto second = content.find(old_arg.value(), first + old_arg.value().size());
-  if (second != std::string::npos) {
-    return common::Result<ToolResult>::failure("old_string must be unique");
+  auto dir = root.value()->open_parent(resolved.value(), false);
+  if (!dir.ok()) {
+    return common::Result<ToolResult>::failure(dir.error());
   }
-
-  content.replace(first, old_arg.value().size(), new_arg.value());
-
-  const auto temp_path = validated.value().string() + ".tmp";
-  std::ofstream out(temp_path, std::ios::trunc);
-  if (!out) {
+  const std::string name = resolved.value().absolute.filename().string();
+  const auto mode = static_cast<mode_t>(source.value().mode());
+  auto temp = security::create_temp_file(dir.value(), name, mode);
+  if (!temp.ok()) {
+    ::close(dir.value());
+    return common::Result<ToolResult>::failure("Failed to write temporary file");
+  }
+  ::fchmod(temp.value().fd, mode);
+  auto written = write_edited(source.value(), replacements.value(), temp.value().fd);
+  const bool closed = ::close(temp.value().fd) == 0;
+  if (!written.ok() || !closed) {
+    ::unlinkat(dir.value(), temp.value().name.c_str(), 0);
+    ::close(dir.value());
     return common::Result<ToolResult>::failure("Failed to write temporary file");
   }
-  out << content;
-  out.close();
 
-  std::error_code ec;
-  std::filesystem::rename(temp_path, validated.value(), ec);
-  if (ec) {
+  const bool renamed =
+      ::renameat(dir.value(), temp.value().name.c_str(), dir.value(), name.c_str()) == 0;
+  if (!renamed) {
+    ::unlinkat(dir.value(), temp.value().name.c_str(), 0);
+  }
+  ::close(dir.value());
+  if (!renamed) {
     return common::Result<ToolResult>::failure("Failed to replace file");
   }
 
   policy_->record_action();
 
   ToolResult result;
-  result.output = "File edited: " + validated.value().string();
+  result.output = "File edited: " + resolved.value().absolute.string();
+  if (replacements.value().size() > 1) {
+    result.output += " (" + std::to_string(replacements.value().size()) + " edits)";
+  }
+  result.metadata["edits"] = std::to_string(replacements.value().size());
+  result.metadata["bytes"] = std::to_string(written.value());
   return common::Result<ToolResult>::success(std::move(result));
 }
 
@@ -1,14 +1,21 @@
 #include "ghostclaw/tools/builtin/file_read.hpp"
 
-#include <array>
-#include <filesystem>
-#include <fstream>
-#include <sstream>
+#include "ghostclaw/security/path_resolver.hpp"
+#include "ghostclaw/tools/file_view.hpp"
+#include "ghostclaw/tools/result_cache.hpp"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <optional>
+#include <sys/stat.h>
 
 namespace ghostclaw::tools {
 
 namespace {
 
+constexpr std::size_t kMaxReadBytes = 20 * 1024;
+constexpr std::size_t kBinaryProbeBytes = 8192;
+
 common::Result<std::string> required_arg(const ToolArgs &args, const std::string &name) {
   const auto it = args.find(name);
   if (it == args.end() || it->second.empty()) {
@@ -17,33 +24,28 @@ common::Result<std::string> required_arg(const ToolArgs &args, const std::string
   return common::Result<std::string>::success(it->second);
 }
 
-bool is_binary_file(const std::filesystem::path &path) {
-  std::ifstream in(path, std::ios::binary);
-  if (!in) {
-    return false;
+common::Result<std::optional<std::size_t>> optional_count(const ToolArgs &args,
+                                                          const std::string &name) {
+  using R = common::Result<std::optional<std::size_t>>;
+  const auto it = args.find(name);
+  if (it == args.end() || it->second.empty()) {
+    return R::success(std::nullopt);
   }
-
-  std::array<char, 8192> buffer{};
-  in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
-  const auto count = in.gcount();
-  for (std::streamsize i = 0; i < count; ++i) {
-    if (buffer[static_cast<std::size_t>(i)] == '\0') {
-      return true;
-    }
+  if (!std::all_of(it->second.begin(), it->second.end(),
+                   [](const char ch) { return ch >= '0' && ch <= '9'; })) {
+    return R::failure("Invalid argument: " + name + " must be a non-negative integer");
+  }
+  try {
+    return R::success(static_cast<std::size_t>(std::stoull(it->second)));
+  } catch (...) {
+    return R::failure("Invalid argument: " + name + " is out of range");
   }
-  return false;
 }
 
-security::SecurityPolicy scoped_policy(const security::SecurityPolicy &policy,
-                                       const tools::ToolContext &ctx) {
-  security::SecurityPolicy copy = policy;
-  if (!ctx.workspace_path.empty()) {
-    std::error_code ec;
-    std::filesystem::create_directories(ctx.workspace_path, ec);
-    auto canonical = std::filesystem::weakly_canonical(ctx.workspace_path, ec);
-    copy.workspace_dir = ec ? ctx.workspace_path : canonical;
-  }
-  return copy;
+common::Result<std::shared_ptr<const security::WorkspaceRoot>>
+workspace_root(const security::SecurityPolicy &policy, const tools::ToolContext &ctx) {
+  return security::PathResolver::shared().root(ctx.workspace_path.empty() ? policy.workspace_dir
+                                                                          : ctx.workspace_path);
 }
 
 } // namespace
@@ -52,10 +54,12 @@ FileReadTool::FileReadTool(std::shared_ptr<security::SecurityPolicy> policy) : p
 
 std::string_view FileReadTool::name() const { return "file_read"; }
 
-std::string_view FileReadTool::description() const { return "Read a UTF-8 text file"; }
+std::string_view FileReadTool::description() const {
+  return "Read a UTF-8 text file, or a byte or line range of it";
+}
 
 std::string FileReadTool::parameters_schema() const {
-  return R"({"type":"object","required":["path"],"properties":{"path":{"type":"string"}}})";
+  return R"({"type":"object","required":["path"],"properties":{"path":{"type":"string"},"offset":{"type":"integer","description":"byte offset to start at"},"limit":{"type":"integer","description":"bytes to read"},"start_line":{"type":"integer","description":"1-based first line"},"line_count":{"type":"integer","description":"lines to read from start_line"},"tail_lines":{"type":"integer","description":"read the last N lines"}}})";
 }
 
 common::Result<ToolResult> FileReadTool::execute(const ToolArgs &args, const ToolContext &ctx) {
@@ -68,31 +72,82 @@ common::Result<ToolResult> FileReadTool::execute(const ToolArgs &args, const Too
     return common::Result<ToolResult>::failure(path_arg.error());
   }
 
-  const auto effective_policy = scoped_policy(*policy_, ctx);
-  auto validated = security::validate_path(path_arg.value(), effective_policy);
-  if (!validated.ok()) {
-    return common::Result<ToolResult>::failure(validated.error());
+  auto offset = optional_count(args, "offset");
+  auto limit = optional_count(args, "limit");
+  auto start_line = optional_count(args, "start_line");
+  auto line_count = optional_count(args, "line_count");
+  auto tail = optional_count(args, "tail_lines");
+  for (const auto *parsed : {&offset, &limit, &start_line, &line_count, &tail}) {
+    if (!parsed->ok()) {
+      return common::Result<ToolResult>::failure(parsed->error());
+    }
+  }
+  const bool byte_range = offset.value().has_value() || limit.value().has_value();
+  const bool line_range = start_line.value().has_value() || line_count.value().has_value();
+  if (static_cast<int>(byte_range) + static_cast<int>(line_range) +
+          static_cast<int>(tail.value().has_value()) >
+      1) {
+    return common::Result<ToolResult>::failure(
+        "offset/limit, start_line/line_count and tail_lines cannot be combined");
+  }
+  if (start_line.value().has_value() && *start_line.value() == 0) {
+    return common::Result<ToolResult>::failure("start_line is 1-based");
   }
 
-  if (is_binary_file(validated.value())) {
-    return common::Result<ToolResult>::failure("Binary file read is not allowed");
+  auto root = workspace_root(*policy_, ctx);
+  if (!root.ok()) {
+    return common::Result<ToolResult>::failure(root.error());
+  }
+  auto resolved = root.value()->resolve(path_arg.value(), *policy_);
+  if (!resolved.ok()) {
+    return common::Result<ToolResult>::failure(resolved.error());
+  }
+  auto fd = root.value()->open(resolved.value(), O_RDONLY);
+  if (!fd.ok()) {
+    return common::Result<ToolResult>::failure(fd.error());
   }
 
-  std::ifstream in(validated.value());
-  if (!in) {
-    return common::Result<ToolResult>::failure("Failed to open file");
+  auto view = FileView::adopt(fd.value(), resolved.value().absolute);
+  if (!view.ok()) {
+    return common::Result<ToolResult>::failure(view.error());
+  }
+  const auto data = view.value().data();
+  if (data.substr(0, kBinaryProbeBytes).find('\0') != std::string_view::npos) {
+    return common::Result<ToolResult>::failure("Binary file read is not allowed");
   }
 
-  std::stringstream buffer;
-  buffer << in.rdbuf();
-  std::string content = buffer.str();
+  LineSpan span;
+  if (tail.value().has_value()) {
+    span = tail_lines(view.value(), *tail.value());
+  } else if (line_range) {
+    span = locate_lines(view.value(), start_line.value().value_or(1),
+                        line_count.value().value_or(0));
+  } else {
+    span.begin = std::min(offset.value().value_or(0), data.size());
+    const std::size_t available = data.size() - span.begin;
+    span.end = span.begin + std::min(limit.value().value_or(available), available);
+  }
 
   ToolResult result;
-  if (content.size() > 20 * 1024) {
-    content.resize(20 * 1024);
+  std::size_t end = span.end;
+  if (end - span.begin > kMaxReadBytes) {
+    end = span.begin + kMaxReadBytes;
     result.truncated = true;
+    result.metadata["next_offset"] = std::to_string(end);
+  }
+  result.output.assign(data.substr(span.begin, end - span.begin));
+  result.metadata["file_size"] = std::to_string(data.size());
+  result.metadata["offset"] = std::to_string(span.begin);
+  result.metadata["bytes"] = std::to_string(result.output.size());
+  if (span.first_line != 0 && !result.output.empty()) {
+    auto newlines = static_cast<std::size_t>(
+        std::count(result.output.begin(), result.output.end(), '\n'));
+    if (result.output.back() == '\n') {
+      --newlines;
+    }
+    result.metadata["start_line"] = std::to_string(span.first_line);
+    result.metadata["end_line"] = std::to_string(span.first_line + newlines);
   }
-  result.output = std::move(content);
   return common::Result<ToolResult>::success(std::move(result));
 }
 
@@ -100,4 +155,35 @@ bool FileReadTool::is_safe() const { return true; }
 
 std::string_view FileReadTool::group() const { return "fs"; }
 
+std::optional<ToolCachePolicy> FileReadTool::cache_policy(const ToolArgs &args,
+                                                          const ToolContext &ctx) const {
+  const auto path_it = args.find("path");
+  if (!policy_ || path_it == args.end()) {
+    return std::nullopt;
+  }
+  auto root = workspace_root(*policy_, ctx);
+  if (!root.ok()) {
+    return std::nullopt;
+  }
+  auto resolved = root.value()->resolve(path_it->second, *policy_);
+  if (!resolved.ok()) {
+    return std::nullopt;
+  }
+  struct stat st {};
+  if (::stat(resolved.value().absolute.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+    return std::nullopt;
+  }
+#if defined(__APPLE__)
+  const auto &mtime = st.st_mtimespec;
+#else
+  const auto &mtime = st.st_mtim;
+#endif
+  // Any write moves mtime or size; the inode catches files replaced by rename.
+  return ToolCachePolicy{
+      .key = resolved.value().absolute.string() + '\n' + canonical_args(args),
+      .version = std::to_string(st.st_ino) + ':' + std::to_string(mtime.tv_sec) + '.' +
+                 std::to_string(mtime.tv_nsec) + ':' + std::to_string(st.st_size),
+      .ttl = {}};
+}
+
 } // namespace ghostclaw::tools
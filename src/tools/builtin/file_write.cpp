@@ -1,7 +1,9 @@
 #include "ghostclaw/tools/builtin/file_write.hpp"
 
-#include <filesystem>
-#include <fstream>
+#include "ghostclaw/security/path_resolver.hpp"
+
+#include <cerrno>
+#include <unistd.h>
 
 namespace ghostclaw::tools {
 
@@ -15,16 +17,25 @@ common::Result<std::string> required_arg(const ToolArgs &args, const std::string
   return common::Result<std::string>::success(it->second);
 }
 
-security::SecurityPolicy scoped_policy(const security::SecurityPolicy &policy,
-                                       const tools::ToolContext &ctx) {
-  security::SecurityPolicy copy = policy;
-  if (!ctx.workspace_path.empty()) {
-    std::error_code ec;
-    std::filesystem::create_directories(ctx.workspace_path, ec);
-    auto canonical = std::filesystem::weakly_canonical(ctx.workspace_path, ec);
-    copy.workspace_dir = ec ? ctx.workspace_path : canonical;
+common::Result<std::shared_ptr<const security::WorkspaceRoot>>
+workspace_root(const security::SecurityPolicy &policy, const tools::ToolContext &ctx) {
+  return security::PathResolver::shared().root(ctx.workspace_path.empty() ? policy.workspace_dir
+                                                                          : ctx.workspace_path);
+}
+
+bool write_all(const int fd, const char *data, std::size_t size) {
+  while (size > 0) {
+    const auto written = ::write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += written;
+    size -= static_cast<std::size_t>(written);
   }
-  return copy;
+  return true;
 }
 
 } // namespace
@@ -58,35 +69,52 @@ common::Result<ToolResult> FileWriteTool::execute(const ToolArgs &args, const To
     return common::Result<ToolResult>::failure(content_arg.error());
   }
 
-  const auto effective_policy = scoped_policy(*policy_, ctx);
-  auto validated = security::validate_path(path_arg.value(), effective_policy);
-  if (!validated.ok()) {
-    return common::Result<ToolResult>::failure(validated.error());
+  auto root = workspace_root(*policy_, ctx);
+  if (!root.ok()) {
+    return common::Result<ToolResult>::failure(root.error());
   }
-
-  std::error_code ec;
-  std::filesystem::create_directories(validated.value().parent_path(), ec);
-  if (ec) {
-    return common::Result<ToolResult>::failure("Failed to create parent directory");
+  auto resolved = root.value()->resolve(path_arg.value(), *policy_);
+  if (!resolved.ok()) {
+    return common::Result<ToolResult>::failure(resolved.error());
+  }
+  const std::string name = resolved.value().absolute.filename().string();
+  if (name.empty() || name == "." || name == "..") {
+    return common::Result<ToolResult>::failure("Path must name a file");
   }
 
-  const auto temp_path = validated.value().string() + ".tmp";
-  std::ofstream out(temp_path, std::ios::trunc);
-  if (!out) {
+  // The temp file and the rename go through the held parent directory, so the file lands
+  // in the directory that was resolved even if a path component is swapped meanwhile.
+  auto dir = root.value()->open_parent(resolved.value(), true);
+  if (!dir.ok()) {
+    return common::Result<ToolResult>::failure("Failed to create parent directory: " + dir.error());
+  }
+  auto temp = security::create_temp_file(dir.value(), name, 0666);
+  if (!temp.ok()) {
+    ::close(dir.value());
     return common::Result<ToolResult>::failure("Failed to open temporary file");
   }
-  out << content_arg.value();
-  out.close();
-
-  std::filesystem::rename(temp_path, validated.value(), ec);
-  if (ec) {
+  const auto &content = content_arg.value();
+  const bool written = write_all(temp.value().fd, content.data(), content.size());
+  const bool closed = ::close(temp.value().fd) == 0;
+  if (!written || !closed) {
+    ::unlinkat(dir.value(), temp.value().name.c_str(), 0);
+    ::close(dir.value());
+    return common::Result<ToolResult>::failure("Failed to write temporary file");
+  }
+  const bool renamed =
+      ::renameat(dir.value(), temp.value().name.c_str(), dir.value(), name.c_str()) == 0;
+  if (!renamed) {
+    ::unlinkat(dir.value(), temp.value().name.c_str(), 0);
+  }
+  ::close(dir.value());
+  if (!renamed) {
     return common::Result<ToolResult>::failure("Failed to atomically replace file");
   }
 
   policy_->record_action();
 
   ToolResult result;
-  result.output = "File written: " + validated.value().string();
+  result.output = "File written: " + resolved.value().absolute.string();
   return common::Result<ToolResult>::success(std::move(result));
 }
 
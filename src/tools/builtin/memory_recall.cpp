@@ -1,5 +1,7 @@
 #include "ghostclaw/tools/builtin/memory_recall.hpp"
 
+#include "ghostclaw/tools/result_cache.hpp"
+
 #include <sstream>
 
 namespace ghostclaw::tools {
@@ -55,4 +57,19 @@ bool MemoryRecallTool::is_safe() const { return true; }
 
 std::string_view MemoryRecallTool::group() const { return "memory"; }
 
+std::optional<ToolCachePolicy> MemoryRecallTool::cache_policy(const ToolArgs &args,
+                                                              const ToolContext &) const {
+  if (memory_ == nullptr) {
+    return std::nullopt;
+  }
+  const auto epoch = memory_->write_epoch();
+  if (!epoch.has_value()) {
+    return std::nullopt;
+  }
+  // Epochs are unique per process, so the backend itself need not be part of the key.
+  // The TTL bounds drift of recency-weighted scores.
+  return ToolCachePolicy{
+      .key = canonical_args(args), .version = std::to_string(*epoch), .ttl = std::chrono::minutes(1)};
+}
+
 } // namespace ghostclaw::tools
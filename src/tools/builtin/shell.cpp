@@ -1,5 +1,6 @@
 #include "ghostclaw/tools/builtin/shell.hpp"
 
+#include <algorithm>
 #include <array>
 #include <chrono>
 #include <csignal>
@@ -14,7 +15,17 @@ namespace ghostclaw::tools {
 
 namespace {
 
-constexpr std::size_t kMaxOutputBytes = 1024 * 1024;
+// What goes back to the model: the start and the end of the output, since that is where
+// commands print what they are doing and how it ended.
+constexpr std::size_t kCaptureHeadBytes = 32 * 1024;
+constexpr std::size_t kCaptureTailBytes = 32 * 1024;
+
+// Live output: complete lines, batched, at about kStreamLinesPerSecond with bursts up to
+// kStreamBurstLines. Lines over budget are dropped from the stream (not from the capture).
+constexpr auto kStreamFlushInterval = std::chrono::milliseconds(200);
+constexpr double kStreamLinesPerSecond = 50.0;
+constexpr double kStreamBurstLines = 100.0;
+constexpr std::size_t kStreamMaxLineBytes = 2048;
 
 common::Result<std::string> required_arg(const ToolArgs &args, const std::string &name) {
   const auto it = args.find(name);
@@ -24,6 +35,123 @@ common::Result<std::string> required_arg(const ToolArgs &args, const std::string
   return common::Result<std::string>::success(it->second);
 }
 
+// Keeps the first and last bytes of a command's output; the middle is only counted.
+class HeadTailCapture {
+public:
+  void append(std::string_view data) {
+    total_ += data.size();
+    if (head_.size() < kCaptureHeadBytes) {
+      const auto take = std::min(kCaptureHeadBytes - head_.size(), data.size());
+      head_.append(data.substr(0, take));
+      data.remove_prefix(take);
+    }
+    tail_.append(data);
+    if (tail_.size() > 2 * kCaptureTailBytes) {
+      tail_.erase(0, tail_.size() - kCaptureTailBytes);
+    }
+  }
+
+  [[nodiscard]] std::size_t omitted() const {
+    return total_ - head_.size() - std::min(tail_.size(), kCaptureTailBytes);
+  }
+
+  [[nodiscard]] std::string str() const {
+    const std::string_view tail =
+        std::string_view(tail_).substr(tail_.size() - std::min(tail_.size(), kCaptureTailBytes));
+    if (omitted() == 0) {
+      return head_ + std::string(tail);
+    }
+    return head_ + "\n[... " + std::to_string(omitted()) + " bytes omitted ...]\n" +
+           std::string(tail);
+  }
+
+private:
+  std::string head_;
+  std::string tail_;
+  std::size_t total_ = 0;
+};
+
+// Turns raw pipe reads into ToolOutputChunks for ctx.on_output.
+class OutputStreamer {
+public:
+  explicit OutputStreamer(const ToolContext &ctx)
+      : on_output_(ctx.on_output), last_refill_(std::chrono::steady_clock::now()),
+        last_flush_(last_refill_) {}
+
+  [[nodiscard]] bool enabled() const { return static_cast<bool>(on_output_); }
+
+  void feed(const std::size_t stream, std::string_view data) {
+    auto &pending = streams_[stream];
+    pending.partial.append(data);
+    std::size_t start = 0;
+    while (true) {
+      const auto newline = pending.partial.find('\n', start);
+      if (newline == std::string::npos) {
+        break;
+      }
+      take_line(pending, std::string_view(pending.partial).substr(start, newline - start));
+      start = newline + 1;
+    }
+    pending.partial.erase(0, start);
+    if (pending.partial.size() > kStreamMaxLineBytes) {
+      take_line(pending, pending.partial);
+      pending.partial.clear();
+    }
+  }
+
+  void flush(const bool final) {
+    const auto now = std::chrono::steady_clock::now();
+    if (!final && now - last_flush_ < kStreamFlushInterval) {
+      return;
+    }
+    last_flush_ = now;
+    for (std::size_t i = 0; i < streams_.size(); ++i) {
+      auto &pending = streams_[i];
+      if (final && !pending.partial.empty()) {
+        take_line(pending, pending.partial);
+        pending.partial.clear();
+      }
+      if (pending.batch.empty() && pending.skipped == 0) {
+        continue;
+      }
+      on_output_(ToolOutputChunk{.call_id = {},
+                                 .tool = {},
+                                 .stream = i == 0 ? "stdout" : "stderr",
+                                 .text = std::move(pending.batch),
+                                 .skipped_lines = pending.skipped});
+      pending.batch.clear();
+      pending.skipped = 0;
+    }
+  }
+
+private:
+  struct Pending {
+    std::string partial;
+    std::string batch;
+    std::size_t skipped = 0;
+  };
+
+  void take_line(Pending &pending, std::string_view line) {
+    const auto now = std::chrono::steady_clock::now();
+    const std::chrono::duration<double> elapsed = now - last_refill_;
+    last_refill_ = now;
+    tokens_ = std::min(kStreamBurstLines, tokens_ + elapsed.count() * kStreamLinesPerSecond);
+    if (tokens_ < 1.0) {
+      ++pending.skipped;
+      return;
+    }
+    tokens_ -= 1.0;
+    pending.batch.append(line.substr(0, kStreamMaxLineBytes));
+    pending.batch.push_back('\n');
+  }
+
+  std::function<void(const ToolOutputChunk &)> on_output_;
+  std::array<Pending, 2> streams_;
+  double tokens_ = kStreamBurstLines;
+  std::chrono::steady_clock::time_point last_refill_;
+  std::chrono::steady_clock::time_point last_flush_;
+};
+
 } // namespace
 
 ShellTool::ShellTool(std::shared_ptr<security::SecurityPolicy> policy) : policy_(std::move(policy)) {}
@@ -55,23 +183,35 @@ common::Result<ToolResult> ShellTool::execute(const ToolArgs &args, const ToolCo
     return common::Result<ToolResult>::failure("Rate limit exceeded");
   }
 
-  int pipefd[2] = {-1, -1};
-  if (pipe(pipefd) != 0) {
+  // stdout and stderr get separate pipes so live output can say which is which.
+  int out_pipe[2] = {-1, -1};
+  int err_pipe[2] = {-1, -1};
+  if (pipe(out_pipe) != 0) {
+    return common::Result<ToolResult>::failure("Failed to create pipe");
+  }
+  if (pipe(err_pipe) != 0) {
+    close(out_pipe[0]);
+    close(out_pipe[1]);
     return common::Result<ToolResult>::failure("Failed to create pipe");
   }
 
   const pid_t pid = fork();
   if (pid < 0) {
-    close(pipefd[0]);
-    close(pipefd[1]);
+    for (const int fd : {out_pipe[0], out_pipe[1], err_pipe[0], err_pipe[1]}) {
+      close(fd);
+    }
     return common::Result<ToolResult>::failure("Failed to fork");
   }
 
   if (pid == 0) {
-    close(pipefd[0]);
-    dup2(pipefd[1], STDOUT_FILENO);
-    dup2(pipefd[1], STDERR_FILENO);
-    close(pipefd[1]);
+    // Own process group so timeout and cancellation also reach grandchildren.
+    setpgid(0, 0);
+    close(out_pipe[0]);
+    close(err_pipe[0]);
+    dup2(out_pipe[1], STDOUT_FILENO);
+    dup2(err_pipe[1], STDERR_FILENO);
+    close(out_pipe[1]);
+    close(err_pipe[1]);
 
     if (!ctx.workspace_path.empty()) {
       (void)chdir(ctx.workspace_path.c_str());
@@ -81,14 +221,36 @@ common::Result<ToolResult> ShellTool::execute(const ToolArgs &args, const ToolCo
     _exit(127);
   }
 
-  close(pipefd[1]);
-  const int flags = fcntl(pipefd[0], F_GETFL, 0);
-  fcntl(pipefd[0], F_SETFL, flags | O_NONBLOCK);
+  setpgid(pid, pid);
+  close(out_pipe[1]);
+  close(err_pipe[1]);
+  const std::array<int, 2> read_fds = {out_pipe[0], err_pipe[0]};
+  for (const int fd : read_fds) {
+    const int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+  }
 
-  std::string output;
-  output.reserve(4096);
-  bool truncated = false;
+  HeadTailCapture capture;
+  OutputStreamer streamer(ctx);
   bool timeout = false;
+  // Kill from the cancelling thread so the child dies without waiting for our poll tick.
+  // The subscription is dropped before the child is reaped, so the pid cannot be reused.
+  common::CancelSubscription kill_on_cancel(ctx.cancel_token, [pid]() { kill(-pid, SIGKILL); });
+
+  // Reads whatever is available on one pipe; false once it has nothing more to give.
+  std::array<char, 4096> buffer{};
+  const auto read_available = [&](const std::size_t stream) {
+    const ssize_t bytes = read(read_fds[stream], buffer.data(), buffer.size());
+    if (bytes <= 0) {
+      return false;
+    }
+    const std::string_view data(buffer.data(), static_cast<std::size_t>(bytes));
+    capture.append(data);
+    if (streamer.enabled()) {
+      streamer.feed(stream, data);
+    }
+    return true;
+  };
 
   const auto started = std::chrono::steady_clock::now();
   const auto timeout_limit = std::chrono::milliseconds(timeout_ms());
@@ -98,65 +260,69 @@ common::Result<ToolResult> ShellTool::execute(const ToolArgs &args, const ToolCo
   while (running) {
     const auto now = std::chrono::steady_clock::now();
     if (now - started > timeout_limit) {
-      kill(pid, SIGKILL);
+      kill(-pid, SIGKILL);
       timeout = true;
       running = false;
       break;
     }
+    if (common::is_cancelled(ctx.cancel_token)) {
+      kill(-pid, SIGKILL);
+      running = false;
+      break;
+    }
 
-    struct pollfd pfd {
-      .fd = pipefd[0], .events = POLLIN, .revents = 0,
-    };
-    (void)poll(&pfd, 1, 50);
-
-    std::array<char, 4096> buffer{};
-    const ssize_t bytes = read(pipefd[0], buffer.data(), buffer.size());
-    if (bytes > 0) {
-      const std::size_t remaining =
-          kMaxOutputBytes > output.size() ? kMaxOutputBytes - output.size() : 0;
-      const std::size_t to_copy = std::min<std::size_t>(remaining, static_cast<std::size_t>(bytes));
-      output.append(buffer.data(), to_copy);
-      if (to_copy < static_cast<std::size_t>(bytes) || output.size() >= kMaxOutputBytes) {
-        truncated = true;
+    std::array<pollfd, 2> pfds{};
+    for (std::size_t i = 0; i < read_fds.size(); ++i) {
+      pfds[i] = {.fd = read_fds[i], .events = POLLIN, .revents = 0};
+    }
+    (void)poll(pfds.data(), pfds.size(), 50);
+    for (std::size_t i = 0; i < read_fds.size(); ++i) {
+      if (pfds[i].revents != 0) {
+        (void)read_available(i);
       }
     }
+    if (streamer.enabled()) {
+      streamer.flush(false);
+    }
 
-    const pid_t done = waitpid(pid, &status, WNOHANG);
-    if (done == pid) {
+    // Peek without reaping; the child is reaped once the cancel subscription is gone.
+    siginfo_t info{};
+    if (waitid(P_PID, static_cast<id_t>(pid), &info, WEXITED | WNOHANG | WNOWAIT) == 0 &&
+        info.si_pid == pid) {
       running = false;
     }
   }
 
   // Drain remaining output.
-  std::array<char, 4096> buffer{};
-  while (true) {
-    const ssize_t bytes = read(pipefd[0], buffer.data(), buffer.size());
-    if (bytes <= 0) {
-      break;
-    }
-    const std::size_t remaining = kMaxOutputBytes > output.size() ? kMaxOutputBytes - output.size() : 0;
-    const std::size_t to_copy = std::min<std::size_t>(remaining, static_cast<std::size_t>(bytes));
-    output.append(buffer.data(), to_copy);
-    if (to_copy < static_cast<std::size_t>(bytes) || output.size() >= kMaxOutputBytes) {
-      truncated = true;
+  for (std::size_t i = 0; i < read_fds.size(); ++i) {
+    while (read_available(i)) {
     }
+    close(read_fds[i]);
+  }
+  if (streamer.enabled()) {
+    streamer.flush(true);
   }
 
-  close(pipefd[0]);
+  kill_on_cancel.reset();
+  // The subscription may have killed the child before the loop saw the token.
+  const bool cancelled = !timeout && common::is_cancelled(ctx.cancel_token);
   waitpid(pid, &status, 0);
 
   policy_->record_action();
 
   ToolResult result;
-  result.output = output;
-  result.truncated = truncated;
-  if (truncated) {
-    result.output += "\n[output truncated]";
+  result.output = capture.str();
+  result.truncated = capture.omitted() > 0;
+  if (result.truncated) {
+    result.metadata["omitted_bytes"] = std::to_string(capture.omitted());
   }
 
   if (timeout) {
     result.success = false;
     result.output += "\n[command timed out]";
+  } else if (cancelled) {
+    result.success = false;
+    result.output += "\n[command cancelled]";
   } else {
     result.success = WIFEXITED(status) && (WEXITSTATUS(status) == 0);
     result.metadata["exit_code"] =
@@ -0,0 +1,107 @@
+#include "ghostclaw/tools/builtin/tool_output.hpp"
+
+#include "ghostclaw/common/fs.hpp"
+#include "ghostclaw/tools/output_store.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+namespace ghostclaw::tools {
+
+namespace {
+
+constexpr std::size_t kDefaultLimit = 200;
+constexpr std::size_t kMaxOutputBytes = 16 * 1024;
+
+std::size_t parse_count(const ToolArgs &args, const std::string &name, const std::size_t fallback) {
+  const auto it = args.find(name);
+  if (it == args.end()) {
+    return fallback;
+  }
+  try {
+    return static_cast<std::size_t>(std::stoull(it->second));
+  } catch (...) {
+    return fallback;
+  }
+}
+
+std::vector<std::string> split_lines(const std::string &content) {
+  std::vector<std::string> lines;
+  std::istringstream in(content);
+  std::string line;
+  while (std::getline(in, line)) {
+    lines.push_back(std::move(line));
+  }
+  return lines;
+}
+
+} // namespace
+
+std::string_view ToolOutputTool::name() const { return "tool_output"; }
+
+std::string_view ToolOutputTool::description() const {
+  return "Read a stored tool output by handle: page by line offset/limit or filter lines by "
+         "pattern";
+}
+
+std::string ToolOutputTool::parameters_schema() const {
+  return R"({"type":"object","required":["handle"],"properties":{"handle":{"type":"string"},"offset":{"type":"integer","description":"first line, 1-based"},"limit":{"type":"integer"},"pattern":{"type":"string","description":"case-insensitive substring; only matching lines are returned"}}})";
+}
+
+common::Result<ToolResult> ToolOutputTool::execute(const ToolArgs &args, const ToolContext &ctx) {
+  const auto handle_it = args.find("handle");
+  if (handle_it == args.end() || common::trim(handle_it->second).empty()) {
+    return common::Result<ToolResult>::failure("Missing argument: handle");
+  }
+
+  ToolOutputStore store(ToolOutputStore::default_root(ctx.workspace_path));
+  auto content = store.get(ctx.session_id, common::trim(handle_it->second));
+  if (!content.ok()) {
+    return common::Result<ToolResult>::failure(content.error());
+  }
+
+  const auto lines = split_lines(content.value());
+  const std::size_t offset = std::max<std::size_t>(1, parse_count(args, "offset", 1));
+  const std::size_t limit = std::max<std::size_t>(1, parse_count(args, "limit", kDefaultLimit));
+  const auto pattern_it = args.find("pattern");
+  const std::string pattern =
+      pattern_it == args.end() ? "" : common::to_lower(common::trim(pattern_it->second));
+
+  ToolResult result;
+  std::ostringstream out;
+  std::size_t shown = 0;
+  std::size_t last = 0;
+  for (std::size_t i = offset - 1; i < lines.size() && shown < limit; ++i) {
+    if (!pattern.empty() && common::to_lower(lines[i]).find(pattern) == std::string::npos) {
+      continue;
+    }
+    if (static_cast<std::size_t>(out.tellp()) + lines[i].size() > kMaxOutputBytes) {
+      result.truncated = true;
+      break;
+    }
+    out << (i + 1) << ": " << lines[i] << "\n";
+    ++shown;
+    last = i + 1;
+  }
+
+  if (shown == 0) {
+    out << (pattern.empty() ? "[no lines" : "[no matching lines") << " from line " << offset
+        << " of " << lines.size() << "]";
+  } else {
+    out << "[" << (pattern.empty() ? "lines " : "matches in lines ") << offset << "-" << last
+        << " of " << lines.size();
+    if (last < lines.size()) {
+      out << "; continue with offset=" << (last + 1);
+    }
+    out << "]";
+  }
+  result.output = out.str();
+  return common::Result<ToolResult>::success(std::move(result));
+}
+
+bool ToolOutputTool::is_safe() const { return true; }
+
+std::string_view ToolOutputTool::group() const { return "sessions"; }
+
+} // namespace ghostclaw::tools
@@ -1,5 +1,7 @@
 #include "ghostclaw/tools/builtin/web_fetch.hpp"
 
+#include "ghostclaw/tools/result_cache.hpp"
+
 #include <curl/curl.h>
 
 #include <regex>
@@ -79,4 +81,9 @@ bool WebFetchTool::is_safe() const { return true; }
 
 std::string_view WebFetchTool::group() const { return "web"; }
 
+std::optional<ToolCachePolicy> WebFetchTool::cache_policy(const ToolArgs &args,
+                                                          const ToolContext &) const {
+  return ToolCachePolicy{.key = canonical_args(args), .version = {}, .ttl = std::chrono::minutes(5)};
+}
+
 } // namespace ghostclaw::tools
@@ -2,6 +2,7 @@
 
 #include "ghostclaw/common/fs.hpp"
 #include "ghostclaw/common/json_util.hpp"
+#include "ghostclaw/tools/result_cache.hpp"
 
 #include <curl/curl.h>
 
@@ -245,4 +246,12 @@ bool WebSearchTool::is_safe() const { return true; }
 
 std::string_view WebSearchTool::group() const { return "web"; }
 
+std::optional<ToolCachePolicy> WebSearchTool::cache_policy(const ToolArgs &args,
+                                                           const ToolContext &) const {
+  // Results shift slowly; a few minutes is enough to absorb repeated queries in a turn.
+  return ToolCachePolicy{.key = config_.provider + '\n' + canonical_args(args),
+                         .version = {},
+                         .ttl = std::chrono::minutes(5)};
+}
+
 } // namespace ghostclaw::tools
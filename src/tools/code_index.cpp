@@ -0,0 +1,633 @@
+#include "ghostclaw/tools/code_index.hpp"
+
+#include "ghostclaw/memory/workspace_walk.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <regex>
+
+namespace ghostclaw::tools {
+
+namespace {
+
+// Larger files are usually generated or data; they stay out of the index and searches.
+constexpr std::uint64_t kMaxIndexedBytes = 1024 * 1024;
+constexpr std::size_t kMaxLineChars = 240;
+// std::regex recurses once or more per character, so a long line can exhaust a thread's
+// stack (about 200 bytes a character with libstdc++; macOS gives threads 512 KiB). Longer
+// lines are left out of regex searches and counted instead.
+constexpr std::size_t kMaxRegexLineChars = 1024;
+constexpr std::size_t kMaxResults = 500;
+constexpr std::array<char, 8> kIndexMagic = {'G', 'C', 'I', 'D', 'X', '1', '\0', '\0'};
+constexpr std::array<char, 8> kJournalMagic = {'G', 'C', 'I', 'J', 'N', '1', '\0', '\0'};
+constexpr std::uint8_t kJournalPut = 1;
+constexpr std::uint8_t kJournalDrop = 2;
+// The snapshot is rewritten once the journal holds more records than this or than there
+// are indexed files, whichever is larger.
+constexpr std::size_t kMinCompactRecords = 256;
+constexpr auto kRescanInterval = std::chrono::seconds(1);
+
+char ascii_lower(const char ch) {
+  return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch - 'A' + 'a') : ch;
+}
+
+void lower_in_place(std::string &text) {
+  std::transform(text.begin(), text.end(), text.begin(),
+                 [](const char ch) { return ascii_lower(ch); });
+}
+
+std::uint32_t trigram_at(const char *data) {
+  return (static_cast<std::uint32_t>(static_cast<unsigned char>(ascii_lower(data[0]))) << 16u) |
+         (static_cast<std::uint32_t>(static_cast<unsigned char>(ascii_lower(data[1]))) << 8u) |
+         static_cast<std::uint32_t>(static_cast<unsigned char>(ascii_lower(data[2])));
+}
+
+// Distinct trigrams of `content`, sorted. A per-thread bitmap over the 2^24 possible
+// trigrams dedupes in one pass instead of sorting every occurrence.
+std::vector<std::uint32_t> trigrams_of(const std::string &content) {
+  thread_local std::vector<std::uint64_t> seen(std::size_t{1} << 18u, 0);
+  std::vector<std::uint32_t> out;
+  for (std::size_t i = 0; i + 3 <= content.size(); ++i) {
+    if (content[i] == '\n' || content[i + 1] == '\n' || content[i + 2] == '\n') {
+      continue;
+    }
+    const std::uint32_t trigram = trigram_at(content.data() + i);
+    auto &word = seen[trigram >> 6u];
+    const std::uint64_t bit = std::uint64_t{1} << (trigram & 63u);
+    if ((word & bit) == 0) {
+      word |= bit;
+      out.push_back(trigram);
+    }
+  }
+  for (const auto trigram : out) {
+    seen[trigram >> 6u] = 0;
+  }
+  std::sort(out.begin(), out.end());
+  return out;
+}
+
+void add_literal_trigrams(const std::string &literal, std::vector<std::uint32_t> &out) {
+  for (std::size_t i = 0; i + 3 <= literal.size(); ++i) {
+    out.push_back(trigram_at(literal.data() + i));
+  }
+}
+
+bool read_file(const std::filesystem::path &path, std::string &out) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return false;
+  }
+  in.seekg(0, std::ios::end);
+  out.resize(static_cast<std::size_t>(in.tellg()));
+  in.seekg(0);
+  in.read(out.data(), static_cast<std::streamsize>(out.size()));
+  out.resize(static_cast<std::size_t>(in.gcount()));
+  return true;
+}
+
+bool looks_binary(const std::string &content) {
+  return std::memchr(content.data(), '\0', std::min<std::size_t>(content.size(), 8192)) != nullptr;
+}
+
+bool under_prefix(const std::string &path, const std::string &prefix) {
+  if (prefix.empty()) {
+    return true;
+  }
+  return path.size() > prefix.size() && path.compare(0, prefix.size(), prefix) == 0 &&
+         path[prefix.size()] == '/';
+}
+
+template <typename T> void write_pod(std::ofstream &out, const T value) {
+  out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T> bool read_pod(std::ifstream &in, T &value) {
+  return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+
+void write_path(std::ofstream &out, const std::string &path) {
+  write_pod(out, static_cast<std::uint32_t>(path.size()));
+  out.write(path.data(), static_cast<std::streamsize>(path.size()));
+}
+
+bool read_path(std::ifstream &in, std::string &path) {
+  std::uint32_t size = 0;
+  if (!read_pod(in, size) || size > 4096) {
+    return false;
+  }
+  path.resize(size);
+  return static_cast<bool>(in.read(path.data(), size));
+}
+
+// IndexedFile is private to CodeIndex; these take it as a deduced type.
+template <typename File> void write_file_record(std::ofstream &out, const File &file) {
+  write_path(out, file.path);
+  write_pod(out, file.size);
+  write_pod(out, file.mtime);
+  write_pod(out, static_cast<std::uint8_t>(file.searchable ? 1 : 0));
+  write_pod(out, static_cast<std::uint32_t>(file.trigrams.size()));
+  out.write(reinterpret_cast<const char *>(file.trigrams.data()),
+            static_cast<std::streamsize>(file.trigrams.size() * sizeof(std::uint32_t)));
+}
+
+template <typename File> bool read_file_record(std::ifstream &in, File &file) {
+  std::uint8_t searchable = 0;
+  std::uint32_t trigram_count = 0;
+  if (!read_path(in, file.path) || !read_pod(in, file.size) || !read_pod(in, file.mtime) ||
+      !read_pod(in, searchable) || !read_pod(in, trigram_count) ||
+      trigram_count > (std::uint32_t{1} << 24u)) {
+    return false;
+  }
+  file.searchable = searchable != 0;
+  file.trigrams.resize(trigram_count);
+  return static_cast<bool>(
+      in.read(reinterpret_cast<char *>(file.trigrams.data()),
+              static_cast<std::streamsize>(trigram_count * sizeof(std::uint32_t))));
+}
+
+} // namespace
+
+std::vector<std::uint32_t> required_trigrams(const std::string &pattern, const bool regex) {
+  std::vector<std::uint32_t> out;
+  if (!regex) {
+    add_literal_trigrams(pattern, out);
+  } else {
+    // Collect the literal runs every match must contain. Alternation could make any run
+    // optional, so it disables narrowing; groups are skipped because a quantifier after
+    // them may make their contents optional too.
+    std::vector<std::string> runs(1);
+    const auto end_run = [&] {
+      if (!runs.back().empty()) {
+        runs.emplace_back();
+      }
+    };
+    int depth = 0;
+    for (std::size_t i = 0; i < pattern.size(); ++i) {
+      const char ch = pattern[i];
+      if (ch == '|') {
+        return {};
+      }
+      if (ch == '\\' && i + 1 < pattern.size()) {
+        const char next = pattern[++i];
+        if (depth == 0 && !std::isalnum(static_cast<unsigned char>(next))) {
+          runs.back().push_back(next);
+        } else {
+          end_run();
+        }
+        continue;
+      }
+      if (ch == '(') {
+        ++depth;
+        end_run();
+        continue;
+      }
+      if (ch == ')') {
+        depth = std::max(0, depth - 1);
+        end_run();
+        continue;
+      }
+      if (depth > 0) {
+        continue;
+      }
+      if (ch == '[') {
+        std::size_t close = i + 1;
+        if (close < pattern.size() && pattern[close] == '^') {
+          ++close;
+        }
+        if (close < pattern.size() && pattern[close] == ']') {
+          ++close;
+        }
+        while (close < pattern.size() && pattern[close] != ']') {
+          close += pattern[close] == '\\' ? 2 : 1;
+        }
+        i = close;
+        end_run();
+        continue;
+      }
+      if (ch == '*' || ch == '?' || ch == '{') {
+        // The preceding character may be absent.
+        const bool optional = ch != '{' || (i + 1 < pattern.size() && pattern[i + 1] == '0');
+        if (optional && !runs.back().empty()) {
+          runs.back().pop_back();
+        }
+        if (ch == '{') {
+          const auto close = pattern.find('}', i);
+          i = close == std::string::npos ? pattern.size() : close;
+        }
+        end_run();
+        continue;
+      }
+      if (ch == '+') {
+        end_run();
+        continue;
+      }
+      if (ch == '.' || ch == '^' || ch == '$') {
+        end_run();
+        continue;
+      }
+      runs.back().push_back(ch);
+    }
+    for (const auto &run : runs) {
+      add_literal_trigrams(run, out);
+    }
+  }
+  std::sort(out.begin(), out.end());
+  out.erase(std::unique(out.begin(), out.end()), out.end());
+  return out;
+}
+
+CodeIndex::CodeIndex(std::filesystem::path workspace, std::filesystem::path index_path)
+    : workspace_(std::move(workspace)), index_path_(std::move(index_path)) {}
+
+std::shared_ptr<CodeIndex> CodeIndex::for_workspace(const std::filesystem::path &workspace) {
+  static std::mutex mutex;
+  static std::unordered_map<std::string, std::shared_ptr<CodeIndex>> indexes;
+  std::error_code ec;
+  auto canonical = std::filesystem::weakly_canonical(workspace, ec);
+  if (ec) {
+    canonical = workspace;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  auto &index = indexes[canonical.string()];
+  if (index == nullptr) {
+    index = std::make_shared<CodeIndex>(canonical, default_path(canonical));
+  }
+  return index;
+}
+
+std::filesystem::path CodeIndex::default_path(const std::filesystem::path &workspace) {
+  return workspace / ".ghostclaw" / "code-index";
+}
+
+common::Status CodeIndex::refresh() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return refresh_locked();
+}
+
+std::size_t CodeIndex::file_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return ids_by_path_.size();
+}
+
+std::filesystem::path CodeIndex::journal_path() const {
+  return index_path_.string() + ".journal";
+}
+
+common::Status CodeIndex::refresh_locked() {
+  std::error_code ec;
+  if (!std::filesystem::is_directory(workspace_, ec)) {
+    return common::Status::error("workspace missing");
+  }
+  if (!loaded_) {
+    load_locked();
+    rebuild_postings_locked();
+    loaded_ = true;
+  }
+
+  std::vector<bool> seen(files_.size(), false);
+  std::vector<std::uint32_t> updated;
+  std::string content;
+  memory::walk_workspace(workspace_, [&](const memory::WorkspaceFile &file) {
+    const auto mtime = static_cast<std::int64_t>(file.mtime.time_since_epoch().count());
+    std::uint32_t id = 0;
+    if (const auto it = ids_by_path_.find(file.relative); it != ids_by_path_.end()) {
+      id = it->second;
+      seen[id] = true;
+      const auto &old = files_[id];
+      if (old.size == file.size && old.mtime == mtime) {
+        return;
+      }
+      remove_postings_locked(id);
+    } else if (!free_ids_.empty()) {
+      id = free_ids_.back();
+      free_ids_.pop_back();
+      seen[id] = true;
+    } else {
+      id = static_cast<std::uint32_t>(files_.size());
+      files_.emplace_back();
+      seen.push_back(true);
+    }
+    IndexedFile indexed;
+    indexed.path = file.relative;
+    indexed.size = file.size;
+    indexed.mtime = mtime;
+    if (file.size <= kMaxIndexedBytes && read_file(file.path, content) && !looks_binary(content)) {
+      indexed.trigrams = trigrams_of(content);
+      indexed.searchable = true;
+    }
+    files_[id] = std::move(indexed);
+    ids_by_path_[file.relative] = id;
+    add_postings_locked(id);
+    updated.push_back(id);
+  });
+
+  std::vector<std::string> removed;
+  for (std::uint32_t id = 0; id < files_.size(); ++id) {
+    if (seen[id] || files_[id].path.empty()) {
+      continue;
+    }
+    remove_postings_locked(id);
+    ids_by_path_.erase(files_[id].path);
+    removed.push_back(std::move(files_[id].path));
+    files_[id] = IndexedFile{};
+    free_ids_.push_back(id);
+  }
+  last_scan_ = std::chrono::steady_clock::now();
+  if (updated.empty() && removed.empty()) {
+    return common::Status::success();
+  }
+  return persist_locked(updated, removed);
+}
+
+void CodeIndex::rebuild_postings_locked() {
+  postings_.clear();
+  for (std::uint32_t id = 0; id < files_.size(); ++id) {
+    for (const auto trigram : files_[id].trigrams) {
+      postings_[trigram].push_back(id);
+    }
+  }
+}
+
+void CodeIndex::add_postings_locked(const std::uint32_t id) {
+  for (const auto trigram : files_[id].trigrams) {
+    auto &ids = postings_[trigram];
+    ids.insert(std::lower_bound(ids.begin(), ids.end(), id), id);
+  }
+}
+
+void CodeIndex::remove_postings_locked(const std::uint32_t id) {
+  for (const auto trigram : files_[id].trigrams) {
+    const auto it = postings_.find(trigram);
+    if (it == postings_.end()) {
+      continue;
+    }
+    auto &ids = it->second;
+    if (const auto pos = std::lower_bound(ids.begin(), ids.end(), id);
+        pos != ids.end() && *pos == id) {
+      ids.erase(pos);
+    }
+    if (ids.empty()) {
+      postings_.erase(it);
+    }
+  }
+}
+
+void CodeIndex::load_locked() {
+  files_.clear();
+  ids_by_path_.clear();
+  free_ids_.clear();
+  journal_records_ = 0;
+  journal_damaged_ = false;
+
+  const auto put = [this](IndexedFile file) {
+    if (const auto it = ids_by_path_.find(file.path); it != ids_by_path_.end()) {
+      files_[it->second] = std::move(file);
+      return;
+    }
+    ids_by_path_.emplace(file.path, static_cast<std::uint32_t>(files_.size()));
+    files_.push_back(std::move(file));
+  };
+
+  std::ifstream in(index_path_, std::ios::binary);
+  std::array<char, kIndexMagic.size()> magic{};
+  std::uint32_t count = 0;
+  if (in && in.read(magic.data(), magic.size()) && magic == kIndexMagic && read_pod(in, count)) {
+    for (std::uint32_t i = 0; i < count; ++i) {
+      IndexedFile file;
+      if (!read_file_record(in, file)) {
+        break;
+      }
+      put(std::move(file));
+    }
+  }
+
+  // Journal records replay over the snapshot in order. Each one describes a file as it was
+  // indexed, so a stale or cut-short journal only costs a re-index on the next refresh.
+  std::ifstream journal(journal_path(), std::ios::binary);
+  if (!journal) {
+    return;
+  }
+  if (!journal.read(magic.data(), magic.size()) || magic != kJournalMagic) {
+    journal_damaged_ = true;
+    return;
+  }
+  std::uint8_t op = 0;
+  while (read_pod(journal, op)) {
+    IndexedFile file;
+    if (op == kJournalPut && read_file_record(journal, file)) {
+      put(std::move(file));
+    } else if (op == kJournalDrop && read_path(journal, file.path)) {
+      if (const auto it = ids_by_path_.find(file.path); it != ids_by_path_.end()) {
+        files_[it->second] = IndexedFile{};
+        free_ids_.push_back(it->second);
+        ids_by_path_.erase(it);
+      }
+    } else {
+      journal_damaged_ = true;
+      return;
+    }
+    ++journal_records_;
+  }
+}
+
+common::Status CodeIndex::save_locked() {
+  std::error_code ec;
+  std::filesystem::create_directories(index_path_.parent_path(), ec);
+  const auto tmp = index_path_.string() + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      return common::Status::error("failed to write code index");
+    }
+    out.write(kIndexMagic.data(), kIndexMagic.size());
+    write_pod(out, static_cast<std::uint32_t>(ids_by_path_.size()));
+    for (const auto &file : files_) {
+      if (!file.path.empty()) {
+        write_file_record(out, file);
+      }
+    }
+    if (!out) {
+      return common::Status::error("failed to write code index");
+    }
+  }
+  std::filesystem::rename(tmp, index_path_, ec);
+  if (ec) {
+    return common::Status::error("failed to replace code index: " + ec.message());
+  }
+  std::filesystem::remove(journal_path(), ec);
+  journal_records_ = 0;
+  journal_damaged_ = false;
+  return common::Status::success();
+}
+
+common::Status CodeIndex::persist_locked(const std::vector<std::uint32_t> &updated,
+                                         const std::vector<std::string> &removed) {
+  const std::size_t records = updated.size() + removed.size();
+  std::error_code ec;
+  if (journal_damaged_ || !std::filesystem::exists(index_path_, ec) ||
+      journal_records_ + records > std::max(kMinCompactRecords, ids_by_path_.size())) {
+    return save_locked();
+  }
+
+  const bool fresh = !std::filesystem::exists(journal_path(), ec);
+  std::ofstream out(journal_path(), std::ios::binary | std::ios::app);
+  if (!out) {
+    return common::Status::error("failed to write code index journal");
+  }
+  if (fresh) {
+    out.write(kJournalMagic.data(), kJournalMagic.size());
+  }
+  for (const auto id : updated) {
+    write_pod(out, kJournalPut);
+    write_file_record(out, files_[id]);
+  }
+  for (const auto &path : removed) {
+    write_pod(out, kJournalDrop);
+    write_path(out, path);
+  }
+  if (!out.flush()) {
+    journal_damaged_ = true;
+    return common::Status::error("failed to write code index journal");
+  }
+  journal_records_ += records;
+  return common::Status::success();
+}
+
+std::vector<std::uint32_t> CodeIndex::candidates_locked(const CodeQuery &query) const {
+  const auto required = required_trigrams(query.pattern, query.regex);
+  std::vector<std::uint32_t> ids;
+  if (required.empty()) {
+    ids.reserve(files_.size());
+    for (std::uint32_t id = 0; id < files_.size(); ++id) {
+      ids.push_back(id);
+    }
+  } else {
+    // Intersect from the rarest trigram so the working set only shrinks.
+    std::vector<const std::vector<std::uint32_t> *> lists;
+    for (const auto trigram : required) {
+      const auto it = postings_.find(trigram);
+      if (it == postings_.end()) {
+        return {};
+      }
+      lists.push_back(&it->second);
+    }
+    std::sort(lists.begin(), lists.end(),
+              [](const auto *a, const auto *b) { return a->size() < b->size(); });
+    ids = *lists.front();
+    std::vector<std::uint32_t> narrowed;
+    for (std::size_t i = 1; i < lists.size() && !ids.empty(); ++i) {
+      narrowed.clear();
+      std::set_intersection(ids.begin(), ids.end(), lists[i]->begin(), lists[i]->end(),
+                            std::back_inserter(narrowed));
+      ids.swap(narrowed);
+    }
+  }
+  std::erase_if(ids, [&](const std::uint32_t id) {
+    return !files_[id].searchable || !under_prefix(files_[id].path, query.path_prefix);
+  });
+  return ids;
+}
+
+common::Result<CodeSearchResult> CodeIndex::search(const CodeQuery &query) {
+  if (query.pattern.empty()) {
+    return common::Result<CodeSearchResult>::failure("query is empty");
+  }
+  std::optional<std::regex> matcher;
+  if (query.regex) {
+    try {
+      auto flags = std::regex::ECMAScript | std::regex::optimize;
+      if (!query.case_sensitive) {
+        flags |= std::regex::icase;
+      }
+      matcher.emplace(query.pattern, flags);
+    } catch (const std::regex_error &error) {
+      return common::Result<CodeSearchResult>::failure(std::string("invalid regex: ") +
+                                                       error.what());
+    }
+  }
+  std::string needle = query.pattern;
+  if (!query.case_sensitive) {
+    lower_in_place(needle);
+  }
+  const std::size_t max_results = std::clamp<std::size_t>(query.max_results, 1, kMaxResults);
+
+  CodeSearchResult result;
+  std::vector<std::string> paths;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!loaded_ || std::chrono::steady_clock::now() - last_scan_ >= kRescanInterval) {
+      if (auto status = refresh_locked(); !status.ok()) {
+        return common::Result<CodeSearchResult>::failure(status.error());
+      }
+    }
+    const auto ids = candidates_locked(query);
+    paths.reserve(ids.size());
+    for (const auto id : ids) {
+      paths.push_back(files_[id].path);
+    }
+  }
+
+  // Matching reads the files themselves, so it runs without holding the index.
+  result.candidates = paths.size();
+  std::string content;
+  std::string lowered;
+  for (const auto &path : paths) {
+    if (result.truncated) {
+      break;
+    }
+    if (!read_file(workspace_ / path, content)) {
+      continue;
+    }
+    ++result.files_scanned;
+    std::size_t line_number = 0;
+    std::size_t start = 0;
+    while (start <= content.size()) {
+      const auto newline = content.find('\n', start);
+      const auto end = newline == std::string::npos ? content.size() : newline;
+      ++line_number;
+      std::string_view line(content.data() + start, end - start);
+      if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+      }
+      bool hit = false;
+      if (matcher.has_value()) {
+        if (line.size() > kMaxRegexLineChars) {
+          ++result.long_lines_skipped;
+        } else {
+          hit = std::regex_search(line.begin(), line.end(), *matcher);
+        }
+      } else if (query.case_sensitive) {
+        hit = line.find(needle) != std::string_view::npos;
+      } else {
+        lowered.assign(line);
+        lower_in_place(lowered);
+        hit = lowered.find(needle) != std::string::npos;
+      }
+      if (hit) {
+        if (result.matches.size() == max_results) {
+          result.truncated = true;
+          break;
+        }
+        std::string text(line.substr(0, kMaxLineChars));
+        if (line.size() > kMaxLineChars) {
+          text += "...";
+        }
+        result.matches.push_back(
+            CodeMatch{.path = path, .line = line_number, .text = std::move(text)});
+      }
+      if (newline == std::string::npos) {
+        break;
+      }
+      start = newline + 1;
+    }
+  }
+  return common::Result<CodeSearchResult>::success(std::move(result));
+}
+
+} // namespace ghostclaw::tools
@@ -0,0 +1,227 @@
+#include "ghostclaw/tools/file_view.hpp"
+
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+namespace ghostclaw::tools {
+
+namespace {
+
+constexpr std::size_t kLineStride = 1024;
+constexpr std::size_t kMaxIndexedFiles = 64;
+
+std::int64_t mtime_ns_of(const struct stat &st) {
+#if defined(__APPLE__)
+  const auto &ts = st.st_mtimespec;
+#else
+  const auto &ts = st.st_mtim;
+#endif
+  return static_cast<std::int64_t>(ts.tv_sec) * 1'000'000'000 + static_cast<std::int64_t>(ts.tv_nsec);
+}
+
+// Advances `pos` past up to `lines` newlines; returns how many were passed.
+std::size_t skip_lines(std::string_view data, std::size_t &pos, std::size_t lines) {
+  std::size_t skipped = 0;
+  while (skipped < lines && pos < data.size()) {
+    const void *hit = std::memchr(data.data() + pos, '\n', data.size() - pos);
+    if (hit == nullptr) {
+      pos = data.size();
+      break;
+    }
+    pos = static_cast<std::size_t>(static_cast<const char *>(hit) - data.data()) + 1;
+    ++skipped;
+  }
+  return skipped;
+}
+
+struct LineCheckpoints {
+  std::size_t size = 0;
+  std::int64_t mtime_ns = 0;
+  // starts[k] is the offset of line k * kLineStride + 1.
+  std::vector<std::size_t> starts{0};
+  bool complete = false;
+  std::uint64_t last_used = 0;
+};
+
+struct LineIndexCache {
+  std::mutex mutex;
+  std::unordered_map<std::string, LineCheckpoints> entries;
+  std::uint64_t clock = 0;
+};
+
+LineIndexCache &line_index_cache() {
+  static LineIndexCache cache;
+  return cache;
+}
+
+LineCheckpoints &checkpoints_for(LineIndexCache &cache, const FileView &file) {
+  const std::string key = file.path().string();
+  auto it = cache.entries.find(key);
+  if (it == cache.entries.end()) {
+    if (cache.entries.size() >= kMaxIndexedFiles) {
+      auto oldest = cache.entries.begin();
+      for (auto candidate = cache.entries.begin(); candidate != cache.entries.end(); ++candidate) {
+        if (candidate->second.last_used < oldest->second.last_used) {
+          oldest = candidate;
+        }
+      }
+      cache.entries.erase(oldest);
+    }
+    it = cache.entries.emplace(key, LineCheckpoints{}).first;
+  }
+  auto &entry = it->second;
+  if (entry.size != file.size() || entry.mtime_ns != file.mtime_ns()) {
+    entry = LineCheckpoints{};
+    entry.size = file.size();
+    entry.mtime_ns = file.mtime_ns();
+  }
+  entry.last_used = ++cache.clock;
+  return entry;
+}
+
+} // namespace
+
+common::Result<FileView> FileView::open(const std::filesystem::path &path) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return common::Result<FileView>::failure("Failed to open file");
+  }
+  return adopt(fd, path);
+}
+
+common::Result<FileView> FileView::adopt(const int fd, const std::filesystem::path &path) {
+  FileView view;
+  view.path_ = path;
+  view.fd_ = fd;
+  struct stat st {};
+  if (::fstat(view.fd_, &st) != 0) {
+    return common::Result<FileView>::failure("Failed to stat file");
+  }
+  if (!S_ISREG(st.st_mode)) {
+    return common::Result<FileView>::failure("Not a regular file");
+  }
+  view.size_ = static_cast<std::size_t>(st.st_size);
+  view.mode_ = static_cast<std::uint32_t>(st.st_mode & 07777);
+  view.mtime_ns_ = mtime_ns_of(st);
+  if (view.size_ == 0) {
+    return common::Result<FileView>::success(std::move(view));
+  }
+  void *mapped = ::mmap(nullptr, view.size_, PROT_READ, MAP_SHARED, view.fd_, 0);
+  if (mapped == MAP_FAILED) {
+    return common::Result<FileView>::failure("Failed to map file");
+  }
+  view.data_ = static_cast<const char *>(mapped);
+  return common::Result<FileView>::success(std::move(view));
+}
+
+FileView::FileView(FileView &&other) noexcept
+    : path_(std::move(other.path_)), data_(other.data_), size_(other.size_), fd_(other.fd_),
+      mode_(other.mode_), mtime_ns_(other.mtime_ns_) {
+  other.data_ = nullptr;
+  other.size_ = 0;
+  other.fd_ = -1;
+}
+
+FileView &FileView::operator=(FileView &&other) noexcept {
+  if (this != &other) {
+    reset();
+    path_ = std::move(other.path_);
+    data_ = other.data_;
+    size_ = other.size_;
+    fd_ = other.fd_;
+    mode_ = other.mode_;
+    mtime_ns_ = other.mtime_ns_;
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.fd_ = -1;
+  }
+  return *this;
+}
+
+FileView::~FileView() { reset(); }
+
+void FileView::reset() {
+  if (data_ != nullptr) {
+    ::munmap(const_cast<char *>(data_), size_);
+    data_ = nullptr;
+  }
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+  size_ = 0;
+}
+
+LineSpan locate_lines(const FileView &file, const std::size_t first_line, const std::size_t count) {
+  const auto data = file.data();
+  LineSpan span{.begin = data.size(), .end = data.size(), .first_line = 0};
+  if (first_line == 0 || data.empty()) {
+    return span;
+  }
+
+  const std::size_t target = first_line - 1;
+  const std::size_t checkpoint = target / kLineStride;
+  std::size_t pos = 0;
+  {
+    auto &cache = line_index_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    auto &index = checkpoints_for(cache, file);
+    while (index.starts.size() <= checkpoint && !index.complete) {
+      std::size_t next = index.starts.back();
+      if (skip_lines(data, next, kLineStride) < kLineStride || next >= data.size()) {
+        index.complete = true;
+        break;
+      }
+      index.starts.push_back(next);
+    }
+    if (index.starts.size() <= checkpoint) {
+      return span;
+    }
+    pos = index.starts[checkpoint];
+  }
+
+  const std::size_t remaining = target - checkpoint * kLineStride;
+  if (skip_lines(data, pos, remaining) < remaining || pos >= data.size()) {
+    return span;
+  }
+  span.begin = pos;
+  span.first_line = first_line;
+  if (count == 0) {
+    span.end = data.size();
+  } else {
+    std::size_t end = pos;
+    skip_lines(data, end, count);
+    span.end = end;
+  }
+  return span;
+}
+
+LineSpan tail_lines(const FileView &file, const std::size_t count) {
+  const auto data = file.data();
+  LineSpan span{.begin = data.size(), .end = data.size(), .first_line = 0};
+  if (count == 0 || data.empty()) {
+    return span;
+  }
+  std::size_t pos = data.size();
+  if (data[pos - 1] == '\n') {
+    --pos;
+  }
+  std::size_t found = 0;
+  while (pos > 0) {
+    if (data[pos - 1] == '\n' && ++found == count) {
+      break;
+    }
+    --pos;
+  }
+  span.begin = pos;
+  return span;
+}
+
+} // namespace ghostclaw::tools
@@ -0,0 +1,150 @@
+#include "ghostclaw/tools/output_store.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace ghostclaw::tools {
+
+namespace {
+
+constexpr std::string_view kHandlePrefix = "out-";
+
+std::string new_handle() {
+  static std::atomic<std::uint32_t> counter{0};
+  thread_local std::mt19937 rng{std::random_device{}()};
+  const auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                       .count();
+  std::ostringstream out;
+  out << kHandlePrefix << std::hex << now << std::setw(4) << std::setfill('0')
+      << (counter.fetch_add(1) & 0xFFFFU) << std::setw(4) << (rng() & 0xFFFFU);
+  return out.str();
+}
+
+// Handles end up in file names; accept only what new_handle() produces.
+bool valid_handle(const std::string &handle) {
+  if (handle.size() <= kHandlePrefix.size() || handle.rfind(kHandlePrefix, 0) != 0) {
+    return false;
+  }
+  return std::all_of(handle.begin() + static_cast<std::ptrdiff_t>(kHandlePrefix.size()),
+                     handle.end(), [](const char ch) {
+                       return (ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'f');
+                     });
+}
+
+std::string sanitize_session(const std::string &session_id) {
+  std::string out;
+  for (const char ch : session_id.empty() ? std::string("default") : session_id) {
+    const bool keep = (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') ||
+                      (ch >= '0' && ch <= '9') || ch == '-' || ch == '_';
+    out.push_back(keep ? ch : '_');
+  }
+  return out;
+}
+
+// Backs off to a UTF-8 boundary so a preview never ends mid-character.
+std::size_t utf8_floor(const std::string &text, std::size_t pos) {
+  while (pos > 0 && pos < text.size() &&
+         (static_cast<unsigned char>(text[pos]) & 0xC0U) == 0x80U) {
+    --pos;
+  }
+  return pos;
+}
+
+} // namespace
+
+ToolOutputStore::ToolOutputStore(std::filesystem::path root, const std::size_t max_per_session)
+    : root_(std::move(root)), max_per_session_(std::max<std::size_t>(1, max_per_session)) {}
+
+std::filesystem::path ToolOutputStore::default_root(const std::filesystem::path &workspace) {
+  return workspace / ".ghostclaw" / "tool-outputs";
+}
+
+std::filesystem::path ToolOutputStore::session_dir(const std::string &session_id) const {
+  return root_ / sanitize_session(session_id);
+}
+
+common::Result<StoredOutput> ToolOutputStore::put(const std::string &session_id,
+                                                  const std::string &content) {
+  const auto dir = session_dir(session_id);
+  std::error_code ec;
+  std::filesystem::create_directories(dir, ec);
+  if (ec) {
+    return common::Result<StoredOutput>::failure("failed to create tool output dir: " +
+                                                 ec.message());
+  }
+
+  StoredOutput stored;
+  stored.handle = new_handle();
+  stored.bytes = content.size();
+  stored.lines = static_cast<std::size_t>(std::count(content.begin(), content.end(), '\n'));
+  if (!content.empty() && content.back() != '\n') {
+    ++stored.lines;
+  }
+
+  std::ofstream out(dir / (stored.handle + ".txt"), std::ios::binary | std::ios::trunc);
+  if (!out) {
+    return common::Result<StoredOutput>::failure("failed to write tool output");
+  }
+  out.write(content.data(), static_cast<std::streamsize>(content.size()));
+  out.close();
+  prune(dir);
+  return common::Result<StoredOutput>::success(std::move(stored));
+}
+
+common::Result<std::string> ToolOutputStore::get(const std::string &session_id,
+                                                 const std::string &handle) const {
+  if (!valid_handle(handle)) {
+    return common::Result<std::string>::failure("invalid tool output handle: " + handle);
+  }
+  std::ifstream in(session_dir(session_id) / (handle + ".txt"), std::ios::binary);
+  if (!in) {
+    return common::Result<std::string>::failure("unknown tool output handle: " + handle);
+  }
+  std::stringstream buffer;
+  buffer << in.rdbuf();
+  return common::Result<std::string>::success(buffer.str());
+}
+
+void ToolOutputStore::prune(const std::filesystem::path &dir) const {
+  std::error_code ec;
+  std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>> files;
+  for (const auto &entry : std::filesystem::directory_iterator(dir, ec)) {
+    if (entry.is_regular_file(ec) && entry.path().extension() == ".txt") {
+      files.emplace_back(entry.last_write_time(ec), entry.path());
+    }
+  }
+  if (files.size() <= max_per_session_) {
+    return;
+  }
+  std::sort(files.begin(), files.end());
+  for (std::size_t i = 0; i + max_per_session_ < files.size(); ++i) {
+    std::filesystem::remove(files[i].second, ec);
+  }
+}
+
+std::string spill_preview(const std::string &output, const StoredOutput &stored,
+                          const std::size_t preview_bytes) {
+  const std::size_t head_bytes = utf8_floor(output, preview_bytes * 3 / 4);
+  const std::size_t tail_start =
+      utf8_floor(output, output.size() - std::min(output.size(), preview_bytes / 4));
+
+  std::ostringstream out;
+  out << output.substr(0, head_bytes);
+  if (tail_start > head_bytes) {
+    out << "\n[... " << (tail_start - head_bytes) << " bytes omitted ...]\n";
+    out << output.substr(tail_start);
+  }
+  out << "\n[Full output: " << stored.bytes << " bytes, " << stored.lines
+      << " lines, stored as handle " << stored.handle
+      << ". Call tool_output with this handle to page through it or grep it.]";
+  return out.str();
+}
+
+} // namespace ghostclaw::tools
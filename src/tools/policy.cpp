@@ -8,7 +8,7 @@ namespace ghostclaw::tools {
 
 std::vector<std::string> ToolPolicy::expand_group(const std::string_view group) {
   static const std::unordered_map<std::string, std::vector<std::string>> mapping = {
-      {"fs", {"file_read", "file_write", "file_edit"}},
+      {"fs", {"file_read", "file_write", "file_edit", "code_search"}},
       {"runtime", {"shell", "process_bg"}},
       {"memory", {"memory_store", "memory_recall", "memory_forget"}},
       {"web", {"web_search", "web_fetch", "browser"}},
@@ -0,0 +1,112 @@
+#include "ghostclaw/tools/result_cache.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace ghostclaw::tools {
+
+namespace {
+
+std::size_t result_bytes(const ToolResult &result) {
+  std::size_t bytes = result.output.size();
+  for (const auto &[key, value] : result.metadata) {
+    bytes += key.size() + value.size();
+  }
+  return bytes;
+}
+
+} // namespace
+
+ToolResultCache::ToolResultCache(const std::size_t max_entries, const std::size_t max_bytes)
+    : max_entries_(std::max<std::size_t>(1, max_entries)), max_bytes_(max_bytes) {}
+
+std::shared_ptr<ToolResultCache> ToolResultCache::shared() {
+  static const auto cache = std::make_shared<ToolResultCache>();
+  return cache;
+}
+
+std::optional<ToolResult> ToolResultCache::lookup(const std::string &tool,
+                                                  const ToolCachePolicy &policy) {
+  const std::string key = tool + '\n' + policy.key;
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto it = index_.find(key);
+  if (it == index_.end()) {
+    ++misses_;
+    return std::nullopt;
+  }
+  const auto entry = it->second;
+  if (entry->version != policy.version || std::chrono::steady_clock::now() >= entry->expires) {
+    bytes_ -= entry->bytes;
+    entries_.erase(entry);
+    index_.erase(it);
+    ++misses_;
+    return std::nullopt;
+  }
+  entries_.splice(entries_.begin(), entries_, entry);
+  ++hits_;
+  return entry->result;
+}
+
+void ToolResultCache::store(const std::string &tool, const ToolCachePolicy &policy,
+                            const ToolResult &result) {
+  const std::size_t bytes = result_bytes(result);
+  if (bytes > max_bytes_) {
+    return;
+  }
+  Entry entry{.key = tool + '\n' + policy.key,
+              .version = policy.version,
+              .expires = policy.ttl.count() > 0
+                             ? std::chrono::steady_clock::now() + policy.ttl
+                             : std::chrono::steady_clock::time_point::max(),
+              .result = result,
+              .bytes = bytes};
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (const auto it = index_.find(entry.key); it != index_.end()) {
+    bytes_ -= it->second->bytes;
+    entries_.erase(it->second);
+    index_.erase(it);
+  }
+  bytes_ += bytes;
+  entries_.push_front(std::move(entry));
+  index_[entries_.front().key] = entries_.begin();
+  evict_locked();
+}
+
+void ToolResultCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  index_.clear();
+  bytes_ = 0;
+}
+
+ToolResultCacheStats ToolResultCache::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return ToolResultCacheStats{
+      .hits = hits_, .misses = misses_, .entries = entries_.size(), .bytes = bytes_};
+}
+
+void ToolResultCache::evict_locked() {
+  while (!entries_.empty() && (entries_.size() > max_entries_ || bytes_ > max_bytes_)) {
+    bytes_ -= entries_.back().bytes;
+    index_.erase(entries_.back().key);
+    entries_.pop_back();
+  }
+}
+
+std::string canonical_args(const ToolArgs &args) {
+  std::vector<std::pair<std::string, std::string>> sorted(args.begin(), args.end());
+  std::sort(sorted.begin(), sorted.end());
+  std::string out;
+  for (const auto &[name, value] : sorted) {
+    out += name;
+    out += '=';
+    out += std::to_string(value.size());
+    out += ':';
+    out += value;
+    out += '\n';
+  }
+  return out;
+}
+
+} // namespace ghostclaw::tools
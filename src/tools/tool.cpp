@@ -7,7 +7,8 @@ ToolSpec ITool::spec() const {
                   .description = std::string(description()),
                   .parameters_json = parameters_schema(),
                   .safe = is_safe(),
-                  .group = std::string(group())};
+                  .group = std::string(group()),
+                  .function_json = {}};
 }
 
 } // namespace ghostclaw::tools
@@ -0,0 +1,201 @@
+#include "ghostclaw/tools/tool_catalog.hpp"
+
+#include "ghostclaw/common/fs.hpp"
+#include "ghostclaw/common/json_util.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <sstream>
+#include <string_view>
+#include <unordered_set>
+
+namespace ghostclaw::tools {
+
+namespace {
+
+constexpr int kNameInMessageScore = 5;
+constexpr int kNameInContextScore = 4;
+constexpr int kRecentScore = 3;
+constexpr int kGroupScore = 2;
+constexpr int kTermScore = 1;
+
+constexpr std::array<std::string_view, 16> kStopWords = {
+    "the",  "and",  "for",   "with", "from", "into", "this",  "that",
+    "use",  "using", "when", "will", "can",  "are",  "optional", "given"};
+
+bool is_stop_word(const std::string &term) {
+  return std::find(kStopWords.begin(), kStopWords.end(), term) != kStopWords.end();
+}
+
+std::vector<std::string> keyword_terms(const std::string &text) {
+  std::vector<std::string> terms;
+  std::string current;
+  const auto push = [&]() {
+    if (current.size() >= 3 && !is_stop_word(current)) {
+      terms.push_back(current);
+    }
+    current.clear();
+  };
+  for (const char ch : text) {
+    if (std::isalnum(static_cast<unsigned char>(ch)) != 0) {
+      current.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(ch))));
+      continue;
+    }
+    push();
+  }
+  push();
+  return terms;
+}
+
+// "web_search" is also matched as "web search" and "websearch".
+std::vector<std::string> name_forms(const std::string &name) {
+  const std::string lower = common::to_lower(name);
+  std::vector<std::string> forms{lower};
+  if (lower.find('_') == std::string::npos) {
+    return forms;
+  }
+  std::string spaced = lower;
+  std::replace(spaced.begin(), spaced.end(), '_', ' ');
+  forms.push_back(std::move(spaced));
+  std::string joined;
+  std::copy_if(lower.begin(), lower.end(), std::back_inserter(joined),
+               [](const char ch) { return ch != '_'; });
+  forms.push_back(std::move(joined));
+  return forms;
+}
+
+bool mentions(const std::string &haystack, const std::vector<std::string> &forms) {
+  return std::any_of(forms.begin(), forms.end(), [&haystack](const std::string &form) {
+    return haystack.find(form) != std::string::npos;
+  });
+}
+
+// Exact match, or a shared prefix for longer words so "searching" finds "search".
+bool term_matches(const std::string &tool_term, const std::unordered_set<std::string> &words) {
+  if (words.contains(tool_term)) {
+    return true;
+  }
+  if (tool_term.size() < 4) {
+    return false;
+  }
+  return std::any_of(words.begin(), words.end(), [&tool_term](const std::string &word) {
+    return word.size() >= 4 &&
+           (common::starts_with(word, tool_term) || common::starts_with(tool_term, word));
+  });
+}
+
+} // namespace
+
+std::string serialize_function_spec(const ToolSpec &spec) {
+  std::ostringstream out;
+  out << "{\"type\":\"function\",\"function\":{";
+  out << "\"name\":\"" << common::json_escape(spec.name) << "\",";
+  out << "\"description\":\"" << common::json_escape(spec.description) << "\",";
+  out << "\"parameters\":" << (spec.parameters_json.empty() ? "{}" : spec.parameters_json);
+  out << "}}";
+  return out.str();
+}
+
+ToolCatalog::ToolCatalog(const ToolRegistry &registry, std::vector<std::string> core_tools) {
+  std::unordered_set<std::string> core;
+  for (auto &name : core_tools) {
+    core.insert(common::to_lower(name));
+  }
+
+  specs_ = registry.all_specs();
+  entries_.reserve(specs_.size());
+  for (auto &spec : specs_) {
+    spec.function_json = serialize_function_spec(spec);
+
+    Entry entry;
+    entry.name_forms = name_forms(spec.name);
+    entry.group = common::to_lower(spec.group);
+    entry.core = core.contains(entry.name_forms.front());
+    std::unordered_set<std::string> seen;
+    for (auto &term : keyword_terms(spec.name + " " + spec.group + " " + spec.description)) {
+      if (seen.insert(term).second) {
+        entry.terms.push_back(std::move(term));
+      }
+    }
+    entries_.push_back(std::move(entry));
+  }
+}
+
+std::vector<ToolSpec> ToolCatalog::select(const ToolSelectionRequest &request) const {
+  std::vector<std::size_t> allowed;
+  allowed.reserve(specs_.size());
+  for (std::size_t i = 0; i < specs_.size(); ++i) {
+    if (!request.allow || request.allow(specs_[i])) {
+      allowed.push_back(i);
+    }
+  }
+
+  std::vector<bool> chosen(specs_.size(), false);
+  if (request.max_tools == 0 || allowed.size() <= request.max_tools) {
+    for (const auto index : allowed) {
+      chosen[index] = true;
+    }
+  } else {
+    const std::string message = common::to_lower(request.message);
+    const std::string context = common::to_lower(request.context);
+    const auto message_terms = keyword_terms(request.message);
+    const std::unordered_set<std::string> words(message_terms.begin(), message_terms.end());
+    std::unordered_set<std::string> recent;
+    for (const auto &name : request.recent_tools) {
+      recent.insert(common::to_lower(name));
+    }
+
+    std::size_t taken = 0;
+    std::vector<std::pair<int, std::size_t>> scored;
+    for (const auto index : allowed) {
+      const auto &entry = entries_[index];
+      if (entry.core) {
+        chosen[index] = true;
+        ++taken;
+        continue;
+      }
+      int score = 0;
+      if (mentions(message, entry.name_forms)) {
+        score += kNameInMessageScore;
+      } else if (!context.empty() && mentions(context, entry.name_forms)) {
+        score += kNameInContextScore;
+      }
+      if (recent.contains(entry.name_forms.front())) {
+        score += kRecentScore;
+      }
+      if (!entry.group.empty() && words.contains(entry.group)) {
+        score += kGroupScore;
+      }
+      for (const auto &term : entry.terms) {
+        if (term_matches(term, words)) {
+          score += kTermScore;
+        }
+      }
+      if (score > 0) {
+        scored.emplace_back(score, index);
+      }
+    }
+
+    std::stable_sort(scored.begin(), scored.end(),
+                     [](const auto &a, const auto &b) { return a.first > b.first; });
+    for (const auto &[score, index] : scored) {
+      (void)score;
+      if (taken >= request.max_tools) {
+        break;
+      }
+      chosen[index] = true;
+      ++taken;
+    }
+  }
+
+  std::vector<ToolSpec> out;
+  for (std::size_t i = 0; i < specs_.size(); ++i) {
+    if (chosen[i]) {
+      out.push_back(specs_[i]);
+    }
+  }
+  return out;
+}
+
+} // namespace ghostclaw::tools
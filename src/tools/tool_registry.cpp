@@ -5,6 +5,7 @@
 #include "ghostclaw/tools/builtin/browser.hpp"
 #include "ghostclaw/tools/builtin/calendar.hpp"
 #include "ghostclaw/tools/builtin/canvas.hpp"
+#include "ghostclaw/tools/builtin/code_search.hpp"
 #include "ghostclaw/tools/builtin/email.hpp"
 #include "ghostclaw/tools/builtin/file_edit.hpp"
 #include "ghostclaw/tools/builtin/file_read.hpp"
@@ -18,11 +19,10 @@
 #include "ghostclaw/tools/builtin/sessions.hpp"
 #include "ghostclaw/tools/builtin/shell.hpp"
 #include "ghostclaw/tools/builtin/skills.hpp"
+#include "ghostclaw/tools/builtin/tool_output.hpp"
 #include "ghostclaw/tools/builtin/web_fetch.hpp"
 #include "ghostclaw/tools/builtin/web_search.hpp"
-#include "ghostclaw/mcp/manager.hpp"
-
-#include <iostream>
+#include "ghostclaw/mcp/fleet.hpp"
 
 namespace ghostclaw::tools {
 
@@ -64,8 +64,10 @@ ToolRegistry ToolRegistry::create_default(std::shared_ptr<security::SecurityPoli
   registry.register_tool(std::make_unique<FileReadTool>(policy));
   registry.register_tool(std::make_unique<FileWriteTool>(policy));
   registry.register_tool(std::make_unique<FileEditTool>(policy));
+  registry.register_tool(std::make_unique<CodeSearchTool>());
   registry.register_tool(std::make_unique<WebSearchTool>());
   registry.register_tool(std::make_unique<WebFetchTool>());
+  registry.register_tool(std::make_unique<ToolOutputTool>());
   return registry;
 }
 
@@ -77,6 +79,7 @@ ToolRegistry ToolRegistry::create_full(std::shared_ptr<security::SecurityPolicy>
   registry.register_tool(std::make_unique<FileReadTool>(policy));
   registry.register_tool(std::make_unique<FileWriteTool>(policy));
   registry.register_tool(std::make_unique<FileEditTool>(policy));
+  registry.register_tool(std::make_unique<CodeSearchTool>());
 
   WebSearchConfig ws_config;
   ws_config.provider = config.web_search.provider;
@@ -85,6 +88,7 @@ ToolRegistry ToolRegistry::create_full(std::shared_ptr<security::SecurityPolicy>
   }
   registry.register_tool(std::make_unique<WebSearchTool>(std::move(ws_config)));
   registry.register_tool(std::make_unique<WebFetchTool>());
+  registry.register_tool(std::make_unique<ToolOutputTool>());
 
   registry.register_tool(std::make_unique<BrowserTool>(config.browser.allowed_domains, config.browser));
   registry.register_tool(std::make_unique<CanvasTool>());
@@ -115,18 +119,18 @@ ToolRegistry ToolRegistry::create_full(std::shared_ptr<security::SecurityPolicy>
   registry.register_tool(std::make_unique<SessionsSpawnTool>(session_store));
   registry.register_tool(std::make_unique<SubagentsTool>(session_store));
 
-  // Register MCP tools from configured servers
+  // Register MCP tools from configured servers. Registries share the process-wide
+  // fleet, so each server runs once however many engines are built; servers with a
+  // cached tool list start on first use.
   if (!config.mcp.servers.empty()) {
-    auto mcp_manager = std::make_shared<mcp::McpManager>(config.mcp.servers);
-    auto mcp_status = mcp_manager->start_all();
-    if (!mcp_status.ok()) {
-      std::cerr << "[tools] MCP warning: " << mcp_status.error() << "\n";
+    std::filesystem::path mcp_cache_dir;
+    if (auto cfg_dir = config::config_dir(); cfg_dir.ok()) {
+      mcp_cache_dir = cfg_dir.value() / "mcp";
     }
-    auto mcp_tools = mcp_manager->collect_tools();
+    auto mcp_tools = mcp::McpFleet::shared().collect_tools(config.mcp.servers, mcp_cache_dir);
     for (auto &tool : mcp_tools) {
       registry.register_tool(std::move(tool));
     }
-    // McpManager kept alive via shared_ptr in McpTool instances
   }
 
   return registry;
@@ -0,0 +1,39 @@
+// libFuzzer target for the gateway's HTTP request parser. Build with
+// -DGHOSTCLAW_BUILD_FUZZERS=ON using clang, then run ./http_parser_fuzz.
+#include "ghostclaw/gateway/http_parser.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t *data, std::size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+  // The first byte picks the read size, so requests get split at every possible point.
+  const std::size_t step = 1 + data[0] % 64;
+  const std::string_view input(reinterpret_cast<const char *>(data + 1), size - 1);
+
+  ghostclaw::gateway::HttpRequestParser parser(
+      {.max_head_bytes = 1024, .max_headers = 16, .max_body_bytes = 1024});
+  std::size_t offset = 0;
+  while (offset < input.size()) {
+    const auto taken = parser.feed(input.substr(offset, step));
+    offset += taken;
+    const auto status = parser.status();
+    if (status == ghostclaw::gateway::HttpParseStatus::Error) {
+      break;
+    }
+    if (status == ghostclaw::gateway::HttpParseStatus::Complete) {
+      const auto &request = parser.request();
+      (void)request.header("content-type");
+      if (request.body.size() > 1024) {
+        __builtin_trap();
+      }
+      (void)parser.consume();
+    } else if (taken == 0) {
+      break;
+    }
+  }
+  return 0;
+}
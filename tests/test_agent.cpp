@@ -1,21 +1,29 @@
 #include "test_framework.hpp"
 
 #include "ghostclaw/agent/context.hpp"
+#include "ghostclaw/agent/continuation.hpp"
 #include "ghostclaw/agent/engine.hpp"
 #include "ghostclaw/agent/message_queue.hpp"
 #include "ghostclaw/agent/session.hpp"
 #include "ghostclaw/agent/stream_parser.hpp"
 #include "ghostclaw/memory/memory.hpp"
 #include "ghostclaw/providers/traits.hpp"
+#include "ghostclaw/tools/builtin/tool_output.hpp"
 #include "ghostclaw/tools/tool_registry.hpp"
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <filesystem>
+#include <functional>
 #include <fstream>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <random>
 #include <sstream>
+#include <thread>
 #include <unordered_map>
 
 namespace {
@@ -54,6 +62,9 @@ public:
 
   [[nodiscard]] ghostclaw::common::Result<std::vector<ghostclaw::memory::MemoryEntry>>
   recall(const std::string &, std::size_t limit) override {
+    if (on_recall) {
+      on_recall();
+    }
     std::vector<ghostclaw::memory::MemoryEntry> out = recall_entries;
     if (out.size() > limit) {
       out.resize(limit);
@@ -106,6 +117,7 @@ public:
   std::unordered_map<std::string, ghostclaw::memory::MemoryEntry> entries;
   std::vector<ghostclaw::memory::MemoryEntry> recall_entries;
   std::size_t store_calls = 0;
+  std::function<void()> on_recall;
 };
 
 class SequenceProvider final : public ghostclaw::providers::Provider {
@@ -119,28 +131,77 @@ public:
   }
 
   [[nodiscard]] ghostclaw::common::Result<std::string>
-  chat_with_system(const std::optional<std::string> &, const std::string &, const std::string &,
-                   double) override {
+  chat_with_system(const std::optional<std::string> &, const std::string &message,
+                   const std::string &, double) override {
     ++call_count;
+    messages.push_back(message);
     if (index_ >= responses_.size()) {
       return ghostclaw::common::Result<std::string>::failure("out of responses");
     }
+    ghostclaw::providers::report_usage(usage_per_call);
     return responses_[index_++];
   }
 
   [[nodiscard]] ghostclaw::common::Status warmup() override {
+    {
+      std::lock_guard<std::mutex> lock(warmup_mutex);
+      ++warmup_calls;
+    }
+    warmup_cv.notify_all();
     return ghostclaw::common::Status::success();
   }
 
   [[nodiscard]] std::string name() const override { return "sequence"; }
 
   std::size_t call_count = 0;
+  std::vector<std::string> messages;
+  ghostclaw::providers::TokenUsage usage_per_call;
+  std::mutex warmup_mutex;
+  std::condition_variable warmup_cv;
+  std::size_t warmup_calls = 0;
 
 private:
   std::vector<ghostclaw::common::Result<std::string>> responses_;
   std::size_t index_ = 0;
 };
 
+// Stands in for a provider stuck in a slow HTTP call: like CurlHttpClient, it only
+// returns early when the turn's cancel token fires.
+class BlockingProvider final : public ghostclaw::providers::Provider {
+public:
+  [[nodiscard]] ghostclaw::common::Result<std::string>
+  chat(const std::string &, const std::string &, double) override {
+    return chat_with_system(std::nullopt, "", "", 0.0);
+  }
+
+  [[nodiscard]] ghostclaw::common::Result<std::string>
+  chat_with_system(const std::optional<std::string> &, const std::string &, const std::string &,
+                   double) override {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      started = true;
+    }
+    cv.notify_all();
+    const auto token = ghostclaw::common::current_cancel_token();
+    if (token == nullptr) {
+      return ghostclaw::common::Result<std::string>::failure("no cancel token installed");
+    }
+    if (token->wait_for(std::chrono::seconds(5))) {
+      return ghostclaw::common::Result<std::string>::failure("request cancelled");
+    }
+    return ghostclaw::common::Result<std::string>::success("late reply");
+  }
+
+  [[nodiscard]] ghostclaw::common::Status warmup() override {
+    return ghostclaw::common::Status::success();
+  }
+  [[nodiscard]] std::string name() const override { return "blocking"; }
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool started = false;
+};
+
 class EchoTool final : public ghostclaw::tools::ITool {
 public:
   [[nodiscard]] std::string_view name() const override { return "echo_tool"; }
@@ -153,10 +214,39 @@ public:
     ghostclaw::tools::ToolResult result;
     const auto it = args.find("value");
     result.output = (it == args.end()) ? "missing" : ("value=" + it->second);
+    if (delay.count() > 0) {
+      std::this_thread::sleep_for(delay);
+    }
     return ghostclaw::common::Result<ghostclaw::tools::ToolResult>::success(std::move(result));
   }
   [[nodiscard]] bool is_safe() const override { return true; }
   [[nodiscard]] std::string_view group() const override { return "test"; }
+
+  std::chrono::milliseconds delay{0};
+};
+
+// Stands in for shell: a runtime tool, so it needs approval when the policy asks.
+class RuntimeTool final : public ghostclaw::tools::ITool {
+public:
+  explicit RuntimeTool(std::shared_ptr<std::atomic<int>> runs) : runs_(std::move(runs)) {}
+
+  [[nodiscard]] std::string_view name() const override { return "run_cmd"; }
+  [[nodiscard]] std::string_view description() const override { return "runs a command"; }
+  [[nodiscard]] std::string parameters_schema() const override {
+    return R"({"type":"object","properties":{"command":{"type":"string"}}})";
+  }
+  [[nodiscard]] ghostclaw::common::Result<ghostclaw::tools::ToolResult>
+  execute(const ghostclaw::tools::ToolArgs &args, const ghostclaw::tools::ToolContext &) override {
+    ++*runs_;
+    ghostclaw::tools::ToolResult result;
+    result.output = "ran " + args.at("command");
+    return ghostclaw::common::Result<ghostclaw::tools::ToolResult>::success(std::move(result));
+  }
+  [[nodiscard]] bool is_safe() const override { return false; }
+  [[nodiscard]] std::string_view group() const override { return "runtime"; }
+
+private:
+  std::shared_ptr<std::atomic<int>> runs_;
 };
 
 } // namespace
@@ -288,6 +378,41 @@ void register_agent_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
                              "run output mismatch");
                    }});
 
+  tests.push_back({"agent_turn_preparation_overlaps_recall_with_provider_warmup", [] {
+                     const auto ws = make_temp_dir();
+                     cfg::Config config;
+                     config.memory.auto_save = false;
+                     auto provider = std::make_shared<SequenceProvider>(
+                         std::vector<ghostclaw::common::Result<std::string>>{
+                             ghostclaw::common::Result<std::string>::success("first"),
+                             ghostclaw::common::Result<std::string>::success("second")});
+                     auto memory = std::make_unique<FakeMemory>();
+                     bool overlapped = false;
+                     // Recall blocks until warmup has run; a serial turn would time out here.
+                     memory->on_recall = [&]() {
+                       std::unique_lock<std::mutex> lock(provider->warmup_mutex);
+                       overlapped = provider->warmup_cv.wait_for(
+                           lock, std::chrono::seconds(2),
+                           [&]() { return provider->warmup_calls > 0; });
+                     };
+                     ghostclaw::memory::MemoryEntry recalled;
+                     recalled.key = "pref";
+                     recalled.content = "likes tea";
+                     memory->recall_entries.push_back(recalled);
+                     tools::ToolRegistry registry;
+                     agent::AgentEngine engine(config, provider, std::move(memory),
+                                               std::move(registry), ws);
+
+                     auto first = engine.run("hello");
+                     require(first.ok(), first.error());
+                     require(first.value().content == "first", "unexpected first reply");
+                     require(overlapped, "memory recall should run alongside provider warmup");
+                     auto second = engine.run("again");
+                     require(second.ok(), second.error());
+                     std::lock_guard<std::mutex> lock(provider->warmup_mutex);
+                     require(provider->warmup_calls == 1, "warmup should be prefetched once");
+                   }});
+
   tests.push_back({"agent_run_stream_delivers_tokens", [] {
                      const auto ws = make_temp_dir();
                      cfg::Config config;
@@ -335,6 +460,341 @@ void register_agent_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
                      require(provider->call_count == 2, "provider should be called twice");
                    }});
 
+  tests.push_back({"agent_parks_turn_on_approval_and_resumes_elsewhere", [] {
+                     const auto ws = make_temp_dir();
+                     cfg::Config config;
+                     config.memory.auto_save = false;
+                     config.autonomy.approval_ask = "always";
+                     auto provider = std::make_shared<SequenceProvider>(
+                         std::vector<ghostclaw::common::Result<std::string>>{
+                             ghostclaw::common::Result<std::string>::success(
+                                 "<tool>run_cmd</tool><args>{\"command\":\"make\"}</args>"),
+                             ghostclaw::common::Result<std::string>::success("built it"),
+                         });
+                     auto runs = std::make_shared<std::atomic<int>>(0);
+                     tools::ToolRegistry registry;
+                     registry.register_tool(std::make_unique<RuntimeTool>(runs));
+                     agent::AgentEngine engine(config, provider, std::make_unique<FakeMemory>(),
+                                               std::move(registry), ws);
+
+                     agent::AgentOptions options;
+                     options.session_id = "s1";
+                     options.park_on_approval = true;
+                     auto parked = engine.run("build", options);
+                     require(parked.ok(), parked.error());
+                     require(parked.value().pending_approval_id.has_value(), "turn should park");
+                     require(parked.value().pending_approval_command == "make",
+                             "pending command mismatch");
+                     require(runs->load() == 0, "tool must not run before approval");
+                     const std::string id = *parked.value().pending_approval_id;
+                     require(engine.parked_turns(std::string("s1")).size() == 1,
+                             "parked turn should be listed");
+
+                     agent::AgentOptions other;
+                     other.session_id = "s2";
+                     require(!engine.resume(id, ghostclaw::security::ApprovalDecision::AllowOnce,
+                                            other)
+                                  .ok(),
+                             "another session must not resume the turn");
+
+                     // A second engine on the same workspace stands in for another worker.
+                     tools::ToolRegistry second_registry;
+                     second_registry.register_tool(std::make_unique<RuntimeTool>(runs));
+                     agent::AgentEngine second(config, provider, std::make_unique<FakeMemory>(),
+                                               std::move(second_registry), ws);
+                     auto resumed =
+                         second.resume(id, ghostclaw::security::ApprovalDecision::AllowOnce, options);
+                     require(resumed.ok(), resumed.error());
+                     require(runs->load() == 1, "approved tool should run once");
+                     require(resumed.value().content == "built it", "resumed answer mismatch");
+                     require(resumed.value().tool_results.size() == 1 &&
+                                 resumed.value().tool_results[0].result.success,
+                             "resumed turn should report the tool result");
+                     require(provider->messages.back().find("ran make") != std::string::npos,
+                             "tool output should reach the provider");
+                     require(!engine.resume(id, ghostclaw::security::ApprovalDecision::AllowOnce)
+                                  .ok(),
+                             "a turn resumes only once");
+                     require(engine.parked_turns().empty(), "no turn should stay parked");
+                     require(std::filesystem::is_empty(
+                                 agent::ContinuationStore::default_root(ws)),
+                             "a resumed turn should leave no claim behind");
+                   }});
+
+  tests.push_back({"agent_denied_approval_is_reported_to_the_model", [] {
+                     const auto ws = make_temp_dir();
+                     cfg::Config config;
+                     config.memory.auto_save = false;
+                     config.autonomy.approval_ask = "always";
+                     auto provider = std::make_shared<SequenceProvider>(
+                         std::vector<ghostclaw::common::Result<std::string>>{
+                             ghostclaw::common::Result<std::string>::success(
+                                 "<tool>run_cmd</tool><args>{\"command\":\"rm -rf build\"}</args>"),
+                             ghostclaw::common::Result<std::string>::success("left it alone"),
+                         });
+                     auto runs = std::make_shared<std::atomic<int>>(0);
+                     tools::ToolRegistry registry;
+                     registry.register_tool(std::make_unique<RuntimeTool>(runs));
+                     agent::AgentEngine engine(config, provider, std::make_unique<FakeMemory>(),
+                                               std::move(registry), ws);
+
+                     agent::AgentOptions options;
+                     options.park_on_approval = true;
+                     auto parked = engine.run("clean", options);
+                     require(parked.ok(), parked.error());
+                     require(parked.value().pending_approval_id.has_value(), "turn should park");
+
+                     const auto reply =
+                         agent::parse_approval_reply("/deny " + *parked.value().pending_approval_id);
+                     require(reply.has_value() &&
+                                 reply->decision == ghostclaw::security::ApprovalDecision::Deny,
+                             "deny reply should parse");
+                     auto resumed = engine.resume(reply->id, reply->decision, options);
+                     require(resumed.ok(), resumed.error());
+                     require(runs->load() == 0, "denied tool must not run");
+                     require(resumed.value().content == "left it alone", "resumed answer mismatch");
+                     require(provider->messages.back().find("denied by approver") != std::string::npos,
+                             "denial should reach the provider");
+                   }});
+
+  tests.push_back({"parked_turn_round_trips_and_parses_approval_replies", [] {
+                     agent::ParkedTurn turn;
+                     turn.id = "ap1";
+                     turn.session_id = "s\"1";
+                     turn.message = "line one\nline two";
+                     turn.iteration = 3;
+                     turn.batch_start = 1;
+                     turn.command = "make";
+                     agent::ToolCallResult done;
+                     done.id = "c0";
+                     done.name = "echo_tool";
+                     done.result.success = true;
+                     done.result.output = "{\"nested\":[1]}";
+                     done.result.metadata["k"] = "v";
+                     agent::ToolCallResult waiting;
+                     waiting.id = "c1";
+                     waiting.name = "run_cmd";
+                     waiting.awaiting_approval = true;
+                     turn.completed = {done, waiting};
+                     turn.pending.push_back(agent::ToolCallRequest{
+                         .id = "c1", .name = "run_cmd", .arguments = {{"command", "make"}}});
+
+                     auto parsed = agent::parked_turn_from_json(agent::parked_turn_to_json(turn));
+                     require(parsed.ok(), parsed.error());
+                     const auto &back = parsed.value();
+                     require(back.session_id == turn.session_id && back.message == turn.message,
+                             "scalars should round trip");
+                     require(back.iteration == 3 && back.batch_start == 1, "counters should round trip");
+                     require(back.completed.size() == 2 && back.completed[0].result.output ==
+                                                               done.result.output,
+                             "completed results should round trip");
+                     require(back.completed[0].result.metadata.at("k") == "v" &&
+                                 back.completed[1].awaiting_approval,
+                             "result flags should round trip");
+                     require(back.pending.size() == 1 &&
+                                 back.pending[0].arguments.at("command") == "make",
+                             "pending calls should round trip");
+
+                     require(agent::parse_approval_reply("/approve@ghostbot ap1")->decision ==
+                                 ghostclaw::security::ApprovalDecision::AllowOnce,
+                             "telegram command form should parse");
+                     require(agent::parse_approval_reply("/approve-always ap1")->decision ==
+                                 ghostclaw::security::ApprovalDecision::AllowAlways,
+                             "approve-always should parse");
+                     require(!agent::parse_approval_reply("/approve").has_value() &&
+                                 !agent::parse_approval_reply("/approve ap1 now").has_value() &&
+                                 !agent::parse_approval_reply("/approve ../x").has_value() &&
+                                 !agent::parse_approval_reply("approve ap1").has_value(),
+                             "malformed replies should be ignored");
+                   }});
+
+  tests.push_back({"continuation_store_keeps_claims_until_finished_and_sweeps_stale", [] {
+                     const auto root = make_temp_dir() / "parked";
+                     agent::ContinuationStore store(root, std::chrono::seconds(60));
+                     agent::ParkedTurn turn;
+                     turn.session_id = "s1";
+                     const auto id = store.park(turn);
+                     require(id.ok(), id.error());
+                     require(store.take(id.value()).ok(), "parked turn should be claimable");
+                     require(!store.take(id.value()).ok(), "a claim should be exclusive");
+                     require(std::filesystem::exists(root / (id.value() + ".claimed")),
+                             "the claim should stay on disk while the turn resumes");
+                     store.release(id.value());
+                     require(store.list().size() == 1, "a released turn should be parked again");
+                     require(store.take(id.value()).ok(), "a released turn should be claimable");
+                     store.finish(id.value());
+                     require(std::filesystem::is_empty(root), "a finished turn should be gone");
+
+                     const auto stale = store.park(turn);
+                     require(stale.ok(), stale.error());
+                     std::filesystem::last_write_time(
+                         root / (stale.value() + ".json"),
+                         std::filesystem::file_time_type::clock::now() - std::chrono::hours(1));
+                     require(!store.take(stale.value()).ok(), "an expired turn should not resume");
+                     const auto old = store.park(turn);
+                     require(old.ok(), old.error());
+                     std::filesystem::last_write_time(
+                         root / (old.value() + ".json"),
+                         std::filesystem::file_time_type::clock::now() - std::chrono::hours(1));
+                     const auto fresh = store.park(turn);
+                     require(fresh.ok(), fresh.error());
+                     const auto left = store.list();
+                     require(left.size() == 1 && left[0].id == fresh.value(),
+                             "parking should sweep turns past their TTL");
+                   }});
+
+  tests.push_back({"agent_spills_large_tool_output_to_store", [] {
+                     const auto ws = make_temp_dir();
+                     cfg::Config config;
+                     config.memory.auto_save = false;
+                     config.tools.spill_threshold_bytes = 1024;
+                     std::string value;
+                     for (int i = 0; i < 800; ++i) {
+                       value += "row-" + std::to_string(i) + ";";
+                     }
+                     value += "needle";
+                     auto provider = std::make_shared<SequenceProvider>(
+                         std::vector<ghostclaw::common::Result<std::string>>{
+                             ghostclaw::common::Result<std::string>::success(
+                                 "<tool>echo_tool</tool><args>{\"value\":\"" + value +
+                                 "\"}</args>"),
+                             ghostclaw::common::Result<std::string>::success("final answer"),
+                         });
+
+                     auto memory = std::make_unique<FakeMemory>();
+                     tools::ToolRegistry registry;
+                     registry.register_tool(std::make_unique<EchoTool>());
+                     registry.register_tool(std::make_unique<tools::ToolOutputTool>());
+                     agent::AgentEngine engine(config, provider, std::move(memory), std::move(registry), ws);
+
+                     agent::AgentOptions options;
+                     options.session_id = "spill";
+                     auto result = engine.run("use tool", options);
+                     require(result.ok(), result.error());
+                     require(result.value().tool_results.size() == 1, "expected one tool execution");
+                     const auto &full = result.value().tool_results[0].result.output;
+                     require(full.size() > 4000, "response should keep the full tool output");
+
+                     require(provider->messages.size() == 2, "expected two provider calls");
+                     const auto &prompt = provider->messages[1];
+                     require(prompt.size() < full.size() / 2, "prompt should carry a preview only");
+                     require(prompt.find("tool_output") != std::string::npos,
+                             "preview should point at tool_output");
+                     const auto at = prompt.find("handle out-");
+                     require(at != std::string::npos, "preview should name the handle");
+                     const auto handle = prompt.substr(at + 7, prompt.find('.', at) - at - 7);
+
+                     tools::ToolOutputTool reader;
+                     tools::ToolContext ctx;
+                     ctx.workspace_path = ws;
+                     ctx.session_id = "spill";
+                     auto page = reader.execute({{"handle", handle}, {"pattern", "NEEDLE"}}, ctx);
+                     require(page.ok(), page.error());
+                     require(page.value().output.find("1: value=row-0;") == 0 &&
+                                 page.value().output.find("needle") != std::string::npos,
+                             "grep should return the stored line");
+                   }});
+
+  tests.push_back({"agent_keeps_large_output_inline_when_tool_output_is_unavailable", [] {
+                     const auto ws = make_temp_dir();
+                     cfg::Config config;
+                     config.memory.auto_save = false;
+                     config.tools.spill_threshold_bytes = 1024;
+                     const std::string value(4000, 'x');
+                     auto provider = std::make_shared<SequenceProvider>(
+                         std::vector<ghostclaw::common::Result<std::string>>{
+                             ghostclaw::common::Result<std::string>::success(
+                                 "<tool>echo_tool</tool><args>{\"value\":\"" + value +
+                                 "\"}</args>"),
+                             ghostclaw::common::Result<std::string>::success("final answer"),
+                         });
+                     tools::ToolRegistry registry;
+                     registry.register_tool(std::make_unique<EchoTool>());
+                     agent::AgentEngine engine(config, provider, std::make_unique<FakeMemory>(),
+                                               std::move(registry), ws);
+
+                     auto result = engine.run("use tool", {});
+                     require(result.ok(), result.error());
+                     require(provider->messages.size() == 2, "expected two provider calls");
+                     require(provider->messages[1].find(value) != std::string::npos,
+                             "without tool_output the model should get the whole output");
+                   }});
+
+  tests.push_back({"agent_routes_simple_turns_to_fast_model_and_escalates", [] {
+                     const auto ws = make_temp_dir();
+                     cfg::Config config;
+                     config.memory.auto_save = false;
+                     auto strong = std::make_shared<SequenceProvider>(
+                         std::vector<ghostclaw::common::Result<std::string>>{
+                             ghostclaw::common::Result<std::string>::success("final answer"),
+                         });
+                     auto fast = std::make_shared<SequenceProvider>(
+                         std::vector<ghostclaw::common::Result<std::string>>{
+                             ghostclaw::common::Result<std::string>::success("You're welcome!"),
+                             ghostclaw::common::Result<std::string>::success(
+                                 "<tool>echo_tool</tool><args>{\"value\":\"abc\"}</args>"),
+                         });
+
+                     auto memory = std::make_unique<FakeMemory>();
+                     tools::ToolRegistry registry;
+                     registry.register_tool(std::make_unique<EchoTool>());
+                     agent::AgentEngine engine(config, strong, std::move(memory), std::move(registry), ws);
+                     require(!engine.router_stats().has_value(), "no router by default");
+                     engine.set_model_router(
+                         std::make_shared<ghostclaw::providers::ModelRouter>(config.router, fast));
+
+                     auto simple = engine.run("thanks!");
+                     require(simple.ok(), simple.error());
+                     require(simple.value().content == "You're welcome!", "fast reply expected");
+                     require(strong->call_count == 0, "default model should not be called");
+
+                     auto escalated = engine.run("what is the weather like today?");
+                     require(escalated.ok(), escalated.error());
+                     require(escalated.value().content.find("final answer") != std::string::npos,
+                             "default model should answer after escalation");
+                     require(fast->call_count == 2 && strong->call_count == 1,
+                             "tool use on the fast model should escalate");
+
+                     const auto stats = engine.router_stats();
+                     require(stats.has_value(), "router stats expected");
+                     require(stats->fast_turns == 1 && stats->strong_turns == 1,
+                             "turns should be booked to the serving tier");
+                     require(stats->escalations == 1, "escalation should be counted");
+                   }});
+
+  tests.push_back({"agent_run_reports_usage_and_tool_durations", [] {
+                     const auto ws = make_temp_dir();
+                     cfg::Config config;
+                     config.memory.auto_save = false;
+                     auto provider = std::make_shared<SequenceProvider>(
+                         std::vector<ghostclaw::common::Result<std::string>>{
+                             ghostclaw::common::Result<std::string>::success(
+                                 "<tool>echo_tool</tool><args>{\"value\":\"abc\"}</args>"),
+                             ghostclaw::common::Result<std::string>::success("final answer"),
+                         });
+                     provider->usage_per_call = {.prompt_tokens = 100,
+                                                 .completion_tokens = 10,
+                                                 .cached_prompt_tokens = 40};
+
+                     auto memory = std::make_unique<FakeMemory>();
+                     tools::ToolRegistry registry;
+                     auto tool = std::make_unique<EchoTool>();
+                     tool->delay = std::chrono::milliseconds(20);
+                     registry.register_tool(std::move(tool));
+                     agent::AgentEngine engine(config, provider, std::move(memory), std::move(registry), ws);
+
+                     auto result = engine.run("use tool");
+                     require(result.ok(), result.error());
+                     const auto &usage = result.value().usage;
+                     require(usage.prompt_tokens == 200 && usage.completion_tokens == 20,
+                             "usage should sum over both provider calls");
+                     require(usage.total_tokens == 220, "total tokens mismatch");
+                     require(usage.cached_prompt_tokens == 80, "cached tokens mismatch");
+                     require(result.value().tool_results.size() == 1, "expected one tool execution");
+                     require(result.value().tool_results[0].duration >= std::chrono::milliseconds(20),
+                             "tool duration should be measured");
+                   }});
+
   tests.push_back({"agent_auto_save_to_memory", [] {
                      const auto ws = make_temp_dir();
                      cfg::Config config;
@@ -349,6 +809,7 @@ void register_agent_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
                      agent::AgentEngine engine(config, provider, std::move(memory), std::move(registry), ws);
                      auto result = engine.run("autosave me");
                      require(result.ok(), result.error());
+                     require(engine.memory()->flush().ok(), "auto-save flush failed");
                      require(memory_ptr->store_calls >= 1, "run should autosave conversation");
                    }});
 
@@ -438,4 +899,57 @@ void register_agent_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
                      require(one.size() == 1, "steer mode should pop one");
                      require(!queue.empty(), "one item should remain");
                    }});
+  tests.push_back({"agent_steering_message_cancels_in_flight_turn", [] {
+                     const auto ws = make_temp_dir();
+                     cfg::Config config;
+                     config.memory.auto_save = false;
+                     auto provider = std::make_shared<BlockingProvider>();
+                     tools::ToolRegistry registry;
+                     registry.register_tool(std::make_unique<EchoTool>());
+                     agent::AgentEngine engine(config, provider, std::make_unique<FakeMemory>(),
+                                               std::move(registry), ws);
+
+                     agent::ActiveTurns turns;
+                     auto first = std::make_unique<agent::ActiveTurn>(turns, "s1",
+                                                                      agent::QueueMode::Followup);
+                     agent::AgentOptions options;
+                     options.session_id = "s1";
+                     options.cancel_token = first->token();
+                     auto running = std::async(std::launch::async,
+                                               [&] { return engine.run("long task", options); });
+                     {
+                       std::unique_lock<std::mutex> lock(provider->mutex);
+                       require(provider->cv.wait_for(lock, std::chrono::seconds(5),
+                                                     [&] { return provider->started; }),
+                               "provider call should start");
+                     }
+
+                     // A followup for the same session leaves the running turn alone; a
+                     // steering message supersedes it.
+                     agent::ActiveTurn followup(turns, "s1", agent::QueueMode::Followup);
+                     require(!first->cancelled(), "followup must not cancel the running turn");
+                     const auto steered_at = std::chrono::steady_clock::now();
+                     agent::ActiveTurn steer(turns, "s1", agent::QueueMode::Steer);
+                     require(first->cancelled() && followup.cancelled(),
+                             "steer should cancel every earlier turn for the session");
+                     require(!steer.cancelled(), "steering turn itself stays live");
+
+                     auto result = running.get();
+                     const auto reclaimed = std::chrono::steady_clock::now() - steered_at;
+                     require(!result.ok(), "cancelled turn should fail");
+                     require(result.error() == agent::kTurnCancelled, result.error());
+                     require(reclaimed < std::chrono::seconds(1),
+                             "superseded turn should be reclaimed promptly");
+                     require(ghostclaw::common::current_cancel_token() == nullptr,
+                             "run should not leak its token to the caller thread");
+
+                     agent::AgentOptions late;
+                     late.cancel_token = first->token();
+                     require(!engine.run("queued", late).ok(),
+                             "an already-cancelled turn should not reach the provider");
+                     first.reset();
+                     require(turns.cancel("s1") == 1, "only the steering turn should remain");
+                     require(agent::queue_mode_from_string(" Steer ") == agent::QueueMode::Steer,
+                             "queue mode parsing should be case-insensitive");
+                   }});
 }
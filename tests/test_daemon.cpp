@@ -1,10 +1,14 @@
 #include "test_framework.hpp"
 
 #include "ghostclaw/config/config.hpp"
+#include "ghostclaw/daemon/control.hpp"
 #include "ghostclaw/daemon/daemon.hpp"
 #include "ghostclaw/daemon/pid_file.hpp"
 #include "ghostclaw/daemon/state_writer.hpp"
 #include "ghostclaw/health/health.hpp"
+#include "ghostclaw/memory/memory.hpp"
+#include "ghostclaw/sessions/store.hpp"
+#include "ghostclaw/tools/tool_registry.hpp"
 
 #include <filesystem>
 #include <fstream>
@@ -46,6 +50,23 @@ std::filesystem::path make_temp_home() {
   return path;
 }
 
+class EchoProvider final : public ghostclaw::providers::Provider {
+public:
+  [[nodiscard]] ghostclaw::common::Result<std::string>
+  chat(const std::string &message, const std::string &, double) override {
+    return ghostclaw::common::Result<std::string>::success("echo:  " + message);
+  }
+  [[nodiscard]] ghostclaw::common::Result<std::string>
+  chat_with_system(const std::optional<std::string> &, const std::string &message,
+                   const std::string &, double) override {
+    return ghostclaw::common::Result<std::string>::success("echo:  " + message);
+  }
+  [[nodiscard]] ghostclaw::common::Status warmup() override {
+    return ghostclaw::common::Status::success();
+  }
+  [[nodiscard]] std::string name() const override { return "echo"; }
+};
+
 } // namespace
 
 void register_daemon_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
@@ -126,6 +147,160 @@ void register_daemon_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
                     require(!daemon.is_running(), "daemon should stop");
                   }});
 
+  tests.push_back({"daemon_control_socket_streams_events_and_result", [] {
+                     const auto home = make_temp_home();
+                     const auto socket = home / "ctl.sock";
+                     dm::ControlClient client(socket);
+                     require(!client.available(), "no daemon should be listening yet");
+                     require(!client.call("ping", {}).ok(), "call without daemon should fail");
+
+                     dm::ControlServer server(
+                         socket, [](const std::string &method, const dm::ControlMap &params,
+                                    const dm::ControlEmit &emit) {
+                           if (method == "slow") {
+                             std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+                             return ghostclaw::common::Result<dm::ControlMap>::success({});
+                           }
+                           if (method != "echo") {
+                             return ghostclaw::common::Result<dm::ControlMap>::failure(
+                                 "unknown method: " + method);
+                           }
+                           emit({{"text", "one "}});
+                           emit({{"text", "two\n\"quoted\""}});
+                           return ghostclaw::common::Result<dm::ControlMap>::success(
+                               {{"value", params.at("value")}});
+                         });
+                     auto started = server.start();
+                     require(started.ok(), started.error());
+                     require(client.available(), "client should see the daemon");
+                     require((std::filesystem::status(socket).permissions() &
+                              (std::filesystem::perms::group_all |
+                               std::filesystem::perms::others_all)) ==
+                                 std::filesystem::perms::none,
+                             "socket should only be reachable by its owner");
+                     dm::ControlServer rival(socket, {});
+                     require(!rival.start().ok(), "a live daemon's socket must not be taken over");
+                     require(client.available(), "the first daemon should keep its socket");
+
+                     std::string streamed;
+                     auto result = client.call("echo", {{"value", "a\tb"}},
+                                               [&](const dm::ControlMap &event) {
+                                                 streamed += event.at("text");
+                                               });
+                     require(result.ok(), result.error());
+                     require(result.value().at("value") == "a\tb", "result value mismatch");
+                     require(streamed == "one two\n\"quoted\"", "events should stream in order");
+
+                     auto unknown = client.call("nope", {});
+                     require(!unknown.ok() && unknown.error() == "unknown method: nope",
+                             "handler errors should reach the client");
+
+                     auto slow = client.call("slow", {}, {}, std::chrono::milliseconds(1000));
+                     require(!slow.ok() && slow.error().find("did not answer") != std::string::npos,
+                             "a client timeout should be reported as a timeout: " + slow.error());
+                     server.stop();
+                     require(!client.available(), "socket should be gone after stop");
+
+                     // A file nobody answers on, as a crashed daemon leaves behind, is replaced.
+                     std::ofstream(socket) << "stale";
+                     dm::ControlServer restarted(socket, {});
+                     require(restarted.start().ok(), "start over a stale socket should succeed");
+                     restarted.stop();
+                   }});
+
+  tests.push_back({"daemon_control_service_serves_agent_cron_and_sessions", [] {
+                     const auto workspace = make_temp_home();
+                     cfg::Config config;
+                     config.memory.backend = "markdown";
+                     config.memory.auto_save = false;
+                     int engines_built = 0;
+                     std::vector<std::string> providers_built;
+                     bool flaky_fails = true;
+                     dm::ControlService service(
+                         workspace,
+                         [&](const std::string &provider) {
+                           ++engines_built;
+                           providers_built.push_back(provider);
+                           using EngineResult = ghostclaw::common::Result<
+                               std::shared_ptr<ghostclaw::agent::AgentEngine>>;
+                           if (provider == "flaky" && flaky_fails) {
+                             flaky_fails = false;
+                             return EngineResult::failure("flaky provider down");
+                           }
+                           return EngineResult::success(
+                               std::make_shared<ghostclaw::agent::AgentEngine>(
+                                   config, std::make_shared<EchoProvider>(),
+                                   ghostclaw::memory::create_memory(config, workspace),
+                                   ghostclaw::tools::ToolRegistry{}, workspace));
+                         },
+                         {"other", "flaky"});
+
+                     auto added = service.handle(
+                         "cron.add", {{"expression", "*/5 * * * *"}, {"command", "say hi"}});
+                     require(added.ok(), added.error());
+                     auto listed = service.handle("cron.list", {});
+                     require(listed.ok() && listed.value().at("count") == "1", "cron list count");
+                     require(listed.value().at("output").find("say hi") != std::string::npos,
+                             "cron list should include command");
+                     require(engines_built == 0, "cron must not build an engine");
+
+                     std::string streamed;
+                     auto run = service.handle("agent.run", {{"message", "hello there"}},
+                                               [&](const dm::ControlMap &event) {
+                                                 streamed += event.at("text");
+                                               });
+                     require(run.ok(), run.error());
+                     require(run.value().at("content") == "echo:  hello there",
+                             "agent content mismatch");
+                     require(streamed == run.value().at("content"),
+                             "streamed chunks should reproduce the reply exactly");
+
+                     auto stored = service.handle("memory.store",
+                                                  {{"key", "fav"}, {"content", "green tea"}});
+                     require(stored.ok(), stored.error());
+                     auto recalled = service.handle("memory.recall", {{"query", "tea"}});
+                     require(recalled.ok(), recalled.error());
+                     require(recalled.value().at("output").find("green tea") != std::string::npos,
+                             "recall should find stored memory");
+                     require(engines_built == 1, "engine should be built once and reused");
+
+                     for (int i = 0; i < 2; ++i) {
+                       auto overridden = service.handle(
+                           "agent.run", {{"message", "hi"}, {"provider", "other"}});
+                       require(overridden.ok(), overridden.error());
+                     }
+                     require(providers_built == std::vector<std::string>{"", "other"},
+                             "a provider override should get its own reused engine");
+                     auto unknown = service.handle(
+                         "agent.run", {{"message", "hi"}, {"provider", "unconfigured"}});
+                     require(!unknown.ok() && unknown.error().find("unknown provider") !=
+                                                  std::string::npos,
+                             "an unconfigured provider should be refused");
+                     require(providers_built.size() == 2,
+                             "an unconfigured provider must not build an engine");
+                     require(!service.handle("agent.run", {{"message", "hi"}, {"provider", "flaky"}})
+                                  .ok(),
+                             "a failed build should surface its error");
+                     require(service.handle("agent.run", {{"message", "hi"}, {"provider", "flaky"}})
+                                 .ok(),
+                             "a failed build must not be cached");
+
+                     ghostclaw::sessions::SessionStore sessions(workspace / "sessions");
+                     ghostclaw::sessions::TranscriptEntry entry;
+                     entry.content = "from gateway";
+                     require(sessions
+                                 .append_transcript("agent:ghostclaw:channel:cli:peer:me", entry)
+                                 .ok(),
+                             "transcript append failed");
+                     auto history = service.handle(
+                         "sessions.history", {{"session_id", "agent:ghostclaw:channel:cli:peer:me"}});
+                     require(history.ok(), history.error());
+                     require(history.value().at("output").find("user: from gateway") !=
+                                 std::string::npos,
+                             "history output mismatch");
+                     require(!service.handle("bogus", {}).ok(), "unknown method should fail");
+                   }});
+
   // ============================================
   // NEW TESTS: Component Startup and Dependencies
   // ============================================
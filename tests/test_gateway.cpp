@@ -1,12 +1,17 @@
 #include "test_framework.hpp"
 
 #include "ghostclaw/agent/engine.hpp"
+#include "ghostclaw/browser/cdp.hpp"
+#include "ghostclaw/gateway/cluster.hpp"
+#include "ghostclaw/gateway/http_parser.hpp"
 #include "ghostclaw/gateway/protocol.hpp"
 #include "ghostclaw/gateway/server.hpp"
+#include "ghostclaw/gateway/websocket.hpp"
 #include "ghostclaw/memory/memory.hpp"
 #include "ghostclaw/sessions/store.hpp"
 #include "ghostclaw/tools/tool_registry.hpp"
 
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
@@ -18,6 +23,13 @@
 #include <thread>
 #include <unordered_map>
 
+#include <zlib.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
 namespace {
 
 std::filesystem::path make_temp_dir() {
@@ -71,6 +83,7 @@ public:
   [[nodiscard]] ghostclaw::common::Result<std::string>
   chat_with_system(const std::optional<std::string> &, const std::string &, const std::string &,
                    double) override {
+    ghostclaw::providers::report_usage({.prompt_tokens = 12, .completion_tokens = 3});
     return ghostclaw::common::Result<std::string>::success(response_);
   }
   [[nodiscard]] ghostclaw::common::Status warmup() override {
@@ -170,6 +183,141 @@ std::shared_ptr<ghostclaw::agent::AgentEngine> make_engine(const ghostclaw::conf
   return make_engine_with_provider(config, workspace, provider);
 }
 
+std::uint16_t reserve_local_port() {
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return 0;
+  }
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  socklen_t len = sizeof(addr);
+  std::uint16_t port = 0;
+  if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0 &&
+      getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &len) == 0) {
+    port = ntohs(addr.sin_port);
+  }
+  close(fd);
+  return port;
+}
+
+// Minimal websocket client pieces for exercising permessage-deflate on the wire.
+std::string raw_deflate(const std::string &text) {
+  z_stream stream{};
+  ghostclaw::tests::require(
+      deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) == Z_OK,
+      "deflateInit2 failed");
+  std::string out(deflateBound(&stream, static_cast<uLong>(text.size())) + 16, '\0');
+  stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(text.data()));
+  stream.avail_in = static_cast<uInt>(text.size());
+  stream.next_out = reinterpret_cast<Bytef *>(out.data());
+  stream.avail_out = static_cast<uInt>(out.size());
+  ghostclaw::tests::require(deflate(&stream, Z_SYNC_FLUSH) == Z_OK, "deflate failed");
+  out.resize(out.size() - stream.avail_out - 4);
+  deflateEnd(&stream);
+  return out;
+}
+
+std::string raw_inflate(std::string data) {
+  data.append("\x00\x00\xff\xff", 4);
+  z_stream stream{};
+  ghostclaw::tests::require(inflateInit2(&stream, -15) == Z_OK, "inflateInit2 failed");
+  std::string out(64 * 1024, '\0');
+  stream.next_in = reinterpret_cast<Bytef *>(data.data());
+  stream.avail_in = static_cast<uInt>(data.size());
+  stream.next_out = reinterpret_cast<Bytef *>(out.data());
+  stream.avail_out = static_cast<uInt>(out.size());
+  const int rc = inflate(&stream, Z_SYNC_FLUSH);
+  ghostclaw::tests::require(rc == Z_OK || rc == Z_STREAM_END, "inflate failed");
+  out.resize(out.size() - stream.avail_out);
+  inflateEnd(&stream);
+  return out;
+}
+
+void send_masked_frame(const int fd, const std::string &payload, const bool compressed) {
+  std::string frame;
+  frame.push_back(static_cast<char>(0x81 | (compressed ? 0x40 : 0)));
+  if (payload.size() < 126) {
+    frame.push_back(static_cast<char>(0x80 | payload.size()));
+  } else {
+    frame.push_back(static_cast<char>(0x80 | 126));
+    frame.push_back(static_cast<char>((payload.size() >> 8) & 0xff));
+    frame.push_back(static_cast<char>(payload.size() & 0xff));
+  }
+  const std::array<char, 4> mask = {0x12, 0x34, 0x56, 0x78};
+  frame.append(mask.data(), mask.size());
+  for (std::size_t i = 0; i < payload.size(); ++i) {
+    frame.push_back(static_cast<char>(payload[i] ^ mask[i % 4]));
+  }
+  ghostclaw::tests::require(send(fd, frame.data(), frame.size(), 0) ==
+                                static_cast<ssize_t>(frame.size()),
+                            "frame send failed");
+}
+
+void recv_exactly(const int fd, char *out, const std::size_t size) {
+  std::size_t got = 0;
+  while (got < size) {
+    const ssize_t n = recv(fd, out + got, size - got, 0);
+    ghostclaw::tests::require(n > 0, "connection closed early");
+    got += static_cast<std::size_t>(n);
+  }
+}
+
+// Returns the payload of the next server frame and whether it was compressed.
+std::pair<std::string, bool> recv_frame(const int fd) {
+  std::array<unsigned char, 2> head{};
+  recv_exactly(fd, reinterpret_cast<char *>(head.data()), head.size());
+  std::size_t size = head[1] & 0x7f;
+  if (size == 126) {
+    std::array<unsigned char, 2> ext{};
+    recv_exactly(fd, reinterpret_cast<char *>(ext.data()), ext.size());
+    size = (static_cast<std::size_t>(ext[0]) << 8) | ext[1];
+  } else if (size == 127) {
+    std::array<unsigned char, 8> ext{};
+    recv_exactly(fd, reinterpret_cast<char *>(ext.data()), ext.size());
+    size = 0;
+    for (const auto byte : ext) {
+      size = (size << 8) | byte;
+    }
+  }
+  std::string payload(size, '\0');
+  recv_exactly(fd, payload.data(), size);
+  return {payload, (head[0] & 0x40) != 0};
+}
+
+// Sends `raw` over one connection and reads until the server closes it.
+std::string exchange_raw(const std::uint16_t port, const std::string &raw) {
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  ghostclaw::tests::require(fd >= 0, "socket failed");
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  ghostclaw::tests::require(connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0,
+                            "connect failed");
+  ghostclaw::tests::require(send(fd, raw.data(), raw.size(), 0) ==
+                                static_cast<ssize_t>(raw.size()),
+                            "send failed");
+  std::string out;
+  std::array<char, 4096> buf{};
+  ssize_t n = 0;
+  while ((n = recv(fd, buf.data(), buf.size(), 0)) > 0) {
+    out.append(buf.data(), static_cast<std::size_t>(n));
+  }
+  close(fd);
+  return out;
+}
+
+std::size_t count_of(const std::string &text, const std::string &needle) {
+  std::size_t count = 0;
+  for (auto pos = text.find(needle); pos != std::string::npos;
+       pos = text.find(needle, pos + needle.size())) {
+    ++count;
+  }
+  return count;
+}
+
 } // namespace
 
 void register_gateway_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
@@ -294,6 +442,175 @@ void register_gateway_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
                      server.stop();
                    }});
 
+  tests.push_back({"gateway_cluster_routing_is_stable_across_membership_changes", [] {
+                     std::vector<gw::ClusterWorker> three = {
+                         {.worker_id = "w1"}, {.worker_id = "w2"}, {.worker_id = "w3"}};
+                     std::vector<gw::ClusterWorker> two = {{.worker_id = "w1"},
+                                                           {.worker_id = "w2"}};
+                     std::unordered_map<std::string, int> per_worker;
+                     for (int i = 0; i < 300; ++i) {
+                       const std::string session = "agent:ghostclaw:channel:webhook:peer:p" +
+                                                   std::to_string(i);
+                       const auto owner = gw::route_session(session, three);
+                       require(owner.has_value(), "route should pick an owner");
+                       ++per_worker[owner->worker_id];
+                       const auto again = gw::route_session(session, three);
+                       require(again->worker_id == owner->worker_id, "routing must be stable");
+                       if (owner->worker_id != "w3") {
+                         const auto after_leave = gw::route_session(session, two);
+                         require(after_leave->worker_id == owner->worker_id,
+                                 "sessions of remaining workers must not move");
+                       }
+                     }
+                     require(per_worker.size() == 3, "every worker should own sessions");
+                     require(!gw::route_session("s", {}).has_value(), "no workers, no owner");
+
+                     const auto dir = make_temp_dir() / "cluster";
+                     gw::WorkerRegistry registry(dir, std::chrono::milliseconds(1000));
+                     require(registry.heartbeat({.worker_id = "live", .endpoint = "http://a"}).ok(),
+                             "heartbeat failed");
+                     require(registry
+                                 .heartbeat({.worker_id = "stale",
+                                             .endpoint = "http://b",
+                                             .heartbeat_ms = 1})
+                                 .ok(),
+                             "stale heartbeat failed");
+                     const auto live = registry.live_workers();
+                     require(live.size() == 1 && live[0].worker_id == "live",
+                             "stale lease should be ignored");
+                     require(live[0].endpoint == "http://a", "endpoint should roundtrip");
+                     require(!std::filesystem::exists(dir / "stale.worker"),
+                             "stale lease should be pruned");
+                   }});
+
+  tests.push_back({"gateway_cluster_session_lock_excludes_other_holders", [] {
+                     const auto dir = make_temp_dir() / "cluster";
+                     gw::ClusterCoordinator a(dir, {.worker_id = "a", .endpoint = "http://a"},
+                                              std::chrono::milliseconds(1000));
+                     gw::ClusterCoordinator b(dir, {.worker_id = "b", .endpoint = "http://b"},
+                                              std::chrono::milliseconds(1000));
+                     auto held = a.lock_session("agent:main");
+                     require(held.held(), "session lock should be taken");
+
+                     std::atomic<bool> acquired{false};
+                     std::thread other([&] {
+                       auto waited = b.lock_session("agent:main");
+                       acquired = waited.held();
+                     });
+                     std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                     require(!acquired.load(), "another worker must wait for the session");
+                     held = gw::ClusterLock{};
+                     other.join();
+                     require(acquired.load(), "the waiter should get the lock once released");
+
+                     const auto runner = dir / "runner.lock";
+                     auto first = gw::ClusterLock::try_acquire(runner);
+                     require(first.held(), "runner lock should be free");
+                     require(!gw::ClusterLock::try_acquire(runner).held(),
+                             "a second runner must not get the lock");
+                     first = gw::ClusterLock{};
+                     require(gw::ClusterLock::try_acquire(runner).held(),
+                             "the runner lock should pass on once released");
+                   }});
+
+  tests.push_back({"gateway_cluster_forwards_webhook_to_session_owner", [] {
+                     const auto cluster_dir = make_temp_dir() / "cluster";
+                     auto make_config = [&](const std::string &worker_id) {
+                       ghostclaw::config::Config config;
+                       config.gateway.require_pairing = false;
+                       config.gateway.cluster_enabled = true;
+                       config.gateway.cluster_dir = cluster_dir.string();
+                       config.gateway.cluster_worker_id = worker_id;
+                       config.gateway.cluster_lease_seconds = 2;
+                       return config;
+                     };
+                     auto config_a = make_config("worker-a");
+                     config_a.gateway.websocket_enabled = true;
+                     config_a.gateway.websocket_port = 0;
+                     config_a.gateway.websocket_host = "127.0.0.1";
+                     // worker-b only admits paired clients; forwarded turns get in with the
+                     // shared cluster key instead.
+                     auto config_b = make_config("worker-b");
+                     config_b.gateway.require_pairing = true;
+                     auto engine_a = make_engine_with_provider(
+                         config_a, make_temp_dir(), std::make_shared<SequenceProvider>("from-a"));
+                     auto engine_b = make_engine_with_provider(
+                         config_b, make_temp_dir(), std::make_shared<SequenceProvider>("from-b"));
+                     gw::GatewayServer server_a(config_a, engine_a);
+                     gw::GatewayServer server_b(config_b, engine_b);
+                     gw::GatewayOptions options;
+                     options.host = "127.0.0.1";
+                     options.port = 0;
+                     auto started_b = server_b.start(options);
+                     require(started_b.ok(), started_b.error());
+                     auto started_a = server_a.start(options);
+                     require(started_a.ok(), started_a.error());
+                     require(server_a.cluster() != nullptr, "cluster should be enabled");
+                     require(server_a.cluster()->members().size() == 2,
+                             "worker-a should see both members");
+
+                     std::string owned_by_b;
+                     for (int i = 0; i < 64 && owned_by_b.empty(); ++i) {
+                       const std::string session = "agent:ghostclaw:channel:webhook:peer:p" +
+                                                   std::to_string(i);
+                       const auto owner = server_a.cluster()->remote_owner(session);
+                       if (owner.has_value() && owner->worker_id == "worker-b") {
+                         owned_by_b = session;
+                       }
+                     }
+                     require(!owned_by_b.empty(), "some session should belong to worker-b");
+
+                     gw::HttpRequest req;
+                     req.method = "POST";
+                     req.path = "/webhook";
+                     req.body = "{\"message\":\"hi\",\"session_id\":\"" + owned_by_b + "\"}";
+                     const auto forwarded = server_a.dispatch_for_test(req);
+                     require(forwarded.status == 200, "forwarded webhook should succeed");
+                     require(forwarded.body.find("from-b") != std::string::npos,
+                             "owner should run the turn");
+                     require(forwarded.headers.count("X-Ghostclaw-Worker") == 1 &&
+                                 forwarded.headers.at("X-Ghostclaw-Worker") == "worker-b",
+                             "response should name the owning worker");
+
+                     auto ws_client = ghostclaw::browser::make_websocket_transport();
+                     require(ws_client->connect("ws://127.0.0.1:" +
+                                                std::to_string(server_a.websocket_port()) + "/")
+                                 .ok(),
+                             "connect failed");
+                     require(ws_client
+                                 ->send_text(R"({"type":"rpc","id":"7","method":"agent.run",)"
+                                             R"("message":"hi","session_id":")" +
+                                             owned_by_b + "\"}")
+                                 .ok(),
+                             "send failed");
+                     std::string ws_result;
+                     while (ws_result.empty()) {
+                       auto frame = ws_client->receive_text(std::chrono::milliseconds(5000));
+                       require(frame.ok(), frame.ok() ? "" : frame.error());
+                       if (frame.value().find("\"rpc.result\"") != std::string::npos ||
+                           frame.value().find("\"error\"") != std::string::npos) {
+                         ws_result = frame.value();
+                       }
+                     }
+                     require(ws_result.find("from-b") != std::string::npos &&
+                                 ws_result.find("worker-b") != std::string::npos,
+                             "websocket agent.run should run on the owner: " + ws_result);
+                     ws_client->close();
+
+                     req.headers["x-ghostclaw-forwarded"] = "worker-b";
+                     const auto local = server_a.dispatch_for_test(req);
+                     require(local.body.find("from-a") != std::string::npos,
+                             "forwarded requests must not bounce again");
+
+                     server_b.stop();
+                     req.headers.clear();
+                     const auto takeover = server_a.dispatch_for_test(req);
+                     require(takeover.status == 200, "takeover should succeed");
+                     require(takeover.body.find("from-a") != std::string::npos,
+                             "worker-a should take over once worker-b is gone");
+                     server_a.stop();
+                   }});
+
   tests.push_back({"gateway_webhook_serializes_runs_per_session", [] {
                      ghostclaw::config::Config config;
                      config.gateway.require_pairing = false;
@@ -397,6 +714,21 @@ void register_gateway_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
                      require(!history_resp.error.has_value(), "session.history should succeed");
                      require(history_resp.result["count"] == "2",
                              "history should include user+assistant entries");
+                     require(history_resp.result["total"] == "2" &&
+                                 history_resp.result["first_id"] == "1" &&
+                                 history_resp.result["has_more_before"] == "false",
+                             "history should describe the page");
+
+                     history.params["limit"] = "1";
+                     auto newest = rpc.handle(history);
+                     require(newest.result["last_id"] == "2" &&
+                                 newest.result["has_more_before"] == "true",
+                             "limited page should hold the newest entry");
+                     history.params["before"] = newest.result["first_id"];
+                     auto older = rpc.handle(history);
+                     require(older.result["first_id"] == "1" &&
+                                 older.result["entries_json"].find("\"id\":1") != std::string::npos,
+                             "before should page back to the first entry");
                    }});
 
   tests.push_back({"gateway_rpc_session_overrides_groups_and_provenance", [] {
@@ -507,6 +839,68 @@ void register_gateway_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
                              "missing session should use standard thinking");
                    }});
 
+  tests.push_back({"gateway_rpc_session_usage_accumulates_agent_turns", [] {
+                     ghostclaw::config::Config config;
+                     const auto ws = make_temp_dir();
+                     auto engine = make_engine(config, ws);
+                     FakeMemory memory;
+                     ghostclaw::sessions::SessionStore session_store(ws / "sessions");
+                     gw::RpcHandler rpc(engine, &memory, &session_store, config);
+
+                     for (int i = 0; i < 2; ++i) {
+                       gw::RpcRequest run;
+                       run.id = "run-" + std::to_string(i);
+                       run.method = "agent.run";
+                       run.params["message"] = "hello";
+                       run.params["session_id"] = "counter";
+                       run.params["channel"] = "webhook";
+                       auto resp = rpc.handle(run);
+                       require(!resp.error.has_value(), "agent.run should succeed");
+                       require(resp.result["total_tokens"] == "15", "turn usage missing from result");
+                     }
+
+                     gw::RpcRequest by_session;
+                     by_session.id = "usage-1";
+                     by_session.method = "session.usage";
+                     by_session.params["session_id"] = "counter";
+                     by_session.params["channel"] = "webhook";
+                     auto session_resp = rpc.handle(by_session);
+                     require(!session_resp.error.has_value(), "session.usage should succeed");
+                     require(session_resp.result["turns"] == "2", "session turn count mismatch");
+                     require(session_resp.result["prompt_tokens"] == "24",
+                             "session prompt tokens mismatch");
+                     require(session_resp.result["completion_tokens"] == "6",
+                             "session completion tokens mismatch");
+
+                     gw::RpcRequest by_channel;
+                     by_channel.id = "usage-2";
+                     by_channel.method = "session.usage";
+                     by_channel.params["channel"] = "webhook";
+                     auto channel_resp = rpc.handle(by_channel);
+                     require(!channel_resp.error.has_value(), "channel usage should succeed");
+                     require(channel_resp.result["total_tokens"] == "30",
+                             "channel total tokens mismatch");
+                   }});
+
+  tests.push_back({"gateway_approval_resolve_requires_session", [] {
+                     ghostclaw::config::Config config;
+                     const auto ws = make_temp_dir();
+                     auto engine = make_engine(config, ws);
+                     FakeMemory memory;
+                     ghostclaw::sessions::SessionStore session_store(ws / "sessions");
+                     gw::RpcHandler rpc(engine, &memory, &session_store, config);
+
+                     gw::RpcRequest resolve;
+                     resolve.id = "ap-1";
+                     resolve.method = "approval.resolve";
+                     resolve.params["id"] = "ap123";
+                     resolve.params["decision"] = "allow-once";
+                     auto resp = rpc.handle(resolve);
+                     require(resp.error.has_value() &&
+                                 resp.error->find("session_id") != std::string::npos,
+                             "approval.resolve without a session should be refused");
+                   }});
+
   tests.push_back({"gateway_ws_protocol_parse_subscribe", [] {
                      auto parsed = gw::parse_ws_client_message(
                          R"({"id":"abc","type":"subscribe","session":"agent:main","text":"hello"})");
@@ -621,6 +1015,129 @@ void register_gateway_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
                      server.stop();
                    }});
 
+  tests.push_back({"gateway_websocket_resubscribe_replays_missed_events", [] {
+                     gw::WebSocketServer server;
+                     gw::WebSocketOptions options;
+                     options.port = reserve_local_port();
+                     options.replay_events_per_session = 3;
+                     auto started = server.start(options);
+                     require(started.ok(), started.error());
+
+                     for (int i = 1; i <= 5; ++i) {
+                       require(server.publish_session_event("s1", {{"token", std::to_string(i)}}) ==
+                                   0,
+                               "nobody is subscribed yet");
+                     }
+                     require(server.last_session_seq("s1") == 5, "events are numbered per session");
+                     require(server.last_session_seq("s2") == 0, "unknown session starts at 0");
+
+                     const std::string url = "ws://127.0.0.1:" + std::to_string(server.port()) + "/";
+                     // Next frame after the server's greeting.
+                     const auto next = [](ghostclaw::browser::ICDPTransport &transport) {
+                       while (true) {
+                         auto frame = transport.receive_text(std::chrono::milliseconds(2000));
+                         require(frame.ok(), frame.ok() ? "" : frame.error());
+                         if (frame.value().find("\"type\":\"hello\"") == std::string::npos) {
+                           return frame.value();
+                         }
+                       }
+                     };
+
+                     auto resumed = ghostclaw::browser::make_websocket_transport();
+                     require(resumed->connect(url).ok(), "connect failed");
+                     require(resumed->send_text(
+                                    R"({"type":"subscribe","session":"s1","since":3})").ok(),
+                             "send failed");
+                     const auto ack = next(*resumed);
+                     require(ack.find("\"type\":\"ack\"") != std::string::npos &&
+                                 ack.find("\"seq\":\"5\"") != std::string::npos &&
+                                 ack.find("\"replayed\":\"2\"") != std::string::npos &&
+                                 ack.find("\"truncated\":\"false\"") != std::string::npos,
+                             "ack should report the replay: " + ack);
+                     require(next(*resumed).find("\"seq\":4") != std::string::npos, "replay seq 4");
+                     require(next(*resumed).find("\"seq\":5") != std::string::npos, "replay seq 5");
+
+                     require(server.publish_session_event("s1", {{"token", "6"}}) == 1,
+                             "live events reach the resubscribed client");
+                     const auto live = next(*resumed);
+                     require(live.find("\"seq\":6") != std::string::npos &&
+                                 live.find("\"token\":\"6\"") != std::string::npos,
+                             "live event follows the replay: " + live);
+
+                     auto stale = ghostclaw::browser::make_websocket_transport();
+                     require(stale->connect(url).ok(), "connect failed");
+                     require(stale->send_text(
+                                    R"({"type":"subscribe","session":"s1","since":1})").ok(),
+                             "send failed");
+                     const auto stale_ack = next(*stale);
+                     require(stale_ack.find("\"truncated\":\"true\"") != std::string::npos &&
+                                 stale_ack.find("\"replayed\":\"3\"") != std::string::npos,
+                             "events evicted from the ring are reported: " + stale_ack);
+
+                     const auto stats = server.stats();
+                     require(stats.replay_sessions == 1 && stats.replay_events == 3,
+                             "replay buffer stays bounded");
+                     resumed->close();
+                     stale->close();
+                     server.stop();
+                   }});
+
+  tests.push_back({"gateway_websocket_negotiates_permessage_deflate", [] {
+                     gw::WebSocketServer server;
+                     gw::WebSocketOptions options;
+                     options.port = reserve_local_port();
+                     auto started = server.start(options);
+                     require(started.ok(), started.error());
+
+                     const int fd = socket(AF_INET, SOCK_STREAM, 0);
+                     sockaddr_in addr{};
+                     addr.sin_family = AF_INET;
+                     addr.sin_port = htons(server.port());
+                     addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                     require(connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0,
+                             "connect failed");
+                     const std::string handshake =
+                         "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\nUpgrade: websocket\r\n"
+                         "Connection: Upgrade\r\nSec-WebSocket-Version: 13\r\n"
+                         "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                         "Sec-WebSocket-Extensions: x-unknown, permessage-deflate; "
+                         "client_max_window_bits\r\n\r\n";
+                     require(send(fd, handshake.data(), handshake.size(), 0) ==
+                                 static_cast<ssize_t>(handshake.size()),
+                             "handshake send failed");
+                     std::string response;
+                     while (response.find("\r\n\r\n") == std::string::npos) {
+                       char ch = 0;
+                       recv_exactly(fd, &ch, 1);
+                       response.push_back(ch);
+                     }
+                     require(response.find("Sec-WebSocket-Extensions: permessage-deflate; "
+                                           "server_no_context_takeover; "
+                                           "client_no_context_takeover") != std::string::npos,
+                             "deflate should be accepted: " + response);
+                     require(recv_frame(fd).first.find("hello") != std::string::npos,
+                             "greeting first");
+
+                     send_masked_frame(fd, raw_deflate(R"({"type":"subscribe","session":"s1"})"),
+                                       true);
+                     require(recv_frame(fd).first.find("\"type\":\"ack\"") != std::string::npos,
+                             "compressed client frames are inflated");
+
+                     const std::string big(4000, 'x');
+                     require(server.publish_session_event("s1", {{"text", big}}) == 1,
+                             "event should be delivered");
+                     const auto [payload, compressed] = recv_frame(fd);
+                     require(compressed && payload.size() < 1000,
+                             "large events should be compressed");
+                     const auto event = raw_inflate(payload);
+                     require(event.find("\"seq\":1") != std::string::npos &&
+                                 event.find(big) != std::string::npos,
+                             "compressed event should inflate to the original");
+
+                     close(fd);
+                     server.stop();
+                   }});
+
   tests.push_back({"gateway_websocket_tls_requires_cert_and_key", [] {
                      ghostclaw::config::Config config;
                      config.gateway.require_pairing = false;
@@ -638,4 +1155,217 @@ void register_gateway_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
                      auto started = server.start(options);
                      require(!started.ok(), "websocket tls should fail without cert/key");
                    }});
+
+  tests.push_back({"gateway_http_parser_resumes_across_split_reads", [] {
+                     const std::string raw = "POST /webhook?x=1 HTTP/1.1\r\n"
+                                             "Host: localhost\r\n"
+                                             "X-Pairing-Code: 1234\r\n"
+                                             "Content-Length: 11\r\n"
+                                             "\r\n"
+                                             "hello world";
+                     gw::HttpRequestParser whole;
+                     require(whole.feed(raw) == raw.size(), "whole request should fit");
+                     require(whole.status() == gw::HttpParseStatus::Complete, "whole parse");
+
+                     gw::HttpRequestParser split;
+                     for (std::size_t i = 0; i < raw.size(); ++i) {
+                       require(split.status() == gw::HttpParseStatus::NeedMore,
+                               "should need more before the last byte");
+                       (void)split.feed(std::string_view(raw).substr(i, 1));
+                     }
+                     require(split.status() == gw::HttpParseStatus::Complete, "split parse");
+                     for (const auto *parser : {&whole, &split}) {
+                       const auto &req = parser->request();
+                       require(req.method == "POST" && req.target == "/webhook?x=1",
+                               "request line");
+                       require(req.headers.size() == 3, "header count");
+                       require(req.header("x-pairing-code") == "1234",
+                               "headers are case-insensitive");
+                       require(req.body == "hello world", "body");
+                       require(req.keep_alive, "HTTP/1.1 defaults to keep-alive");
+                     }
+                   }});
+
+  tests.push_back({"gateway_http_parser_decodes_chunked_and_pipelined", [] {
+                     const std::string raw = "POST /a HTTP/1.1\r\n"
+                                             "Transfer-Encoding: chunked\r\n"
+                                             "\r\n"
+                                             "5\r\nhello\r\n"
+                                             "6;ext=1\r\n world\r\n"
+                                             "0\r\n"
+                                             "X-Trailer: ignored\r\n"
+                                             "\r\n"
+                                             "GET /b HTTP/1.0\r\n\r\n";
+                     gw::HttpRequestParser parser;
+                     (void)parser.feed(raw);
+                     require(parser.status() == gw::HttpParseStatus::Complete, "first request");
+                     require(parser.request().body == "hello world", "chunked body decoded");
+                     require(parser.has_pipelined(), "second request is pipelined");
+
+                     require(parser.consume() == gw::HttpParseStatus::Complete,
+                             "second request parses from leftovers");
+                     require(parser.request().target == "/b", "second target");
+                     require(parser.request().body.empty(), "no body");
+                     require(!parser.request().keep_alive, "HTTP/1.0 closes by default");
+                     require(parser.consume() == gw::HttpParseStatus::NeedMore,
+                             "nothing left after the second request");
+                   }});
+
+  tests.push_back({"gateway_http_parser_enforces_limits", [] {
+                     const auto status_of = [](const std::string &raw,
+                                               gw::HttpParserLimits limits = {}) {
+                       gw::HttpRequestParser parser(limits);
+                       std::size_t offset = 0;
+                       while (offset < raw.size() &&
+                              parser.status() == gw::HttpParseStatus::NeedMore) {
+                         const auto taken = parser.feed(std::string_view(raw).substr(offset));
+                         if (taken == 0) {
+                           break;
+                         }
+                         offset += taken;
+                       }
+                       return parser.status() == gw::HttpParseStatus::Error ? parser.error_status()
+                                                                            : 0;
+                     };
+                     require(status_of("GET / HTTP/1.1\r\nX: " + std::string(20000, 'a') +
+                                       "\r\n\r\n") == 431,
+                             "oversized head");
+                     std::string many = "GET / HTTP/1.1\r\n";
+                     for (int i = 0; i < 8; ++i) {
+                       many += "X-" + std::to_string(i) + ": v\r\n";
+                     }
+                     require(status_of(many + "\r\n", {.max_head_bytes = 16 * 1024,
+                                                       .max_headers = 4,
+                                                       .max_body_bytes = 1024}) == 431,
+                             "too many headers");
+                     require(status_of("POST / HTTP/1.1\r\nContent-Length: 70000\r\n\r\n") == 413,
+                             "declared body over the limit");
+                     require(status_of("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                                       "ffffff\r\n") == 413,
+                             "chunk over the limit");
+                     require(status_of("POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n") == 501,
+                             "unsupported transfer coding");
+                     require(status_of("POST / HTTP/1.1\r\nContent-Length: 1\r\n"
+                                       "Transfer-Encoding: chunked\r\n\r\n") == 400,
+                             "Content-Length with Transfer-Encoding");
+                     require(status_of("POST / HTTP/1.1\r\nContent-Length: 1\r\n"
+                                       "Content-Length: 2\r\n\r\n") == 400,
+                             "conflicting Content-Length");
+                     require(status_of("GET / HTTP/2.0\r\n\r\n") == 505, "unsupported version");
+                     require(status_of("GE T / HTTP/1.1\r\n\r\n") == 400, "malformed request line");
+                     require(status_of("GET / HTTP/1.1\r\nBad Header: x\r\n\r\n") == 400,
+                             "invalid header name");
+                   }});
+
+  tests.push_back({"gateway_http_parser_survives_mutated_input", [] {
+                     const std::vector<std::string> seeds = {
+                         "POST /webhook HTTP/1.1\r\nContent-Length: 5\r\n\r\nhello",
+                         "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabc\r\n0\r\n\r\n",
+                         "GET /health HTTP/1.1\r\nConnection: close\r\n\r\nGET / HTTP/1.1\r\n\r\n",
+                     };
+                     std::mt19937 rng(91);
+                     for (int round = 0; round < 3000; ++round) {
+                       std::string input = seeds[static_cast<std::size_t>(round) % seeds.size()];
+                       const int edits = 1 + static_cast<int>(rng() % 6);
+                       for (int e = 0; e < edits && !input.empty(); ++e) {
+                         const auto at = rng() % input.size();
+                         switch (rng() % 3) {
+                         case 0:
+                           input[at] = static_cast<char>(rng() & 0xff);
+                           break;
+                         case 1:
+                           input.erase(at, 1);
+                           break;
+                         default:
+                           input.insert(at, 1, static_cast<char>(rng() & 0xff));
+                           break;
+                         }
+                       }
+                       gw::HttpRequestParser parser(
+                           {.max_head_bytes = 256, .max_headers = 8, .max_body_bytes = 64});
+                       std::size_t offset = 0;
+                       while (offset < input.size()) {
+                         const auto step = std::min<std::size_t>(1 + rng() % 7, input.size() - offset);
+                         const auto taken = parser.feed(std::string_view(input).substr(offset, step));
+                         offset += taken;
+                         if (parser.status() == gw::HttpParseStatus::Error) {
+                           break;
+                         }
+                         if (parser.status() == gw::HttpParseStatus::Complete) {
+                           const auto &req = parser.request();
+                           require(req.body.size() <= 64, "body stays within the limit");
+                           (void)parser.consume();
+                         } else if (taken == 0) {
+                           break;
+                         }
+                       }
+                     }
+                   }});
+
+  tests.push_back({"gateway_http_keep_alive_serves_pipelined_requests", [] {
+                     ghostclaw::config::Config config;
+                     config.gateway.require_pairing = false;
+                     const auto ws = make_temp_dir();
+                     auto engine = make_engine(config, ws);
+
+                     gw::GatewayServer server(config, engine);
+                     gw::GatewayOptions options;
+                     options.host = "127.0.0.1";
+                     options.port = 0;
+                     auto started = server.start(options);
+                     require(started.ok(), started.error());
+
+                     const auto replies = exchange_raw(
+                         server.port(), "GET /health HTTP/1.1\r\nHost: x\r\n\r\n"
+                                        "GET /health HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n");
+                     require(count_of(replies, "HTTP/1.1 200 OK") == 2,
+                             "both pipelined requests should be answered");
+                     require(count_of(replies, "Connection: keep-alive") == 1 &&
+                                 count_of(replies, "Connection: close") == 1,
+                             "connection should close only when asked");
+
+                     // An idle keep-alive connection survives other clients connecting.
+                     const int idle = socket(AF_INET, SOCK_STREAM, 0);
+                     sockaddr_in addr{};
+                     addr.sin_family = AF_INET;
+                     addr.sin_port = htons(server.port());
+                     addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                     require(connect(idle, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0,
+                             "connect failed");
+                     timeval timeout{.tv_sec = 5, .tv_usec = 0};
+                     (void)setsockopt(idle, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+                     const auto send_text = [idle](const std::string &text) {
+                       return send(idle, text.data(), text.size(), 0) ==
+                              static_cast<ssize_t>(text.size());
+                     };
+                     std::string idle_replies;
+                     std::array<char, 4096> buf{};
+                     require(send_text("GET /health HTTP/1.1\r\nHost: x\r\n\r\n"), "send failed");
+                     while (count_of(idle_replies, "HTTP/1.1 200 OK") < 1) {
+                       const ssize_t n = recv(idle, buf.data(), buf.size(), 0);
+                       require(n > 0, "first keep-alive reply missing");
+                       idle_replies.append(buf.data(), static_cast<std::size_t>(n));
+                     }
+                     require(count_of(exchange_raw(server.port(),
+                                                   "GET /health HTTP/1.1\r\nHost: x\r\n"
+                                                   "Connection: close\r\n\r\n"),
+                                      "HTTP/1.1 200 OK") == 1,
+                             "second client should be served");
+                     require(send_text("GET /health HTTP/1.1\r\nHost: x\r\n"
+                                       "Connection: close\r\n\r\n"),
+                             "idle connection was closed by another client");
+                     for (ssize_t n = 0; (n = recv(idle, buf.data(), buf.size(), 0)) > 0;) {
+                       idle_replies.append(buf.data(), static_cast<std::size_t>(n));
+                     }
+                     close(idle);
+                     require(count_of(idle_replies, "HTTP/1.1 200 OK") == 2,
+                             "idle keep-alive connection should keep serving");
+
+                     const auto rejected = exchange_raw(
+                         server.port(), "POST /webhook HTTP/1.1\r\nContent-Length: 999999\r\n\r\n");
+                     require(rejected.rfind("HTTP/1.1 413", 0) == 0, "oversized body rejected");
+                     require(rejected.find("request_too_large") != std::string::npos,
+                             "413 body keeps its error code");
+                     server.stop();
+                   }});
 }
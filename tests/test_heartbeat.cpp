@@ -4,14 +4,17 @@
 #include "ghostclaw/heartbeat/cron.hpp"
 #include "ghostclaw/heartbeat/cron_store.hpp"
 #include "ghostclaw/heartbeat/engine.hpp"
+#include "ghostclaw/heartbeat/job_pool.hpp"
 #include "ghostclaw/heartbeat/scheduler.hpp"
 #include "ghostclaw/memory/memory.hpp"
 #include "ghostclaw/tools/tool_registry.hpp"
 
+#include <atomic>
 #include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <random>
 #include <thread>
@@ -341,6 +344,35 @@ void register_heartbeat_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
                    }});
 
   // ============================================
+  tests.push_back({"heartbeat_job_pool_skips_busy_keys_and_drops_queue_on_stop", [] {
+                     std::mutex gate;
+                     std::unique_lock<std::mutex> hold(gate);
+                     std::atomic<bool> started{false};
+                     std::atomic<int> ran{0};
+                     hb::JobPool pool(1);
+                     require(pool.post("a",
+                                       [&] {
+                                         started = true;
+                                         std::lock_guard<std::mutex> wait(gate);
+                                         ++ran;
+                                       }),
+                             "first job should be accepted");
+                     while (!started.load()) {
+                       std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                     }
+                     require(!pool.post("a", [&] { ++ran; }),
+                             "a key still running should not be queued again");
+                     require(pool.post("b", [&] { ++ran; }), "another key should queue");
+                     require(pool.busy() == 2, "both jobs should count as busy");
+                     std::thread stopper([&] { pool.stop(); });
+                     std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                     hold.unlock();
+                     stopper.join();
+                     require(ran.load() == 1, "stop should wait for the running job only");
+                     require(!pool.post("c", [&] { ++ran; }), "a stopped pool takes no jobs");
+                     require(pool.busy() == 0, "nothing should stay busy after stop");
+                   }});
+
   // NEW TESTS: Scheduler Behavior
   // ============================================
 
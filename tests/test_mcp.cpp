@@ -2,10 +2,14 @@
 
 #include "ghostclaw/config/config.hpp"
 #include "ghostclaw/mcp/client.hpp"
+#include "ghostclaw/mcp/fleet.hpp"
 #include "ghostclaw/mcp/tool.hpp"
 
+#include <chrono>
 #include <filesystem>
 #include <fstream>
+#include <sstream>
+#include <thread>
 
 namespace {
 
@@ -30,6 +34,43 @@ struct ConfigOverrideGuard {
   }
 };
 
+// Minimal stdio MCP server: answers initialize, lists "echo" and "quit", and exits
+// after answering a "quit" call. Every launch appends a line to the log file.
+ghostclaw::config::McpServerConfig write_fake_server(const std::filesystem::path &dir) {
+  std::filesystem::create_directories(dir);
+  const auto script = dir / "server.sh";
+  std::ofstream out(script);
+  out << R"SH(echo started >> "$1"
+while IFS= read -r line; do
+  id=$(printf '%s' "$line" | sed -n 's/.*"id":\([0-9][0-9]*\).*/\1/p')
+  [ -z "$id" ] && continue
+  case "$line" in
+    *'"method":"initialize"'*) printf '{"jsonrpc":"2.0","id":%s,"result":{}}\n' "$id" ;;
+    *'"method":"tools/list"'*) printf '{"jsonrpc":"2.0","id":%s,"result":{"tools":[{"name":"echo","description":"Echo text","inputSchema":{"type":"object"}},{"name":"quit","description":"Exit","inputSchema":{"type":"object"}}]}}\n' "$id" ;;
+    *'"name":"quit"'*) printf '{"jsonrpc":"2.0","id":%s,"result":{"content":[{"type":"text","text":"bye"}]}}\n' "$id"; exit 0 ;;
+    *) printf '{"jsonrpc":"2.0","id":%s,"result":{"content":[{"type":"text","text":"pong"}]}}\n' "$id" ;;
+  esac
+done
+)SH";
+  out.close();
+
+  ghostclaw::config::McpServerConfig server;
+  server.id = "fake";
+  server.command = "/bin/sh";
+  server.args = {script.string(), (dir / "starts.log").string()};
+  return server;
+}
+
+std::size_t count_starts(const std::filesystem::path &dir) {
+  std::ifstream in(dir / "starts.log");
+  std::size_t lines = 0;
+  std::string line;
+  while (std::getline(in, line)) {
+    ++lines;
+  }
+  return lines;
+}
+
 } // namespace
 
 void register_mcp_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
@@ -159,6 +200,64 @@ default_model = "test"
     require(tool.group() == "mcp", "MCP tools should be in 'mcp' group");
   }});
 
+  tests.push_back({"mcp_fleet_shares_servers_and_starts_cached_servers_lazily", [] {
+    const auto dir = std::filesystem::temp_directory_path() / "ghostclaw_test_mcp_fleet";
+    std::filesystem::remove_all(dir);
+    const auto server = write_fake_server(dir);
+    const auto cache_dir = dir / "cache";
+
+    {
+      ghostclaw::mcp::McpFleet fleet;
+      auto first = fleet.collect_tools({server}, cache_dir);
+      auto second = fleet.collect_tools({server}, cache_dir);
+      require(first.size() == 2 && second.size() == 2, "both registries should get both tools");
+      require(count_starts(dir) == 1, "the server should be launched once for both registries");
+      require(fleet.acquire(server) == fleet.acquire(server), "same config should share a client");
+      require(fleet.running_count() == 1, "one server process expected");
+    }
+
+    ghostclaw::mcp::McpFleet fresh;
+    auto cached = fresh.collect_tools({server}, cache_dir);
+    require(cached.size() == 2, "tool list should come from the disk cache");
+    require(cached[0]->name() == "mcp_fake_echo", "cached tool name should round-trip");
+    require(count_starts(dir) == 1, "a cached server should not start before use");
+    require(fresh.running_count() == 0, "nothing should be running yet");
+
+    auto result = cached[0]->execute({{"text", "hi"}}, {});
+    require(result.ok(), result.ok() ? "" : result.error());
+    require(result.value().output == "pong", "tool call should reach the server");
+    require(count_starts(dir) == 2, "first use should start the server");
+
+    cached.clear();
+    require(fresh.running_count() == 0, "releasing the last tool should stop the server");
+    std::filesystem::remove_all(dir);
+  }});
+
+  tests.push_back({"mcp_client_restarts_server_after_exit", [] {
+    const auto dir = std::filesystem::temp_directory_path() / "ghostclaw_test_mcp_restart";
+    std::filesystem::remove_all(dir);
+    ghostclaw::mcp::McpClient client(write_fake_server(dir));
+
+    require(!client.health_check(), "a never-started server should be left alone");
+    auto bye = client.call_tool("quit", "{}");
+    require(bye.ok() && bye.value() == "bye", "quit call should be answered");
+    // Let the server exit; a request sent before it does would race the shutdown.
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+    auto pong = client.call_tool("echo", "{}");
+    require(pong.ok(), pong.ok() ? "" : pong.error());
+    require(pong.value() == "pong", "call after exit should reach a restarted server");
+    require(client.restart_count() == 1, "one restart expected");
+    require(count_starts(dir) == 2, "server should have been launched twice");
+
+    (void)client.call_tool("quit", "{}");
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    require(client.health_check(), "health check should restart the exited server");
+    require(client.restart_count() == 2, "health check restart should be counted");
+    client.stop();
+    std::filesystem::remove_all(dir);
+  }});
+
   tests.push_back({"mcp_config_validation", [] {
     ghostclaw::config::Config config;
     ghostclaw::config::McpServerConfig server;
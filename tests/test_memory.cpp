@@ -10,13 +10,16 @@
 #include "ghostclaw/memory/sqlite_store.hpp"
 #include "ghostclaw/memory/vector_index.hpp"
 #include "ghostclaw/memory/workspace_indexer.hpp"
+#include "ghostclaw/memory/write_behind.hpp"
 
 #include <chrono>
 #include <filesystem>
 #include <fstream>
+#include <future>
 #include <random>
 #include <thread>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace {
 
@@ -42,6 +45,10 @@ public:
   [[nodiscard]] ghostclaw::common::Status store(const std::string &key, const std::string &content,
                                                 ghostclaw::memory::MemoryCategory) override {
     ++store_calls;
+    if (fail_stores > 0) {
+      --fail_stores;
+      return ghostclaw::common::Status::error("forced store failure");
+    }
     entries[key] = content;
     return ghostclaw::common::Status::success();
   }
@@ -83,6 +90,7 @@ public:
   }
 
   std::size_t store_calls = 0;
+  std::size_t fail_stores = 0;
   std::unordered_map<std::string, std::string> entries;
 };
 
@@ -109,6 +117,34 @@ private:
   std::size_t dimensions_;
 };
 
+// Holds embed_batch (the write-behind path) until released; embed returns at once.
+class GatedEmbedder final : public ghostclaw::memory::IEmbedder {
+public:
+  explicit GatedEmbedder(std::shared_future<void> release) : release_(std::move(release)) {}
+
+  [[nodiscard]] std::string_view name() const override { return "gated"; }
+
+  [[nodiscard]] ghostclaw::common::Result<std::vector<float>>
+  embed(std::string_view) override {
+    return ghostclaw::common::Result<std::vector<float>>::success(std::vector<float>(8, 0.5f));
+  }
+
+  [[nodiscard]] ghostclaw::common::Result<std::vector<std::vector<float>>>
+  embed_batch(const std::vector<std::string> &texts) override {
+    batch_started.set_value();
+    release_.wait();
+    return ghostclaw::common::Result<std::vector<std::vector<float>>>::success(
+        std::vector<std::vector<float>>(texts.size(), std::vector<float>(8, 0.5f)));
+  }
+
+  [[nodiscard]] std::size_t dimensions() const override { return 8; }
+
+  std::promise<void> batch_started;
+
+private:
+  std::shared_future<void> release_;
+};
+
 } // namespace
 
 void register_memory_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
@@ -363,6 +399,161 @@ void register_memory_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
                              "recall should return keyword/recency fallback results");
                    }});
 
+  tests.push_back({"unique_memory_key_does_not_collide_within_a_second", [] {
+                     std::unordered_set<std::string> keys;
+                     for (int i = 0; i < 1000; ++i) {
+                       const auto key = mem::unique_memory_key("conversation");
+                       require(key.starts_with("conversation_"), "key prefix mismatch");
+                       keys.insert(key);
+                     }
+                     require(keys.size() == 1000, "generated keys should be unique");
+                   }});
+
+  tests.push_back({"write_behind_memory_serves_pending_entries_and_flushes_batch", [] {
+                     const auto ws = make_temp_dir();
+                     cfg::MemoryConfig conf;
+                     conf.embedding_dimensions = 8;
+                     conf.embedding_cache_size = 64;
+
+                     auto sqlite = std::make_unique<mem::SqliteMemory>(
+                         ws / "brain.db", std::make_unique<mem::NoopEmbedder>(8), conf);
+                     auto *backend = sqlite.get();
+                     mem::WriteBehindOptions options;
+                     options.linger = std::chrono::seconds(30);
+                     options.max_batch = 8;
+                     mem::WriteBehindMemory memory(std::move(sqlite), options);
+
+                     memory.enqueue("turn_a", "User: rocket launch\nAssistant: go",
+                                    mem::MemoryCategory::Daily);
+                     memory.enqueue("turn_b", "User: weather\nAssistant: sunny",
+                                    mem::MemoryCategory::Daily);
+                     require(memory.pending() == 2, "entries should wait in the queue");
+
+                     auto got = memory.get("turn_a");
+                     require(got.ok() && got.value().has_value(), "pending entry should be readable");
+                     auto recalled = memory.recall("rocket", 5);
+                     require(recalled.ok(), recalled.error());
+                     require(!recalled.value().empty() && recalled.value().front().key == "turn_a",
+                             "recall should match pending entries by keyword");
+
+                     require(memory.flush().ok(), "flush failed");
+                     require(memory.pending() == 0, "flush should drain the queue");
+                     auto stored = backend->get("turn_b");
+                     require(stored.ok() && stored.value().has_value(),
+                             "flushed entry should reach the backend");
+                     auto counted = memory.count();
+                     require(counted.ok() && counted.value() == 2, "count mismatch after flush");
+
+                     memory.enqueue("turn_c", "queued at shutdown", mem::MemoryCategory::Daily);
+                     auto forgotten = memory.forget("turn_c");
+                     require(forgotten.ok() && forgotten.value(), "forget should drop pending entry");
+                     require(memory.pending() == 0, "forgotten entry should not be written");
+                   }});
+
+  tests.push_back({"write_behind_memory_store_is_not_overwritten_by_in_flight_batch", [] {
+                     const auto ws = make_temp_dir();
+                     cfg::MemoryConfig conf;
+                     conf.embedding_dimensions = 8;
+                     std::promise<void> release;
+                     auto embedder = std::make_unique<GatedEmbedder>(release.get_future().share());
+                     auto batch_started = embedder->batch_started.get_future();
+                     auto sqlite = std::make_unique<mem::SqliteMemory>(ws / "brain.db",
+                                                                       std::move(embedder), conf);
+                     auto *backend = sqlite.get();
+                     mem::WriteBehindOptions options;
+                     options.linger = std::chrono::milliseconds(0);
+                     mem::WriteBehindMemory memory(std::move(sqlite), options);
+
+                     memory.enqueue("turn_a", "older", mem::MemoryCategory::Daily);
+                     batch_started.wait();
+                     auto stored = std::async(std::launch::async, [&memory]() {
+                       return memory.store("turn_a", "newer", mem::MemoryCategory::Daily);
+                     });
+                     require(stored.wait_for(std::chrono::milliseconds(50)) ==
+                                 std::future_status::timeout,
+                             "store should wait for the in-flight batch holding its key");
+                     release.set_value();
+                     require(stored.get().ok(), "store failed");
+                     require(memory.flush().ok(), "flush failed");
+
+                     auto got = backend->get("turn_a");
+                     require(got.ok() && got.value().has_value() &&
+                                 got.value()->content == "newer",
+                             "the explicit store should win over the older batched write");
+                   }});
+
+  tests.push_back({"write_behind_memory_retries_failed_batches_before_dropping", [] {
+                     auto counting = std::make_unique<CountingMemory>();
+                     auto *backend = counting.get();
+                     backend->fail_stores = 2;
+                     mem::WriteBehindOptions options;
+                     options.linger = std::chrono::milliseconds(0);
+                     options.retry_backoff = std::chrono::milliseconds(1);
+                     mem::WriteBehindMemory memory(std::move(counting), options);
+
+                     memory.enqueue("turn_a", "kept", mem::MemoryCategory::Daily);
+                     require(memory.flush().ok(), "a batch that lands on retry should flush cleanly");
+                     require(backend->entries.count("turn_a") == 1,
+                             "retried batch should reach the backend");
+
+                     backend->fail_stores = 10;
+                     memory.enqueue("turn_b", "lost", mem::MemoryCategory::Daily);
+                     const auto flushed = memory.flush();
+                     require(!flushed.ok() && flushed.error().find("forced") != std::string::npos,
+                             "flush should report a batch dropped after its retries");
+                     require(backend->fail_stores == 7, "retries should be bounded");
+                     require(memory.pending() == 0, "dropped batch should leave the queue");
+                   }});
+
+  tests.push_back({"write_behind_memory_count_skips_pending_keys_already_stored", [] {
+                     const auto ws = make_temp_dir();
+                     cfg::MemoryConfig conf;
+                     conf.embedding_dimensions = 8;
+                     auto sqlite = std::make_unique<mem::SqliteMemory>(
+                         ws / "brain.db", std::make_unique<mem::NoopEmbedder>(8), conf);
+                     mem::WriteBehindOptions options;
+                     options.linger = std::chrono::seconds(30);
+                     mem::WriteBehindMemory memory(std::move(sqlite), options);
+
+                     require(memory.store("turn_a", "stored", mem::MemoryCategory::Daily).ok(),
+                             "store failed");
+                     memory.enqueue("turn_a", "updated", mem::MemoryCategory::Daily);
+                     memory.enqueue("turn_b", "new", mem::MemoryCategory::Daily);
+                     memory.enqueue("turn_b", "newer", mem::MemoryCategory::Daily);
+                     auto counted = memory.count();
+                     require(counted.ok() && counted.value() == 2,
+                             "count should add only distinct keys the backend lacks");
+                     require(memory.stats().total_entries == 2, "stats total mismatch");
+                   }});
+
+  tests.push_back({"memory_write_epoch_moves_on_every_visible_write", [] {
+                     const auto ws = make_temp_dir();
+                     cfg::MemoryConfig conf;
+                     conf.embedding_dimensions = 8;
+                     auto sqlite = std::make_unique<mem::SqliteMemory>(
+                         ws / "brain.db", std::make_unique<mem::NoopEmbedder>(8), conf);
+                     mem::WriteBehindOptions options;
+                     options.linger = std::chrono::seconds(30);
+                     mem::WriteBehindMemory memory(std::move(sqlite), options);
+
+                     const auto initial = memory.write_epoch();
+                     require(initial.has_value(), "sqlite backend should report an epoch");
+                     auto recalled = memory.recall("anything", 5);
+                     require(recalled.ok() && memory.write_epoch() == initial,
+                             "reads should not move the epoch");
+
+                     memory.enqueue("turn_a", "queued", mem::MemoryCategory::Daily);
+                     const auto queued = memory.write_epoch();
+                     require(queued.has_value() && *queued > *initial, "enqueue should move the epoch");
+                     require(memory.flush().ok(), "flush failed");
+                     const auto flushed = memory.write_epoch();
+                     require(*flushed > *queued, "backend write should move the epoch");
+
+                     auto forgotten = memory.forget("turn_a");
+                     require(forgotten.ok() && forgotten.value(), "forget failed");
+                     require(*memory.write_epoch() > *flushed, "forget should move the epoch");
+                   }});
+
   tests.push_back({"create_memory_factory_backend_selection", [] {
                      const auto ws = make_temp_dir();
                      cfg::Config config;
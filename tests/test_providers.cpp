@@ -1,14 +1,38 @@
 #include "test_framework.hpp"
 
+#include "ghostclaw/common/cancel.hpp"
+#include "ghostclaw/common/json_util.hpp"
 #include "ghostclaw/config/schema.hpp"
 #include "ghostclaw/providers/compatible.hpp"
+#include "ghostclaw/providers/admission.hpp"
+#include "ghostclaw/providers/batch.hpp"
 #include "ghostclaw/providers/factory.hpp"
+#include "ghostclaw/providers/gguf.hpp"
+#include "ghostclaw/providers/local.hpp"
+#include "ghostclaw/providers/local_model.hpp"
 #include "ghostclaw/providers/reliable.hpp"
+#include "ghostclaw/providers/router.hpp"
 #include "ghostclaw/providers/traits.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <random>
+#include <sstream>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 namespace {
 
@@ -102,6 +126,254 @@ void unset_test_env(const char *name) {
 #endif
 }
 
+// Polls until `key` has `count` queued requests, so tests can order their waiters.
+void wait_for_queued(const std::string &key, const std::size_t count) {
+  for (int i = 0; i < 500; ++i) {
+    for (const auto &stats : ghostclaw::providers::AdmissionController::shared().stats()) {
+      if (stats.key == key && stats.queued == count) {
+        return;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+}
+
+ghostclaw::providers::AdmissionStats admission_stats(const std::string &key) {
+  for (const auto &stats : ghostclaw::providers::AdmissionController::shared().stats()) {
+    if (stats.key == key) {
+      return stats;
+    }
+  }
+  return {};
+}
+
+std::filesystem::path make_temp_dir() {
+  static std::mt19937_64 rng{std::random_device{}()};
+  const auto base = std::filesystem::temp_directory_path() /
+                    ("ghostclaw-providers-test-" + std::to_string(rng()));
+  std::filesystem::create_directories(base);
+  return base;
+}
+
+// A tiny llama-architecture model with random weights: a SentencePiece vocabulary of
+// whole words and letters, 2 layers, 4 query heads sharing 2 KV heads. Attention weights
+// are Q8_0 and the rest F32 so both kernels are exercised.
+std::filesystem::path write_tiny_llama(const std::filesystem::path &dir) {
+  namespace p = ghostclaw::providers;
+  const std::string space = "\xE2\x96\x81";
+  std::vector<std::string> pieces = {"<unk>", "<s>", "</s>", space};
+  std::vector<std::int32_t> types = {2, 3, 3, 1};
+  // Merges only go through pieces in the vocabulary, so every word prefix is a piece.
+  for (const std::string word : {"hello", "world", "the", "cat", "sat", "on", "mat"}) {
+    for (std::size_t len = 1; len <= word.size(); ++len) {
+      const std::string piece = space + word.substr(0, len);
+      if (std::find(pieces.begin(), pieces.end(), piece) == pieces.end()) {
+        pieces.push_back(piece);
+        types.push_back(1);
+      }
+    }
+  }
+  for (char c = 'a'; c <= 'z'; ++c) {
+    pieces.emplace_back(1, c);
+    types.push_back(1);
+  }
+  std::vector<float> scores(pieces.size());
+  for (std::size_t i = 0; i < scores.size(); ++i) {
+    scores[i] = -static_cast<float>(i);
+  }
+
+  constexpr std::uint64_t embd = 32;
+  constexpr std::uint64_t ff = 64;
+  constexpr std::uint64_t kv = 16;
+  const std::uint64_t vocab = pieces.size();
+  std::mt19937_64 rng(7);
+  const auto random = [&](const std::uint64_t count, const float scale) {
+    std::vector<float> values(count);
+    for (auto &value : values) {
+      value = (static_cast<float>(rng() % 2001) / 1000.0F - 1.0F) * scale;
+    }
+    return values;
+  };
+
+  p::GgufWriter writer;
+  writer.set_string("general.architecture", "llama");
+  writer.set_uint("llama.context_length", 256);
+  writer.set_uint("llama.embedding_length", embd);
+  writer.set_uint("llama.block_count", 2);
+  writer.set_uint("llama.feed_forward_length", ff);
+  writer.set_uint("llama.attention.head_count", 4);
+  writer.set_uint("llama.attention.head_count_kv", 2);
+  writer.set_float("llama.attention.layer_norm_rms_epsilon", 1e-5F);
+  writer.set_string("tokenizer.ggml.model", "llama");
+  writer.set_strings("tokenizer.ggml.tokens", pieces);
+  writer.set_floats("tokenizer.ggml.scores", scores);
+  writer.set_ints("tokenizer.ggml.token_type", types);
+
+  writer.add_f32("token_embd.weight", {embd, vocab}, random(embd * vocab, 1.0F));
+  writer.add_f32("output_norm.weight", {embd}, std::vector<float>(embd, 1.0F));
+  for (int layer = 0; layer < 2; ++layer) {
+    const std::string prefix = "blk." + std::to_string(layer) + ".";
+    writer.add_f32(prefix + "attn_norm.weight", {embd}, std::vector<float>(embd, 1.0F));
+    writer.add_f32(prefix + "ffn_norm.weight", {embd}, std::vector<float>(embd, 1.0F));
+    writer.add_tensor(prefix + "attn_q.weight", {embd, embd}, p::GgmlType::Q8_0,
+                      p::quantize_q8_0(random(embd * embd, 0.3F)));
+    writer.add_tensor(prefix + "attn_k.weight", {embd, kv}, p::GgmlType::Q8_0,
+                      p::quantize_q8_0(random(embd * kv, 0.3F)));
+    writer.add_tensor(prefix + "attn_v.weight", {embd, kv}, p::GgmlType::Q8_0,
+                      p::quantize_q8_0(random(embd * kv, 0.3F)));
+    writer.add_tensor(prefix + "attn_output.weight", {embd, embd}, p::GgmlType::Q8_0,
+                      p::quantize_q8_0(random(embd * embd, 0.3F)));
+    writer.add_f32(prefix + "ffn_gate.weight", {embd, ff}, random(embd * ff, 0.3F));
+    writer.add_f32(prefix + "ffn_up.weight", {embd, ff}, random(embd * ff, 0.3F));
+    writer.add_f32(prefix + "ffn_down.weight", {ff, embd}, random(ff * embd, 0.3F));
+  }
+  const auto path = dir / "tiny.gguf";
+  const auto status = writer.write(path);
+  ghostclaw::tests::require(status.ok(), "failed to write fixture model");
+  return path;
+}
+
+// In-memory stand-in for the Anthropic Message Batches and OpenAI Batch endpoints. Every
+// request is answered with "echo: <last message content>".
+class BatchStandInClient final : public ghostclaw::providers::HttpClient {
+public:
+  bool fail_submit = false;
+  // Batches never finish while set.
+  bool stall = false;
+  std::size_t submits = 0;
+  std::vector<std::size_t> batch_sizes;
+  std::vector<std::string> cancelled;
+  std::string last_upload;
+
+  [[nodiscard]] ghostclaw::providers::HttpResponse
+  post_json(const std::string &url, const std::unordered_map<std::string, std::string> &,
+            const std::string &body, std::uint64_t) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (fail_submit) {
+      return reply(500, "{\"error\":\"unavailable\"}");
+    }
+    if (url.ends_with("/cancel")) {
+      const auto id = url.substr(0, url.size() - 7);
+      cancelled.push_back(id.substr(id.rfind('/') + 1));
+      return reply(200, "{}");
+    }
+    if (url.ends_with("/v1/messages/batches")) {
+      const auto requests = ghostclaw::common::json_split_top_level_objects(
+          ghostclaw::common::json_get_array(body, "requests"));
+      const std::string id = "msgbatch_" + std::to_string(++submits);
+      batch_sizes.push_back(requests.size());
+      std::string results;
+      for (const auto &request : requests) {
+        results += "{\"custom_id\":\"" + ghostclaw::common::json_get_string(request, "custom_id") +
+                   "\",\"result\":{\"type\":\"succeeded\",\"message\":{\"id\":\"msg\","
+                   "\"type\":\"message\",\"content\":[{\"type\":\"text\",\"text\":\"echo: " +
+                   last_content(request) +
+                   "\"}],\"usage\":{\"input_tokens\":3,\"output_tokens\":2}}}}\n";
+      }
+      results_[id] = results;
+      return reply(200, "{\"id\":\"" + id + "\",\"processing_status\":\"in_progress\"}");
+    }
+    if (url.ends_with("/files")) {
+      last_upload = body;
+      const auto begin = body.find("\r\n\r\n", body.find("filename="));
+      const auto end = body.rfind("\r\n--");
+      files_["file-in"] = body.substr(begin + 4, end - begin - 4);
+      return reply(200, "{\"id\":\"file-in\",\"purpose\":\"batch\"}");
+    }
+    if (url.ends_with("/batches")) {
+      const std::string id = "batch_" + std::to_string(++submits);
+      std::string output;
+      std::istringstream lines(files_[ghostclaw::common::json_get_string(body, "input_file_id")]);
+      std::size_t count = 0;
+      for (std::string line; std::getline(lines, line);) {
+        ++count;
+        output += "{\"id\":\"r\",\"custom_id\":\"" +
+                  ghostclaw::common::json_get_string(line, "custom_id") +
+                  "\",\"response\":{\"status_code\":200,\"body\":{\"choices\":[{\"message\":"
+                  "{\"role\":\"assistant\",\"content\":\"echo: " +
+                  last_content(line) +
+                  "\"}}],\"usage\":{\"prompt_tokens\":3,\"completion_tokens\":2}}},"
+                  "\"error\":null}\n";
+      }
+      batch_sizes.push_back(count);
+      files_["out-" + id] = output;
+      return reply(200, "{\"id\":\"" + id + "\",\"status\":\"validating\"}");
+    }
+    return reply(404, "");
+  }
+
+  [[nodiscard]] ghostclaw::providers::HttpResponse
+  post_json_stream(const std::string &url,
+                   const std::unordered_map<std::string, std::string> &headers,
+                   const std::string &body, std::uint64_t timeout_ms,
+                   const ghostclaw::providers::StreamChunkCallback &) override {
+    return post_json(url, headers, body, timeout_ms);
+  }
+
+  [[nodiscard]] ghostclaw::providers::HttpResponse
+  head(const std::string &, const std::unordered_map<std::string, std::string> &,
+       std::uint64_t) override {
+    return reply(200, "");
+  }
+
+  [[nodiscard]] ghostclaw::providers::HttpResponse
+  get(const std::string &url, const std::unordered_map<std::string, std::string> &,
+      std::uint64_t) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto id = url.substr(url.rfind('/') + 1);
+    if (url.find("/v1/messages/batches/") != std::string::npos) {
+      // Still processing on the first poll.
+      if (++polls_[id] < 2 || stall) {
+        return reply(200, "{\"id\":\"" + id + "\",\"processing_status\":\"in_progress\"}");
+      }
+      return reply(200, "{\"id\":\"" + id +
+                            "\",\"processing_status\":\"ended\",\"results_url\":"
+                            "\"https://standin/results/" +
+                            id + "\"}");
+    }
+    if (url.starts_with("https://standin/results/")) {
+      return reply(200, results_[id]);
+    }
+    if (url.find("/batches/") != std::string::npos) {
+      return reply(200, "{\"id\":\"" + id +
+                            "\",\"status\":\"completed\",\"output_file_id\":\"out-" + id +
+                            "\",\"error_file_id\":null}");
+    }
+    if (url.ends_with("/content")) {
+      const auto file = url.substr(0, url.size() - 8);
+      return reply(200, files_[file.substr(file.rfind('/') + 1)]);
+    }
+    return reply(404, "");
+  }
+
+private:
+  static ghostclaw::providers::HttpResponse reply(const std::uint16_t status, std::string body) {
+    ghostclaw::providers::HttpResponse response;
+    response.status = status;
+    response.body = std::move(body);
+    return response;
+  }
+
+  static std::string last_content(const std::string &json) {
+    const std::string key = "\"content\":\"";
+    const auto start = json.rfind(key) + key.size();
+    return json.substr(start, json.find('"', start) - start);
+  }
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, std::string> results_;
+  std::unordered_map<std::string, std::string> files_;
+  std::unordered_map<std::string, int> polls_;
+};
+
+// Flushes `lane` until `done` holds, so tests need not wait out the poll interval.
+void flush_until(ghostclaw::providers::BatchLane &lane, const std::function<bool()> &done) {
+  for (int i = 0; i < 500 && !done(); ++i) {
+    lane.flush();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+}
+
 } // namespace
 
 void register_provider_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
@@ -200,6 +472,63 @@ void register_provider_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
                      require(streamed == "hello", "stream callbacks mismatch");
                    }});
 
+  tests.push_back({"provider_usage_parsers_include_cached_prompt_tokens", [] {
+                     const auto openai = p::parse_openai_usage(
+                         R"({"choices":[{"message":{"content":"hi"}}],"usage":{"prompt_tokens":120,)"
+                         R"("completion_tokens":8,"total_tokens":128,)"
+                         R"("prompt_tokens_details":{"cached_tokens":96}}})");
+                     require(openai.has_value(), "openai usage missing");
+                     require(openai->prompt_tokens == 120 && openai->completion_tokens == 8,
+                             "openai token counts mismatch");
+                     require(openai->cached_prompt_tokens == 96, "openai cached tokens mismatch");
+
+                     const auto anthropic = p::parse_anthropic_usage(
+                         R"({"content":[{"type":"text","text":"hi"}],"usage":{"input_tokens":10,)"
+                         R"("cache_read_input_tokens":90,"cache_creation_input_tokens":5,"output_tokens":7}})");
+                     require(anthropic.has_value(), "anthropic usage missing");
+                     require(anthropic->prompt_tokens == 105, "anthropic prompt should include cache");
+                     require(anthropic->cached_prompt_tokens == 90, "anthropic cached tokens mismatch");
+                     require(anthropic->completion_tokens == 7, "anthropic output mismatch");
+
+                     const std::string sse =
+                         "event: message_start\n"
+                         "data: {\"type\":\"message_start\",\"message\":{\"usage\":{\"input_tokens\":30,\"cache_read_input_tokens\":0,\"output_tokens\":1}}}\n\n"
+                         "event: content_block_delta\n"
+                         "data: {\"type\":\"content_block_delta\",\"delta\":{\"type\":\"text_delta\",\"text\":\"hi\"}}\n\n"
+                         "event: message_delta\n"
+                         "data: {\"type\":\"message_delta\",\"delta\":{\"stop_reason\":\"end_turn\"},\"usage\":{\"output_tokens\":12}}\n\n";
+                     const auto streamed = p::parse_anthropic_sse_usage(sse);
+                     require(streamed.has_value(), "anthropic sse usage missing");
+                     require(streamed->prompt_tokens == 30 && streamed->completion_tokens == 12,
+                             "anthropic sse usage mismatch");
+                     require(!p::parse_openai_usage(R"({"choices":[]})").has_value(),
+                             "missing usage should parse as nothing");
+                   }});
+
+  tests.push_back({"compatible_streaming_reports_usage_to_capture", [] {
+                     auto mock = std::make_shared<MockHttpClient>();
+                     mock->stream_chunks = {
+                         "data: {\"choices\":[{\"delta\":{\"content\":\"ok\"}}],\"usage\":null}\n\n",
+                         "data: {\"choices\":[],\"usage\":{\"prompt_tokens\":50,\"completion_tokens\":3,"
+                         "\"prompt_tokens_details\":{\"cached_tokens\":32}}}\n\n",
+                         "data: [DONE]\n\n"};
+                     mock->next_post_stream = {.status = 200,
+                                               .headers = {{"content-type", "text/event-stream"}}};
+                     p::CompatibleProvider provider("test", "https://example.com/v1", "key", mock);
+
+                     p::ScopedUsageCapture capture;
+                     auto result = provider.chat_with_system_stream(std::nullopt, "hi", "model", 0.7,
+                                                                    [](std::string_view) {});
+                     require(result.ok(), result.error());
+                     require(result.value() == "ok", "stream result mismatch");
+                     require(mock->last_body.find("\"include_usage\":true") != std::string::npos,
+                             "stream request should ask for usage");
+                     require(capture.usage().prompt_tokens == 50, "captured prompt tokens mismatch");
+                     require(capture.usage().cached_prompt_tokens == 32,
+                             "captured cached tokens mismatch");
+                     require(capture.usage().total_tokens() == 53, "captured total mismatch");
+                   }});
+
   tests.push_back({"compatible_auth_error", [] {
                      auto mock = std::make_shared<MockHttpClient>();
                      mock->next_post = {.status = 401, .body = "unauthorized"};
@@ -678,4 +1007,604 @@ void register_provider_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
                          std::nullopt, "hi", "model", 0.7, nullptr);
                      require(result.ok(), result.error());
                    }});
+  tests.push_back({"curl_client_aborts_request_when_cancel_token_fires", [] {
+                     // A listener that never accepts: the request connects and then waits
+                     // for a response that never comes.
+                     const int listener = socket(AF_INET, SOCK_STREAM, 0);
+                     require(listener >= 0, "socket failed");
+                     sockaddr_in addr{};
+                     addr.sin_family = AF_INET;
+                     addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                     addr.sin_port = 0;
+                     require(bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0,
+                             "bind failed");
+                     require(listen(listener, 4) == 0, "listen failed");
+                     socklen_t len = sizeof(addr);
+                     getsockname(listener, reinterpret_cast<sockaddr *>(&addr), &len);
+                     const std::string url =
+                         "http://127.0.0.1:" + std::to_string(ntohs(addr.sin_port)) + "/v1";
+
+                     auto token = std::make_shared<ghostclaw::common::CancelToken>();
+                     std::thread canceller([token] {
+                       std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                       token->cancel();
+                     });
+
+                     ghostclaw::providers::CurlHttpClient client;
+                     const auto started = std::chrono::steady_clock::now();
+                     ghostclaw::providers::HttpResponse response;
+                     {
+                       ghostclaw::common::ScopedCancelToken scope(token);
+                       response = client.post_json(url, {}, "{}", 10'000);
+                     }
+                     const auto elapsed = std::chrono::steady_clock::now() - started;
+                     canceller.join();
+                     close(listener);
+
+                     require(response.network_error, "cancelled request should fail");
+                     require(response.cancelled, "response should be marked cancelled");
+                     require(elapsed < std::chrono::seconds(2),
+                             "cancel should abort the request promptly");
+                     require(ghostclaw::common::current_cancel_token() == nullptr,
+                             "scope should restore the previous token");
+                   }});
+
+  tests.push_back({"model_router_routes_simple_turns_fast", [] {
+                     ghostclaw::config::RouterConfig config;
+                     config.max_fast_chars = 120;
+                     auto fast = std::make_shared<SequenceProvider>(
+                         std::vector<ghostclaw::common::Result<std::string>>{
+                             ghostclaw::common::Result<std::string>::success("COMPLEX")},
+                         "fast");
+                     p::ModelRouter router(config, fast);
+
+                     require(router.route({.message = "Thanks!"}).tier == p::RouteTier::Fast,
+                             "acknowledgement should go fast");
+                     require(router.route({.message = "what's the capital of peru?"}).tier ==
+                                 p::RouteTier::Fast,
+                             "short question should go fast");
+                     require(router.route({.message = "read the config file"}).tier ==
+                                 p::RouteTier::Strong,
+                             "likely tool use should go strong");
+                     require(router.route({.message = "explain this stack trace"}).tier ==
+                                 p::RouteTier::Strong,
+                             "reasoning should go strong");
+                     require(router.route({.message = std::string(200, 'a')}).tier ==
+                                 p::RouteTier::Strong,
+                             "long message should go strong");
+                     require(router.route({.message = "ok", .skill_match = true}).tier ==
+                                 p::RouteTier::Strong,
+                             "skill match should go strong");
+                     require(router.route({.message = "ok", .pinned = true}).tier ==
+                                 p::RouteTier::Strong,
+                             "pinned model should not be rerouted");
+                     require(router.stats().classifier_calls == 0, "classifier is off by default");
+
+                     config.classifier = true;
+                     p::ModelRouter classified(config, fast);
+                     const auto borderline = classified.route(
+                         {.message = "tell me something about the history of the roman empire "
+                                     "and its neighbours"});
+                     require(borderline.tier == p::RouteTier::Strong &&
+                                 borderline.reason == "classifier",
+                             "classifier should decide borderline turns");
+                     require(classified.stats().classifier_calls == 1, "classifier call not counted");
+
+                     require(p::ModelRouter::should_escalate("  "), "empty reply should escalate");
+                     require(p::ModelRouter::should_escalate("I'm not sure about that."),
+                             "unsure reply should escalate");
+                     require(!p::ModelRouter::should_escalate("Lima."), "answer should stand");
+                   }});
+  tests.push_back({"gguf_round_trips_metadata_and_tensors", [] {
+                     namespace p = ghostclaw::providers;
+                     const auto dir = make_temp_dir();
+                     std::vector<float> weights(64);
+                     for (std::size_t i = 0; i < weights.size(); ++i) {
+                       weights[i] = std::sin(static_cast<float>(i)) * 2.0F;
+                     }
+                     p::GgufWriter writer;
+                     writer.set_string("general.name", "fixture");
+                     writer.set_uint("fixture.count", 42);
+                     writer.set_float("fixture.scale", 0.5F);
+                     writer.set_bool("fixture.flag", true);
+                     writer.set_strings("fixture.words", {"a", "bc"});
+                     writer.add_f32("plain", {4, 2}, {1, 2, 3, 4, 5, 6, 7, 8});
+                     writer.add_tensor("quant", {32, 2}, p::GgmlType::Q8_0,
+                                       p::quantize_q8_0(weights));
+                     require(writer.write(dir / "fixture.gguf").ok(), "write failed");
+
+                     const auto opened = p::GgufFile::open(dir / "fixture.gguf");
+                     require(opened.ok(), opened.ok() ? "" : opened.error());
+                     const auto &file = *opened.value();
+                     require(file.get_string("general.name", "") == "fixture", "string lost");
+                     require(file.get_int("fixture.count", 0) == 42, "uint lost");
+                     require(file.get_float("fixture.scale", 0.0) == 0.5, "float lost");
+                     require(file.get_bool("fixture.flag", false), "bool lost");
+                     require(file.get_int("fixture.missing", 7) == 7, "fallback ignored");
+                     const auto *words = file.find("fixture.words");
+                     require(words != nullptr && words->strings == std::vector<std::string>{"a", "bc"},
+                             "string array lost");
+
+                     const auto *plain = file.tensor("plain");
+                     require(plain != nullptr && plain->row_length() == 4 && plain->rows() == 2,
+                             "f32 tensor shape lost");
+                     std::vector<float> decoded(8);
+                     p::ggml_dequantize(plain->type, plain->data, decoded.data(), 8);
+                     require(decoded[0] == 1.0F && decoded[7] == 8.0F, "f32 values lost");
+
+                     const auto *quant = file.tensor("quant");
+                     require(quant != nullptr && quant->rows() == 2, "q8_0 tensor shape lost");
+                     decoded.resize(weights.size());
+                     p::ggml_dequantize(quant->type, quant->data, decoded.data(), weights.size());
+                     for (std::size_t i = 0; i < weights.size(); ++i) {
+                       require(std::fabs(decoded[i] - weights[i]) < 0.02F, "q8_0 value drifted");
+                     }
+
+                     std::ofstream(dir / "bad.gguf") << "not a model";
+                     require(!p::GgufFile::open(dir / "bad.gguf").ok(), "garbage should not open");
+                     {
+                       // Valid header claiming 2^40 tensors in a 24-byte file.
+                       std::ofstream huge(dir / "huge.gguf", std::ios::binary);
+                       const std::uint32_t version = 3;
+                       const std::uint64_t tensor_count = 1ULL << 40U;
+                       const std::uint64_t kv_count = 0;
+                       huge.write("GGUF", 4);
+                       huge.write(reinterpret_cast<const char *>(&version), sizeof(version));
+                       huge.write(reinterpret_cast<const char *>(&tensor_count),
+                                  sizeof(tensor_count));
+                       huge.write(reinterpret_cast<const char *>(&kv_count), sizeof(kv_count));
+                     }
+                     require(!p::GgufFile::open(dir / "huge.gguf").ok(),
+                             "an impossible tensor count should be rejected");
+
+                     // 2^62 f32 values is 2^64 bytes, which wraps to zero unless checked.
+                     p::GgufWriter wrapping;
+                     wrapping.add_f32("wrap", {1ULL << 62U}, {1.0F});
+                     require(wrapping.write(dir / "wrap.gguf").ok(), "write failed");
+                     require(!p::GgufFile::open(dir / "wrap.gguf").ok(),
+                             "a tensor size that overflows should be rejected");
+                     p::GgufWriter dims;
+                     dims.add_f32("dims", {4, 1ULL << 32U, 1ULL << 32U}, {1.0F});
+                     require(dims.write(dir / "dims.gguf").ok(), "write failed");
+                     require(!p::GgufFile::open(dir / "dims.gguf").ok(),
+                             "an element count that overflows should be rejected");
+                     p::GgufWriter unsupported;
+                     unsupported.add_tensor("q4_1", {32}, static_cast<p::GgmlType>(3),
+                                            std::vector<std::uint8_t>(20));
+                     require(unsupported.write(dir / "q4_1.gguf").ok(), "write failed");
+                     require(!p::GgufFile::open(dir / "q4_1.gguf").ok(),
+                             "an unsupported tensor type should be rejected");
+                     std::filesystem::remove_all(dir);
+                   }});
+
+  tests.push_back({"local_model_tokenizes_and_generates_deterministically", [] {
+                     namespace p = ghostclaw::providers;
+                     const auto dir = make_temp_dir();
+                     const auto path = write_tiny_llama(dir);
+                     const auto loaded = p::LocalModel::load(path, {.threads = 1});
+                     require(loaded.ok(), loaded.ok() ? "" : loaded.error());
+                     const auto &model = loaded.value();
+                     require(model->architecture() == "llama", "architecture lost");
+                     require(model->context_length() == 256, "context should cap at trained length");
+
+                     const auto &tok = model->tokenizer();
+                     const auto ids = tok.encode("hello world cab", false);
+                     // "cab" is not in the vocabulary; it stops at the longest prefix piece.
+                     require(ids.size() == 4, "expected two words and two pieces");
+                     require(ids[0] == *tok.find("\xE2\x96\x81hello"), "word piece not merged");
+                     std::string text;
+                     for (const auto id : ids) {
+                       text += tok.decode(id);
+                     }
+                     require(text == " hello world cab", "decode mismatch: " + text);
+                     require(tok.encode("<s>the", true).front() == tok.bos(),
+                             "special token not parsed");
+
+                     const auto chat =
+                         model->encode_chat(std::string("<s>system"), "<s>hello", 1000);
+                     require(std::count(chat.begin(), chat.end(), tok.bos()) == 1,
+                             "special tokens in chat bodies must stay text");
+
+                     std::string long_system;
+                     for (int i = 0; i < 100; ++i) {
+                       long_system += "hello world ";
+                     }
+                     const auto full = model->encode_chat(long_system, "the cat sat", 100000);
+                     const auto trimmed = model->encode_chat(long_system, "the cat sat", 80);
+                     require(full.size() > 160 && trimmed.size() == 80,
+                             "chat should fit the budget");
+                     require(std::equal(trimmed.begin(), trimmed.begin() + 10, full.begin()),
+                             "system prompt head should survive truncation");
+                     require(std::equal(trimmed.end() - 15, trimmed.end(), full.end() - 15),
+                             "latest user turn should survive truncation");
+
+                     const p::LocalGenerateOptions greedy{.max_tokens = 8, .temperature = 0.0F};
+                     p::LocalGenerateStats first;
+                     const auto a = model->generate("the cat sat", greedy, {}, &first);
+                     require(a.ok(), "generate failed");
+                     require(first.generated_tokens > 0 && first.reused_tokens == 0,
+                             "first call should generate from scratch");
+
+                     const auto threaded = p::LocalModel::load(path, {.threads = 4});
+                     require(threaded.ok(), "threaded load failed");
+                     const auto b = threaded.value()->generate("the cat sat", greedy);
+                     require(b.ok() && b.value() == a.value(), "thread count changed the output");
+                     std::filesystem::remove_all(dir);
+                   }});
+
+  tests.push_back({"local_model_reuses_kv_cache_for_shared_prefixes", [] {
+                     namespace p = ghostclaw::providers;
+                     const auto dir = make_temp_dir();
+                     const auto path = write_tiny_llama(dir);
+                     auto cached = p::LocalModel::load(path, {.threads = 2, .cache_slots = 2});
+                     require(cached.ok(), "load failed");
+                     const auto &model = cached.value();
+                     const p::LocalGenerateOptions greedy{.max_tokens = 6, .temperature = 0.0F};
+
+                     p::LocalGenerateStats stats;
+                     (void)model->generate("the cat sat on the mat", greedy, {}, &stats);
+                     const std::size_t first_prompt = stats.prompt_tokens;
+                     (void)model->generate("the cat sat on the mat", greedy, {}, &stats);
+                     require(stats.reused_tokens == first_prompt - 1,
+                             "repeated prompt should reuse all but its last token");
+
+                     const std::string extended = "the cat sat on the mat hello world";
+                     const auto warm = model->generate(extended, greedy, {}, &stats);
+                     require(stats.reused_tokens >= first_prompt - 1,
+                             "extended prompt should reuse the shared prefix");
+                     const auto cold = p::LocalModel::load(path, {.threads = 1});
+                     require(cold.ok(), "reload failed");
+                     const auto fresh = cold.value()->generate(extended, greedy);
+                     require(warm.ok() && fresh.ok() && warm.value() == fresh.value(),
+                             "cached and fresh evaluation should agree");
+
+                     // A different conversation sharing only a prefix must not evict the first.
+                     (void)model->generate("the cat hello", greedy, {}, &stats);
+                     (void)model->generate(extended, greedy, {}, &stats);
+                     require(stats.reused_tokens == stats.prompt_tokens - 1,
+                             "branching prompt should not drop the longer cache");
+                     std::filesystem::remove_all(dir);
+                   }});
+
+  tests.push_back({"gguf_provider_streams_and_reports_usage", [] {
+                     namespace p = ghostclaw::providers;
+                     const auto dir = make_temp_dir();
+                     const auto path = write_tiny_llama(dir);
+                     p::LocalModelCache::shared().configure({.threads = 2, .max_tokens = 6});
+
+                     const auto provider = p::create_provider("gguf:" + path.string(), std::nullopt);
+                     require(provider.ok(), provider.ok() ? "" : provider.error());
+                     require(provider.value()->name() == "gguf", "wrong provider name");
+                     const auto again = p::create_provider("gguf:" + path.string(), std::nullopt);
+                     require(again.ok(), "second provider failed");
+                     require(std::dynamic_pointer_cast<p::LocalProvider>(again.value())->model() ==
+                                 std::dynamic_pointer_cast<p::LocalProvider>(provider.value())->model(),
+                             "providers for one file should share the model");
+
+                     std::string streamed;
+                     p::ScopedUsageCapture capture;
+                     const auto reply = provider.value()->chat_with_system_stream(
+                         std::string("be brief"), "hello", "ignored", 0.0,
+                         [&](std::string_view chunk) { streamed.append(chunk); });
+                     require(reply.ok(), "stream failed");
+                     require(streamed == reply.value(), "chunks should concatenate to the reply");
+                     require(capture.usage().prompt_tokens > 0 && capture.usage().completion_tokens > 0,
+                             "usage not reported");
+
+                     auto token = std::make_shared<ghostclaw::common::CancelToken>();
+                     token->cancel();
+                     ghostclaw::common::ScopedCancelToken scoped(token);
+                     require(!provider.value()->chat("hello", "ignored", 0.0).ok(),
+                             "cancelled request should fail");
+
+                     require(!p::create_provider("gguf:" + (dir / "missing.gguf").string(),
+                                                 std::nullopt)
+                                  .ok(),
+                             "missing model should fail");
+                     p::LocalModelCache::shared().configure({});
+                     std::filesystem::remove_all(dir);
+                   }});
+  tests.push_back({"admission_serves_interactive_before_background", [] {
+                     namespace p = ghostclaw::providers;
+                     auto &controller = p::AdmissionController::shared();
+                     controller.configure({.max_concurrent = 1});
+                     const std::string key = "test-admission-priority";
+
+                     auto held = controller.acquire(key, 10);
+                     require(held.ok(), "first request should pass");
+                     std::mutex order_mutex;
+                     std::vector<std::string> order;
+                     const auto worker = [&](const p::RequestPriority priority, std::string label) {
+                       p::ScopedRequestClass request_class(priority, label);
+                       auto ticket = p::AdmissionController::shared().acquire(key, 10);
+                       std::lock_guard<std::mutex> lock(order_mutex);
+                       order.push_back(ticket.ok() ? label : "failed");
+                     };
+                     std::thread background(worker, p::RequestPriority::Background, "background");
+                     wait_for_queued(key, 1);
+                     std::thread interactive(worker, p::RequestPriority::Interactive, "interactive");
+                     wait_for_queued(key, 2);
+                     held.value() = p::AdmissionController::Ticket();
+                     background.join();
+                     interactive.join();
+                     require(order == std::vector<std::string>{"interactive", "background"},
+                             "interactive request should go first");
+                     const auto stats = admission_stats(key);
+                     require(stats.admitted_interactive == 2 && stats.admitted_background == 1,
+                             "admissions not counted");
+                     controller.configure({});
+                   }});
+
+  tests.push_back({"admission_shares_capacity_between_sessions", [] {
+                     namespace p = ghostclaw::providers;
+                     auto &controller = p::AdmissionController::shared();
+                     controller.configure({.max_concurrent = 1});
+                     const std::string key = "test-admission-fairness";
+
+                     std::optional<p::ScopedRequestClass> busy;
+                     busy.emplace(p::RequestPriority::Interactive, "busy");
+                     auto held = controller.acquire(key, 10);
+                     busy.reset();
+                     require(held.ok(), "first request should pass");
+                     std::mutex order_mutex;
+                     std::vector<std::string> order;
+                     const auto worker = [&](const std::string &session) {
+                       p::ScopedRequestClass request_class(p::RequestPriority::Interactive, session);
+                       auto ticket = p::AdmissionController::shared().acquire(key, 10);
+                       std::lock_guard<std::mutex> lock(order_mutex);
+                       order.push_back(session);
+                     };
+                     std::thread again(worker, "busy");
+                     wait_for_queued(key, 1);
+                     std::thread quiet(worker, "quiet");
+                     wait_for_queued(key, 2);
+                     held.value() = p::AdmissionController::Ticket();
+                     again.join();
+                     quiet.join();
+                     require(order == std::vector<std::string>{"quiet", "busy"},
+                             "session with fewer recent requests should go first");
+                     controller.configure({});
+                   }});
+
+  tests.push_back({"admission_holds_background_at_its_budget_share", [] {
+                     namespace p = ghostclaw::providers;
+                     auto &controller = p::AdmissionController::shared();
+                     controller.configure({.requests_per_minute = 4, .background_share = 0.5});
+                     const std::string key = "test-admission-budget";
+
+                     std::vector<p::AdmissionController::Ticket> tickets;
+                     {
+                       p::ScopedRequestClass request_class(p::RequestPriority::Background, "cron");
+                       for (int i = 0; i < 2; ++i) {
+                         auto ticket = controller.acquire(key, 10);
+                         require(ticket.ok(), "background within its share should pass");
+                         tickets.push_back(std::move(ticket.value()));
+                       }
+                       auto token = std::make_shared<ghostclaw::common::CancelToken>();
+                       ghostclaw::common::ScopedCancelToken scoped(token);
+                       std::thread canceller([token]() {
+                         std::this_thread::sleep_for(std::chrono::milliseconds(150));
+                         token->cancel();
+                       });
+                       const auto blocked = controller.acquire(key, 10);
+                       canceller.join();
+                       require(!blocked.ok(), "background over its share should wait");
+                     }
+                     const auto start = std::chrono::steady_clock::now();
+                     auto interactive = controller.acquire(key, 10);
+                     require(interactive.ok(), "interactive should use the remaining budget");
+                     require(std::chrono::steady_clock::now() - start < std::chrono::seconds(1),
+                             "interactive should not wait");
+                     require(admission_stats(key).window_requests == 3, "window not tracked");
+                     controller.configure({});
+                   }});
+
+  tests.push_back({"admitted_provider_cools_down_after_rate_limit", [] {
+                     namespace p = ghostclaw::providers;
+                     p::AdmissionController::shared().configure({});
+                     p::ProviderError limited;
+                     limited.code = p::ProviderErrorCode::RateLimitError;
+                     limited.status = 429;
+                     limited.retry_after = 1;
+                     auto inner = std::make_shared<SequenceProvider>(
+                         std::vector<ghostclaw::common::Result<std::string>>{
+                             ghostclaw::common::Result<std::string>::failure(limited.to_string()),
+                             ghostclaw::common::Result<std::string>::success("ok")},
+                         "upstream");
+                     auto admitted =
+                         std::make_shared<p::AdmittedProvider>(inner, "test-admission-cooldown");
+                     require(admitted->name() == "upstream", "name should pass through");
+                     // A long blind backoff would take 5s; the admission pause is 1s.
+                     p::ReliableProvider reliable(admitted, {}, 2, 5000);
+                     const auto start = std::chrono::steady_clock::now();
+                     const auto result = reliable.chat("hi", "model", 0.0);
+                     const auto elapsed = std::chrono::steady_clock::now() - start;
+                     require(result.ok() && result.value() == "ok", "retry should succeed");
+                     require(elapsed >= std::chrono::milliseconds(900) &&
+                                 elapsed < std::chrono::seconds(4),
+                             "retry should wait out the cool-down instead of the backoff");
+                     require(admission_stats("test-admission-cooldown").rate_limited == 1,
+                             "rate limit not recorded");
+                   }});
+
+  tests.push_back({"batch_lane_groups_requests_and_routes_results", [] {
+                     namespace p = ghostclaw::providers;
+                     auto standin = std::make_shared<BatchStandInClient>();
+                     auto backend = std::make_shared<p::AnthropicBatchBackend>(
+                         "key", "https://standin", standin);
+                     p::BatchLane lane;
+                     ghostclaw::config::BatchConfig config;
+                     config.enabled = true;
+                     config.max_batch_size = 2;
+                     config.max_delay_secs = 3600;
+                     lane.configure(config);
+
+                     std::mutex mutex;
+                     std::unordered_map<std::string, p::BatchOutcome> outcomes;
+                     for (const std::string message : {"one", "two"}) {
+                       p::BatchRequest request;
+                       request.message = message;
+                       request.model = "claude";
+                       lane.enqueue("test-batch-anthropic", backend, std::move(request),
+                                    [&mutex, &outcomes, message](p::BatchOutcome outcome) {
+                                      std::lock_guard<std::mutex> lock(mutex);
+                                      outcomes[message] = std::move(outcome);
+                                    });
+                     }
+                     flush_until(lane, [&] {
+                       std::lock_guard<std::mutex> lock(mutex);
+                       return outcomes.size() == 2;
+                     });
+
+                     std::lock_guard<std::mutex> lock(mutex);
+                     require(outcomes.size() == 2, "both callbacks should run");
+                     require(outcomes["one"].error.empty() && outcomes["one"].content == "echo: one",
+                             "first result misrouted: " + outcomes["one"].content);
+                     require(outcomes["two"].content == "echo: two", "second result misrouted");
+                     require(outcomes["one"].usage.has_value() &&
+                                 outcomes["one"].usage->completion_tokens == 2,
+                             "usage should be parsed");
+                     require(standin->batch_sizes == std::vector<std::size_t>{2},
+                             "requests should share one batch");
+                     const auto stats = lane.stats();
+                     require(stats.size() == 1 && stats[0].completed == 2 &&
+                                 stats[0].submitted_batches == 1 && stats[0].in_flight_batches == 0,
+                             "stats not tracked");
+                   }});
+
+  tests.push_back({"batched_provider_defers_only_deferred_requests", [] {
+                     namespace p = ghostclaw::providers;
+                     auto standin = std::make_shared<BatchStandInClient>();
+                     auto inner = std::make_shared<SequenceProvider>(
+                         std::vector<ghostclaw::common::Result<std::string>>{
+                             ghostclaw::common::Result<std::string>::success("direct")},
+                         "openai");
+                     p::BatchedProvider provider(
+                         inner,
+                         std::make_shared<p::OpenAiBatchBackend>("key", "https://standin/v1",
+                                                                 standin),
+                         "test-batch-openai");
+                     auto &lane = p::BatchLane::shared();
+                     ghostclaw::config::BatchConfig config;
+                     config.enabled = true;
+                     config.max_batch_size = 1;
+                     lane.configure(config);
+
+                     std::atomic<bool> done{false};
+                     std::optional<ghostclaw::common::Result<std::string>> deferred;
+                     p::TokenUsage usage;
+                     std::thread job([&] {
+                       p::ScopedRequestClass request_class(p::RequestPriority::Deferred, "cron");
+                       p::ScopedUsageCapture capture;
+                       deferred = provider.chat_with_system("be brief", "hello", "gpt", 0.0);
+                       usage = capture.usage();
+                       done = true;
+                     });
+                     flush_until(lane, [&] { return done.load(); });
+                     job.join();
+                     const auto interactive = provider.chat("hi", "gpt", 0.0);
+                     lane.configure({});
+
+                     require(deferred.has_value() && deferred->ok() &&
+                                 deferred->value() == "echo: hello",
+                             "deferred request should be answered by the batch");
+                     require(usage.prompt_tokens == 3, "batch usage should be reported");
+                     require(standin->last_upload.find("\"url\":\"/v1/chat/completions\"") !=
+                                     std::string::npos &&
+                                 standin->last_upload.find("be brief") != std::string::npos,
+                             "upload should carry the chat request");
+                     require(interactive.ok() && interactive.value() == "direct",
+                             "interactive request should go direct");
+                     require(standin->batch_sizes.size() == 1, "only the deferred call batches");
+                   }});
+
+  tests.push_back({"batched_provider_falls_back_when_batch_fails", [] {
+                     namespace p = ghostclaw::providers;
+                     auto standin = std::make_shared<BatchStandInClient>();
+                     standin->fail_submit = true;
+                     auto inner = std::make_shared<SequenceProvider>(
+                         std::vector<ghostclaw::common::Result<std::string>>{
+                             ghostclaw::common::Result<std::string>::success("direct")},
+                         "anthropic");
+                     p::BatchedProvider provider(
+                         inner,
+                         std::make_shared<p::AnthropicBatchBackend>("key", "https://standin",
+                                                                    standin),
+                         "test-batch-fallback");
+                     ghostclaw::config::BatchConfig config;
+                     config.enabled = true;
+                     config.max_batch_size = 1;
+                     p::BatchLane::shared().configure(config);
+                     ghostclaw::common::Result<std::string> result =
+                         ghostclaw::common::Result<std::string>::failure("unset");
+                     {
+                       p::ScopedRequestClass request_class(p::RequestPriority::Deferred, "");
+                       result = provider.chat("hello", "claude", 0.0);
+                     }
+                     p::BatchLane::shared().configure({});
+                     require(result.ok() && result.value() == "direct",
+                             "failed batch should fall back to a direct call");
+                   }});
+  tests.push_back({"batched_provider_cancels_timed_out_batch_instead_of_retrying", [] {
+                     namespace p = ghostclaw::providers;
+                     auto standin = std::make_shared<BatchStandInClient>();
+                     standin->stall = true;
+                     auto inner = std::make_shared<SequenceProvider>(
+                         std::vector<ghostclaw::common::Result<std::string>>{
+                             ghostclaw::common::Result<std::string>::success("direct")},
+                         "anthropic");
+                     p::BatchedProvider provider(
+                         inner,
+                         std::make_shared<p::AnthropicBatchBackend>("key", "https://standin",
+                                                                    standin),
+                         "test-batch-timeout");
+                     ghostclaw::config::BatchConfig config;
+                     config.enabled = true;
+                     config.max_batch_size = 1;
+                     config.poll_interval_secs = 1;
+                     config.max_wait_secs = 1;
+                     p::BatchLane::shared().configure(config);
+                     ghostclaw::common::Result<std::string> result =
+                         ghostclaw::common::Result<std::string>::failure("unset");
+                     {
+                       p::ScopedRequestClass request_class(p::RequestPriority::Deferred, "");
+                       result = provider.chat("hello", "claude", 0.0);
+                     }
+                     p::BatchLane::shared().configure({});
+                     require(!result.ok(),
+                             "timed-out batch request should fail, not retry directly");
+                     require(standin->cancelled == std::vector<std::string>{"msgbatch_1"},
+                             "abandoned batch should be cancelled upstream");
+                   }});
+
+  tests.push_back({"batch_lane_stop_releases_blocked_submitters", [] {
+                     namespace p = ghostclaw::providers;
+                     auto standin = std::make_shared<BatchStandInClient>();
+                     standin->stall = true;
+                     auto backend = std::make_shared<p::AnthropicBatchBackend>(
+                         "key", "https://standin", standin);
+                     p::BatchLane lane;
+                     ghostclaw::config::BatchConfig config;
+                     config.enabled = true;
+                     config.max_batch_size = 1;
+                     lane.configure(config);
+
+                     std::optional<ghostclaw::common::Result<p::BatchOutcome>> outcome;
+                     std::thread waiter([&] {
+                       p::BatchRequest request;
+                       request.message = "hello";
+                       request.model = "claude";
+                       outcome = lane.submit("test-batch-stop", backend, std::move(request));
+                     });
+                     flush_until(lane, [&] {
+                       const auto stats = lane.stats();
+                       return !stats.empty() && stats[0].in_flight_batches == 1;
+                     });
+                     lane.stop();
+                     waiter.join();
+                     require(outcome.has_value() && outcome->ok() &&
+                                 !outcome->value().error.empty() && !outcome->value().retryable,
+                             "stop should fail the in-flight request as not retryable");
+                     require(lane.stats().empty(), "stop should drop every queue");
+                   }});
 }
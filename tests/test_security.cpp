@@ -5,16 +5,19 @@
 #include "ghostclaw/security/approval.hpp"
 #include "ghostclaw/security/external_content.hpp"
 #include "ghostclaw/security/pairing.hpp"
+#include "ghostclaw/security/path_resolver.hpp"
 #include "ghostclaw/security/policy.hpp"
 #include "ghostclaw/security/secrets.hpp"
 #include "ghostclaw/security/tool_policy.hpp"
 
+#include <fcntl.h>
 #include <filesystem>
 #include <fstream>
 #include <future>
 #include <random>
 #include <set>
 #include <thread>
+#include <unistd.h>
 
 namespace {
 
@@ -223,6 +226,64 @@ void register_security_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
                      require(!validated.ok(), "symlink escape should fail");
                    }});
 
+  tests.push_back({"workspace_root_is_cached_and_confines_opens", [] {
+                     const auto home = make_temp_home();
+                     const EnvGuard env_home("HOME", home.string());
+
+                     cfg::Config config;
+                     config.autonomy.workspace_only = true;
+                     auto policy_result = sec::SecurityPolicy::from_config(config);
+                     require(policy_result.ok(), policy_result.error());
+                     const auto &policy = policy_result.value();
+
+                     const auto ws = home / "resolver-ws";
+                     auto root = sec::PathResolver::shared().root(ws);
+                     require(root.ok(), root.error());
+                     auto again = sec::PathResolver::shared().root(ws);
+                     require(again.ok() && again.value() == root.value(), "root should be cached");
+                     require(std::filesystem::is_directory(ws), "workspace should be created");
+
+                     auto resolved = root.value()->resolve("a/../notes.txt", policy);
+                     require(resolved.ok(), resolved.error());
+                     require(resolved.value().relative == "notes.txt", "path should be normalised");
+                     {
+                       std::ofstream out(ws / "notes.txt");
+                       out << "hi";
+                     }
+                     auto fd = root.value()->open(resolved.value(), O_RDONLY);
+                     require(fd.ok(), fd.error());
+                     ::close(fd.value());
+
+                     require(!root.value()->resolve("../outside.txt", policy).ok(),
+                             "relative escape should fail");
+
+                     std::error_code ec;
+                     std::filesystem::create_symlink(ws / "notes.txt", ws / "alias.txt", ec);
+                     std::filesystem::create_directory_symlink("/etc", ws / "etc-link", ec);
+                     if (!ec) {
+                       auto alias = root.value()->resolve("alias.txt", policy);
+                       require(alias.ok(), alias.error());
+                       require(!root.value()->open(alias.value(), O_RDONLY).ok(),
+                               "symlinks should not be followed");
+                       auto through = root.value()->resolve("etc-link/passwd", policy);
+                       require(!through.ok() || !root.value()->open(through.value(), O_RDONLY).ok(),
+                               "symlinked directory should not be traversed");
+                     }
+
+                     auto nested = root.value()->resolve("deep/er/file.txt", policy);
+                     require(nested.ok(), nested.error());
+                     auto parent = root.value()->open_parent(nested.value(), true);
+                     require(parent.ok(), parent.error());
+                     ::close(parent.value());
+                     require(std::filesystem::is_directory(ws / "deep" / "er"),
+                             "parent directories should be created");
+
+                     std::filesystem::remove_all(ws);
+                     auto recreated = sec::PathResolver::shared().root(ws);
+                     require(recreated.ok() && recreated.value() != root.value(),
+                             "removed workspace should be reopened");
+                   }});
+
   tests.push_back({"relative_escape_rejected", [] {
                      const auto home = make_temp_home();
                      const EnvGuard env_home("HOME", home.string());
@@ -357,13 +418,22 @@ void register_security_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
 
   tests.push_back({"tool_policy_group_expansion_v2", [] {
                      const auto fs = sec::ToolPolicyPipeline::expand_group("group:fs");
-                     require(fs.size() == 3, "group:fs should expand to 3 tools");
+                     require(fs.size() == 4, "group:fs should expand to 4 tools");
                      const auto runtime = sec::ToolPolicyPipeline::expand_group("runtime");
                      require(runtime.size() == 2, "runtime alias should expand to 2 tools");
                      const auto memory = sec::ToolPolicyPipeline::expand_group("group:memory");
                      require(memory.size() == 3, "group:memory should expand to 3 tools");
                      const auto skills = sec::ToolPolicyPipeline::expand_group("group:skills");
                      require(skills.size() == 1, "group:skills should expand to 1 tool");
+
+                     sec::ToolPolicyPipeline pipeline;
+                     for (const auto profile : {sec::ToolProfile::Minimal, sec::ToolProfile::Coding,
+                                                sec::ToolProfile::Messaging}) {
+                       sec::ToolPolicyRequest request;
+                       request.profile = profile;
+                       require(pipeline.evaluate_tool("tool_output", request).allowed,
+                               "every profile should let the model page spilled output");
+                     }
                      require(sec::ToolPolicyPipeline::normalize_tool_name("file_read") == "read",
                              "file_read alias normalization failed");
                    }});
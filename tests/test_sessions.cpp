@@ -1,12 +1,15 @@
 #include "test_framework.hpp"
 
+#include "ghostclaw/sessions/history.hpp"
 #include "ghostclaw/sessions/session.hpp"
 #include "ghostclaw/sessions/session_key.hpp"
 #include "ghostclaw/sessions/store.hpp"
 #include "ghostclaw/sessions/transcript.hpp"
 
 #include <atomic>
+#include <chrono>
 #include <filesystem>
+#include <fstream>
 #include <future>
 #include <random>
 #include <thread>
@@ -114,6 +117,49 @@ void register_sessions_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
                              "remaining subagent mismatch");
                    }});
 
+  tests.push_back({"sessions_store_instances_share_directory_coherently", [] {
+                     const auto dir = make_temp_sessions_dir();
+                     s::SessionStore first(dir);
+                     s::SessionStore second(dir);
+                     const std::string key_a = "agent:ghostclaw:channel:webhook:peer:shared-a";
+                     const std::string key_b = "agent:ghostclaw:channel:webhook:peer:shared-b";
+
+                     s::SessionState state_a;
+                     state_a.session_id = key_a;
+                     state_a.model = "model-a";
+                     require(first.upsert_state(state_a).ok(), "first upsert failed");
+                     s::SessionState state_b;
+                     state_b.session_id = key_b;
+                     state_b.model = "model-b";
+                     require(second.upsert_state(state_b).ok(), "second upsert failed");
+
+                     auto seen_by_first = first.get_state(key_b);
+                     require(seen_by_first.ok(), "first store should see second store's session");
+                     require(seen_by_first.value().model == "model-b", "model mismatch");
+                     auto listed = first.list_states();
+                     require(listed.ok() && listed.value().size() == 2,
+                             "writes from both stores must survive");
+
+                     std::vector<std::thread> writers;
+                     for (int w = 0; w < 2; ++w) {
+                       writers.emplace_back([&, w]() {
+                         auto &store = w == 0 ? first : second;
+                         for (int i = 0; i < 25; ++i) {
+                           s::TranscriptEntry entry;
+                           entry.role = s::TranscriptRole::User;
+                           entry.content = "w" + std::to_string(w) + "-" + std::to_string(i);
+                           (void)store.append_transcript(key_a, entry);
+                         }
+                       });
+                     }
+                     for (auto &writer : writers) {
+                       writer.join();
+                     }
+                     auto transcript = second.load_transcript(key_a);
+                     require(transcript.ok(), transcript.error());
+                     require(transcript.value().size() == 50, "transcript lines were lost");
+                   }});
+
   tests.push_back({"sessions_store_group_and_provenance_roundtrip", [] {
                      const auto dir = make_temp_sessions_dir();
                      s::SessionStore store(dir);
@@ -306,6 +352,75 @@ void register_sessions_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
                      require(last.content == "message-19", "should return most recent entries");
                    }});
 
+  tests.push_back({"sessions_transcript_pages_by_cursor", [] {
+                     const auto dir = make_temp_sessions_dir();
+                     s::SessionStore store(dir);
+                     const std::string key = "agent:ghostclaw:channel:test:peer:paged";
+                     const auto append = [&](const int i) {
+                       s::TranscriptEntry entry;
+                       entry.content = "message-" + std::to_string(i);
+                       require(store.append_transcript(key, entry).ok(), "append should succeed");
+                     };
+                     for (int i = 1; i <= 20; ++i) {
+                       append(i);
+                     }
+
+                     auto latest = store.load_transcript_page(key, {.limit = 5});
+                     require(latest.ok(), latest.error());
+                     require(latest.value().total == 20, "total counts every entry");
+                     require(latest.value().entries.size() == 5 &&
+                                 latest.value().entries.front().id == 16 &&
+                                 latest.value().entries.back().content == "message-20",
+                             "default page is the newest entries");
+                     require(latest.value().has_more_before && !latest.value().has_more_after,
+                             "newest page only has older entries around it");
+
+                     auto older = store.load_transcript_page(key, {.before = 16, .limit = 5});
+                     require(older.ok(), older.error());
+                     require(older.value().entries.front().id == 11 &&
+                                 older.value().entries.back().id == 15,
+                             "before pages backwards");
+
+                     auto newer = store.load_transcript_page(key, {.after = 18, .limit = 5});
+                     require(newer.ok(), newer.error());
+                     require(newer.value().entries.size() == 2 &&
+                                 newer.value().entries.front().content == "message-19" &&
+                                 !newer.value().has_more_after && newer.value().has_more_before,
+                             "after pages forwards to the end");
+
+                     append(21);
+                     auto grown = store.load_transcript_page(key, {.after = 20, .limit = 5});
+                     require(grown.ok() && grown.value().total == 21 &&
+                                 grown.value().entries.size() == 1 &&
+                                 grown.value().entries.front().content == "message-21",
+                             "index picks up appended entries");
+                     auto all = store.load_transcript(key);
+                     require(all.ok() && all.value().size() == 21 && all.value()[20].id == 21,
+                             "full loads carry ids too");
+
+                     // A transcript rewritten in place is re-indexed from scratch.
+                     std::filesystem::path transcript;
+                     for (const auto &file :
+                          std::filesystem::directory_iterator(dir / "transcripts")) {
+                       transcript = file.path();
+                     }
+                     const auto saved = dir / "saved.jsonl";
+                     std::filesystem::copy_file(transcript, saved);
+                     std::filesystem::resize_file(transcript, 0);
+                     append(1);
+                     auto rewritten = store.load_transcript_page(key, {.limit = 5});
+                     require(rewritten.ok() && rewritten.value().total == 1 &&
+                                 rewritten.value().entries.front().id == 1,
+                             "shrunk transcript should be re-indexed");
+
+                     // So is one replaced by a larger file, which a size check alone misses.
+                     std::filesystem::rename(saved, transcript);
+                     auto replaced = store.load_transcript_page(key, {.limit = 5});
+                     require(replaced.ok() && replaced.value().total == 21 &&
+                                 replaced.value().entries.front().content == "message-17",
+                             "replaced transcript should be re-indexed");
+                   }});
+
   tests.push_back({"sessions_transcript_ordering_preserved", [] {
                      const auto dir = make_temp_sessions_dir();
                      s::SessionStore store(dir);
@@ -397,6 +512,52 @@ void register_sessions_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
                      // Subagents may or may not be preserved depending on implementation
                    }});
 
+  tests.push_back({"sessions_usage_accumulates_and_survives_upsert", [] {
+                     const auto dir = make_temp_sessions_dir();
+                     const std::string web = "agent:ghostclaw:channel:webhook:peer:alice";
+                     const std::string tg = "agent:ghostclaw:channel:telegram:peer:bob";
+                     {
+                       s::SessionStore store(dir);
+                       require(store.upsert_state({.session_id = web}).ok(), "upsert web failed");
+                       require(store.upsert_state({.session_id = tg}).ok(), "upsert tg failed");
+
+                       s::SessionUsage turn;
+                       turn.turns = 1;
+                       turn.prompt_tokens = 100;
+                       turn.completion_tokens = 20;
+                       turn.cached_prompt_tokens = 60;
+                       turn.tool_calls = 2;
+                       turn.tool_ms = 15;
+                       turn.latency_ms = 400;
+                       require(store.record_usage(web, turn).ok(), "record web failed");
+                       require(store.record_usage(web, turn).ok(), "record web again failed");
+                       require(store.record_usage(tg, turn).ok(), "record tg failed");
+                       require(!store.record_usage("agent:ghostclaw:channel:x:peer:none", turn).ok(),
+                               "unknown session should be rejected");
+
+                       s::SessionState update;
+                       update.session_id = web;
+                       update.model = "other-model";
+                       require(store.upsert_state(update).ok(), "plain upsert failed");
+                     }
+
+                     s::SessionStore reopened(dir);
+                     auto loaded = reopened.get_state(web);
+                     require(loaded.ok(), loaded.error());
+                     require(loaded.value().usage.turns == 2, "turn count mismatch");
+                     require(loaded.value().usage.prompt_tokens == 200, "prompt tokens mismatch");
+                     require(loaded.value().usage.cached_prompt_tokens == 120,
+                             "cached tokens mismatch");
+                     require(loaded.value().usage.tool_ms == 30, "tool time mismatch");
+
+                     auto by_channel = reopened.usage_by_channel();
+                     require(by_channel.ok(), by_channel.error());
+                     require(by_channel.value().at("webhook").completion_tokens == 40,
+                             "webhook channel total mismatch");
+                     require(by_channel.value().at("telegram").latency_ms == 400,
+                             "telegram channel total mismatch");
+                   }});
+
   tests.push_back({"sessions_state_get_nonexistent", [] {
                      const auto dir = make_temp_sessions_dir();
                      s::SessionStore store(dir);
@@ -501,4 +662,235 @@ void register_sessions_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
                      require(history.ok(), history.error());
                      require(history.value().size() == 4, "all roles should be stored");
                    }});
+
+  tests.push_back({"sessions_history_keeps_context_bounded_with_rolling_summary", [] {
+                     const auto dir = make_temp_sessions_dir();
+                     const std::string id = "agent:ghostclaw:channel:webhook:peer:carol";
+                     s::SessionStore store(dir);
+                     require(store.upsert_state({.session_id = id}).ok(), "upsert failed");
+
+                     std::atomic<int> summarize_calls{0};
+                     s::HistoryOptions options;
+                     options.recent_messages = 4;
+                     options.summarize_batch = 2;
+                     options.summary_token_budget = 50;
+                     s::SessionHistory history(
+                         &store,
+                         [&summarize_calls](const std::string &previous, const std::string &messages,
+                                            std::size_t budget) {
+                           ++summarize_calls;
+                           return s::extractive_summary(previous, messages, budget);
+                         },
+                         options);
+
+                     require(history.context_for(id).empty(), "no history yet");
+                     std::size_t largest = 0;
+                     for (int turn = 0; turn < 12; ++turn) {
+                       const auto n = std::to_string(turn);
+                       require(store.append_transcript(id, {.role = s::TranscriptRole::User,
+                                                            .content = "question " + n}).ok(),
+                               "append user failed");
+                       require(store.append_transcript(id, {.role = s::TranscriptRole::System,
+                                                            .content = "noise " + n}).ok(),
+                               "append system failed");
+                       require(store.append_transcript(id, {.role = s::TranscriptRole::Assistant,
+                                                            .content = "\"answer\" " + n}).ok(),
+                               "append assistant failed");
+                       history.schedule_refresh(id);
+                       history.flush();
+                       largest = std::max(largest, history.context_for(id).size());
+                     }
+
+                     const std::string context = history.context_for(id);
+                     require(context.find("Summary of earlier conversation:") != std::string::npos,
+                             "summary missing: " + context);
+                     require(context.find("User: question 11") != std::string::npos,
+                             "latest turn should be verbatim");
+                     require(context.find("User: question 0\n") == std::string::npos,
+                             "oldest turn should no longer be verbatim");
+                     require(context.find("noise") == std::string::npos,
+                             "system entries should be left out");
+                     require(summarize_calls.load() < 12, "summaries should be batched");
+                     require(largest < 700, "context should stay bounded");
+
+                     s::SessionStore reopened(dir);
+                     auto state = reopened.get_state(id);
+                     require(state.ok(), state.error());
+                     require(state.value().summary_through > 0, "summary position not persisted");
+                     require(state.value().history_summary.find("\"answer\"") != std::string::npos,
+                             "summary should round-trip quotes");
+                     require(reopened.upsert_state({.session_id = id, .model = "m"}).ok(),
+                             "plain upsert failed");
+                     require(reopened.get_state(id).value().history_summary ==
+                                 state.value().history_summary,
+                             "plain upsert should keep the summary");
+                     std::filesystem::remove_all(dir);
+                   }});
+  tests.push_back({"sessions_history_stop_drops_queued_refreshes_and_cancels_current", [] {
+                     const auto dir = make_temp_sessions_dir();
+                     s::SessionStore store(dir);
+                     std::atomic<int> summarize_calls{0};
+                     std::atomic<bool> saw_cancel{false};
+                     s::HistoryOptions options;
+                     options.recent_messages = 1;
+                     options.summarize_batch = 1;
+                     {
+                       s::SessionHistory history(
+                           &store,
+                           [&](const std::string &previous, const std::string &messages,
+                               std::size_t budget) {
+                             ++summarize_calls;
+                             // Stands in for a provider call that honours the thread's token.
+                             const auto token = ghostclaw::common::current_cancel_token();
+                             saw_cancel = token != nullptr &&
+                                          token->wait_for(std::chrono::seconds(5));
+                             return s::extractive_summary(previous, messages, budget);
+                           },
+                           options);
+                       for (int i = 0; i < 4; ++i) {
+                         const std::string id = "agent:ghostclaw:channel:webhook:peer:p" +
+                                                std::to_string(i);
+                         require(store.upsert_state({.session_id = id}).ok(), "upsert failed");
+                         for (const auto role : {s::TranscriptRole::User,
+                                                 s::TranscriptRole::Assistant}) {
+                           require(store.append_transcript(id, {.role = role, .content = "m"})
+                                       .ok(),
+                                   "append failed");
+                         }
+                         history.schedule_refresh(id);
+                       }
+                       while (summarize_calls.load() == 0) {
+                         std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                       }
+                     }
+                     require(summarize_calls.load() == 1, "queued refreshes should be dropped");
+                     require(saw_cancel.load(), "the refresh in flight should be cancelled");
+                     auto state = store.get_state("agent:ghostclaw:channel:webhook:peer:p0");
+                     require(state.ok() && state.value().summary_through == 0,
+                             "a cancelled refresh should not store its summary");
+                     std::filesystem::remove_all(dir);
+                   }});
+  tests.push_back({"sessions_history_context_reads_only_past_the_summary_cursor", [] {
+                     std::vector<s::TranscriptEntry> transcript;
+                     for (std::uint64_t id = 1; id <= 6; ++id) {
+                       transcript.push_back({.role = id % 2 == 1 ? s::TranscriptRole::User
+                                                                 : s::TranscriptRole::Assistant,
+                                             .content = "message " + std::to_string(id),
+                                             .id = id});
+                     }
+                     const s::SessionState state{.history_summary = "- earlier",
+                                                 .summary_through = 4};
+                     const std::vector<s::TranscriptEntry> page(transcript.begin() + 4,
+                                                                transcript.end());
+
+                     const auto from_page = s::build_history_context(state, page);
+                     require(from_page == s::build_history_context(state, transcript),
+                             "a page past the cursor should give the same context");
+                     require(from_page.find("message 5") != std::string::npos, "tail missing");
+                     require(from_page.find("message 4") == std::string::npos,
+                             "summarised entries should be skipped");
+                   }});
+  tests.push_back({"sessions_idle_sessions_are_archived_and_rehydrated_on_access", [] {
+                     const auto dir = make_temp_sessions_dir();
+                     const std::string old_a = "agent:ghost:channel:test:peer:old-a";
+                     const std::string old_b = "agent:ghost:channel:test:peer:old-b";
+                     const std::string active = "agent:ghost:channel:test:peer:active";
+                     {
+                       s::SessionStore store(dir);
+                       for (int i = 0; i < 3; ++i) {
+                         for (const auto &id : {old_a, old_b}) {
+                           require(store
+                                       .append_transcript(
+                                           id, {.content = id + " message " + std::to_string(i),
+                                                .timestamp = "2020-01-01T00:00:00Z"})
+                                       .ok(),
+                                   "append failed");
+                         }
+                       }
+                       require(store.append_transcript(active, {.content = "recent"}).ok(),
+                               "append failed");
+
+                       auto archived = store.archive_idle(std::chrono::hours(1));
+                       require(archived.ok(), archived.error());
+                       require(archived.value() == 2, "both idle sessions should be archived");
+                       require(store.list_states().value().size() == 1,
+                               "hot index should only hold the active session");
+                       require(store.archive_idle(std::chrono::hours(1)).value() == 0,
+                               "a second pass should find nothing");
+                     }
+
+                     s::SessionStore reopened(dir);
+                     require(reopened.list_states().value().size() == 1,
+                             "archived sessions should stay out of the hot index");
+                     auto listed = reopened.list_archived();
+                     require(listed.ok() && listed.value().size() == 2, "archive index lost");
+                     require(!std::filesystem::exists(dir / "transcripts" /
+                                                      "agent_ghost_channel_test_peer_old-a.jsonl"),
+                             "archived transcript should be removed");
+
+                     auto transcript = reopened.load_transcript(old_a);
+                     require(transcript.ok(), transcript.error());
+                     require(transcript.value().size() == 3, "archived transcript not restored");
+                     require(transcript.value()[2].content == old_a + " message 2",
+                             "restored transcript out of order");
+                     require(reopened.get_state(old_a).ok(), "state should be hot again");
+
+                     require(reopened.append_transcript(old_b, {.content = "back again"}).ok(),
+                             "append to archived session failed");
+                     auto resumed = reopened.load_transcript(old_b);
+                     require(resumed.ok() && resumed.value().size() == 4,
+                             "append should follow the restored transcript");
+                     require(resumed.value().back().id == 4 &&
+                                 resumed.value().back().content == "back again",
+                             "entry ids should continue after the archive");
+                     require(reopened.list_states().value().size() == 3, "sessions not restored");
+                     require(reopened.list_archived().value().empty(), "archive index not updated");
+
+                     bool segment_left = false;
+                     for (const auto &file : std::filesystem::directory_iterator(dir / "archive")) {
+                       segment_left |= file.path().extension() == ".gz";
+                     }
+                     require(!segment_left, "unreferenced segment should be deleted");
+                     std::filesystem::remove_all(dir);
+                   }});
+  tests.push_back({"sessions_archive_keeps_unreadable_or_corrupt_sessions", [] {
+                     const auto dir = make_temp_sessions_dir();
+                     const std::string unreadable = "agent:ghost:channel:test:peer:unreadable";
+                     const std::string corrupt = "agent:ghost:channel:test:peer:corrupt";
+                     s::SessionStore store(dir);
+                     for (const auto &id : {unreadable, corrupt}) {
+                       require(store
+                                   .append_transcript(id, {.content = id + " message",
+                                                           .timestamp = "2020-01-01T00:00:00Z"})
+                                   .ok(),
+                               "append failed");
+                     }
+                     // A directory where the transcript should be opens but cannot be read.
+                     const auto blocked =
+                         dir / "transcripts" / "agent_ghost_channel_test_peer_unreadable.jsonl";
+                     std::filesystem::remove(blocked);
+                     std::filesystem::create_directories(blocked / "keep");
+
+                     auto archived = store.archive_idle(std::chrono::hours(1));
+                     require(archived.ok() && archived.value() == 1,
+                             "only the readable session should be archived");
+                     require(std::filesystem::exists(blocked / "keep"),
+                             "an unreadable transcript must not be removed");
+                     require(store.get_state(unreadable).ok(), "unreadable session should stay hot");
+
+                     for (const auto &file : std::filesystem::directory_iterator(dir / "archive")) {
+                       if (file.path().extension() == ".gz") {
+                         std::ofstream(file.path(), std::ios::binary | std::ios::trunc)
+                             << "not gzip at all, but long enough to cover the entry";
+                       }
+                     }
+                     require(!store.get_state(corrupt).ok(), "corrupt archive should be reported");
+                     require(!store.append_transcript(corrupt, {.content = "new"}).ok(),
+                             "append should not recreate a corrupt session empty");
+                     require(!store.upsert_state({.session_id = corrupt, .model = "m"}).ok(),
+                             "upsert should not recreate a corrupt session empty");
+                     require(store.list_archived().value().size() == 1,
+                             "the archive entry should be kept for recovery");
+                     std::filesystem::remove_all(dir);
+                   }});
 }
@@ -1,17 +1,30 @@
 #include "test_framework.hpp"
 
+#include "ghostclaw/gateway/websocket.hpp"
 #include "ghostclaw/nodes/discovery.hpp"
 #include "ghostclaw/nodes/node.hpp"
+#include "ghostclaw/nodes/scheduler.hpp"
 #include "ghostclaw/security/policy.hpp"
 #include "ghostclaw/sessions/session_key.hpp"
 #include "ghostclaw/sessions/store.hpp"
 #include "ghostclaw/tools/builtin/sessions.hpp"
 
+#include <chrono>
 #include <filesystem>
+#include <functional>
 #include <algorithm>
 #include <memory>
+#include <mutex>
 #include <random>
 #include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 
 namespace {
 
@@ -37,6 +50,63 @@ std::string extract_json_field(const std::string &json, const std::string &field
   return json.substr(start, end - start);
 }
 
+#ifndef _WIN32
+std::uint16_t reserve_local_port() {
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return 0;
+  }
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  socklen_t len = sizeof(addr);
+  std::uint16_t port = 0;
+  if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0 &&
+      getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &len) == 0) {
+    port = ntohs(addr.sin_port);
+  }
+  close(fd);
+  return port;
+}
+#endif
+
+class RecordingNodeTransport final : public ghostclaw::nodes::INodeTransport {
+public:
+  ghostclaw::common::Result<ghostclaw::nodes::NodeActionResult>
+  invoke(const ghostclaw::nodes::NodeDescriptor &node, std::string_view action,
+         const ghostclaw::tools::ToolArgs &args,
+         const ghostclaw::nodes::NodeOutputCallback &on_output,
+         std::chrono::milliseconds timeout,
+         const std::shared_ptr<ghostclaw::common::CancelToken> &cancel_token) override {
+    (void)args;
+    (void)timeout;
+    (void)cancel_token;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      calls.push_back(node.node_id);
+    }
+    if (during_call) {
+      during_call(node.node_id);
+    }
+    if (node.node_id == failing_node) {
+      return ghostclaw::common::Result<ghostclaw::nodes::NodeActionResult>::failure("unreachable");
+    }
+    if (on_output) {
+      on_output(node.node_id + ":" + std::string(action));
+    }
+    ghostclaw::nodes::NodeActionResult result;
+    result.output = "ran on " + node.node_id;
+    return ghostclaw::common::Result<ghostclaw::nodes::NodeActionResult>::success(
+        std::move(result));
+  }
+
+  std::mutex mutex;
+  std::vector<std::string> calls;
+  std::string failing_node;
+  std::function<void(const std::string &)> during_call;
+};
+
 } // namespace
 
 void register_sessions_tools_nodes_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
@@ -267,4 +337,166 @@ void register_sessions_tools_nodes_tests(std::vector<ghostclaw::tests::TestCase>
                      unsetenv("GHOSTCLAW_GPS_LON");
 #endif
                    }});
+
+  tests.push_back({"nodes_scheduler_ranks_by_capability_load_and_failures", [] {
+                     auto registry = std::make_shared<nodes::NodeRegistry>();
+                     auto advertise = [&](const std::string &id, std::vector<std::string> caps,
+                                          bool paired) {
+                       require(registry
+                                   ->advertise({.node_id = id,
+                                                .endpoint = "ws://127.0.0.1:1/" + id,
+                                                .capabilities = std::move(caps),
+                                                .paired = paired,
+                                                .connected = paired})
+                                   .ok(),
+                               "advertise should succeed");
+                     };
+                     advertise("alpha", {"system"}, true);
+                     advertise("beta", {"system.run"}, true);
+                     advertise("camera-only", {"camera"}, true);
+                     advertise("unpaired", {"system"}, false);
+
+                     auto transport = std::make_shared<RecordingNodeTransport>();
+                     auto scheduler = std::make_shared<nodes::NodeScheduler>(registry, transport);
+
+                     const auto ranked = scheduler->rank_candidates("system.run");
+                     require(ranked.size() == 2, "only paired nodes with system capability rank");
+                     require(ranked[0].node_id == "alpha", "ties break by node id");
+
+                     // While alpha is busy its in-flight penalty pushes it behind beta.
+                     std::string busy_front;
+                     transport->during_call = [&](const std::string &node_id) {
+                       const auto during = scheduler->rank_candidates("system.run");
+                       if (node_id == "alpha" && !during.empty()) {
+                         busy_front = during.front().node_id;
+                       }
+                     };
+                     tools::ToolContext ctx;
+                     std::string streamed;
+                     auto first = scheduler->dispatch("system.run", {{"command", "echo hi"}}, ctx,
+                                                      [&](std::string_view chunk) {
+                                                        streamed.append(chunk);
+                                                      });
+                     require(first.ok(), first.error());
+                     require(first.value().remote && first.value().node_id == "alpha",
+                             "first dispatch should go to alpha");
+                     require(busy_front == "beta", "busy node should rank behind idle node");
+                     require(streamed == "alpha:system.run", "output should stream to caller");
+
+                     transport->during_call = nullptr;
+                     transport->failing_node = "alpha";
+                     auto second = scheduler->dispatch("system.run", {{"command", "echo hi"}}, ctx);
+                     require(second.ok(), second.error());
+                     require(second.value().node_id == "beta", "failed node should fall through");
+                     require(second.value().attempts == 2, "both nodes should be attempted");
+                     require(scheduler->rank_candidates("system.run").front().node_id == "beta",
+                             "failure penalty should demote alpha");
+
+                     auto camera = scheduler->dispatch("camera.snap", {}, ctx);
+                     require(camera.ok() && camera.value().node_id == "camera-only",
+                             "capability family should match camera.snap");
+
+                     auto missing = scheduler->dispatch("screen.record", {}, ctx);
+                     require(!missing.ok(), "no capable node and no local fallback should fail");
+
+                     const auto stats = scheduler->stats();
+                     require(stats.size() == 3, "stats should track every node used");
+                     for (const auto &entry : stats) {
+                       require(entry.in_flight == 0, "in-flight counts should be released");
+                     }
+
+                     tools::ToolContext cancelled_ctx = ctx;
+                     cancelled_ctx.cancel_token = std::make_shared<ghostclaw::common::CancelToken>();
+                     cancelled_ctx.cancel_token->cancel();
+                     const auto calls_before = transport->calls.size();
+                     auto cancelled = scheduler->dispatch("system.run", {}, cancelled_ctx);
+                     require(!cancelled.ok(), "cancelled dispatch should fail");
+                     require(transport->calls.size() == calls_before,
+                             "cancelled dispatch should not reach a node");
+
+                     const nodes::NodeActionExecutor local_executor;
+                     auto anonymous = nodes::serve_node_invoke(
+                         local_executor, {{"action", "system.run"}, {"token", ""}}, ctx, "", {});
+                     require(!anonymous.ok(), "a node without serve_token should refuse calls");
+                   }});
+
+#ifndef _WIN32
+  tests.push_back({"nodes_scheduler_offloads_to_local_websocket_nodes", [] {
+                     const auto dir = make_temp_dir();
+                     auto policy = std::make_shared<ghostclaw::security::SecurityPolicy>();
+                     policy->workspace_dir = dir;
+                     policy->workspace_only = true;
+                     policy->allowed_commands = {"echo"};
+                     auto executor = std::make_shared<nodes::NodeActionExecutor>(policy);
+                     tools::ToolContext ctx;
+                     ctx.workspace_path = dir;
+
+                     std::vector<std::unique_ptr<ghostclaw::gateway::WebSocketServer>> servers;
+                     auto registry = std::make_shared<nodes::NodeRegistry>();
+                     for (const std::string id : {"node-a", "node-b"}) {
+                       auto server = std::make_unique<ghostclaw::gateway::WebSocketServer>();
+                       ghostclaw::gateway::WebSocketOptions options;
+                       options.port = reserve_local_port();
+                       options.rpc_handler = [executor, ctx](
+                                                 const ghostclaw::gateway::WsClientMessage &request,
+                                                 const std::function<void(
+                                                     const ghostclaw::gateway::RpcMap &)> &emit) {
+                         return nodes::serve_node_invoke(*executor, request.payload, ctx,
+                                                         "node-secret", emit);
+                       };
+                       auto started = server->start(options);
+                       require(started.ok(), started.error());
+                       require(registry
+                                   ->advertise({.node_id = id,
+                                                .endpoint = "ws://127.0.0.1:" +
+                                                            std::to_string(server->port()) + "/",
+                                                .capabilities = {"system"},
+                                                .paired = true,
+                                                .connected = true,
+                                                .pair_token = "node-secret"})
+                                   .ok(),
+                               "advertise should succeed");
+                       servers.push_back(std::move(server));
+                     }
+
+                     auto scheduler =
+                         std::make_shared<nodes::NodeScheduler>(registry, nullptr, executor);
+                     std::string streamed;
+                     auto remote = scheduler->dispatch("system.run",
+                                                       {{"command", "echo remote \"ok\""}}, ctx,
+                                                       [&](std::string_view chunk) {
+                                                         streamed.append(chunk);
+                                                       });
+                     require(remote.ok(), remote.error());
+                     require(remote.value().remote, "call should run on a websocket node");
+                     require(remote.value().result.success, remote.value().result.output);
+                     require(remote.value().result.output.find("remote ok") != std::string::npos,
+                             "remote output mismatch: " + remote.value().result.output);
+                     require(remote.value().result.metadata["exit_code"] == "0",
+                             "remote metadata should round-trip");
+                     require(streamed.find("remote ok") != std::string::npos,
+                             "remote output should stream back");
+
+                     auto denied = scheduler->dispatch("system.run", {{"command", "rm -rf /"}}, ctx);
+                     require(denied.ok() && denied.value().remote,
+                             "policy rejection should come back as a node result");
+                     require(!denied.value().result.success, "rejected command should fail");
+
+                     servers[0]->stop();
+                     auto failover = scheduler->dispatch("system.run", {{"command", "echo again"}},
+                                                         ctx);
+                     require(failover.ok(), failover.error());
+                     require(failover.value().node_id == "node-b",
+                             "dispatch should fail over to the remaining node");
+
+                     servers[1]->stop();
+                     auto local = scheduler->dispatch("system.run", {{"command", "echo local"}},
+                                                      ctx);
+                     require(local.ok(), local.error());
+                     require(!local.value().remote && local.value().node_id == "local",
+                             "dispatch should fall back to the local executor");
+                     require(local.value().result.output.find("local") != std::string::npos,
+                             "local fallback output mismatch");
+                   }});
+#endif
 }
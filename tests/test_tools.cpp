@@ -3,13 +3,16 @@
 #include "ghostclaw/agent/tool_executor.hpp"
 #include "ghostclaw/canvas/host.hpp"
 #include "ghostclaw/memory/memory.hpp"
+#include "ghostclaw/memory/workspace_walk.hpp"
 #include "ghostclaw/security/approval.hpp"
 #include "ghostclaw/security/policy.hpp"
 #include "ghostclaw/security/tool_policy.hpp"
 #include "ghostclaw/tools/approval.hpp"
+#include "ghostclaw/tools/code_index.hpp"
 #include "ghostclaw/tools/builtin/browser.hpp"
 #include "ghostclaw/tools/builtin/canvas.hpp"
 #include "ghostclaw/tools/builtin/calendar.hpp"
+#include "ghostclaw/tools/builtin/code_search.hpp"
 #include "ghostclaw/tools/builtin/email.hpp"
 #include "ghostclaw/tools/builtin/file_edit.hpp"
 #include "ghostclaw/tools/builtin/file_read.hpp"
@@ -21,16 +24,22 @@
 #include "ghostclaw/tools/builtin/reminder.hpp"
 #include "ghostclaw/tools/builtin/shell.hpp"
 #include "ghostclaw/tools/builtin/skills.hpp"
+#include "ghostclaw/tools/builtin/tool_output.hpp"
 #include "ghostclaw/tools/builtin/web_fetch.hpp"
 #include "ghostclaw/tools/builtin/web_search.hpp"
+#include "ghostclaw/tools/output_store.hpp"
 #include "ghostclaw/tools/plugin/plugin_loader.hpp"
 #include "ghostclaw/tools/policy.hpp"
+#include "ghostclaw/tools/result_cache.hpp"
+#include "ghostclaw/tools/tool_catalog.hpp"
 #include "ghostclaw/tools/tool_registry.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <memory>
+#include <mutex>
 #include <random>
 #include <thread>
 #include <unordered_map>
@@ -170,6 +179,30 @@ private:
   int millis_ = 0;
 };
 
+class CountingCacheableTool final : public ghostclaw::tools::ITool {
+public:
+  [[nodiscard]] std::string_view name() const override { return "counting"; }
+  [[nodiscard]] std::string_view description() const override { return "cacheable counter"; }
+  [[nodiscard]] std::string parameters_schema() const override { return R"({"type":"object"})"; }
+  [[nodiscard]] ghostclaw::common::Result<ghostclaw::tools::ToolResult>
+  execute(const ghostclaw::tools::ToolArgs &, const ghostclaw::tools::ToolContext &) override {
+    ghostclaw::tools::ToolResult result;
+    result.output = "run " + std::to_string(++runs);
+    return ghostclaw::common::Result<ghostclaw::tools::ToolResult>::success(std::move(result));
+  }
+  [[nodiscard]] bool is_safe() const override { return true; }
+  [[nodiscard]] std::string_view group() const override { return "test"; }
+  [[nodiscard]] std::optional<ghostclaw::tools::ToolCachePolicy>
+  cache_policy(const ghostclaw::tools::ToolArgs &args,
+               const ghostclaw::tools::ToolContext &) const override {
+    return ghostclaw::tools::ToolCachePolicy{
+        .key = ghostclaw::tools::canonical_args(args), .version = version, .ttl = {}};
+  }
+
+  int runs = 0;
+  std::string version = "v1";
+};
+
 class AlwaysFailTool final : public ghostclaw::tools::ITool {
 public:
   [[nodiscard]] std::string_view name() const override { return "always_fail"; }
@@ -198,6 +231,28 @@ public:
   [[nodiscard]] std::string_view group() const override { return "runtime"; }
 };
 
+class DescribedTool final : public ghostclaw::tools::ITool {
+public:
+  DescribedTool(std::string tool_name, std::string description, std::string group)
+      : name_(std::move(tool_name)), description_(std::move(description)),
+        group_(std::move(group)) {}
+
+  [[nodiscard]] std::string_view name() const override { return name_; }
+  [[nodiscard]] std::string_view description() const override { return description_; }
+  [[nodiscard]] std::string parameters_schema() const override { return R"({"type":"object"})"; }
+  [[nodiscard]] ghostclaw::common::Result<ghostclaw::tools::ToolResult>
+  execute(const ghostclaw::tools::ToolArgs &, const ghostclaw::tools::ToolContext &) override {
+    return ghostclaw::common::Result<ghostclaw::tools::ToolResult>::success({});
+  }
+  [[nodiscard]] bool is_safe() const override { return true; }
+  [[nodiscard]] std::string_view group() const override { return group_; }
+
+private:
+  std::string name_;
+  std::string description_;
+  std::string group_;
+};
+
 } // namespace
 
 void register_tools_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
@@ -214,7 +269,7 @@ void register_tools_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
 
   tests.push_back({"tool_policy_group_expansion", [] {
                      auto expanded = tools::ToolPolicy::expand_group("fs");
-                     require(expanded.size() == 3, "fs group size mismatch");
+                     require(expanded.size() == 4, "fs group size mismatch");
                    }});
 
   tests.push_back({"tool_policy_deny_overrides_allow", [] {
@@ -267,6 +322,104 @@ void register_tools_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
                      require(result.value().truncated, "large output should be truncated");
                    }});
 
+  tests.push_back({"shell_tool_streams_output_while_running", [] {
+                     const auto ws = make_temp_dir();
+                     auto policy = make_policy(ws);
+                     tools::ShellTool shell(policy);
+                     tools::ToolContext ctx;
+                     ctx.workspace_path = ws;
+
+                     std::mutex mutex;
+                     std::vector<tools::ToolOutputChunk> chunks;
+                     std::chrono::steady_clock::time_point first_chunk{};
+                     ctx.on_output = [&](const tools::ToolOutputChunk &chunk) {
+                       std::lock_guard<std::mutex> lock(mutex);
+                       if (chunks.empty()) {
+                         first_chunk = std::chrono::steady_clock::now();
+                       }
+                       chunks.push_back(chunk);
+                     };
+                     auto result = shell.execute(
+                         {{"command",
+                           "python -c 'import sys, time\n"
+                           "print(\"step 1\", flush=True)\n"
+                           "time.sleep(0.6)\n"
+                           "sys.stderr.write(\"warn\\n\")\n"
+                           "print(\"step 2\")'"}},
+                         ctx);
+                     const auto finished = std::chrono::steady_clock::now();
+                     require(result.ok(), result.error());
+                     require(result.value().output.find("step 2") != std::string::npos,
+                             "captured output should include everything");
+                     require(!chunks.empty(), "output should be streamed");
+                     require(finished - first_chunk >= std::chrono::milliseconds(300),
+                             "first line should arrive before the command ends");
+                     std::string out;
+                     std::string err;
+                     for (const auto &chunk : chunks) {
+                       (chunk.stream == "stderr" ? err : out) += chunk.text;
+                     }
+                     require(out == "step 1\nstep 2\n", "stdout chunks mismatch: " + out);
+                     require(err == "warn\n", "stderr should be tagged separately: " + err);
+                   }});
+
+  tests.push_back({"shell_tool_rate_limits_stream_and_bounds_capture", [] {
+                     const auto ws = make_temp_dir();
+                     auto policy = make_policy(ws);
+                     tools::ShellTool shell(policy);
+                     tools::ToolContext ctx;
+                     ctx.workspace_path = ws;
+
+                     std::size_t streamed = 0;
+                     std::size_t skipped = 0;
+                     ctx.on_output = [&](const tools::ToolOutputChunk &chunk) {
+                       streamed += static_cast<std::size_t>(
+                           std::count(chunk.text.begin(), chunk.text.end(), '\n'));
+                       skipped += chunk.skipped_lines;
+                     };
+                     auto result = shell.execute(
+                         {{"command", "python -c 'print(\"\\n\".join(\"line %d\" % i for i in "
+                                      "range(20000)))'"}},
+                         ctx);
+                     require(result.ok(), result.error());
+                     require(streamed + skipped == 20000, "every line should be streamed or counted");
+                     require(skipped > 0 && streamed < 1000, "stream should be rate limited");
+
+                     const auto &output = result.value().output;
+                     require(result.value().truncated, "large output should be truncated");
+                     require(output.size() < 70 * 1024, "capture should stay bounded");
+                     require(output.rfind("line 0\n", 0) == 0, "capture should keep the head");
+                     require(output.find("line 19999") != std::string::npos,
+                             "capture should keep the tail");
+                     require(output.find("bytes omitted") != std::string::npos,
+                             "capture should mark the omitted middle");
+                   }});
+
+  tests.push_back({"shell_tool_cancel_kills_running_command", [] {
+                     const auto ws = make_temp_dir();
+                     auto policy = make_policy(ws);
+                     tools::ShellTool shell(policy);
+                     tools::ToolContext ctx;
+                     ctx.workspace_path = ws;
+                     ctx.cancel_token = std::make_shared<ghostclaw::common::CancelToken>();
+
+                     std::thread canceller([token = ctx.cancel_token] {
+                       std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                       token->cancel();
+                     });
+                     const auto started = std::chrono::steady_clock::now();
+                     auto result = shell.execute(
+                         {{"command", "python -c 'import time; time.sleep(30)'"}}, ctx);
+                     const auto elapsed = std::chrono::steady_clock::now() - started;
+                     canceller.join();
+
+                     require(result.ok(), result.error());
+                     require(!result.value().success, "cancelled command should not succeed");
+                     require(result.value().output.find("[command cancelled]") != std::string::npos,
+                             "output should note the cancellation");
+                     require(elapsed < std::chrono::seconds(2), "cancel should kill the child promptly");
+                   }});
+
   tests.push_back({"file_read_success", [] {
                      const auto ws = make_temp_dir();
                      auto policy = make_policy(ws);
@@ -354,6 +507,122 @@ void register_tools_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
                      require(!result.ok(), "non-unique replacement should fail");
                    }});
 
+  tests.push_back({"file_read_byte_and_line_ranges", [] {
+                     const auto ws = make_temp_dir();
+                     auto policy = make_policy(ws);
+                     {
+                       std::ofstream out(ws / "big.log");
+                       for (int i = 1; i <= 3000; ++i) {
+                         out << "line " << i << "\n";
+                       }
+                     }
+                     tools::FileReadTool tool(policy);
+                     tools::ToolContext ctx;
+                     ctx.workspace_path = ws;
+
+                     auto bytes = tool.execute({{"path", "big.log"}, {"offset", "7"}, {"limit", "6"}},
+                                               ctx);
+                     require(bytes.ok(), bytes.error());
+                     require(bytes.value().output == "line 2", "byte range mismatch");
+
+                     auto lines = tool.execute(
+                         {{"path", "big.log"}, {"start_line", "2049"}, {"line_count", "2"}}, ctx);
+                     require(lines.ok(), lines.error());
+                     require(lines.value().output == "line 2049\nline 2050\n",
+                             "line range mismatch: " + lines.value().output);
+                     require(lines.value().metadata.at("end_line") == "2050", "end_line mismatch");
+
+                     auto earlier = tool.execute(
+                         {{"path", "big.log"}, {"start_line", "1024"}, {"line_count", "1"}}, ctx);
+                     require(earlier.ok() && earlier.value().output == "line 1024\n",
+                             "cached checkpoints should serve earlier lines");
+
+                     auto tail = tool.execute({{"path", "big.log"}, {"tail_lines", "2"}}, ctx);
+                     require(tail.ok(), tail.error());
+                     require(tail.value().output == "line 2999\nline 3000\n", "tail mismatch");
+
+                     auto past_end = tool.execute({{"path", "big.log"}, {"start_line", "5000"}}, ctx);
+                     require(past_end.ok() && past_end.value().output.empty(),
+                             "lines past the end should read nothing");
+
+                     auto capped = tool.execute({{"path", "big.log"}, {"start_line", "1"}}, ctx);
+                     require(capped.ok() && capped.value().truncated, "large range should truncate");
+                     require(capped.value().metadata.at("next_offset") == "20480",
+                             "truncated read should report where to continue");
+
+                     std::ofstream(ws / "big.log", std::ios::app) << "line 3001\n";
+                     auto appended = tool.execute({{"path", "big.log"}, {"tail_lines", "1"}}, ctx);
+                     require(appended.ok() && appended.value().output == "line 3001\n",
+                             "appended line should be visible");
+
+                     auto mixed = tool.execute(
+                         {{"path", "big.log"}, {"offset", "1"}, {"start_line", "1"}}, ctx);
+                     require(!mixed.ok(), "byte and line ranges cannot be combined");
+                     auto negative = tool.execute({{"path", "big.log"}, {"offset", "-1"}}, ctx);
+                     require(!negative.ok(), "negative offset should be rejected");
+                   }});
+
+  tests.push_back({"file_edit_applies_batch_atomically", [] {
+                     const auto ws = make_temp_dir();
+                     auto policy = make_policy(ws);
+                     std::string original;
+                     for (int i = 0; i < 2000; ++i) {
+                       original += "filler " + std::to_string(i) + "\n";
+                     }
+                     original = "alpha\n" + original + "omega\n";
+                     std::ofstream(ws / "doc.txt") << original;
+                     std::filesystem::permissions(ws / "doc.txt",
+                                                  std::filesystem::perms::owner_read |
+                                                      std::filesystem::perms::owner_write |
+                                                      std::filesystem::perms::owner_exec);
+                     tools::FileEditTool editor(policy);
+                     tools::ToolContext ctx;
+                     ctx.workspace_path = ws;
+
+                     auto edited = editor.execute(
+                         {{"path", "doc.txt"},
+                          {"edits", R"([{"old_string":"omega","new_string":"OMEGA"},)"
+                                    R"({"old_string":"alpha\n","new_string":""}])"}},
+                         ctx);
+                     require(edited.ok(), edited.error());
+                     require(edited.value().metadata.at("edits") == "2", "edit count mismatch");
+
+                     auto read_all = [&] {
+                       std::ifstream in(ws / "doc.txt");
+                       return std::string(std::istreambuf_iterator<char>(in), {});
+                     };
+                     std::string expected = original.substr(6);
+                     expected.replace(expected.find("omega"), 5, "OMEGA");
+                     require(read_all() == expected, "batch edit content mismatch");
+                     const auto perms = std::filesystem::status(ws / "doc.txt").permissions();
+                     require((perms & std::filesystem::perms::owner_exec) !=
+                                 std::filesystem::perms::none,
+                             "file mode should be preserved");
+
+                     auto missing = editor.execute(
+                         {{"path", "doc.txt"},
+                          {"edits", R"([{"old_string":"OMEGA","new_string":"x"},)"
+                                    R"({"old_string":"absent","new_string":"y"}])"}},
+                         ctx);
+                     require(!missing.ok(), "a failing edit should reject the batch");
+                     require(missing.error().find("edit 2") != std::string::npos,
+                             "error should name the failing edit");
+                     require(read_all() == expected, "rejected batch must leave the file untouched");
+
+                     auto overlap = editor.execute(
+                         {{"path", "doc.txt"},
+                          {"edits", R"([{"old_string":"filler 1999","new_string":"a"},)"
+                                    R"({"old_string":"1999\nOMEGA","new_string":"b"}])"}},
+                         ctx);
+                     require(!overlap.ok(), "overlapping edits should be rejected");
+
+                     std::size_t leftovers = 0;
+                     for (const auto &entry : std::filesystem::directory_iterator(ws)) {
+                       leftovers += entry.path().filename() != "doc.txt" ? 1 : 0;
+                     }
+                     require(leftovers == 0, "no temporary files should remain");
+                   }});
+
   tests.push_back({"memory_tools_store_recall_forget", [] {
                      FakeMemory memory;
                      tools::MemoryStoreTool store(&memory);
@@ -540,6 +809,162 @@ void register_tools_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
                      require(elapsed.count() < 450, "tools should run in parallel");
                    }});
 
+  tests.push_back({"tool_executor_tags_streamed_output", [] {
+                     const auto ws = make_temp_dir();
+                     tools::ToolRegistry registry;
+                     registry.register_tool(std::make_unique<tools::ShellTool>(make_policy(ws)));
+                     agent::ToolExecutor executor(registry);
+                     tools::ToolContext ctx;
+                     ctx.workspace_path = ws;
+                     std::vector<tools::ToolOutputChunk> chunks;
+                     ctx.on_output = [&](const tools::ToolOutputChunk &chunk) {
+                       chunks.push_back(chunk);
+                     };
+                     auto results = executor.execute(
+                         {{.id = "call-7", .name = "shell", .arguments = {{"command", "echo live"}}}},
+                         ctx);
+                     require(results.size() == 1 && results[0].result.success, "shell should run");
+                     require(chunks.size() == 1, "one chunk expected");
+                     require(chunks[0].call_id == "call-7" && chunks[0].tool == "shell",
+                             "executor should tag chunks with the call");
+                     require(chunks[0].text == "live\n", "chunk text mismatch");
+                   }});
+
+  tests.push_back({"tool_result_cache_checks_version_and_evicts_lru", [] {
+                     tools::ToolResultCache cache(2, 1024);
+                     tools::ToolResult result;
+                     result.output = "a";
+                     const tools::ToolCachePolicy a{.key = "a", .version = "1", .ttl = {}};
+                     cache.store("t", a, result);
+                     require(cache.lookup("t", a).has_value(), "stored entry should hit");
+                     require(!cache.lookup("other", a).has_value(), "tool name is part of the key");
+
+                     const tools::ToolCachePolicy a2{.key = "a", .version = "2", .ttl = {}};
+                     require(!cache.lookup("t", a2).has_value(), "new version should miss");
+                     require(!cache.lookup("t", a).has_value(), "stale entry should be dropped");
+
+                     const tools::ToolCachePolicy b{.key = "b", .version = "1", .ttl = {}};
+                     const tools::ToolCachePolicy c{.key = "c", .version = "1", .ttl = {}};
+                     cache.store("t", a, result);
+                     cache.store("t", b, result);
+                     (void)cache.lookup("t", a);
+                     cache.store("t", c, result);
+                     require(cache.lookup("t", a).has_value(), "recently used entry should stay");
+                     require(!cache.lookup("t", b).has_value(), "least recently used entry should go");
+
+                     tools::ToolResult big;
+                     big.output.assign(2048, 'x');
+                     cache.store("t", b, big);
+                     require(!cache.lookup("t", b).has_value(), "oversized result should not be kept");
+
+                     const tools::ToolCachePolicy expiring{
+                         .key = "e", .version = "1", .ttl = std::chrono::milliseconds(1)};
+                     cache.store("t", expiring, result);
+                     std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                     require(!cache.lookup("t", expiring).has_value(), "expired entry should miss");
+
+                     const auto stats = cache.stats();
+                     require(stats.hits == 3 && stats.entries <= 2, "stats mismatch");
+                     require(tools::canonical_args({{"a", "1"}, {"b", "2"}}) ==
+                                 tools::canonical_args({{"b", "2"}, {"a", "1"}}),
+                             "canonical args should not depend on map order");
+                   }});
+
+  tests.push_back({"tool_executor_reuses_cacheable_results", [] {
+                     tools::ToolRegistry registry;
+                     auto counting = std::make_unique<CountingCacheableTool>();
+                     auto *tool = counting.get();
+                     registry.register_tool(std::move(counting));
+                     agent::ToolExecutor executor(registry);
+                     tools::ToolContext ctx;
+
+                     const std::vector<agent::ToolCallRequest> call = {
+                         {.id = "1", .name = "counting", .arguments = {{"q", "x"}}}};
+                     auto uncached = executor.execute(call, ctx);
+                     (void)executor.execute(call, ctx);
+                     require(tool->runs == 2, "without a cache every call should run");
+
+                     executor.set_result_cache(std::make_shared<tools::ToolResultCache>());
+                     auto first = executor.execute(call, ctx);
+                     auto second = executor.execute(call, ctx);
+                     require(tool->runs == 3, "identical call should be served from cache");
+                     require(second[0].result.output == first[0].result.output, "cached output mismatch");
+                     require(second[0].result.metadata["cache"] == "hit", "hit should be marked");
+
+                     (void)executor.execute({{.id = "2", .name = "counting", .arguments = {{"q", "y"}}}},
+                                            ctx);
+                     require(tool->runs == 4, "different arguments should run");
+                     tool->version = "v2";
+                     auto refreshed = executor.execute(call, ctx);
+                     require(tool->runs == 5 && refreshed[0].result.output == "run 5",
+                             "version change should invalidate");
+                   }});
+
+  tests.push_back({"tool_executor_cached_file_read_sees_writes", [] {
+                     const auto ws = make_temp_dir();
+                     tools::ToolRegistry registry;
+                     registry.register_tool(std::make_unique<tools::FileReadTool>(make_policy(ws)));
+                     agent::ToolExecutor executor(registry);
+                     executor.set_result_cache(std::make_shared<tools::ToolResultCache>());
+                     tools::ToolContext ctx;
+                     ctx.workspace_path = ws;
+
+                     {
+                       std::ofstream out(ws / "notes.txt");
+                       out << "first";
+                     }
+                     const std::vector<agent::ToolCallRequest> call = {
+                         {.id = "1", .name = "file_read", .arguments = {{"path", "notes.txt"}}}};
+                     auto first = executor.execute(call, ctx);
+                     require(first[0].result.success && first[0].result.output == "first", "read failed");
+                     auto second = executor.execute(call, ctx);
+                     require(second[0].result.metadata["cache"] == "hit", "repeat read should hit");
+
+                     {
+                       std::ofstream out(ws / "notes.txt", std::ios::trunc);
+                       out << "second version";
+                     }
+                     auto third = executor.execute(call, ctx);
+                     require(third[0].result.output == "second version", "write should invalidate");
+                     require(!third[0].result.metadata.contains("cache"), "changed file should miss");
+                   }});
+
+  tests.push_back({"file_tools_do_not_follow_symlinks_in_workspace", [] {
+                     const auto ws = make_temp_dir();
+                     const auto policy = make_policy(ws);
+                     tools::ToolContext ctx;
+                     ctx.workspace_path = ws;
+                     {
+                       std::ofstream out(ws / "real.txt");
+                       out << "alpha beta";
+                     }
+                     std::error_code ec;
+                     std::filesystem::create_symlink(ws / "real.txt", ws / "link.txt", ec);
+                     if (ec) {
+                       return;
+                     }
+
+                     tools::FileReadTool read(policy);
+                     require(read.execute({{"path", "real.txt"}}, ctx).ok(), "plain read should work");
+                     auto via_link = read.execute({{"path", "link.txt"}}, ctx);
+                     require(!via_link.ok() && via_link.error().find("Symlink") != std::string::npos,
+                             "read through symlink should be refused");
+
+                     tools::FileEditTool edit(policy);
+                     auto edited = edit.execute(
+                         {{"path", "link.txt"}, {"old_string", "alpha"}, {"new_string", "gamma"}}, ctx);
+                     require(!edited.ok(), "edit through symlink should be refused");
+
+                     tools::FileWriteTool write(policy);
+                     auto written = write.execute({{"path", "nested/dir/out.txt"}, {"content", "x"}}, ctx);
+                     require(written.ok(), written.error());
+                     require(std::filesystem::exists(ws / "nested" / "dir" / "out.txt"),
+                             "write should create parent directories");
+                     require(std::distance(std::filesystem::directory_iterator(ws / "nested" / "dir"),
+                                           std::filesystem::directory_iterator{}) == 1,
+                             "no temporary files should be left behind");
+                   }});
+
   tests.push_back({"tool_executor_circuit_breaker", [] {
                      tools::ToolRegistry registry;
                      registry.register_tool(std::make_unique<AlwaysFailTool>());
@@ -605,6 +1030,40 @@ void register_tools_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
                              "approval deny message expected");
                    }});
 
+  tests.push_back({"tool_executor_parks_calls_awaiting_approval", [] {
+                     tools::ToolRegistry registry;
+                     registry.register_tool(std::make_unique<SafeShellTool>());
+
+                     ghostclaw::security::ApprovalPolicy policy;
+                     policy.security = ghostclaw::security::ExecSecurity::Full;
+                     policy.ask = ghostclaw::security::ExecAsk::Always;
+
+                     const auto temp = make_temp_dir();
+                     auto approval = std::make_shared<ghostclaw::security::ApprovalManager>(
+                         policy, temp / "approvals.txt", temp / "approvals.sock");
+
+                     agent::ToolExecutor::Dependencies deps;
+                     deps.approval = approval;
+                     agent::ToolExecutor executor(registry, deps);
+
+                     tools::ToolContext ctx;
+                     ctx.park_approvals = true;
+                     const std::vector<agent::ToolCallRequest> calls = {
+                         {.id = "1", .name = "shell", .arguments = {{"command", "echo hello"}}}};
+                     // No approver is listening: without parking this would wait and deny.
+                     const auto parked = executor.execute(calls, ctx);
+                     require(parked.size() == 1, "single result expected");
+                     require(parked[0].awaiting_approval, "call should await approval");
+                     require(parked[0].result.metadata.at("approval_command") == "echo hello",
+                             "approval command should be reported");
+
+                     const auto approved = executor.execute_approved(calls, ctx);
+                     require(approved.size() == 1 && !approved[0].awaiting_approval,
+                             "approved call should run");
+                     require(approved[0].result.success && approved[0].result.output == "ok",
+                             "approved call output mismatch");
+                   }});
+
   tests.push_back({"approval_manager_smart_mode", [] {
                      tools::ApprovalManager approval(tools::ApprovalMode::Smart);
                      DummySafeTool safe;
@@ -696,6 +1155,231 @@ void register_tools_tests(std::vector<ghostclaw::tests::TestCase> &tests) {
                      require(cancelled.ok(), cancelled.error());
                    }});
 
+  tests.push_back({"tool_output_store_pages_spilled_output", [] {
+                     const auto ws = make_temp_dir();
+                     tools::ToolOutputStore store(tools::ToolOutputStore::default_root(ws), 2);
+                     std::string content;
+                     for (int i = 1; i <= 50; ++i) {
+                       content += "line " + std::to_string(i) + (i == 30 ? " ERROR here" : "") + "\n";
+                     }
+                     auto stored = store.put("s1", content);
+                     require(stored.ok(), stored.error());
+                     require(stored.value().lines == 50, "line count mismatch");
+                     require(stored.value().handle.rfind("out-", 0) == 0, "handle prefix expected");
+                     require(!store.get("s2", stored.value().handle).ok(),
+                             "outputs should be scoped to their session");
+                     require(!store.get("s1", "../../etc/passwd").ok(), "bad handle should fail");
+
+                     const auto preview = tools::spill_preview(content, stored.value(), 100);
+                     require(preview.find("line 1\n") == 0, "preview should start with the head");
+                     require(preview.find("line 50") != std::string::npos,
+                             "preview should keep the tail");
+                     require(preview.find("line 25") == std::string::npos,
+                             "preview should omit the middle");
+
+                     tools::ToolOutputTool tool;
+                     tools::ToolContext ctx;
+                     ctx.workspace_path = ws;
+                     ctx.session_id = "s1";
+                     auto page = tool.execute(
+                         {{"handle", stored.value().handle}, {"offset", "10"}, {"limit", "3"}}, ctx);
+                     require(page.ok(), page.error());
+                     require(page.value().output.find("10: line 10\n11: line 11\n12: line 12\n") == 0,
+                             "page should number lines from offset");
+                     require(page.value().output.find("continue with offset=13") != std::string::npos,
+                             "page footer should give the next offset");
+
+                     auto grep = tool.execute({{"handle", stored.value().handle}, {"pattern", "error"}},
+                                              ctx);
+                     require(grep.ok(), grep.error());
+                     require(grep.value().output.find("30: line 30 ERROR here") == 0,
+                             "pattern should match case-insensitively");
+
+                     for (int i = 0; i < 2; ++i) {
+                       std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                       require(store.put("s1", "newer").ok(), "put should succeed");
+                     }
+                     require(!store.get("s1", stored.value().handle).ok(),
+                             "oldest output should be pruned");
+                   }});
+
+  tests.push_back({"tool_catalog_selects_core_and_relevant_tools", [] {
+                     tools::ToolRegistry registry;
+                     registry.register_tool(std::make_unique<DescribedTool>(
+                         "shell", "Run a shell command", "runtime"));
+                     registry.register_tool(std::make_unique<DescribedTool>(
+                         "web_search", "Search the web for pages", "web"));
+                     registry.register_tool(std::make_unique<DescribedTool>(
+                         "calendar", "Create and list calendar events", "calendar"));
+                     registry.register_tool(std::make_unique<DescribedTool>(
+                         "email", "Send email messages", "messaging"));
+                     registry.register_tool(std::make_unique<DescribedTool>(
+                         "canvas", "Render a canvas", "ui"));
+                     tools::ToolCatalog catalog(registry, {"shell"});
+
+                     require(catalog.size() == 5, "catalog should snapshot every tool");
+                     require(catalog.specs()[1].function_json ==
+                                 R"({"type":"function","function":{"name":"web_search",)"
+                                 R"("description":"Search the web for pages",)"
+                                 R"("parameters":{"type":"object"}}})",
+                             "function JSON should be serialised up front");
+
+                     const auto names = [](const std::vector<tools::ToolSpec> &specs) {
+                       std::string out;
+                       for (const auto &spec : specs) {
+                         out += spec.name + ",";
+                       }
+                       return out;
+                     };
+
+                     tools::ToolSelectionRequest request;
+                     request.message = "searching for news about the launch";
+                     request.max_tools = 2;
+                     require(names(catalog.select(request)) == "shell,web_search,",
+                             "core tool plus best match expected, got " +
+                                 names(catalog.select(request)));
+
+                     request.message = "what next?";
+                     request.recent_tools = {"email"};
+                     require(names(catalog.select(request)) == "shell,email,",
+                             "recently used tool should be kept");
+
+                     request.recent_tools.clear();
+                     request.context = "Skill: use the calendar tool for scheduling";
+                     require(names(catalog.select(request)) == "shell,calendar,",
+                             "tool named in skill context should be offered");
+
+                     request.allow = [](const tools::ToolSpec &spec) { return spec.name != "email"; };
+                     request.max_tools = 4;
+                     require(names(catalog.select(request)) == "shell,web_search,calendar,canvas,",
+                             "all allowed tools fit under the limit");
+                     request.max_tools = 0;
+                     require(catalog.select(request).size() == 4, "0 should mean no limit");
+                   }});
+
+  tests.push_back({"gitignore_glob_match_segments", [] {
+                     namespace memory = ghostclaw::memory;
+                     require(memory::gitignore_glob_match("*.log", "debug.log"), "star glob");
+                     require(!memory::gitignore_glob_match("*.log", "logs/debug.log"),
+                             "star stays within a segment");
+                     require(memory::gitignore_glob_match("**/foo", "a/b/foo"), "leading globstar");
+                     require(memory::gitignore_glob_match("**/foo", "foo"), "globstar may be empty");
+                     require(!memory::gitignore_glob_match("**/foo", "xfoo"),
+                             "globstar must end at a separator");
+                     require(memory::gitignore_glob_match("a/**/b", "a/x/y/b"), "inner globstar");
+                   }});
+
+  tests.push_back({"code_index_searches_and_tracks_changes", [] {
+                     const auto ws = make_temp_dir();
+                     std::filesystem::create_directories(ws / "src");
+                     std::filesystem::create_directories(ws / "build");
+                     {
+                       std::ofstream(ws / ".gitignore") << "build/\n*.log\n";
+                       std::ofstream(ws / "src" / "main.cpp")
+                           << "int main() {\n  return run_server(8080);\n}\n";
+                       std::ofstream(ws / "src" / "util.cpp")
+                           << "int run_client() { return 0; }\n// RUN_SERVER docs\n";
+                       std::ofstream(ws / "build" / "gen.cpp") << "run_server(1);\n";
+                       std::ofstream(ws / "trace.log") << "run_server called\n";
+                     }
+
+                     tools::CodeIndex index(ws, tools::CodeIndex::default_path(ws));
+                     auto literal = index.search({.pattern = "run_server"});
+                     require(literal.ok(), literal.error());
+                     require(literal.value().matches.size() == 1, "ignored files must not match");
+                     require(literal.value().matches[0].path == "src/main.cpp" &&
+                                 literal.value().matches[0].line == 2,
+                             "literal match location");
+                     require(literal.value().candidates == 2,
+                             "trigrams are case-folded, so RUN_SERVER keeps util.cpp a candidate");
+                     auto narrow = index.search({.pattern = "run_client"});
+                     require(narrow.ok(), narrow.error());
+                     require(narrow.value().candidates == 1, "trigrams should rule out main.cpp");
+
+                     auto folded = index.search({.pattern = "run_server", .case_sensitive = false});
+                     require(folded.ok(), folded.error());
+                     require(folded.value().matches.size() == 2, "case-insensitive match count");
+
+                     auto regex = index.search({.pattern = "run_(server|client)\\(", .regex = true});
+                     require(regex.ok(), regex.error());
+                     require(regex.value().matches.size() == 2, "regex match count");
+
+                     auto scoped = index.search(
+                         {.pattern = "run_", .case_sensitive = false, .path_prefix = "src"});
+                     require(scoped.ok(), scoped.error());
+                     require(scoped.value().matches.size() == 3, "files under src should match");
+                     auto partial = index.search({.pattern = "run_", .path_prefix = "sr"});
+                     require(partial.ok(), partial.error());
+                     require(partial.value().matches.empty(), "prefix must name a directory");
+
+                     auto capped = index.search(
+                         {.pattern = "run_", .case_sensitive = false, .max_results = 1});
+                     require(capped.ok(), capped.error());
+                     require(capped.value().matches.size() == 1 && capped.value().truncated,
+                             "max_results should cap and flag truncation");
+
+                     auto bad = index.search({.pattern = "run_(", .regex = true});
+                     require(!bad.ok(), "invalid regex should fail");
+
+                     std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                     std::ofstream(ws / "src" / "util.cpp") << "void run_server_later();\n";
+                     std::ofstream(ws / "src" / "extra.cpp") << "auto x = run_server_extra;\n";
+                     std::filesystem::remove(ws / "src" / "main.cpp");
+                     require(index.refresh().ok(), "refresh should succeed");
+                     auto updated = index.search({.pattern = "run_server"});
+                     require(updated.ok(), updated.error());
+                     require(updated.value().matches.size() == 2, "edited file should be re-indexed");
+                     require(updated.value().candidates == 2, "removed file should leave postings");
+                     require(index.file_count() == 3, "live file count mismatch");
+
+                     const auto index_path = tools::CodeIndex::default_path(ws);
+                     require(std::filesystem::exists(index_path), "index should be persisted");
+                     require(std::filesystem::exists(index_path.string() + ".journal"),
+                             "changes should be appended to the journal");
+                     tools::CodeIndex reloaded(ws, index_path);
+                     auto again = reloaded.search({.pattern = "run_server_"});
+                     require(again.ok(), again.error());
+                     require(again.value().matches.size() == 2, "reloaded index should search");
+                     require(reloaded.file_count() == 3, "indexed file count mismatch");
+                   }});
+
+  tests.push_back({"code_index_regex_skips_overlong_lines", [] {
+                     const auto ws = make_temp_dir();
+                     {
+                       std::ofstream(ws / "bundle.min.js")
+                           << std::string(400000, 'a') << "\nvar needle_b = 1;\n";
+                     }
+                     tools::CodeIndex index(ws, tools::CodeIndex::default_path(ws));
+                     auto found = index.search({.pattern = "a|x.*b", .regex = true});
+                     require(found.ok(), found.error());
+                     require(found.value().long_lines_skipped == 1,
+                             "the minified line should be skipped, not matched");
+                     require(found.value().matches.size() == 1 &&
+                                 found.value().matches[0].line == 2,
+                             "short lines should still be regex-searched");
+                     auto literal = index.search({.pattern = "aaaa"});
+                     require(literal.ok() && literal.value().matches.size() == 1,
+                             "literal search should still match the long line");
+                   }});
+
+  tests.push_back({"code_search_tool_formats_matches", [] {
+                     const auto ws = make_temp_dir();
+                     std::ofstream(ws / "notes.txt") << "alpha\nbeta gamma\n";
+                     tools::CodeSearchTool tool;
+                     tools::ToolContext ctx;
+                     ctx.workspace_path = ws;
+                     auto hit = tool.execute({{"query", "gamma"}}, ctx);
+                     require(hit.ok(), hit.error());
+                     require(hit.value().output.find("notes.txt:2: beta gamma") != std::string::npos,
+                             "match line expected, got " + hit.value().output);
+                     auto miss = tool.execute({{"query", "delta"}}, ctx);
+                     require(miss.ok(), miss.error());
+                     require(miss.value().output.find("No matches") != std::string::npos,
+                             "empty result message expected");
+                     auto missing = tool.execute({}, ctx);
+                     require(!missing.ok(), "query is required");
+                   }});
+
   tests.push_back({"plugin_loader_empty_dir", [] {
                      const auto ws = make_temp_dir();
                      tools::plugin::PluginLoader loader(ws / "plugins");